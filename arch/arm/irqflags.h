@@ -56,6 +56,19 @@ static inline void arch_irq_disable(void)
 	asm("msr cpsr_c, %0" :: "r"(cpsr | 0x80));
 }
 
+static inline uint32_t arch_irq_save(void)
+{
+	uint32_t cpsr;
+	asm volatile("mrs %0, cpsr" : "=r"(cpsr) :: "memory");
+	asm volatile("msr cpsr_c, %0" :: "r"(cpsr | 0x80) : "memory");
+	return cpsr;
+}
+
+static inline void arch_irq_restore(uint32_t flags)
+{
+	asm volatile("msr cpsr_c, %0" :: "r"(flags) : "memory");
+}
+
 #elif defined(CONFIG_ARCH_ARMV7A)
 
 static inline void arch_irq_enable(void)
@@ -68,6 +81,19 @@ static inline void arch_irq_disable(void)
 	asm("cpsid if");
 }
 
+static inline uint32_t arch_irq_save(void)
+{
+	uint32_t cpsr;
+	asm volatile("mrs %0, cpsr" : "=r"(cpsr) :: "memory");
+	asm volatile("cpsid if" ::: "memory");
+	return cpsr;
+}
+
+static inline void arch_irq_restore(uint32_t flags)
+{
+	asm volatile("msr cpsr_c, %0" :: "r"(flags) : "memory");
+}
+
 #elif defined(CONFIG_ARCH_ARMV7M)
 
 static inline void arch_irq_enable(void)
@@ -80,6 +106,19 @@ static inline void arch_irq_disable(void)
 	asm("cpsid i");
 }
 
+static inline uint32_t arch_irq_save(void)
+{
+	uint32_t primask;
+	asm volatile("mrs %0, primask" : "=r"(primask) :: "memory");
+	asm volatile("cpsid i" ::: "memory");
+	return primask;
+}
+
+static inline void arch_irq_restore(uint32_t flags)
+{
+	asm volatile("msr primask, %0" :: "r"(flags) : "memory");
+}
+
 #endif
 
 #endif /* ARM_IRQFLAGS_H_ */
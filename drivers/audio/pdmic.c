@@ -61,11 +61,84 @@ static int _pdmic_dma_transfer_callback(void* arg, void* arg2)
 	return callback_call(&desc->rx.callback, NULL);
 }
 
+static int _pdmic_ring_callback(void* arg, void* arg2)
+{
+	struct _pdmic_desc* desc = (struct _pdmic_desc*)arg;
+	uint8_t* data;
+
+	if (!desc->rx.ring.active)
+		return 0;
+
+	/* blocks complete in descriptor order */
+	data = desc->rx.ring.buffer.data + desc->rx.ring.next * desc->rx.ring.period_size;
+	cache_invalidate_region(data, desc->rx.ring.period_size);
+	desc->rx.ring.next = (desc->rx.ring.next + 1) % desc->rx.ring.periods;
+
+	desc->rx.ring.block.data = data;
+	desc->rx.ring.block.size = desc->rx.ring.period_size;
+	desc->rx.ring.block.attr = PDMIC_BUF_ATTR_READ;
+
+	return callback_call(&desc->rx.ring.callback, &desc->rx.ring.block);
+}
+
+/**
+ * \brief Get the prescaler giving the closest PDM clock from a source clock
+ * \param clk source clock
+ * \param f_pdmic expected PDM clock
+ * \param error set to the PDM clock error
+ * \return prescaler value
+ */
+static uint32_t _pdmic_prescal(uint32_t clk, uint32_t f_pdmic, uint32_t* error)
+{
+	/* f = SELCK / (2 * (PRESCAL + 1)), rounded */
+	uint32_t div = (clk + f_pdmic) / (2 * f_pdmic);
+	uint32_t f;
+
+	if (div == 0)
+		div = 1;
+	f = clk / (2 * div);
+	*error = f > f_pdmic ? f - f_pdmic : f_pdmic - f;
+	return div - 1;
+}
+
+/**
+ * \brief Select the PLLA divider for the generated clock giving the closest
+ * PDM clock, the generated clock must be three times lower than the
+ * peripheral clock.
+ */
+static uint32_t _pdmic_gck_div(struct _pdmic_desc* desc)
+{
+	uint32_t id = get_pdmic_id_from_addr(desc->addr);
+	uint32_t f_pdmic = desc->sample_rate * desc->dsp_osr;
+	uint32_t plla = pmc_get_plla_clock();
+	uint32_t pclk = pmc_get_peripheral_clock(id);
+	uint32_t div, best_div = 0, best_error = UINT32_MAX;
+
+	for (div = 1; div <= 256; div++) {
+		uint32_t gclk = plla / div;
+		uint32_t error;
+
+		if (gclk < 2 * f_pdmic)
+			break;
+		if (3 * gclk > pclk)
+			continue;
+		if (_pdmic_prescal(gclk, f_pdmic, &error) >= PDMIC_MR_PRESCAL_MAX_VAL)
+			continue;
+		if (error < best_error) {
+			best_error = error;
+			best_div = div;
+		}
+	}
+
+	return best_div;
+}
+
 static void _pdmic_dma_transfer(struct _pdmic_desc* desc, struct _buffer* buffer)
 {
 	struct _callback _cb;
 
 	memset(&desc->rx.dma.cfg, 0, sizeof(desc->rx.dma.cfg));
+	desc->rx.dma.cfg_dma.loop = false;
 
 	desc->rx.dma.cfg.saddr = (void*)&desc->addr->PDMIC_CDR;
 	desc->rx.dma.cfg.daddr = buffer->data;
@@ -133,6 +206,7 @@ int pdmic_configure(struct _pdmic_desc *desc)
 	uint32_t dspr0_val, dspr1_val;
 	uint32_t pclk_rate, gclk_rate;
 	uint32_t pclk_prescal, gclk_prescal;
+	uint32_t pclk_error, gclk_error;
 	uint32_t f_pdmic;
 	uint32_t id = get_pdmic_id_from_addr(desc->addr);
 
@@ -220,14 +294,15 @@ int pdmic_configure(struct _pdmic_desc *desc)
 	pclk_rate = pmc_get_peripheral_clock(id);
 	gclk_rate = pmc_get_gck_clock(id);
 
-	/* PRESCAL = SELCK/(2*f_pdmic) - 1*/
-	pclk_prescal = (uint32_t)(pclk_rate / (f_pdmic << 1)) - 1;
-	gclk_prescal = (uint32_t)(gclk_rate / (f_pdmic << 1)) - 1;
+	/* PRESCAL = SELCK/(2*f_pdmic) - 1, use the most accurate clock */
+	pclk_prescal = _pdmic_prescal(pclk_rate, f_pdmic, &pclk_error);
+	gclk_prescal = _pdmic_prescal(gclk_rate, f_pdmic, &gclk_error);
 
-	if (pclk_prescal < PDMIC_MR_PRESCAL_MAX_VAL) {
-		mr_val = PDMIC_MR_PRESCAL(pclk_prescal) | PDMIC_MR_CLKS_PCLK;
-	} else if (gclk_prescal < PDMIC_MR_PRESCAL_MAX_VAL) {
+	if (gclk_rate && gclk_prescal < PDMIC_MR_PRESCAL_MAX_VAL &&
+	    (pclk_prescal >= PDMIC_MR_PRESCAL_MAX_VAL || gclk_error < pclk_error)) {
 		mr_val = PDMIC_MR_PRESCAL(gclk_prescal) | PDMIC_MR_CLKS_GCLK;
+	} else if (pclk_prescal < PDMIC_MR_PRESCAL_MAX_VAL) {
+		mr_val = PDMIC_MR_PRESCAL(pclk_prescal) | PDMIC_MR_CLKS_PCLK;
 	} else {
 		trace_error("PDMIC Prescal configure error");
 		return -EINVAL;
@@ -292,9 +367,11 @@ int pdmic_init(struct _pdmic_desc *desc)
 	struct _pmc_periph_cfg cfg = {
 		.gck = {
 			.css = PMC_PCR_GCKCSS_PLLA_CLK,
-			.div = 18,
+			.div = _pdmic_gck_div(desc),
 		},
 	};
+	if (cfg.gck.div == 0)
+		cfg.gck.div = 18;
 	pmc_configure_peripheral(id, &cfg, true);
 
 #if (TRACE_LEVEL >= TRACE_LEVEL_DEBUG)
@@ -346,6 +423,11 @@ bool pdmic_rx_transfer_is_done(struct _pdmic_desc* desc)
 
 void pdmic_rx_stop(struct _pdmic_desc* desc)
 {
+	if (desc->rx.ring.active) {
+		pdmic_ring_stop(desc);
+		return;
+	}
+
 	if (desc->transfer_mode == PDMIC_MODE_DMA) {
 		if (desc->rx.dma.channel){
 			dma_stop_transfer(desc->rx.dma.channel);
@@ -353,3 +435,71 @@ void pdmic_rx_stop(struct _pdmic_desc* desc)
 		}
 	}
 }
+
+int pdmic_ring_start(struct _pdmic_desc* desc, struct _buffer* buf,
+		uint8_t periods, struct _callback* cb)
+{
+#ifdef CONFIG_HAVE_XDMAC
+	struct _callback _cb;
+	uint32_t sample_size;
+	uint8_t i;
+
+	sample_size = desc->dsp_size == PDMIC_CONVERTED_DATA_SIZE_32 ? 4 : 2;
+	if (buf == NULL || buf->size == 0 || periods < 2 ||
+	    periods > PDMIC_RING_MAX_PERIODS ||
+	    (buf->size % (periods * sample_size)) != 0)
+		return -EINVAL;
+
+	if (!mutex_try_lock(&desc->rx.mutex))
+		return -EBUSY;
+
+	desc->rx.ring.periods = periods;
+	desc->rx.ring.next = 0;
+	desc->rx.ring.period_size = buf->size / periods;
+	desc->rx.ring.buffer = *buf;
+	callback_copy(&desc->rx.ring.callback, cb);
+
+	memset(desc->rx.ring.cfg, 0, sizeof(desc->rx.ring.cfg));
+	for (i = 0; i < periods; i++) {
+		desc->rx.ring.cfg[i].saddr = (void*)&desc->addr->PDMIC_CDR;
+		desc->rx.ring.cfg[i].daddr = buf->data + i * desc->rx.ring.period_size;
+		desc->rx.ring.cfg[i].len = desc->rx.ring.period_size / sample_size;
+	}
+
+	desc->rx.dma.cfg_dma.data_width = sample_size == 4 ?
+		DMA_DATA_WIDTH_WORD : DMA_DATA_WIDTH_HALF_WORD;
+	desc->rx.dma.cfg_dma.loop = true;
+
+	/* no dirty line may be evicted over captured samples */
+	cache_invalidate_region(buf->data, buf->size);
+
+	dma_configure_transfer(desc->rx.dma.channel, &desc->rx.dma.cfg_dma,
+			desc->rx.ring.cfg, periods);
+	/* interrupt at the end of each period */
+	xdmac_enable_channel_it(desc->rx.dma.channel->hw,
+			desc->rx.dma.channel->id, XDMAC_CIE_BIE);
+	callback_set(&_cb, _pdmic_ring_callback, (void*)desc);
+	dma_set_callback(desc->rx.dma.channel, &_cb);
+
+	desc->rx.ring.active = true;
+	dma_start_transfer(desc->rx.dma.channel);
+	pdmic_stream_convert(desc, true);
+
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+void pdmic_ring_stop(struct _pdmic_desc* desc)
+{
+	if (!desc->rx.ring.active)
+		return;
+
+	desc->rx.ring.active = false;
+	pdmic_stream_convert(desc, false);
+	dma_stop_transfer(desc->rx.dma.channel);
+	dma_reset_channel(desc->rx.dma.channel);
+	desc->rx.dma.cfg_dma.loop = false;
+	mutex_unlock(&desc->rx.mutex);
+}
@@ -64,6 +64,9 @@
 #define PDMIC_DSPR_SHIFT_MAX_VAL (16)
 #define PDMIC_DSPR_DGAIN_MAX_VAL (32768)
 
+/** Maximum number of periods of a capture ring */
+#define PDMIC_RING_MAX_PERIODS  (8)
+
 #define PDMIC_SUCCESS           (0)
 #define PDMIC_INVALID_PARAMETER (1)
 #define PDMIC_ERROR_LOCK        (2)
@@ -107,6 +110,18 @@ struct _pdmic_desc {
 			struct _dma_cfg cfg_dma;
 			struct _dma_transfer_cfg cfg;
 		} dma;
+
+		/* continuous capture, one DMA descriptor per period */
+		struct {
+			bool active;
+			uint8_t periods;
+			uint8_t next;
+			uint32_t period_size;
+			struct _buffer buffer;
+			struct _buffer block;
+			struct _callback callback;
+			struct _dma_transfer_cfg cfg[PDMIC_RING_MAX_PERIODS];
+		} ring;
 	} rx;
 };
 
@@ -132,6 +147,28 @@ extern int pdmic_transfer(struct _pdmic_desc* desc, struct _buffer* buf, struct
 
 extern void pdmic_rx_stop(struct _pdmic_desc* desc);
 
+/**
+ * \brief Start continuous capture into a ring of periods. The DMA
+ * descriptors are linked in a loop so that conversion never stops between
+ * periods. The callback is called from the DMA interrupt for each filled
+ * period with a struct _buffer describing it as second argument, the period
+ * is overwritten periods - 1 periods later.
+ * \param desc PDMIC descriptor
+ * \param buf ring buffer, size must be a multiple of periods and of the
+ * sample size
+ * \param periods number of periods, 2 to PDMIC_RING_MAX_PERIODS
+ * \param cb period callback
+ * \return 0 on success, -EINVAL for an invalid ring, -EBUSY if a transfer
+ * is in progress, -ENOTSUP if the DMA controller cannot loop
+ */
+extern int pdmic_ring_start(struct _pdmic_desc* desc, struct _buffer* buf,
+		uint8_t periods, struct _callback* cb);
+
+/**
+ * \brief Stop continuous capture and conversion.
+ */
+extern void pdmic_ring_stop(struct _pdmic_desc* desc);
+
 extern bool pdmic_rx_transfer_is_done(struct _pdmic_desc* desc);
 
 #endif /* _PDMIC_H */
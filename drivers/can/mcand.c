@@ -43,6 +43,7 @@
 #include "can/mcand.h"
 #include "errno.h"
 #include "irq/irq.h"
+#include "irqflags.h"
 #include "mm/cache.h"
 #include "peripherals/pmc.h"
 #include "trace.h"
@@ -296,6 +297,9 @@ static int mcan_initialize(struct _mcan_desc* desc, const struct mcan_config *cf
 	/* Extended ID Filter AND mask */
 	mcan->MCAN_XIDAM = 0x1FFFFFFF;
 
+	/* Timestamp counter incremented every CAN bit time */
+	mcan->MCAN_TSCC = MCAN_TSCC_TSS_TCP_INC | MCAN_TSCC_TCP(0);
+
 	/* Interrupt configuration - leave initialization with all interrupts off
 	 * Disable all interrupts */
 	mcan_disable_it(mcan, MCAN_INT_ALL);
@@ -670,6 +674,98 @@ static void _mcand_rx_fifo_handler(struct _mcan_desc *desc, enum _mcan_ram fifo)
 	}
 }
 
+static uint32_t _mcand_rx_fifo_level(struct _mcan_desc *desc,
+				     enum _mcan_ram fifo, uint32_t *get)
+{
+	uint32_t status;
+
+	if (fifo == MCAN_RAM_RX_FIFO1) {
+		status = desc->addr->MCAN_RXF1S;
+		*get = (status & MCAN_RXF1S_F1GI_Msk) >> MCAN_RXF1S_F1GI_Pos;
+		return (status & MCAN_RXF1S_F1FL_Msk) >> MCAN_RXF1S_F1FL_Pos;
+	}
+	status = desc->addr->MCAN_RXF0S;
+	*get = (status & MCAN_RXF0S_F0GI_Msk) >> MCAN_RXF0S_F0GI_Pos;
+	return (status & MCAN_RXF0S_F0FL_Msk) >> MCAN_RXF0S_F0FL_Pos;
+}
+
+static void _mcand_rx_ring_handler(struct _mcan_desc *desc, enum _mcan_ram fifo)
+{
+	struct _mcan_rx_ring *ring = &desc->rx_ring[fifo == MCAN_RAM_RX_FIFO1];
+	uint32_t get;
+	uint32_t fill = _mcand_rx_fifo_level(desc, fifo, &get);
+
+	if (fill > ring->stats.max_fill)
+		ring->stats.max_fill = fill;
+	if (fill)
+		callback_call(&ring->cb, (void*)fill);
+}
+
+static void _mcand_tx_queue_fill(struct _mcan_desc *desc)
+{
+	struct _mcan_tx_queue *txq = &desc->tx_queue;
+	Mcan *mcan = desc->addr;
+	uint32_t fifo_start = desc->set.cfg.item_count[MCAN_RAM_TX_BUFFER];
+	uint32_t fifo_end = fifo_start + desc->set.cfg.item_count[MCAN_RAM_TX_FIFO];
+	uint32_t elem_size = MCAN_RAM_BUF_HDR_SIZE + desc->set.cfg.buf_size_tx / 4;
+	uint32_t status = mcan->MCAN_TXFQS;
+	uint32_t free = (status & MCAN_TXFQS_TFFL_Msk) >> MCAN_TXFQS_TFFL_Pos;
+	uint32_t put = (status & MCAN_TXFQS_TFQPI_Msk) >> MCAN_TXFQS_TFQPI_Pos;
+	uint32_t request = 0;
+
+	/* n frames are written to n consecutive buffers from the put index,
+	 * then requested at once */
+	while (free && txq->tail != txq->head) {
+		struct _mcan_tx_element *elem = &txq->elements[txq->tail];
+		uint32_t *tx_buf = desc->set.ram_array_tx + put * elem_size;
+		uint32_t len = get_data_length((enum mcan_dlc)
+				((elem->t1 & MCAN_RAM_T1_DLC_Msk) >> MCAN_RAM_T1_DLC_Pos));
+		uint32_t i;
+
+		tx_buf[0] = elem->t0;
+		tx_buf[1] = elem->t1;
+		for (i = 0; i < (len + 3) / 4; i++)
+			tx_buf[2 + i] = elem->data[i];
+
+		request |= 1u << put;
+		if (++put >= fifo_end)
+			put = fifo_start;
+		if (++txq->tail >= txq->size)
+			txq->tail = 0;
+		free--;
+	}
+
+	if (request) {
+		dsb();
+		txq->pending |= request;
+		mcan->MCAN_TXBTIE |= request;
+		mcan->MCAN_TXBAR = request;
+	}
+}
+
+static void _mcand_tx_queue_handler(struct _mcan_desc *desc)
+{
+	struct _mcan_tx_queue *txq = &desc->tx_queue;
+	Mcan *mcan = desc->addr;
+	uint32_t done = mcan->MCAN_TXBTO & txq->pending;
+	uint32_t count = 0;
+	uint32_t bits;
+
+	if (!done)
+		return;
+
+	txq->pending &= ~done;
+	mcan->MCAN_TXBTIE &= ~done;
+	for (bits = done; bits; bits &= bits - 1)
+		count++;
+	txq->sent += count;
+
+	if (txq->active)
+		_mcand_tx_queue_fill(desc);
+
+	callback_call(&txq->cb, (void*)count);
+}
+
 /**
  * Interrupt handler for MCAN Driver.
  */
@@ -703,6 +799,35 @@ static void _mcan_handler(uint32_t source, void* user_arg)
 	status = mcan_get_status(mcan);
 
 	dsb();
+	if (desc->rx_ring[0].active) {
+		if (status & MCAN_IR_RF0F)
+			desc->rx_ring[0].stats.full++;
+		if (status & MCAN_IR_RF0L)
+			desc->rx_ring[0].stats.lost++;
+		if (status & (MCAN_IR_RF0N | MCAN_IR_RF0W | MCAN_IR_RF0F |
+			      MCAN_IR_RF0L)) {
+			mcan_clear_status(mcan, MCAN_IR_RF0N | MCAN_IR_RF0W |
+					  MCAN_IR_RF0F | MCAN_IR_RF0L);
+			_mcand_rx_ring_handler(desc, MCAN_RAM_RX_FIFO0);
+		}
+		status &= ~(MCAN_IR_RF0N | MCAN_IR_RF0W | MCAN_IR_RF0F |
+			    MCAN_IR_RF0L);
+	}
+	if (desc->rx_ring[1].active) {
+		if (status & MCAN_IR_RF1F)
+			desc->rx_ring[1].stats.full++;
+		if (status & MCAN_IR_RF1L)
+			desc->rx_ring[1].stats.lost++;
+		if (status & (MCAN_IR_RF1N | MCAN_IR_RF1W | MCAN_IR_RF1F |
+			      MCAN_IR_RF1L)) {
+			mcan_clear_status(mcan, MCAN_IR_RF1N | MCAN_IR_RF1W |
+					  MCAN_IR_RF1F | MCAN_IR_RF1L);
+			_mcand_rx_ring_handler(desc, MCAN_RAM_RX_FIFO1);
+		}
+		status &= ~(MCAN_IR_RF1N | MCAN_IR_RF1W | MCAN_IR_RF1F |
+			    MCAN_IR_RF1L);
+	}
+
 	if (status & MCAN_IR_RF0N) {
 		mcan_clear_status(mcan, MCAN_IR_RF0N);
 		_mcand_rx_fifo_handler(desc, MCAN_RAM_RX_FIFO0);
@@ -712,24 +837,24 @@ static void _mcan_handler(uint32_t source, void* user_arg)
 		_mcand_rx_fifo_handler(desc, MCAN_RAM_RX_FIFO1);
 	}
 
-	if (status & MCAN_IR_RF0F) {
-		mcan_clear_status(mcan, MCAN_IR_RF0F);
-		trace_warning("Receive FIFO 0 Watermark Reached\n\r");
-	}
 	if (status & MCAN_IR_RF0W) {
 		mcan_clear_status(mcan, MCAN_IR_RF0W);
+		trace_warning("Receive FIFO 0 Watermark Reached\n\r");
+	}
+	if (status & MCAN_IR_RF0F) {
+		mcan_clear_status(mcan, MCAN_IR_RF0F);
 		trace_warning("Receive FIFO 0 Full\n\r");
 	}
 	if (status & MCAN_IR_RF0L) {
 		mcan_clear_status(mcan, MCAN_IR_RF0L);
 		trace_warning("Receive FIFO 0 Message Lost\n\r");
 	}
-	if (status & MCAN_IR_RF1F) {
-		mcan_clear_status(mcan, MCAN_IR_RF1F);
-		trace_warning("Receive FIFO 1 Watermark Reached\n\r");
-	}
 	if (status & MCAN_IR_RF1W) {
 		mcan_clear_status(mcan, MCAN_IR_RF1W);
+		trace_warning("Receive FIFO 1 Watermark Reached\n\r");
+	}
+	if (status & MCAN_IR_RF1F) {
+		mcan_clear_status(mcan, MCAN_IR_RF1F);
 		trace_warning("Receive FIFO 1 Full\n\r");
 	}
 	if (status & MCAN_IR_RF1L) {
@@ -744,6 +869,7 @@ static void _mcan_handler(uint32_t source, void* user_arg)
 	if (status & MCAN_IR_TC) {
 		mcan_clear_status(mcan, MCAN_IR_TC);
 		_mcand_tx_buffer_handler(desc);
+		_mcand_tx_queue_handler(desc);
 	}
 
 	if (status & MCAN_IR_TCF) {
@@ -930,6 +1056,19 @@ static int mcand_set_baudrate(Mcan *mcan, uint32_t freq, uint32_t freq_fd)
 	return 0;
 }
 
+/**
+ * \brief Enable the transmission interrupt of Tx Buffers. The interrupt
+ * handler clears the bits of the buffers sent, the read-modify-write of
+ * TXBTIE runs with interrupts masked.
+ */
+static void _mcand_enable_tx_it(Mcan *mcan, uint32_t mask)
+{
+	uint32_t flags = arch_irq_save();
+
+	mcan->MCAN_TXBTIE |= mask;
+	arch_irq_restore(flags);
+}
+
 static uint8_t* mcan_prepare_tx_buffer(struct _mcan_desc *desc, uint8_t buf_idx, uint32_t id, uint8_t len)
 {
 	struct mcan_set *set = &desc->set;
@@ -960,7 +1099,7 @@ static uint8_t* mcan_prepare_tx_buffer(struct _mcan_desc *desc, uint8_t buf_idx,
 	*tx_buf++ = val;
 	/* enable transmit from buffer to set TC interrupt bit in IR,
 	 * but interrupt will not happen unless TC interrupt is enabled */
-	mcan->MCAN_TXBTIE = (1 << buf_idx);
+	_mcand_enable_tx_it(mcan, 1 << buf_idx);
 	return (uint8_t *)tx_buf;   /* now it points to the data field */
 }
 
@@ -995,7 +1134,7 @@ static void mcan_enqueue_outgoing_msg(struct _mcan_desc *desc,
 	/* enable transmit from buffer to set TC interrupt bit in IR,
 	 * but interrupt will not happen unless TC interrupt is enabled
 	 */
-	mcan->MCAN_TXBTIE = (1 << putIdx);
+	_mcand_enable_tx_it(mcan, 1 << putIdx);
 	/* request to send */
 	mcan->MCAN_TXBAR = (1 << putIdx);
 }
@@ -1010,6 +1149,8 @@ static int mcand_tx(struct _mcan_desc *desc, struct _buffer *buf,
 			MCAN_RAM_T0_XTD | MCAN_RAM_T0_XTDID(desc->identifier) :
 			desc->identifier;
 	if (buf->attr & CAND_BUF_ATTR_USING_FIFO) {
+		if (desc->tx_queue.active)
+			return -EBUSY;
 		status = mcand_get_ram(desc, MCAN_RAM_TX_FIFO, &buf_idx);
 		if (status < 0)
 			return status;
@@ -1067,6 +1208,8 @@ static int mcand_rx(struct _mcan_desc *desc, struct _buffer *buf,
 			ram = MCAN_RAM_RX_FIFO0;
 			it = MCAN_IE_RF0NE | MCAN_IE_RF0WE | MCAN_IE_RF0FE | MCAN_IE_RF0LE;
 		}
+		if (desc->rx_ring[ram == MCAN_RAM_RX_FIFO1].active)
+			return -EBUSY;
 	} else {
 		ram = MCAN_RAM_RX_BUFFER;
 		it = MCAN_IE_DRXE;
@@ -1247,3 +1390,275 @@ int mcand_transfer(struct _mcan_desc *desc, struct _buffer *buf,
 		return mcand_rx(desc, buf, cb);
 	return -EINVAL;
 }
+
+int mcand_rx_ring_filter(struct _mcan_desc* desc, enum _mcan_ram fifo,
+			 uint32_t id, uint32_t mask, bool extended)
+{
+	struct mcan_set *set = &desc->set;
+	uint32_t *filter;
+	uint8_t filt_idx;
+	int status;
+
+	if (fifo != MCAN_RAM_RX_FIFO0 && fifo != MCAN_RAM_RX_FIFO1)
+		return -EINVAL;
+
+	if (extended) {
+		status = mcand_get_ram(desc, MCAN_RAM_EXT_FILTER, &filt_idx);
+		if (status < 0)
+			return status;
+		filter = set->ram_filt_ext + filt_idx * MCAN_RAM_FILT_EXT_SIZE;
+		*filter++ = ((fifo == MCAN_RAM_RX_FIFO1) ?
+				MCAN_RAM_F0_EFEC_FIFO1 : MCAN_RAM_F0_EFEC_FIFO0)
+			| MCAN_RAM_F0_EFID1(id);
+		*filter = MCAN_RAM_F1_EFT_CLASSIC | MCAN_RAM_F1_EFID2(mask);
+	} else {
+		status = mcand_get_ram(desc, MCAN_RAM_STD_FILTER, &filt_idx);
+		if (status < 0)
+			return status;
+		filter = set->ram_filt_std + filt_idx * MCAN_RAM_FILT_STD_SIZE;
+		*filter = MCAN_RAM_S0_SFT_CLASSIC
+			| ((fifo == MCAN_RAM_RX_FIFO1) ?
+				MCAN_RAM_S0_SFEC_FIFO1 : MCAN_RAM_S0_SFEC_FIFO0)
+			| MCAN_RAM_S0_SFID1(id)
+			| MCAN_RAM_S0_SFID2(mask);
+	}
+	dsb();
+
+	return filt_idx;
+}
+
+int mcand_rx_ring_start(struct _mcan_desc* desc, enum _mcan_ram fifo,
+			uint8_t watermark, struct _callback* cb)
+{
+	struct _mcan_rx_ring *ring;
+	Mcan *mcan = desc->addr;
+	uint32_t it;
+	bool enabled;
+
+	if (fifo != MCAN_RAM_RX_FIFO0 && fifo != MCAN_RAM_RX_FIFO1)
+		return -EINVAL;
+	if (desc->set.cfg.item_count[fifo] == 0 ||
+	    watermark >= desc->set.cfg.item_count[fifo])
+		return -EINVAL;
+
+	/* FIFO elements already handed out by mcand_transfer() */
+	if (desc->set.cfg.ram_status[fifo])
+		return -EBUSY;
+
+	ring = &desc->rx_ring[fifo == MCAN_RAM_RX_FIFO1];
+	if (ring->active)
+		return -EBUSY;
+
+	/* the watermark can only be changed in configuration mode */
+	enabled = mcan_is_enabled(mcan);
+	if (enabled)
+		mcan_disable(mcan);
+	mcan_reconfigure(mcan);
+	if (fifo == MCAN_RAM_RX_FIFO1) {
+		mcan->MCAN_RXF1C = (mcan->MCAN_RXF1C & ~MCAN_RXF1C_F1WM_Msk)
+			| MCAN_RXF1C_F1WM(watermark);
+		it = MCAN_IE_RF1FE | MCAN_IE_RF1LE |
+			(watermark ? MCAN_IE_RF1WE : MCAN_IE_RF1NE);
+	} else {
+		mcan->MCAN_RXF0C = (mcan->MCAN_RXF0C & ~MCAN_RXF0C_F0WM_Msk)
+			| MCAN_RXF0C_F0WM(watermark);
+		it = MCAN_IE_RF0FE | MCAN_IE_RF0LE |
+			(watermark ? MCAN_IE_RF0WE : MCAN_IE_RF0NE);
+	}
+	if (enabled)
+		mcan_enable(mcan);
+
+	memset(&ring->stats, 0, sizeof(ring->stats));
+	ring->watermark = watermark;
+	callback_copy(&ring->cb, cb);
+	ring->active = true;
+
+	mcan_enable_it(mcan, it);
+	return 0;
+}
+
+void mcand_rx_ring_stop(struct _mcan_desc* desc, enum _mcan_ram fifo)
+{
+	struct _mcan_rx_ring *ring = &desc->rx_ring[fifo == MCAN_RAM_RX_FIFO1];
+
+	if (!ring->active)
+		return;
+
+	if (fifo == MCAN_RAM_RX_FIFO1)
+		mcan_disable_it(desc->addr, MCAN_IE_RF1NE | MCAN_IE_RF1WE |
+				MCAN_IE_RF1FE | MCAN_IE_RF1LE);
+	else
+		mcan_disable_it(desc->addr, MCAN_IE_RF0NE | MCAN_IE_RF0WE |
+				MCAN_IE_RF0FE | MCAN_IE_RF0LE);
+	ring->active = false;
+}
+
+uint32_t mcand_rx_ring_peek(struct _mcan_desc* desc, enum _mcan_ram fifo,
+			    struct _mcan_frame* frames, uint32_t max)
+{
+	uint32_t *ram;
+	uint32_t size;
+	uint32_t total;
+	uint32_t get;
+	uint32_t fill;
+	uint32_t i;
+
+	if (fifo == MCAN_RAM_RX_FIFO1) {
+		ram = desc->set.ram_fifo_rx1;
+		size = desc->set.cfg.buf_size_rx_fifo1;
+	} else {
+		ram = desc->set.ram_fifo_rx0;
+		size = desc->set.cfg.buf_size_rx_fifo0;
+	}
+	total = desc->set.cfg.item_count[fifo];
+
+	fill = _mcand_rx_fifo_level(desc, fifo, &get);
+	if (fill > max)
+		fill = max;
+
+	for (i = 0; i < fill; i++) {
+		uint32_t *rx_buf = ram + get * (MCAN_RAM_BUF_HDR_SIZE + size / 4);
+		uint32_t r0 = rx_buf[0];
+		uint32_t r1 = rx_buf[1];
+		struct _mcan_frame *frame = &frames[i];
+
+		if (r0 & MCAN_RAM_R0_XTD) {
+			frame->id = (r0 & MCAN_RAM_R0_XTDID_Msk) >> MCAN_RAM_R0_XTDID_Pos;
+			frame->flags = MCAN_FRAME_EXTENDED;
+		} else {
+			frame->id = (r0 & MCAN_RAM_R0_STDID_Msk) >> MCAN_RAM_R0_STDID_Pos;
+			frame->flags = 0;
+		}
+		if (r0 & MCAN_RAM_R0_RTR)
+			frame->flags |= MCAN_FRAME_REMOTE;
+		if (r0 & MCAN_RAM_R0_ESI)
+			frame->flags |= MCAN_FRAME_ESI;
+		if (r1 & MCAN_RAM_R1_FDF)
+			frame->flags |= MCAN_FRAME_FD;
+		if (r1 & MCAN_RAM_R1_BRS)
+			frame->flags |= MCAN_FRAME_BRS;
+		frame->timestamp = (r1 & MCAN_RAM_R1_RXTS_Msk) >> MCAN_RAM_R1_RXTS_Pos;
+		frame->len = get_data_length((enum mcan_dlc)
+				((r1 & MCAN_RAM_R1_DLC_Msk) >> MCAN_RAM_R1_DLC_Pos));
+		if (frame->len > size)
+			frame->len = size;
+		frame->data = (uint8_t*)&rx_buf[2];
+
+		if (++get >= total)
+			get = 0;
+	}
+
+	return fill;
+}
+
+void mcand_rx_ring_release(struct _mcan_desc* desc, enum _mcan_ram fifo,
+			   uint32_t count)
+{
+	struct _mcan_rx_ring *ring = &desc->rx_ring[fifo == MCAN_RAM_RX_FIFO1];
+	uint32_t total = desc->set.cfg.item_count[fifo];
+	uint32_t get;
+	uint32_t fill = _mcand_rx_fifo_level(desc, fifo, &get);
+
+	if (count > fill)
+		count = fill;
+	if (count == 0)
+		return;
+
+	/* acknowledging an element releases all the elements before it */
+	get = (get + count - 1) % total;
+	if (fifo == MCAN_RAM_RX_FIFO1)
+		mcan_rx_fifo1_ack(desc->addr, get);
+	else
+		mcan_rx_fifo0_ack(desc->addr, get);
+	ring->stats.frames += count;
+}
+
+void mcand_rx_ring_get_stats(struct _mcan_desc* desc, enum _mcan_ram fifo,
+			     struct _mcan_rx_stats* stats)
+{
+	*stats = desc->rx_ring[fifo == MCAN_RAM_RX_FIFO1].stats;
+}
+
+int mcand_tx_queue_start(struct _mcan_desc* desc,
+			 struct _mcan_tx_element* elements, uint16_t size,
+			 struct _callback* cb)
+{
+	struct _mcan_tx_queue *txq = &desc->tx_queue;
+
+	if (elements == NULL || size < 2)
+		return -EINVAL;
+	if (desc->set.cfg.item_count[MCAN_RAM_TX_FIFO] == 0)
+		return -EINVAL;
+
+	/* Tx FIFO elements already handed out by mcand_transfer() */
+	if (desc->set.cfg.ram_status[MCAN_RAM_TX_FIFO] || txq->active)
+		return -EBUSY;
+
+	txq->elements = elements;
+	txq->size = size;
+	txq->head = 0;
+	txq->tail = 0;
+	txq->sent = 0;
+	callback_copy(&txq->cb, cb);
+	txq->active = true;
+
+	mcan_enable_it(desc->addr, MCAN_IE_TCE);
+	return 0;
+}
+
+void mcand_tx_queue_stop(struct _mcan_desc* desc)
+{
+	struct _mcan_tx_queue *txq = &desc->tx_queue;
+	uint32_t flags = arch_irq_save();
+
+	txq->active = false;
+	txq->tail = txq->head;
+	arch_irq_restore(flags);
+}
+
+int mcand_tx_queue_push(struct _mcan_desc* desc,
+			const struct _mcan_frame* frame)
+{
+	struct _mcan_tx_queue *txq = &desc->tx_queue;
+	struct _mcan_tx_element *elem;
+	enum can_mode mode;
+	enum mcan_dlc dlc;
+	uint32_t flags;
+	uint16_t next;
+
+	if (!txq->active)
+		return -EINVAL;
+	if (frame->len > desc->set.cfg.buf_size_tx ||
+	    !mcan_get_length_code(frame->len, &dlc))
+		return -EINVAL;
+
+	next = txq->head + 1;
+	if (next >= txq->size)
+		next = 0;
+	if (next == txq->tail)
+		return -ENOSPC;
+
+	elem = &txq->elements[txq->head];
+	if (frame->flags & MCAN_FRAME_EXTENDED)
+		elem->t0 = MCAN_RAM_T0_XTD | MCAN_RAM_T0_XTDID(frame->id);
+	else
+		elem->t0 = MCAN_RAM_T0_STDID(frame->id);
+	if (frame->flags & MCAN_FRAME_REMOTE)
+		elem->t0 |= MCAN_RAM_T0_RTR;
+	elem->t1 = MCAN_RAM_T1_MM(0) | MCAN_RAM_T1_DLC((uint32_t)dlc);
+	mode = mcan_get_mode(desc->addr);
+	if (mode == CAN_MODE_CAN_FD_CONST_RATE)
+		elem->t1 |= MCAN_RAM_T1_FDF;
+	else if (mode == CAN_MODE_CAN_FD_DUAL_RATE)
+		elem->t1 |= MCAN_RAM_T1_FDF | MCAN_RAM_T1_BRS;
+	memcpy(elem->data, frame->data, frame->len);
+
+	/* keep the interrupt handler away while filling the Tx FIFO, it also
+	 * runs the Tx handlers when entered for another interrupt source */
+	flags = arch_irq_save();
+	txq->head = next;
+	_mcand_tx_queue_fill(desc);
+	arch_irq_restore(flags);
+
+	return 0;
+}
@@ -45,6 +45,57 @@
  *        Types
  *----------------------------------------------------------------------------*/
 
+enum _mcan_frame_flags {
+	MCAN_FRAME_EXTENDED = 0x01, /**< 29-bit identifier */
+	MCAN_FRAME_REMOTE   = 0x02, /**< remote transmission request */
+	MCAN_FRAME_FD       = 0x04, /**< CAN FD format */
+	MCAN_FRAME_BRS      = 0x08, /**< CAN FD bit rate switching */
+	MCAN_FRAME_ESI      = 0x10, /**< transmitter was error passive */
+};
+
+/** View of a frame, as used by the Rx FIFO ring and the Tx queue. Received
+ * frames are not copied: data points into the Message RAM and stays valid
+ * until the frame is released with mcand_rx_ring_release(). */
+struct _mcan_frame {
+	uint32_t id;         /**< 11-bit or 29-bit identifier */
+	uint16_t timestamp;  /**< Rx timestamp, in CAN bit times */
+	uint8_t flags;       /**< MCAN_FRAME_xxx */
+	uint8_t len;         /**< payload length, in bytes */
+	uint8_t* data;       /**< payload */
+};
+
+/** Tx Buffer Element, in Message RAM layout */
+struct _mcan_tx_element {
+	uint32_t t0;
+	uint32_t t1;
+	uint32_t data[16];
+};
+
+struct _mcan_rx_stats {
+	uint32_t frames;     /**< frames released */
+	uint32_t lost;       /**< Message Lost events (at least one frame each) */
+	uint32_t full;       /**< FIFO Full events */
+	uint8_t max_fill;    /**< highest FIFO fill level observed */
+};
+
+struct _mcan_rx_ring {
+	bool active;
+	uint8_t watermark;
+	struct _callback cb;
+	struct _mcan_rx_stats stats;
+};
+
+struct _mcan_tx_queue {
+	bool active;
+	struct _mcan_tx_element* elements;
+	uint16_t size;
+	uint16_t head;       /* next element to be pushed */
+	uint16_t tail;       /* next element to be moved to the Tx FIFO */
+	uint32_t pending;    /* Tx FIFO buffers requested, not yet sent */
+	uint32_t sent;
+	struct _callback cb;
+};
+
 struct _cand_ram_item {
 	struct _buffer *buf;
 	struct _callback cb;
@@ -110,6 +161,9 @@ struct _mcan_desc {
 
 	struct _cand_ram_item * ram_item;
 	struct mcan_set set;
+
+	struct _mcan_rx_ring rx_ring[2];
+	struct _mcan_tx_queue tx_queue;
 };
 
 /*----------------------------------------------------------------------------
@@ -127,5 +181,94 @@ extern int mcand_configure(struct _mcan_desc* desc);
  */
 extern int mcand_transfer(struct _mcan_desc* desc, struct _buffer *buf,
 			  struct _callback* cb);
+
+/**
+ * Route frames matching a classic id/mask filter to a Rx FIFO. A zero mask
+ * accepts every frame.
+ * \param desc      Pointer to CAN Driver descriptor instance.
+ * \param fifo      MCAN_RAM_RX_FIFO0 or MCAN_RAM_RX_FIFO1.
+ * \param id        Identifier to match.
+ * \param mask      Identifier bits to compare.
+ * \param extended  true for 29-bit identifiers.
+ * \return filter index if successful, negative error code otherwise.
+ */
+extern int mcand_rx_ring_filter(struct _mcan_desc* desc, enum _mcan_ram fifo,
+				uint32_t id, uint32_t mask, bool extended);
+
+/**
+ * Hand a Rx FIFO over to the ring API. Frames stay in the Message RAM: the
+ * callback is invoked from the interrupt handler with the FIFO fill level as
+ * second argument, frames are then read with mcand_rx_ring_peek() and
+ * acknowledged in batches with mcand_rx_ring_release(), from the callback or
+ * later from the application.
+ * \param desc       Pointer to CAN Driver descriptor instance.
+ * \param fifo       MCAN_RAM_RX_FIFO0 or MCAN_RAM_RX_FIFO1.
+ * \param watermark  Fill level that triggers the callback, 0 to trigger it on
+ * each new frame.
+ * \param cb         Pointer to call back structure.
+ * \return 0 if successful, negative error code otherwise.
+ */
+extern int mcand_rx_ring_start(struct _mcan_desc* desc, enum _mcan_ram fifo,
+			       uint8_t watermark, struct _callback* cb);
+
+/**
+ * Stop notifying a Rx FIFO ring. Frames not released stay in the FIFO.
+ */
+extern void mcand_rx_ring_stop(struct _mcan_desc* desc, enum _mcan_ram fifo);
+
+/**
+ * Get views on the oldest frames of a Rx FIFO, without acknowledging them.
+ * \param desc    Pointer to CAN Driver descriptor instance.
+ * \param fifo    MCAN_RAM_RX_FIFO0 or MCAN_RAM_RX_FIFO1.
+ * \param frames  Array receiving the frame views.
+ * \param max     Size of the frames array.
+ * \return number of frame views written.
+ */
+extern uint32_t mcand_rx_ring_peek(struct _mcan_desc* desc, enum _mcan_ram fifo,
+				   struct _mcan_frame* frames, uint32_t max);
+
+/**
+ * Acknowledge the oldest frames of a Rx FIFO with a single write of the
+ * acknowledge register, giving their elements back to the hardware.
+ * \param desc   Pointer to CAN Driver descriptor instance.
+ * \param fifo   MCAN_RAM_RX_FIFO0 or MCAN_RAM_RX_FIFO1.
+ * \param count  Number of frames to release.
+ */
+extern void mcand_rx_ring_release(struct _mcan_desc* desc, enum _mcan_ram fifo,
+				  uint32_t count);
+
+/**
+ * Read the receive statistics of a Rx FIFO ring.
+ */
+extern void mcand_rx_ring_get_stats(struct _mcan_desc* desc, enum _mcan_ram fifo,
+				    struct _mcan_rx_stats* stats);
+
+/**
+ * Hand the Tx FIFO over to a software queue. Queued frames are moved to the
+ * Tx FIFO as soon as elements are free, from the transmission complete
+ * interrupt. The callback is invoked with the number of frames sent.
+ * \param desc      Pointer to CAN Driver descriptor instance.
+ * \param elements  Storage for the software queue.
+ * \param size      Number of elements, one of them is kept unused.
+ * \param cb        Pointer to call back structure, may be NULL.
+ * \return 0 if successful, negative error code otherwise.
+ */
+extern int mcand_tx_queue_start(struct _mcan_desc* desc,
+				struct _mcan_tx_element* elements, uint16_t size,
+				struct _callback* cb);
+
+/**
+ * Give the Tx FIFO back to mcand_transfer(). Frames already moved to the Tx
+ * FIFO are still sent, frames left in the software queue are dropped.
+ */
+extern void mcand_tx_queue_stop(struct _mcan_desc* desc);
+
+/**
+ * Queue a frame for transmission.
+ * \return 0 if successful, -ENOSPC if the queue is full, other negative
+ * error code otherwise.
+ */
+extern int mcand_tx_queue_push(struct _mcan_desc* desc,
+			       const struct _mcan_frame* frame);
 /**@}*/
 #endif /* #ifndef _MCAN_H_ */
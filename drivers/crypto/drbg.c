@@ -0,0 +1,289 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "crypto/aesd.h"
+#include "crypto/drbg.h"
+#include "crypto/trngd.h"
+#include "errno.h"
+#include "intmath.h"
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static void _drbg_inc_v(uint8_t* v)
+{
+	int i;
+
+	for (i = DRBG_BLOCK_SIZE - 1; i >= 0; i--)
+		if (++v[i] != 0)
+			break;
+}
+
+/* Encrypt the first 'blocks' blocks of desc->ctr into desc->out */
+static void _drbg_encrypt(struct _drbg_desc* desc, uint32_t blocks)
+{
+	struct _aesd_desc* aes = desc->aes;
+	struct _buffer buf_in = {
+		.data = desc->ctr,
+		.size = blocks * DRBG_BLOCK_SIZE,
+	};
+	struct _buffer buf_out = {
+		.data = desc->out,
+		.size = blocks * DRBG_BLOCK_SIZE,
+	};
+
+	aes->cfg.encrypt = true;
+	aes->cfg.mode = AESD_MODE_ECB;
+	aes->cfg.key_size = AESD_AES256;
+	aes->cfg.entag = false;
+	memcpy(aes->cfg.key, desc->key, DRBG_KEY_SIZE);
+
+	aesd_transfer(aes, &buf_in, &buf_out, NULL, NULL);
+	aesd_wait_transfer(aes);
+}
+
+/* Fill desc->ctr with 'blocks' successive values of V + 1 */
+static void _drbg_fill_counters(struct _drbg_desc* desc, uint32_t blocks)
+{
+	uint32_t i;
+
+	for (i = 0; i < blocks; i++) {
+		_drbg_inc_v(desc->v);
+		memcpy(&desc->ctr[i * DRBG_BLOCK_SIZE], desc->v, DRBG_BLOCK_SIZE);
+	}
+}
+
+/* CTR_DRBG_Update (SP800-90A 10.2.1.2) */
+static void _drbg_update(struct _drbg_desc* desc, const uint8_t* provided)
+{
+	const uint32_t blocks = DRBG_SEED_SIZE / DRBG_BLOCK_SIZE;
+	uint32_t i;
+
+	_drbg_fill_counters(desc, blocks);
+	_drbg_encrypt(desc, blocks);
+
+	if (provided)
+		for (i = 0; i < DRBG_SEED_SIZE; i++)
+			desc->out[i] ^= provided[i];
+
+	memcpy(desc->key, desc->out, DRBG_KEY_SIZE);
+	memcpy(desc->v, &desc->out[DRBG_KEY_SIZE], DRBG_BLOCK_SIZE);
+	memset(desc->out, 0, DRBG_SEED_SIZE);
+}
+
+/* Get a seed from 'entropy' or from the TRNG entropy pool, xor-ed with the
+ * (zero-padded) personalization string or additional input */
+static int _drbg_get_seed(uint8_t* seed, const uint8_t* entropy,
+			  const struct _buffer* input)
+{
+	uint32_t i;
+	int err;
+
+	if (input && input->size > DRBG_SEED_SIZE)
+		return -EINVAL;
+
+	if (entropy) {
+		memcpy(seed, entropy, DRBG_SEED_SIZE);
+	} else {
+		if (!trngd_is_healthy())
+			return -EIO;
+		if (trngd_get_available() < DRBG_SEED_SIZE)
+			return -EAGAIN;
+		err = trngd_read(seed, DRBG_SEED_SIZE);
+		if (err < 0)
+			return err;
+		if (err != DRBG_SEED_SIZE)
+			return -EAGAIN;
+	}
+
+	if (input)
+		for (i = 0; i < input->size; i++)
+			seed[i] ^= input->data[i];
+
+	return 0;
+}
+
+static int _drbg_reseed(struct _drbg_desc* desc, const uint8_t* entropy,
+			const struct _buffer* additional)
+{
+	uint8_t seed[DRBG_SEED_SIZE];
+	int err;
+
+	err = _drbg_get_seed(seed, entropy, additional);
+	if (err < 0)
+		return err;
+
+	_drbg_update(desc, seed);
+	memset(seed, 0, sizeof(seed));
+	desc->reseed_counter = 1;
+
+	return 0;
+}
+
+static int _drbg_generate(struct _drbg_desc* desc, uint8_t* data, uint32_t len,
+			  const struct _buffer* additional)
+{
+	uint8_t input[DRBG_SEED_SIZE];
+	uint32_t blocks, chunk;
+	int err;
+
+	if (!desc->instantiated)
+		return -EINVAL;
+	if (len > DRBG_MAX_REQUEST_SIZE)
+		return -EINVAL;
+	if (additional && additional->size > DRBG_SEED_SIZE)
+		return -EINVAL;
+
+	if (desc->reseed_counter > DRBG_RESEED_INTERVAL) {
+		err = _drbg_reseed(desc, NULL, additional);
+		if (err < 0)
+			return err;
+		additional = NULL;
+	}
+
+	memset(input, 0, sizeof(input));
+	if (additional && additional->size) {
+		memcpy(input, additional->data, additional->size);
+		_drbg_update(desc, input);
+	}
+
+	while (len) {
+		chunk = min_u32(len, sizeof(desc->out));
+		blocks = CEIL_INT_DIV(chunk, DRBG_BLOCK_SIZE);
+		_drbg_fill_counters(desc, blocks);
+		_drbg_encrypt(desc, blocks);
+		memcpy(data, desc->out, chunk);
+		data += chunk;
+		len -= chunk;
+	}
+	memset(desc->out, 0, sizeof(desc->out));
+
+	_drbg_update(desc, input);
+	desc->reseed_counter++;
+
+	return 0;
+}
+
+/*----------------------------------------------------------------------------
+ *        Public functions
+ *----------------------------------------------------------------------------*/
+
+int drbg_instantiate(struct _drbg_desc* desc, const uint8_t* entropy,
+		     const struct _buffer* pers)
+{
+	int err;
+
+	if (!mutex_try_lock(&desc->mutex))
+		return -EBUSY;
+
+	memset(desc->key, 0, sizeof(desc->key));
+	memset(desc->v, 0, sizeof(desc->v));
+	desc->cache_pos = sizeof(desc->cache);
+
+	err = _drbg_reseed(desc, entropy, pers);
+	desc->instantiated = (err == 0);
+
+	mutex_unlock(&desc->mutex);
+	return err;
+}
+
+int drbg_reseed(struct _drbg_desc* desc, const uint8_t* entropy,
+		const struct _buffer* additional)
+{
+	int err;
+
+	if (!desc->instantiated)
+		return -EINVAL;
+
+	if (!mutex_try_lock(&desc->mutex))
+		return -EBUSY;
+
+	err = _drbg_reseed(desc, entropy, additional);
+
+	mutex_unlock(&desc->mutex);
+	return err;
+}
+
+int drbg_generate(struct _drbg_desc* desc, struct _buffer* output,
+		  const struct _buffer* additional)
+{
+	int err;
+
+	if (!mutex_try_lock(&desc->mutex))
+		return -EBUSY;
+
+	err = _drbg_generate(desc, output->data, output->size, additional);
+
+	mutex_unlock(&desc->mutex);
+	return err;
+}
+
+int drbg_rand(struct _drbg_desc* desc, uint32_t* value)
+{
+	int err;
+
+	if (!mutex_try_lock(&desc->mutex))
+		return -EBUSY;
+
+	if (desc->cache_pos + sizeof(*value) > sizeof(desc->cache)) {
+		err = _drbg_generate(desc, desc->cache, sizeof(desc->cache), NULL);
+		if (err < 0) {
+			mutex_unlock(&desc->mutex);
+			return err;
+		}
+		desc->cache_pos = 0;
+	}
+
+	memcpy(value, &desc->cache[desc->cache_pos], sizeof(*value));
+	memset(&desc->cache[desc->cache_pos], 0, sizeof(*value));
+	desc->cache_pos += sizeof(*value);
+
+	mutex_unlock(&desc->mutex);
+	return 0;
+}
+
+void drbg_uninstantiate(struct _drbg_desc* desc)
+{
+	mutex_lock(&desc->mutex);
+	desc->instantiated = false;
+	desc->reseed_counter = 0;
+	memset(desc->key, 0, sizeof(desc->key));
+	memset(desc->v, 0, sizeof(desc->v));
+	memset(desc->cache, 0, sizeof(desc->cache));
+	desc->cache_pos = sizeof(desc->cache);
+	mutex_unlock(&desc->mutex);
+}
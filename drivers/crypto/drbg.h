@@ -0,0 +1,161 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * CTR_DRBG deterministic random bit generator (NIST SP800-90A section 10.2.1)
+ * using AES-256 without derivation function. The AES peripheral (aesd) is
+ * used for block encryption, and full entropy seeds are taken from the TRNG
+ * entropy pool (trngd).
+ *
+ * drbg_rand() returns 32-bit values from a buffer of pre-generated random
+ * bytes and is suitable as a fast rand() replacement, for example as lwIP
+ * LWIP_RAND() or for TCP initial sequence numbers.
+ */
+
+#ifndef _DRBG_H_
+#define _DRBG_H_
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chip.h"
+#include "compiler.h"
+#include "crypto/aesd.h"
+#include "io.h"
+#include "mutex.h"
+
+/*------------------------------------------------------------------------------
+ *         Definitions
+ *------------------------------------------------------------------------------*/
+
+#define DRBG_KEY_SIZE 32
+#define DRBG_BLOCK_SIZE AES_BLOCK_SIZE
+#define DRBG_SEED_SIZE (DRBG_KEY_SIZE + DRBG_BLOCK_SIZE)
+
+/** Maximum number of bytes per request (2^19 bits) */
+#define DRBG_MAX_REQUEST_SIZE 65536
+
+#ifndef DRBG_RESEED_INTERVAL
+/** Number of generate requests between two reseeds */
+#define DRBG_RESEED_INTERVAL 100000
+#endif
+
+#ifndef DRBG_BUFFER_BLOCKS
+/** Number of AES blocks encrypted per AES transfer */
+#define DRBG_BUFFER_BLOCKS 16
+#endif
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+struct _drbg_desc {
+	/* AES driver, its configuration is overwritten by the DRBG */
+	struct _aesd_desc* aes;
+
+	/* --- following fields are used internally --- */
+
+	mutex_t mutex;
+	bool instantiated;
+
+	/* working state */
+	uint8_t key[DRBG_KEY_SIZE];
+	uint8_t v[DRBG_BLOCK_SIZE];
+	uint32_t reseed_counter;
+
+	/* AES transfer buffers */
+	ALIGNED(L1_CACHE_BYTES) uint8_t ctr[DRBG_BUFFER_BLOCKS * DRBG_BLOCK_SIZE];
+	ALIGNED(L1_CACHE_BYTES) uint8_t out[DRBG_BUFFER_BLOCKS * DRBG_BLOCK_SIZE];
+
+	/* random bytes pre-generated for drbg_rand() */
+	uint8_t cache[DRBG_BUFFER_BLOCKS * DRBG_BLOCK_SIZE];
+	uint32_t cache_pos;
+};
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Instantiate the DRBG.
+ * \param desc DRBG descriptor, desc->aes must be initialized (aesd_init)
+ * \param entropy seed (DRBG_SEED_SIZE bytes), NULL to read it from the TRNG
+ * entropy pool
+ * \param pers personalization string (at most DRBG_SEED_SIZE bytes), or NULL
+ * \return 0 on success, -EAGAIN if not enough entropy is available yet,
+ * -EIO on TRNG health test failure, -EINVAL on invalid parameters
+ */
+extern int drbg_instantiate(struct _drbg_desc* desc, const uint8_t* entropy,
+			    const struct _buffer* pers);
+
+/**
+ * \brief Reseed the DRBG.
+ * \param desc DRBG descriptor
+ * \param entropy seed (DRBG_SEED_SIZE bytes), NULL to read it from the TRNG
+ * entropy pool
+ * \param additional additional input (at most DRBG_SEED_SIZE bytes), or NULL
+ * \return 0 on success, <0 on error (see drbg_instantiate)
+ */
+extern int drbg_reseed(struct _drbg_desc* desc, const uint8_t* entropy,
+		       const struct _buffer* additional);
+
+/**
+ * \brief Generate random bytes. The DRBG is automatically reseeded from the
+ * TRNG entropy pool every DRBG_RESEED_INTERVAL requests.
+ * \param desc DRBG descriptor
+ * \param output buffer to fill (at most DRBG_MAX_REQUEST_SIZE bytes)
+ * \param additional additional input (at most DRBG_SEED_SIZE bytes), or NULL
+ * \return 0 on success, -EBUSY if the DRBG is in use, -EAGAIN if a reseed is
+ * required but not enough entropy is available yet, <0 on other errors
+ */
+extern int drbg_generate(struct _drbg_desc* desc, struct _buffer* output,
+			 const struct _buffer* additional);
+
+/**
+ * \brief Get a 32-bit random value from a buffer of pre-generated random
+ * bytes. The buffer is refilled with drbg_generate() when empty.
+ * \param desc DRBG descriptor
+ * \param value random value, only written on success
+ * \return 0 on success, <0 on error (see drbg_generate)
+ */
+extern int drbg_rand(struct _drbg_desc* desc, uint32_t* value);
+
+/**
+ * \brief Clear the internal state of the DRBG.
+ * \param desc DRBG descriptor
+ */
+extern void drbg_uninstantiate(struct _drbg_desc* desc);
+
+#endif /* _DRBG_H_ */
@@ -38,6 +38,7 @@
 #include "errno.h"
 #include "intmath.h"
 #include "irq/irq.h"
+#include "irqflags.h"
 #include "mm/cache.h"
 #include "peripherals/pmc.h"
 #include "serial/console.h"
@@ -126,6 +127,49 @@ static uint8_t _shad_get_dma_chunk_size(enum _shad_algo algo)
 #endif
 }
 
+static int _shad_get_mode(struct _shad_desc* desc, enum _shad_algo algo, uint32_t* mode)
+{
+	uint32_t mr;
+
+	switch (algo) {
+	case ALGO_SHA_1:
+		mr = SHA_MR_ALGO_SHA1;
+		break;
+	case ALGO_SHA_224:
+		mr = SHA_MR_ALGO_SHA224;
+		break;
+	case ALGO_SHA_256:
+		mr = SHA_MR_ALGO_SHA256;
+		break;
+#ifdef SHA_MR_ALGO_SHA384
+	case ALGO_SHA_384:
+		mr = SHA_MR_ALGO_SHA384;
+		break;
+#endif
+#ifdef SHA_MR_ALGO_SHA512
+	case ALGO_SHA_512:
+		mr = SHA_MR_ALGO_SHA512;
+		break;
+#endif
+	default:
+		return -EINVAL;
+	}
+
+	switch (desc->cfg.transfer_mode) {
+	case SHAD_TRANS_POLLING:
+		mr |= SHA_MR_SMOD_AUTO_START;
+		break;
+	case SHAD_TRANS_DMA:
+		mr |= SHA_MR_SMOD_IDATAR0_START;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	*mode = mr | SHA_MR_PROCDLY_LONGEST;
+	return 0;
+}
+
 static void _shad_finish(struct _shad_desc* desc)
 {
 	/* Get output data */
@@ -376,6 +420,310 @@ static int _shad_update_polling(struct _shad_desc* desc, const uint8_t* data, ui
 	}
 }
 
+/*----------------------------------------------------------------------------
+ *        Local functions (hash contexts scheduler)
+ *----------------------------------------------------------------------------*/
+
+static uint8_t _shad_get_state_size(enum _shad_algo algo)
+{
+	switch (algo) {
+	case ALGO_SHA_1:
+		return 20;
+	case ALGO_SHA_224:
+	case ALGO_SHA_256:
+		return 32;
+	default:
+		return 64;
+	}
+}
+
+static void _shad_sched_run(struct _shad_desc* desc);
+
+/* Without user initial hash values, the intermediate hash value of a started
+ * context cannot be restored: no other computation can use the peripheral
+ * until the digest of that context is read */
+static bool _shad_ctx_holds_peripheral(struct _shad_desc* desc)
+{
+#ifdef CONFIG_HAVE_SHA_HMAC
+	return false;
+#else
+	return desc->sched.owner && desc->sched.owner->processed;
+#endif
+}
+
+static void _shad_ctx_restart(struct _shad_ctx* ctx)
+{
+	ctx->remaining = 0;
+	ctx->processed = 0;
+	ctx->reload = true;
+	ctx->req.data = NULL;
+	ctx->req.size = 0;
+	ctx->req.digest = NULL;
+	ctx->req.outer = false;
+
+	if (ctx->hmac) {
+		/* Message is hashed after the pre-computed K0 xor ipad block */
+		memcpy(ctx->state, ctx->ipad_state, sizeof(ctx->state));
+		ctx->processed = _shad_get_block_size(ctx->algo);
+	}
+}
+
+static struct _shad_ctx* _shad_sched_pick(struct _shad_desc* desc)
+{
+	struct _shad_ctx* ctx;
+	struct _shad_ctx* prev = NULL;
+
+	for (ctx = desc->sched.head; ctx; prev = ctx, ctx = ctx->next) {
+#ifndef CONFIG_HAVE_SHA_HMAC
+		/* Without user initial hash values, the intermediate hash
+		 * value of a context cannot be restored: once started, a
+		 * context keeps the peripheral until its digest is read. */
+		if (desc->sched.owner && desc->sched.owner != ctx)
+			continue;
+#endif
+		if (prev)
+			prev->next = ctx->next;
+		else
+			desc->sched.head = ctx->next;
+		if (desc->sched.tail == ctx)
+			desc->sched.tail = prev;
+		ctx->next = NULL;
+		break;
+	}
+	return ctx;
+}
+
+static void _shad_sched_enqueue(struct _shad_desc* desc, struct _shad_ctx* ctx)
+{
+	ctx->next = NULL;
+	if (desc->sched.tail)
+		desc->sched.tail->next = ctx;
+	else
+		desc->sched.head = ctx;
+	desc->sched.tail = ctx;
+}
+
+static void _shad_ctx_load(struct _shad_desc* desc, struct _shad_ctx* ctx)
+{
+	uint32_t mode;
+
+	/* Intermediate hash value already in the peripheral */
+	if (desc->sched.owner == ctx && !ctx->reload)
+		return;
+
+	_shad_get_mode(desc, ctx->algo, &mode);
+	sha_soft_reset();
+	if (ctx->processed) {
+#ifdef CONFIG_HAVE_SHA_HMAC
+		/* Restore the intermediate hash value of the context as the
+		 * user initial hash value */
+		sha_configure(mode | SHA_MR_UIHV);
+		sha_set_msr(0);
+		sha_set_bcr(0);
+		sha_set_ir0(1);
+		sha_set_input(ctx->state, _shad_get_state_size(ctx->algo));
+#else
+		/* unreachable: shad_start() refuses to run while a started
+		 * context holds the peripheral */
+		assert(false);
+#endif
+	} else {
+		sha_configure(mode);
+#ifdef CONFIG_HAVE_SHA_HMAC
+		sha_set_msr(0);
+		sha_set_bcr(0);
+#endif
+	}
+	sha_first_block();
+	desc->sched.owner = ctx;
+	ctx->reload = false;
+}
+
+static void _shad_ctx_slice_done(struct _shad_desc* desc, struct _shad_ctx* ctx)
+{
+	const uint32_t digest_size = shad_get_digest_size(ctx->algo);
+	bool done = false;
+
+	/* Save intermediate hash value */
+	sha_get_output(ctx->state, _shad_get_state_size(ctx->algo));
+
+	if (ctx->req.digest && ctx->remaining == 0) {
+		if (ctx->hmac && !ctx->req.outer) {
+			/* Inner hash done, hash it with the opad state:
+			 * H((K0 xor opad) || H((K0 xor ipad) || text)) */
+			memcpy(ctx->block, ctx->state, digest_size);
+			memcpy(ctx->state, ctx->opad_state, sizeof(ctx->state));
+			ctx->processed = _shad_get_block_size(ctx->algo);
+			ctx->remaining = digest_size;
+			ctx->req.outer = true;
+			ctx->reload = true;
+		} else {
+			memcpy(ctx->req.digest->data, ctx->state, digest_size);
+			desc->sched.owner = NULL;
+			_shad_ctx_restart(ctx);
+			done = true;
+		}
+	} else if (ctx->req.size == 0) {
+		done = true;
+	}
+
+	arch_irq_disable();
+	desc->sched.current = NULL;
+	if (!done)
+		_shad_sched_enqueue(desc, ctx);
+	arch_irq_enable();
+
+	if (done) {
+		ctx->busy = false;
+		callback_call(&ctx->req.callback, NULL);
+	}
+}
+
+static int _shad_ctx_dma_callback(void* arg, void* arg2)
+{
+	struct _shad_desc* desc = (struct _shad_desc*)arg;
+
+	dma_reset_channel(desc->dma_channel);
+
+	/* Wait for the DATRDY bit (Data Ready) in the status register */
+	while ((sha_get_status() & SHA_ISR_DATRDY) == 0);
+
+	_shad_ctx_slice_done(desc, desc->sched.current);
+	_shad_sched_run(desc);
+
+	return 0;
+}
+
+/* Prepare at most one slice of the current request of a context, returns the
+ * number of scatter-gather entries to be hashed */
+static uint32_t _shad_ctx_prepare_slice(struct _shad_ctx* ctx, const uint8_t** sg_data, uint32_t* sg_len)
+{
+	const uint32_t block_size = _shad_get_block_size(ctx->algo);
+	uint32_t sg_count = 0;
+	uint32_t len;
+
+	if (ctx->req.digest) {
+		/* Final slice: append padding to the remaining data */
+		len = _shad_fill_padding(ctx->algo, ctx->processed + ctx->remaining,
+		                         &ctx->block[ctx->remaining],
+		                         ARRAY_SIZE(ctx->block) - ctx->remaining);
+		sg_data[sg_count] = ctx->block;
+		sg_len[sg_count++] = ctx->remaining + len;
+		ctx->remaining = 0;
+		return sg_count;
+	}
+
+	/* Complete the pending partial block */
+	if (ctx->remaining) {
+		len = min_u32(ctx->req.size, block_size - ctx->remaining);
+		memcpy(&ctx->block[ctx->remaining], ctx->req.data, len);
+		ctx->remaining += len;
+		ctx->req.data += len;
+		ctx->req.size -= len;
+		if (ctx->remaining == block_size) {
+			sg_data[sg_count] = ctx->block;
+			sg_len[sg_count++] = block_size;
+			ctx->processed += block_size;
+			ctx->remaining = 0;
+		}
+	}
+
+	/* Hash whole blocks directly from the request buffer */
+	len = min_u32(ctx->req.size, SHAD_CTX_SLICE_SIZE) & ~(block_size - 1);
+	if (len) {
+		sg_data[sg_count] = ctx->req.data;
+		sg_len[sg_count++] = len;
+		ctx->processed += len;
+		ctx->req.data += len;
+		ctx->req.size -= len;
+	}
+
+	/* Keep the last partial block for next update */
+	if (ctx->req.size < block_size) {
+		memcpy(&ctx->block[ctx->remaining], ctx->req.data, ctx->req.size);
+		ctx->remaining += ctx->req.size;
+		ctx->req.size = 0;
+	}
+
+	return sg_count;
+}
+
+static void _shad_sched_run(struct _shad_desc* desc)
+{
+	const uint8_t* sg_data[2];
+	uint32_t sg_len[2];
+	struct _shad_ctx* ctx;
+	uint32_t sg_count, i;
+
+	while (true) {
+		arch_irq_disable();
+		if (desc->sched.current) {
+			arch_irq_enable();
+			return;
+		}
+		ctx = _shad_sched_pick(desc);
+		desc->sched.current = ctx;
+		arch_irq_enable();
+
+		if (!ctx)
+			return;
+
+		_shad_ctx_load(desc, ctx);
+
+		sg_count = _shad_ctx_prepare_slice(ctx, sg_data, sg_len);
+		if (sg_count == 0) {
+			/* Data stored in the context, nothing to hash yet */
+			arch_irq_disable();
+			desc->sched.current = NULL;
+			arch_irq_enable();
+			ctx->busy = false;
+			callback_call(&ctx->req.callback, NULL);
+			continue;
+		}
+
+		if (desc->cfg.transfer_mode == SHAD_TRANS_DMA) {
+			struct _dma_cfg cfg_dma;
+			struct _dma_transfer_cfg cfg[2];
+			struct _callback _cb;
+
+			memset(&cfg_dma, 0, sizeof(cfg_dma));
+			cfg_dma.incr_saddr = true;
+			cfg_dma.incr_daddr = false;
+			cfg_dma.data_width = DMA_DATA_WIDTH_WORD;
+			cfg_dma.chunk_size = _shad_get_dma_chunk_size(ctx->algo);
+			for (i = 0; i < sg_count; i++)
+				_shad_prepare_dma_sg(&cfg[i], sg_data[i], sg_len[i]);
+
+			callback_set(&_cb, _shad_ctx_dma_callback, (void*)desc);
+			dma_set_callback(desc->dma_channel, &_cb);
+			dma_configure_transfer(desc->dma_channel, &cfg_dma, cfg, sg_count);
+			dma_start_transfer(desc->dma_channel);
+			return;
+		}
+
+		for (i = 0; i < sg_count; i++)
+			_shad_process_blocks_polling(sg_data[i], sg_len[i],
+			                             _shad_get_block_size(ctx->algo), false);
+		_shad_ctx_slice_done(desc, ctx);
+	}
+}
+
+static int _shad_ctx_submit(struct _shad_desc* desc, struct _shad_ctx* ctx)
+{
+	arch_irq_disable();
+	if (!desc->sched.current && mutex_is_locked(&desc->mutex)) {
+		arch_irq_enable();
+		trace_error("SHAD mutex already locked!\r\n");
+		return -EAGAIN;
+	}
+	ctx->busy = true;
+	_shad_sched_enqueue(desc, ctx);
+	arch_irq_enable();
+
+	_shad_sched_run(desc);
+	return 0;
+}
+
 /*----------------------------------------------------------------------------
  *        Public functions
  *----------------------------------------------------------------------------*/
@@ -388,6 +736,8 @@ void shad_init(struct _shad_desc* desc)
 	/* Allocate one DMA channel for writing message blocks to SHA_IDATARx */
 	desc->dma_channel = dma_allocate_channel(DMA_PERIPH_MEMORY, ID_SHA);
 	assert(desc->dma_channel);
+
+	memset(&desc->sched, 0, sizeof(desc->sched));
 }
 
 int shad_get_digest_size(enum _shad_algo algo)
@@ -410,47 +760,23 @@ int shad_get_digest_size(enum _shad_algo algo)
 
 int shad_start(struct _shad_desc* desc)
 {
-	uint32_t algo, mode;
+	uint32_t mode;
+	int err;
 
-	switch (desc->cfg.algo) {
-	case ALGO_SHA_1:
-		algo = SHA_MR_ALGO_SHA1;
-		break;
-	case ALGO_SHA_224:
-		algo = SHA_MR_ALGO_SHA224;
-		break;
-	case ALGO_SHA_256:
-		algo = SHA_MR_ALGO_SHA256;
-		break;
-#ifdef SHA_MR_ALGO_SHA384
-	case ALGO_SHA_384:
-		algo = SHA_MR_ALGO_SHA384;
-		break;
-#endif
-#ifdef SHA_MR_ALGO_SHA512
-	case ALGO_SHA_512:
-		algo = SHA_MR_ALGO_SHA512;
-		break;
-#endif
-	default:
-		return -EINVAL;
-	}
+	if (_shad_ctx_holds_peripheral(desc))
+		return -ENOTSUP;
 
-	switch (desc->cfg.transfer_mode) {
-	case SHAD_TRANS_POLLING:
-		mode = SHA_MR_SMOD_AUTO_START;
-		break;
-	case SHAD_TRANS_DMA:
-		mode = SHA_MR_SMOD_IDATAR0_START;
-		break;
-	default:
-		return -EINVAL;
-	}
+	err = _shad_get_mode(desc, desc->cfg.algo, &mode);
+	if (err < 0)
+		return err;
 
 	sha_soft_reset();
-	sha_configure(algo | mode | SHA_MR_PROCDLY_LONGEST);
+	sha_configure(mode);
 	memset(&desc->xfer, 0, sizeof(desc->xfer));
 
+	/* The intermediate hash value of the last scheduled context is lost */
+	desc->sched.owner = NULL;
+
 	return 0;
 }
 
@@ -713,8 +1039,11 @@ int shad_compute_hash(struct _shad_desc* desc,
 					  struct _callback* cb)
 {
 	bool autopading;
+	int err;
 
-	shad_start(desc);
+	err = shad_start(desc);
+	if (err < 0)
+		return err;
 #ifdef CONFIG_HAVE_SHA_HMAC
 	autopading = true;
 #else
@@ -731,6 +1060,7 @@ int shad_hmac_set_key(struct _shad_desc* desc,
 					  struct _buffer* key)
 {
 	const uint32_t B = _shad_get_block_size(desc->cfg.algo);
+	int err;
 
 	/* FIPS Publication 198 :
 	To compute a MAC over the data ‘text’ using the HMAC function, the following operation is performed:
@@ -740,7 +1070,9 @@ int shad_hmac_set_key(struct _shad_desc* desc,
 		If the length of K = B: set K0 = K.
 		If the length of K > B: hash K to obtain an L byte string, then append (B-L) zeros to create a B-byte string K0.
 		If the length of K < B: append zeros to the end of K to create a B-byte string K0. */
-	shad_start(desc);
+	err = shad_start(desc);
+	if (err < 0)
+		return err;
 	hmac_determine_k0(desc, key);
 	hmac_init_pad(B);
 #ifdef CONFIG_HAVE_SHA_HMAC
@@ -756,10 +1088,146 @@ int shad_compute_hmac(struct _shad_desc* desc,
 					  struct _buffer* digest,
 					  struct _callback* cb)
 {
-	shad_start(desc);
+	int err;
+
+	err = shad_start(desc);
+	if (err < 0)
+		return err;
 #ifdef CONFIG_HAVE_SHA_HMAC
 	return hmac_computer_with_intermediate(desc, text, digest);
 #else
 	return hmac_computer_without_intermediate(desc, text, digest);
 #endif
-}
\ No newline at end of file
+}
+
+int shad_ctx_init(struct _shad_ctx* ctx, enum _shad_algo algo)
+{
+	if (shad_get_digest_size(algo) < 0)
+		return -EINVAL;
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->algo = algo;
+	ctx->reload = true;
+	return 0;
+}
+
+int shad_ctx_hmac_init(struct _shad_desc* desc, struct _shad_ctx* ctx,
+		       enum _shad_algo algo, struct _buffer* key)
+{
+#ifdef CONFIG_HAVE_SHA_HMAC
+	const uint32_t B = _shad_get_block_size(algo);
+	uint8_t* k0 = ctx->block;
+	struct _buffer buf;
+	uint32_t i;
+	int err;
+
+	err = shad_ctx_init(ctx, algo);
+	if (err < 0)
+		return err;
+
+	/* FIPS Publication 198, steps 1-3: determine K0 */
+	if (key->size > B) {
+		buf.data = k0;
+		buf.size = shad_get_digest_size(algo);
+		err = shad_ctx_update(desc, ctx, key, NULL);
+		if (err < 0)
+			return err;
+		shad_ctx_wait_completion(desc, ctx);
+		err = shad_ctx_finish(desc, ctx, &buf, NULL);
+		if (err < 0)
+			return err;
+		shad_ctx_wait_completion(desc, ctx);
+		memset(&k0[buf.size], 0, B - buf.size);
+	} else {
+		memcpy(k0, key->data, key->size);
+		memset(&k0[key->size], 0, B - key->size);
+	}
+
+	/* Hash K0 xor opad, then K0 xor ipad, keep intermediate hash values */
+	for (i = 0; i < B; i++)
+		k0[i] ^= 0x5c;
+	buf.data = k0;
+	buf.size = B;
+	err = shad_ctx_update(desc, ctx, &buf, NULL);
+	if (err < 0)
+		return err;
+	shad_ctx_wait_completion(desc, ctx);
+	memcpy(ctx->opad_state, ctx->state, sizeof(ctx->state));
+
+	shad_ctx_reset(ctx);
+	for (i = 0; i < B; i++)
+		k0[i] ^= 0x5c ^ 0x36;
+	err = shad_ctx_update(desc, ctx, &buf, NULL);
+	if (err < 0)
+		return err;
+	shad_ctx_wait_completion(desc, ctx);
+	memcpy(ctx->ipad_state, ctx->state, sizeof(ctx->state));
+
+	ctx->hmac = true;
+	return shad_ctx_reset(ctx);
+#else
+	return -ENOTSUP;
+#endif
+}
+
+int shad_ctx_reset(struct _shad_ctx* ctx)
+{
+	if (ctx->busy)
+		return -EBUSY;
+
+	_shad_ctx_restart(ctx);
+	return 0;
+}
+
+int shad_ctx_update(struct _shad_desc* desc, struct _shad_ctx* ctx,
+		    struct _buffer* buffer, struct _callback* cb)
+{
+	if (ctx->busy)
+		return -EBUSY;
+
+	if (desc->cfg.transfer_mode == SHAD_TRANS_DMA) {
+		/* Check that remaining data size and buffer address are
+		 * aligned correctly */
+		assert((ctx->remaining & 3) == 0);
+		assert((((uint32_t)buffer->data) & 3) == 0);
+	}
+
+	callback_copy(&ctx->req.callback, cb);
+	ctx->req.data = buffer->data;
+	ctx->req.size = buffer->size;
+	ctx->req.digest = NULL;
+	ctx->req.outer = false;
+
+	return _shad_ctx_submit(desc, ctx);
+}
+
+int shad_ctx_finish(struct _shad_desc* desc, struct _shad_ctx* ctx,
+		    struct _buffer* digest, struct _callback* cb)
+{
+	if (ctx->busy)
+		return -EBUSY;
+
+	if (digest->size != shad_get_digest_size(ctx->algo))
+		return -EINVAL;
+
+	callback_copy(&ctx->req.callback, cb);
+	ctx->req.data = NULL;
+	ctx->req.size = 0;
+	ctx->req.digest = digest;
+	ctx->req.outer = false;
+
+	return _shad_ctx_submit(desc, ctx);
+}
+
+bool shad_ctx_is_busy(struct _shad_ctx* ctx)
+{
+	return ctx->busy;
+}
+
+void shad_ctx_wait_completion(struct _shad_desc* desc, struct _shad_ctx* ctx)
+{
+	while (shad_ctx_is_busy(ctx)) {
+		if (desc->cfg.transfer_mode == SHAD_TRANS_DMA)
+			dma_poll();
+	}
+}
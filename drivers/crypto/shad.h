@@ -38,11 +38,28 @@
 #include <stdint.h>
 
 #include "callback.h"
+#include "compiler.h"
 #include "crypto/sha.h"
 #include "dma/dma.h"
 #include "io.h"
 #include "mutex.h"
 
+/*------------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+/** Largest block size of the supported algorithms (SHA-384/SHA-512) */
+#define SHAD_MAX_BLOCK_SIZE 128
+
+/** Largest intermediate hash value of the supported algorithms */
+#define SHAD_MAX_STATE_SIZE 64
+
+#ifndef SHAD_CTX_SLICE_SIZE
+/** Maximum number of bytes hashed for a context before the peripheral is
+ * handed over to the next queued context */
+#define SHAD_CTX_SLICE_SIZE 4096
+#endif
+
 /*------------------------------------------------------------------------------
  *        Types
  *----------------------------------------------------------------------------*/
@@ -61,6 +78,8 @@ enum _shad_transfer_mode
 	SHAD_TRANS_DMA
 };
 
+struct _shad_ctx;
+
 struct _shad_desc {
 	/* structure to define SHA configuration */
 	struct {
@@ -81,6 +100,45 @@ struct _shad_desc {
 		uint32_t processed; /* cumulated data processed, value is included in padding data */
 		struct _buffer* buffer;
 	} xfer;
+
+	/* hash contexts scheduler */
+	struct {
+		struct _shad_ctx* head;    /* first queued context */
+		struct _shad_ctx* tail;    /* last queued context */
+		struct _shad_ctx* current; /* context being processed */
+		struct _shad_ctx* owner;   /* context loaded in the peripheral */
+	} sched;
+};
+
+/* Hash context: one independent message stream. Several contexts can be
+ * updated concurrently on the same SHA descriptor, they are time-sliced on
+ * the peripheral by saving/restoring their intermediate hash value. */
+struct _shad_ctx {
+	enum _shad_algo algo;
+
+	/* --- following fields are used internally --- */
+
+	struct _shad_ctx* next; /* next context in the scheduler queue */
+	volatile bool busy;     /* a request is pending for this context */
+	bool hmac;              /* HMAC context (ipad/opad states are valid) */
+	bool reload;            /* state must be (re)loaded in the peripheral */
+
+	uint32_t remaining; /* bytes stored in block, waiting for a full block */
+	uint32_t processed; /* bytes already hashed */
+
+	ALIGNED(4) uint8_t block[2 * SHAD_MAX_BLOCK_SIZE]; /* partial block */
+	ALIGNED(4) uint8_t state[SHAD_MAX_STATE_SIZE];     /* intermediate hash */
+	ALIGNED(4) uint8_t ipad_state[SHAD_MAX_STATE_SIZE]; /* H(K0 xor ipad) */
+	ALIGNED(4) uint8_t opad_state[SHAD_MAX_STATE_SIZE]; /* H(K0 xor opad) */
+
+	/* data about current request */
+	struct {
+		struct _callback callback;
+		const uint8_t* data;    /* data not yet hashed */
+		uint32_t size;
+		struct _buffer* digest; /* set for finish requests */
+		bool outer;             /* HMAC outer hash in progress */
+	} req;
 };
 
 /*------------------------------------------------------------------------------
@@ -103,7 +161,9 @@ extern int shad_get_digest_size(enum _shad_algo algo);
 /**
  * \brief Start a new SHA computation.
  * \param desc a SHA driver descriptor
- * \return 0 on success, <0 on error
+ * \return 0 on success, <0 on error. -ENOTSUP on devices without user
+ * initial hash values (no CONFIG_HAVE_SHA_HMAC) while a started context
+ * holds the peripheral, until its digest is read.
  */
 extern int shad_start(struct _shad_desc* desc);
 
@@ -163,6 +223,7 @@ extern int shad_compute_hash(struct _shad_desc* desc,
  * \brief the HMAC KEY computation.
  * \param desc a SHA driver descriptor
  * \param key key to process
+ * \return 0 on success, <0 on error (see shad_start)
  */
 extern int shad_hmac_set_key(struct _shad_desc* desc,
 					  struct _buffer* key);
@@ -182,4 +243,75 @@ extern int shad_compute_hmac(struct _shad_desc* desc,
 					  struct _buffer* text,
 					  struct _buffer* digest,
 					  struct _callback* cb);
+
+/**
+ * \brief Initialize a hash context.
+ * \param ctx hash context to initialize
+ * \param algo SHA algorithm: ALGO_SHA_1..ALGO_SHA_512
+ * \return 0 on success, <0 on error
+ */
+extern int shad_ctx_init(struct _shad_ctx* ctx, enum _shad_algo algo);
+
+/**
+ * \brief Initialize a HMAC context. The key is processed once: K0 xor ipad
+ * and K0 xor opad are hashed and the resulting intermediate hash values are
+ * kept in the context, so each message only hashes its own data.
+ * \param desc a SHA driver descriptor
+ * \param ctx hash context to initialize
+ * \param algo SHA algorithm: ALGO_SHA_1..ALGO_SHA_512
+ * \param key HMAC key
+ * \return 0 on success, <0 on error
+ * \note This function waits for the key pre-computation to be done.
+ */
+extern int shad_ctx_hmac_init(struct _shad_desc* desc, struct _shad_ctx* ctx,
+			      enum _shad_algo algo, struct _buffer* key);
+
+/**
+ * \brief Restart a new message on a hash or HMAC context.
+ * The HMAC key pre-computation is kept.
+ * \param ctx hash context
+ * \return 0 on success, -EBUSY if a request is pending on the context
+ */
+extern int shad_ctx_reset(struct _shad_ctx* ctx);
+
+/**
+ * \brief Queue some data to be hashed on a context.
+ * \param desc a SHA driver descriptor
+ * \param ctx hash context
+ * \param buffer data buffer to process, must stay valid until the callback
+ * \param cb callback called when the data processing is done
+ * \return 0 on success, <0 on error
+ * \note When using DMA, the buffer data pointer must be word aligned.
+ * Additionally, the buffer size must be a multiple of 4 bytes except for the
+ * last call to shad_ctx_update.
+ */
+extern int shad_ctx_update(struct _shad_desc* desc, struct _shad_ctx* ctx,
+			   struct _buffer* buffer, struct _callback* cb);
+
+/**
+ * \brief Queue the final padding of a context and get resulting digest
+ * (or HMAC for HMAC contexts).
+ * \param desc a SHA driver descriptor
+ * \param ctx hash context
+ * \param digest data buffer to store the resulting digest
+ * \param cb callback called when the digest is available
+ * \return 0 on success, <0 on error
+ */
+extern int shad_ctx_finish(struct _shad_desc* desc, struct _shad_ctx* ctx,
+			   struct _buffer* digest, struct _callback* cb);
+
+/**
+ * \brief Checks if a request is pending on a hash context.
+ * \param ctx hash context
+ * \return true if the context is busy.
+ */
+extern bool shad_ctx_is_busy(struct _shad_ctx* ctx);
+
+/**
+ * \brief Wait for the pending request of a hash context to be done.
+ * \param desc a SHA driver descriptor
+ * \param ctx hash context
+ */
+extern void shad_ctx_wait_completion(struct _shad_desc* desc, struct _shad_ctx* ctx);
+
 #endif /* SHAD_H */
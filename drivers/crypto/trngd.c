@@ -0,0 +1,291 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "callback.h"
+#include "crypto/trng.h"
+#include "crypto/trngd.h"
+#include "errno.h"
+#include "irqflags.h"
+#include "ring.h"
+
+/*----------------------------------------------------------------------------
+ *        Local variables
+ *----------------------------------------------------------------------------*/
+
+static struct {
+	/* entropy pool */
+	uint8_t pool[TRNGD_POOL_SIZE];
+	volatile uint32_t head;
+	volatile uint32_t tail;
+
+	/* health tests */
+	volatile bool failed;
+	uint32_t startup;
+	uint8_t rct_sample;
+	uint32_t rct_count;
+	uint8_t apt_sample;
+	uint32_t apt_count;
+	uint32_t apt_index;
+	struct _trngd_stats stats;
+
+	/* pending asynchronous read */
+	struct {
+		uint8_t* data;
+		uint32_t len;
+		uint32_t done;
+		struct _callback callback;
+	} req;
+	volatile bool busy;
+
+	bool it_enabled;
+} _trngd;
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static void _trngd_handler(uint32_t random_value, void* user_arg);
+
+static void _trngd_restart_tests(void)
+{
+	_trngd.startup = TRNGD_STARTUP_SAMPLES;
+	_trngd.rct_count = 0;
+	_trngd.apt_index = 0;
+}
+
+/* Run the continuous health tests on one 8-bit sample, returns false on
+ * failure */
+static bool _trngd_health_test(uint8_t sample)
+{
+	_trngd.stats.samples++;
+
+	/* Repetition Count Test */
+	if (_trngd.rct_count && sample == _trngd.rct_sample) {
+		if (++_trngd.rct_count >= TRNGD_RCT_CUTOFF) {
+			_trngd.stats.rct_failures++;
+			return false;
+		}
+	} else {
+		_trngd.rct_sample = sample;
+		_trngd.rct_count = 1;
+	}
+
+	/* Adaptive Proportion Test */
+	if (_trngd.apt_index == 0) {
+		_trngd.apt_sample = sample;
+		_trngd.apt_count = 1;
+	} else if (sample == _trngd.apt_sample) {
+		if (++_trngd.apt_count >= TRNGD_APT_CUTOFF) {
+			_trngd.stats.apt_failures++;
+			return false;
+		}
+	}
+	if (++_trngd.apt_index >= TRNGD_APT_WINDOW)
+		_trngd.apt_index = 0;
+
+	return true;
+}
+
+static uint32_t _trngd_pool_read(uint8_t* data, uint32_t len)
+{
+	uint32_t count = 0;
+
+	while (count < len && !RING_EMPTY(_trngd.head, _trngd.tail)) {
+		data[count++] = _trngd.pool[_trngd.tail];
+		RING_INC(_trngd.tail, TRNGD_POOL_SIZE);
+	}
+	return count;
+}
+
+static void _trngd_update_it(void)
+{
+	bool needed = !_trngd.failed &&
+		(_trngd.busy || RING_SPACE(_trngd.head, _trngd.tail, TRNGD_POOL_SIZE) >= 4);
+
+	/* Only keep the TRNG interrupt enabled when samples are needed */
+	if (needed && !_trngd.it_enabled) {
+		_trngd.it_enabled = true;
+		trng_enable_it(_trngd_handler, NULL);
+	} else if (!needed && _trngd.it_enabled) {
+		_trngd.it_enabled = false;
+		trng_disable_it();
+	}
+}
+
+static void _trngd_complete(int status)
+{
+	_trngd.busy = false;
+	callback_call(&_trngd.req.callback, (void*)status);
+}
+
+static void _trngd_handler(uint32_t random_value, void* user_arg)
+{
+	uint8_t sample;
+	int i;
+
+	if (_trngd.failed)
+		return;
+
+	for (i = 0; i < 4; i++, random_value >>= 8) {
+		sample = random_value & 0xff;
+
+		if (!_trngd_health_test(sample)) {
+			_trngd.failed = true;
+			_trngd.stats.discarded++;
+			RING_CLEAR(_trngd.head, _trngd.tail);
+			if (_trngd.busy)
+				_trngd_complete(-EIO);
+			break;
+		}
+
+		if (_trngd.startup) {
+			_trngd.startup--;
+			_trngd.stats.discarded++;
+			continue;
+		}
+
+		if (_trngd.busy) {
+			_trngd.req.data[_trngd.req.done++] = sample;
+			if (_trngd.req.done == _trngd.req.len)
+				_trngd_complete(0);
+		} else if (RING_SPACE(_trngd.head, _trngd.tail, TRNGD_POOL_SIZE)) {
+			_trngd.pool[_trngd.head] = sample;
+			RING_INC(_trngd.head, TRNGD_POOL_SIZE);
+		} else {
+			_trngd.stats.discarded++;
+		}
+	}
+
+	_trngd_update_it();
+}
+
+/*----------------------------------------------------------------------------
+ *        Public functions
+ *----------------------------------------------------------------------------*/
+
+void trngd_init(void)
+{
+	memset(&_trngd, 0, sizeof(_trngd));
+	_trngd_restart_tests();
+
+	trng_enable();
+	_trngd_update_it();
+}
+
+void trngd_deinit(void)
+{
+	trng_disable_it();
+	trng_disable();
+	_trngd.it_enabled = false;
+}
+
+bool trngd_is_healthy(void)
+{
+	return !_trngd.failed;
+}
+
+void trngd_reset_health(void)
+{
+	arch_irq_disable();
+	RING_CLEAR(_trngd.head, _trngd.tail);
+	_trngd_restart_tests();
+	_trngd.failed = false;
+	_trngd_update_it();
+	arch_irq_enable();
+}
+
+uint32_t trngd_get_available(void)
+{
+	return RING_CNT(_trngd.head, _trngd.tail, TRNGD_POOL_SIZE);
+}
+
+int trngd_read(uint8_t* data, uint32_t len)
+{
+	uint32_t count;
+
+	if (_trngd.failed)
+		return -EIO;
+
+	arch_irq_disable();
+	count = _trngd_pool_read(data, len);
+	_trngd_update_it();
+	arch_irq_enable();
+
+	return count;
+}
+
+int trngd_read_async(uint8_t* data, uint32_t len, struct _callback* cb)
+{
+	if (_trngd.failed)
+		return -EIO;
+
+	arch_irq_disable();
+	if (_trngd.busy) {
+		arch_irq_enable();
+		return -EBUSY;
+	}
+
+	callback_copy(&_trngd.req.callback, cb);
+	_trngd.req.data = data;
+	_trngd.req.len = len;
+
+	/* Serve the request from the pool first */
+	_trngd.req.done = _trngd_pool_read(data, len);
+	if (_trngd.req.done == len) {
+		arch_irq_enable();
+		callback_call(&_trngd.req.callback, (void*)0);
+		return 0;
+	}
+
+	_trngd.busy = true;
+	_trngd_update_it();
+	arch_irq_enable();
+
+	return 0;
+}
+
+bool trngd_is_busy(void)
+{
+	return _trngd.busy;
+}
+
+void trngd_get_stats(struct _trngd_stats* stats)
+{
+	arch_irq_disable();
+	memcpy(stats, &_trngd.stats, sizeof(*stats));
+	arch_irq_enable();
+}
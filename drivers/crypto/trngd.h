@@ -0,0 +1,153 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef _TRNGD_H_
+#define _TRNGD_H_
+
+#ifdef CONFIG_HAVE_TRNG
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "callback.h"
+
+/*------------------------------------------------------------------------------
+ *         Definitions
+ *------------------------------------------------------------------------------*/
+
+#ifndef TRNGD_POOL_SIZE
+/** Size of the entropy pool, in bytes */
+#define TRNGD_POOL_SIZE 256
+#endif
+
+/* Health tests parameters (NIST SP800-90B section 4.4), computed for an
+ * assessed min-entropy of 6 bits per 8-bit sample and a false positive
+ * probability of 2^-40 */
+
+#ifndef TRNGD_RCT_CUTOFF
+/** Repetition Count Test cutoff: 1 + ceil(40 / 6) */
+#define TRNGD_RCT_CUTOFF 8
+#endif
+
+#ifndef TRNGD_APT_WINDOW
+/** Adaptive Proportion Test window size (non-binary samples) */
+#define TRNGD_APT_WINDOW 512
+#endif
+
+#ifndef TRNGD_APT_CUTOFF
+/** Adaptive Proportion Test cutoff */
+#define TRNGD_APT_CUTOFF 36
+#endif
+
+/** Number of samples discarded and tested at start-up (SP800-90B 4.3) */
+#define TRNGD_STARTUP_SAMPLES 1024
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+struct _trngd_stats {
+	uint32_t samples;      /* 8-bit samples tested */
+	uint32_t discarded;    /* 8-bit samples discarded (start-up, failures) */
+	uint32_t rct_failures; /* Repetition Count Test failures */
+	uint32_t apt_failures; /* Adaptive Proportion Test failures */
+};
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Enable the TRNG and start filling the entropy pool from the TRNG
+ * interrupt. Samples are checked by the continuous health tests before being
+ * added to the pool.
+ */
+extern void trngd_init(void);
+
+/**
+ * \brief Stop filling the entropy pool and disable the TRNG.
+ */
+extern void trngd_deinit(void);
+
+/**
+ * \brief Check the state of the noise source health tests.
+ * \return true if no health test failure was detected.
+ */
+extern bool trngd_is_healthy(void);
+
+/**
+ * \brief Clear a health test failure: the pool is flushed and the start-up
+ * tests are run again.
+ */
+extern void trngd_reset_health(void);
+
+/**
+ * \brief Get the number of entropy bytes available in the pool.
+ */
+extern uint32_t trngd_get_available(void);
+
+/**
+ * \brief Read entropy from the pool without waiting.
+ * \param data buffer to fill
+ * \param len number of bytes requested
+ * \return number of bytes read (can be less than requested), -EIO if the
+ * health tests failed.
+ */
+extern int trngd_read(uint8_t* data, uint32_t len);
+
+/**
+ * \brief Read entropy asynchronously: the buffer is filled from the TRNG
+ * interrupt as samples become available, and the callback is called once it
+ * is full (arg2 is 0) or when a health test fails (arg2 is -EIO).
+ * \param data buffer to fill, must stay valid until the callback
+ * \param len number of bytes requested
+ * \param cb callback
+ * \return 0 on success, -EBUSY if an asynchronous read is already pending,
+ * -EIO if the health tests failed.
+ */
+extern int trngd_read_async(uint8_t* data, uint32_t len, struct _callback* cb);
+
+/**
+ * \brief Check if an asynchronous read is pending.
+ */
+extern bool trngd_is_busy(void);
+
+/**
+ * \brief Get health tests statistics.
+ * \param stats structure to fill
+ */
+extern void trngd_get_stats(struct _trngd_stats* stats);
+
+#endif /* CONFIG_HAVE_TRNG */
+
+#endif /* _TRNGD_H_ */
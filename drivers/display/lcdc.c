@@ -38,11 +38,15 @@
 #include <stdio.h>
 
 #include "chip.h"
+#include "callback.h"
 #include "compiler.h"
 #include "display/lcdc.h"
+#include "errno.h"
 #include "gpio/pio.h"
+#include "irq/irq.h"
 #include "mm/cache.h"
 #include "peripherals/pmc.h"
+#include "timer.h"
 #include "trace.h"
 
 /** \addtogroup lcdc_base
@@ -52,6 +56,13 @@
 
 /**@{*/
 
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+/** Longest wait for a descriptor load, in ms (a frame at a low refresh rate) */
+#define LCDC_VSYNC_TIMEOUT 100
+
 /*----------------------------------------------------------------------------
  *        Local types
  *----------------------------------------------------------------------------*/
@@ -71,6 +82,7 @@ struct _layer_info {
 	volatile uint32_t  *reg_color;      /**< regs: RGB Default, RGB Key, RGB Mask */
 	volatile uint32_t  *reg_scale;      /**< regs: scale */
 	volatile uint32_t  *reg_clut;       /**< regs: CLUT */
+	uint32_t            irq_mask;       /**< layer bit in LCDC_LCDIER */
 };
 
 /** DMA descriptor for LCDC */
@@ -81,6 +93,18 @@ struct _lcdc_dma_desc {
 	uint32_t for_alignment_only;
 };
 
+/** Frame queue of a layer. frames[first] is on screen and the next ones wait
+ * in order, the oldest waiting frame is queued on the DMA when pending. */
+struct _frame_queue {
+	struct _lcdc_dma_desc *desc;        /**< one descriptor per frame slot */
+	void                  *frames[LCDC_FRAME_QUEUE_SIZE];
+	volatile uint8_t       first;
+	volatile uint8_t       count;
+	volatile bool          pending;
+	bool                   active;
+	struct _callback       release;
+};
+
 /** Variable layer data */
 struct _layer_data {
 	struct _lcdc_dma_desc *dma_desc;
@@ -88,6 +112,7 @@ struct _layer_data {
 	struct _lcdc_dma_desc *dma_v_desc;
 	void                  *buffer;
 	uint8_t                bpp;
+	struct _frame_queue   *queue;
 };
 
 /*----------------------------------------------------------------------------
@@ -103,11 +128,21 @@ static struct _lcdc_dma_desc base_dma_desc;  /**< DMA desc. for Base Layer */
 
 static struct _layer_data lcdc_base;         /**< Base Layer */
 
+CACHE_ALIGNED_DDR
+static struct _lcdc_dma_desc base_queue_desc[LCDC_FRAME_QUEUE_SIZE];
+
+static struct _frame_queue base_queue;       /**< Base Layer frame queue */
+
 #ifdef CONFIG_HAVE_LCDC_OVR1
 CACHE_ALIGNED_DDR
 static struct _lcdc_dma_desc ovr1_dma_desc;  /**< DMA desc. for OVR1 Layer */
 
 static struct _layer_data lcdc_ovr1;         /**< OVR1 Layer */
+
+CACHE_ALIGNED_DDR
+static struct _lcdc_dma_desc ovr1_queue_desc[LCDC_FRAME_QUEUE_SIZE];
+
+static struct _frame_queue ovr1_queue;       /**< OVR1 Layer frame queue */
 #endif
 
 #ifdef CONFIG_HAVE_LCDC_OVR2
@@ -128,6 +163,11 @@ static struct _lcdc_dma_desc heo_dma_v_desc; /**< DMA desc. for HEO V Layer */
 
 static struct _layer_data lcdc_heo;          /**< HEO Layer */
 
+CACHE_ALIGNED_DDR
+static struct _lcdc_dma_desc heo_queue_desc[LCDC_FRAME_QUEUE_SIZE];
+
+static struct _frame_queue heo_queue;        /**< HEO Layer frame queue */
+
 #ifdef CONFIG_HAVE_LCDC_PP
 CACHE_ALIGNED_DDR
 static struct _lcdc_dma_desc pp_dma_desc;    /**< DMA desc. for PP Layer */
@@ -156,7 +196,8 @@ static const struct _layer_info lcdc_layers[] = {
 		.reg_cfg = &LCDC->LCDC_BASECFG0,
 		.reg_stride = &LCDC->LCDC_BASECFG2,
 		.reg_color = &LCDC->LCDC_BASECFG3,
-		.reg_clut = &LCDC->LCDC_BASECLUT[0]
+		.reg_clut = &LCDC->LCDC_BASECLUT[0],
+		.irq_mask = LCDC_LCDIER_BASEIE,
 	},
 #ifdef CONFIG_HAVE_LCDC_OVR1
 	/* 2: LCDC_OVR1 */
@@ -171,6 +212,7 @@ static const struct _layer_info lcdc_layers[] = {
 		.reg_stride = &LCDC->LCDC_OVR1CFG4,
 		.reg_color = &LCDC->LCDC_OVR1CFG6,
 		.reg_clut = &LCDC->LCDC_OVR1CLUT[0],
+		.irq_mask = LCDC_LCDIER_OVR1IE,
 	},
 #else
 	/* 2: N/A */
@@ -193,6 +235,7 @@ static const struct _layer_info lcdc_layers[] = {
 		.reg_color = &LCDC->LCDC_HEOCFG9,
 		.reg_scale = &LCDC->LCDC_HEOCFG13,
 		.reg_clut = &LCDC->LCDC_HEOCLUT[0],
+		.irq_mask = LCDC_LCDIER_HEOIE,
 	},
 #ifdef CONFIG_HAVE_LCDC_OVR2
 	/* 4: LCDC_OVR2 */
@@ -207,6 +250,7 @@ static const struct _layer_info lcdc_layers[] = {
 		.reg_stride = &LCDC->LCDC_OVR2CFG4,
 		.reg_color = &LCDC->LCDC_OVR2CFG6,
 		.reg_clut = &LCDC->LCDC_OVR2CLUT[0],
+		.irq_mask = LCDC_LCDIER_OVR2IE,
 	},
 #else
 	/* 4: N/A */
@@ -314,12 +358,12 @@ static void _set_dma_desc(void *buffer, struct _lcdc_dma_desc *desc,
 {
 	/* Modify descriptor */
 	desc->addr = (uint32_t)buffer;
-	desc->ctrl = LCDC_BASECTRL_DFETCH;
+	desc->ctrl = LCDC_BASECTRL_DFETCH | LCDC_BASECTRL_DSCRIEN;
 	desc->next = (uint32_t)desc;
 	cache_clean_region(desc, sizeof(struct _lcdc_dma_desc));
 	/* Modify registers */
 	dma_head_reg[1] = (uint32_t)buffer;
-	dma_head_reg[2] = LCDC_BASECTRL_DFETCH;
+	dma_head_reg[2] = LCDC_BASECTRL_DFETCH | LCDC_BASECTRL_DSCRIEN;
 	dma_head_reg[3] = (uint32_t)desc;
 }
 
@@ -341,6 +385,69 @@ static void _clear_dma_desc(struct _lcdc_dma_desc *desc,
 	dma_head_reg[3] = (uint32_t)desc;
 }
 
+/**
+ * Queue the oldest waiting frame of a layer, the DMA loads it at next start
+ * of frame and raises the head descriptor loaded interrupt.
+ */
+static void _frame_queue_commit(const struct _layer_info *layer)
+{
+	struct _frame_queue *queue = layer->data->queue;
+	uint8_t slot = (queue->first + 1) % LCDC_FRAME_QUEUE_SIZE;
+	struct _lcdc_dma_desc *desc = &queue->desc[slot];
+
+	/* the descriptor of a slot is not in use by the DMA until its frame is
+	 * queued again, it can be rewritten */
+	desc->addr = (uint32_t)queue->frames[slot];
+	desc->ctrl = LCDC_BASECTRL_DFETCH | LCDC_BASECTRL_ADDIEN;
+	desc->next = (uint32_t)desc;
+	cache_clean_region(desc, sizeof(*desc));
+
+	queue->pending = true;
+	layer->reg_dma_head[0] = (uint32_t)desc;
+	layer->reg_enable[0] = LCDC_BASECHER_A2QEN;
+}
+
+/**
+ * The queued frame is on screen, release the previous one and queue the
+ * next waiting frame.
+ */
+static void _frame_queue_loaded(const struct _layer_info *layer)
+{
+	struct _frame_queue *queue = layer->data->queue;
+	void *released;
+
+	if (!queue->pending)
+		return;
+
+	released = queue->frames[queue->first];
+	queue->first = (queue->first + 1) % LCDC_FRAME_QUEUE_SIZE;
+	queue->count--;
+	queue->pending = false;
+	layer->data->buffer = queue->frames[queue->first];
+
+	if (queue->count > 1)
+		_frame_queue_commit(layer);
+
+	callback_call(&queue->release, released);
+}
+
+static void _lcdc_handler(uint32_t source, void* user_arg)
+{
+	uint8_t i;
+
+	for (i = LCDC_BASE; i < ARRAY_SIZE(lcdc_layers); i++) {
+		const struct _layer_info *layer = &lcdc_layers[i];
+
+		if (!layer->data || !layer->data->queue ||
+		    !layer->data->queue->active)
+			continue;
+
+		/* reading the layer ISR clears it */
+		if (layer->reg_enable[6] & LCDC_BASEISR_ADD)
+			_frame_queue_loaded(layer);
+	}
+}
+
 /**
  * Compute scaling factors
  */
@@ -448,10 +555,16 @@ void lcdc_configure(const struct _lcdc_desc *desc)
 	lcdc_base.bpp = 0;
 	lcdc_base.buffer = NULL;
 	lcdc_base.dma_desc = &base_dma_desc;
+	lcdc_base.queue = &base_queue;
+	base_queue.desc = base_queue_desc;
+	base_queue.active = false;
 #ifdef CONFIG_HAVE_LCDC_OVR1
 	lcdc_ovr1.bpp = 0;
 	lcdc_ovr1.buffer = NULL;
 	lcdc_ovr1.dma_desc = &ovr1_dma_desc;
+	lcdc_ovr1.queue = &ovr1_queue;
+	ovr1_queue.desc = ovr1_queue_desc;
+	ovr1_queue.active = false;
 #endif
 #ifdef CONFIG_HAVE_LCDC_OVR2
 	lcdc_ovr2.bpp = 0;
@@ -463,6 +576,9 @@ void lcdc_configure(const struct _lcdc_desc *desc)
 	lcdc_heo.dma_desc = &heo_dma_desc;
 	lcdc_heo.dma_u_desc = &heo_dma_u_desc;
 	lcdc_heo.dma_v_desc = &heo_dma_v_desc;
+	lcdc_heo.queue = &heo_queue;
+	heo_queue.desc = heo_queue_desc;
+	heo_queue.active = false;
 #ifdef CONFIG_HAVE_LCDC_PP
 	/* Reset layer information */
 	lcdc_pp.bpp = 0;
@@ -608,6 +724,57 @@ void lcdc_refresh(uint8_t layer_id)
 	}
 }
 
+/**
+ * Wait for the next descriptor load of a layer DMA channel, which happens at
+ * start of frame. A buffer queued before the call is on screen on return.
+ * When a frame queue is started on the layer, wait until the frames queued
+ * before the call are on screen.
+ * \param layer_id Layer ID.
+ * \return 0 once a descriptor is loaded, -EINVAL if the layer is not running,
+ * -ETIMEDOUT if no descriptor is loaded within LCDC_VSYNC_TIMEOUT ms.
+ */
+int lcdc_wait_vsync(uint8_t layer_id)
+{
+	const struct _layer_info *layer = &lcdc_layers[layer_id];
+	struct _timeout timeout;
+
+	if (!layer->reg_enable || !(layer->reg_enable[2] & LCDC_BASECHSR_CHSR))
+		return -EINVAL;
+
+	timer_start_timeout(&timeout, LCDC_VSYNC_TIMEOUT);
+
+	if (layer->data->queue && layer->data->queue->active) {
+		struct _frame_queue *queue = layer->data->queue;
+		uint8_t count = queue->count;
+
+		/* the flags belong to the interrupt handler, each queued frame
+		 * gets its own frame time */
+		while (count > 1) {
+			if (queue->count < count) {
+				count = queue->count;
+				timer_reset_timeout(&timeout);
+			} else if (timer_timeout_reached(&timeout)) {
+				trace_error("lcdc: layer %u, frame queue stalled\r\n",
+				            layer_id);
+				return -ETIMEDOUT;
+			}
+		}
+		return 0;
+	}
+
+	/* reading ISR clears the descriptor loaded flag of previous frames */
+	(void)layer->reg_enable[6];
+	while (!(layer->reg_enable[6] & LCDC_BASEISR_DSCR)) {
+		if (timer_timeout_reached(&timeout)) {
+			trace_error("lcdc: layer %u, no descriptor loaded\r\n",
+			            layer_id);
+			return -ETIMEDOUT;
+		}
+	}
+
+	return 0;
+}
+
 /**
  * Set display window position.
  * \param layer_id Layer ID.
@@ -855,10 +1022,14 @@ void * lcdc_put_image_rotated(uint8_t layer_id,
 	uint32_t bits_per_row, bytes_per_row;
 	uint32_t bytes_per_pixel = bpp >> 3;
 
-	void *old_buffer = data->buffer;
+	void *old_buffer;
 
 	if (!layer->reg_cfg)
-		return old_buffer;
+		return data ? data->buffer : NULL;
+
+	/* the layer goes back to its own descriptor */
+	lcdc_queue_stop(layer_id);
+	old_buffer = data->buffer;
 
 	//printf("Show %x @ %d: (%d,%d)+(%d,%d) img %d x %d * %d\n\r", buffer, layer_id, x, y, w, h, img_w, img_h, bpp);
 
@@ -1175,7 +1346,7 @@ void * lcdc_put_image_rotated(uint8_t layer_id,
 	/** DMA is running, just add new descriptor to queue */
 	if (layer->reg_blender[0] & LCDC_HEOCFG12_DMA) {
 		data->dma_desc->addr = (uint32_t)buffer;
-		data->dma_desc->ctrl = LCDC_HEOCTRL_DFETCH;
+		data->dma_desc->ctrl = LCDC_HEOCTRL_DFETCH | LCDC_HEOCTRL_DSCRIEN;
 		data->dma_desc->next = (uint32_t)data->dma_desc;
 		cache_clean_region(data->dma_desc, sizeof(*(data->dma_desc)));
 		layer->reg_dma_head[0] = (uint32_t)data->dma_desc;
@@ -1326,6 +1497,8 @@ void lcdc_stop_base(void)
 	if (!(LCDC->LCDC_BASECHSR & LCDC_BASECHSR_CHSR))
 		return;
 
+	lcdc_queue_stop(LCDC_BASE);
+
 	/* 1. Clear the DFETCH bit in the DSCR.CHXCTRL field of the DSCR structure
 	   will disable the channel at the end of the frame. */
 	/* 2. Set the DSCR.CHXNEXT field of the DSCR structure will disable the
@@ -1362,6 +1535,8 @@ void lcdc_stop_ovr1(void)
 	if (!(LCDC->LCDC_OVR1CHSR & LCDC_OVR1CHSR_CHSR))
 		return;
 
+	lcdc_queue_stop(LCDC_OVR1);
+
 	/* 1. Clear the DFETCH bit in the DSCR.CHXCTRL field of the DSCR structure
 	   will disable the channel at the end of the frame. */
 	/* 2. Set the DSCR.CHXNEXT field of the DSCR structure will disable the
@@ -1399,6 +1574,8 @@ void lcdc_stop_heo(void)
 	if (!(LCDC->LCDC_HEOCHSR & LCDC_HEOCHSR_CHSR))
 		return;
 
+	lcdc_queue_stop(LCDC_HEO);
+
 	/* 1. Clear the DFETCH bit in the DSCR.CHXCTRL field of the DSCR structure
 	   will disable the channel at the end of the frame. */
 	/* 2. Set the DSCR.CHXNEXT field of the DSCR structure will disable the
@@ -1419,6 +1596,136 @@ void lcdc_stop_heo(void)
 	while (LCDC->LCDC_HEOCHSR & LCDC_HEOCHSR_CHSR);
 }
 
+/**
+ * Start a frame queue on a layer already displaying a buffer with
+ * lcdc_put_image() or the lcdc_show_xxx() functions. The frames then have
+ * the format and window of this buffer. YUV planar formats are not handled.
+ * \param layer_id Layer ID, LCDC_BASE, LCDC_OVR1 or LCDC_HEO.
+ * \param release Callback called from interrupt context with a frame buffer
+ * as second argument once the LCDC does not read it any more, may be NULL.
+ * \return 0 on success, -ENODEV if the layer has no frame queue, -EINVAL if
+ * the layer is not displaying a buffer, -ETIMEDOUT if a previous queue could
+ * not be stopped.
+ */
+int lcdc_queue_start(uint8_t layer_id, struct _callback *release)
+{
+	const struct _layer_info *layer = &lcdc_layers[layer_id];
+	struct _frame_queue *queue;
+
+	if (!layer->data || !layer->data->queue)
+		return -ENODEV;
+	if (!layer->data->buffer || !(layer->reg_enable[2] & LCDC_BASECHSR_CHSR))
+		return -EINVAL;
+
+	queue = layer->data->queue;
+	if (queue->active) {
+		int err = lcdc_queue_stop(layer_id);
+		if (err < 0)
+			return err;
+	}
+
+	/* keep the slot index, the DMA may still loop on its descriptor */
+	queue->frames[queue->first] = layer->data->buffer;
+	queue->count = 1;
+	queue->pending = false;
+	if (release)
+		callback_copy(&queue->release, release);
+	else
+		callback_set(&queue->release, NULL, NULL);
+
+	/* clear previous flags */
+	(void)layer->reg_enable[6];
+	queue->active = true;
+
+	irq_add_handler(ID_LCDC, _lcdc_handler, NULL);
+	layer->reg_enable[3] = LCDC_BASEIER_ADD;
+	LCDC->LCDC_LCDIER = layer->irq_mask;
+	irq_enable(ID_LCDC);
+
+	return 0;
+}
+
+/**
+ * Stop the frame queue of a layer. A frame already queued on the DMA is
+ * waited for, the frames still waiting are released without being shown.
+ * \param layer_id Layer ID.
+ * \return 0 on success, -ETIMEDOUT if the DMA did not load the queued frame
+ * within LCDC_VSYNC_TIMEOUT ms, the LCDC then keeps that frame.
+ */
+int lcdc_queue_stop(uint8_t layer_id)
+{
+	const struct _layer_info *layer = &lcdc_layers[layer_id];
+	struct _frame_queue *queue;
+	struct _timeout timeout;
+	uint8_t keep;
+
+	if (!layer->data || !layer->data->queue || !layer->data->queue->active)
+		return 0;
+
+	queue = layer->data->queue;
+	layer->reg_enable[4] = LCDC_BASEIDR_ADD;
+	LCDC->LCDC_LCDIDR = layer->irq_mask;
+	queue->active = false;
+
+	keep = queue->pending ? 2 : 1;
+	while (queue->count > keep) {
+		uint8_t slot = (queue->first + queue->count - 1) % LCDC_FRAME_QUEUE_SIZE;
+		queue->count--;
+		callback_call(&queue->release, queue->frames[slot]);
+	}
+
+	if (queue->pending) {
+		timer_start_timeout(&timeout, LCDC_VSYNC_TIMEOUT);
+		while (layer->reg_enable[2] & LCDC_BASECHSR_A2QSR) {
+			if (timer_timeout_reached(&timeout)) {
+				trace_error("lcdc: layer %u, queued frame not loaded\r\n",
+				            layer_id);
+				return -ETIMEDOUT;
+			}
+		}
+		(void)layer->reg_enable[6];
+		_frame_queue_loaded(layer);
+	}
+
+	return 0;
+}
+
+/**
+ * Queue a frame for display on a layer with a started frame queue. Frames
+ * are shown in order, each for at least one frame, the change happens at
+ * start of frame. The buffer must be cleaned from the data cache and stays
+ * owned by the LCDC until released.
+ * \param layer_id Layer ID.
+ * \param buffer Frame buffer.
+ * \return 0 on success, -EINVAL if the queue is not started, -EBUSY if
+ * LCDC_FRAME_QUEUE_SIZE frames are already owned by the LCDC.
+ */
+int lcdc_queue_frame(uint8_t layer_id, void *buffer)
+{
+	const struct _layer_info *layer = &lcdc_layers[layer_id];
+	struct _frame_queue *queue;
+	int err = 0;
+
+	if (!layer->data || !layer->data->queue || !layer->data->queue->active)
+		return -EINVAL;
+
+	queue = layer->data->queue;
+	layer->reg_enable[4] = LCDC_BASEIDR_ADD;
+
+	if (queue->count < LCDC_FRAME_QUEUE_SIZE) {
+		uint8_t slot = (queue->first + queue->count) % LCDC_FRAME_QUEUE_SIZE;
+		queue->frames[slot] = buffer;
+		queue->count++;
+		if (!queue->pending)
+			_frame_queue_commit(layer);
+	} else {
+		err = -EBUSY;
+	}
+
+	layer->reg_enable[3] = LCDC_BASEIER_ADD;
+	return err;
+}
+
 /**
  * \brief Turn on the LCD.
  */
@@ -115,9 +115,15 @@ enum {
 };
 /**     @}*/
 
+/** Frame buffers owned by the LCDC in a layer frame queue: one on screen, one
+ * queued for next start of frame and one waiting */
+#define LCDC_FRAME_QUEUE_SIZE 3
+
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "callback.h"
+
 /*----------------------------------------------------------------------------
  *        Types
  *----------------------------------------------------------------------------*/
@@ -157,6 +163,14 @@ extern void lcdc_enable_layer(uint8_t layer, bool enable);
 
 extern void lcdc_refresh(uint8_t layer);
 
+extern int lcdc_wait_vsync(uint8_t layer);
+
+extern int lcdc_queue_start(uint8_t layer, struct _callback *release);
+
+extern int lcdc_queue_stop(uint8_t layer);
+
+extern int lcdc_queue_frame(uint8_t layer, void *buffer);
+
 extern void lcdc_set_position(uint8_t layer, uint32_t x, uint32_t y);
 
 extern void lcdc_set_priority(uint8_t layer, uint8_t priority);
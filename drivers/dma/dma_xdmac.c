@@ -160,6 +160,7 @@ int xdmacd_configure_transfer(struct _dma_channel* channel,
 	return 0;
 }
 
+RAMFUNC
 void dma_irq_handler(uint32_t source, void* user_arg)
 {
 	uint32_t chan, gis, gcs;
@@ -91,6 +91,7 @@ uint32_t dmac_get_global_it_mask(Dmac *dmac)
 	return dmac->DMAC_EBCIMR;
 }
 
+RAMFUNC
 uint32_t dmac_get_global_isr(Dmac *dmac)
 {
 	assert(dmac == DMAC0 || dmac == DMAC1);
@@ -145,6 +146,7 @@ void dmac_disable_channels(Dmac *dmac, uint8_t channel_mask)
 	dmac->DMAC_CHDR = channel_mask;
 }
 
+RAMFUNC
 void dmac_resume_channel(Dmac *dmac, uint8_t channel)
 {
 	assert(dmac == DMAC0 || dmac == DMAC1);
@@ -255,6 +257,7 @@ bool is_dmac_auto_transfer(Dmac *dmac, uint8_t channel)
 	return (dmac->DMAC_CH[channel].DMAC_CTRLB & DMAC_CTRLB_AUTO_ENABLE);
 }
 
+RAMFUNC
 void dmac_auto_clear(Dmac *dmac, uint8_t channel)
 {
 	assert(dmac == DMAC0 || dmac == DMAC1);
@@ -78,6 +78,7 @@ uint32_t xdmac_get_global_it_mask(Xdmac *xdmac)
 	return xdmac->XDMAC_GIM;
 }
 
+RAMFUNC
 uint32_t xdmac_get_global_isr(Xdmac *xdmac)
 {
 	return xdmac->XDMAC_GIS;
@@ -121,6 +122,7 @@ void xdmac_disable_channels(Xdmac *xdmac, uint32_t channel_mask)
 	xdmac->XDMAC_GD = channel_mask;
 }
 
+RAMFUNC
 uint32_t xdmac_get_global_channel_status(Xdmac *xdmac)
 {
 	return xdmac->XDMAC_GS;
@@ -187,6 +189,7 @@ void xdmac_disable_channel_it(Xdmac *xdmac, uint8_t channel, uint32_t int_mask)
 	xdmac->XDMAC_CH[channel].XDMAC_CID = int_mask;
 }
 
+RAMFUNC
 uint32_t xdmac_get_channel_it_mask(Xdmac *xdmac, uint8_t channel)
 {
 	assert(channel < XDMAC_CHANNELS);
@@ -194,6 +197,7 @@ uint32_t xdmac_get_channel_it_mask(Xdmac *xdmac, uint8_t channel)
 	return xdmac->XDMAC_CH[channel].XDMAC_CIM;
 }
 
+RAMFUNC
 uint32_t xdmac_get_channel_isr(Xdmac *xdmac, uint8_t channel)
 {
 	assert(channel < XDMAC_CHANNELS);
@@ -32,13 +32,18 @@
  *----------------------------------------------------------------------------*/
 
 #include "chip.h"
+#include "errno.h"
 #include "trace.h"
 
 #include "extram/ddram.h"
+#include "extram/memtest.h"
 
 #include "peripherals/matrix.h"
 #include "extram/mpddrc.h"
 #include "peripherals/pmc.h"
+#ifdef CONFIG_HAVE_SFRBU
+#include "peripherals/sfrbu.h"
+#endif
 
 #include "mm/l1cache.h"
 
@@ -1146,3 +1151,33 @@ void ddram_configure(struct _mpddrc_desc* desc)
 	assert(!dcache_is_enabled());
 	mpddrc_configure(desc);
 }
+
+int ddram_configure_cached(struct _mpddrc_desc* desc,
+			   struct _mpddrc_saved_config* saved,
+			   uint32_t size)
+{
+	bool retained = false;
+
+	assert(!dcache_is_enabled());
+
+	if (mpddrc_configure_saved(desc, saved) == 0)
+		return 0;
+
+#ifdef CONFIG_HAVE_SFRBU
+	retained = sfrbu_is_ddr_backup_enabled();
+#endif
+	mpddrc_configure(desc);
+
+	/* do not overwrite a memory content kept in self-refresh */
+	if (retained)
+		return 1;
+
+	if (memtest_data_bus(DDR_CS_ADDR) < 0 ||
+	    memtest_address_bus(DDR_CS_ADDR, size) < 0) {
+		mpddrc_invalidate_saved_config(saved);
+		return -EIO;
+	}
+
+	mpddrc_save_config(desc, saved);
+	return 1;
+}
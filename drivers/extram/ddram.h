@@ -115,6 +115,26 @@ extern void ddram_init_descriptor(struct _mpddrc_desc* desc,
 
 extern void ddram_configure(struct _mpddrc_desc* desc);
 
+/**
+ * \brief Configure the DDRAM, reusing a setup saved on a previous boot.
+ *
+ * If the saved setup matches the descriptor, the controller is configured
+ * from it and the memory is not tested again. Otherwise the DDRAM is
+ * configured from the descriptor, the data and address buses are tested and
+ * the resulting setup is saved. No test is done when the memory content was
+ * retained in self-refresh.
+ *
+ * \param desc DDRAM descriptor
+ * \param saved Saved setup, in a location preserved across resets
+ * \param size Size of the memory in bytes (for the address bus test)
+ * \return 0 if the saved setup was used, 1 if the DDRAM was configured from
+ * the descriptor, -EIO if the bus test failed (the saved setup is then
+ * invalidated)
+ */
+extern int ddram_configure_cached(struct _mpddrc_desc* desc,
+				  struct _mpddrc_saved_config* saved,
+				  uint32_t size);
+
 #ifdef __cplusplus
 }
 #endif
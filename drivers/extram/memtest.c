@@ -0,0 +1,347 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "chip.h"
+#include "barriers.h"
+#include "errno.h"
+#include "intmath.h"
+
+#include "dma/dma.h"
+#include "extram/memtest.h"
+#include "mm/cache.h"
+
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+/* number of words generated at once when checking a block */
+#define MEMTEST_CHECK_WORDS 64
+
+/*----------------------------------------------------------------------------
+ *        Local types
+ *----------------------------------------------------------------------------*/
+
+struct _memtest_ctx {
+	const struct _memtest_cfg* cfg;
+	struct _dma_channel* channel;
+	uint32_t block_size;
+	uint32_t blocks;
+	bool dma_started;
+};
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static uint32_t _mix(uint32_t value)
+{
+	value ^= value >> 16;
+	value *= 0x85ebca6bu;
+	value ^= value >> 13;
+	value *= 0xc2b2ae35u;
+	value ^= value >> 16;
+	return value;
+}
+
+static void _record_error(struct _memtest_result* result, const uint32_t* addr,
+		uint32_t expected, uint32_t actual)
+{
+	if (result->errors == 0) {
+		result->first_addr = (uint32_t)addr;
+		result->expected = expected;
+		result->actual = actual;
+	}
+	result->errors++;
+}
+
+static void _block_area(struct _memtest_ctx* ctx, uint32_t block,
+		uint32_t* addr, uint32_t* size)
+{
+	uint32_t offset = block * ctx->block_size;
+
+	*addr = ctx->cfg->addr + offset;
+	*size = min_u32(ctx->block_size, ctx->cfg->size - offset);
+}
+
+static void _wait_dma(struct _memtest_ctx* ctx)
+{
+	if (!ctx->dma_started)
+		return;
+	while (!dma_is_transfer_done(ctx->channel))
+		dma_poll();
+	dma_reset_channel(ctx->channel);
+	dsb();
+	ctx->dma_started = false;
+}
+
+static void _write_block(struct _memtest_ctx* ctx,
+		enum _memtest_pattern pattern, uint32_t block)
+{
+	const struct _memtest_cfg* cfg = ctx->cfg;
+	uint32_t addr, size;
+
+	_block_area(ctx, block, &addr, &size);
+
+	if (!ctx->channel) {
+		memtest_fill(pattern, cfg->seed, (uint32_t*)addr,
+				(addr - cfg->addr) / 4, size / 4);
+		cache_clean_region((void*)addr, size);
+		return;
+	}
+
+	/* generate the block while the previous one is being transferred */
+	uint32_t* stage = cfg->stage + (block & 1) * (ctx->block_size / 4);
+	memtest_fill(pattern, cfg->seed, stage, (addr - cfg->addr) / 4, size / 4);
+	cache_clean_region(stage, size);
+
+	_wait_dma(ctx);
+
+	struct _dma_transfer_cfg xfer = {
+		.saddr = stage,
+		.daddr = (void*)addr,
+		.len = size / 4,
+	};
+	struct _dma_cfg dma_cfg = {
+		.incr_saddr = true,
+		.incr_daddr = true,
+		.data_width = DMA_DATA_WIDTH_WORD,
+		.chunk_size = DMA_CHUNK_SIZE_1,
+		.loop = false,
+	};
+	dma_configure_transfer(ctx->channel, &dma_cfg, &xfer, 1);
+	dma_start_transfer(ctx->channel);
+	ctx->dma_started = true;
+}
+
+static void _check_block(struct _memtest_ctx* ctx,
+		enum _memtest_pattern pattern, uint32_t block,
+		struct _memtest_result* result)
+{
+	const struct _memtest_cfg* cfg = ctx->cfg;
+	uint32_t addr, size;
+
+	_block_area(ctx, block, &addr, &size);
+	cache_invalidate_region((void*)addr, size);
+	memtest_check(pattern, cfg->seed, (const uint32_t*)addr,
+			(addr - cfg->addr) / 4, size / 4, result);
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+uint32_t memtest_pattern_word(enum _memtest_pattern pattern, uint32_t seed,
+		uint32_t index)
+{
+	switch (pattern) {
+	case MEMTEST_WALKING_ONES:
+		return 1u << (index & 31);
+	case MEMTEST_WALKING_ZEROS:
+		return ~(1u << (index & 31));
+	case MEMTEST_CHECKERBOARD:
+		return (index & 1) ? 0xaaaaaaaau : 0x55555555u;
+	case MEMTEST_ADDRESS:
+		return index;
+	case MEMTEST_INV_ADDRESS:
+		return ~index;
+	case MEMTEST_RANDOM:
+		return _mix(seed ^ (index * 0x9e3779b9u));
+	default:
+		return 0;
+	}
+}
+
+void memtest_fill(enum _memtest_pattern pattern, uint32_t seed,
+		uint32_t* buffer, uint32_t index, uint32_t count)
+{
+	uint32_t i;
+
+	switch (pattern) {
+	case MEMTEST_WALKING_ONES:
+		for (i = 0; i < count; i++)
+			buffer[i] = 1u << ((index + i) & 31);
+		break;
+	case MEMTEST_WALKING_ZEROS:
+		for (i = 0; i < count; i++)
+			buffer[i] = ~(1u << ((index + i) & 31));
+		break;
+	case MEMTEST_ADDRESS:
+		for (i = 0; i < count; i++)
+			buffer[i] = index + i;
+		break;
+	case MEMTEST_INV_ADDRESS:
+		for (i = 0; i < count; i++)
+			buffer[i] = ~(index + i);
+		break;
+	default:
+		for (i = 0; i < count; i++)
+			buffer[i] = memtest_pattern_word(pattern, seed, index + i);
+		break;
+	}
+}
+
+uint32_t memtest_check(enum _memtest_pattern pattern, uint32_t seed,
+		const uint32_t* buffer, uint32_t index, uint32_t count,
+		struct _memtest_result* result)
+{
+	uint32_t expected[MEMTEST_CHECK_WORDS];
+	uint32_t errors = 0;
+	uint32_t i, j, len;
+
+	for (i = 0; i < count; i += len) {
+		len = min_u32(count - i, MEMTEST_CHECK_WORDS);
+		memtest_fill(pattern, seed, expected, index + i, len);
+		if (!memcmp(expected, &buffer[i], len * 4))
+			continue;
+		for (j = 0; j < len; j++) {
+			if (buffer[i + j] == expected[j])
+				continue;
+			errors++;
+			if (result)
+				_record_error(result, &buffer[i + j],
+						expected[j], buffer[i + j]);
+		}
+	}
+
+	return errors;
+}
+
+int memtest_data_bus(uint32_t addr)
+{
+	volatile uint32_t* word = (volatile uint32_t*)addr;
+	uint32_t pattern;
+
+	for (pattern = 1; pattern; pattern <<= 1) {
+		*word = pattern;
+		dsb();
+		if (*word != pattern)
+			return -EIO;
+		*word = ~pattern;
+		dsb();
+		if (*word != ~pattern)
+			return -EIO;
+	}
+
+	return 0;
+}
+
+int memtest_address_bus(uint32_t addr, uint32_t size)
+{
+	volatile uint32_t* base = (volatile uint32_t*)addr;
+	const uint32_t pattern = 0xaaaaaaaau;
+	const uint32_t antipattern = 0x55555555u;
+	uint32_t words = size / 4;
+	uint32_t offset, test;
+
+	/* write the pattern at each power-of-two offset */
+	for (offset = 1; offset < words; offset <<= 1)
+		base[offset] = pattern;
+
+	/* check for address bits stuck high */
+	base[0] = antipattern;
+	dsb();
+	for (offset = 1; offset < words; offset <<= 1)
+		if (base[offset] != pattern)
+			return -EIO;
+	base[0] = pattern;
+
+	/* check for address bits stuck low or shorted */
+	for (test = 1; test < words; test <<= 1) {
+		base[test] = antipattern;
+		dsb();
+		if (base[0] != pattern)
+			return -EIO;
+		for (offset = 1; offset < words; offset <<= 1)
+			if (offset != test && base[offset] != pattern)
+				return -EIO;
+		base[test] = pattern;
+	}
+
+	return 0;
+}
+
+int memtest_run(const struct _memtest_cfg* cfg, struct _memtest_result* result)
+{
+	struct _memtest_ctx ctx;
+	uint32_t p, block;
+
+	memset(result, 0, sizeof(*result));
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.cfg = cfg;
+
+	if (!cfg->pattern_count || !cfg->size || ((cfg->addr | cfg->size) & 3))
+		return -EINVAL;
+	for (p = 0; p < cfg->pattern_count; p++)
+		if (cfg->patterns[p] >= MEMTEST_PATTERN_COUNT)
+			return -EINVAL;
+
+	if (cfg->use_dma) {
+		ctx.block_size = (cfg->stage_size / 2) & ~(L1_CACHE_BYTES - 1);
+		if (!cfg->stage || !IS_CACHE_ALIGNED(cfg->stage) ||
+		    ctx.block_size == 0)
+			return -EINVAL;
+		ctx.channel = dma_allocate_channel(DMA_PERIPH_MEMORY,
+				DMA_PERIPH_MEMORY);
+		if (!ctx.channel)
+			return -EBUSY;
+	} else {
+		ctx.block_size = 16 * 1024;
+	}
+	ctx.blocks = (cfg->size + ctx.block_size - 1) / ctx.block_size;
+
+	for (block = 0; block < ctx.blocks; block++)
+		_write_block(&ctx, cfg->patterns[0], block);
+	_wait_dma(&ctx);
+
+	/* Check each pattern once it has been completely written, so that
+	 * aliased addresses are detected. Each checked block is then
+	 * overwritten with the next pattern while the CPU checks the
+	 * following block. */
+	for (p = 0; p < cfg->pattern_count; p++) {
+		bool next = (p + 1) < cfg->pattern_count;
+
+		for (block = 0; block < ctx.blocks; block++) {
+			_check_block(&ctx, cfg->patterns[p], block, result);
+			if (next)
+				_write_block(&ctx, cfg->patterns[p + 1], block);
+		}
+		_wait_dma(&ctx);
+	}
+
+	if (ctx.channel)
+		dma_free_channel(ctx.channel);
+
+	return result->errors ? -EIO : 0;
+}
@@ -0,0 +1,148 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * External RAM test engine.
+ *
+ * Test patterns are pure functions of the word index inside the tested area,
+ * so any part of the area can be generated or checked independently. The
+ * area is filled by DMA memory-to-memory transfers from a double-buffered
+ * staging area while the CPU generates the next block and checks the blocks
+ * already written, and a pattern is only checked once the whole area has
+ * been written so that address aliasing is detected.
+ */
+
+#ifndef MEMTEST_H_
+#define MEMTEST_H_
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+enum _memtest_pattern {
+	MEMTEST_WALKING_ONES,   /**< single bit set, rotating with the index */
+	MEMTEST_WALKING_ZEROS,  /**< single bit cleared, rotating with the index */
+	MEMTEST_CHECKERBOARD,   /**< 0x55555555/0xaaaaaaaa alternating */
+	MEMTEST_ADDRESS,        /**< word index */
+	MEMTEST_INV_ADDRESS,    /**< inverted word index */
+	MEMTEST_RANDOM,         /**< pseudo-random, derived from seed and index */
+	MEMTEST_PATTERN_COUNT,
+};
+
+struct _memtest_result {
+	uint32_t errors;      /**< number of mismatching words */
+	uint32_t first_addr;  /**< address of the first mismatching word */
+	uint32_t expected;    /**< expected value at first_addr */
+	uint32_t actual;      /**< value read at first_addr */
+};
+
+struct _memtest_cfg {
+	uint32_t addr;        /**< start of the tested area (cache aligned) */
+	uint32_t size;        /**< size of the tested area in bytes */
+	const enum _memtest_pattern* patterns;
+	uint32_t pattern_count;
+	uint32_t seed;        /**< seed for MEMTEST_RANDOM */
+	uint32_t* stage;      /**< staging area in internal SRAM (cache aligned) */
+	uint32_t stage_size;  /**< staging area size in bytes, split in 2 blocks */
+	bool use_dma;         /**< fill the tested area using DMA */
+};
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Compute a pattern word.
+ * \param pattern Test pattern
+ * \param seed Seed for MEMTEST_RANDOM
+ * \param index Index of the word inside the tested area
+ * \return value of the word
+ */
+extern uint32_t memtest_pattern_word(enum _memtest_pattern pattern,
+		uint32_t seed, uint32_t index);
+
+/**
+ * \brief Fill a buffer with a part of a pattern.
+ * \param buffer Buffer to fill
+ * \param index Index of the first word of buffer inside the tested area
+ * \param count Number of words
+ */
+extern void memtest_fill(enum _memtest_pattern pattern, uint32_t seed,
+		uint32_t* buffer, uint32_t index, uint32_t count);
+
+/**
+ * \brief Check a buffer against a part of a pattern.
+ * \param buffer Buffer to check
+ * \param index Index of the first word of buffer inside the tested area
+ * \param count Number of words
+ * \param result Error count and first error, updated (may be NULL)
+ * \return number of mismatching words
+ */
+extern uint32_t memtest_check(enum _memtest_pattern pattern, uint32_t seed,
+		const uint32_t* buffer, uint32_t index, uint32_t count,
+		struct _memtest_result* result);
+
+/**
+ * \brief Quick data bus test: walking one on a single word.
+ * \param addr Address of the word used for the test
+ * \return 0 on success, -EIO on failure
+ */
+extern int memtest_data_bus(uint32_t addr);
+
+/**
+ * \brief Quick address bus test: words at power-of-two offsets.
+ * \param addr Start of the tested area
+ * \param size Size of the tested area in bytes (power of two)
+ * \return 0 on success, -EIO on failure
+ */
+extern int memtest_address_bus(uint32_t addr, uint32_t size);
+
+/**
+ * \brief Run the configured patterns over the tested area.
+ *
+ * The DMA driver must be initialized when use_dma is set.
+ *
+ * \param cfg Test configuration
+ * \param result Error count and first error
+ * \return 0 on success, -EIO if errors were found, -EINVAL for a wrong
+ * configuration, -EBUSY if no DMA channel is available
+ */
+extern int memtest_run(const struct _memtest_cfg* cfg,
+		struct _memtest_result* result);
+
+#endif /* MEMTEST_H_ */
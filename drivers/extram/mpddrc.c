@@ -29,6 +29,7 @@
 
 #include "chip.h"
 #include "barriers.h"
+#include "errno.h"
 #include "timer.h"
 #include "trace.h"
 
@@ -37,7 +38,9 @@
 #include "peripherals/sfrbu.h"
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef MPDDRC_LPR_LPCB_DISABLED
 #define MPDDRC_LPR_LPCB_DISABLED			(MPDDRC_LPR_LPCB_NOLOWPOWER)
@@ -480,7 +483,56 @@ static void _configure_lpddr(struct _mpddrc_desc *desc)
 
 #endif /* CONFIG_HAVE_MPDDRC_LPDDR */
 
-extern void mpddrc_configure(struct _mpddrc_desc* desc)
+static uint32_t _checksum(const uint32_t* data, uint32_t count)
+{
+	uint32_t sum = 0xffffffffu;
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		sum = ((sum << 5) | (sum >> 27)) ^ data[i];
+	return sum;
+}
+
+/* Signature of the descriptor a saved configuration was made from */
+static uint32_t _desc_signature(const struct _mpddrc_desc* desc)
+{
+	uint32_t data[7 + (sizeof(desc->timings) + 3) / 4];
+
+	memset(data, 0, sizeof(data));
+	data[0] = desc->type;
+	data[1] = desc->mode;
+	data[2] = desc->control;
+	data[3] = desc->refresh_window;
+	data[4] = desc->refresh_cycles;
+#ifdef CONFIG_HAVE_MPDDRC_IO_CALIBRATION
+	data[5] = desc->io_calibr;
+#endif
+#ifdef CONFIG_HAVE_MPDDRC_DATA_PATH
+	data[6] = desc->data_path;
+#endif
+	memcpy(&data[7], &desc->timings, sizeof(desc->timings));
+
+	return _checksum(data, ARRAY_SIZE(data));
+}
+
+static uint32_t _saved_config_checksum(const struct _mpddrc_saved_config* saved)
+{
+	return _checksum((const uint32_t*)saved,
+			offsetof(struct _mpddrc_saved_config, checksum) / 4);
+}
+
+/* Whether the memory content was retained in self-refresh */
+static bool _is_memory_retained(void)
+{
+#ifdef CONFIG_HAVE_SFRBU
+	return sfrbu_is_ddr_backup_enabled();
+#else
+	return false;
+#endif
+}
+
+static void _configure(struct _mpddrc_desc* desc,
+		const struct _mpddrc_saved_config* saved)
 {
 #ifdef MPDDRC_HS_DIS_ANTICIP_READ
 	/* Disable anticipated read */
@@ -513,11 +565,16 @@ extern void mpddrc_configure(struct _mpddrc_desc* desc)
 	value &= ~MPDDRC_IO_CALIBR_CALCODEN_Msk;
 
 	value |= desc->io_calibr;
+	if (saved) {
+		/* start from the previously calibrated ZQ codes */
+		value &= ~(MPDDRC_IO_CALIBR_CALCODEP_Msk | MPDDRC_IO_CALIBR_CALCODEN_Msk);
+		value |= saved->io_calibr & (MPDDRC_IO_CALIBR_CALCODEP_Msk | MPDDRC_IO_CALIBR_CALCODEN_Msk);
+	}
 	MPDDRC->MPDDRC_IO_CALIBR = value;
 #endif
 
 #ifdef CONFIG_HAVE_MPDDRC_DATA_PATH
-	MPDDRC->MPDDRC_RD_DATA_PATH = desc->data_path;
+	MPDDRC->MPDDRC_RD_DATA_PATH = saved ? saved->data_path : desc->data_path;
 #endif
 
 	/* Step 2: Program features of the DDR3-SDRAM device in the
@@ -539,7 +596,11 @@ extern void mpddrc_configure(struct _mpddrc_desc* desc)
 	if (lpr != lpr_prv)
 		MPDDRC->MPDDRC_LPR = lpr;
 
-	switch(desc->type) {
+	if (saved && _is_memory_retained()) {
+		/* Validated setup and memory still initialized: only the
+		 * controller timings are needed to leave self-refresh */
+		_set_ddr_timings(desc);
+	} else switch(desc->type) {
 #ifdef CONFIG_HAVE_MPDDRC_SDRAM
 	case MPDDRC_TYPE_SDRAM:
 		_configure_sdram(desc);
@@ -576,9 +637,13 @@ extern void mpddrc_configure(struct _mpddrc_desc* desc)
 	}
 
 	/* Last step: Write the refresh rate */
-	/* Refresh Timer is (refresh_window / refresh_cycles) * master_clock */
-	uint32_t master_clock = pmc_get_master_clock() / 1000;
-	MPDDRC->MPDDRC_RTR = MPDDRC_RTR_COUNT(desc->refresh_window * master_clock / desc->refresh_cycles);
+	if (saved) {
+		MPDDRC->MPDDRC_RTR = saved->rtr;
+	} else {
+		/* Refresh Timer is (refresh_window / refresh_cycles) * master_clock */
+		uint32_t master_clock = pmc_get_master_clock() / 1000;
+		MPDDRC->MPDDRC_RTR = MPDDRC_RTR_COUNT(desc->refresh_window * master_clock / desc->refresh_cycles);
+	}
 
 #ifdef CONFIG_HAVE_SFRBU
 	if (sfrbu_is_ddr_backup_enabled()) {
@@ -589,6 +654,55 @@ extern void mpddrc_configure(struct _mpddrc_desc* desc)
 #endif
 }
 
+void mpddrc_configure(struct _mpddrc_desc* desc)
+{
+	_configure(desc, NULL);
+}
+
+void mpddrc_save_config(const struct _mpddrc_desc* desc,
+		struct _mpddrc_saved_config* saved)
+{
+	saved->magic = MPDDRC_SAVED_CONFIG_MAGIC;
+	saved->signature = _desc_signature(desc);
+	saved->master_clock = pmc_get_master_clock();
+#ifdef CONFIG_HAVE_MPDDRC_IO_CALIBRATION
+	saved->io_calibr = MPDDRC->MPDDRC_IO_CALIBR;
+#else
+	saved->io_calibr = 0;
+#endif
+#ifdef CONFIG_HAVE_MPDDRC_DATA_PATH
+	saved->data_path = MPDDRC->MPDDRC_RD_DATA_PATH;
+#else
+	saved->data_path = 0;
+#endif
+	saved->rtr = MPDDRC->MPDDRC_RTR;
+	saved->checksum = _saved_config_checksum(saved);
+}
+
+bool mpddrc_saved_config_valid(const struct _mpddrc_desc* desc,
+		const struct _mpddrc_saved_config* saved)
+{
+	return saved->magic == MPDDRC_SAVED_CONFIG_MAGIC &&
+	       saved->checksum == _saved_config_checksum(saved) &&
+	       saved->signature == _desc_signature(desc) &&
+	       saved->master_clock == pmc_get_master_clock();
+}
+
+int mpddrc_configure_saved(struct _mpddrc_desc* desc,
+		const struct _mpddrc_saved_config* saved)
+{
+	if (!mpddrc_saved_config_valid(desc, saved))
+		return -EINVAL;
+
+	_configure(desc, saved);
+	return 0;
+}
+
+void mpddrc_invalidate_saved_config(struct _mpddrc_saved_config* saved)
+{
+	saved->magic = 0;
+}
+
 RAMCODE void mpddrc_issue_low_power_command(uint32_t cmd)
 {
 	uint32_t value;
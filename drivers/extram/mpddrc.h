@@ -30,6 +30,7 @@
 #ifndef MPDDRC_HEADER_
 #define MPDDRC_HEADER_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 enum _ram_type {
@@ -88,6 +89,23 @@ struct _mpddrc_desc {
 	uint32_t refresh_cycles;
 };
 
+#define MPDDRC_SAVED_CONFIG_MAGIC 0x4344444du /* "MDDC" */
+
+/**
+ * Controller setup saved after the memory has been validated, to be stored
+ * in a location preserved across resets (backup SRAM, NVM) and reused on the
+ * next boot.
+ */
+struct _mpddrc_saved_config {
+	uint32_t magic;
+	uint32_t signature;    /**< signature of the descriptor used */
+	uint32_t master_clock; /**< MCK frequency the setup was made for */
+	uint32_t io_calibr;    /**< IO calibration, including ZQ codes */
+	uint32_t data_path;    /**< read data path */
+	uint32_t rtr;          /**< refresh timer */
+	uint32_t checksum;
+};
+
 RAMDATA extern struct pck_mck_cfg clock_setting_backup;
 #ifdef CONFIG_RAMCODE
 RAMDATA extern volatile int _ddr_active_needed;
@@ -95,6 +113,46 @@ RAMDATA extern volatile int _ddr_active_needed;
 
 extern void mpddrc_configure(struct _mpddrc_desc* desc);
 
+/**
+ * \brief Save the current controller setup.
+ *
+ * To be called once the memory configured from desc has been validated.
+ *
+ * \param desc the descriptor used to configure the controller
+ * \param saved the saved setup
+ */
+extern void mpddrc_save_config(const struct _mpddrc_desc* desc,
+		struct _mpddrc_saved_config* saved);
+
+/**
+ * \brief Check whether a saved setup can be used with a descriptor.
+ *
+ * The saved setup must be intact and made from the same descriptor, at the
+ * same master clock frequency.
+ */
+extern bool mpddrc_saved_config_valid(const struct _mpddrc_desc* desc,
+		const struct _mpddrc_saved_config* saved);
+
+/**
+ * \brief Configure the controller from a saved setup.
+ *
+ * The ZQ calibration codes, read data path and refresh timer are restored
+ * from the saved setup. When the memory content was retained in
+ * self-refresh, the device initialization sequence is skipped.
+ *
+ * \param desc the descriptor the setup was saved from
+ * \param saved the saved setup
+ * \return 0 on success, -EINVAL if the saved setup cannot be used (the
+ * controller is left untouched)
+ */
+extern int mpddrc_configure_saved(struct _mpddrc_desc* desc,
+		const struct _mpddrc_saved_config* saved);
+
+/**
+ * \brief Invalidate a saved setup, e.g. after a memory test failure.
+ */
+extern void mpddrc_invalidate_saved_config(struct _mpddrc_saved_config* saved);
+
 /**
  * \brief Issue a Low-Power Command to the DDR-SDRAM device.
  *
@@ -563,15 +563,33 @@ static int _twid_poll_write(struct _twi_desc* desc, struct _buffer* buffer)
 			twi_send_stop_condition(desc->addr);
 
 	if (size == (buffer->size - 1)) {
+		uint32_t status;
+
 		if (_check_tx_timeout(desc))
 			return -ETIMEDOUT;
 		twi_write_byte(desc->addr, buffer->data[i]);
-		while(!twi_is_byte_sent(desc->addr));
+		do {
+			status = twi_get_status(desc->addr);
+		} while (!(status & TWI_SR_TXRDY));
+
+		/* NACK is set with TXRDY (and cleared on read) when the slave
+		 * does not acknowledge its address, e.g. EEPROM busy */
+		if (status & TWI_SR_NACK)
+			return -ECONNABORTED;
 	}
 
 	/* wait transfer to be finished */
-	if (desc->flags & BUS_I2C_BUF_ATTR_STOP)
-		return _twid_wait_twi_transfer(desc);
+	if (desc->flags & BUS_I2C_BUF_ATTR_STOP) {
+		int err = _twid_wait_twi_transfer(desc);
+#ifdef CONFIG_HAVE_TWI_FIFO
+		if (!err && use_fifo && twi_fifo_is_locked(desc->addr)) {
+			twi_fifo_unlock(desc->addr);
+			twi_fifo_flush_tx(desc->addr);
+			return -ECONNABORTED;
+		}
+#endif
+		return err;
+	}
 	return 0;
 }
 
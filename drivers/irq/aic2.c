@@ -132,6 +132,7 @@ void aic_disable(uint32_t source)
 	AIC->AIC_IDCR = 1 << source;
 }
 
+RAMFUNC
 uint32_t aic_get_current_interrupt_source(void)
 {
 	return AIC->AIC_ISR;
@@ -182,6 +182,7 @@ void aic_disable(uint32_t source)
 	aic->AIC_IDCR = AIC_IDCR_INTD;
 }
 
+RAMFUNC
 uint32_t aic_get_current_interrupt_source(void)
 {
 	return AIC->AIC_ISR;
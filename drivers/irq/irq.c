@@ -99,6 +99,7 @@ static void _free_handler(struct handler_entry* entry)
 	next_free_handler = entry;
 }
 
+RAMFUNC
 static void _default_irq_handler(void)
 {
 	uint32_t source;
@@ -97,6 +97,7 @@ void nvic_disable(uint32_t source)
 	NVIC->NVIC_ICER[index] = bit;
 }
 
+RAMFUNC
 uint32_t nvic_get_current_interrupt_source(void)
 {
 	uint32_t ipsr;
@@ -449,6 +449,27 @@ exit:
 	return err;
 }
 
+int phy_auto_negotiate_poll(const struct _phy* phy)
+{
+	int err;
+	uint16_t value;
+
+	err = phy->op->phy_read(phy->desc->addr, phy->desc->phy_addr,
+			GMII_BMSR, &value, phy->desc->timeout.idle);
+	if (err < 0) {
+		trace_error("Error reading PHY BMSR\r\n");
+		phy->op->disable_mido(phy->desc->addr);
+		return err;
+	}
+
+	if (!(value & GMII_BMSR_AUTONEG_COMP))
+		return 1;
+
+	/* auto-negotiation completed, setup the MAC link speed */
+	err = phy_auto_negotiate_wait_for_completion(phy);
+	return err < 0 ? err : 0;
+}
+
 int phy_auto_negotiate(const struct _phy* phy, bool block)
 {
 	int err = 0;
@@ -132,6 +132,11 @@ extern int phy_auto_negotiate(const struct _phy* phy, bool block);
 
 extern int phy_auto_negotiate_wait_for_completion(const struct _phy* phy);
 
+/* Check once for the completion of an auto-negotiation started with
+ * phy_auto_negotiate(phy, false): return 1 while in progress, 0 once the link
+ * mode is set, or a negative error code */
+extern int phy_auto_negotiate_poll(const struct _phy* phy);
+
 extern int phy_set_speed_duplex(const struct _phy* phy, enum _eth_speed speed, enum _eth_duplex duplex);
 
 extern void phy_dump_registers(const struct _phy* phy);
@@ -58,7 +58,7 @@ void eefc_set_flash_wait_states(Eefc* eefc, uint8_t cycles)
 	eefc->EEFC_FMR = (eefc->EEFC_FMR & ~EEFC_FMR_FWS_Msk) | EEFC_FMR_FWS(cycles);
 }
 
-SECTION(".ramfunc")
+RAMFUNC
 int eefc_read_unique_id(Eefc* eefc, uint8_t* uid)
 {
 	uint32_t status;
@@ -79,7 +79,7 @@ int eefc_read_unique_id(Eefc* eefc, uint8_t* uid)
 
 	/* Wait for Unique Identifier to be ready (i.e. !FRDY) */
 	do {
-		status = EEFC->EEFC_FSR;
+		status = eefc->EEFC_FSR;
 	} while ((status & EEFC_FSR_FRDY) == EEFC_FSR_FRDY);
 
 	/* The Unique Identifier is located in the first 128 bits of the Flash */
@@ -91,7 +91,7 @@ int eefc_read_unique_id(Eefc* eefc, uint8_t* uid)
 
 	/* Wait for Stop Unique Identifier to be complete (i.e. FRDY) */
 	do {
-		status = EEFC->EEFC_FSR;
+		status = eefc->EEFC_FSR;
 	} while ((status & EEFC_FSR_FRDY) != EEFC_FSR_FRDY);
 
 	/* Flash is available again, re-enable interrupts */
@@ -100,15 +100,30 @@ int eefc_read_unique_id(Eefc* eefc, uint8_t* uid)
 	return 0;
 }
 
+RAMFUNC
+void eefc_start_command(Eefc* eefc, uint32_t cmd, uint32_t arg)
+{
+	eefc->EEFC_FCR = EEFC_FCR_FKEY_PASSWD | EEFC_FCR_FARG(arg) | (cmd & EEFC_FCR_FCMD_Msk);
+}
+
+RAMFUNC
 int eefc_perform_command(Eefc* eefc, uint32_t cmd, uint32_t arg)
 {
 	uint32_t status;
 
+	/* The flash cannot be read until the command completes: both the
+	 * command start and the wait loop run from SRAM. */
 	eefc->EEFC_FCR = EEFC_FCR_FKEY_PASSWD | EEFC_FCR_FARG(arg) | (cmd & EEFC_FCR_FCMD_Msk);
 	do {
-		status = EEFC->EEFC_FSR;
+		status = eefc->EEFC_FSR;
 	} while ((status & EEFC_FSR_FRDY) != EEFC_FSR_FRDY);
 
+	return eefc_check_status(status);
+}
+
+RAMFUNC
+int eefc_check_status(uint32_t status)
+{
 	if (status & EEFC_FSR_FLOCKE)
 		return -EPERM;
 	else if (status & EEFC_FSR_FLERR)
@@ -81,6 +81,26 @@ extern int eefc_read_unique_id(Eefc* eefc, uint8_t* uid);
  */
 extern int eefc_perform_command(Eefc* eefc, uint32_t command, uint32_t arg);
 
+/**
+ * \brief Starts the given command and returns without waiting for its
+ * completion. The FRDY bit of the status (or the FRDY interrupt) signals the
+ * end of the command, eefc_check_status() then gives its result.
+ *
+ * \param eefc  Pointer to a Efc instance
+ * \param cmd  Command to perform.
+ * \param arg  Optional command argument.
+ */
+extern void eefc_start_command(Eefc* eefc, uint32_t command, uint32_t arg);
+
+/**
+ * \brief Converts the status of a completed command into an error code.
+ *
+ * \param status  EEFC status read once the FRDY bit is set.
+ *
+ * \return 0 if successful, otherwise returns an error code.
+ */
+extern int eefc_check_status(uint32_t status);
+
 /**
  * \brief Returns the current status of the EEFC.
  *
@@ -40,6 +40,7 @@
 #include "errno.h"
 #include "flashd.h"
 #include "intmath.h"
+#include "irq/irq.h"
 #include "mm/cache.h"
 #include "trace.h"
 #include "serial/console.h"
@@ -48,10 +49,272 @@
  *        Local definitions
  *----------------------------------------------------------------------------*/
 
-#define MAX_PAGE_SIZE 512
 #define MAX_LOCK_REGIONS 128
 
-static uint32_t page_buffer[MAX_PAGE_SIZE / sizeof(uint32_t)];
+/* "Erase and Write Page" is only supported in the 8 Kbytes sectors at the
+ * beginning of the flash */
+#define SMALL_SECTORS_SIZE (16 * 1024)
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static int _flashd_get_erase_arg(struct _flash* flash, uint32_t page, uint32_t* farg)
+{
+	/* Get FARG field for EPA command:
+	 * The first page to be erased is specified in the FARG[15:2] field of
+	 * the MC_FCR register.
+	 *
+	 * The 2 lowest bits of the FARG field define the number of pages to
+	 * be erased (FARG[1:0]).
+	 */
+	switch (flash->erase_size / flash->page_size) {
+	case 32:
+		*farg = page | 3; /* 32 pages */
+		break;
+	case 16:
+		*farg = page | 2; /* 16 pages */
+		break;
+	case 8:
+		*farg = page | 1; /* 8 pages */
+		break;
+	case 4:
+		*farg = page; /* 4 pages */
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static bool _flashd_is_erased(uint32_t addr, uint32_t length)
+{
+	const uint32_t* ptr = (const uint32_t*)(IFLASH_ADDR + addr);
+	int i;
+
+	for (i = 0; i < length / sizeof(uint32_t); i++)
+		if (ptr[i] != 0xffffffff)
+			return false;
+
+	return true;
+}
+
+static bool _flashd_buffer_needs_erase(struct _flash* flash)
+{
+	const uint32_t* ptr = (const uint32_t*)(IFLASH_ADDR +
+			flash->buffer.page * flash->page_size);
+	int i;
+
+	/* programming can only clear bits */
+	for (i = 0; i < flash->page_size / sizeof(uint32_t); i++)
+		if (~ptr[i] & flash->buffer.data[i])
+			return true;
+
+	return false;
+}
+
+static void _flashd_latch_buffer(struct _flash* flash)
+{
+	volatile uint32_t* flashptr = (uint32_t*)(IFLASH_ADDR +
+			flash->buffer.page * flash->page_size);
+	int i;
+
+	/* copy from buffer to flash, use barriers to force write order */
+	for (i = 0; i < flash->page_size / sizeof(uint32_t); i++) {
+		flashptr[i] = flash->buffer.data[i];
+		dsb();
+	}
+
+	cache_invalidate_region((void*)flashptr, flash->page_size);
+	flash->buffer.dirty = false;
+}
+
+static bool _flashd_op_covers_page(struct _flash* flash, uint32_t page)
+{
+	uint32_t addr = page * flash->page_size;
+
+	return addr >= flash->op.addr &&
+	       addr + flash->page_size <= flash->op.addr + flash->op.length;
+}
+
+/* Get the command programming the page buffer, or the erase command that must
+ * be performed before it */
+static int _flashd_program_buffer(struct _flash* flash, uint32_t* cmd, uint32_t* arg)
+{
+	uint32_t page = flash->buffer.page;
+	uint32_t addr = page * flash->page_size;
+	int rc;
+
+	*cmd = EEFC_FCR_FCMD_WP;
+	*arg = page;
+
+	if (addr < flash->op.erased_end &&
+	    addr >= flash->op.erased_end - flash->erase_size) {
+		/* erase block already erased by this operation */
+	} else if ((addr % flash->erase_size) == 0 &&
+	           addr >= flash->op.addr &&
+	           addr + flash->erase_size <= flash->op.addr + flash->op.length &&
+	           !_flashd_is_erased(addr, flash->erase_size)) {
+		/* the whole erase block is rewritten: erase it with a single
+		 * command, the page is programmed once the erase completed */
+		rc = _flashd_get_erase_arg(flash, page, arg);
+		if (rc < 0)
+			return rc;
+		cache_invalidate_region((void*)(IFLASH_ADDR + addr),
+				flash->erase_size);
+		flash->op.erased_end = addr + flash->erase_size;
+		*cmd = EEFC_FCR_FCMD_EPA;
+		return 1;
+	} else if (addr < SMALL_SECTORS_SIZE &&
+	           _flashd_buffer_needs_erase(flash)) {
+		*cmd = EEFC_FCR_FCMD_EWP;
+	}
+
+	_flashd_latch_buffer(flash);
+	flash->op.program = false;
+	return 1;
+}
+
+/* Fill the page buffer from the operation data and get the next command to
+ * perform. Returns 1 if a command must be performed, 0 when the operation is
+ * complete or a negative error code. */
+static int _flashd_next_command(struct _flash* flash, uint32_t* cmd, uint32_t* arg)
+{
+	while (!flash->op.program) {
+		if (flash->op.offset < flash->op.length) {
+			uint32_t addr = flash->op.addr + flash->op.offset;
+			uint32_t page = addr / flash->page_size;
+			uint32_t page_offset = addr - page * flash->page_size;
+			uint32_t size = min_u32(flash->op.length - flash->op.offset,
+					flash->page_size - page_offset);
+
+			/* program the page buffered by a previous write first,
+			 * unless this operation rewrites it entirely: the page
+			 * would be programmed twice after a single erase of its
+			 * block */
+			if (flash->buffer.dirty && flash->buffer.page != page) {
+				if (_flashd_op_covers_page(flash, flash->buffer.page)) {
+					flash->buffer.dirty = false;
+				} else {
+					flash->op.program = true;
+					break;
+				}
+			}
+
+			/* if data does not cover full page, read existing data
+			 * from flash */
+			if (!flash->buffer.dirty) {
+				if (size < flash->page_size)
+					memcpy(flash->buffer.data,
+					       (uint8_t*)(IFLASH_ADDR + page * flash->page_size),
+					       flash->page_size);
+				flash->buffer.page = page;
+				flash->buffer.dirty = true;
+			}
+
+			memcpy((uint8_t*)flash->buffer.data + page_offset,
+			       flash->op.data + flash->op.offset, size);
+			flash->op.offset += size;
+
+			if (page_offset + size == flash->page_size)
+				flash->op.program = true;
+		} else if (flash->op.flush && flash->buffer.dirty) {
+			flash->op.program = true;
+		} else {
+			return 0;
+		}
+	}
+
+	return _flashd_program_buffer(flash, cmd, arg);
+}
+
+static void _flashd_start_op(struct _flash* flash, uint32_t addr, const uint8_t* data, uint32_t length, bool flush)
+{
+	flash->op.addr = addr;
+	flash->op.data = data;
+	flash->op.length = length;
+	flash->op.offset = 0;
+	flash->op.erased_end = 0;
+	flash->op.flush = flush;
+	flash->op.program = false;
+}
+
+static void _flashd_abort_op(struct _flash* flash)
+{
+	flash->op.length = 0;
+	flash->op.offset = 0;
+	flash->op.program = false;
+	flash->buffer.dirty = false;
+}
+
+static int _flashd_run_op(struct _flash* flash)
+{
+	uint32_t cmd, arg;
+	int rc;
+
+	board_cfg_mpu_for_flash_write();
+
+	while ((rc = _flashd_next_command(flash, &cmd, &arg)) > 0) {
+		rc = eefc_perform_command(flash->eefc, cmd, arg);
+		if (rc < 0)
+			break;
+	}
+
+	board_cfg_mpu_for_flash_read();
+
+	if (rc < 0)
+		_flashd_abort_op(flash);
+
+	return rc;
+}
+
+static void _flashd_async_complete(struct _flash* flash, int rc)
+{
+	eefc_disable_frdy_it(flash->eefc);
+	board_cfg_mpu_for_flash_read();
+
+	if (rc < 0)
+		_flashd_abort_op(flash);
+
+	flash->async.status = rc;
+	flash->async.busy = false;
+	callback_call(&flash->async.cb, (void*)rc);
+}
+
+static void _flashd_async_next(struct _flash* flash)
+{
+	uint32_t cmd, arg;
+	int rc;
+
+	rc = _flashd_next_command(flash, &cmd, &arg);
+	if (rc > 0)
+		eefc_start_command(flash->eefc, cmd, arg);
+	else
+		_flashd_async_complete(flash, rc);
+}
+
+static void _flashd_async_ready(struct _flash* flash, uint32_t status)
+{
+	int rc = eefc_check_status(status);
+
+	if (rc < 0)
+		_flashd_async_complete(flash, rc);
+	else
+		_flashd_async_next(flash);
+}
+
+static void _flashd_irq_handler(uint32_t source, void* user_arg)
+{
+	struct _flash* flash = (struct _flash*)user_arg;
+	uint32_t status;
+
+	assert(source == ID_EFC);
+
+	status = eefc_get_status(flash->eefc);
+	if (flash->async.busy && (status & EEFC_FSR_FRDY))
+		_flashd_async_ready(flash, status);
+}
 
 /*----------------------------------------------------------------------------
  *        Exported functions
@@ -83,7 +346,7 @@ int flashd_initialize(struct _flash* flash, Eefc* eefc)
 
 	/* FL_PAGE_SIZE */
 	flash->page_size = eefc_get_result(flash->eefc);
-	if (flash->page_size > MAX_PAGE_SIZE)
+	if (flash->page_size > FLASHD_MAX_PAGE_SIZE)
 		return -ENOTSUP;
 
 	/* FL_NB_PLANE (check that only 1 plane available) */
@@ -220,6 +483,11 @@ int flashd_set_gpnvm_bits(struct _flash* flash, uint8_t gpnvm_start, uint8_t gpn
 
 int flashd_erase(struct _flash* flash)
 {
+	if (flash->async.busy)
+		return -EBUSY;
+
+	flash->buffer.dirty = false;
+
 	cache_invalidate_region((void*)IFLASH_ADDR, flash->total_size);
 	return eefc_perform_command(flash->eefc, EEFC_FCR_FCMD_EA, 0);
 }
@@ -227,6 +495,10 @@ int flashd_erase(struct _flash* flash)
 int flashd_erase_block(struct _flash* flash, uint32_t addr, uint32_t length)
 {
 	uint32_t page, farg;
+	int rc;
+
+	if (flash->async.busy)
+		return -EBUSY;
 
 	if (addr % flash->erase_size != 0)
 		return -EINVAL;
@@ -236,29 +508,14 @@ int flashd_erase_block(struct _flash* flash, uint32_t addr, uint32_t length)
 
 	page = addr / flash->page_size;
 
-	/* Get FARG field for EPA command:
-	 * The first page to be erased is specified in the FARG[15:2] field of
-	 * the MC_FCR register.
-	 *
-	 * The 2 lowest bits of the FARG field define the number of pages to
-	 * be erased (FARG[1:0]).
-	 */
-	switch (flash->erase_size / flash->page_size) {
-	case 32:
-		farg = page | 3; /* 32 pages */
-		break;
-	case 16:
-		farg = page | 2; /* 16 pages */
-		break;
-	case 8:
-		farg = page | 1; /* 8 pages */
-		break;
-	case 4:
-		farg = page; /* 4 pages */
-		break;
-	default:
-		return -EINVAL;
-	}
+	rc = _flashd_get_erase_arg(flash, page, &farg);
+	if (rc < 0)
+		return rc;
+
+	/* drop the buffered page if it is erased */
+	if (flash->buffer.page >= page &&
+	    flash->buffer.page < page + length / flash->page_size)
+		flash->buffer.dirty = false;
 
 	cache_invalidate_region((void*)(IFLASH_ADDR + addr), flash->erase_size);
 	return eefc_perform_command(flash->eefc, EEFC_FCR_FCMD_EPA, farg);
@@ -271,49 +528,111 @@ int flashd_read(struct _flash* flash, uint32_t addr, uint8_t* data, uint32_t len
 
 	memcpy(data, (uint8_t*)(IFLASH_ADDR + addr), length);
 
+	/* return data not yet programmed from the page buffer */
+	if (flash->buffer.dirty) {
+		uint32_t start = flash->buffer.page * flash->page_size;
+		uint32_t end = start + flash->page_size;
+
+		if (addr < end && addr + length > start) {
+			uint32_t from = max_u32(addr, start);
+			uint32_t to = min_u32(addr + length, end);
+			memcpy(data + (from - addr),
+			       (uint8_t*)flash->buffer.data + (from - start),
+			       to - from);
+		}
+	}
+
 	return 0;
 }
 
 int flashd_write(struct _flash* flash, uint32_t addr, const uint8_t* data, uint32_t length)
 {
-	int i, rc = 0;
-	uint32_t offset = 0;
+	if (flash->async.busy)
+		return -EBUSY;
+
+	if ((addr + length) > flash->total_size)
+		return -EINVAL;
+
+	_flashd_start_op(flash, addr, data, length, true);
+	return _flashd_run_op(flash);
+}
+
+int flashd_write_buffered(struct _flash* flash, uint32_t addr, const uint8_t* data, uint32_t length)
+{
+	if (flash->async.busy)
+		return -EBUSY;
+
+	if ((addr + length) > flash->total_size)
+		return -EINVAL;
+
+	_flashd_start_op(flash, addr, data, length, false);
+	return _flashd_run_op(flash);
+}
+
+int flashd_flush(struct _flash* flash)
+{
+	if (flash->async.busy)
+		return -EBUSY;
+
+	_flashd_start_op(flash, 0, NULL, 0, true);
+	return _flashd_run_op(flash);
+}
+
+void flashd_set_irq_mode(struct _flash* flash, bool enable)
+{
+	assert(!flash->async.busy);
+
+	if (enable == flash->async.use_irq)
+		return;
+
+	if (enable) {
+		irq_add_handler(ID_EFC, _flashd_irq_handler, flash);
+		irq_enable(ID_EFC);
+	} else {
+		irq_disable(ID_EFC);
+		irq_remove_handler(ID_EFC, _flashd_irq_handler);
+	}
+	flash->async.use_irq = enable;
+}
+
+int flashd_write_async(struct _flash* flash, uint32_t addr, const uint8_t* data, uint32_t length, struct _callback* cb)
+{
+	if (flash->async.busy)
+		return -EBUSY;
 
 	if ((addr + length) > flash->total_size)
 		return -EINVAL;
 
+	_flashd_start_op(flash, addr, data, length, true);
+	callback_copy(&flash->async.cb, cb);
+	flash->async.status = 0;
+	flash->async.busy = true;
+
 	board_cfg_mpu_for_flash_write();
 
-	while (offset < length) {
-		/* Compute number of bytes to program in page */
-		uint32_t page = (addr + offset) / flash->page_size;
-		uint32_t page_offset = (addr + offset) - page * flash->page_size;
-		uint32_t write_size = min_u32(length - offset, flash->page_size - page_offset);
-		volatile uint32_t* flashptr = (uint32_t*)(IFLASH_ADDR + page * flash->page_size);
-
-		/* if data does not cover full page, read existing data from flash */
-		if (page_offset > 0 || write_size < flash->page_size)
-			for (i = 0; i < flash->page_size / sizeof(uint32_t); i++)
-				page_buffer[i] = flashptr[i];
-
-		/* overwrite buffer with new data to flash */
-		memcpy(((uint8_t*)page_buffer) + page_offset, data + offset, write_size);
-
-		/* copy from buffer to flash, use barriers to force write order */
-		for (i = 0; i < flash->page_size / sizeof(uint32_t); i++) {
-			flashptr[i] = page_buffer[i];
-			dsb();
-		}
+	/* FRDY is cleared once the command is started, the interrupt can be
+	 * enabled afterwards */
+	_flashd_async_next(flash);
+	if (flash->async.busy && flash->async.use_irq)
+		eefc_enable_frdy_it(flash->eefc);
 
-		/* Send "erase write page" command */
-		rc = eefc_perform_command(flash->eefc, EEFC_FCR_FCMD_WP, page);
-		if (rc < 0)
-			break;
+	return 0;
+}
 
-		offset += write_size;
+int flashd_poll(struct _flash* flash)
+{
+	int rc;
+
+	if (flash->async.busy && !flash->async.use_irq) {
+		uint32_t status = eefc_get_status(flash->eefc);
+		if (status & EEFC_FSR_FRDY)
+			_flashd_async_ready(flash, status);
 	}
 
-	board_cfg_mpu_for_flash_read();
+	if (flash->async.busy)
+		return 1;
 
+	rc = flash->async.status;
+	flash->async.status = 0;
 	return rc;
 }
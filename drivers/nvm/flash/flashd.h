@@ -30,8 +30,17 @@
 #ifndef FLASHD_H
 #define FLASHD_H
 
+#include <stdbool.h>
+
+#include "callback.h"
 #include "chip.h"
 
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+#define FLASHD_MAX_PAGE_SIZE 512
+
 /*----------------------------------------------------------------------------
  *        Type definitions
  *----------------------------------------------------------------------------*/
@@ -43,6 +52,33 @@ struct _flash {
 	uint32_t erase_size;
 	uint32_t lock_count;
 	uint32_t gpnvm_count;
+
+	/* page write buffer, keeps the last page written until it is
+	 * complete or flushed */
+	struct {
+		uint32_t page;
+		bool dirty;
+		uint32_t data[FLASHD_MAX_PAGE_SIZE / sizeof(uint32_t)];
+	} buffer;
+
+	/* write operation in progress */
+	struct {
+		uint32_t addr;
+		const uint8_t* data;
+		uint32_t length;
+		uint32_t offset;
+		uint32_t erased_end;
+		bool flush;
+		bool program;
+	} op;
+
+	/* asynchronous write state */
+	struct {
+		volatile bool busy;
+		volatile int status;
+		bool use_irq;
+		struct _callback cb;
+	} async;
 };
 
 /*----------------------------------------------------------------------------
@@ -138,7 +174,66 @@ extern int flashd_read(struct _flash* flash, uint32_t addr, uint8_t* data, uint3
  * \param data pointer to the data to write into the flash
  * \param length number of bytes to write
  * \returns 0 on success; otherwise returns a negative error code.
+ * \note Pages that are not erased are rewritten with "Erase and Write Page"
+ * in the 8 Kbytes sectors, and erase blocks entirely covered by the write are
+ * erased first. Other pages are programmed as-is (bits can only be cleared),
+ * the caller must erase them with flashd_erase_block().
  */
 extern int flashd_write(struct _flash* flash, uint32_t addr, const uint8_t* data, uint32_t length);
 
+/**
+ * \brief Write data to the flash, keeping the last page in the page buffer
+ * when it is not complete so that a following contiguous write completes it
+ * instead of programming the page twice.
+ * \param flash pointer to the flash driver structure
+ * \param addr start offset into the flash for the write operation
+ * \param data pointer to the data to write into the flash
+ * \param length number of bytes to write
+ * \returns 0 on success; otherwise returns a negative error code.
+ * \note The buffered page is programmed by flashd_flush() or by a write to
+ * another page. flashd_read() returns the buffered data.
+ */
+extern int flashd_write_buffered(struct _flash* flash, uint32_t addr, const uint8_t* data, uint32_t length);
+
+/**
+ * \brief Program the page held in the page buffer, if any.
+ * \param flash pointer to the flash driver structure
+ * \returns 0 on success; otherwise returns a negative error code.
+ */
+extern int flashd_flush(struct _flash* flash);
+
+/**
+ * \brief Select how asynchronous writes are completed: from the EEFC
+ * interrupt (FRDY) or by calling flashd_poll().
+ * \param flash pointer to the flash driver structure
+ * \param enable true to use the EEFC interrupt (the IRQ driver must be
+ *        initialized)
+ */
+extern void flashd_set_irq_mode(struct _flash* flash, bool enable);
+
+/**
+ * \brief Start writing data to the flash. The first page command is started
+ * and the function returns, the following ones are started on FRDY, from the
+ * EEFC interrupt or from flashd_poll(). The callback is called with the
+ * result (0 or a negative error code) as second argument once done.
+ * \param flash pointer to the flash driver structure
+ * \param addr start offset into the flash for the write operation
+ * \param data pointer to the data to write, must stay valid until completion
+ * \param length number of bytes to write
+ * \param cb completion callback, may be NULL
+ * \returns 0 on success; otherwise returns a negative error code.
+ * \note The flash cannot be read while a command is in progress: code and
+ * data fetched from it stall until the command completes, so only code
+ * running from SRAM/TCM (e.g. SAM-BA applets) overlaps with the write.
+ */
+extern int flashd_write_async(struct _flash* flash, uint32_t addr, const uint8_t* data, uint32_t length, struct _callback* cb);
+
+/**
+ * \brief Advance the asynchronous write in progress.
+ * \param flash pointer to the flash driver structure
+ * \returns 1 while the write is in progress, 0 when idle, or a negative error
+ * code (returned once) if the write failed.
+ */
+extern int flashd_poll(struct _flash* flash);
+
 #endif /* FLASHD_H */
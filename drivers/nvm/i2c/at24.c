@@ -67,6 +67,8 @@
 #define MCP24AA_EUI64_ADDR_OFFSET  0    /*< Offset between EEPROM and EUI64 I2C addresses */
 #define MCP24AA_EUI64_OFFSET       0xf8 /*< Read offset for EUI64 */
 
+#define AT24_WRITE_TIMEOUT         20   /*< Write cycle timeout, in ms (twice the longest tWR) */
+
 
 /*------------------------------------------------------------------------------
  *         Local constants
@@ -152,47 +154,46 @@ static int _at24_twi_read(const struct _at24* at24, uint8_t addr_offset, struct
 	return err;
 }
 
-//------------------------------------------------------------------------------
-///        Exported functions
-//------------------------------------------------------------------------------
+/*
+ * Address the EEPROM without sending data: the EEPROM does not acknowledge
+ * its address during its internal write cycle. Only the first byte of the
+ * memory address is sent, so the transfer has no side effect.
+ * Return 0 when the EEPROM is ready, -EBUSY during the write cycle.
+ */
+static int _at24_ack_poll(const struct _at24* at24, uint32_t offset)
+{
+	uint8_t addr_offset, addr_buf[2];
+	struct _buffer buf = {
+		.data = addr_buf,
+		.size = 1,
+		.attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_TX | BUS_I2C_BUF_ATTR_STOP,
+	};
+	int err;
 
-int at24_configure(struct _at24* at24, const struct _at24_config* cfg)
+	_at24_compute_address_field(at24, addr_buf, offset, &addr_offset);
+	err = bus_transfer(at24->bus, at24->addr + addr_offset, &buf, 1, NULL);
+
+	return err == -ECONNABORTED ? -EBUSY : err;
+}
+
+/* Wait for the end of the write cycle, must be called within a transaction */
+static int _at24_wait_write_cycle(const struct _at24* at24, uint32_t offset)
 {
-	int i;
-	const struct _at24_desc *desc;
-	uint8_t addr_mask;
+	uint64_t start = timer_get_tick();
+	int err;
 
-	for (i = 0, desc = NULL; i < ARRAY_SIZE(_at24_devices); i++) {
-		if (_at24_devices[i].model == cfg->model) {
-			desc = &_at24_devices[i];
-			break;
+	while ((err = _at24_ack_poll(at24, offset)) == -EBUSY) {
+		if (timer_get_interval(start, timer_get_tick()) > AT24_WRITE_TIMEOUT) {
+			trace_error("at24: write cycle timeout\r\n");
+			return -ETIMEDOUT;
 		}
 	}
-	if (!desc) {
-		trace_error("at24: unknown model %u\r\n", cfg->model);
-		return -ENOTSUP;
-	}
-
-	if (at24->desc->size == 18) {
-		addr_mask = ~4; /* A2 */
-	} else if (at24->desc->size == 17) {
-		addr_mask = ~6; /* A2 A1 */
-	} else {
-		addr_mask = ~7; /* A2 A1 A0 */
-	}
-	if ((cfg->addr & addr_mask) != AT24_EEPROM_ADDR) {
-		trace_error("at24: invalid TWI address %u\r\n", cfg->addr);
-		return -ENODEV;
-	}
-
-	at24->bus = cfg->bus;
-	at24->addr = cfg->addr;
-	at24->desc = desc;
 
-	return 0;
+	return err;
 }
 
-int at24_read(const struct _at24* at24, uint32_t offset, uint8_t* data, uint16_t length)
+/* Send one page (or less) of data, the write cycle starts on STOP */
+static int _at24_write_page(const struct _at24* at24, uint32_t offset, const uint8_t* data, uint16_t length)
 {
 	uint8_t addr_offset, addr_buf[2];
 	struct _buffer buf[2] = {
@@ -202,22 +203,21 @@ int at24_read(const struct _at24* at24, uint32_t offset, uint8_t* data, uint16_t
 			.attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_TX,
 		},
 		{
-			.data = data,
+			.data = (uint8_t*)data,
 			.size = length,
-			.attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_RX | BUS_I2C_BUF_ATTR_STOP,
+			.attr = BUS_BUF_ATTR_TX | BUS_I2C_BUF_ATTR_STOP,
 		},
 	};
 
 	/* prepare TWI bus buffers */
 	buf[0].size = _at24_compute_address_field(at24, addr_buf, offset, &addr_offset);
 
-	/* read data */
-	return _at24_twi_read(at24, addr_offset, buf);
+	/* start the TWI bus transfer */
+	return bus_transfer(at24->bus, at24->addr + addr_offset, buf, 2, NULL);
 }
 
-int at24_write(const struct _at24* at24, uint32_t offset, const uint8_t* data, uint16_t length)
+static int _at24_read(const struct _at24* at24, uint32_t offset, uint8_t* data, uint16_t length)
 {
-	const uint16_t page_size = at24->desc->page_size;
 	uint8_t addr_offset, addr_buf[2];
 	struct _buffer buf[2] = {
 		{
@@ -226,11 +226,22 @@ int at24_write(const struct _at24* at24, uint32_t offset, const uint8_t* data, u
 			.attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_TX,
 		},
 		{
-			/* .data */
-			/* .size */
-			.attr = BUS_BUF_ATTR_TX | BUS_I2C_BUF_ATTR_STOP,
+			.data = data,
+			.size = length,
+			.attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_RX | BUS_I2C_BUF_ATTR_STOP,
 		},
 	};
+
+	/* prepare TWI bus buffers */
+	buf[0].size = _at24_compute_address_field(at24, addr_buf, offset, &addr_offset);
+
+	/* read data */
+	return _at24_twi_read(at24, addr_offset, buf);
+}
+
+static int _at24_write(const struct _at24* at24, uint32_t offset, const uint8_t* data, uint32_t length)
+{
+	const uint16_t page_size = at24->desc->page_size;
 	uint16_t chunk_size;
 	int err = 0;
 
@@ -241,13 +252,12 @@ int at24_write(const struct _at24* at24, uint32_t offset, const uint8_t* data, u
 		/* compute chunk size (aligned to write page size) */
 		chunk_size = min_u32(length, page_size - (offset % page_size));
 
-		/* prepare TWI bus buffers */
-		buf[0].size = _at24_compute_address_field(at24, addr_buf, offset, &addr_offset);
-		buf[1].data = (uint8_t*)data;
-		buf[1].size = chunk_size;
+		err = _at24_write_page(at24, offset, data, chunk_size);
+		if (err < 0)
+			break;
 
-		/* start the TWI bus transfer */
-		err = bus_transfer(at24->bus, at24->addr + addr_offset, buf, 2, NULL);
+		/* wait for the write cycle to complete */
+		err = _at24_wait_write_cycle(at24, offset);
 		if (err < 0)
 			break;
 
@@ -255,9 +265,6 @@ int at24_write(const struct _at24* at24, uint32_t offset, const uint8_t* data, u
 		offset += chunk_size;
 		data += chunk_size;
 		length -= chunk_size;
-
-		/* wait 10 ms for write cycle to complete */
-		msleep(10);
 	};
 
 	/* stop transaction */
@@ -266,6 +273,306 @@ int at24_write(const struct _at24* at24, uint32_t offset, const uint8_t* data, u
 	return err;
 }
 
+/* Copy the overlapping part of [offset, offset + length) between the user
+ * buffer and the cached page */
+static void _at24_cache_copy(const struct _at24_cache_line* line, uint16_t page_size,
+		uint32_t offset, uint8_t* data, uint32_t length, bool to_line)
+{
+	uint32_t start = max_u32(offset, line->page);
+	uint32_t end = min_u32(offset + length, line->page + page_size);
+
+	if (!line->valid || start >= end)
+		return;
+
+	if (to_line)
+		memcpy(&line->data[start - line->page], &data[start - offset], end - start);
+	else
+		memcpy(&data[start - offset], &line->data[start - line->page], end - start);
+}
+
+static int _at24_cache_flush_line(struct _at24* at24, struct _at24_cache_line* line)
+{
+	int err;
+
+	if (!line->valid || !line->end)
+		return 0;
+
+	err = _at24_write(at24, line->page + line->start, &line->data[line->start], line->end - line->start);
+	if (err < 0)
+		return err;
+
+	line->start = 0;
+	line->end = 0;
+	return 0;
+}
+
+static struct _at24_cache_line* _at24_cache_get_line(struct _at24* at24, uint32_t page, bool load)
+{
+	struct _at24_cache_line *line, *victim = NULL;
+	int i;
+
+	for (i = 0; i < at24->cache.count; i++) {
+		line = &at24->cache.lines[i];
+		if (line->valid && line->page == page)
+			goto found;
+		if (!victim || !line->valid ||
+		    (victim->valid && line->last_use < victim->last_use))
+			victim = line;
+	}
+
+	/* replace the least recently used page */
+	line = victim;
+	if (_at24_cache_flush_line(at24, line) < 0)
+		return NULL;
+	line->valid = false;
+	if (load && _at24_read(at24, page, line->data, at24->desc->page_size) < 0)
+		return NULL;
+	line->page = page;
+	line->start = 0;
+	line->end = 0;
+	line->valid = true;
+
+found:
+	line->last_use = ++at24->cache.clock;
+	return line;
+}
+
+static int _at24_async_next(struct _at24* at24)
+{
+	const uint16_t page_size = at24->desc->page_size;
+	uint16_t chunk_size;
+	int err;
+
+	chunk_size = min_u32(at24->async.length, page_size - (at24->async.next % page_size));
+
+	bus_start_transaction(at24->bus);
+	err = _at24_write_page(at24, at24->async.next, at24->async.data, chunk_size);
+	bus_stop_transaction(at24->bus);
+	if (err < 0)
+		return err;
+
+	at24->async.busy = true;
+	at24->async.offset = at24->async.next;
+	at24->async.start = timer_get_tick();
+	at24->async.next += chunk_size;
+	at24->async.data += chunk_size;
+	at24->async.length -= chunk_size;
+
+	return 0;
+}
+
+static void _at24_async_complete(struct _at24* at24, int err)
+{
+	struct _callback cb;
+
+	/* the callback may start the next write */
+	callback_copy(&cb, &at24->async.cb);
+	at24->async.busy = false;
+	at24->async.length = 0;
+	callback_call(&cb, (void*)err);
+}
+
+//------------------------------------------------------------------------------
+///        Exported functions
+//------------------------------------------------------------------------------
+
+int at24_configure(struct _at24* at24, const struct _at24_config* cfg)
+{
+	int i;
+	const struct _at24_desc *desc;
+	uint8_t addr_mask;
+
+	for (i = 0, desc = NULL; i < ARRAY_SIZE(_at24_devices); i++) {
+		if (_at24_devices[i].model == cfg->model) {
+			desc = &_at24_devices[i];
+			break;
+		}
+	}
+	if (!desc) {
+		trace_error("at24: unknown model %u\r\n", cfg->model);
+		return -ENOTSUP;
+	}
+
+	if (desc->size == 18) {
+		addr_mask = ~4; /* A2 */
+	} else if (desc->size == 17) {
+		addr_mask = ~6; /* A2 A1 */
+	} else {
+		addr_mask = ~7; /* A2 A1 A0 */
+	}
+	if ((cfg->addr & addr_mask) != AT24_EEPROM_ADDR) {
+		trace_error("at24: invalid TWI address %u\r\n", cfg->addr);
+		return -ENODEV;
+	}
+
+	at24->bus = cfg->bus;
+	at24->addr = cfg->addr;
+	at24->desc = desc;
+	memset(&at24->async, 0, sizeof(at24->async));
+	memset(&at24->cache, 0, sizeof(at24->cache));
+
+	return 0;
+}
+
+int at24_read(const struct _at24* at24, uint32_t offset, uint8_t* data, uint16_t length)
+{
+	int i, err;
+
+	if (at24->async.busy)
+		return -EBUSY;
+
+	err = _at24_read(at24, offset, data, length);
+	if (err < 0)
+		return err;
+
+	/* cached pages may hold data not written yet */
+	for (i = 0; i < at24->cache.count; i++)
+		_at24_cache_copy(&at24->cache.lines[i], at24->desc->page_size, offset, data, length, false);
+
+	return 0;
+}
+
+int at24_write(const struct _at24* at24, uint32_t offset, const uint8_t* data, uint16_t length)
+{
+	int i;
+
+	if (at24->async.busy)
+		return -EBUSY;
+
+	/* keep the cached pages coherent */
+	for (i = 0; i < at24->cache.count; i++)
+		_at24_cache_copy(&at24->cache.lines[i], at24->desc->page_size, offset, (uint8_t*)data, length, true);
+
+	return _at24_write(at24, offset, data, length);
+}
+
+int at24_write_async(struct _at24* at24, uint32_t offset, const uint8_t* data, uint32_t length, struct _callback* cb)
+{
+	int i, err;
+
+	if (at24->async.busy)
+		return -EBUSY;
+	if (!length)
+		return -EINVAL;
+
+	for (i = 0; i < at24->cache.count; i++)
+		_at24_cache_copy(&at24->cache.lines[i], at24->desc->page_size, offset, (uint8_t*)data, length, true);
+
+	at24->async.next = offset;
+	at24->async.data = data;
+	at24->async.length = length;
+	callback_copy(&at24->async.cb, cb);
+
+	err = _at24_async_next(at24);
+	if (err < 0)
+		at24->async.length = 0;
+	return err;
+}
+
+int at24_poll(struct _at24* at24)
+{
+	int err;
+
+	if (!at24->async.busy)
+		return 0;
+
+	bus_start_transaction(at24->bus);
+	err = _at24_ack_poll(at24, at24->async.offset);
+	bus_stop_transaction(at24->bus);
+
+	if (err == -EBUSY) {
+		if (timer_get_interval(at24->async.start, timer_get_tick()) <= AT24_WRITE_TIMEOUT)
+			return 1;
+		err = -ETIMEDOUT;
+	}
+
+	if (err == 0 && at24->async.length) {
+		err = _at24_async_next(at24);
+		if (err == 0)
+			return 1;
+	}
+
+	_at24_async_complete(at24, err);
+	return err;
+}
+
+int at24_set_cache(struct _at24* at24, uint8_t* buffer, uint32_t size)
+{
+	int i, err;
+
+	err = at24_flush(at24);
+	if (err < 0)
+		return err;
+
+	at24->cache.count = 0;
+	if (buffer)
+		at24->cache.count = min_u32(size / at24->desc->page_size, AT24_CACHE_LINES);
+
+	for (i = 0; i < at24->cache.count; i++) {
+		struct _at24_cache_line* line = &at24->cache.lines[i];
+
+		line->valid = false;
+		line->start = 0;
+		line->end = 0;
+		line->data = &buffer[i * at24->desc->page_size];
+	}
+
+	return 0;
+}
+
+int at24_write_cached(struct _at24* at24, uint32_t offset, const uint8_t* data, uint32_t length)
+{
+	const uint16_t page_size = at24->desc->page_size;
+	struct _at24_cache_line* line;
+	uint16_t start, end;
+
+	if (at24->async.busy)
+		return -EBUSY;
+	if (!at24->cache.count)
+		return _at24_write(at24, offset, data, length);
+
+	while (length) {
+		start = offset % page_size;
+		end = min_u32(page_size, start + length);
+
+		/* no need to read the page if it is fully overwritten */
+		line = _at24_cache_get_line(at24, offset - start, end - start < page_size);
+		if (!line)
+			return -EIO;
+
+		memcpy(&line->data[start], data, end - start);
+		if (line->end) {
+			line->start = min_u32(line->start, start);
+			line->end = max_u32(line->end, end);
+		} else {
+			line->start = start;
+			line->end = end;
+		}
+
+		offset += end - start;
+		data += end - start;
+		length -= end - start;
+	}
+
+	return 0;
+}
+
+int at24_flush(struct _at24* at24)
+{
+	int i, err;
+
+	if (at24->async.busy)
+		return -EBUSY;
+
+	for (i = 0; i < at24->cache.count; i++) {
+		err = _at24_cache_flush_line(at24, &at24->cache.lines[i]);
+		if (err < 0)
+			return err;
+	}
+
+	return 0;
+}
+
 bool at24_has_serial(const struct _at24* at24)
 {
 	return at24->desc->family == AT24CS ||
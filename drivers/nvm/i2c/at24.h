@@ -36,8 +36,11 @@
  *         Headers
  *----------------------------------------------------------------------------*/
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "callback.h"
+
 /*----------------------------------------------------------------------------
  *         Global definitions
  *----------------------------------------------------------------------------*/
@@ -46,6 +49,8 @@
 #define EUI48_LENGTH  6
 #define EUI64_LENGTH  8
 
+#define AT24_CACHE_LINES 4
+
 enum _at24_model {
 	AT24C01,
 	AT24C02,
@@ -102,10 +107,37 @@ struct _at24_config {
 	enum _at24_model model;
 };
 
+struct _at24_cache_line {
+	uint32_t page;      /* offset of the cached page */
+	uint16_t start;     /* offset of the first dirty byte in the page */
+	uint16_t end;       /* offset of the last dirty byte + 1, 0 if clean */
+	uint32_t last_use;  /* value of the cache clock at the last access */
+	bool valid;
+	uint8_t* data;      /* page content, page_size bytes */
+};
+
 struct _at24 {
 	uint8_t bus;
 	uint8_t addr;
 	const struct _at24_desc *desc;
+
+	/* asynchronous write state */
+	struct {
+		bool busy;           /* a write cycle is in progress */
+		uint32_t offset;     /* offset of the page being written */
+		uint32_t next;       /* offset of the next data to write */
+		const uint8_t* data; /* next data to write */
+		uint32_t length;     /* remaining length to write */
+		uint64_t start;      /* tick of the start of the write cycle */
+		struct _callback cb;
+	} async;
+
+	/* write-back page cache */
+	struct {
+		uint8_t count;       /* number of lines, 0 when disabled */
+		uint32_t clock;
+		struct _at24_cache_line lines[AT24_CACHE_LINES];
+	} cache;
 };
 
 /*----------------------------------------------------------------------------
@@ -115,6 +147,47 @@ struct _at24 {
 extern int at24_configure(struct _at24* at24, const struct _at24_config* cfg);
 extern int at24_read(const struct _at24* at24, uint32_t offset, uint8_t* data, uint16_t length);
 extern int at24_write(const struct _at24* at24, uint32_t offset, const uint8_t* data, uint16_t length);
+
+/**
+ * \brief Start writing data to the EEPROM without waiting for the write cycles
+ *
+ * The first page is sent to the EEPROM, the next pages are sent by
+ * at24_poll() when the EEPROM acknowledges its address again. The data must
+ * remain valid until the callback is called with the status of the write
+ * (0 or -errno) as second argument.
+ *
+ * \return 0 on success, -EBUSY if an asynchronous write is in progress,
+ * or another negative error code
+ */
+extern int at24_write_async(struct _at24* at24, uint32_t offset, const uint8_t* data, uint32_t length, struct _callback* cb);
+
+/**
+ * \brief Make progress on the asynchronous write
+ *
+ * \return 1 while the write is in progress, 0 when idle, or a negative
+ * error code if the write failed
+ */
+extern int at24_poll(struct _at24* at24);
+
+/**
+ * \brief Setup the write-back page cache used by at24_write_cached()
+ *
+ * The buffer is split into up to AT24_CACHE_LINES pages. Dirty pages are
+ * flushed before the cache is changed, a NULL buffer disables the cache.
+ */
+extern int at24_set_cache(struct _at24* at24, uint8_t* buffer, uint32_t size);
+
+/**
+ * \brief Write data to the page cache, repeated updates of a cached page are
+ * merged into a single EEPROM page write when the page is evicted or flushed
+ */
+extern int at24_write_cached(struct _at24* at24, uint32_t offset, const uint8_t* data, uint32_t length);
+
+/**
+ * \brief Write the dirty pages of the cache to the EEPROM
+ */
+extern int at24_flush(struct _at24* at24);
+
 extern bool at24_has_serial(const struct _at24* at24);
 extern bool at24_read_serial(const struct _at24* at24, uint8_t* serial);
 extern bool at24_has_eui48(const struct _at24* at24);
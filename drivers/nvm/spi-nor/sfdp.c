@@ -69,6 +69,7 @@ struct sfdp_parameter_header {
 
 
 #define SFDP_BFPT_ID		0xff00u	/* Basic Flash Parameter Table */
+#define SFDP_SECTOR_MAP_ID	0xff81u	/* Sector Map Parameter Table */
 #define SFDP_4BAIT_ID		0xff84u	/* 4-byte Address Instruction Table */
 
 #define SFDP_SIGNATURE		0x50444653u
@@ -133,9 +134,35 @@ enum sfdp_bfpt_dword {
 #define BFPT_DWORD5_FAST_READ_2_2_2      (0x1UL << 0)
 #define BFPT_DWORD5_FAST_READ_4_4_4      (0x1UL << 4)
 
+/* 10th DWORD. */
+#define BFPT_DWORD10_ERASE_TIME_SHIFT(i) (4 + 7 * (i))
+#define BFPT_DWORD10_ERASE_TIME_COUNT    (0x1FUL << 0)
+#define BFPT_DWORD10_ERASE_TIME_UNIT     (0x3UL << 5)
+
 /* 11th DWORD. */
 #define BFPT_DWORD11_PAGE_SIZE_SHIFT     4
 #define BFPT_DWORD11_PAGE_SIZE_MASK      (0xFUL << 4)
+#define BFPT_DWORD11_PP_TIME_COUNT_SHIFT 8
+#define BFPT_DWORD11_PP_TIME_COUNT_MASK  (0x1FUL << 8)
+#define BFPT_DWORD11_PP_TIME_UNIT_64US   (0x1UL << 13)
+#define BFPT_DWORD11_CHIP_ERASE_COUNT_SHIFT 24
+#define BFPT_DWORD11_CHIP_ERASE_COUNT_MASK  (0x1FUL << 24)
+#define BFPT_DWORD11_CHIP_ERASE_UNIT_SHIFT  29
+#define BFPT_DWORD11_CHIP_ERASE_UNIT_MASK   (0x3UL << 29)
+
+/* 12th DWORD. */
+#define BFPT_DWORD12_RESUME_INTERVAL_SHIFT 20
+#define BFPT_DWORD12_RESUME_INTERVAL_MASK  (0xFUL << 20)
+#define BFPT_DWORD12_SUSPEND_LATENCY_SHIFT 24
+#define BFPT_DWORD12_SUSPEND_LATENCY_COUNT (0x1FUL << 24)
+#define BFPT_DWORD12_SUSPEND_LATENCY_UNIT  (0x3UL << 29)
+#define BFPT_DWORD12_NO_SUSPEND            (0x1UL << 31)
+
+/* 13th DWORD. */
+#define BFPT_DWORD13_PROGRAM_RESUME_SHIFT  0
+#define BFPT_DWORD13_PROGRAM_SUSPEND_SHIFT 8
+#define BFPT_DWORD13_ERASE_RESUME_SHIFT    16
+#define BFPT_DWORD13_ERASE_SUSPEND_SHIFT   24
 
 /* 15th DWORD. */
 
@@ -389,6 +416,57 @@ static int spi_flash_parse_bfpt(struct spi_flash *flash,
 	params->page_size >>= BFPT_DWORD11_PAGE_SIZE_SHIFT;
 	params->page_size = (0x1UL << params->page_size);
 
+	/* Typical Sector Erase times: (count + 1) * 1ms/16ms/128ms/1s. */
+	for (i = 0; i < SFLASH_CMD_ERASE_MAX; i++) {
+		static const uint32_t units[] = { 1000, 16000, 128000, 1000000 };
+		uint32_t field = bfpt.dwords[BFPT_DWORD10] >> BFPT_DWORD10_ERASE_TIME_SHIFT(i);
+		uint32_t count = field & BFPT_DWORD10_ERASE_TIME_COUNT;
+		uint32_t unit = (field & BFPT_DWORD10_ERASE_TIME_UNIT) >> 5;
+
+		if (map->commands[i].size)
+			map->commands[i].typ_time = (count + 1) * units[unit];
+	}
+
+	/* Typical Page Program time: (count + 1) * 8us/64us. */
+	flash->page_program_time =
+		((bfpt.dwords[BFPT_DWORD11] & BFPT_DWORD11_PP_TIME_COUNT_MASK)
+		 >> BFPT_DWORD11_PP_TIME_COUNT_SHIFT) + 1;
+	flash->page_program_time *=
+		(bfpt.dwords[BFPT_DWORD11] & BFPT_DWORD11_PP_TIME_UNIT_64US) ? 64 : 8;
+
+	/* Typical Chip Erase time: (count + 1) * 16ms/256ms/4s/64s. */
+	{
+		static const uint32_t units[] = { 16000, 256000, 4000000, 64000000 };
+		uint32_t dword11 = bfpt.dwords[BFPT_DWORD11];
+
+		spi_flash_set_erase_command(&map->chip, params->size, SFLASH_INST_ERASE_CHIP);
+		map->chip.typ_time =
+			(((dword11 & BFPT_DWORD11_CHIP_ERASE_COUNT_MASK)
+			  >> BFPT_DWORD11_CHIP_ERASE_COUNT_SHIFT) + 1) *
+			units[(dword11 & BFPT_DWORD11_CHIP_ERASE_UNIT_MASK)
+			      >> BFPT_DWORD11_CHIP_ERASE_UNIT_SHIFT];
+	}
+
+	/* Program/Erase Suspend and Resume. */
+	if (!(bfpt.dwords[BFPT_DWORD12] & BFPT_DWORD12_NO_SUSPEND)) {
+		static const uint32_t units[] = { 1, 1, 8, 64 }; /* 128ns rounded up */
+		uint32_t dword12 = bfpt.dwords[BFPT_DWORD12];
+		uint32_t dword13 = bfpt.dwords[BFPT_DWORD13];
+
+		flash->program_resume_inst = dword13 >> BFPT_DWORD13_PROGRAM_RESUME_SHIFT;
+		flash->program_suspend_inst = dword13 >> BFPT_DWORD13_PROGRAM_SUSPEND_SHIFT;
+		flash->erase_resume_inst = dword13 >> BFPT_DWORD13_ERASE_RESUME_SHIFT;
+		flash->erase_suspend_inst = dword13 >> BFPT_DWORD13_ERASE_SUSPEND_SHIFT;
+		flash->suspend_latency =
+			(((dword12 & BFPT_DWORD12_SUSPEND_LATENCY_COUNT)
+			  >> BFPT_DWORD12_SUSPEND_LATENCY_SHIFT) + 1) *
+			units[(dword12 & BFPT_DWORD12_SUSPEND_LATENCY_UNIT) >> 29];
+		flash->resume_interval =
+			(((dword12 & BFPT_DWORD12_RESUME_INTERVAL_MASK)
+			  >> BFPT_DWORD12_RESUME_INTERVAL_SHIFT) + 1) * 64;
+		flash->flags |= SFLASH_FLG_HAS_SUSPEND;
+	}
+
 	/* Enable Quad I/O. */
 	switch (bfpt.dwords[BFPT_DWORD15] & BFPT_DWORD15_QER_MASK) {
 	default:
@@ -428,6 +506,156 @@ static int spi_flash_parse_bfpt(struct spi_flash *flash,
 	return 0;
 }
 
+/* Sector Map Parameter Table */
+
+/*
+ * (from JESD216B)
+ * The Sector Map Parameter Table is a sequence of descriptors:
+ * - zero or more Configuration Detection Command descriptors (2 DWORDs each):
+ *   the bit selected by the read data mask in the byte returned by each
+ *   command gives one bit of the current configuration ID, the first command
+ *   giving the most significant bit,
+ * - one or more Sector Map descriptors (1 header DWORD followed by one DWORD
+ *   per region), the last descriptor of the table has the End bit set.
+ */
+#define SMPT_MAX_DWORDS                  64
+
+#define SMPT_DESC_END                    (0x1UL << 0)
+#define SMPT_DESC_MAP                    (0x1UL << 1)
+
+#define SMPT_CMD_INST(dw)                (((dw) >> 8) & 0xFFu)
+#define SMPT_CMD_READ_LATENCY(dw)        (((dw) >> 16) & 0xFu)
+#define SMPT_CMD_READ_LATENCY_VARIABLE   0xFu
+#define SMPT_CMD_ADDR_LEN(dw)            (((dw) >> 22) & 0x3u)
+#define SMPT_CMD_ADDR_LEN_0              0x0u
+#define SMPT_CMD_ADDR_LEN_3              0x1u
+#define SMPT_CMD_ADDR_LEN_4              0x2u
+#define SMPT_CMD_ADDR_LEN_VARIABLE       0x3u
+#define SMPT_CMD_READ_DATA_MASK(dw)      (((dw) >> 24) & 0xFFu)
+
+#define SMPT_MAP_ID(dw)                  (((dw) >> 8) & 0xFFu)
+#define SMPT_MAP_REGION_COUNT(dw)        ((((dw) >> 16) & 0xFFu) + 1)
+
+#define SMPT_REGION_CMD_MASK(dw)         ((dw) & 0xFu)
+#define SMPT_REGION_SIZE(dw)             (((((dw) >> 8) & 0xFFFFFFu) + 1) * 256)
+
+static uint32_t smpt[SMPT_MAX_DWORDS];
+
+static int spi_flash_smpt_read_config(struct spi_flash *flash, uint32_t desc, uint32_t addr, uint8_t *data)
+{
+	struct spi_flash_command cmd;
+	uint8_t addr_len, latency;
+
+	switch (SMPT_CMD_ADDR_LEN(desc)) {
+	case SMPT_CMD_ADDR_LEN_0:
+		addr_len = 0;
+		break;
+	case SMPT_CMD_ADDR_LEN_4:
+		addr_len = 4;
+		break;
+	case SMPT_CMD_ADDR_LEN_3:
+	case SMPT_CMD_ADDR_LEN_VARIABLE:
+	default:
+		/* the address mode is not switched yet while parsing SFDP */
+		addr_len = 3;
+		break;
+	}
+
+	latency = SMPT_CMD_READ_LATENCY(desc);
+	if (latency == SMPT_CMD_READ_LATENCY_VARIABLE)
+		latency = 8;
+
+	spi_flash_command_init(&cmd, SMPT_CMD_INST(desc), addr_len, SFLASH_TYPE_READ);
+	cmd.proto = flash->read_proto;
+	cmd.addr = addr;
+	cmd.num_wait_states = latency;
+	cmd.data_len = 1;
+	cmd.rx_data = data;
+	return spi_flash_exec(flash, &cmd);
+}
+
+static int spi_flash_parse_smpt(struct spi_flash *flash,
+				const struct sfdp_parameter_header *smpt_header,
+				const struct spi_flash_parameters *params)
+{
+	struct spi_flash_erase_map *map = &flash->erase_map;
+	uint32_t len, i, r, count, mask;
+	uint64_t offset;
+	uint8_t config_id = 0, data;
+	bool detect = false;
+	int rc;
+
+	/* Read the Sector Map Parameter Table. */
+	len = min_u32(ARRAY_SIZE(smpt), smpt_header->length);
+	rc = spi_flash_read_sfdp(flash, SFDP_PARAM_HEADER_PTP(smpt_header),
+				 len * sizeof(uint32_t), smpt);
+	if (rc < 0)
+		return rc;
+
+	/* Run the Configuration Detection commands. */
+	for (i = 0; i < len && !(smpt[i] & SMPT_DESC_MAP); i += 2) {
+		if (i + 1 >= len)
+			return -EINVAL;
+
+		rc = spi_flash_smpt_read_config(flash, smpt[i], smpt[i + 1], &data);
+		if (rc < 0)
+			return rc;
+
+		config_id <<= 1;
+		if (data & SMPT_CMD_READ_DATA_MASK(smpt[i]))
+			config_id |= 1;
+		detect = true;
+	}
+
+	/* Find the Sector Map of the current configuration. */
+	for (; i < len; i += 1 + SMPT_MAP_REGION_COUNT(smpt[i])) {
+		if (!(smpt[i] & SMPT_DESC_MAP))
+			return -EINVAL;
+		if (!detect || SMPT_MAP_ID(smpt[i]) == config_id)
+			break;
+		if (smpt[i] & SMPT_DESC_END)
+			return -EINVAL;
+	}
+	if (i >= len)
+		return -EINVAL;
+
+	count = SMPT_MAP_REGION_COUNT(smpt[i]);
+	if (count > SFLASH_ERASE_MAX_REGIONS)
+		return -ENOTSUP;
+	if (i + count >= len)
+		return -EINVAL;
+
+	/* Only keep the erase types also described in the BFPT. */
+	mask = map->uniform_region.cmd_mask;
+
+	/* Check the regions cover the whole memory before replacing the map. */
+	offset = 0;
+	for (r = 0; r < count; r++)
+		offset += SMPT_REGION_SIZE(smpt[i + 1 + r]);
+	if (offset != params->size)
+		return -EINVAL;
+
+	offset = 0;
+	for (r = 0; r < count; r++) {
+		struct spi_flash_erase_region *region = &map->region_table[r];
+		uint32_t desc = smpt[i + 1 + r];
+
+		region->cmd_mask = SMPT_REGION_CMD_MASK(desc) & mask;
+		region->offset = offset;
+		region->size = SMPT_REGION_SIZE(desc);
+		offset += region->size;
+	}
+
+	if (count > 1) {
+		map->regions = map->region_table;
+		map->num_regions = count;
+	} else {
+		map->uniform_region.cmd_mask = map->region_table[0].cmd_mask;
+	}
+
+	return 0;
+}
+
 static struct sfdp_header header;
 static struct sfdp_parameter_header param_header;
 
@@ -494,6 +722,11 @@ int spi_flash_parse_sfdp(struct spi_flash *flash, struct spi_flash_parameters *p
 			goto exit;
 
 		switch (SFDP_PARAM_HEADER_ID(&param_header)) {
+		case SFDP_SECTOR_MAP_ID:
+			/* Keep the uniform erase map if the table is unusable. */
+			spi_flash_parse_smpt(flash, &param_header, params);
+			break;
+
 		default:
 			break;
 		}
@@ -73,7 +73,15 @@ int spi_flash_write_reg(struct spi_flash *flash, uint8_t inst, const uint8_t *bu
 	return spi_flash_exec(flash, &cmd);
 }
 
-static int spi_flash_is_ready(struct spi_flash *flash)
+static void spi_flash_delay(uint32_t us)
+{
+	if (us >= 1000)
+		msleep(us / 1000);
+	else if (us)
+		timer_delay_us(us);
+}
+
+int spi_flash_is_ready(struct spi_flash *flash)
 {
 	uint8_t sr, fsr;
 	int rc;
@@ -95,25 +103,43 @@ static int spi_flash_is_ready(struct spi_flash *flash)
 	return (fsr & FSR_READY) != 0;
 }
 
-int spi_flash_wait_till_ready_timeout(struct spi_flash *flash, unsigned long timeout)
+int spi_flash_wait_till_ready_typ(struct spi_flash *flash, uint32_t typ_time, unsigned long timeout)
 {
-	unsigned long delay = 1L; /* 1ms */
-	unsigned long loop = (timeout + delay - 1) / (delay);
+	struct _timeout to;
+	uint32_t delay, max_delay;
 	int rc;
 
-	if (!loop)
-		loop = 1;
-	while (loop-- > 0) {
+	timer_start_timeout(&to, timeout ? timeout : 1);
+
+	/* Nothing to expect before half of the typical time. */
+	spi_flash_delay(typ_time / 2);
+
+	/*
+	 * Then back off exponentially, but keep the overshoot within a quarter
+	 * of the typical time so that short operations (page programs) do not
+	 * pay for a full timer tick.
+	 */
+	delay = max_u32(typ_time / 16, SFLASH_POLL_MIN_DELAY);
+	max_delay = SFLASH_POLL_MAX_DELAY;
+	if (typ_time)
+		max_delay = min_u32(max_u32(typ_time / 4, delay), max_delay);
+	for (;;) {
 		rc = spi_flash_is_ready(flash);
 		if (rc < 0)
 			return rc;
 		if (rc)
 			return 0;
+		if (timer_timeout_reached(&to))
+			return -ETIMEDOUT;
 
-		msleep(delay);
+		spi_flash_delay(delay);
+		delay = min_u32(delay * 2, max_delay);
 	}
+}
 
-	return -ETIMEDOUT;
+int spi_flash_wait_till_ready_timeout(struct spi_flash *flash, unsigned long timeout)
+{
+	return spi_flash_wait_till_ready_typ(flash, 0, timeout);
 }
 
 int spi_flash_hwcaps2cmd(uint32_t hwcaps)
@@ -261,6 +287,14 @@ void spi_flash_set_erase_command(struct spi_flash_erase_command *cmd, size_t siz
 	cmd->size = size;
 	cmd->inst = inst;
 
+	/* Conservative typical erase time, refined from SFDP when available. */
+	if (size <= 4096)
+		cmd->typ_time = 40000;
+	else if (size <= 32768)
+		cmd->typ_time = 120000;
+	else
+		cmd->typ_time = 200000;
+
 	if (IS_POWER_OF_TWO(cmd->size))
 		cmd->size_shift = fls(cmd->size) - 1;
 	else
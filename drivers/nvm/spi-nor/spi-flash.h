@@ -36,6 +36,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "callback.h"
 #include "compiler.h"
 #include "intmath.h"
 #include "peripherals/bus.h"
@@ -99,6 +100,13 @@
 #define SFLASH_INST_ERASE_4K  0x20
 #define SFLASH_INST_ERASE_32K 0x52
 #define SFLASH_INST_ERASE_64K 0xD8
+#define SFLASH_INST_ERASE_CHIP 0x60
+
+/**
+ * Suspend/resume instructions.
+ */
+#define SFLASH_INST_SUSPEND 0x75
+#define SFLASH_INST_RESUME  0x7A
 
 /**
  * 4-byte address instruction set.
@@ -176,6 +184,7 @@
 	 SFLASH_PROTO_DATA(data_nbits))
 
 #define SFLASH_CMD_ERASE_MAX	4
+#define SFLASH_ERASE_MAX_REGIONS 8
 #define SFLASH_CMD_ERASE_MASK	0xFULL
 #define SFLASH_CMD_ERASE_OFFSET(_cmd_mask, _offset)		\
 	((((uint64_t)(_offset)) & ~SFLASH_CMD_ERASE_MASK) |	\
@@ -236,7 +245,12 @@ enum spi_flash_protocol {
 #define SFLASH_TYPE_READ_REG	(0x3UL << 0)
 #define SFLASH_TYPE_WRITE_REG	(0x4UL << 0)
 
-#define SFLASH_FLG_HAS_FSR (0x1UL << 0)
+#define SFLASH_FLG_HAS_FSR     (0x1UL << 0)
+#define SFLASH_FLG_HAS_SUSPEND (0x1UL << 1)
+
+/* Status polling delays, in microseconds */
+#define SFLASH_POLL_MIN_DELAY  4
+#define SFLASH_POLL_MAX_DELAY  1000
 
 /*----------------------------------------------------------------------------
  *        Exported Typedefs
@@ -282,12 +296,14 @@ struct spi_flash_command {
  * @size_shift:		the size shift: if @size is a power of 2 then the shift
  *			is stored in @size_shift, otherwise @size_shift is zero.
  * @size_mask:		the size mask based on @size_shift.
+ * @typ_time:		the typical erase time, in microseconds.
  * @inst:		the SPI command op code to erase the sector/block.
  */
 struct spi_flash_erase_command {
 	uint32_t size;
 	uint32_t size_shift;
 	uint32_t size_mask;
+	uint32_t typ_time;
 	uint8_t	inst;
 };
 
@@ -308,15 +324,20 @@ struct spi_flash_erase_region {
 /**
  * struct spi_flash_erase_map - Structure to describe the SPI FLASH erase map
  * @commands:		an array of erase commands shared by all the regions.
+ * @chip:		the chip erase command, its @typ_time is zero when unknown.
  * @uniform_region:	a pre-allocated erase region for SPI FLASH with a uniform
  *			sector size (legacy implementation).
+ * @region_table:	pre-allocated erase regions for SPI FLASH with a non
+ *			uniform sector map (from the SFDP Sector Map table).
  * @regions:		point to an array describing the boundaries of the erase
  *			regions.
  * @num_regions:	the number of elements in the @regions array.
  */
 struct spi_flash_erase_map {
 	struct spi_flash_erase_command commands[SFLASH_CMD_ERASE_MAX];
+	struct spi_flash_erase_command chip;
 	struct spi_flash_erase_region uniform_region;
+	struct spi_flash_erase_region region_table[SFLASH_ERASE_MAX_REGIONS];
 	struct spi_flash_erase_region *regions;
 	uint32_t num_regions;
 };
@@ -357,6 +378,32 @@ struct spi_flash_hwcaps {
 	uint32_t mask;
 };
 
+/**
+ * struct spi_flash_async - State of an asynchronous write or erase
+ * @type:		SFLASH_TYPE_WRITE or SFLASH_TYPE_ERASE, 0 when idle.
+ * @suspended:		The operation in progress is suspended.
+ * @addr:		Address of the page/sector being programmed/erased.
+ * @size:		Size of the page/sector being programmed/erased.
+ * @to:			Next address to program/erase.
+ * @buf:		Next data to program.
+ * @len:		Remaining length.
+ * @start:		Tick at which the operation in progress was started.
+ * @typ_time:		Typical time of the operation in progress, in us.
+ * @cb:			Completion callback, called with the result.
+ */
+struct spi_flash_async {
+	uint8_t type;
+	bool suspended;
+	size_t addr;
+	size_t size;
+	size_t to;
+	const uint8_t *buf;
+	size_t len;
+	uint64_t start;
+	uint32_t typ_time;
+	struct _callback cb;
+};
+
 /**
  * struct spi_flash - Structure to describe some SPI flash memory
  * @priv:		The private data.
@@ -373,6 +420,15 @@ struct spi_flash_hwcaps {
  * @size:		The total SPI flash size (in bytes).
  * @page_size:		The page size (in bytes).
  * @erase_map:		The erase map of the SPI flash.
+ * @page_program_time:	The typical page program time, in microseconds.
+ * @program_suspend_inst: The Program Suspend instruction opcode.
+ * @program_resume_inst: The Program Resume instruction opcode.
+ * @erase_suspend_inst:	The Erase Suspend instruction opcode.
+ * @erase_resume_inst:	The Erase Resume instruction opcode.
+ * @suspend_latency:	The maximum suspend latency, in microseconds.
+ * @resume_interval:	The minimum time between a resume and the next
+ *			suspend, in microseconds.
+ * @async:		The asynchronous write/erase state.
  * @ops:		[DRIVER-SPECIFIC] The SPI controller interface.
  * @read:		[FLASH-SPECIFIC] Read data from the SPI flash.
  * @write:		[FLASH-SPECIFIC] Write data into the SPI flash.
@@ -402,6 +458,15 @@ struct spi_flash {
 	size_t page_size;
 	struct spi_flash_erase_map erase_map;
 
+	uint32_t page_program_time;
+	uint8_t program_suspend_inst;
+	uint8_t program_resume_inst;
+	uint8_t erase_suspend_inst;
+	uint8_t erase_resume_inst;
+	uint32_t suspend_latency;
+	uint32_t resume_interval;
+	struct spi_flash_async async;
+
 	const struct spi_ops *ops;
 
 #ifdef CONFIG_HAVE_AESB
@@ -464,6 +529,25 @@ extern int spi_flash_read_reg(struct spi_flash *flash, uint8_t inst, uint8_t *bu
 extern int spi_flash_write_reg(struct spi_flash *flash, uint8_t inst, const uint8_t *buf, size_t len);
 extern int spi_flash_wait_till_ready_timeout(struct spi_flash *flash, unsigned long timeout);
 
+/**
+ * Wait for the end of an operation whose typical duration is known: sleep
+ * for half of it, then poll the status with a delay starting at 1/16th of it
+ * and doubling up to 1/4th of it (or 1 ms).
+ *
+ * @flash:		Pointer to the SPI flash.
+ * @typ_time:		Typical duration of the operation in microseconds, 0 if
+ *			unknown.
+ * @timeout:		Timeout in milliseconds.
+ */
+extern int spi_flash_wait_till_ready_typ(struct spi_flash *flash, uint32_t typ_time, unsigned long timeout);
+
+/**
+ * Read the status of the SPI flash.
+ *
+ * Return: 1 if ready, 0 if busy, negative error code otherwise.
+ */
+extern int spi_flash_is_ready(struct spi_flash *flash);
+
 extern int spi_flash_setup(struct spi_flash *flash, const struct spi_flash_parameters *params);
 
 extern int spi_flash_read_sr(struct spi_flash *flash, uint8_t *sr);
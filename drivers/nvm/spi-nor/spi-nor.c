@@ -45,6 +45,13 @@
 
 //#define SPI_NOR_VERBOSE_DEBUG
 
+/*----------------------------------------------------------------------------
+ *        Local Constants
+ *----------------------------------------------------------------------------*/
+
+/* Timeout added to the expected duration of operations (in ms) */
+#define TIMEOUT_MARGIN 100
+
 /*----------------------------------------------------------------------------
  *        Local Variables
  *----------------------------------------------------------------------------*/
@@ -298,7 +305,7 @@ static int spi_nor_probe(struct spi_flash *flash)
 	}
 	flash->reg_proto = SFLASH_PROTO_1_1_1;
 	spi_flash_reset(flash);
-	usleep(50);
+	timer_delay_us(50);
 
 	/* Set default settings. */
 	flash->read_proto = SFLASH_PROTO_1_1_1;
@@ -309,6 +316,13 @@ static int spi_nor_probe(struct spi_flash *flash)
 	flash->flags = 0;
 	flash->normal_mode = 0xFFu;
 	flash->xip_mode = 0xA5u;
+	flash->page_program_time = 700;
+	flash->program_suspend_inst = SFLASH_INST_SUSPEND;
+	flash->program_resume_inst = SFLASH_INST_RESUME;
+	flash->erase_suspend_inst = SFLASH_INST_SUSPEND;
+	flash->erase_resume_inst = SFLASH_INST_RESUME;
+	flash->suspend_latency = 30;
+	flash->resume_interval = 100;
 
 	/* Get the static SPI flash info (might by NULL). */
 	info = spi_nor_read_id(flash);
@@ -369,6 +383,285 @@ init_params:
 	return 0;
 }
 
+static const struct spi_flash_erase_region *spi_nor_find_erase_region(const struct spi_flash_erase_map *map, uint64_t offset)
+{
+	uint32_t i;
+
+	for (i = 0; i < map->num_regions; i++) {
+		const struct spi_flash_erase_region *region = &map->regions[i];
+
+		if (offset >= region->offset && offset < region->offset + region->size)
+			return region;
+	}
+
+	return NULL;
+}
+
+/*
+ * Return the mask of the erase commands of @cmd_mask worth using: a command
+ * is not worth using when erasing its block with several smaller commands is
+ * faster (typical times), like 4KB erase on some SPI flash doing 64KB erase in
+ * 16 times 4KB erase time.
+ */
+static uint32_t spi_nor_erase_worth_mask(const struct spi_flash_erase_map *map, uint32_t cmd_mask)
+{
+	uint64_t cost[SFLASH_CMD_ERASE_MAX];
+	uint32_t done = 0, worth = 0;
+	int i, j, next;
+
+	/* Process the commands by increasing block size. */
+	while (done != cmd_mask) {
+		const struct spi_flash_erase_command *e;
+		uint64_t composed = UINT64_MAX;
+
+		next = -1;
+		for (i = 0; i < SFLASH_CMD_ERASE_MAX; i++) {
+			if (!(cmd_mask & ~done & (0x1UL << i)))
+				continue;
+			if (next < 0 || map->commands[i].size < map->commands[next].size)
+				next = i;
+		}
+		e = &map->commands[next];
+
+		/* Cheapest way to erase the block with smaller commands. */
+		for (j = 0; j < SFLASH_CMD_ERASE_MAX; j++) {
+			const struct spi_flash_erase_command *s = &map->commands[j];
+			uint32_t rem, n;
+
+			if (!(done & (0x1UL << j)) || s->size >= e->size)
+				continue;
+			n = spi_flash_div_by_erase_size(s, e->size, &rem);
+			if (!rem && n * cost[j] < composed)
+				composed = n * cost[j];
+		}
+
+		if (e->typ_time <= composed) {
+			cost[next] = e->typ_time;
+			worth |= (0x1UL << next);
+		} else {
+			cost[next] = composed;
+		}
+		done |= (0x1UL << next);
+	}
+
+	return worth;
+}
+
+/*
+ * Select the block erase command to use at @offset to erase @len bytes: the
+ * largest command aligned on @offset that fits in both the range and its erase
+ * region, preferring the commands worth using. Since erase block sizes are
+ * multiple of each other, this greedy choice minimizes the total typical erase
+ * time.
+ */
+static const struct spi_flash_erase_command *spi_nor_select_block_erase(struct spi_flash *flash, size_t offset, size_t len)
+{
+	const struct spi_flash_erase_map *map = &flash->erase_map;
+	const struct spi_flash_erase_region *region;
+	const struct spi_flash_erase_command *erase = NULL, *fallback = NULL;
+	uint64_t region_end;
+	uint32_t worth;
+	size_t i;
+
+	region = spi_nor_find_erase_region(map, offset);
+	if (!region)
+		return NULL;
+	region_end = region->offset + region->size;
+	worth = spi_nor_erase_worth_mask(map, region->cmd_mask);
+
+	for (i = 0; i < SFLASH_CMD_ERASE_MAX; i++) {
+		const struct spi_flash_erase_command *e;
+		uint32_t rem;
+
+		if (!(region->cmd_mask & (0x1UL << i)))
+			continue;
+
+		e = &map->commands[i];
+		spi_flash_div_by_erase_size(e, offset, &rem);
+		if (rem || e->size > len || offset + e->size > region_end)
+			continue;
+
+		if (!fallback || fallback->size < e->size)
+			fallback = e;
+		if ((worth & (0x1UL << i)) && (!erase || erase->size < e->size))
+			erase = e;
+	}
+
+	return erase ? erase : fallback;
+}
+
+/*
+ * Select the erase command to use at @offset to erase @len bytes. The chip
+ * erase command is selected when the range covers the whole memory and it is
+ * faster than erasing block by block.
+ */
+static const struct spi_flash_erase_command *spi_nor_select_erase(struct spi_flash *flash, size_t offset, size_t len)
+{
+	const struct spi_flash_erase_map *map = &flash->erase_map;
+	const struct spi_flash_erase_command *erase;
+	uint64_t total = 0;
+
+	if (offset != 0 || len != flash->size || !map->chip.typ_time)
+		return spi_nor_select_block_erase(flash, offset, len);
+
+	while (len) {
+		erase = spi_nor_select_block_erase(flash, offset, len);
+		if (!erase)
+			return NULL;
+		total += erase->typ_time;
+		offset += erase->size;
+		len -= erase->size;
+	}
+
+	if (map->chip.typ_time < total)
+		return &map->chip;
+	return spi_nor_select_block_erase(flash, 0, flash->size);
+}
+
+/* Timeout of an operation, in milliseconds: ten times its typical time. */
+static unsigned long spi_nor_timeout(uint32_t typ_time)
+{
+	return typ_time / 100 + TIMEOUT_MARGIN;
+}
+
+static int spi_nor_async_start_next(struct spi_flash *flash)
+{
+	struct spi_flash_async *async = &flash->async;
+	struct spi_flash_command cmd;
+	int rc;
+
+	if (async->type == SFLASH_TYPE_WRITE) {
+		size_t page_offset = async->to & (flash->page_size - 1);
+
+		spi_flash_command_init(&cmd, flash->write_inst, flash->addr_len, SFLASH_TYPE_WRITE);
+		cmd.proto = flash->write_proto;
+		cmd.data_len = min_u32(flash->page_size - page_offset, async->len);
+		cmd.tx_data = async->buf;
+		async->size = cmd.data_len;
+		async->typ_time = flash->page_program_time;
+		async->buf += cmd.data_len;
+	} else {
+		const struct spi_flash_erase_command *erase;
+
+		erase = spi_nor_select_erase(flash, async->to, async->len);
+		if (!erase)
+			return -EINVAL;
+
+		spi_flash_command_init(&cmd, erase->inst,
+				       erase == &flash->erase_map.chip ? 0 : flash->addr_len,
+				       SFLASH_TYPE_ERASE);
+		cmd.proto = flash->reg_proto;
+		async->size = erase->size;
+		async->typ_time = erase->typ_time;
+	}
+	cmd.addr = async->to;
+#ifdef CONFIG_HAVE_AESB
+	cmd.use_aesb = flash->use_aesb;
+#endif
+
+	rc = spi_flash_write_enable(flash);
+	if (rc < 0)
+		return rc;
+
+	rc = spi_flash_exec(flash, &cmd);
+	if (rc < 0)
+		return rc;
+
+	async->addr = async->to;
+	async->to += async->size;
+	async->len -= async->size;
+	async->start = timer_get_tick();
+
+	return 0;
+}
+
+static void spi_nor_async_complete(struct spi_flash *flash, int rc)
+{
+	struct _callback cb;
+
+	/* the callback may start the next operation */
+	callback_copy(&cb, &flash->async.cb);
+	flash->async.type = 0;
+	callback_call(&cb, (void*)rc);
+}
+
+static int spi_nor_async_start(struct spi_flash *flash, uint8_t type, size_t to, const uint8_t* buf, size_t len, struct _callback* cb)
+{
+	struct spi_flash_async *async = &flash->async;
+	int rc;
+
+	if (async->type)
+		return -EBUSY;
+	if (!len)
+		return -EINVAL;
+
+	rc = spi_flash_set_protection(flash, false);
+	if (rc < 0)
+		return rc;
+
+	async->type = type;
+	async->suspended = false;
+	async->to = to;
+	async->buf = buf;
+	async->len = len;
+	callback_copy(&async->cb, cb);
+
+	rc = spi_nor_async_start_next(flash);
+	if (rc < 0)
+		async->type = 0;
+	return rc;
+}
+
+/*
+ * Suspend the asynchronous operation in progress before accessing the array.
+ * Return 1 if the operation was suspended, 0 if the SPI flash is ready.
+ */
+static int spi_nor_async_suspend(struct spi_flash *flash, size_t from, size_t len)
+{
+	struct spi_flash_async *async = &flash->async;
+	int rc;
+
+	rc = spi_flash_is_ready(flash);
+	if (rc != 0)
+		return rc < 0 ? rc : 0;
+
+	/*
+	 * Without suspend support, or when reading the page/sector being
+	 * programmed/erased, wait for the end of the operation.
+	 */
+	if (!(flash->flags & SFLASH_FLG_HAS_SUSPEND) ||
+	    (from < async->addr + async->size && async->addr < from + len)) {
+		rc = spi_flash_wait_till_ready_typ(flash, 0, spi_nor_timeout(async->typ_time));
+		return rc < 0 ? rc : 0;
+	}
+
+	rc = spi_flash_write_reg(flash, async->type == SFLASH_TYPE_WRITE ?
+				 flash->program_suspend_inst :
+				 flash->erase_suspend_inst, NULL, 0);
+	if (rc < 0)
+		return rc;
+
+	async->suspended = true;
+	rc = spi_flash_wait_till_ready_typ(flash, flash->suspend_latency, TIMEOUT_MARGIN);
+	return rc < 0 ? rc : 1;
+}
+
+static int spi_nor_async_resume(struct spi_flash *flash)
+{
+	struct spi_flash_async *async = &flash->async;
+	int rc;
+
+	rc = spi_flash_write_reg(flash, async->type == SFLASH_TYPE_WRITE ?
+				 flash->program_resume_inst :
+				 flash->erase_resume_inst, NULL, 0);
+	async->suspended = false;
+
+	/* Let the operation progress before it can be suspended again. */
+	timer_delay_us(flash->resume_interval);
+
+	return rc;
+}
+
 static int _bus_init(union spi_flash_priv* priv)
 {
 	return 0;
@@ -737,6 +1030,14 @@ int spi_nor_configure(struct spi_flash *flash, const struct spi_flash_cfg *cfg)
 int spi_nor_read(struct spi_flash *flash, size_t from, uint8_t* buf, size_t len)
 {
 	struct spi_flash_command cmd;
+	int suspended = 0;
+	int rc;
+
+	if (flash->async.type) {
+		suspended = spi_nor_async_suspend(flash, from, len);
+		if (suspended < 0)
+			return suspended;
+	}
 
 	spi_flash_command_init(&cmd, flash->read_inst, flash->addr_len, SFLASH_TYPE_READ);
 	cmd.proto = flash->read_proto;
@@ -749,7 +1050,15 @@ int spi_nor_read(struct spi_flash *flash, size_t from, uint8_t* buf, size_t len)
 #ifdef CONFIG_HAVE_AESB
 	cmd.use_aesb = flash->use_aesb;
 #endif
-	return spi_flash_exec(flash, &cmd);
+	rc = spi_flash_exec(flash, &cmd);
+
+	if (suspended) {
+		int rc2 = spi_nor_async_resume(flash);
+		if (rc >= 0)
+			rc = rc2;
+	}
+
+	return rc;
 }
 
 int spi_nor_write(struct spi_flash *flash, size_t to, const uint8_t* buf, size_t len)
@@ -757,6 +1066,9 @@ int spi_nor_write(struct spi_flash *flash, size_t to, const uint8_t* buf, size_t
 	struct spi_flash_command cmd;
 	int rc = 0;
 
+	if (flash->async.type)
+		return -EBUSY;
+
 	rc = spi_flash_set_protection(flash, false);
 	if (rc < 0)
 		return rc;
@@ -784,7 +1096,8 @@ int spi_nor_write(struct spi_flash *flash, size_t to, const uint8_t* buf, size_t
 		if (rc < 0)
 			break;
 
-		rc = spi_flash_wait_till_ready(flash);
+		rc = spi_flash_wait_till_ready_typ(flash, flash->page_program_time,
+						   spi_nor_timeout(flash->page_program_time));
 		if (rc < 0)
 			break;
 
@@ -798,18 +1111,11 @@ int spi_nor_write(struct spi_flash *flash, size_t to, const uint8_t* buf, size_t
 
 int spi_nor_erase(struct spi_flash *flash, size_t offset, size_t len)
 {
-	const struct spi_flash_erase_map *map = &flash->erase_map;
 	struct spi_flash_command cmd;
 	int rc = 0;
 
-	rc = spi_flash_set_protection(flash, false);
-	if (rc < 0)
-		return rc;
-
-	if (!spi_flash_has_uniform_erase(flash)) {
-		/* @TODO: add support to non uniform erase map. */
-		return -ENOTSUP;
-	}
+	if (flash->async.type)
+		return -EBUSY;
 
 	rc = spi_flash_set_protection(flash, false);
 	if (rc < 0)
@@ -821,25 +1127,11 @@ int spi_nor_erase(struct spi_flash *flash, size_t offset, size_t len)
 	cmd.use_aesb = flash->use_aesb;
 #endif
 	while (len) {
-		const struct spi_flash_erase_command *erase = NULL;
-		size_t i;
+		const struct spi_flash_erase_command *erase;
 
-		for (i = 0; i < SFLASH_CMD_ERASE_MAX; i++) {
-			const struct spi_flash_erase_command *e;
-			uint32_t rem;
-
-			if ((map->uniform_region.cmd_mask & (0x1UL << i))) {
-				e = &map->commands[i];
-				spi_flash_div_by_erase_size(e, offset, &rem);
-				if (rem)
-					continue;
-
-				if (e->size <= len && (!erase || erase->size < e->size))
-					erase = e;
-			}
-		}
+		erase = spi_nor_select_erase(flash, offset, len);
 		if (!erase)
-			return -1;
+			return -EINVAL;
 
 #ifdef SPI_NOR_VERBOSE_DEBUG
 		trace_info("spi-nor: erase params: inst=0x%x\r\n", erase->inst);
@@ -852,12 +1144,14 @@ int spi_nor_erase(struct spi_flash *flash, size_t offset, size_t len)
 			break;
 
 		cmd.inst = erase->inst;
+		cmd.addr_len = erase == &flash->erase_map.chip ? 0 : flash->addr_len;
 		cmd.addr = offset;
 		rc = spi_flash_exec(flash, &cmd);
 		if (rc < 0)
 			break;
 
-		rc = spi_flash_wait_till_ready(flash);
+		rc = spi_flash_wait_till_ready_typ(flash, erase->typ_time,
+						   spi_nor_timeout(erase->typ_time));
 		if (rc < 0)
 			break;
 
@@ -867,3 +1161,46 @@ int spi_nor_erase(struct spi_flash *flash, size_t offset, size_t len)
 
 	return rc;
 }
+
+int spi_nor_write_async(struct spi_flash *flash, size_t to, const uint8_t* buf, size_t len, struct _callback* cb)
+{
+	return spi_nor_async_start(flash, SFLASH_TYPE_WRITE, to, buf, len, cb);
+}
+
+int spi_nor_erase_async(struct spi_flash *flash, size_t offset, size_t len, struct _callback* cb)
+{
+	return spi_nor_async_start(flash, SFLASH_TYPE_ERASE, offset, NULL, len, cb);
+}
+
+int spi_nor_poll(struct spi_flash *flash)
+{
+	struct spi_flash_async *async = &flash->async;
+	uint64_t elapsed;
+	int rc;
+
+	if (!async->type)
+		return 0;
+	if (async->suspended)
+		return 1;
+
+	/* Do not bother the SPI flash before half of the typical time. */
+	elapsed = timer_get_interval(async->start, timer_get_tick());
+	if (elapsed < async->typ_time / 2000)
+		return 1;
+
+	rc = spi_flash_is_ready(flash);
+	if (rc == 0) {
+		if (elapsed <= spi_nor_timeout(async->typ_time))
+			return 1;
+		rc = -ETIMEDOUT;
+	}
+
+	if (rc > 0 && async->len) {
+		rc = spi_nor_async_start_next(flash);
+		if (rc == 0)
+			return 1;
+	}
+
+	spi_nor_async_complete(flash, rc < 0 ? rc : 0);
+	return rc < 0 ? rc : 0;
+}
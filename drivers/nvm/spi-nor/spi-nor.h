@@ -117,6 +117,25 @@ int spi_nor_read(struct spi_flash *flash, size_t from, uint8_t* buf, size_t len)
 int spi_nor_write(struct spi_flash *flash, size_t to, const uint8_t* buf, size_t len);
 int spi_nor_erase(struct spi_flash *flash, size_t offset, size_t len);
 
+/*
+ * Asynchronous write/erase: the first page/sector operation is started and
+ * the function returns. spi_nor_poll() starts the following ones as the SPI
+ * flash becomes ready, and calls the callback with the result (0 or a
+ * negative error code) as second argument once done. spi_nor_read() can be
+ * called meanwhile: it suspends the operation when the SPI flash supports it
+ * and the read does not overlap the page/sector being programmed/erased,
+ * otherwise it waits for the end of the page/sector operation.
+ */
+int spi_nor_write_async(struct spi_flash *flash, size_t to, const uint8_t* buf, size_t len, struct _callback* cb);
+int spi_nor_erase_async(struct spi_flash *flash, size_t offset, size_t len, struct _callback* cb);
+
+/*
+ * Advance the asynchronous operation in progress.
+ * Return 1 while the operation is in progress, 0 when idle, or a negative
+ * error code if the operation failed.
+ */
+int spi_nor_poll(struct spi_flash *flash);
+
 int spansion_new_quad_enable(struct spi_flash *flash);
 int spansion_quad_enable(struct spi_flash *flash);
 int macronix_quad_enable(struct spi_flash *flash);
@@ -33,18 +33,37 @@
 
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "chip.h"
 #include "errno.h"
 #include "i2c/twid.h"
+#include "mm/cache.h"
 #include "peripherals/bus.h"
 #include "timer.h"
 #include "trace.h"
 #include "video/image_sensor_inf.h"
 
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+/** Maximum number of data bytes written by a single auto-increment burst */
+#define SENSOR_BURST_SIZE 32
+
+/** Maximum number of writes issued with a single bus transfer */
+#define SENSOR_BATCH_SIZE 16
+
 /*----------------------------------------------------------------------------
  *        Local variables
  *----------------------------------------------------------------------------*/
+
+/** Register address and data bytes of the writes of a batch */
+CACHE_ALIGNED static uint8_t sensor_batch_data[SENSOR_BATCH_SIZE][2 + SENSOR_BURST_SIZE];
+
+/** Bus buffers of a batch, two per write (address and data) */
+static struct _buffer sensor_batch_buf[2 * SENSOR_BATCH_SIZE];
+
 /** Supported sensor profiles */
 static const struct sensor_profile* sensor_profiles[SENSOR_SUPPORTED_NUMBER] = {
 	&ov2640_profile,
@@ -120,64 +139,6 @@ static int sensor_twi_read_reg(uint8_t twi_mode, uint8_t bus, uint8_t addr,
 	return err;
 }
 
-/**
- * \brief  Write a value to a register in an dedicated sensor device.
- * \param bus  TWI bus
- * \param addr Sensor TWI addr
- * \param reg Register to be written
- * \param data Data written
- * \return SENSOR_OK if no error; otherwise SENSOR_TWI_ERROR
- */
-static int sensor_twi_write_reg(uint8_t twi_mode, uint8_t bus, uint8_t addr,
-				uint16_t reg, uint8_t *data)
-{
-	int err;
-	uint8_t addr_buf[2];
-	struct _buffer buf[2] = {
-		{
-			.data = addr_buf,
-			/* .size */
-			.attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_TX,
-		},
-		{
-			.data = data,
-			/* .size */
-			.attr = BUS_BUF_ATTR_TX | BUS_I2C_BUF_ATTR_STOP,
-		},
-	};
-
-	switch (twi_mode){
-	case SENSOR_TWI_REG_BYTE_DATA_BYTE:
-		buf[0].size = 1;
-		buf[1].size = 1;
-		addr_buf[0] = reg & 0xff;
-
-		break;
-
-	case SENSOR_TWI_REG_2BYTE_DATA_BYTE:
-		buf[0].size = 2;
-		buf[1].size = 1;
-		addr_buf[0] = (reg >> 8) & 0xff;
-		addr_buf[1] = reg & 0xff;
-		break;
-
-	case SENSOR_TWI_REG_BYTE_DATA_2BYTE:
-		buf[0].size = 1;
-		buf[1].size = 2;
-		addr_buf[0] = reg & 0xff;
-		break;
-
-	default:
-		return -EINVAL;
-	}
-
-	bus_start_transaction(bus);
-	err = bus_transfer(bus, addr, buf, 2, NULL);
-	bus_stop_transaction(bus);
-
-	return err;
-}
-
 /**
  * \brief Read and check sensor product ID.
  * \param twi_bus  TWI bus
@@ -215,9 +176,46 @@ static uint32_t sensor_check_pid(uint8_t twi_bus, struct sensor_profile* sensor_
 		return SENSOR_ID_ERROR;
 }
 
+/**
+ * \brief Get the size of the register address and data for a TWI mode.
+ * \param twi_mode  Sensor TWI mode
+ * \param addr_size  Filled with the register address size
+ * \param data_size  Filled with the register data size
+ * \return 0 on success, -EINVAL if the mode is not supported
+ */
+static int sensor_twi_get_sizes(uint8_t twi_mode, uint8_t *addr_size,
+				uint8_t *data_size)
+{
+	switch (twi_mode) {
+	case SENSOR_TWI_REG_BYTE_DATA_BYTE:
+		*addr_size = 1;
+		*data_size = 1;
+		return 0;
+	case SENSOR_TWI_REG_2BYTE_DATA_BYTE:
+		*addr_size = 2;
+		*data_size = 1;
+		return 0;
+	case SENSOR_TWI_REG_BYTE_DATA_2BYTE:
+		*addr_size = 1;
+		*data_size = 2;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static bool sensor_reg_is_term(const struct sensor_reg *reg)
+{
+	return reg->reg == SENSOR_REG_TERM && reg->val == SENSOR_VAL_TERM;
+}
+
 /**
  * \brief  Initialize a list of registers.
  * The list of registers is terminated by the pair of values
+ * (SENSOR_REG_TERM, SENSOR_VAL_TERM). SENSOR_REG_DELAY entries insert a delay.
+ * The writes between two delays are sent with a single bus transfer and, if
+ * the sensor supports it, writes to consecutive registers are merged into
+ * auto-increment bursts.
  * \param twi_bus  TWI bus
  * \param sensor_profile   Sensor private profile
  * \param reglist Register list to be written
@@ -227,50 +225,176 @@ static uint32_t sensor_twi_write_regs(uint8_t twi_bus,
 									  struct sensor_profile* sensor_profile,
 									  const struct sensor_reg* reglist)
 {
-	int status;
 	const struct sensor_reg *next = reglist;
+	const bool auto_inc = (sensor_profile->twi_flags & SENSOR_TWI_AUTO_INC) != 0;
+	uint8_t addr_size, data_size;
+	uint8_t *data;
+	uint16_t reg, count;
+	uint32_t len;
+	int err;
+
+	if (sensor_twi_get_sizes(sensor_profile->twi_inf_mode,
+				 &addr_size, &data_size) < 0)
+		return SENSOR_TWI_ERROR;
+
+	while (!sensor_reg_is_term(next)) {
+		if (next->reg == SENSOR_REG_DELAY) {
+			msleep(next->val);
+			next++;
+			continue;
+		}
+
+		/* Prepare the writes up to the next delay */
+		for (count = 0; count < SENSOR_BATCH_SIZE; count++) {
+			if (sensor_reg_is_term(next) || next->reg == SENSOR_REG_DELAY)
+				break;
+
+			data = sensor_batch_data[count];
+			reg = next->reg;
+			if (addr_size == 2) {
+				data[0] = (reg >> 8) & 0xff;
+				data[1] = reg & 0xff;
+			} else {
+				data[0] = reg & 0xff;
+			}
+
+			/* Data bytes are sent in the memory order of the
+			 * value, as the single register writes did */
+			len = 0;
+			do {
+				memcpy(&data[addr_size + len], &next->val, data_size);
+				len += data_size;
+				next++;
+			} while (auto_inc && len + data_size <= SENSOR_BURST_SIZE
+				 && !sensor_reg_is_term(next)
+				 && next->reg == (uint16_t)(reg + len / data_size));
+
+			sensor_batch_buf[2 * count].data = data;
+			sensor_batch_buf[2 * count].size = addr_size;
+			sensor_batch_buf[2 * count].attr = BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_TX;
+			sensor_batch_buf[2 * count + 1].data = &data[addr_size];
+			sensor_batch_buf[2 * count + 1].size = len;
+			sensor_batch_buf[2 * count + 1].attr = BUS_BUF_ATTR_TX | BUS_I2C_BUF_ATTR_STOP;
+		}
 
-	while (!((next->reg == SENSOR_REG_TERM) && (next->val == SENSOR_VAL_TERM))) {
-		status = sensor_twi_write_reg(sensor_profile->twi_inf_mode,
-									  twi_bus,
-									  sensor_profile->addr,
-									  next->reg,
-									  (uint8_t *)(&next->val));
-		msleep(2);
-		if (status < 0)
+		bus_start_transaction(twi_bus);
+		err = bus_transfer(twi_bus, sensor_profile->addr,
+				   sensor_batch_buf, 2 * count, NULL);
+		if (err >= 0)
+			err = bus_wait_transfer(twi_bus);
+		bus_stop_transaction(twi_bus);
+		if (err < 0)
 			return SENSOR_TWI_ERROR;
-		next++;
 	}
 
 	return SENSOR_OK;
 }
 
-/*----------------------------------------------------------------------------
- *        Exported functions
- *----------------------------------------------------------------------------*/
+/**
+ * \brief  Read back a list of registers and compare with the list values.
+ * Registers written again later in the list, or followed by a delay, are not
+ * checked.
+ * \param twi_bus  TWI bus
+ * \param sensor_profile   Sensor private profile
+ * \param reglist Register list to be checked
+ * \return SENSOR_OK if all the registers match; otherwise SENSOR_TWI_ERROR or
+ * SENSOR_VERIFY_ERROR
+ */
+static uint32_t sensor_twi_verify_regs(uint8_t twi_bus,
+									   struct sensor_profile* sensor_profile,
+									   const struct sensor_reg* reglist)
+{
+	const struct sensor_reg *next, *later;
+	uint8_t addr_size, data_size;
+	/* use uint32_t to force 4-byte alignment */
+	uint32_t value;
+	uint32_t status = SENSOR_OK;
 
-uint32_t sensor_setup(uint8_t twi_bus, struct sensor_profile* sensor_profile,
-					  uint8_t resolution,
-					  uint8_t format)
+	if (sensor_twi_get_sizes(sensor_profile->twi_inf_mode,
+				 &addr_size, &data_size) < 0)
+		return SENSOR_TWI_ERROR;
+
+	for (next = reglist; !sensor_reg_is_term(next); next++) {
+		if (next->reg == SENSOR_REG_DELAY || next[1].reg == SENSOR_REG_DELAY)
+			continue;
+		for (later = next + 1; !sensor_reg_is_term(later); later++)
+			if (later->reg == next->reg)
+				break;
+		if (!sensor_reg_is_term(later))
+			continue;
+
+		value = 0;
+		if (sensor_twi_read_reg(sensor_profile->twi_inf_mode, twi_bus,
+					sensor_profile->addr, next->reg,
+					(uint8_t*)&value) < 0)
+			return SENSOR_TWI_ERROR;
+		if (memcmp(&value, &next->val, data_size)) {
+			trace_warning("sensor: reg 0x%x is 0x%x, expected 0x%x\r\n",
+				      (unsigned)next->reg, (unsigned)value,
+				      (unsigned)next->val);
+			status = SENSOR_VERIFY_ERROR;
+		}
+	}
+
+	return status;
+}
+
+/**
+ * \brief Find the output configuration for a resolution and format.
+ * \param sensor_profile  Sensor private profile
+ * \param resolution  Output resolution
+ * \param format  Output format
+ * \return pointer to the output configuration, or NULL if not supported
+ */
+static const struct sensor_output* sensor_find_output(struct sensor_profile* sensor_profile,
+						     uint8_t resolution,
+						     uint8_t format)
 {
 	uint8_t i;
-	uint8_t found = 0;
 
 	for (i = 0; i < SENSOR_SUPPORTED_OUTPUTS; i++) {
+		if (!sensor_profile->output_conf[i])
+			continue;
 		if (sensor_profile->output_conf[i]->supported){
 			if (sensor_profile->output_conf[i]->output_resolution == resolution) {
-				if (sensor_profile->output_conf[i]->output_format == format) {
-					found = 1;
-					break;
-				}
+				if (sensor_profile->output_conf[i]->output_format == format)
+					return sensor_profile->output_conf[i];
 			}
 		}
 	}
-	if (found == 0)
+	return NULL;
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+uint32_t sensor_setup(uint8_t twi_bus, struct sensor_profile* sensor_profile,
+					  uint8_t resolution,
+					  uint8_t format)
+{
+	const struct sensor_output* output;
+
+	output = sensor_find_output(sensor_profile, resolution, format);
+	if (!output)
 		return SENSOR_RESOLUTION_NOT_SUPPORTED;
 
 	return sensor_twi_write_regs(twi_bus, sensor_profile,
-								 sensor_profile->output_conf[i]->output_setting);
+								 output->output_setting);
+}
+
+uint32_t sensor_verify(uint8_t twi_bus, struct sensor_profile* sensor_profile,
+					   uint8_t resolution,
+					   uint8_t format)
+{
+	const struct sensor_output* output;
+
+	output = sensor_find_output(sensor_profile, resolution, format);
+	if (!output)
+		return SENSOR_RESOLUTION_NOT_SUPPORTED;
+
+	return sensor_twi_verify_regs(twi_bus, sensor_profile,
+								  output->output_setting);
 }
 
 struct sensor_profile* sensor_detect(uint8_t twi_bus, bool detect_auto, uint8_t id)
@@ -296,6 +420,91 @@ struct sensor_profile* sensor_detect(uint8_t twi_bus, bool detect_auto, uint8_t
 	}
 }
 
+uint32_t sensor_set_manual_exposure(uint8_t twi_bus,
+									struct sensor_profile* sensor_profile)
+{
+	const struct sensor_exposure* exp = sensor_profile->exposure;
+
+	if (!exp || sensor_profile->twi_inf_mode == SENSOR_TWI_REG_BYTE_DATA_2BYTE)
+		return SENSOR_NOT_SUPPORTED;
+
+	return sensor_twi_write_regs(twi_bus, sensor_profile, exp->manual);
+}
+
+uint32_t sensor_get_exposure(uint8_t twi_bus,
+							 struct sensor_profile* sensor_profile,
+							 uint32_t* exposure,
+							 uint16_t* gain)
+{
+	const struct sensor_exposure* exp = sensor_profile->exposure;
+	/* use uint32_t to force 4-byte alignment */
+	uint32_t data;
+	uint32_t value;
+	uint8_t i;
+
+	if (!exp || sensor_profile->twi_inf_mode == SENSOR_TWI_REG_BYTE_DATA_2BYTE)
+		return SENSOR_NOT_SUPPORTED;
+
+	for (value = 0, i = 0; i < exp->exposure_len; i++) {
+		data = 0;
+		if (sensor_twi_read_reg(sensor_profile->twi_inf_mode, twi_bus,
+					sensor_profile->addr, exp->exposure_reg[i],
+					(uint8_t*)&data) < 0)
+			return SENSOR_TWI_ERROR;
+		value = (value << 8) | (data & 0xff);
+	}
+	*exposure = value >> exp->exposure_shift;
+
+	for (value = 0, i = 0; i < exp->gain_len; i++) {
+		data = 0;
+		if (sensor_twi_read_reg(sensor_profile->twi_inf_mode, twi_bus,
+					sensor_profile->addr, exp->gain_reg[i],
+					(uint8_t*)&data) < 0)
+			return SENSOR_TWI_ERROR;
+		value = (value << 8) | (data & 0xff);
+	}
+	*gain = (uint16_t)value;
+
+	return SENSOR_OK;
+}
+
+uint32_t sensor_set_exposure(uint8_t twi_bus,
+							 struct sensor_profile* sensor_profile,
+							 uint32_t exposure,
+							 uint16_t gain)
+{
+	const struct sensor_exposure* exp = sensor_profile->exposure;
+	struct sensor_reg regs[ARRAY_SIZE(exp->exposure_reg) + ARRAY_SIZE(exp->gain_reg) + 1];
+	uint32_t value;
+	uint8_t i, n = 0;
+
+	if (!exp || sensor_profile->twi_inf_mode == SENSOR_TWI_REG_BYTE_DATA_2BYTE)
+		return SENSOR_NOT_SUPPORTED;
+
+	if (exposure < exp->exposure_min)
+		exposure = exp->exposure_min;
+	if (exposure > exp->exposure_max)
+		exposure = exp->exposure_max;
+	if (gain < exp->gain_min)
+		gain = exp->gain_min;
+	if (gain > exp->gain_max)
+		gain = exp->gain_max;
+
+	value = exposure << exp->exposure_shift;
+	for (i = 0; i < exp->exposure_len; i++, n++) {
+		regs[n].reg = exp->exposure_reg[i];
+		regs[n].val = (value >> (8 * (exp->exposure_len - 1 - i))) & 0xff;
+	}
+	for (i = 0; i < exp->gain_len; i++, n++) {
+		regs[n].reg = exp->gain_reg[i];
+		regs[n].val = (gain >> (8 * (exp->gain_len - 1 - i))) & 0xff;
+	}
+	regs[n].reg = SENSOR_REG_TERM;
+	regs[n].val = SENSOR_VAL_TERM;
+
+	return sensor_twi_write_regs(twi_bus, sensor_profile, regs);
+}
+
 /**
  * \brief Retrieves sensor output bit width and size for giving resolution and format.
  * \param resolution Output resolution request.
@@ -312,18 +521,14 @@ uint32_t sensor_get_output(struct sensor_profile *sensor,
 						   uint32_t *width,
 						   uint32_t *height)
 {
-	uint8_t i;
-	for (i = 0; i < SENSOR_SUPPORTED_OUTPUTS; i++) {
-		if (sensor->output_conf[i]->supported){
-			if (sensor->output_conf[i]->output_resolution == resolution) {
-				if (sensor->output_conf[i]->output_format == format) {
-					*bits = sensor->output_conf[i]->output_bit;
-					*width = sensor->output_conf[i]->output_width;
-					*height = sensor->output_conf[i]->output_height;
-					return SENSOR_OK;
-				}
-			}
-		}
-	}
-	return SENSOR_RESOLUTION_NOT_SUPPORTED;
+	const struct sensor_output* output;
+
+	output = sensor_find_output(sensor, resolution, format);
+	if (!output)
+		return SENSOR_RESOLUTION_NOT_SUPPORTED;
+
+	*bits = output->output_bit;
+	*width = output->output_width;
+	*height = output->output_height;
+	return SENSOR_OK;
 }
@@ -36,6 +36,7 @@
  *        Headers
  *----------------------------------------------------------------------------*/
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "board.h"
 
@@ -58,6 +59,12 @@
 /** terminating list entry for value in configuration file */
 #define SENSOR_VAL_TERM         0xFF
 
+/** register list entry for a delay, the value gives the delay in ms */
+#define SENSOR_REG_DELAY        0xFFFF
+
+/** sensor TWI flags */
+#define SENSOR_TWI_AUTO_INC     (1 << 0) /**< register address auto-increment */
+
 /*----------------------------------------------------------------------------
  *        Types
  *----------------------------------------------------------------------------*/
@@ -66,7 +73,9 @@ enum {
 	SENSOR_OK = 0,        /**< Operation is successful */
 	SENSOR_TWI_ERROR,
 	SENSOR_ID_ERROR,
-	SENSOR_RESOLUTION_NOT_SUPPORTED
+	SENSOR_RESOLUTION_NOT_SUPPORTED,
+	SENSOR_VERIFY_ERROR,
+	SENSOR_NOT_SUPPORTED
 };
 
 /** Sensor type */
@@ -127,6 +136,23 @@ struct sensor_output {
 	const struct sensor_reg* output_setting;    /** sensor registers setting */
 };
 
+/** define a structure for sensor manual exposure and gain control.
+ * Exposure and gain values are split in bytes written MSB first to
+ * consecutive entries of exposure_reg/gain_reg. */
+struct sensor_exposure {
+	const struct sensor_reg* manual; /** registers setting manual exposure/gain */
+	uint16_t exposure_reg[3];     /** exposure registers, MSB first */
+	uint8_t exposure_len;         /** number of exposure registers */
+	uint8_t exposure_shift;       /** left shift of the exposure value */
+	uint16_t gain_reg[2];         /** gain registers, MSB first */
+	uint8_t gain_len;             /** number of gain registers */
+	uint16_t gain_unit;           /** gain value for a 1x gain */
+	uint32_t exposure_min;        /** minimum exposure, in lines */
+	uint32_t exposure_max;        /** maximum exposure, in lines */
+	uint16_t gain_min;            /** minimum gain */
+	uint16_t gain_max;            /** maximum gain */
+};
+
 /** define a structure for sensor profile */
 struct sensor_profile {
 	const char* name;             /** Sensor name */
@@ -139,6 +165,8 @@ struct sensor_profile {
 	uint16_t pid_low;             /** product ID low byte */
 	uint16_t version_mask;        /** version mask */
 	const struct sensor_output* output_conf[SENSOR_SUPPORTED_OUTPUTS]; /** sensor settings */
+	uint8_t twi_flags;            /** TWI access flags (SENSOR_TWI_xxx) */
+	const struct sensor_exposure* exposure; /** manual exposure control, if supported */
 };
 
 /*----------------------------------------------------------------------------
@@ -178,6 +206,58 @@ extern uint32_t sensor_setup(uint8_t twi_bus,
 							 uint8_t resolution,
 							 uint8_t format);
 
+/**
+ * \brief Read back the registers of a sensor setting and compare them with
+ * the values written by sensor_setup(). Registers written again later in the
+ * setting, or followed by a delay (reset, standby) are not checked.
+ * \param twi_bus TWI bus
+ * \param sensor pointer to a sensor profile instance.
+ * \param resolution resolution request
+ * \param format format request
+ * \return SENSOR_OK if all the registers match; otherwise return
+ * SENSOR_XXX_ERROR
+ */
+extern uint32_t sensor_verify(uint8_t twi_bus,
+							  struct sensor_profile* sensor,
+							  uint8_t resolution,
+							  uint8_t format);
+
+/**
+ * \brief Disable the sensor automatic exposure and gain control.
+ * \param twi_bus TWI bus
+ * \param sensor pointer to a sensor profile instance.
+ * \return SENSOR_OK if no error; SENSOR_NOT_SUPPORTED if the sensor has no
+ * manual exposure control; otherwise return SENSOR_XXX_ERROR
+ */
+extern uint32_t sensor_set_manual_exposure(uint8_t twi_bus,
+										   struct sensor_profile* sensor);
+
+/**
+ * \brief Read the current sensor exposure and gain.
+ * \param twi_bus TWI bus
+ * \param sensor pointer to a sensor profile instance.
+ * \param exposure pointer to the exposure, in lines.
+ * \param gain pointer to the gain, in sensor_exposure::gain_unit units.
+ * \return SENSOR_OK if no error; otherwise return SENSOR_XXX_ERROR
+ */
+extern uint32_t sensor_get_exposure(uint8_t twi_bus,
+									struct sensor_profile* sensor,
+									uint32_t* exposure,
+									uint16_t* gain);
+
+/**
+ * \brief Set the sensor exposure and gain (manual exposure control).
+ * \param twi_bus TWI bus
+ * \param sensor pointer to a sensor profile instance.
+ * \param exposure exposure, in lines.
+ * \param gain gain, in sensor_exposure::gain_unit units.
+ * \return SENSOR_OK if no error; otherwise return SENSOR_XXX_ERROR
+ */
+extern uint32_t sensor_set_exposure(uint8_t twi_bus,
+									struct sensor_profile* sensor,
+									uint32_t exposure,
+									uint16_t gain);
+
 /**
  * \brief Retrieves sensor output bit width and size for giving resolution and format.
  * \param sensor pointer to a sensor profile instance.
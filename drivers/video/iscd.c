@@ -49,6 +49,16 @@ CACHE_ALIGNED static union {
 
 static struct _iscd_awb awb;
 
+static const struct _iscd_3a_tuning _iscd_3a_default_tuning = {
+	.awb_gain_min = ISCD_WB_GAIN_ONE / 4,
+	.awb_gain_max = 8 * ISCD_WB_GAIN_ONE - 1,
+	.awb_damping = 64,
+	.ae_target = (HIST_ENTRIES / 4) << 8,
+	.ae_tolerance = (HIST_ENTRIES / 32) << 8,
+	.ae_damping = 128,
+	.ae_settle = BAYER_COUNT,
+};
+
 /*----------------------------------------------------------------------------
  *        Local functions
  *----------------------------------------------------------------------------*/
@@ -71,7 +81,7 @@ static int _dma_histo_callback(void *arg, void* arg2)
 /**
  * \brief Configure xDMA to read Histogram entries.
  */
-static void _iscd_dma_read_histogram(uint32_t buf)
+static void _iscd_dma_read_histogram(uint32_t* buf)
 {
 	struct _dma_cfg cfg_dma;
 	struct _dma_transfer_cfg cfg;
@@ -83,7 +93,7 @@ static void _iscd_dma_read_histogram(uint32_t buf)
 	cfg_dma.loop = false;
 
 	cfg.saddr = (uint32_t*)&ISC->ISC_HIS_ENTRY[0];
-	cfg.daddr = (uint32_t*)buf;
+	cfg.daddr = buf;
 	cfg.len = HIST_ENTRIES;
 
 	dma_configure_transfer(awb.dma.dma_histo_channel, &cfg_dma, &cfg, 1);
@@ -122,50 +132,160 @@ static uint32_t _float2hex(uint8_t sign_bit, uint8_t magnitude_bit,
 }
 
 /**
- * \brief Calculate gain for RGGB bayer and perform them with ISC WB module.
+ * \brief Compute the mean of a channel histogram, in 1/256 bin units. The
+ * last bin holds the clipped pixels, they are counted so that an overexposed
+ * frame reads bright and not empty.
+ */
+static uint32_t _histogram_mean(const uint32_t* buf)
+{
+	uint32_t i;
+	uint32_t pixels = 0;
+	uint64_t sum = 0;
+
+	for (i = 0; i < HIST_ENTRIES; i++) {
+		sum += (uint64_t)buf[i] * i;
+		pixels += buf[i];
+	}
+	if (!pixels)
+		return 0;
+	return (uint32_t)((sum << 8) / pixels);
+}
+
+/**
+ * \brief Move a value toward its target by damping/256 of the difference,
+ * at least one step.
+ */
+static uint32_t _damp(uint32_t value, uint32_t target, uint16_t damping)
+{
+	uint32_t step;
+
+	if (target > value) {
+		step = ((target - value) * damping) >> 8;
+		return value + (step ? step : 1);
+	} else if (target < value) {
+		step = ((value - target) * damping) >> 8;
+		return value - (step ? step : 1);
+	}
+	return value;
+}
+
+/**
+ * \brief Calculate R/B gains from the channel means (gray world) and
+ * perform them with ISC WB module.
  */
 static void _awb_update(void)
 {
-	uint32_t count[BAYER_COUNT];
-	float gain[BAYER_COUNT];
-	uint32_t gain_049[BAYER_COUNT];
-
-	count[HISTOGRAM_R] = (awb.count[HISTOGRAM_R] + awb.backup[HISTOGRAM_R]) / 2;
-	count[HISTOGRAM_GB] = (awb.count[HISTOGRAM_GB] +  awb.backup[HISTOGRAM_GB]) / 2;
-	count[HISTOGRAM_GR] = (awb.count[HISTOGRAM_GR] + awb.backup[HISTOGRAM_GR]) / 2;
-	count[HISTOGRAM_B] = (awb.count[HISTOGRAM_B] + awb.backup[HISTOGRAM_B]) / 2;
-
-	gain[HISTOGRAM_R] = (float)(count[HISTOGRAM_GB]) / (float)(count[HISTOGRAM_R]);
-	gain[HISTOGRAM_GB] = 1.0000000;
-	gain[HISTOGRAM_GR] = 1.0000000;
-	gain[HISTOGRAM_B] = (float)(count[HISTOGRAM_GB]) / (float)(count[HISTOGRAM_B]);
-
-	/* Convert R/G/BGAIN component gain to unsigned 13 bits (0:4:9) */
-	gain_049[HISTOGRAM_R] = _float2hex(0, 4, 9, gain[HISTOGRAM_R]);
-	gain_049[HISTOGRAM_GB] = _float2hex(0, 4, 9, gain[HISTOGRAM_GB]);
-	gain_049[HISTOGRAM_GR] = _float2hex(0, 4, 9, gain[HISTOGRAM_GR]);
-	gain_049[HISTOGRAM_B] = _float2hex(0, 4, 9, gain[HISTOGRAM_B]);
-
-	isc_wb_adjust_bayer_color(0, 0, 0, 0, gain_049[HISTOGRAM_R], gain_049[HISTOGRAM_GR],
-                                  gain_049[HISTOGRAM_B], gain_049[HISTOGRAM_GB]);
+	const struct _iscd_3a_tuning* tuning = awb.tuning;
+	struct _iscd_3a_stats* stats = &awb.stats;
+	uint32_t g = (stats->mean[HISTOGRAM_GR] + stats->mean[HISTOGRAM_GB]) / 2;
+	uint32_t target, gain;
+	uint8_t c;
+	bool converged = true;
+
+	for (c = 0; c < BAYER_COUNT; c++) {
+		if (c == HISTOGRAM_GR || c == HISTOGRAM_GB)
+			continue;
+		if (!stats->mean[c] || !g)
+			continue;
+		target = (g << 9) / stats->mean[c];
+		if (target < tuning->awb_gain_min)
+			target = tuning->awb_gain_min;
+		if (target > tuning->awb_gain_max)
+			target = tuning->awb_gain_max;
+		gain = stats->wb_gain[c];
+		/* within 1/64 of the target */
+		if ((target > gain ? target - gain : gain - target) > (gain >> 6))
+			converged = false;
+		stats->wb_gain[c] = _damp(gain, target, tuning->awb_damping);
+	}
+	stats->awb_converged = converged;
+
+	isc_wb_adjust_bayer_color(0, 0, 0, 0,
+				  stats->wb_gain[HISTOGRAM_R], stats->wb_gain[HISTOGRAM_GR],
+				  stats->wb_gain[HISTOGRAM_B], stats->wb_gain[HISTOGRAM_GB]);
 	isc_update_profile();
+}
 
-	awb.backup[HISTOGRAM_R] = awb.count[HISTOGRAM_R];
-	awb.backup[HISTOGRAM_GB] = awb.count[HISTOGRAM_GB];
-	awb.backup[HISTOGRAM_GR] = awb.count[HISTOGRAM_GR];
-	awb.backup[HISTOGRAM_B] = awb.count[HISTOGRAM_B];
+/**
+ * \brief Drive the sensor exposure and gain so that the G channel mean
+ * reaches the AE target. Exposure is raised first, then the gain.
+ */
+static void _ae_update(void)
+{
+	const struct _iscd_3a_tuning* tuning = awb.tuning;
+	const struct sensor_exposure* exp = awb.sensor->exposure;
+	struct _iscd_3a_stats* stats = &awb.stats;
+	uint32_t luma = (stats->mean[HISTOGRAM_GR] + stats->mean[HISTOGRAM_GB]) / 2;
+	uint32_t ratio, exposure, gain;
+	uint64_t total;
+
+	if ((luma > tuning->ae_target ? luma - tuning->ae_target :
+	     tuning->ae_target - luma) <= tuning->ae_tolerance) {
+		stats->ae_converged = true;
+		return;
+	}
+	stats->ae_converged = false;
+
+	/* correction ratio in 1/256, limited to [1/4, 4] per update */
+	ratio = luma ? (tuning->ae_target << 8) / luma : (4 << 8);
+	if (ratio < (1 << 6))
+		ratio = 1 << 6;
+	if (ratio > (4 << 8))
+		ratio = 4 << 8;
+	ratio = _damp(1 << 8, ratio, tuning->ae_damping);
+
+	total = ((uint64_t)stats->exposure * stats->gain * ratio) >> 8;
+	exposure = (uint32_t)(total / exp->gain_unit);
+	if (exposure > exp->exposure_max) {
+		exposure = exp->exposure_max;
+		gain = (uint32_t)(total / exposure);
+	} else {
+		gain = exp->gain_unit;
+	}
+	if (exposure < exp->exposure_min)
+		exposure = exp->exposure_min;
+	if (gain < exp->gain_min)
+		gain = exp->gain_min;
+	if (gain > exp->gain_max)
+		gain = exp->gain_max;
+
+	if (exposure == stats->exposure && gain == stats->gain)
+		return;
+
+	if (sensor_set_exposure(awb.twi_bus, awb.sensor, exposure, gain) != SENSOR_OK) {
+		trace_warning("AE: sensor exposure update failed\r\n");
+		return;
+	}
+	stats->exposure = exposure;
+	stats->gain = gain;
+	awb.ae_skip = tuning->ae_settle;
 }
 
 /**
- * \brief Count up 4 channel R/G/Gr/Gb histogram data.
+ * \brief Update statistics with the last channel histogram, once all the
+ * channels have been gathered run AWB/AE.
  */
-static void _awb_count_up(uint32_t* buf)
+static void _3a_update(uint32_t* buf)
 {
-	uint32_t i;
+	struct _iscd_3a_stats* stats = &awb.stats;
+
+	stats->mean[awb.op_mode] = _histogram_mean(buf);
+	awb.valid |= 1 << awb.op_mode;
+	stats->updates++;
 
-	awb.count[awb.op_mode] = 0;
-	for (i = 0; i < HIST_ENTRIES; i++)
-		awb.count[awb.op_mode] += (*buf++) * i;
+	if (awb.valid != (1 << BAYER_COUNT) - 1)
+		return;
+
+	_awb_update();
+	/* leave the sensor time to apply the previous exposure */
+	if (awb.ae_skip)
+		awb.ae_skip--;
+	else if (stats->ae_enabled &&
+		 (awb.op_mode == HISTOGRAM_GR || awb.op_mode == HISTOGRAM_GB))
+		_ae_update();
+
+	if (awb.callback)
+		awb.callback(stats);
 }
 
 /**
@@ -412,6 +532,11 @@ uint8_t iscd_pipe_start(struct _iscd_desc* desc)
 
 	awb.state = AWB_INIT;
 	awb.op_mode = 0;
+	awb.valid = 0;
+	if (!awb.tuning)
+		awb.tuning = &_iscd_3a_default_tuning;
+	for (i = 0; i < BAYER_COUNT; i++)
+		awb.stats.wb_gain[i] = ISCD_WB_GAIN_ONE;
 	desc->pipe.frame_idx = 0;
 
 	isc_update_profile();
@@ -425,10 +550,39 @@ uint8_t iscd_pipe_start(struct _iscd_desc* desc)
 	return ISCD_OK;
 }
 
-/**
- * \brief Image tuning for AWB, this is a reference algrothm only.
- */
-void iscd_auto_white_balance_ref_algo(uint32_t* histo_buf)
+void iscd_3a_configure(const struct _iscd_3a_tuning* tuning,
+		       uint8_t twi_bus, struct sensor_profile* sensor,
+		       iscd_3a_callback_t callback)
+{
+	struct _iscd_3a_stats* stats = &awb.stats;
+
+	awb.tuning = tuning ? tuning : &_iscd_3a_default_tuning;
+	awb.twi_bus = twi_bus;
+	awb.sensor = sensor;
+	awb.callback = callback;
+	awb.ae_skip = 0;
+
+	stats->ae_enabled = false;
+	stats->ae_converged = false;
+	stats->exposure = 0;
+	stats->gain = 0;
+	if (sensor && sensor->exposure) {
+		if (sensor_get_exposure(twi_bus, sensor, &stats->exposure,
+					&stats->gain) == SENSOR_OK &&
+		    sensor_set_manual_exposure(twi_bus, sensor) == SENSOR_OK)
+			stats->ae_enabled = true;
+		else
+			trace_warning("AE: sensor manual exposure not available\r\n");
+	}
+	if (stats->ae_enabled) {
+		if (stats->gain < sensor->exposure->gain_min)
+			stats->gain = sensor->exposure->gain_min;
+		if (stats->exposure < sensor->exposure->exposure_min)
+			stats->exposure = sensor->exposure->exposure_min;
+	}
+}
+
+void iscd_3a_process(uint32_t* histo_buf)
 {
 	switch (awb.state) {
 	case AWB_INIT:
@@ -443,24 +597,24 @@ void iscd_auto_white_balance_ref_algo(uint32_t* histo_buf)
 		if (!awb.dma.dma_histo_ready)
 			break;
 		awb.dma.dma_histo_ready = false;
-		_iscd_dma_read_histogram((uint32_t)histo_buf);
+		_iscd_dma_read_histogram(histo_buf);
 		awb.state = AWB_WAIT_DMA_READY;
 		break;
 	case AWB_WAIT_DMA_READY:
 		if (!awb.dma.dma_histo_done)
 			break;
 		awb.dma.dma_histo_done = false;
-		_awb_count_up(histo_buf);
-		awb.op_mode++;
-		if (awb.op_mode < BAYER_COUNT)
-			awb.state = AWB_INIT;
-		else
-			awb.state = AWB_WAIT_ISC_PERFORMED;
-		break;
-	case AWB_WAIT_ISC_PERFORMED:
-		_awb_update();
-		awb.op_mode = 0;
+		_3a_update(histo_buf);
+		awb.op_mode = (awb.op_mode + 1) % BAYER_COUNT;
 		awb.state = AWB_INIT;
 		break;
 	}
 }
+
+/**
+ * \brief Image tuning for AWB, this is a reference algrothm only.
+ */
+void iscd_auto_white_balance_ref_algo(uint32_t* histo_buf)
+{
+	iscd_3a_process(histo_buf);
+}
@@ -35,10 +35,12 @@
  *        Header
  *----------------------------------------------------------------------------*/
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "callback.h"
 #include "dma/dma.h"
+#include "video/image_sensor_inf.h"
 
 /*------------------------------------------------------------------------------
  *        Definition
@@ -59,6 +61,9 @@
 
 #define HIST_ENTRIES (512)
 
+/* White balance gain format is unsigned 0:4:9 */
+#define ISCD_WB_GAIN_ONE (1 << 9)
+
 #define ISCD_OK           (0)
 #define ISCD_ERROR_LOCK   (1)
 #define ISCD_ERROR_CONFIG (2)
@@ -106,9 +111,34 @@ enum _iscd_awb_state {
 	AWB_INIT = 0,
 	AWB_WAIT_HIS_READY,
 	AWB_WAIT_DMA_READY,
-	AWB_WAIT_ISC_PERFORMED,
 };
 
+/* 3A (AWB/AE) tuning parameters. Channel means are in 1/256 histogram
+ * bin units, damping factors in 1/256 (256 = apply full correction). */
+struct _iscd_3a_tuning {
+	uint16_t awb_gain_min;   /**< minimum R/B gain (0:4:9) */
+	uint16_t awb_gain_max;   /**< maximum R/B gain (0:4:9) */
+	uint16_t awb_damping;    /**< AWB correction applied per update */
+	uint32_t ae_target;      /**< target G channel mean */
+	uint32_t ae_tolerance;   /**< AE dead band around ae_target */
+	uint16_t ae_damping;     /**< AE correction applied per update */
+	uint8_t ae_settle;       /**< histograms skipped after an exposure change */
+};
+
+/* 3A statistics, reported after each histogram update */
+struct _iscd_3a_stats {
+	uint32_t mean[BAYER_COUNT];    /**< channel means (1/256 bin) */
+	uint16_t wb_gain[BAYER_COUNT]; /**< current WB gains (0:4:9) */
+	uint32_t exposure;             /**< current sensor exposure, in lines */
+	uint16_t gain;                 /**< current sensor gain */
+	bool awb_converged;
+	bool ae_converged;
+	bool ae_enabled;
+	uint32_t updates;              /**< number of histograms processed */
+};
+
+typedef void (*iscd_3a_callback_t)(const struct _iscd_3a_stats* stats);
+
 struct _iscd_desc {
 	/* structure to define ISCD parameter */
 	struct {
@@ -155,10 +185,16 @@ struct _iscd_awb {
 		bool dma_histo_ready;
 		bool dma_histo_done;
 	} dma;
-	uint32_t backup[BAYER_COUNT];
-	uint32_t count[BAYER_COUNT];
 	uint32_t op_mode;
 	enum _iscd_awb_state state;
+	/* --- following fields are used internally --- */
+	uint8_t valid;
+	uint8_t ae_skip;
+	uint8_t twi_bus;
+	struct sensor_profile* sensor;
+	const struct _iscd_3a_tuning* tuning;
+	iscd_3a_callback_t callback;
+	struct _iscd_3a_stats stats;
 };
 
 /*------------------------------------------------------------------------------
@@ -167,6 +203,27 @@ struct _iscd_awb {
 
 extern uint8_t iscd_pipe_start(struct _iscd_desc* desc);
 
+/**
+ * \brief Configure the 3A (AWB/AE) engine.
+ * \param tuning tuning parameters, NULL for defaults.
+ * \param twi_bus TWI bus of the sensor.
+ * \param sensor sensor profile, NULL to run AWB only. AE is enabled only
+ * if the sensor supports manual exposure control.
+ * \param callback function called with the statistics after each update,
+ * may be NULL.
+ */
+extern void iscd_3a_configure(const struct _iscd_3a_tuning* tuning,
+			      uint8_t twi_bus, struct sensor_profile* sensor,
+			      iscd_3a_callback_t callback);
+
+/**
+ * \brief Run the 3A (AWB/AE) state machine, to be polled from the main loop.
+ * The ISC gathers one Bayer channel histogram per frame, the channels are
+ * cycled and the gains updated after each new channel histogram.
+ * \param histo_buf histogram buffer (HIST_ENTRIES words, cache aligned).
+ */
+extern void iscd_3a_process(uint32_t* histo_buf);
+
 extern void iscd_auto_white_balance_ref_algo(uint32_t* histo_buf);
 
 #endif /* ISCD_H_ */
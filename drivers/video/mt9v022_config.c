@@ -220,6 +220,7 @@ static const struct sensor_output mt9v022_output_mono = {
 	.output_resolution = VGA,
 	.output_format = MONO,
 	.output_bit = BIT_9,
+	.supported = 1,
 	.output_width = 640,
 	.output_height = 480,
 	.output_setting = mt9v022_mono
@@ -55,6 +55,7 @@
 
 static const struct sensor_reg ov2643_yuv_uvga[] = {
 	{0x12, 0x80},
+	{SENSOR_REG_DELAY, 5},
 	{0xc3, 0x1f},
 	{0xc4, 0xff},
 	{0x3d, 0x48},
@@ -196,6 +197,7 @@ static const struct sensor_reg ov2643_yuv_uvga[] = {
 	{0x0f, 0x34},
 
 	{0x12, 0x80},
+	{SENSOR_REG_DELAY, 5},
 	{0xc3, 0x1f},
 	{0xc4, 0xff},
 	{0x3d, 0x48},
@@ -340,6 +342,7 @@ static const struct sensor_reg ov2643_yuv_uvga[] = {
 
 static const struct sensor_reg ov2643_yuv_svga[] = {
 	{0x12, 0x80},
+	{SENSOR_REG_DELAY, 5},
 	{0xc3, 0x1f},
 	{0xc4, 0xff},
 	{0x3d, 0x48},
@@ -515,6 +518,7 @@ static const struct sensor_reg ov2643_yuv_svga[] = {
 
 static const struct sensor_reg ov2643_yuv_vga[] = {
 	{0x12, 0x80},
+	{SENSOR_REG_DELAY, 5},
 	{0xc3, 0x1f},
 	{0xc4, 0xff},
 	{0x3d, 0x48},
@@ -687,6 +691,7 @@ static const struct sensor_reg ov2643_yuv_vga[] = {
 
 static const struct sensor_reg ov2643_raw_vga[] = {
 	{0x12, 0x80},
+	{SENSOR_REG_DELAY, 5},
 	{0xc3, 0x1f},
 	{0xc4, 0xff},
 	{0x3d, 0x48},
@@ -856,6 +861,7 @@ static const struct sensor_reg ov2643_raw_vga[] = {
 
 static const struct sensor_reg ov2643_yuv_qvga[] = {
 	{0x12, 0x80},
+	{SENSOR_REG_DELAY, 5},
 	{0xc3, 0x1f},
 	{0xc4, 0xff},
 	{0x3d, 0x48},
@@ -1032,6 +1038,7 @@ static const struct sensor_reg ov2643_yuv_qvga[] = {
 
 static const struct sensor_reg ov2643_raw_qvga[] = {
 	{0x12, 0x80},
+	{SENSOR_REG_DELAY, 5},
 	{0xc3, 0x1f},
 	{0xc4, 0xff},
 	{0x3d, 0x48},
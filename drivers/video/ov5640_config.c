@@ -56,7 +56,7 @@
 static const struct sensor_reg ov5640_raw_qvga[] = {
 	{0x3103, 0x11},
 	{0x3008, 0x82},
-	{0xFFFF, 0x05},
+	{SENSOR_REG_DELAY, 5},
 	{0x3008, 0x42},
 	{0x3103, 0x03},
 	{0x3017, 0xff},
@@ -187,7 +187,7 @@ static const struct sensor_reg ov5640_raw_qvga[] = {
 static const struct sensor_reg ov5640_yuv_qvga[] = {
 	{0x3103, 0x11},
 	{0x3008, 0x82},
-	{0xFFFF, 0x05},
+	{SENSOR_REG_DELAY, 5},
 	{0x3008, 0x42},
 	{0x3103, 0x03},
 	{0x3017, 0xff},
@@ -490,7 +490,7 @@ static const struct sensor_reg ov5640_yuv_qvga[] = {
 static const struct sensor_reg ov5640_yuv_vga[] = {
 	{0x3103, 0x11},
 	{0x3008, 0x82},
-	{0xFFFF, 0x05},
+	{SENSOR_REG_DELAY, 5},
 	{0x3008, 0x42},
 	{0x3103, 0x03},
 	{0x3017, 0xff},
@@ -790,7 +790,7 @@ static const struct sensor_reg ov5640_yuv_vga[] = {
 static const struct sensor_reg ov5640_yuv_wxga[] = {
 	{0x3103, 0x11},
 	{0x3008, 0x82},
-	{0xFFFF, 0x05},
+	{SENSOR_REG_DELAY, 5},
 	{0x3008, 0x42},
 	{0x3103, 0x03},
 	{0x3017, 0xff},
@@ -5254,6 +5254,29 @@ static const struct sensor_output ov5640_output_wxga =
 static const struct sensor_output ov5640_output_af =
 { 1, 0, 0, 0, 1, 0, 0, ov5640_afc };
 
+/** AEC/AGC manual mode */
+static const struct sensor_reg ov5640_manual_exposure[] = {
+	{0x3503, 0x03},
+	{0xFF, 0xFF}
+};
+
+/** Exposure is 20-bit in 1/16 line (0x3500-0x3502), gain is 10-bit in 1/16
+ * (0x350a-0x350b). Maximum exposure follows VTS (0x3d8) and maximum gain the
+ * gain ceiling (0x3a18-0x3a19) of the settings above. */
+static const struct sensor_exposure ov5640_exposure = {
+	.manual = ov5640_manual_exposure,
+	.exposure_reg = { 0x3500, 0x3501, 0x3502 },
+	.exposure_len = 3,
+	.exposure_shift = 4,
+	.gain_reg = { 0x350a, 0x350b },
+	.gain_len = 2,
+	.gain_unit = 16,
+	.exposure_min = 1,
+	.exposure_max = 0x3d8 - 4,
+	.gain_min = 16,
+	.gain_max = 0xf8,
+};
+
 const struct sensor_profile ov5640_profile =
 {
 	"OV5640",
@@ -5273,5 +5296,7 @@ const struct sensor_profile ov5640_profile =
 		&ov5640_output_af,
 		0,
 		0
-	}
+	},
+	SENSOR_TWI_AUTO_INC,             /* TWI access flags */
+	&ov5640_exposure,                /* manual exposure control */
 };
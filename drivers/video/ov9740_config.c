@@ -57,6 +57,7 @@ static const struct sensor_reg ov9740_yuv_vga[] = {
 
 	/* Software RESET */
 	{0x0103, 0x01},
+	{SENSOR_REG_DELAY, 5},
 
 	/* Orientation */
 	{0x0101, 0x01},
@@ -426,6 +427,7 @@ static const struct sensor_reg ov9740_yuv_vga[] = {
 static const struct sensor_reg ov9740_yuv_wxga[] = {
 	/* WXGA 1280x720 YUV DVP 15FPS for card reader */
 	{0x0103, 0x01},
+	{SENSOR_REG_DELAY, 5},
 	{0x3026, 0x00},
 	{0x3027, 0x00},
 	{0x3002, 0xe8},
@@ -706,6 +708,7 @@ static const struct sensor_reg ov9740_raw_qvga[] = {
 
 	/* Software RESET */
 	{0x0103, 0x01},
+	{SENSOR_REG_DELAY, 5},
 
 	/* Orientation */
 	{0x0101, 0x01},
@@ -1153,6 +1156,7 @@ static const struct sensor_reg ov9740_yuv_qvga[] = {
 
 	/* Software RESET */
 	{0x0103, 0x01},
+	{SENSOR_REG_DELAY, 5},
 
 	/* Orientation */
 	{0x0101, 0x01},
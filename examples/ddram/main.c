@@ -43,9 +43,11 @@
  *
  * \section Description
  *
- * This example shows how to configure SDRMA/DDR/LPDDR/DDR2/LPDDR2 with MPDDR 
- * controller. This example write data and read back to compares the result 
- * against the initial value.
+ * This example shows how to configure SDRMA/DDR/LPDDR/DDR2/LPDDR2 with MPDDR
+ * controller. After a quick data and address bus test, the memory is filled
+ * with several test patterns (walking ones/zeros, checkerboard, address,
+ * pseudo-random) using memory-to-memory DMA transfers while the CPU checks
+ * the parts already written.
  *
  * \section Usage
  *
@@ -79,6 +81,7 @@
  * - ddram/main.c
  * - extram/ddram.c
  * - extram/mpddrc.c
+ * - extram/memtest.c
  * - extram/smc.c
  */
 
@@ -98,6 +101,11 @@
 
 #include "board.h"
 #include "board_console.h"
+#include "errno.h"
+#include "intmath.h"
+#include "dma/dma.h"
+#include "extram/memtest.h"
+#include "mm/cache.h"
 #include "mm/l1cache.h"
 #include "rand.h"
 #include "serial/console.h"
@@ -108,79 +116,89 @@
  *        Local definitions
  *----------------------------------------------------------------------------*/
 
-/* size of the random data buffer (in bytes) */
-#define BUFFER_SIZE (4096)
+/* size of the DMA staging buffer (in bytes), split in two blocks */
+#define STAGE_SIZE (2 * 8192)
 
 /*----------------------------------------------------------------------------
  *        Local variables
  *----------------------------------------------------------------------------*/
 
-static uint8_t random_buffer[BUFFER_SIZE];
+CACHE_ALIGNED static uint32_t stage_buffer[STAGE_SIZE / sizeof(uint32_t)];
+
+static const enum _memtest_pattern test_patterns[] = {
+	MEMTEST_WALKING_ONES,
+	MEMTEST_WALKING_ZEROS,
+	MEMTEST_CHECKERBOARD,
+	MEMTEST_ADDRESS,
+	MEMTEST_INV_ADDRESS,
+	MEMTEST_RANDOM,
+};
 
 /*----------------------------------------------------------------------------
  *        Local functions
  *----------------------------------------------------------------------------*/
 
 /**
- * \brief Test DDRAM access
+ * \brief Test DDRAM buses
  * \param baseAddr Base address of DDRAM
  * \param size  Size of memory in bytes
- * \return 1: OK, 0: Error
+ * \return true if passed
  */
-static bool _ddram_access(uint32_t baseAddr, uint32_t size)
+static bool _ddram_bus_test(uint32_t baseAddr, uint32_t size)
 {
-	uint32_t offset, count;
-	uint8_t *ptr = (uint8_t*)baseAddr;
-	int percent, percent_old;
-
-	percent_old = -1;
-	for (offset = 0; offset < size; offset += count) {
-		count = BUFFER_SIZE;
-		if (count > (size - offset))
-			count = size - offset;
-
-		memcpy(ptr + offset, random_buffer, count);
-
-		if (memcmp(ptr + offset, random_buffer, count)) {
-			printf("Error in range 0x%x-0x%x\r\n", (unsigned)(ptr + offset),
-					(unsigned)(ptr + offset + count));
-			return false;
-		}
-
-		percent =  offset / (size / 100);
-		if (percent != percent_old) {
-			percent_old = percent;
-			printf("%d%%\r", percent);
-		}
+	if (memtest_data_bus(baseAddr) < 0) {
+		printf("Data bus test failed\r\n");
+		return false;
+	}
+	if (memtest_address_bus(baseAddr, size) < 0) {
+		printf("Address bus test failed\r\n");
+		return false;
 	}
-
 	return true;
 }
 
 static void _ddram_test_loop(uint32_t baseAddr, uint32_t size)
 {
-	int i, passed, failed;
+	struct _memtest_cfg cfg = {
+		.addr = baseAddr,
+		.size = size,
+		.patterns = test_patterns,
+		.pattern_count = ARRAY_SIZE(test_patterns),
+		.stage = stage_buffer,
+		.stage_size = sizeof(stage_buffer),
+		.use_dma = true,
+	};
+	struct _memtest_result result;
+	int passed, failed, err;
 	uint64_t start, end;
-	bool ok;
+	uint32_t mbytes;
 
 	passed = 0;
 	failed = 0;
 	while (1) {
-		for (i = 0; i < BUFFER_SIZE/4; i++)
-			((uint32_t*)random_buffer)[i] = rand();
+		cfg.seed = rand();
 
 		start = timer_get_tick();
-		ok = _ddram_access(baseAddr, size);
+		err = memtest_run(&cfg, &result);
 		end = timer_get_tick();
 
-		if (ok) {
+		/* each pattern is written once and read once */
+		mbytes = (size >> 20) * 2 * ARRAY_SIZE(test_patterns);
+		if (err == 0) {
 			passed++;
-			printf("Test Passed (passed=%d, failed=%d) (%ums)\r\n",
-					passed, failed, (unsigned)(end - start));
-		} else {
+			printf("Test Passed (passed=%d, failed=%d) (%ums, %uMB/s)\r\n",
+					passed, failed, (unsigned)(end - start),
+					(unsigned)(mbytes * 1000 / max_u32(end - start, 1)));
+		} else if (err == -EIO) {
 			failed++;
 			printf("Test Failed (passed=%d, failed=%d) (%ums)\r\n",
 					passed, failed, (unsigned)(end - start));
+			printf("%u errors, first at 0x%08x: expected 0x%08x, read 0x%08x\r\n",
+					(unsigned)result.errors, (unsigned)result.first_addr,
+					(unsigned)result.expected, (unsigned)result.actual);
+		} else {
+			printf("Cannot run test (%d)\r\n", err);
+			return;
 		}
 	}
 }
@@ -214,9 +232,13 @@ int main(void)
 	/* Full test DDRAM  */
 	trace_info("Starting memory validation of External DDRAM (%u MB)\n\r",
 	           (unsigned)(BOARD_DDR_MEMORY_SIZE/(1024*1024)));
-	trace_info("Buffer: %u bytes at 0x%08x\r\n", BUFFER_SIZE,
-	           (unsigned)random_buffer);
+	trace_info("Staging buffer: %u bytes at 0x%08x\r\n", STAGE_SIZE,
+	           (unsigned)stage_buffer);
+
+	/* Memory-to-memory DMA fills the DDRAM while the CPU checks it */
+	dma_initialize(false);
 
-	_ddram_test_loop(DDR_CS_ADDR, BOARD_DDR_MEMORY_SIZE);
+	if (_ddram_bus_test(DDR_CS_ADDR, BOARD_DDR_MEMORY_SIZE))
+		_ddram_test_loop(DDR_CS_ADDR, BOARD_DDR_MEMORY_SIZE);
 	return 0;
 }
@@ -118,6 +118,14 @@
 #include "lwip/apps/lwiperf.h"
 #include "lwip/prot/dhcp.h"
 
+#if defined(CONFIG_HAVE_AES) && defined(CONFIG_HAVE_TRNG)
+#include "arch/sys_arch.h"
+#include "crypto/aesd.h"
+#include "crypto/drbg.h"
+#include "crypto/trngd.h"
+#endif
+
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -137,10 +145,36 @@ static const uint8_t _gw_ip_addr[4] = {192, 168, 1, 2};
 /* The NetMask address */
 static const uint8_t _netmask[4] = {255, 255, 255, 0};
 
+#if defined(CONFIG_HAVE_AES) && defined(CONFIG_HAVE_TRNG)
+/* AES driver and DRBG feeding LWIP_RAND() */
+static struct _aesd_desc _aesd;
+static struct _drbg_desc _drbg = { .aes = &_aesd };
+#endif
+
 /*----------------------------------------------------------------------------
  *        Local functions
  *----------------------------------------------------------------------------*/
 
+#if defined(CONFIG_HAVE_AES) && defined(CONFIG_HAVE_TRNG)
+static void _rand_init(void)
+{
+	int err;
+
+	trngd_init();
+	aesd_init(&_aesd);
+
+	/* wait for the TRNG entropy pool to hold a full seed */
+	do {
+		err = drbg_instantiate(&_drbg, NULL, NULL);
+	} while (err == -EAGAIN);
+
+	if (err < 0)
+		printf("-W- DRBG not available (%d), using software rand()\r\n", err);
+	else
+		sys_set_rand_drbg(&_drbg);
+}
+#endif
+
 static void
 lwiperf_report(void *arg, enum lwiperf_report_type report_type,
 	       const ip_addr_t* local_addr, u16_t local_port, const ip_addr_t* remote_addr, u16_t remote_port,
@@ -195,6 +229,11 @@ int main(void)
 	printf(" - DHCP Enabled\n\r");
 #endif
 
+#if defined(CONFIG_HAVE_AES) && defined(CONFIG_HAVE_TRNG)
+	/* TCP initial sequence numbers and local ports from the DRBG */
+	_rand_init();
+#endif
+
 	/* Initialize lwIP modules */
 	lwip_init();
 
@@ -0,0 +1,386 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ *  \page FreeRTOS-sdcard FreeRTOS SD Card with SAMA5D2 and SAM9X60 MPUs
+ *
+ *  \section Purpose
+ *
+ *  The FreeRTOS SD Card example shows how to access the file systems of
+ *  several SD/MMC devices from concurrent FreeRTOS tasks.
+ *
+ *  \section Requirements
+ *
+ *  This package is compatible with the evaluation boards listed below:
+ *  - SAMA5D2-PTC-EK
+ *  - SAMA5D2-XPLAINED
+ *  - SAMA5D27-SOM1-EK
+ *  - SAM9X60-EK
+ *
+ *  A FAT formatted device shall be inserted in each slot.
+ *
+ *  \section Description
+ *
+ *  One task is created per slot. Each task mounts the volume of its slot,
+ *  then repeatedly writes a file, reads it back and checks its contents.
+ *
+ *  FatFs is built with _FS_REENTRANT: each volume, and each drive of the
+ *  sector cache, is protected by its own mutex (see ff_freertos.c and
+ *  diskcache.c), so the two tasks do not wait for each other. The SD/MMC
+ *  commands suspend the calling task until the driver interrupt signals
+ *  their completion (see sdmmc_freertos.c), the other task runs meanwhile.
+ *
+ *  \section Usage
+ *
+ *  -# Build the program and download it inside the evaluation board. Please
+ *     refer to the
+ *     <a href="http://www.atmel.com/dyn/resources/prod_documents/6421B.pdf">
+ *     SAM-BA User Guide</a>, the
+ *     <a href="http://www.atmel.com/dyn/resources/prod_documents/doc6310.pdf">
+ *     GNU-Based Software Development</a>
+ *     application note or to the
+ *     <a href="ftp://ftp.iar.se/WWWfiles/arm/Guides/EWARM_UserGuide.ENU.pdf">
+ *     IAR EWARM User Guide</a>,
+ *     depending on your chosen solution.
+ *  -# On the computer, open and configure a terminal application
+ *     (e.g. HyperTerminal on Microsoft Windows) with these settings:
+ *    - 115200 bauds
+ *    - 8 bits of data
+ *    - No parity
+ *    - 1 stop bit
+ *    - No flow control
+ *  -# Start the application.
+ *  -# In the terminal window, the following text should appear (values
+ *     depend on the board and chip used):
+ *     \code
+ *      -- FreeRTOS SD Card Example xxx --
+ *      -- SAMxxxxx-xx
+ *      -- Compiled: xxx xx xxxx xx:xx:xx --
+ *      Slot0: pass 0, 1024 KB written and checked in xxx ms
+ *      Slot1: pass 0, 1024 KB written and checked in xxx ms
+ *     \endcode
+ *
+ *  \section References
+ *  - freertos_sdcard/main.c
+ *  - sdmmc_freertos.c
+ *  - ff_freertos.c
+ *  - diskcache.c
+ */
+
+/** \file
+ *
+ *  This file contains all the specific code for the FreeRTOS-sdcard example.
+ *
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "board.h"
+#include "chip.h"
+#include "trace.h"
+#include "compiler.h"
+
+#include "mm/cache.h"
+#include "serial/console.h"
+
+#include "sdmmc/sdmmc.h"
+
+#include "libsdmmc/libsdmmc.h"
+#include "libsdmmc/sdmmc_freertos.h"
+#include "fatfs/src/ff.h"
+#if _USE_DISKCACHE
+#include "fatfs/softpack/diskcache.h"
+#endif
+
+/* FreeRTOS files */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <assert.h>
+
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define DMADL_CNT_MAX               512u
+
+/* Size of the file written and checked by each task, and size of the
+ * f_write() and f_read() requests */
+#define FILE_SIZE                   (1024ul * 1024)
+#define CHUNK_SIZE                  (32ul * 1024)
+
+/* Delay between two passes */
+#define PASS_DELAY_MS               1000
+
+#define SDCARD_TASK_PRIORITY        (tskIDLE_PRIORITY + 1)
+#define SDCARD_TASK_STACK_SIZE      (configMINIMAL_STACK_SIZE * 8)
+
+/* Allocate 2 Timers/Counters, that are not used already by the libraries and
+ * drivers this example depends on. */
+#define TIMER0_MODULE               ID_TC0
+#define TIMER0_CHANNEL              0
+#define TIMER1_MODULE               ID_TC0
+#define TIMER1_CHANNEL              1u
+
+#if defined(CONFIG_BOARD_SAMA5D2_PTC_EK) ||\
+    defined(CONFIG_BOARD_SAMA5D2_XPLAINED) ||\
+    defined(CONFIG_BOARD_SAMA5D27_SOM1_EK)
+#  define SLOT0_ID                  ID_SDMMC0
+#  define SLOT1_ID                  ID_SDMMC1
+#  define SLOT_COUNT                2
+#elif defined(CONFIG_BOARD_SAM9X60_EK)
+#  define SLOT0_ID                  ID_SDMMC0
+#  define SLOT_COUNT                1
+#else
+#  error Unsupported board
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Local variables
+ *----------------------------------------------------------------------------*/
+
+static const char test_file_name[] = "rtos.bin";
+
+/* Driver instance data (a.k.a. MCI driver instance) */
+static struct sdmmc_set drv[SLOT_COUNT];
+
+/* Library instance data (a.k.a. SDCard driver instance) */
+CACHE_ALIGNED_DDR static sSdCard lib[SLOT_COUNT];
+
+/* On MPUs that miss standard SDMMC_CD input(s), we should provide here a
+ * board-specific card detection routine that reads general-purpose I/O(s) */
+#ifdef BOARD_SDMMC0_PIN_CD
+bool (*const is_cd0)(uint32_t sdmmc_id) = board_get_sdmmc_card_detect_status;
+#else
+bool (*const is_cd0)(uint32_t sdmmc_id) = NULL;
+#endif
+
+#if defined(BOARD_SDMMC1_PIN_CD) && defined(SLOT1_ID)
+bool (*const is_cd1)(uint32_t sdmmc_id) = board_get_sdmmc_card_detect_status;
+#else
+bool (*const is_cd1)(uint32_t sdmmc_id) = NULL;
+#endif
+
+/* DMA descriptor tables, one per slot since both slots transfer at the
+ * same time */
+CACHE_ALIGNED_DDR static uint32_t dma_table[SLOT_COUNT][DMADL_CNT_MAX * SDMMC_DMADL_SIZE];
+
+/* Data buffers of the tasks. They receive data transferred by the DMA, see
+ * the notes about cache line alignment in the sdmmc_sdcard example. */
+CACHE_ALIGNED_DDR static uint8_t write_buf[SLOT_COUNT][CHUNK_SIZE];
+CACHE_ALIGNED_DDR static uint8_t read_buf[SLOT_COUNT][CHUNK_SIZE];
+
+NOT_CACHED static FATFS fs_header[SLOT_COUNT];
+NOT_CACHED static FIL f_header[SLOT_COUNT];
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static void fill_chunk(uint8_t *buf, uint32_t pass, uint32_t offset)
+{
+	uint32_t *word = (uint32_t *)buf;
+	uint32_t ix;
+
+	for (ix = 0; ix < CHUNK_SIZE / 4; ix++)
+		word[ix] = (pass << 24) ^ (offset + ix * 4);
+}
+
+static bool write_file(uint8_t slot_ix, const TCHAR *file_path, uint32_t pass)
+{
+	FIL *file = &f_header[slot_ix];
+	uint32_t offset;
+	UINT len;
+	FRESULT res;
+
+	res = f_open(file, file_path, FA_CREATE_ALWAYS | FA_WRITE);
+	if (res != FR_OK) {
+		printf("Slot%u: failed to create \"%s\", error %d\n\r", slot_ix,
+		    file_path, res);
+		return false;
+	}
+	for (offset = 0; offset < FILE_SIZE; offset += CHUNK_SIZE) {
+		fill_chunk(write_buf[slot_ix], pass, offset);
+		res = f_write(file, write_buf[slot_ix], CHUNK_SIZE, &len);
+		if (res != FR_OK || len != CHUNK_SIZE) {
+			printf("Slot%u: write error %d\n\r", slot_ix, res);
+			f_close(file);
+			return false;
+		}
+	}
+	res = f_close(file);
+	if (res != FR_OK) {
+		printf("Slot%u: failed to close \"%s\", error %d\n\r", slot_ix,
+		    file_path, res);
+		return false;
+	}
+	return true;
+}
+
+static bool check_file(uint8_t slot_ix, const TCHAR *file_path, uint32_t pass)
+{
+	FIL *file = &f_header[slot_ix];
+	uint32_t offset;
+	UINT len;
+	FRESULT res;
+	bool rc = true;
+
+	res = f_open(file, file_path, FA_OPEN_EXISTING | FA_READ);
+	if (res != FR_OK) {
+		printf("Slot%u: failed to open \"%s\", error %d\n\r", slot_ix,
+		    file_path, res);
+		return false;
+	}
+	for (offset = 0; rc && offset < FILE_SIZE; offset += CHUNK_SIZE) {
+		res = f_read(file, read_buf[slot_ix], CHUNK_SIZE, &len);
+		if (res != FR_OK || len != CHUNK_SIZE) {
+			printf("Slot%u: read error %d\n\r", slot_ix, res);
+			rc = false;
+			break;
+		}
+		fill_chunk(write_buf[slot_ix], pass, offset);
+		if (memcmp(read_buf[slot_ix], write_buf[slot_ix], CHUNK_SIZE)) {
+			printf("Slot%u: data mismatch in [%lu, %lu)\n\r", slot_ix,
+			    offset, offset + CHUNK_SIZE);
+			rc = false;
+		}
+	}
+	f_close(file);
+	return rc;
+}
+
+static void sdcard_task(void *param)
+{
+	const uint8_t slot_ix = (uint8_t)(uint32_t)param;
+	const TCHAR drive_path[] = { '0' + slot_ix, ':', '\0' };
+	TCHAR file_path[sizeof(drive_path) + sizeof(test_file_name)];
+	TickType_t start, ticks;
+	uint32_t pass, errors = 0;
+	FRESULT res;
+
+	/* Suspend the task while the commands sent to its device complete */
+	if (!sdmmc_freertos_init(&lib[slot_ix])) {
+		printf("Slot%u: out of memory\n\r", slot_ix);
+		vTaskDelete(NULL);
+	}
+
+	res = f_mount(&fs_header[slot_ix], drive_path, 1);
+	if (res != FR_OK) {
+		printf("Slot%u: failed to mount FAT file system, error %d\n\r",
+		    slot_ix, res);
+		sdmmc_freertos_deinit(&lib[slot_ix]);
+		vTaskDelete(NULL);
+	}
+#if _USE_DISKCACHE
+	diskcache_pin_fat(&fs_header[slot_ix]);
+#endif
+	strcpy(file_path, drive_path);
+	strcat(file_path, test_file_name);
+
+	for (pass = 0; ; pass++) {
+		start = xTaskGetTickCount();
+		if (!write_file(slot_ix, file_path, pass) ||
+		    !check_file(slot_ix, file_path, pass))
+			errors++;
+		ticks = xTaskGetTickCount() - start;
+		printf("Slot%u: pass %lu, %lu KB written and checked in %lu ms"
+		    ", %lu error(s)\n\r", slot_ix, pass, FILE_SIZE / 1024,
+		    (uint32_t)(ticks * portTICK_PERIOD_MS), errors);
+		vTaskDelay(PASS_DELAY_MS / portTICK_PERIOD_MS);
+	}
+}
+
+static void initialize(void)
+{
+	sdmmc_initialize(&drv[0], SLOT0_ID, TIMER0_MODULE, TIMER0_CHANNEL,
+	    dma_table[0], ARRAY_SIZE(dma_table[0]), false, is_cd0);
+	SDD_InitializeSdmmcMode(&lib[0], &drv[0], 0);
+
+#ifdef SLOT1_ID
+	sdmmc_initialize(&drv[1], SLOT1_ID, TIMER1_MODULE, TIMER1_CHANNEL,
+	    dma_table[1], ARRAY_SIZE(dma_table[1]), false, is_cd1);
+	SDD_InitializeSdmmcMode(&lib[1], &drv[1], 0);
+#endif
+
+#if _USE_DISKCACHE
+	/* Create the locks of the sector cache before the tasks start */
+	diskcache_init();
+#endif
+}
+
+/*----------------------------------------------------------------------------
+ *        Global functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Return the SD/MMC library instance of a slot, required by
+ * sdmmc_ff.c.
+ */
+bool SD_GetInstance(uint8_t index, sSdCard **holder);
+
+bool SD_GetInstance(uint8_t index, sSdCard **holder)
+{
+	assert(holder);
+
+	if (index >= SLOT_COUNT)
+		return false;
+	*holder = &lib[index];
+	return true;
+}
+
+/**
+ *  \brief FreeRTOS-sdcard Application entry point.
+ *
+ *  \return Unused (ANSI-C compatibility).
+ */
+int main(void)
+{
+	uint32_t slot_ix;
+
+	console_example_info("FreeRTOS SD Card Example");
+
+	initialize();
+
+	for (slot_ix = 0; slot_ix < SLOT_COUNT; slot_ix++)
+		xTaskCreate(sdcard_task, "SD", SDCARD_TASK_STACK_SIZE,
+		    (void *)slot_ix, SDCARD_TASK_PRIORITY, NULL);
+
+	/* Start the tasks */
+	vTaskStartScheduler();
+
+	/* Only reached if there was not enough heap to create the idle task */
+	for (;;);
+}
@@ -360,13 +360,15 @@ restart_sensor:
 				goto restart_sensor;
 			case 'A':
 			case 'a':
-				if (sensor_mode == RAW_BAYER)
+				if (sensor_mode == RAW_BAYER && !awb) {
+					iscd_3a_configure(NULL, SENSOR_TWI_BUS, sensor, NULL);
 					awb = true;
+				}
 				break;
 			}
 		}
 		if (awb)
-			iscd_auto_white_balance_ref_algo(iscd.pipe.histo_buf);
+			iscd_3a_process(iscd.pipe.histo_buf);
 	}
 
 }
@@ -75,6 +75,8 @@
  * -# Connect the audio xplained board to the A5D2 board first;
  * -# Press one of the keys listed in the menu to perform the corresponding action;
  * -# Press key '1' or key '2' to record the sound for a short time
+ * -# Press key '4' to record voice at 16 kHz through the PDMIC capture ring,
+ *    with DC removal, high-pass filtering and automatic gain control
  * -# press key '3' to display the sound information
  * -# press key '4' to playback the sound using CLASSD
  * -# press key '+' or key '-' to increase or decrease the recorded sound gain
@@ -100,6 +102,7 @@
 
 #include "audio/classd.h"
 #include "audio/pdmic.h"
+#include "audiodsp.h"
 #include "board.h"
 #include "chip.h"
 #include "compiler.h"
@@ -124,6 +127,13 @@
 
 #define INITIAL_ATTENUATION (10)
 
+/* voice recording: 10 ms capture periods, decimated to 16 kHz */
+#define VOICE_DECIMATION (3)
+
+#define VOICE_PERIOD_SAMPLES (SAMPLE_RATE / 100)
+
+#define VOICE_PERIODS (4)
+
 static const struct {
 	int8_t gain;
 	uint16_t dgain;
@@ -156,6 +166,33 @@ CACHE_ALIGNED_DDR static uint16_t _sound_buffer[SAMPLE_COUNT];
 
 static bool _sound_recorded = false;
 
+/* sample rate and number of samples of the recorded sound */
+static uint32_t _sound_rate = SAMPLE_RATE;
+static uint32_t _sound_count = SAMPLE_COUNT;
+
+CACHE_ALIGNED_DDR static int16_t _ring_buffer[VOICE_PERIODS * VOICE_PERIOD_SAMPLES];
+
+static volatile uint32_t _voice_count;
+
+/** 100 Hz Butterworth high-pass at 48 kHz */
+static const struct _audiodsp_biquad _voice_highpass = {
+	.b0 = 265961911,
+	.b1 = -531923821,
+	.b2 = 265961911,
+	.a1 = -531901035,
+	.a2 = 263511152,
+};
+
+/** Voice processing chain configuration */
+static struct _audiodsp_voice _voice = {
+	.rate = SAMPLE_RATE,
+	.decimation = VOICE_DECIMATION,
+	.dc_shift = 10,
+	.highpass = &_voice_highpass,
+	.agc_target = 8192,
+	.agc_max_gain_db = 30,
+};
+
 /** pdmic Configuration */
 static struct _pdmic_desc pdmic_desc = {
 	.addr = BOARD_PDMIC0_ADDR,
@@ -205,6 +242,7 @@ static void _display_menu(void)
 	printf("1 -> Record the sound with DMA\n\r");
 	printf("2 -> Record the sound for polling\n\r");
 	printf("3 -> Playback the record sound using CLASSD \n\r");
+	printf("4 -> Record voice (16kHz, AGC) with the DMA ring\n\r");
 	printf("+ -> Increase the gain of record sound(increased 10dB)\n\r");
 	printf("- -> Decrease the gain of record sound(reduced 10dB)\n\r");
 	printf("=>");
@@ -287,6 +325,8 @@ static void _record_sound_with_dma(void)
 	struct _callback _cb;
 
 	_record_start();
+	_sound_rate = SAMPLE_RATE;
+	_sound_count = SAMPLE_COUNT;
 
 	struct _buffer _rx = {
 		.data = (uint8_t*)_sound_buffer,
@@ -311,6 +351,8 @@ static void _record_sound_polling(void)
 	struct _callback _cb;
 
 	_record_start();
+	_sound_rate = SAMPLE_RATE;
+	_sound_count = SAMPLE_COUNT;
 
 	struct _buffer _rx = {
 		.data = (uint8_t*)_sound_buffer,
@@ -326,19 +368,75 @@ static void _record_sound_polling(void)
 	while (!pdmic_rx_transfer_is_done(&pdmic_desc));
 }
 
+/**
+ *  \brief Capture ring period callback: filter and decimate one period
+ *  into the sound buffer, stop the ring once the buffer is full.
+ */
+static int _voice_period_callback(void *arg1, void* arg2)
+{
+	struct _buffer* block = (struct _buffer*)arg2;
+	uint32_t count = block->size / sizeof(int16_t);
+
+	if (_voice_count + count / VOICE_DECIMATION > SAMPLE_COUNT) {
+		pdmic_ring_stop(&pdmic_desc);
+		return 0;
+	}
+
+	_voice_count += audiodsp_voice_process(&_voice,
+			(const int16_t*)block->data, count,
+			(int16_t*)_sound_buffer + _voice_count);
+	return 0;
+}
+
+/**
+ * \brief Record voice continuously with the PDMIC capture ring.
+ */
+static void _record_voice(void)
+{
+	struct _callback _cb;
+	struct _buffer _ring = {
+		.data = (uint8_t*)_ring_buffer,
+		.size = sizeof(_ring_buffer),
+		.attr = PDMIC_BUF_ATTR_READ,
+	};
+
+	if (audiodsp_voice_init(&_voice) < 0) {
+		printf("Voice chain configuration failed\r\n");
+		return;
+	}
+	_voice_count = 0;
+
+	_record_start();
+
+	callback_set(&_cb, _voice_period_callback, NULL);
+	if (pdmic_ring_start(&pdmic_desc, &_ring, VOICE_PERIODS, &_cb) < 0) {
+		printf("Capture ring start failed\r\n");
+		_record_stop();
+		_sound_recorded = false;
+		return;
+	}
+
+	while (!pdmic_rx_transfer_is_done(&pdmic_desc));
+
+	_record_stop();
+	_sound_rate = SAMPLE_RATE / VOICE_DECIMATION;
+	_sound_count = _voice_count;
+}
+
 /**
  * \brief Play wav format sound using CLASSD.
  */
 static void _playback_using_classd(void)
 {
 	/* our Classd support 16 bit sound only*/
-	uint32_t  audio_length = SAMPLE_COUNT * 2;
+	uint32_t  audio_length = _sound_count * 2;
 
 	if (!_sound_recorded) {
 	       printf("Please record the sound first\n\r");
 	       return;
 	}
 
+	classd_desc.sample_rate = _sound_rate;
 	classd_configure(&classd_desc);
 	classd_set_equalizer(&classd_desc, CLASSD_EQCFG_FLAT);
 
@@ -394,6 +492,8 @@ int main(void)
 			_record_sound_polling();
 		else if (key == '3')
 			_playback_using_classd();
+		else if (key == '4')
+			_record_voice();
 		else if (key == '+') {
 			if (gain < 70) {
 				gain += 10;
@@ -47,7 +47,7 @@
 /* This option switches fast seek function. (0:Disable or 1:Enable) */
 
 
-#define	_USE_EXPAND		0
+#define	_USE_EXPAND		1
 /* This option switches f_expand function. (0:Disable or 1:Enable) */
 
 
@@ -198,6 +198,18 @@
 */
 
 
+#define _USE_DISKCACHE	1
+#define _DISKCACHE_SECTORS	32
+#define _DISKCACHE_READ_AHEAD	8
+/* The option _USE_DISKCACHE switches the write-back sector cache inserted
+/  between FatFs and the disk I/O layer (lib/fatfs/softpack/diskcache.c).
+/  (0:Disable or 1:Enable)
+/  _DISKCACHE_SECTORS defines the number of cached sectors of each physical
+/  drive. _DISKCACHE_READ_AHEAD defines the number of sectors read in advance
+/  when a sequential access is detected. Dirty sectors are written back on
+/  eviction and on CTRL_SYNC. */
+
+
 
 /*---------------------------------------------------------------------------/
 / System Configurations
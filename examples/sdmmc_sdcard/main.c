@@ -93,6 +93,7 @@
  *          i: Display device info
  *	        l: Mount FAT file system and list files
  *          r: Read the file named test_data.bin
+ *          s: Stream 8 MB to the file named stream.bin
  *	        w: Perform a basic RAW read/write test.
  *     \endcode
  * -# Input command according to the menu.
@@ -130,6 +131,7 @@
 #include "mm/cache.h"
 #include "serial/console.h"
 #include "peripherals/pmc.h"
+#include "timer.h"
 
 #ifdef CONFIG_HAVE_SDMMC
 #  include "sdmmc/sdmmc.h"
@@ -142,6 +144,12 @@
 
 #include "libsdmmc/libsdmmc.h"
 #include "fatfs/src/ff.h"
+#if _USE_DISKCACHE
+#include "fatfs/softpack/diskcache.h"
+#endif
+#if _USE_EXPAND
+#include "fatfs/softpack/ffstream.h"
+#endif
 
 #include <assert.h>
 #include <stdio.h>
@@ -157,6 +165,9 @@
 #define DMADL_CNT_MAX               512u
 #define BLOCK_CNT                   3u
 
+/* Size of the file written by the streaming test */
+#define STREAM_SIZE                 (8ul * 1024 * 1024)
+
 /* Allocate 2 Timers/Counters, that are not used already by the libraries and
  * drivers this example depends on. */
 #define TIMER0_MODULE                 ID_TC0
@@ -226,6 +237,10 @@
 
 const char test_file_path[] = "test_data.bin";
 
+#if _USE_EXPAND
+const char stream_file_path[] = "stream.bin";
+#endif
+
 #ifdef CONFIG_HAVE_SDMMC
 
 /* Driver instance data (a.k.a. MCI driver instance) */
@@ -362,6 +377,10 @@ static void display_menu(void)
 	printf("   i: Display device info\n\r");
 	printf("   l: Mount FAT file system and list files\n\r");
 	printf("   r: Read the file named '%s'\n\r", test_file_path);
+#if _USE_EXPAND
+	printf("   s: Stream %lu MB to the file named '%s'\n\r",
+	    STREAM_SIZE / (1024 * 1024), stream_file_path);
+#endif
 	printf("   w: Perform a basic RAW read/write test.\n\r");
 	printf("\n\r");
 }
@@ -468,6 +487,9 @@ static bool mount_volume(uint8_t slot_ix, sSdCard *pSd, FATFS *fs)
 		printf("Failed to mount FAT file system, error %d\n\r", res);
 		return false;
 	}
+#if _USE_DISKCACHE
+	diskcache_pin_fat(fs);
+#endif
 	res = f_opendir(&dir, drive_path);
 	if (res != FR_OK) {
 		printf("Failed to change to root directory, error %d\n\r", res);
@@ -562,6 +584,66 @@ static bool read_file(uint8_t slot_ix, sSdCard *pSd, FATFS *fs)
 	return rc;
 }
 
+#if _USE_EXPAND
+/**
+ * \brief Write a file through a stream: its clusters are preallocated as one
+ * contiguous block and data_buf is written to the media with multi-block
+ * requests, without going through the FatFs sector window.
+ */
+static bool stream_file(uint8_t slot_ix, sSdCard *pSd, FATFS *fs)
+{
+	const TCHAR drive_path[] = { '0' + slot_ix, ':', '\0' };
+	const UINT buf_size = BLOCK_CNT_MAX * 512ul;
+	TCHAR file_path[sizeof(drive_path) + sizeof(stream_file_path)];
+	struct _ffstream stream;
+	DWORD lba, sectors;
+	uint64_t start;
+	uint32_t written, elapsed;
+	FRESULT res;
+
+	memset(fs, 0, sizeof(FATFS));
+	res = f_mount(fs, drive_path, 1);
+	if (res != FR_OK) {
+		printf("Failed to mount FAT file system, error %d\n\r", res);
+		return false;
+	}
+	strcpy(file_path, drive_path);
+	strcat(file_path, stream_file_path);
+	res = ffstream_create(&stream, &f_header, file_path, STREAM_SIZE);
+	if (res != FR_OK) {
+		printf("Failed to preallocate \"%s\", error %d\n\r",
+		    file_path, res);
+		return false;
+	}
+	ffstream_get_extent(&stream, &lba, &sectors);
+	printf("Writing %lu bytes to blocks #%lu-%lu\n\r", STREAM_SIZE,
+	    lba, lba + sectors - 1);
+
+	memset(data_buf, 0xa5, buf_size);
+	written = 0;
+	start = timer_get_tick();
+	while (ffstream_get_free(&stream) >= buf_size) {
+		res = ffstream_write(&stream, data_buf, buf_size);
+		if (res != FR_OK) {
+			printf("Error %d while attempting to write file\n\r",
+			    res);
+			break;
+		}
+		written += buf_size;
+	}
+	elapsed = (uint32_t)timer_get_interval(start, timer_get_tick());
+
+	res = ffstream_close(&stream);
+	if (res != FR_OK) {
+		trace_error("Failed to close file, error %d\n\r", res);
+		return false;
+	}
+	printf("Wrote %lu bytes in %lu ms (%lu KB/s)\n\r", written, elapsed,
+	    elapsed ? written / elapsed : 0);
+	return true;
+}
+#endif
+
 static bool unmount_volume(uint8_t slot_ix, sSdCard *pSd)
 {
 	const TCHAR drive_path[] = { '0' + slot_ix, ':', '\0' };
@@ -733,6 +815,9 @@ int main(void)
 	}
 #endif
 	initialize();
+#if _USE_DISKCACHE
+	diskcache_init();
+#endif
 
 	/* Display menu */
 	slot = 0;
@@ -784,6 +869,20 @@ int main(void)
 			read_file(slot, lib, &fs_header);
 			unmount_volume(slot, lib);
 			break;
+#if _USE_EXPAND
+		case 's':
+			if (SD_GetStatus(lib) == SDMMC_NOT_SUPPORTED) {
+				printf("Device not detected.\n\r");
+				break;
+			}
+			if (SD_GetWpStatus(lib) == SDMMC_LOCKED) {
+				printf("Device is write protected.\n\r");
+				break;
+			}
+			stream_file(slot, lib, &fs_header);
+			unmount_volume(slot, lib);
+			break;
+#endif
 		case 'w':
 			if (SD_GetStatus(lib) == SDMMC_NOT_SUPPORTED) {
 				printf("Device not detected.\n\r");
@@ -84,9 +84,13 @@
  *     device list.
  *  -# You can play sound in host side through the USB Audio Device, and it
  *     can be heard from the speaker connected to the EK.
+ *  -# Press 'b' in the terminal to mix a beep on top of the stream, the
+ *     stream is lowered while the beep plays. Press 'e' to toggle the bass
+ *     boost equalizer.
  *
  *  \section References
  *  - usb_audio_multi_channels/main.c
+ *  - audiodsp: audio processing library
  *  - usb: USB Framework, Audio Device Class driver and UDP interface driver
  *      - \ref usbd_framework
  *      - \ref usbd_api
@@ -111,6 +115,7 @@
 #include <assert.h>
 
 #include "audio/audio_device.h"
+#include "audiodsp.h"
 #include "board.h"
 #include "callback.h"
 #include "chip.h"
@@ -144,6 +149,12 @@
      after data has been received. */
 #define BUFFER_THRESHOLD (8)
 
+/**  Beep length in frames (100 ms). */
+#define BEEP_FRAMES (AUDDSpeakerDriver_SAMPLERATE / 10)
+
+/**  Samples in one period of the 1 kHz beep. */
+#define BEEP_PERIOD (AUDDSpeakerDriver_SAMPLERATE / 1000)
+
 /*----------------------------------------------------------------------------
  *         External variables
  *----------------------------------------------------------------------------*/
@@ -161,6 +172,56 @@ CACHE_ALIGNED static uint8_t _buffer[BUFFERS][BUFFER_SIZE];
 /**  Number of samples stored in each data buffer. */
 static uint32_t _samples[BUFFERS];
 
+/**  Processing of the received stream before it is sent to the DAC. */
+static struct _audiodsp _dsp = {
+	.in_format = AUDIODSP_S16,
+	.in_channels = AUDDSpeakerDriver_NUMCHANNELS,
+	.out_format = AUDIODSP_S16,
+	.out_channels = AUDDSpeakerDriver_NUMCHANNELS,
+	/* gain changes last 10 ms */
+	.ramp = AUDDSpeakerDriver_SAMPLERATE / 100,
+};
+
+/**  Bass boost stage, flat when disabled. */
+static int _bass_stage;
+static bool _bass_enabled;
+
+/**  Stream gain stage, ducks the stream while beeping. */
+static int _duck_stage;
+
+/**  1 kHz mono beep mixed on top of the stream. */
+static int16_t _beep[BEEP_FRAMES];
+
+/**  One period of a full scale 1 kHz sine at 48 kHz. */
+static const int16_t _sine[BEEP_PERIOD] = {
+	0, 4277, 8481, 12539, 16383, 19947, 23170, 25996,
+	28377, 30273, 31650, 32487, 32767, 32487, 31650, 30273,
+	28377, 25996, 23170, 19947, 16383, 12539, 8481, 4277,
+	0, -4277, -8481, -12539, -16383, -19947, -23170, -25996,
+	-28377, -30273, -31650, -32487, -32767, -32487, -31650, -30273,
+	-28377, -25996, -23170, -19947, -16383, -12539, -8481, -4277,
+};
+
+/**  Flat response, bass boost disabled. */
+static const struct _audiodsp_biquad _bass_flat = {
+	.b0 = 1 << AUDIODSP_BIQUAD_SHIFT,
+};
+
+/**  Bass boost: 150 Hz low shelf, Q 0.707, +9 dB at 48 kHz. */
+static const struct _audiodsp_biquad _bass_boost = {
+	.b0 = 270395259,
+	.b1 = -531061877,
+	.b2 = 260838517,
+	.a1 = -531117331,
+	.a2 = 262742867,
+};
+
+static struct _audiodsp_source _beep_source = {
+	.format = AUDIODSP_S16,
+	.channels = 1,
+	.gain = AUDIODSP_GAIN(0.5),
+};
+
 /**  Audio context */
 static struct _audio_ctx {
 	uint32_t* samples;
@@ -188,6 +249,15 @@ static struct _audio_ctx {
  *         Internal functions
  *----------------------------------------------------------------------------*/
 
+/**
+ *  \brief Run the DSP pipeline in place on a received buffer
+ */
+static void _audio_process(uint16_t index)
+{
+	audiodsp_process(&_dsp, _buffer[index], _buffer[index],
+			_audio_ctx.samples[index] / AUDDSpeakerDriver_BYTESPERSUBFRAME);
+}
+
 /**
  *  \brief Audio TX callback
  */
@@ -200,6 +270,7 @@ static int _audio_transfer_callback(void* arg1, void* arg2)
 		_audio_ctx.circ.tx = (_audio_ctx.circ.tx + 1) % BUFFERS;
 		_audio_ctx.circ.count--;
 		/* Load next buffer */
+		_audio_process(_audio_ctx.circ.tx);
 		callback_set(&_cb, _audio_transfer_callback, desc);
 		audio_transfer(desc,
 			       _buffer[_audio_ctx.circ.tx],
@@ -239,6 +310,7 @@ static void _usb_frame_recv_callback(void* arg, uint8_t status, uint32_t transfe
 				struct _callback _cb;
 
 				/* Start DAC transmission if necessary */
+				_audio_process(_audio_ctx.circ.tx);
 				callback_set(&_cb, _audio_transfer_callback, desc);
 				audio_transfer(desc,
 					       _buffer[_audio_ctx.circ.tx],
@@ -330,6 +402,47 @@ void audd_speaker_driver_stream_setting_changed(uint8_t new_setting)
 	}
 }
 
+/**
+ *  Invoked from the DSP pipeline when the beep has been mixed.
+ */
+static int _beep_done(void* arg, void* arg2)
+{
+	audiodsp_set_gain(&_dsp, _duck_stage, 0xff, AUDIODSP_GAIN_UNITY);
+	return 0;
+}
+
+static void _beep_start(void)
+{
+	struct _callback _cb;
+
+	callback_set(&_cb, _beep_done, NULL);
+	audiodsp_set_gain(&_dsp, _duck_stage, 0xff, AUDIODSP_GAIN(0.5));
+	audiodsp_play(&_dsp, &_beep_source, _beep, BEEP_FRAMES, &_cb);
+}
+
+static void _bass_set(bool enable)
+{
+	audiodsp_set_biquad(&_dsp, _bass_stage, enable ? &_bass_boost : &_bass_flat);
+	_bass_enabled = enable;
+	printf("Bass boost %s\r\n", enable ? "on" : "off");
+}
+
+/**
+ *  \brief Build the DSP pipeline: bass boost, stream ducking, beep mixing
+ */
+static void _dsp_configure(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < BEEP_FRAMES; i++)
+		_beep[i] = _sine[i % BEEP_PERIOD];
+
+	audiodsp_init(&_dsp);
+	_bass_stage = audiodsp_add_biquad(&_dsp, 0xff, &_bass_flat);
+	_duck_stage = audiodsp_add_gain(&_dsp, 0xff);
+	audiodsp_add_mix(&_dsp);
+}
+
 static void console_handler(uint8_t key)
 {
 	switch (key) {
@@ -356,6 +469,16 @@ static void console_handler(uint8_t key)
 		audio_mute(&audio_device, true);
 		break;
 
+	case 'b':
+	case 'B':
+		_beep_start();
+		break;
+
+	case 'e':
+	case 'E':
+		_bass_set(!_bass_enabled);
+		break;
+
 	default:
 		break;
 	}
@@ -392,6 +515,9 @@ int main(void)
 	/* Configure audio play volume */
 	audio_set_volume(&audio_device, _audio_ctx.volume);
 
+	/* Configure stream processing */
+	_dsp_configure();
+
 	/* USB audio driver initialization */
 	audd_speaker_driver_initialize(&audd_speaker_driver_descriptors);
 
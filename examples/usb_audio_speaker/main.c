@@ -122,7 +122,9 @@
 #include "serial/console.h"
 #include "trace.h"
 #include "../usb_common/main_usb_common.h"
+#include "usb/device/audio/audd_resampler.h"
 #include "usb/device/audio/audd_speaker_driver.h"
+#include "usb/device/audio/audd_sync.h"
 
 #if defined(CONFIG_BOARD_SAMA5D2_XPLAINED)
 	#include "config_sama5d2-xplained.h"
@@ -156,12 +158,24 @@
 #define BUFFERS (32)
 
 /**  Size of one buffer in bytes. */
-#define BUFFER_SIZE ROUND_UP_MULT(AUDDSpeakerDriver_BYTESPERFRAME, L1_CACHE_BYTES)
+#define BUFFER_SIZE ROUND_UP_MULT(AUDDSpeakerDriver_MAXBYTESPERFRAME, L1_CACHE_BYTES)
 
 /**  Delay (in number of buffers) before starting the DAC transmission
      after data has been received. */
 #define BUFFER_THRESHOLD (8)
 
+/**  Buffer level (in samples) the feedback endpoint regulates to. */
+#define SYNC_TARGET (BUFFER_THRESHOLD * AUDDSpeakerDriver_SAMPLESPERFRAME / \
+		AUDDSpeakerDriver_NUMCHANNELS)
+
+/**  Number of samples per channel sent to the DAC in resampling mode. */
+#define RESAMPLED_FRAMES (AUDDSpeakerDriver_SAMPLESPERFRAME / \
+		AUDDSpeakerDriver_NUMCHANNELS)
+
+/**  Size of one resampled buffer in bytes. */
+#define RESAMPLED_SIZE ROUND_UP_MULT(RESAMPLED_FRAMES * \
+		AUDDSpeakerDriver_BYTESPERSUBFRAME, L1_CACHE_BYTES)
+
 /*----------------------------------------------------------------------------
  *         External variables
  *----------------------------------------------------------------------------*/
@@ -179,6 +193,18 @@ CACHE_ALIGNED static uint8_t _buffer[BUFFERS][BUFFER_SIZE];
 /**  Number of samples stored in each data buffer. */
 static uint32_t _samples[BUFFERS];
 
+/**  Explicit feedback value sent to the USB host. */
+CACHE_ALIGNED static uint8_t _feedback[L1_CACHE_BYTES];
+
+/**  Host and DAC rate estimation for the explicit feedback. */
+static struct _audd_sync _sync;
+
+/**  Buffers sent to the DAC in resampling mode. */
+CACHE_ALIGNED static uint8_t _resampled[2][RESAMPLED_SIZE];
+
+/**  Resampler converting the host rate to the DAC rate. */
+static struct _audd_resampler _resampler;
+
 /**  Audio context */
 static struct _audio_ctx {
 	uint32_t* samples;
@@ -186,20 +212,32 @@ static struct _audio_ctx {
 	struct {
 		uint16_t rx;
 		uint16_t tx;
+		uint16_t tx_offset;
 		uint32_t count;
+		uint32_t bytes;
 	} circ;
+	uint32_t sent;
 	uint8_t volume;
 	bool playing;
+	bool resample;
+	bool resampling;
+	uint8_t resampled;
 } _audio_ctx = {
 	.samples = _samples,
 	.threshold = BUFFER_THRESHOLD,
 	.circ = {
 		.rx = 0,
 		.tx = 0,
+		.tx_offset = 0,
 		.count = 0,
+		.bytes = 0,
 	},
+	.sent = 0,
 	.volume =  (AUDIO_PLAY_MAX_VOLUME * 80) / 100,
 	.playing = false,
+	.resample = false,
+	.resampling = false,
+	.resampled = 0,
 };
 
 #ifdef PINS_PUSHBUTTONS
@@ -211,23 +249,95 @@ static const struct _pin button_pins[] = PINS_PUSHBUTTONS;
  *         Internal functions
  *----------------------------------------------------------------------------*/
 
+static int _audio_transfer_callback(void* arg, void* arg2);
+
+/**
+ *  \brief Resample the received buffers to one frame at the DAC rate and
+ *  send it to the DAC
+ *
+ *  The ratio follows the buffer level, so the playback stays in sync even
+ *  when the host ignores the explicit feedback.
+ */
+static void _audio_play_resampled(struct _audio_desc* desc)
+{
+	struct _callback _cb;
+	uint8_t* buffer = _resampled[_audio_ctx.resampled];
+	int16_t* out = (int16_t*)buffer;
+	uint32_t level = _audio_ctx.circ.bytes / AUDDSpeakerDriver_BYTESPERSUBFRAME;
+	uint32_t produced = 0;
+	uint32_t size;
+
+	audd_resampler_set_ratio(&_resampler, audd_sync_get_ratio(&_sync, level));
+
+	while (produced < RESAMPLED_FRAMES && _audio_ctx.circ.count > 0) {
+		uint16_t tx = _audio_ctx.circ.tx;
+		uint32_t offset = _audio_ctx.circ.tx_offset;
+		uint32_t used;
+
+		produced += audd_resampler_process(&_resampler,
+				(const int16_t*)&_buffer[tx][offset],
+				(_audio_ctx.samples[tx] - offset) / AUDDSpeakerDriver_BYTESPERSUBFRAME,
+				&out[produced * AUDDSpeakerDriver_NUMCHANNELS],
+				RESAMPLED_FRAMES - produced, &used);
+
+		used *= AUDDSpeakerDriver_BYTESPERSUBFRAME;
+		_audio_ctx.circ.tx_offset += used;
+		_audio_ctx.circ.bytes -= used;
+		if (_audio_ctx.circ.tx_offset >= _audio_ctx.samples[tx]) {
+			_audio_ctx.circ.tx_offset = 0;
+			_audio_ctx.circ.tx = (tx + 1) % BUFFERS;
+			_audio_ctx.circ.count--;
+		}
+	}
+
+	/* pad an underrun with silence */
+	if (produced < RESAMPLED_FRAMES)
+		memset(&out[produced * AUDDSpeakerDriver_NUMCHANNELS], 0,
+		       (RESAMPLED_FRAMES - produced) * AUDDSpeakerDriver_BYTESPERSUBFRAME);
+
+	size = RESAMPLED_FRAMES * AUDDSpeakerDriver_BYTESPERSUBFRAME;
+	cache_clean_region(buffer, size);
+	callback_set(&_cb, _audio_transfer_callback, desc);
+	audio_transfer(desc, buffer, size, &_cb);
+	_audio_ctx.sent = size;
+	_audio_ctx.resampled ^= 1;
+}
+
+/**
+ *  \brief Send the oldest received buffer to the DAC
+ */
+static void _audio_play_next(struct _audio_desc* desc)
+{
+	struct _callback _cb;
+	uint32_t size;
+
+	if (_audio_ctx.resampling) {
+		_audio_play_resampled(desc);
+		return;
+	}
+
+	size = _audio_ctx.samples[_audio_ctx.circ.tx];
+	callback_set(&_cb, _audio_transfer_callback, desc);
+	audio_transfer(desc, _buffer[_audio_ctx.circ.tx], size, &_cb);
+	_audio_ctx.sent = size;
+	_audio_ctx.circ.tx = (_audio_ctx.circ.tx + 1) % BUFFERS;
+	_audio_ctx.circ.count--;
+	_audio_ctx.circ.bytes -= size;
+}
+
 /**
  *  \brief Audio TX callback
  */
 static int _audio_transfer_callback(void* arg, void* arg2)
 {
 	struct _audio_desc* desc = (struct _audio_desc*)arg;
-	struct _callback _cb;
+
+	audd_sync_consumed(&_sync, _audio_ctx.sent / AUDDSpeakerDriver_BYTESPERSUBFRAME);
+	_audio_ctx.sent = 0;
 
 	if (_audio_ctx.circ.count > 0) {
-		_audio_ctx.circ.tx = (_audio_ctx.circ.tx + 1) % BUFFERS;
-		_audio_ctx.circ.count--;
 		/* Load next buffer */
-		callback_set(&_cb, _audio_transfer_callback, desc);
-		audio_transfer(desc,
-			       _buffer[_audio_ctx.circ.tx],
-			       _audio_ctx.samples[_audio_ctx.circ.tx],
-			       &_cb);
+		_audio_play_next(desc);
 	} else {
 		_audio_ctx.playing = false;
 		audio_enable(desc, false);
@@ -245,6 +355,11 @@ static void _usb_frame_recv_callback(void* arg, uint8_t status, uint32_t transfe
 
 	if (status == USBD_STATUS_SUCCESS) {
 		if (_audio_ctx.circ.count >= (BUFFERS - 1)) {
+			/* Should not happen while the host follows the
+			 * feedback, drop the oldest buffer */
+			_audio_ctx.circ.bytes -= _audio_ctx.samples[_audio_ctx.circ.tx] -
+				_audio_ctx.circ.tx_offset;
+			_audio_ctx.circ.tx_offset = 0;
 			_audio_ctx.circ.tx = (_audio_ctx.circ.tx + 1) % BUFFERS;
 			_audio_ctx.circ.count--;
 		}
@@ -252,23 +367,24 @@ static void _usb_frame_recv_callback(void* arg, uint8_t status, uint32_t transfe
 		_audio_ctx.samples[_audio_ctx.circ.rx] = transferred;
 		_audio_ctx.circ.rx = (_audio_ctx.circ.rx + 1) % BUFFERS;
 		_audio_ctx.circ.count++;
+		_audio_ctx.circ.bytes += transferred;
+
+		if (_audio_ctx.playing)
+			audd_sync_frame(&_sync, transferred / AUDDSpeakerDriver_BYTESPERSUBFRAME);
 
 		if (_audio_ctx.circ.count >= _audio_ctx.threshold) {
 			if (!_audio_ctx.playing) {
+				_audio_ctx.resampling = _audio_ctx.resample;
+				if (_audio_ctx.resampling)
+					audd_resampler_init(&_resampler,
+							AUDDSpeakerDriver_NUMCHANNELS);
 				audio_enable(desc, true);
+				audd_sync_restart(&_sync);
 				_audio_ctx.playing = true;
 			}
 			if (audio_transfer_is_done(&audio_device)) {
-				struct _callback _cb;
-
 				/* Start DAC transmission if necessary */
-				callback_set(&_cb, _audio_transfer_callback, desc);
-				audio_transfer(desc,
-					       _buffer[_audio_ctx.circ.tx],
-					       _audio_ctx.samples[_audio_ctx.circ.tx],
-					       &_cb);
-				_audio_ctx.circ.tx = (_audio_ctx.circ.tx + 1) % BUFFERS;
-				_audio_ctx.circ.count--;
+				_audio_play_next(desc);
 			}
 		}
 	} else if (status == USBD_STATUS_ABORTED) {
@@ -280,10 +396,24 @@ static void _usb_frame_recv_callback(void* arg, uint8_t status, uint32_t transfe
 
 	/* Receive next packet */
 	audd_speaker_driver_read(_buffer[_audio_ctx.circ.rx],
-				 AUDDSpeakerDriver_BYTESPERFRAME,
+				 AUDDSpeakerDriver_MAXBYTESPERFRAME,
 				 _usb_frame_recv_callback, desc);
 }
 
+/**
+ *  Invoked when a feedback value has been sent, queue the next one.
+ */
+static void _usb_feedback_callback(void* arg, uint8_t status, uint32_t transferred, uint32_t remaining)
+{
+	uint32_t level = _audio_ctx.circ.bytes / AUDDSpeakerDriver_BYTESPERSUBFRAME;
+	uint32_t length;
+
+	length = audd_sync_get_feedback(&_sync, level, usbd_is_high_speed(), _feedback);
+	cache_clean_region(_feedback, sizeof(_feedback));
+	audd_speaker_driver_write_feedback(_feedback, length,
+					   _usb_feedback_callback, arg);
+}
+
 static void console_handler(uint8_t key)
 {
 	switch (key) {
@@ -318,6 +448,13 @@ static void console_handler(uint8_t key)
 		audio_mute(&audio_device, true);
 		break;
 
+	case 'r':
+	case 'R':
+		/* applied when the playback restarts */
+		_audio_ctx.resample = !_audio_ctx.resample;
+		printf("Resampling %s\r\n", _audio_ctx.resample ? "on" : "off");
+		break;
+
 	default:
 		break;
 	}
@@ -430,6 +567,7 @@ void audd_speaker_driver_stream_setting_changed(uint8_t new_setting)
 		_audio_ctx.circ.count = 0;
 		_audio_ctx.circ.tx = 0;
 		_audio_ctx.circ.rx = 0;
+		_audio_ctx.circ.bytes = 0;
 	}
 }
 
@@ -446,9 +584,6 @@ int main(void)
 {
 	bool usb_conn = false;
 
-	int32_t jitter = 0, _jitter_curr;
-	int8_t clock_adjust = 0;
-
 	console_set_rx_handler(console_handler);
 	console_enable_rx_interrupt();
 
@@ -468,6 +603,10 @@ int main(void)
 	configure_buttons();
 #endif
 
+	/* Host rate follows the DAC through the explicit feedback endpoint */
+	audd_sync_init(&_sync, AUDDSpeakerDriver_SAMPLERATE, SYNC_TARGET,
+		       AUDDSpeakerDriverDescriptors_FB_REFRESH);
+
 	/* USB audio driver initialization */
 	audd_speaker_driver_initialize(&audd_speaker_driver_descriptors);
 
@@ -478,6 +617,7 @@ int main(void)
 	printf("Input '+' or '-' to increase or decrease volume\n\r");
 	printf("Input '0' or '1' to set volume to min / max\n\r");
 	printf("Input 'm' or 'u' to mute or unmute sound\n\r");
+	printf("Input 'r' to resample to the DAC clock on next playback\n\r");
 	printf("=========================================================\n\r");
 
 	/* Infinite loop */
@@ -487,28 +627,14 @@ int main(void)
 			continue;
 		}
 
-		_jitter_curr = (_audio_ctx.circ.count - _audio_ctx.threshold);
-
-		if (jitter != _jitter_curr) {
-			jitter = _jitter_curr;
-			if (jitter > 0 && clock_adjust != 1) {
-				/* USB too fast or SSC too slow: faster clock */
-				clock_adjust = 1;
-				audio_sync_adjust(&audio_device, clock_adjust);
-			}
-			if (jitter < 0 && clock_adjust != -1) {
-				/* USB too slow or SSC too fast: slower clock */
-				clock_adjust = -1;
-				audio_sync_adjust(&audio_device, clock_adjust);
-			}
-		}
-
 		if (!usb_conn) {
 			trace_info("USB connected\r\n");
 			/* Start Reading the incoming audio stream */
 			audd_speaker_driver_read(_buffer[_audio_ctx.circ.rx],
-					AUDDSpeakerDriver_BYTESPERFRAME,
+					AUDDSpeakerDriver_MAXBYTESPERFRAME,
 					_usb_frame_recv_callback, &audio_device);
+			/* Start sending the rate feedback */
+			_usb_feedback_callback(NULL, USBD_STATUS_SUCCESS, 0, 0);
 
 			usb_conn = true;
 		}
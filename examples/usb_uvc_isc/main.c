@@ -73,6 +73,9 @@
  * -# Once the device is connected and configured on windows XP,
  *    "USB Video Device" will appear in "My Computer", you can double click
  *    it to preview with default resolution - QVGA.
+ * -# On high speed, the camera also offers a MJPEG format up to 1280x720,
+ *    encoded in software from the ISC YUV 4:2:2 frames. 1280x720 needs a
+ *    sensor with a WXGA mode such as the OV5640.
  * -# Other video camera programs can also be used to monitor the capture
  *    output. The demo is tested on windows XP through "AmCap.exe".
  *
@@ -130,6 +133,8 @@
 
 #include "../usb_common/main_usb_common.h"
 
+#include "jpegenc.h"
+
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -140,6 +145,8 @@
 #define FRAME_DEBUG_ENABLED
 
 #define NUM_FRAME_BUFFER     4
+#define NUM_JPEG_BUFFER      3
+#define JPEG_QUALITY         75
 #define SENSOR_TWI_BUS BOARD_ISC_TWI_BUS
 #define COUNTER_FREQ         1
 
@@ -171,7 +178,22 @@ static struct _iscd_desc iscd;
 
 /** Video buffers */
 CACHE_ALIGNED_DDR
-static uint8_t stream_buffers[FRAME_BUFFER_SIZEC(640, 480) * NUM_FRAME_BUFFER];
+static uint8_t stream_buffers[FRAME_BUFFER_SIZEC(1280, 720) * NUM_FRAME_BUFFER];
+
+/** Compressed frames: streaming, published and being encoded */
+CACHE_ALIGNED_DDR
+static uint8_t jpeg_buffers[NUM_JPEG_BUFFER][FRAME_MJPEG_BUFFER_SIZEC(1280, 720)];
+
+static struct _jpegenc_desc jpegenc;
+
+static bool mjpeg_enabled;
+
+/** Index of the last frame started by the ISC */
+static volatile uint32_t isc_frame_idx;
+
+static volatile bool isc_frame_ready;
+
+static const uint8_t* jpeg_published;
 
 #ifdef FRAME_DEBUG_ENABLED
 /** define Timer Counter descriptor for counter/timer */
@@ -191,6 +213,46 @@ static void isc_vd_callback(uint8_t frame_idx)
 	_isc_frame_count++;
 #endif
 	uvc_function_update_frame_idx(frame_idx);
+	isc_frame_idx = frame_idx;
+	isc_frame_ready = true;
+}
+
+/**
+ * \brief Compress the latest complete ISC frame and publish it to UVC.
+ */
+static void encode_frame(void)
+{
+	uint32_t size = FRAME_BUFFER_SIZEC(image_width, image_height);
+	const uint8_t* streaming = uvc_function_get_streaming_frame();
+	uint8_t* src;
+	uint8_t* dst = NULL;
+	uint32_t idx, i;
+	int len;
+
+	isc_frame_ready = false;
+	idx = isc_frame_idx;
+	idx = (idx == 0) ? (NUM_FRAME_BUFFER - 1) : (idx - 1);
+	src = &stream_buffers[idx * size];
+
+	/* never overwrite the frame on the wire or the one queued for it */
+	for (i = 0; i < NUM_JPEG_BUFFER; i++) {
+		dst = jpeg_buffers[i];
+		if (dst != streaming && dst != jpeg_published)
+			break;
+	}
+
+	cache_invalidate_region(src, size);
+	len = jpegenc_encode(&jpegenc, src, image_width * 2, dst,
+			sizeof(jpeg_buffers[0]));
+	if (len < 0) {
+		trace_warning("JPEG frame larger than %u bytes, dropped\r\n",
+				(unsigned)sizeof(jpeg_buffers[0]));
+		return;
+	}
+	cache_clean_region(dst, len);
+
+	jpeg_published = dst;
+	uvc_function_update_compressed_frame(dst, len);
 }
 
 /**
@@ -236,6 +298,18 @@ static void start_preview(void)
 
 	/* Configure ISC */
 	configure_isc();
+
+	if (mjpeg_enabled) {
+		jpegenc.width = image_width;
+		jpegenc.height = image_height;
+		jpegenc.quality = JPEG_QUALITY;
+		if (jpegenc_configure(&jpegenc) < 0) {
+			printf("-E- Frame size not supported by the JPEG encoder.\r\n");
+			while (1);
+		}
+		jpeg_published = NULL;
+		isc_frame_ready = false;
+	}
 }
 
 /**
@@ -328,6 +402,8 @@ extern int main( void )
 		}
 
 		if (is_usb_vid_on) {
+			if (mjpeg_enabled && isc_frame_ready)
+				encode_frame();
 			if (!uvc_function_is_video_on()) {
 				is_usb_vid_on = false;
 				isc_stop_capture();
@@ -339,11 +415,15 @@ extern int main( void )
 			if (uvc_function_is_video_on()) {
 				is_usb_vid_on = true;
 				frame_format = uvc_function_get_frame_format();
+				mjpeg_enabled = uvc_function_get_format_index() == VIDCAMD_FormatMjpeg;
 				if (frame_format == 1) {
 					image_resolution = QVGA;
 				}
 				else if (frame_format == 2) {
 					image_resolution = VGA;
+				}
+				else if (frame_format == 3 && mjpeg_enabled) {
+					image_resolution = WXGA;
 				} else {
 					printf ("-I- Only support VGA and QVGA format\r\n");
 					image_resolution = QVGA;
@@ -305,13 +305,13 @@ const struct UsbVideoCamConfigurationDescriptors configurationDescriptorsFS =
 };
 
 /**  Configuration descriptors. */
-const struct UsbVideoCamConfigurationDescriptors configurationDescriptorsHS =
+const struct UsbVideoCamMjpegConfigurationDescriptors configurationDescriptorsHS =
 {
 	/* Configuration descriptor */
 	{
 		sizeof(USBConfigurationDescriptor),
 		USBGenericDescriptor_CONFIGURATION,
-		sizeof(struct UsbVideoCamConfigurationDescriptors),
+		sizeof(struct UsbVideoCamMjpegConfigurationDescriptors),
 		2, /* 2 interface in this configuration */
 		1, /* This is configuration #1 */
 		0, /* No string descriptor for this configuration */
@@ -397,11 +397,11 @@ const struct UsbVideoCamConfigurationDescriptors configurationDescriptorsHS =
 	{
 		/* VS Input Header */
 		{
-			sizeof(UsbVideoInputHeaderDescriptor1),
+			sizeof(UsbVideoInputHeaderDescriptor2),
 			VIDGenericDescriptor_INTERFACE, /* CS_INTERFACE */
 			VIDStreamingInterfaceDescriptor_INPUTHEADER, /* VS_INPUT_HEADER */
-			1, /* Only 1 payload format */
-			sizeof(UsbVideoStreamingInterfaceDescriptor),
+			2, /* 2 payload formats: uncompressed, MJPEG */
+			sizeof(UsbVideoStreamingInterfaceDescriptor2),
 			0x80 | VIDCAMD_IsoInEndpointNum, /* Endpoint address is 0x82 */
 			0x00, /* Dynamic Format Change not supported */
 			2, /* Terminal Link to #2 */
@@ -409,6 +409,7 @@ const struct UsbVideoCamConfigurationDescriptors configurationDescriptorsHS =
 			0, /* Trigger not supported */
 			0, /* No trigger usage */
 			1, /* 1 bmaControls */
+			0, /* No bmaControls */
 			0  /* No bmaControls */
 		},
 		/* VS Format Uncompressed */
@@ -419,7 +420,7 @@ const struct UsbVideoCamConfigurationDescriptors configurationDescriptorsHS =
 				VIDGenericDescriptor_INTERFACE, /* CS_INTERFACE */
 				VIDStreamingInterfaceDescriptor_FMT_UNCOMPRESSED,
 				/* VS_FORMAT_UNCOMPRESSED */
-				1, /* Format index #1 */
+				VIDCAMD_FormatUncompressed, /* Format index #1 */
 				VIDCAMD_NumFrameTypes, /* 3 frame types */
 				guidYUY2, /* guid YUY2 32595559-0000-0010-8000-00AA00389B71 */
 				FRAME_BPP, /* 16 bits per pixel */
@@ -498,6 +499,93 @@ const struct UsbVideoCamConfigurationDescriptors configurationDescriptorsHS =
 				1, /* BT.709 */
 				4, /* BT.601 */
 			}
+		},
+		/* VS Format MJPEG */
+		{
+			/* Payload MJPEG format */
+			{
+				sizeof(USBVideoMjpegFormatDescriptor),
+				VIDGenericDescriptor_INTERFACE, /* CS_INTERFACE */
+				VIDStreamingInterfaceDescriptor_FMT_MJPEG,
+				/* VS_FORMAT_MJPEG */
+				VIDCAMD_FormatMjpeg, /* Format index #2 */
+				VIDCAMD_NumMjpegFrameTypes, /* 3 frame types */
+				0, /* Variable size samples */
+				1, /* Default frame index: #1 */
+				0, /* bAspectRatioX */
+				0, /* bAspectRatioY */
+				0, /* No interlace */
+				0  /* No copy protect restrictions */
+			},
+			/* Frame format 320x240 */
+			{
+				sizeof(USBVideoMjpegFrameDescriptor1),
+				VIDGenericDescriptor_INTERFACE, /* CS_INTERFACE */
+				VIDStreamingInterfaceDescriptor_FRM_MJPEG,
+				/* VS_FRAME_MJPEG */
+				1, /* Frame index #1 */
+				0, /* Still image not supported */
+				VIDCAMD_MJPEG_FW_1, /* wWidth */
+				VIDCAMD_MJPEG_FH_1, /* wHeight */
+				FRAME_BITRATEC(VIDCAMD_MJPEG_FW_1, VIDCAMD_MJPEG_FH_1, 30) / 2, /* Min bitrate */
+				FRAME_BITRATEC(VIDCAMD_MJPEG_FW_1, VIDCAMD_MJPEG_FH_1, 30) / 2, /* Max bitrate */
+				FRAME_MJPEG_BUFFER_SIZEC(VIDCAMD_MJPEG_FW_1, VIDCAMD_MJPEG_FH_1),
+				/* maxFrameBufferSize: 320*240 */
+				FRAME_INTERVALC(30), /* Default interval: 30F/s */
+				1, /* 1 Interval setting */
+				{
+					FRAME_INTERVALC(30), /* 30F/s */
+				},
+			},
+			/* Frame format 640x480 */
+			{
+				sizeof(USBVideoMjpegFrameDescriptor1),
+				VIDGenericDescriptor_INTERFACE, /* CS_INTERFACE */
+				VIDStreamingInterfaceDescriptor_FRM_MJPEG,
+				/* VS_FRAME_MJPEG */
+				2, /* Frame index #2 */
+				0, /* Still image not supported */
+				VIDCAMD_MJPEG_FW_2, /* wWidth */
+				VIDCAMD_MJPEG_FH_2, /* wHeight */
+				FRAME_BITRATEC(VIDCAMD_MJPEG_FW_2, VIDCAMD_MJPEG_FH_2, 30) / 2, /* Min bitrate */
+				FRAME_BITRATEC(VIDCAMD_MJPEG_FW_2, VIDCAMD_MJPEG_FH_2, 30) / 2, /* Max bitrate */
+				FRAME_MJPEG_BUFFER_SIZEC(VIDCAMD_MJPEG_FW_2, VIDCAMD_MJPEG_FH_2),
+				/* maxFrameBufferSize: 640*480 */
+				FRAME_INTERVALC(30), /* Default interval: 30F/s */
+				1, /* 1 Interval setting */
+				{
+					FRAME_INTERVALC(30), /* 30F/s */
+				},
+			},
+			/* Frame format 1280x720 */
+			{
+				sizeof(USBVideoMjpegFrameDescriptor1),
+				VIDGenericDescriptor_INTERFACE, /* CS_INTERFACE */
+				VIDStreamingInterfaceDescriptor_FRM_MJPEG,
+				/* VS_FRAME_MJPEG */
+				3, /* Frame index #3 */
+				0, /* Still image not supported */
+				VIDCAMD_MJPEG_FW_3, /* wWidth */
+				VIDCAMD_MJPEG_FH_3, /* wHeight */
+				FRAME_BITRATEC(VIDCAMD_MJPEG_FW_3, VIDCAMD_MJPEG_FH_3, 30) / 2, /* Min bitrate */
+				FRAME_BITRATEC(VIDCAMD_MJPEG_FW_3, VIDCAMD_MJPEG_FH_3, 30) / 2, /* Max bitrate */
+				FRAME_MJPEG_BUFFER_SIZEC(VIDCAMD_MJPEG_FW_3, VIDCAMD_MJPEG_FH_3),
+				/* maxFrameBufferSize: 1280*720 */
+				FRAME_INTERVALC(30), /* Default interval: 30F/s */
+				1, /* 1 Interval setting */
+				{
+					FRAME_INTERVALC(30), /* 30F/s */
+				},
+			},
+			/* Color format MJPEG */
+			{
+				sizeof(USBVideoColorMatchingDescriptor),
+				VIDGenericDescriptor_INTERFACE, /* CS_INTERFACE */
+				VIDStreamingInterfaceDescriptor_COLORFORMAT, /* VS_COLORFORMAT */
+				1, /* BT.709, sRGB */
+				1, /* BT.709 */
+				4, /* BT.601 */
+			}
 		}
 	},
 	/* VS Interface Descriptor: 400K */
@@ -0,0 +1,421 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "callback.h"
+#include "compiler.h"
+#include "errno.h"
+#include "intmath.h"
+
+#include "audiodsp.h"
+#include "audiodsp_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local definitions
+ *------------------------------------------------------------------------------*/
+
+enum _audiodsp_stage_type {
+	AUDIODSP_STAGE_GAIN,
+	AUDIODSP_STAGE_BIQUAD,
+	AUDIODSP_STAGE_MIX,
+};
+
+/*------------------------------------------------------------------------------
+ *         Local variables
+ *------------------------------------------------------------------------------*/
+
+#ifdef CONFIG_HAVE_NEON
+static const struct _audiodsp_ops* _ops = &audiodsp_neon_ops;
+#else
+static const struct _audiodsp_ops* _ops = &audiodsp_c_ops;
+#endif
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+static bool _check_format(uint8_t format, uint8_t channels)
+{
+	return format <= AUDIODSP_S32 && channels > 0 &&
+	       channels <= AUDIODSP_MAX_CHANNELS;
+}
+
+static struct _audiodsp_stage* _get_stage(struct _audiodsp* dsp, int stage,
+		uint8_t type)
+{
+	if (stage < 0 || stage >= dsp->stage_count)
+		return NULL;
+	if (dsp->stages[stage].type != type)
+		return NULL;
+	return &dsp->stages[stage];
+}
+
+static int _add_stage(struct _audiodsp* dsp, uint8_t type, uint8_t mask)
+{
+	struct _audiodsp_stage* stage;
+
+	if (dsp->stage_count >= AUDIODSP_MAX_STAGES)
+		return -ENOMEM;
+
+	stage = &dsp->stages[dsp->stage_count];
+	memset(stage, 0, sizeof(*stage));
+	stage->type = type;
+	stage->mask = mask;
+	return dsp->stage_count++;
+}
+
+static void _run_gain(struct _audiodsp_stage* stage, uint8_t channel,
+		int32_t* data, uint32_t count)
+{
+	int32_t* current = &stage->gain.current[channel];
+	uint32_t* remaining = &stage->gain.remaining[channel];
+
+	if (*remaining) {
+		int32_t step = stage->gain.step[channel];
+		uint32_t n = min_u32(count, *remaining);
+
+		_ops->ramp(data, n, *current, step);
+		*remaining -= n;
+		if (*remaining)
+			*current += (int32_t)n * step;
+		else
+			*current = stage->gain.target[channel];
+		data += n;
+		count -= n;
+	}
+
+	if (count && *current != AUDIODSP_GAIN_UNITY)
+		_ops->gain(data, count, *current);
+}
+
+static void _run_mix(struct _audiodsp* dsp, uint32_t count)
+{
+	int i;
+
+	for (i = 0; i < AUDIODSP_MAX_SOURCES; i++) {
+		struct _audiodsp_source* source = dsp->sources[i];
+		uint32_t n;
+		uint8_t s, c;
+
+		if (!source)
+			continue;
+
+		n = min_u32(count, source->frames);
+		for (s = 0; s < source->channels && s < dsp->out_channels; s++) {
+			_ops->load(source->data, source->format,
+					source->channels, s, dsp->scratch, n);
+			for (c = s; c < dsp->out_channels; c += source->channels)
+				_ops->mix(dsp->block[c], dsp->scratch, n,
+						source->gain);
+		}
+
+		source->data += n * audiodsp_frame_size(
+				(enum _audiodsp_format)source->format,
+				source->channels);
+		source->frames -= n;
+		if (!source->frames) {
+			dsp->sources[i] = NULL;
+			callback_call(&source->done, source);
+		}
+	}
+}
+
+static void _run_stage(struct _audiodsp* dsp, struct _audiodsp_stage* stage,
+		uint32_t count)
+{
+	uint8_t c;
+
+	if (stage->type == AUDIODSP_STAGE_MIX) {
+		_run_mix(dsp, count);
+		return;
+	}
+
+	for (c = 0; c < dsp->out_channels; c++) {
+		if (!(stage->mask & (1 << c)))
+			continue;
+		if (stage->type == AUDIODSP_STAGE_GAIN)
+			_run_gain(stage, c, dsp->block[c], count);
+		else
+			audiodsp_biquad_run(&stage->biquad.coefs,
+					stage->biquad.state[c], dsp->block[c],
+					count);
+	}
+}
+
+/*------------------------------------------------------------------------------
+ *         Library internal functions
+ *------------------------------------------------------------------------------*/
+
+void audiodsp_biquad_run(const struct _audiodsp_biquad* k, int32_t* state,
+		int32_t* data, uint32_t count)
+{
+	int32_t x1 = state[0], x2 = state[1];
+	int32_t y1 = state[2], y2 = state[3];
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		int32_t x = data[i];
+		int64_t acc = (int64_t)k->b0 * x + (int64_t)k->b1 * x1
+		            + (int64_t)k->b2 * x2 - (int64_t)k->a1 * y1
+		            - (int64_t)k->a2 * y2;
+		int64_t y = (acc + (1 << (AUDIODSP_BIQUAD_SHIFT - 1)))
+		            >> AUDIODSP_BIQUAD_SHIFT;
+
+		if (y > INT32_MAX)
+			y = INT32_MAX;
+		else if (y < INT32_MIN)
+			y = INT32_MIN;
+		x2 = x1;
+		x1 = x;
+		y2 = y1;
+		y1 = y;
+		data[i] = y;
+	}
+
+	state[0] = x1;
+	state[1] = x2;
+	state[2] = y1;
+	state[3] = y2;
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+int audiodsp_init(struct _audiodsp* dsp)
+{
+	uint8_t c;
+
+	if (!_check_format(dsp->in_format, dsp->in_channels) ||
+	    !_check_format(dsp->out_format, dsp->out_channels))
+		return -EINVAL;
+
+	for (c = 0; c < AUDIODSP_MAX_CHANNELS; c++)
+		dsp->map[c] = c % dsp->in_channels;
+	dsp->stage_count = 0;
+	memset(dsp->sources, 0, sizeof(dsp->sources));
+	return 0;
+}
+
+bool audiodsp_use_neon(bool enable)
+{
+#ifdef CONFIG_HAVE_NEON
+	_ops = enable ? &audiodsp_neon_ops : &audiodsp_c_ops;
+	return enable;
+#else
+	(void)enable;
+	return false;
+#endif
+}
+
+int audiodsp_set_map(struct _audiodsp* dsp, const uint8_t* map)
+{
+	uint8_t c;
+
+	for (c = 0; c < dsp->out_channels; c++)
+		if (map[c] >= dsp->in_channels && map[c] != AUDIODSP_MAP_NONE)
+			return -EINVAL;
+
+	memcpy(dsp->map, map, dsp->out_channels);
+	return 0;
+}
+
+int audiodsp_add_gain(struct _audiodsp* dsp, uint8_t mask)
+{
+	int index = _add_stage(dsp, AUDIODSP_STAGE_GAIN, mask);
+	uint8_t c;
+
+	if (index < 0)
+		return index;
+
+	for (c = 0; c < AUDIODSP_MAX_CHANNELS; c++) {
+		dsp->stages[index].gain.current[c] = AUDIODSP_GAIN_UNITY;
+		dsp->stages[index].gain.target[c] = AUDIODSP_GAIN_UNITY;
+	}
+	return index;
+}
+
+int audiodsp_set_gain(struct _audiodsp* dsp, int stage, uint8_t mask,
+		int32_t gain)
+{
+	struct _audiodsp_stage* s = _get_stage(dsp, stage, AUDIODSP_STAGE_GAIN);
+	uint8_t c;
+
+	if (!s || gain < 0)
+		return -EINVAL;
+
+	for (c = 0; c < AUDIODSP_MAX_CHANNELS; c++) {
+		int32_t step = 0;
+
+		if (!(mask & (1 << c)))
+			continue;
+
+		if (dsp->ramp)
+			step = ((int64_t)gain - s->gain.current[c]) / (int64_t)dsp->ramp;
+		s->gain.target[c] = gain;
+		s->gain.step[c] = step;
+		if (step) {
+			s->gain.remaining[c] = dsp->ramp;
+		} else {
+			s->gain.remaining[c] = 0;
+			s->gain.current[c] = gain;
+		}
+	}
+	return 0;
+}
+
+int audiodsp_add_biquad(struct _audiodsp* dsp, uint8_t mask,
+		const struct _audiodsp_biquad* coefs)
+{
+	int index = _add_stage(dsp, AUDIODSP_STAGE_BIQUAD, mask);
+
+	if (index >= 0)
+		dsp->stages[index].biquad.coefs = *coefs;
+	return index;
+}
+
+int audiodsp_set_biquad(struct _audiodsp* dsp, int stage,
+		const struct _audiodsp_biquad* coefs)
+{
+	struct _audiodsp_stage* s = _get_stage(dsp, stage, AUDIODSP_STAGE_BIQUAD);
+
+	if (!s)
+		return -EINVAL;
+
+	s->biquad.coefs = *coefs;
+	return 0;
+}
+
+int audiodsp_add_mix(struct _audiodsp* dsp)
+{
+	return _add_stage(dsp, AUDIODSP_STAGE_MIX, 0);
+}
+
+int audiodsp_play(struct _audiodsp* dsp, struct _audiodsp_source* source,
+		const void* data, uint32_t frames, struct _callback* cb)
+{
+	int i, slot = -1;
+
+	if (!_check_format(source->format, source->channels))
+		return -EINVAL;
+
+	for (i = 0; i < AUDIODSP_MAX_SOURCES; i++) {
+		if (dsp->sources[i] == source) {
+			/* restart, the slot is released while updating */
+			dsp->sources[i] = NULL;
+			slot = i;
+			break;
+		}
+		if (!dsp->sources[i] && slot < 0)
+			slot = i;
+	}
+	if (slot < 0)
+		return -EBUSY;
+
+	source->data = (const uint8_t*)data;
+	source->frames = frames;
+	callback_copy(&source->done, cb);
+	if (frames)
+		dsp->sources[slot] = source;
+	return 0;
+}
+
+void audiodsp_stop(struct _audiodsp* dsp, struct _audiodsp_source* source)
+{
+	int i;
+
+	for (i = 0; i < AUDIODSP_MAX_SOURCES; i++)
+		if (dsp->sources[i] == source)
+			dsp->sources[i] = NULL;
+}
+
+int audiodsp_process(struct _audiodsp* dsp, const void* in, void* out,
+		uint32_t frames)
+{
+	uint32_t in_size = audiodsp_frame_size(
+			(enum _audiodsp_format)dsp->in_format, dsp->in_channels);
+	uint32_t out_size = audiodsp_frame_size(
+			(enum _audiodsp_format)dsp->out_format, dsp->out_channels);
+	int32_t* planes[AUDIODSP_MAX_CHANNELS];
+	uint8_t c, s;
+
+	/* blocks are processed in time order for the filter states, wider
+	 * output frames would overwrite the input of the next blocks */
+	if (out_size > in_size &&
+	    (uintptr_t)out < (uintptr_t)in + frames * in_size &&
+	    (uintptr_t)in < (uintptr_t)out + frames * out_size)
+		return -EINVAL;
+
+	for (c = 0; c < AUDIODSP_MAX_CHANNELS; c++)
+		planes[c] = dsp->block[c];
+
+	while (frames) {
+		uint32_t n = min_u32(frames, AUDIODSP_BLOCK_FRAMES);
+
+		/* all channels are loaded before storing, so that in place
+		 * processing works block by block */
+		for (c = 0; c < dsp->out_channels; c++) {
+			if (dsp->map[c] == AUDIODSP_MAP_NONE)
+				memset(dsp->block[c], 0, n * sizeof(int32_t));
+			else
+				_ops->load(in, dsp->in_format, dsp->in_channels,
+						dsp->map[c], dsp->block[c], n);
+		}
+
+		for (s = 0; s < dsp->stage_count; s++)
+			_run_stage(dsp, &dsp->stages[s], n);
+
+		_ops->store(planes, dsp->out_channels, dsp->out_format, out, n);
+
+		in = (const uint8_t*)in + n * in_size;
+		out = (uint8_t*)out + n * out_size;
+		frames -= n;
+	}
+
+	return 0;
+}
+
+uint32_t audiodsp_frame_size(enum _audiodsp_format format, uint8_t channels)
+{
+	switch (format) {
+	case AUDIODSP_S16:
+		return 2 * channels;
+	case AUDIODSP_S24_PACKED:
+		return 3 * channels;
+	default:
+		return 4 * channels;
+	}
+}
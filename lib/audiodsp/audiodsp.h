@@ -0,0 +1,341 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Audio processing on PCM buffers.
+ *
+ * A pipeline converts interleaved input frames to blocks of planar Q31
+ * samples, runs its stages in place on each block and converts the result
+ * to the interleaved output format. Output channels can take any input
+ * channel or silence, so the pipeline also handles channel mapping and
+ * 16, 24 and 32 bit format changes.
+ *
+ * Stages run in the order they were added:
+ * - gain: per-channel gains, changes are ramped to avoid clicks
+ * - biquad: one second order IIR section per stage, cascade stages for
+ *   higher order equalizers
+ * - mix: adds the sources queued with audiodsp_play(), e.g. system sounds
+ *   on top of a stream
+ *
+ * audiodsp_process() handles any number of frames, AUDIODSP_BLOCK_FRAMES at
+ * a time, and is meant to be called from DMA completion callbacks just
+ * before a buffer is queued to (or after it is received from) an audio
+ * peripheral.
+ *
+ * Format conversion, gain and mixing have NEON versions when the library is
+ * built with CONFIG_HAVE_NEON. Both versions give identical output.
+ *
+ * The voice chain is a separate mono S16 path for microphone capture: DC
+ * removal, high-pass filter, automatic gain control and decimation, e.g.
+ * from 48 kHz to 16 kHz.
+ */
+
+#ifndef _AUDIODSP_H
+#define _AUDIODSP_H
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "callback.h"
+#include "compiler.h"
+
+/*------------------------------------------------------------------------------
+ *         Definitions
+ *------------------------------------------------------------------------------*/
+
+/** Maximum number of channels of a pipeline */
+#define AUDIODSP_MAX_CHANNELS 8
+
+/** Frames processed at once */
+#define AUDIODSP_BLOCK_FRAMES 64
+
+/** Maximum number of stages of a pipeline */
+#define AUDIODSP_MAX_STAGES 8
+
+/** Maximum number of sources playing at the same time */
+#define AUDIODSP_MAX_SOURCES 4
+
+/** Gain of 1.0, gains are Q31 */
+#define AUDIODSP_GAIN_UNITY INT32_MAX
+
+/** Gain from a constant between 0 and 1 */
+#define AUDIODSP_GAIN(x) ((int32_t)((x) * 2147483647.0))
+
+/** Biquad coefficients are Q28 */
+#define AUDIODSP_BIQUAD_SHIFT 28
+
+/** Output channel map entry for silence */
+#define AUDIODSP_MAP_NONE 0xff
+
+/** Length of the voice chain decimation filter */
+#define AUDIODSP_VOICE_TAPS 48
+
+/** Maximum decimation factor of the voice chain */
+#define AUDIODSP_VOICE_MAX_DECIMATION 4
+
+/** Maximum AGC gain of the voice chain, the Q16 gain fits 32 bits */
+#define AUDIODSP_VOICE_MAX_AGC_GAIN_DB 90
+
+/** Sample formats, samples of a frame are interleaved */
+enum _audiodsp_format {
+	AUDIODSP_S16,         /**< 16 bits */
+	AUDIODSP_S24,         /**< 24 bits, LSB aligned in 32 bits */
+	AUDIODSP_S24_PACKED,  /**< 24 bits in 3 bytes */
+	AUDIODSP_S32,         /**< 32 bits */
+};
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Biquad coefficients, Q28, normalized so that a0 is 1:
+ * y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2]
+ *
+ * Coefficients are computed offline for the sample rate in use, e.g. with
+ * the Audio EQ Cookbook formulas (R. Bristow-Johnson), divided by a0 and
+ * multiplied by 2^AUDIODSP_BIQUAD_SHIFT.
+ */
+struct _audiodsp_biquad {
+	int32_t b0;
+	int32_t b1;
+	int32_t b2;
+	int32_t a1;
+	int32_t a2;
+};
+
+/** Audio buffer mixed into a pipeline by its mix stages */
+struct _audiodsp_source {
+	uint8_t format;          /**< enum _audiodsp_format */
+	uint8_t channels;        /**< output channel c takes channel c % channels */
+	int32_t gain;            /**< Q31 */
+
+	/* --- following fields are used internally --- */
+	const uint8_t* data;
+	uint32_t frames;
+	struct _callback done;
+};
+
+struct _audiodsp_stage {
+	uint8_t type;
+	uint8_t mask;            /**< channels the stage applies to */
+	union {
+		struct {
+			int32_t current[AUDIODSP_MAX_CHANNELS];
+			int32_t target[AUDIODSP_MAX_CHANNELS];
+			int32_t step[AUDIODSP_MAX_CHANNELS];
+			uint32_t remaining[AUDIODSP_MAX_CHANNELS];
+		} gain;
+		struct {
+			struct _audiodsp_biquad coefs;
+			int32_t state[AUDIODSP_MAX_CHANNELS][4];
+		} biquad;
+	};
+};
+
+struct _audiodsp {
+	uint8_t in_format;       /**< enum _audiodsp_format */
+	uint8_t in_channels;
+	uint8_t out_format;      /**< enum _audiodsp_format */
+	uint8_t out_channels;
+	uint32_t ramp;           /**< gain changes last ramp frames */
+
+	/* --- following fields are used internally --- */
+	uint8_t map[AUDIODSP_MAX_CHANNELS];
+	struct _audiodsp_stage stages[AUDIODSP_MAX_STAGES];
+	uint8_t stage_count;
+	struct _audiodsp_source* sources[AUDIODSP_MAX_SOURCES];
+	ALIGNED(16) int32_t block[AUDIODSP_MAX_CHANNELS][AUDIODSP_BLOCK_FRAMES];
+	ALIGNED(16) int32_t scratch[AUDIODSP_BLOCK_FRAMES];
+};
+
+/** Mono S16 voice capture chain */
+struct _audiodsp_voice {
+	uint32_t rate;           /**< input sample rate in Hz */
+	uint8_t decimation;      /**< output rate is rate / decimation */
+	uint8_t dc_shift;        /**< DC removal pole at 1 - 2^-x, 0 disables */
+	const struct _audiodsp_biquad* highpass; /**< high-pass filter, NULL disables */
+	int16_t agc_target;      /**< AGC peak level, 0 disables the AGC */
+	uint8_t agc_max_gain_db; /**< maximum AGC gain, up to 90 dB */
+
+	/* --- following fields are used internally --- */
+	int32_t hp_state[4];
+	int32_t dc_x1;
+	int32_t dc_y1;
+	uint32_t agc_env;
+	int32_t agc_gain;
+	int32_t agc_max;
+	uint8_t agc_count;
+	uint8_t pos;
+	uint8_t phase;
+	const int16_t* fir;
+	int32_t history[2 * AUDIODSP_VOICE_TAPS];
+	ALIGNED(16) int32_t block[AUDIODSP_BLOCK_FRAMES];
+};
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Initialize a pipeline from its public fields. The pipeline starts
+ * without stages, output channel c takes input channel c % in_channels.
+ * \param dsp pipeline
+ * \return 0 on success, -EINVAL if formats or channel counts are not
+ * supported
+ */
+extern int audiodsp_init(struct _audiodsp* dsp);
+
+/**
+ * \brief Select NEON or portable C kernels. NEON is used by default when
+ * available.
+ * \param enable true to use NEON
+ * \return true if NEON is in use
+ */
+extern bool audiodsp_use_neon(bool enable);
+
+/**
+ * \brief Set the input channel of each output channel.
+ * \param dsp pipeline
+ * \param map out_channels entries, input channel or AUDIODSP_MAP_NONE
+ * \return 0 on success, -EINVAL if an entry is not a valid input channel
+ */
+extern int audiodsp_set_map(struct _audiodsp* dsp, const uint8_t* map);
+
+/**
+ * \brief Append a gain stage, gains start at unity.
+ * \param dsp pipeline
+ * \param mask output channels the stage applies to
+ * \return stage index, or -ENOMEM if the pipeline is full
+ */
+extern int audiodsp_add_gain(struct _audiodsp* dsp, uint8_t mask);
+
+/**
+ * \brief Change the gain of channels of a gain stage, the new gain is
+ * reached after dsp->ramp frames.
+ * \param dsp pipeline
+ * \param stage index returned by audiodsp_add_gain()
+ * \param mask channels to change
+ * \param gain Q31 gain, 0 to AUDIODSP_GAIN_UNITY
+ * \return 0 on success, -EINVAL if stage is not a gain stage
+ */
+extern int audiodsp_set_gain(struct _audiodsp* dsp, int stage, uint8_t mask,
+		int32_t gain);
+
+/**
+ * \brief Append a biquad stage with a cleared filter state.
+ * \param dsp pipeline
+ * \param mask output channels the stage applies to
+ * \param coefs filter coefficients
+ * \return stage index, or -ENOMEM if the pipeline is full
+ */
+extern int audiodsp_add_biquad(struct _audiodsp* dsp, uint8_t mask,
+		const struct _audiodsp_biquad* coefs);
+
+/**
+ * \brief Change the coefficients of a biquad stage, the filter state is
+ * kept.
+ * \return 0 on success, -EINVAL if stage is not a biquad stage
+ */
+extern int audiodsp_set_biquad(struct _audiodsp* dsp, int stage,
+		const struct _audiodsp_biquad* coefs);
+
+/**
+ * \brief Append the stage mixing the playing sources.
+ * \return stage index, or -ENOMEM if the pipeline is full
+ */
+extern int audiodsp_add_mix(struct _audiodsp* dsp);
+
+/**
+ * \brief Start mixing a buffer. A source already playing restarts with the
+ * new buffer.
+ * \param dsp pipeline
+ * \param source source format and gain
+ * \param data interleaved frames, must stay valid until played
+ * \param frames number of frames
+ * \param cb called with the source as second argument once the last frame
+ * has been mixed, from the context calling audiodsp_process(), may be NULL
+ * \return 0 on success, -EINVAL if the source format is not supported,
+ * -EBUSY if AUDIODSP_MAX_SOURCES sources are playing
+ */
+extern int audiodsp_play(struct _audiodsp* dsp,
+		struct _audiodsp_source* source, const void* data,
+		uint32_t frames, struct _callback* cb);
+
+/**
+ * \brief Stop mixing a source, its callback is not called.
+ */
+extern void audiodsp_stop(struct _audiodsp* dsp,
+		struct _audiodsp_source* source);
+
+/**
+ * \brief Run the pipeline. in and out may be the same buffer as long as
+ * output frames are not larger than input frames.
+ * \param dsp pipeline
+ * \param in interleaved input frames
+ * \param out interleaved output frames
+ * \param frames number of frames
+ * \return 0 on success, -EINVAL if the buffers overlap and output frames are
+ * larger than input frames, the stores would overwrite input not read yet
+ */
+extern int audiodsp_process(struct _audiodsp* dsp, const void* in,
+		void* out, uint32_t frames);
+
+/**
+ * \brief Size of a frame in bytes.
+ */
+extern uint32_t audiodsp_frame_size(enum _audiodsp_format format,
+		uint8_t channels);
+
+/**
+ * \brief Initialize a voice chain from its public fields, filter states are
+ * cleared and the AGC starts at unity gain.
+ * \param voice voice chain
+ * \return 0 on success, -EINVAL if a parameter is out of range
+ */
+extern int audiodsp_voice_init(struct _audiodsp_voice* voice);
+
+/**
+ * \brief Run the voice chain. in and out may be the same buffer.
+ * \param voice voice chain
+ * \param in input samples at voice->rate
+ * \param count number of input samples
+ * \param out output samples at voice->rate / voice->decimation
+ * \return number of output samples
+ */
+extern uint32_t audiodsp_voice_process(struct _audiodsp_voice* voice,
+		const int16_t* in, uint32_t count, int16_t* out);
+
+#endif /* _AUDIODSP_H */
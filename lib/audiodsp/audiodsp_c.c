@@ -0,0 +1,186 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+#include "audiodsp.h"
+#include "audiodsp_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+static inline int32_t _sat32(int64_t x)
+{
+	return x > INT32_MAX ? INT32_MAX : (x < INT32_MIN ? INT32_MIN : x);
+}
+
+/**
+ * \brief Q31 product, rounded, same result as the NEON vqrdmulh instruction
+ */
+static inline int32_t _qmul(int32_t a, int32_t b)
+{
+	return _sat32(((int64_t)a * b + (1 << 30)) >> 31);
+}
+
+static inline int32_t _to_s16(int32_t x)
+{
+	int32_t y = ((int64_t)x + (1 << 15)) >> 16;
+	return y > INT16_MAX ? INT16_MAX : y;
+}
+
+static inline int32_t _to_s24(int32_t x)
+{
+	int32_t y = ((int64_t)x + (1 << 7)) >> 8;
+	return y > 0x7fffff ? 0x7fffff : y;
+}
+
+static void _load(const void* src, uint8_t format, uint8_t channels,
+		uint8_t index, int32_t* dst, uint32_t count)
+{
+	uint32_t i;
+
+	switch (format) {
+	case AUDIODSP_S16:
+	{
+		const int16_t* s = (const int16_t*)src + index;
+		for (i = 0; i < count; i++, s += channels)
+			dst[i] = (uint32_t)*s << 16;
+		break;
+	}
+	case AUDIODSP_S24:
+	{
+		const int32_t* s = (const int32_t*)src + index;
+		for (i = 0; i < count; i++, s += channels)
+			dst[i] = (uint32_t)*s << 8;
+		break;
+	}
+	case AUDIODSP_S24_PACKED:
+	{
+		const uint8_t* s = (const uint8_t*)src + 3 * index;
+		for (i = 0; i < count; i++, s += 3 * channels)
+			dst[i] = (s[0] << 8) | (s[1] << 16) | ((uint32_t)s[2] << 24);
+		break;
+	}
+	case AUDIODSP_S32:
+	{
+		const int32_t* s = (const int32_t*)src + index;
+		for (i = 0; i < count; i++, s += channels)
+			dst[i] = *s;
+		break;
+	}
+	}
+}
+
+static void _store(int32_t* const* src, uint8_t channels, uint8_t format,
+		void* dst, uint32_t count)
+{
+	uint32_t i;
+	uint8_t c;
+
+	for (c = 0; c < channels; c++) {
+		const int32_t* s = src[c];
+
+		switch (format) {
+		case AUDIODSP_S16:
+		{
+			int16_t* d = (int16_t*)dst + c;
+			for (i = 0; i < count; i++, d += channels)
+				*d = _to_s16(s[i]);
+			break;
+		}
+		case AUDIODSP_S24:
+		{
+			int32_t* d = (int32_t*)dst + c;
+			for (i = 0; i < count; i++, d += channels)
+				*d = _to_s24(s[i]);
+			break;
+		}
+		case AUDIODSP_S24_PACKED:
+		{
+			uint8_t* d = (uint8_t*)dst + 3 * c;
+			for (i = 0; i < count; i++, d += 3 * channels) {
+				int32_t x = _to_s24(s[i]);
+				d[0] = x;
+				d[1] = x >> 8;
+				d[2] = x >> 16;
+			}
+			break;
+		}
+		case AUDIODSP_S32:
+		{
+			int32_t* d = (int32_t*)dst + c;
+			for (i = 0; i < count; i++, d += channels)
+				*d = s[i];
+			break;
+		}
+		}
+	}
+}
+
+static void _gain(int32_t* data, uint32_t count, int32_t gain)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		data[i] = _qmul(data[i], gain);
+}
+
+static void _ramp(int32_t* data, uint32_t count, int32_t gain, int32_t step)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++, gain += step)
+		data[i] = _qmul(data[i], gain);
+}
+
+static void _mix(int32_t* dst, const int32_t* src, uint32_t count,
+		int32_t gain)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		dst[i] = _sat32((int64_t)dst[i] + _qmul(src[i], gain));
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported variables
+ *------------------------------------------------------------------------------*/
+
+const struct _audiodsp_ops audiodsp_c_ops = {
+	.load = _load,
+	.store = _store,
+	.gain = _gain,
+	.ramp = _ramp,
+	.mix = _mix,
+};
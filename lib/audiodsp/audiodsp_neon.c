@@ -0,0 +1,212 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <arm_neon.h>
+#include <stdint.h>
+
+#include "audiodsp.h"
+#include "audiodsp_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+/* Kernels process 4 or 8 samples per iteration and leave the tail, packed
+ * 24 bits and channel counts other than 1, 2 and 4 to the C kernels, results
+ * are identical to audiodsp_c_ops. */
+
+static void _load(const void* src, uint8_t format, uint8_t channels,
+		uint8_t index, int32_t* dst, uint32_t count)
+{
+	uint32_t done = 0;
+
+	if (format == AUDIODSP_S16) {
+		const int16_t* s = (const int16_t*)src;
+		int16x4_t x;
+
+		for (; count - done >= 4; done += 4, s += 4 * channels) {
+			if (channels == 1)
+				x = vld1_s16(s);
+			else if (channels == 2)
+				x = vld2_s16(s).val[index];
+			else if (channels == 4)
+				x = vld4_s16(s).val[index];
+			else
+				break;
+			vst1q_s32(dst + done, vshll_n_s16(x, 16));
+		}
+	} else if (format == AUDIODSP_S24 || format == AUDIODSP_S32) {
+		const int32_t* s = (const int32_t*)src;
+		int32x4_t x;
+
+		for (; count - done >= 4; done += 4, s += 4 * channels) {
+			if (channels == 1)
+				x = vld1q_s32(s);
+			else if (channels == 2)
+				x = vld2q_s32(s).val[index];
+			else if (channels == 4)
+				x = vld4q_s32(s).val[index];
+			else
+				break;
+			if (format == AUDIODSP_S24)
+				x = vshlq_n_s32(x, 8);
+			vst1q_s32(dst + done, x);
+		}
+	}
+
+	src = (const uint8_t*)src
+	    + done * audiodsp_frame_size((enum _audiodsp_format)format, channels);
+	audiodsp_c_ops.load(src, format, channels, index, dst + done,
+			count - done);
+}
+
+static inline int32x4_t _to_s24(int32x4_t x)
+{
+	return vminq_s32(vrshrq_n_s32(x, 8), vdupq_n_s32(0x7fffff));
+}
+
+static void _store(int32_t* const* src, uint8_t channels, uint8_t format,
+		void* dst, uint32_t count)
+{
+	int32_t* tail[AUDIODSP_MAX_CHANNELS];
+	uint32_t done = 0;
+	uint8_t c;
+
+	if (channels == 3 || channels > 4)
+		goto tail;
+
+	switch (format) {
+	case AUDIODSP_S16:
+	{
+		int16_t* d = (int16_t*)dst;
+
+		for (; count - done >= 4; done += 4, d += 4 * channels) {
+			if (channels == 1) {
+				vst1_s16(d, vqrshrn_n_s32(vld1q_s32(src[0] + done), 16));
+			} else if (channels == 2) {
+				int16x4x2_t x;
+				x.val[0] = vqrshrn_n_s32(vld1q_s32(src[0] + done), 16);
+				x.val[1] = vqrshrn_n_s32(vld1q_s32(src[1] + done), 16);
+				vst2_s16(d, x);
+			} else {
+				int16x4x4_t x;
+				for (c = 0; c < 4; c++)
+					x.val[c] = vqrshrn_n_s32(vld1q_s32(src[c] + done), 16);
+				vst4_s16(d, x);
+			}
+		}
+		break;
+	}
+	case AUDIODSP_S24:
+	case AUDIODSP_S32:
+	{
+		int32_t* d = (int32_t*)dst;
+
+		for (; count - done >= 4; done += 4, d += 4 * channels) {
+			int32x4_t x[4];
+			for (c = 0; c < channels; c++) {
+				x[c] = vld1q_s32(src[c] + done);
+				if (format == AUDIODSP_S24)
+					x[c] = _to_s24(x[c]);
+			}
+			if (channels == 1) {
+				vst1q_s32(d, x[0]);
+			} else if (channels == 2) {
+				int32x4x2_t y = { { x[0], x[1] } };
+				vst2q_s32(d, y);
+			} else {
+				int32x4x4_t y = { { x[0], x[1], x[2], x[3] } };
+				vst4q_s32(d, y);
+			}
+		}
+		break;
+	}
+	}
+
+tail:
+	for (c = 0; c < channels; c++)
+		tail[c] = src[c] + done;
+	dst = (uint8_t*)dst
+	    + done * audiodsp_frame_size((enum _audiodsp_format)format, channels);
+	audiodsp_c_ops.store(tail, channels, format, dst, count - done);
+}
+
+static void _gain(int32_t* data, uint32_t count, int32_t gain)
+{
+	for (; count >= 4; count -= 4, data += 4)
+		vst1q_s32(data, vqrdmulhq_n_s32(vld1q_s32(data), gain));
+	audiodsp_c_ops.gain(data, count, gain);
+}
+
+static void _ramp(int32_t* data, uint32_t count, int32_t gain, int32_t step)
+{
+	uint32_t done = 0;
+
+	if (count >= 4) {
+		/* gains of the first 4 samples, all within the ramp */
+		const int32_t first[4] = { gain, gain + step, gain + 2 * step,
+					   gain + 3 * step };
+		int32x4_t g = vld1q_s32(first);
+		int32x4_t g_step = vdupq_n_s32(4 * (uint32_t)step);
+
+		for (; count - done >= 4; done += 4) {
+			vst1q_s32(data + done,
+				  vqrdmulhq_s32(vld1q_s32(data + done), g));
+			g = vaddq_s32(g, g_step);
+		}
+	}
+	audiodsp_c_ops.ramp(data + done, count - done,
+			gain + (int32_t)done * step, step);
+}
+
+static void _mix(int32_t* dst, const int32_t* src, uint32_t count,
+		int32_t gain)
+{
+	for (; count >= 4; count -= 4, dst += 4, src += 4) {
+		int32x4_t x = vqrdmulhq_n_s32(vld1q_s32(src), gain);
+		vst1q_s32(dst, vqaddq_s32(vld1q_s32(dst), x));
+	}
+	audiodsp_c_ops.mix(dst, src, count, gain);
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported variables
+ *------------------------------------------------------------------------------*/
+
+const struct _audiodsp_ops audiodsp_neon_ops = {
+	.load = _load,
+	.store = _store,
+	.gain = _gain,
+	.ramp = _ramp,
+	.mix = _mix,
+};
@@ -0,0 +1,89 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef _AUDIODSP_PRIVATE_H
+#define _AUDIODSP_PRIVATE_H
+
+#include <stdint.h>
+
+#include "audiodsp.h"
+
+/*------------------------------------------------------------------------------
+ *      Types
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Block kernels. Interleaved buffers hold frames of channels samples
+ * in a enum _audiodsp_format, planar buffers hold Q31 samples.
+ */
+struct _audiodsp_ops {
+	/** Convert sample index of count interleaved frames to Q31 */
+	void (*load)(const void* src, uint8_t format, uint8_t channels,
+			uint8_t index, int32_t* dst, uint32_t count);
+
+	/** Convert and interleave channels planar buffers, rounded and
+	 *  saturated */
+	void (*store)(int32_t* const* src, uint8_t channels, uint8_t format,
+			void* dst, uint32_t count);
+
+	/** Apply a Q31 gain */
+	void (*gain)(int32_t* data, uint32_t count, int32_t gain);
+
+	/** Apply a Q31 gain, increased by step after each sample */
+	void (*ramp)(int32_t* data, uint32_t count, int32_t gain,
+			int32_t step);
+
+	/** Add src scaled by a Q31 gain to dst, saturated */
+	void (*mix)(int32_t* dst, const int32_t* src, uint32_t count,
+			int32_t gain);
+};
+
+/*------------------------------------------------------------------------------
+ *      Exported variables
+ *------------------------------------------------------------------------------*/
+
+/** Portable C kernels, also used by NEON kernels for block tails */
+extern const struct _audiodsp_ops audiodsp_c_ops;
+
+#ifdef CONFIG_HAVE_NEON
+extern const struct _audiodsp_ops audiodsp_neon_ops;
+#endif
+
+/*------------------------------------------------------------------------------
+ *      Exported functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Direct form I biquad on Q31 samples, state holds x[n-1], x[n-2],
+ * y[n-1] and y[n-2]
+ */
+extern void audiodsp_biquad_run(const struct _audiodsp_biquad* k,
+		int32_t* state, int32_t* data, uint32_t count);
+
+#endif /* _AUDIODSP_PRIVATE_H */
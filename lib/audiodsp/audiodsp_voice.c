@@ -0,0 +1,273 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "errno.h"
+#include "intmath.h"
+
+#include "audiodsp.h"
+#include "audiodsp_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local definitions
+ *------------------------------------------------------------------------------*/
+
+/** The AGC gain is updated every AGC_STEP samples */
+#define AGC_STEP 32
+
+/** Peak envelope decays by 1/2^x per sample */
+#define AGC_RELEASE_SHIFT 13
+
+/** Gain increases move by 1/2^x of the difference per step */
+#define AGC_RISE_SHIFT 5
+
+/** AGC gains are Q16 */
+#define AGC_UNITY (1 << 16)
+
+/** AGC gain limits are built from 20 dB steps */
+#define AGC_DB_STEP 20
+
+/*------------------------------------------------------------------------------
+ *         Local constants
+ *------------------------------------------------------------------------------*/
+
+/**
+ * Decimation filters, Q15, for decimation by 2 to
+ * AUDIODSP_VOICE_MAX_DECIMATION. Blackman windowed sinc low-passes with the
+ * cut-off at 0.9 times the output Nyquist frequency, normalized for unity
+ * DC gain, the rounding error is added to the centre tap.
+ */
+static const int16_t _fir[AUDIODSP_VOICE_MAX_DECIMATION - 1][AUDIODSP_VOICE_TAPS] = {
+	/* decimation by 2 */
+	{
+		0, 0, -3, -5, 10, 22, -16, -61,
+		7, 130, 42, -225, -169, 323, 419, -371,
+		-842, 273, 1510, 157, -2648, -1525, 5832, 13523,
+		13525, 5832, -1525, -2648, 157, 1510, 273, -842,
+		-371, 419, 323, -169, -225, 42, 130, 7,
+		-61, -16, 22, 10, -5, -3, 0, 0,
+	},
+	/* decimation by 3 */
+	{
+		0, 1, 3, 4, -7, -26, -29, 10,
+		82, 116, 28, -172, -320, -193, 250, 702,
+		645, -183, -1350, -1778, -426, 2818, 6756, 9454,
+		9452, 6756, 2818, -426, -1778, -1350, -183, 645,
+		702, 250, -193, -320, -172, 28, 116, 82,
+		10, -29, -26, -7, 4, 3, 1, 0,
+	},
+	/* decimation by 4 */
+	{
+		0, 0, 2, 7, 14, 13, -8, -50,
+		-92, -96, -21, 135, 312, 386, 231, -193,
+		-758, -1163, -1028, -78, 1686, 3909, 5969, 7208,
+		7206, 5969, 3909, 1686, -78, -1028, -1163, -758,
+		-193, 231, 386, 312, 135, -21, -96, -92,
+		-50, -8, 13, 14, 7, 2, 0, 0,
+	},
+};
+
+/** 10^(dB / 20) for 0 to 19 dB, Q16 */
+static const int32_t _db_gain[AGC_DB_STEP] = {
+	65536, 73533, 82505, 92572, 103868, 116541, 130762, 146717,
+	164619, 184706, 207243, 232531, 260904, 292739, 328458, 368536,
+	413504, 463959, 520571, 584090,
+};
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+static inline int32_t _sat32(int64_t x)
+{
+	return x > INT32_MAX ? INT32_MAX : (x < INT32_MIN ? INT32_MIN : x);
+}
+
+/**
+ * \brief One pole DC blocker: y[n] = x[n] - x[n-1] + (1 - 2^-shift) y[n-1]
+ */
+static void _dc_removal(struct _audiodsp_voice* voice, int32_t* data,
+		uint32_t count)
+{
+	int32_t x1 = voice->dc_x1, y1 = voice->dc_y1;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		int32_t x = data[i];
+		y1 = _sat32((int64_t)x - x1 + y1 - (y1 >> voice->dc_shift));
+		x1 = x;
+		data[i] = y1;
+	}
+
+	voice->dc_x1 = x1;
+	voice->dc_y1 = y1;
+}
+
+/**
+ * \brief Peak envelope follower driving a Q16 gain: gain drops at once when
+ * the level rises and recovers slowly, up to agc_max.
+ */
+static void _agc(struct _audiodsp_voice* voice, int32_t* data, uint32_t count)
+{
+	const uint32_t target = (uint32_t)voice->agc_target << 16;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		int32_t x = data[i];
+		uint32_t level = x < 0 ? -(uint32_t)x : (uint32_t)x;
+
+		if (level > voice->agc_env)
+			voice->agc_env = level;
+		else
+			voice->agc_env -= voice->agc_env >> AGC_RELEASE_SHIFT;
+
+		if (++voice->agc_count == AGC_STEP) {
+			int64_t gain = voice->agc_max;
+
+			voice->agc_count = 0;
+			if (voice->agc_env) {
+				int64_t g = ((uint64_t)target << 16) / voice->agc_env;
+				if (g < gain)
+					gain = g;
+			}
+			if (gain < voice->agc_gain)
+				voice->agc_gain = gain;
+			else
+				voice->agc_gain += (gain - voice->agc_gain) >> AGC_RISE_SHIFT;
+		}
+
+		data[i] = _sat32(((int64_t)x * voice->agc_gain) >> 16);
+	}
+}
+
+/**
+ * \brief Low-pass and keep one sample out of decimation, in place
+ * \return number of output samples
+ */
+static uint32_t _decimate(struct _audiodsp_voice* voice, int32_t* data,
+		uint32_t count)
+{
+	uint32_t i, out = 0;
+	int k;
+
+	for (i = 0; i < count; i++) {
+		int32_t* h;
+		int64_t acc = 0;
+
+		/* history is doubled so that the last taps are contiguous,
+		 * newest sample first */
+		voice->pos = (voice->pos ? voice->pos : AUDIODSP_VOICE_TAPS) - 1;
+		voice->history[voice->pos] = data[i];
+		voice->history[voice->pos + AUDIODSP_VOICE_TAPS] = data[i];
+
+		if (++voice->phase < voice->decimation)
+			continue;
+		voice->phase = 0;
+
+		h = &voice->history[voice->pos];
+		for (k = 0; k < AUDIODSP_VOICE_TAPS; k++)
+			acc += (int64_t)voice->fir[k] * h[k];
+		data[out++] = _sat32((acc + (1 << 14)) >> 15);
+	}
+
+	return out;
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+int audiodsp_voice_init(struct _audiodsp_voice* voice)
+{
+	int i;
+
+	if (voice->rate == 0 || voice->decimation == 0 ||
+	    voice->decimation > AUDIODSP_VOICE_MAX_DECIMATION ||
+	    voice->dc_shift > 30 || voice->agc_target < 0 ||
+	    voice->agc_max_gain_db > AUDIODSP_VOICE_MAX_AGC_GAIN_DB)
+		return -EINVAL;
+
+	memset(voice->hp_state, 0, sizeof(voice->hp_state));
+
+	voice->dc_x1 = 0;
+	voice->dc_y1 = 0;
+
+	voice->agc_env = 0;
+	voice->agc_gain = AGC_UNITY;
+	voice->agc_max = _db_gain[voice->agc_max_gain_db % AGC_DB_STEP];
+	for (i = AGC_DB_STEP; i <= voice->agc_max_gain_db; i += AGC_DB_STEP)
+		voice->agc_max *= 10;
+	voice->agc_count = 0;
+
+	voice->pos = 0;
+	voice->phase = 0;
+	memset(voice->history, 0, sizeof(voice->history));
+	voice->fir = voice->decimation > 1 ? _fir[voice->decimation - 2] : NULL;
+
+	return 0;
+}
+
+uint32_t audiodsp_voice_process(struct _audiodsp_voice* voice,
+		const int16_t* in, uint32_t count, int16_t* out)
+{
+	int32_t* block = voice->block;
+	uint32_t total = 0;
+
+	while (count) {
+		uint32_t n = min_u32(count, AUDIODSP_BLOCK_FRAMES);
+		uint32_t m = n;
+
+		audiodsp_c_ops.load(in, AUDIODSP_S16, 1, 0, block, n);
+
+		if (voice->dc_shift)
+			_dc_removal(voice, block, n);
+		if (voice->highpass)
+			audiodsp_biquad_run(voice->highpass, voice->hp_state, block, n);
+		if (voice->agc_target)
+			_agc(voice, block, n);
+		if (voice->decimation > 1)
+			m = _decimate(voice, block, n);
+
+		/* output never runs ahead of input, in place is safe */
+		audiodsp_c_ops.store(&block, 1, AUDIODSP_S16, out, m);
+
+		in += n;
+		out += m;
+		count -= n;
+		total += m;
+	}
+
+	return total;
+}
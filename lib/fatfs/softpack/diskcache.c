@@ -0,0 +1,590 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "diskcache.h"
+#include "mm/cache.h"
+
+#if _USE_DISKCACHE
+
+/*----------------------------------------------------------------------------
+ *        Definitions
+ *----------------------------------------------------------------------------*/
+
+#if _DISKCACHE_SECTORS < 4
+#error _DISKCACHE_SECTORS must be at least 4
+#endif
+
+/** Number of sectors of the staging buffer used for read-ahead and for
+ * writing back runs of contiguous dirty sectors */
+#if _DISKCACHE_READ_AHEAD > 1
+#define DISKCACHE_STAGING_SECTORS _DISKCACHE_READ_AHEAD
+#else
+#define DISKCACHE_STAGING_SECTORS 1
+#endif
+
+/** Transfers larger than this number of sectors bypass the cache */
+#define DISKCACHE_BYPASS_SECTORS (_DISKCACHE_SECTORS / 2)
+
+/** Maximum number of pinned sectors of a drive */
+#define DISKCACHE_MAX_PINNED (_DISKCACHE_SECTORS / 2)
+
+#define ENTRY_VALID  (1 << 0)
+#define ENTRY_DIRTY  (1 << 1)
+#define ENTRY_PINNED (1 << 2)
+
+/*----------------------------------------------------------------------------
+ *        Local types
+ *----------------------------------------------------------------------------*/
+
+struct _diskcache_entry {
+	DWORD sector;
+	uint32_t stamp;
+	BYTE flags;
+};
+
+/** Cache state of a physical drive. Each drive has its own set of entries
+ * and its own lock, so that accesses to different drives run in parallel. */
+struct _diskcache_drive {
+	BYTE pdrv;
+	const struct _diskcache_ops* ops;
+	DWORD sectors;
+	DWORD pin_start;
+	DWORD pin_count;
+	DWORD next_sector;
+	struct _diskcache_entry entries[_DISKCACHE_SECTORS];
+	uint32_t stamp;
+	uint32_t pinned;
+	struct _diskcache_stats stats;
+#if _FS_REENTRANT
+	_SYNC_t lock;
+#endif
+};
+
+/*----------------------------------------------------------------------------
+ *        Local variables
+ *----------------------------------------------------------------------------*/
+
+static struct _diskcache_drive _diskcache[_VOLUMES];
+
+static bool _diskcache_initialized;
+
+CACHE_ALIGNED static BYTE _diskcache_data[_VOLUMES][_DISKCACHE_SECTORS][_MAX_SS];
+
+CACHE_ALIGNED static BYTE _diskcache_staging[_VOLUMES][DISKCACHE_STAGING_SECTORS][_MAX_SS];
+
+/** Write-back buffers, separate from the staging buffers since entries can
+ * be evicted while read-ahead data is being inserted */
+CACHE_ALIGNED static BYTE _diskcache_wb[_VOLUMES][DISKCACHE_STAGING_SECTORS][_MAX_SS];
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static int _diskcache_find(struct _diskcache_drive* drive, DWORD sector)
+{
+	int i;
+
+	for (i = 0; i < _DISKCACHE_SECTORS; i++) {
+		struct _diskcache_entry* entry = &drive->entries[i];
+		if ((entry->flags & ENTRY_VALID) && entry->sector == sector)
+			return i;
+	}
+	return -1;
+}
+
+static void _diskcache_touch(struct _diskcache_drive* drive, int index)
+{
+	drive->entries[index].stamp = ++drive->stamp;
+}
+
+static void _diskcache_drop(struct _diskcache_drive* drive, int index)
+{
+	struct _diskcache_entry* entry = &drive->entries[index];
+
+	if (entry->flags & ENTRY_PINNED)
+		drive->pinned--;
+	entry->flags = 0;
+}
+
+static DRESULT _diskcache_dev_read(struct _diskcache_drive* drive,
+				   BYTE* buff, DWORD sector, UINT count)
+{
+	drive->stats.dev_reads++;
+	drive->stats.dev_read_sectors += count;
+	return drive->ops->read(drive->pdrv, buff, sector, count);
+}
+
+static DRESULT _diskcache_dev_write(struct _diskcache_drive* drive,
+				    const BYTE* buff, DWORD sector, UINT count)
+{
+	drive->stats.dev_writes++;
+	drive->stats.dev_write_sectors += count;
+	return drive->ops->write(drive->pdrv, buff, sector, count);
+}
+
+/* Write back a dirty entry, together with the dirty entries of the
+ * following contiguous sectors */
+static DRESULT _diskcache_flush(struct _diskcache_drive* drive, int index)
+{
+	struct _diskcache_entry* entry = &drive->entries[index];
+	BYTE (*data)[_MAX_SS] = _diskcache_data[drive->pdrv];
+	BYTE (*wb)[_MAX_SS] = _diskcache_wb[drive->pdrv];
+	int run[DISKCACHE_STAGING_SECTORS];
+	DRESULT res;
+	UINT count, i;
+
+	run[0] = index;
+	for (count = 1; count < DISKCACHE_STAGING_SECTORS; count++) {
+		int next = _diskcache_find(drive, entry->sector + count);
+		if (next < 0 || !(drive->entries[next].flags & ENTRY_DIRTY))
+			break;
+		run[count] = next;
+	}
+
+	if (count == 1) {
+		res = _diskcache_dev_write(drive, data[index], entry->sector, 1);
+	} else {
+		for (i = 0; i < count; i++)
+			memcpy(wb[i], data[run[i]], _MAX_SS);
+		res = _diskcache_dev_write(drive, wb[0], entry->sector, count);
+	}
+
+	if (res == RES_OK)
+		for (i = 0; i < count; i++)
+			drive->entries[run[i]].flags &= ~ENTRY_DIRTY;
+
+	return res;
+}
+
+static bool _diskcache_is_pinned(struct _diskcache_drive* drive, DWORD sector)
+{
+	return drive->pin_count && sector >= drive->pin_start &&
+	       sector - drive->pin_start < drive->pin_count;
+}
+
+/* Allocate an entry for a sector, evicting the least recently used one if
+ * needed. Returns -1 if a dirty entry could not be written back. */
+static int _diskcache_alloc(struct _diskcache_drive* drive, DWORD sector)
+{
+	struct _diskcache_entry* entry;
+	int i, victim = -1;
+
+	for (i = 0; i < _DISKCACHE_SECTORS; i++) {
+		entry = &drive->entries[i];
+		if (!(entry->flags & ENTRY_VALID)) {
+			victim = i;
+			break;
+		}
+		if (entry->flags & ENTRY_PINNED)
+			continue;
+		if (victim < 0 || (int32_t)(entry->stamp - drive->entries[victim].stamp) < 0)
+			victim = i;
+	}
+	if (victim < 0)
+		return -1;
+
+	entry = &drive->entries[victim];
+	if ((entry->flags & ENTRY_DIRTY) && _diskcache_flush(drive, victim) != RES_OK)
+		return -1;
+	_diskcache_drop(drive, victim);
+
+	entry->sector = sector;
+	entry->flags = ENTRY_VALID;
+	if (_diskcache_is_pinned(drive, sector) &&
+	    drive->pinned < DISKCACHE_MAX_PINNED) {
+		entry->flags |= ENTRY_PINNED;
+		drive->pinned++;
+	}
+	_diskcache_touch(drive, victim);
+
+	return victim;
+}
+
+/* Write back the dirty entries in a sector range */
+static DRESULT _diskcache_flush_range(struct _diskcache_drive* drive,
+				      DWORD sector, UINT count)
+{
+	DRESULT res;
+	int i;
+
+	for (i = 0; i < _DISKCACHE_SECTORS; i++) {
+		struct _diskcache_entry* entry = &drive->entries[i];
+		if ((entry->flags & ENTRY_DIRTY) &&
+		    entry->sector >= sector && entry->sector - sector < count) {
+			res = _diskcache_flush(drive, i);
+			if (res != RES_OK)
+				return res;
+		}
+	}
+	return RES_OK;
+}
+
+/* Drop the entries in a sector range */
+static void _diskcache_drop_range(struct _diskcache_drive* drive,
+				  DWORD sector, UINT count)
+{
+	int i;
+
+	for (i = 0; i < _DISKCACHE_SECTORS; i++) {
+		struct _diskcache_entry* entry = &drive->entries[i];
+		if ((entry->flags & ENTRY_VALID) &&
+		    entry->sector >= sector && entry->sector - sector < count)
+			_diskcache_drop(drive, i);
+	}
+}
+
+/* Lock the cache of a physical drive. Returns NULL if the drive number is
+ * invalid, if the cache is not initialized or on lock timeout. */
+static struct _diskcache_drive* _diskcache_lock(BYTE pdrv)
+{
+	if (pdrv >= _VOLUMES || !_diskcache_initialized)
+		return NULL;
+#if _FS_REENTRANT
+	if (!ff_req_grant(_diskcache[pdrv].lock))
+		return NULL;
+#endif
+	return &_diskcache[pdrv];
+}
+
+static void _diskcache_unlock(struct _diskcache_drive* drive)
+{
+#if _FS_REENTRANT
+	ff_rel_grant(drive->lock);
+#endif
+}
+
+static void _diskcache_detach(struct _diskcache_drive* drive)
+{
+	_diskcache_drop_range(drive, 0, 0xffffffff);
+	drive->ops = NULL;
+	drive->sectors = 0;
+	drive->pin_start = 0;
+	drive->pin_count = 0;
+	drive->next_sector = 0;
+	memset(&drive->stats, 0, sizeof(drive->stats));
+}
+
+static void _diskcache_attach(struct _diskcache_drive* drive,
+			      const struct _diskcache_ops* ops, DWORD sectors)
+{
+	_diskcache_detach(drive);
+	drive->ops = ops;
+	drive->sectors = sectors;
+}
+
+static DRESULT _diskcache_read(struct _diskcache_drive* drive,
+			       BYTE* buff, DWORD sector, UINT count)
+{
+	BYTE (*data)[_MAX_SS] = _diskcache_data[drive->pdrv];
+	BYTE (*staging)[_MAX_SS] = _diskcache_staging[drive->pdrv];
+	bool sequential;
+	DRESULT res;
+	UINT i, j, run, len;
+	int index;
+
+	if (!drive->ops)
+		return RES_NOTRDY;
+	if (sector >= drive->sectors || count > drive->sectors - sector)
+		return RES_PARERR;
+
+	sequential = (sector == drive->next_sector);
+	drive->next_sector = sector + count;
+
+	if (count > DISKCACHE_BYPASS_SECTORS) {
+		/* Large transfer: write back the cached data and read directly
+		 * from the device */
+		res = _diskcache_flush_range(drive, sector, count);
+		if (res != RES_OK)
+			return res;
+		drive->stats.misses += count;
+		return _diskcache_dev_read(drive, buff, sector, count);
+	}
+
+	for (i = 0; i < count; i += run) {
+		index = _diskcache_find(drive, sector + i);
+		if (index >= 0) {
+			memcpy(&buff[i * _MAX_SS], data[index], _MAX_SS);
+			_diskcache_touch(drive, index);
+			drive->stats.hits++;
+			run = 1;
+			continue;
+		}
+
+		/* Count missing contiguous sectors */
+		for (run = 1; i + run < count && run < DISKCACHE_STAGING_SECTORS; run++)
+			if (_diskcache_find(drive, sector + i + run) >= 0)
+				break;
+
+		/* Extend the device read up to the read-ahead size when the
+		 * access is sequential and reaches the end of the request */
+		len = run;
+		if (sequential && i + run == count) {
+			len = DISKCACHE_STAGING_SECTORS;
+			if (len > drive->sectors - (sector + i))
+				len = drive->sectors - (sector + i);
+			if (len < run)
+				len = run;
+		}
+
+		res = _diskcache_dev_read(drive, staging[0], sector + i, len);
+		if (res != RES_OK)
+			return res;
+		drive->stats.misses += run;
+		drive->stats.read_ahead += len - run;
+
+		for (j = 0; j < len; j++) {
+			if (j < run)
+				memcpy(&buff[(i + j) * _MAX_SS], staging[j], _MAX_SS);
+			else if (_diskcache_find(drive, sector + i + j) >= 0)
+				continue;
+			index = _diskcache_alloc(drive, sector + i + j);
+			if (index < 0)
+				continue;
+			memcpy(data[index], staging[j], _MAX_SS);
+		}
+	}
+
+	return RES_OK;
+}
+
+static DRESULT _diskcache_write(struct _diskcache_drive* drive,
+				const BYTE* buff, DWORD sector, UINT count)
+{
+	BYTE (*data)[_MAX_SS] = _diskcache_data[drive->pdrv];
+	UINT i;
+	int index;
+
+	if (!drive->ops)
+		return RES_NOTRDY;
+	if (sector >= drive->sectors || count > drive->sectors - sector)
+		return RES_PARERR;
+
+	if (count > DISKCACHE_BYPASS_SECTORS) {
+		/* Large transfer: cached data is superseded, write directly to
+		 * the device */
+		_diskcache_drop_range(drive, sector, count);
+		return _diskcache_dev_write(drive, buff, sector, count);
+	}
+
+	for (i = 0; i < count; i++) {
+		index = _diskcache_find(drive, sector + i);
+		if (index < 0)
+			index = _diskcache_alloc(drive, sector + i);
+		if (index < 0) {
+			/* No entry available, write through */
+			DRESULT res = _diskcache_dev_write(drive,
+			                                   &buff[i * _MAX_SS],
+			                                   sector + i, 1);
+			if (res != RES_OK)
+				return res;
+			continue;
+		}
+		memcpy(data[index], &buff[i * _MAX_SS], _MAX_SS);
+		drive->entries[index].flags |= ENTRY_DIRTY;
+		_diskcache_touch(drive, index);
+	}
+
+	return RES_OK;
+}
+
+static DRESULT _diskcache_sync(struct _diskcache_drive* drive)
+{
+	DRESULT res;
+	int i, first;
+
+	if (!drive->ops)
+		return RES_NOTRDY;
+
+	/* Write back dirty entries by increasing sector number so that
+	 * contiguous sectors are grouped */
+	while (true) {
+		first = -1;
+		for (i = 0; i < _DISKCACHE_SECTORS; i++) {
+			struct _diskcache_entry* entry = &drive->entries[i];
+			if (!(entry->flags & ENTRY_DIRTY))
+				continue;
+			if (first < 0 || entry->sector < drive->entries[first].sector)
+				first = i;
+		}
+		if (first < 0)
+			return RES_OK;
+		res = _diskcache_flush(drive, first);
+		if (res != RES_OK)
+			return res;
+	}
+}
+
+static void _diskcache_pin(struct _diskcache_drive* drive, DWORD sector, DWORD count)
+{
+	int i;
+
+	drive->pin_start = sector;
+	drive->pin_count = count;
+
+	/* Update the already cached entries */
+	for (i = 0; i < _DISKCACHE_SECTORS; i++) {
+		struct _diskcache_entry* entry = &drive->entries[i];
+		if (!(entry->flags & ENTRY_VALID))
+			continue;
+		if (_diskcache_is_pinned(drive, entry->sector)) {
+			if (!(entry->flags & ENTRY_PINNED) &&
+			    drive->pinned < DISKCACHE_MAX_PINNED) {
+				entry->flags |= ENTRY_PINNED;
+				drive->pinned++;
+			}
+		} else if (entry->flags & ENTRY_PINNED) {
+			entry->flags &= ~ENTRY_PINNED;
+			drive->pinned--;
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+DRESULT diskcache_init(void)
+{
+	BYTE pdrv;
+
+	if (_diskcache_initialized)
+		return RES_OK;
+
+	memset(_diskcache, 0, sizeof(_diskcache));
+	for (pdrv = 0; pdrv < _VOLUMES; pdrv++) {
+		_diskcache[pdrv].pdrv = pdrv;
+#if _FS_REENTRANT
+		if (!ff_cre_syncobj(pdrv, &_diskcache[pdrv].lock)) {
+			while (pdrv--)
+				ff_del_syncobj(_diskcache[pdrv].lock);
+			return RES_ERROR;
+		}
+#endif
+	}
+	_diskcache_initialized = true;
+
+	return RES_OK;
+}
+
+void diskcache_attach(BYTE pdrv, const struct _diskcache_ops* ops, DWORD sectors)
+{
+	struct _diskcache_drive* drive = _diskcache_lock(pdrv);
+
+	if (!drive)
+		return;
+	_diskcache_attach(drive, ops, sectors);
+	_diskcache_unlock(drive);
+}
+
+void diskcache_detach(BYTE pdrv)
+{
+	struct _diskcache_drive* drive = _diskcache_lock(pdrv);
+
+	if (!drive)
+		return;
+	_diskcache_detach(drive);
+	_diskcache_unlock(drive);
+}
+
+DRESULT diskcache_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
+{
+	struct _diskcache_drive* drive = _diskcache_lock(pdrv);
+	DRESULT res;
+
+	if (!drive)
+		return RES_NOTRDY;
+	res = _diskcache_read(drive, buff, sector, count);
+	_diskcache_unlock(drive);
+	return res;
+}
+
+DRESULT diskcache_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
+{
+	struct _diskcache_drive* drive = _diskcache_lock(pdrv);
+	DRESULT res;
+
+	if (!drive)
+		return RES_NOTRDY;
+	res = _diskcache_write(drive, buff, sector, count);
+	_diskcache_unlock(drive);
+	return res;
+}
+
+DRESULT diskcache_sync(BYTE pdrv)
+{
+	struct _diskcache_drive* drive = _diskcache_lock(pdrv);
+	DRESULT res;
+
+	if (!drive)
+		return RES_NOTRDY;
+	res = _diskcache_sync(drive);
+	_diskcache_unlock(drive);
+	return res;
+}
+
+void diskcache_pin(BYTE pdrv, DWORD sector, DWORD count)
+{
+	struct _diskcache_drive* drive = _diskcache_lock(pdrv);
+
+	if (!drive)
+		return;
+	_diskcache_pin(drive, sector, count);
+	_diskcache_unlock(drive);
+}
+
+void diskcache_pin_fat(const FATFS* fs)
+{
+	/* Pin the FATs and, on FAT12/16 volumes, the root directory */
+	if (fs->fs_type)
+		diskcache_pin(fs->drv, fs->fatbase, fs->database - fs->fatbase);
+}
+
+void diskcache_get_stats(BYTE pdrv, struct _diskcache_stats* stats)
+{
+	if (pdrv < _VOLUMES)
+		memcpy(stats, &_diskcache[pdrv].stats, sizeof(*stats));
+}
+
+void diskcache_reset_stats(BYTE pdrv)
+{
+	if (pdrv < _VOLUMES)
+		memset(&_diskcache[pdrv].stats, 0, sizeof(_diskcache[pdrv].stats));
+}
+
+#endif /* _USE_DISKCACHE */
@@ -0,0 +1,162 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Write-back sector cache between FatFs and the disk I/O layer.
+ *
+ * Each physical drive has its own set of _DISKCACHE_SECTORS cached sectors.
+ * Sectors are evicted in LRU order, except the sectors of a pinned region
+ * (typically the FAT) which are kept as long as they use less than half of
+ * the set. When sequential reads are detected, _DISKCACHE_READ_AHEAD sectors
+ * are read in advance with a single multi-block transfer. Dirty sectors are
+ * written back, grouped by runs of contiguous sectors, on eviction and on
+ * diskcache_sync() (CTRL_SYNC).
+ * Large transfers bypass the cache.
+ *
+ * The cache is enabled with _USE_DISKCACHE in ffconf.h and initialized with
+ * diskcache_init() before the first mount. The disk I/O layer registers its
+ * raw read/write functions with diskcache_attach() and forwards disk_read(),
+ * disk_write() and CTRL_SYNC to the cache.
+ *
+ * With _FS_REENTRANT, diskcache_init() creates one sync object per drive with
+ * ff_cre_syncobj(), so it shall be called before tasks start. Accesses to
+ * different drives do not block each other.
+ */
+
+#ifndef _DISKCACHE_H_
+#define _DISKCACHE_H_
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+#include "ff.h"
+#include "diskio.h"
+
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+/** Raw access functions of a physical drive */
+struct _diskcache_ops {
+	DRESULT (*read)(BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
+	DRESULT (*write)(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
+};
+
+/** I/O counters of a physical drive */
+struct _diskcache_stats {
+	uint32_t hits;              /* sectors read from the cache */
+	uint32_t misses;            /* sectors read from the device */
+	uint32_t read_ahead;        /* sectors read in advance */
+	uint32_t dev_reads;         /* device read requests */
+	uint32_t dev_read_sectors;  /* sectors read from the device */
+	uint32_t dev_writes;        /* device write requests */
+	uint32_t dev_write_sectors; /* sectors written to the device */
+};
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Initialize the cache and, with _FS_REENTRANT, create the sync
+ * objects of the drives. Shall be called once before the drives are used.
+ * \return Result code; RES_OK if successful.
+ */
+extern DRESULT diskcache_init(void);
+
+/**
+ * \brief Attach a physical drive to the cache. Previously cached sectors of
+ * the drive are dropped.
+ * \param pdrv  Physical drive number.
+ * \param ops  Raw access functions of the drive.
+ * \param sectors  Number of sectors of the drive.
+ */
+extern void diskcache_attach(BYTE pdrv, const struct _diskcache_ops* ops, DWORD sectors);
+
+/**
+ * \brief Detach a physical drive from the cache, without writing back dirty
+ * sectors (e.g. after media removal).
+ * \param pdrv  Physical drive number.
+ */
+extern void diskcache_detach(BYTE pdrv);
+
+/**
+ * \brief Read sectors through the cache.
+ * \return Result code; RES_OK if successful.
+ */
+extern DRESULT diskcache_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
+
+/**
+ * \brief Write sectors to the cache. Sectors are written to the device on
+ * eviction or diskcache_sync().
+ * \return Result code; RES_OK if successful.
+ */
+extern DRESULT diskcache_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
+
+/**
+ * \brief Write back all the dirty sectors of a physical drive.
+ * \param pdrv  Physical drive number.
+ * \return Result code; RES_OK if successful.
+ */
+extern DRESULT diskcache_sync(BYTE pdrv);
+
+/**
+ * \brief Define the region of a physical drive whose sectors are pinned in
+ * the cache.
+ * \param pdrv  Physical drive number.
+ * \param sector  First sector of the region.
+ * \param count  Number of sectors in the region (0 to disable pinning).
+ */
+extern void diskcache_pin(BYTE pdrv, DWORD sector, DWORD count);
+
+/**
+ * \brief Pin the FAT region of a mounted volume in the cache.
+ * \param fs  Mounted file system object.
+ */
+extern void diskcache_pin_fat(const FATFS* fs);
+
+/**
+ * \brief Get the I/O counters of a physical drive.
+ * \param pdrv  Physical drive number.
+ * \param stats  Structure to fill.
+ */
+extern void diskcache_get_stats(BYTE pdrv, struct _diskcache_stats* stats);
+
+/**
+ * \brief Clear the I/O counters of a physical drive.
+ * \param pdrv  Physical drive number.
+ */
+extern void diskcache_reset_stats(BYTE pdrv);
+
+#endif /* _DISKCACHE_H_ */
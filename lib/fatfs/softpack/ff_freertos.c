@@ -0,0 +1,95 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ * FreeRTOS synchronization and memory functions required by FatFs, see
+ * option/syscall.c.
+ *
+ * Each mounted volume gets its own FreeRTOS mutex, so that tasks accessing
+ * different volumes do not wait for each other. Set in ffconf.h:
+ *   #define _FS_REENTRANT  1
+ *   #define _FS_TIMEOUT    <timeout in FreeRTOS ticks>
+ *   #define _SYNC_t        void*
+ *----------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stddef.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include "ff.h"
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+#if _FS_REENTRANT
+
+int ff_cre_syncobj(BYTE vol, _SYNC_t* sobj)
+{
+	(void)vol;
+	*sobj = (_SYNC_t)xSemaphoreCreateMutex();
+	return *sobj != NULL;
+}
+
+int ff_del_syncobj(_SYNC_t sobj)
+{
+	vSemaphoreDelete((SemaphoreHandle_t)sobj);
+	return 1;
+}
+
+int ff_req_grant(_SYNC_t sobj)
+{
+	return xSemaphoreTake((SemaphoreHandle_t)sobj, _FS_TIMEOUT) == pdTRUE;
+}
+
+void ff_rel_grant(_SYNC_t sobj)
+{
+	xSemaphoreGive((SemaphoreHandle_t)sobj);
+}
+
+#endif /* _FS_REENTRANT */
+
+#if _USE_LFN == 3
+
+void* ff_memalloc(UINT msize)
+{
+	return pvPortMalloc(msize);
+}
+
+void ff_memfree(void* mblock)
+{
+	vPortFree(mblock);
+}
+
+#endif /* _USE_LFN == 3 */
@@ -0,0 +1,193 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "ffstream.h"
+
+#if _USE_EXPAND && !_FS_READONLY
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static UINT _ffstream_sector_size(const FATFS* fs)
+{
+#if _MAX_SS == _MIN_SS
+	(void)fs;
+	return _MAX_SS;
+#else
+	return fs->ssize;
+#endif
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+FRESULT ffstream_create(struct _ffstream* stream, FIL* fp,
+		const TCHAR* path, FSIZE_t size)
+{
+	FATFS* fs;
+	FRESULT res;
+
+	memset(stream, 0, sizeof(*stream));
+
+	res = f_open(fp, path, FA_CREATE_ALWAYS | FA_WRITE);
+	if (res != FR_OK)
+		return res;
+
+	res = f_expand(fp, size, 1);
+	if (res != FR_OK) {
+		f_close(fp);
+		return res;
+	}
+
+	fs = fp->obj.fs;
+
+	/* f_expand() does not account for the allocated clusters in the free
+	 * cluster count */
+	if (fs->free_clst <= fs->n_fatent - 2) {
+		DWORD csz = (DWORD)fs->csize * _ffstream_sector_size(fs);
+		fs->free_clst -= (DWORD)((size + csz - 1) / csz);
+		fs->fsi_flag |= 1;
+	}
+
+	stream->fp = fp;
+	stream->pdrv = fs->drv;
+	stream->ssize = _ffstream_sector_size(fs);
+	stream->lba = fs->database + (DWORD)fs->csize * (fp->obj.sclust - 2);
+	stream->sectors = (DWORD)((size + stream->ssize - 1) / stream->ssize);
+
+	/* Commit the allocation, so that the clusters are not lost if the
+	 * stream is never closed */
+	res = f_sync(fp);
+	if (res != FR_OK) {
+		f_close(fp);
+		stream->fp = NULL;
+	}
+	return res;
+}
+
+void ffstream_get_extent(const struct _ffstream* stream,
+		DWORD* lba, DWORD* sectors)
+{
+	*lba = stream->lba;
+	*sectors = stream->sectors;
+}
+
+FRESULT ffstream_write(struct _ffstream* stream, const void* buff, UINT len)
+{
+	DRESULT dres;
+	DWORD count;
+
+	if (!stream->fp)
+		return FR_INVALID_OBJECT;
+	if (len == 0)
+		return FR_OK;
+
+	/* A partial sector terminates the stream */
+	if (stream->length != (FSIZE_t)stream->pos * stream->ssize)
+		return FR_DENIED;
+
+	count = (len + stream->ssize - 1) / stream->ssize;
+	if (count > stream->sectors - stream->pos)
+		return FR_DENIED;
+
+#if _FS_REENTRANT
+	/* The media is accessed outside of FatFs, take the volume lock */
+	if (!ff_req_grant(stream->fp->obj.fs->sobj))
+		return FR_TIMEOUT;
+#endif
+	dres = disk_write(stream->pdrv, (const BYTE*)buff,
+	                  stream->lba + stream->pos, count);
+#if _FS_REENTRANT
+	ff_rel_grant(stream->fp->obj.fs->sobj);
+#endif
+	if (dres != RES_OK)
+		return FR_DISK_ERR;
+
+	stream->pos += count;
+	stream->length += len;
+	return FR_OK;
+}
+
+FSIZE_t ffstream_get_free(const struct _ffstream* stream)
+{
+	if (stream->length != (FSIZE_t)stream->pos * stream->ssize)
+		return 0;
+	return (FSIZE_t)(stream->sectors - stream->pos) * stream->ssize;
+}
+
+FRESULT ffstream_close(struct _ffstream* stream)
+{
+	FIL* fp = stream->fp;
+	FRESULT res = FR_OK;
+
+	if (!fp)
+		return FR_INVALID_OBJECT;
+
+	/* Flush the data written by the disk I/O layer before updating the
+	 * directory entry */
+#if _FS_REENTRANT
+	if (!ff_req_grant(fp->obj.fs->sobj))
+		res = FR_TIMEOUT;
+	else {
+		if (disk_ioctl(stream->pdrv, CTRL_SYNC, NULL) != RES_OK)
+			res = FR_DISK_ERR;
+		ff_rel_grant(fp->obj.fs->sobj);
+	}
+#else
+	if (disk_ioctl(stream->pdrv, CTRL_SYNC, NULL) != RES_OK)
+		res = FR_DISK_ERR;
+#endif
+
+	/* Shrink the file to the data length, releasing the unused clusters */
+	if (res == FR_OK && stream->length < f_size(fp)) {
+		res = f_lseek(fp, stream->length);
+		if (res == FR_OK)
+			res = f_truncate(fp);
+	}
+
+	if (res == FR_OK)
+		res = f_close(fp);
+	else
+		f_close(fp);
+
+	stream->fp = NULL;
+	return res;
+}
+
+#endif /* _USE_EXPAND && !_FS_READONLY */
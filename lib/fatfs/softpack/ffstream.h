@@ -0,0 +1,128 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Contiguous file streaming on top of FatFs.
+ *
+ * A stream is a file whose clusters are preallocated as a single contiguous
+ * block with f_expand() (on exFAT, the file is flagged as contiguous, so no
+ * FAT chain is written). The block is exposed as one LBA extent and the
+ * application writes whole sectors directly to the media with multi-block
+ * disk_write() requests, bypassing the FatFs sector window and the cluster
+ * by cluster allocation of f_write(). The directory entry is updated once,
+ * with the actual data length, when the stream is closed; unused clusters
+ * at the end of the block are released.
+ *
+ * Requires _USE_EXPAND set to 1 in ffconf.h. Since data is written to the
+ * media outside of the FatFs API, the file must not be accessed through
+ * f_read()/f_write() until the stream is closed. Buffers are passed to the
+ * disk I/O layer as-is and must therefore meet its DMA requirements.
+ */
+
+#ifndef _FFSTREAM_H_
+#define _FFSTREAM_H_
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include "ff.h"
+
+/*----------------------------------------------------------------------------
+ *        Types
+ *----------------------------------------------------------------------------*/
+
+struct _ffstream {
+	FIL* fp;           /* file object, opened by ffstream_create() */
+	DWORD lba;         /* first sector of the extent */
+	DWORD sectors;     /* number of sectors of the extent */
+
+	/* --- following fields are used internally --- */
+	DWORD pos;         /* next sector to write, relative to lba */
+	FSIZE_t length;    /* number of bytes written */
+	UINT ssize;        /* sector size */
+	BYTE pdrv;         /* physical drive number */
+};
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Create a file and preallocate a contiguous block of clusters for it.
+ * \param stream  Stream descriptor to initialize.
+ * \param fp  File object to use for the stream.
+ * \param path  Path of the file, truncated if it already exists.
+ * \param size  Number of bytes to preallocate.
+ * \return FR_OK on success, FR_DENIED if no contiguous block of the requested
+ * size is available, or other FatFs error code.
+ */
+extern FRESULT ffstream_create(struct _ffstream* stream, FIL* fp,
+		const TCHAR* path, FSIZE_t size);
+
+/**
+ * \brief Get the extent allocated to a stream.
+ * \param stream  Stream descriptor.
+ * \param lba  Filled with the first sector of the extent.
+ * \param sectors  Filled with the number of sectors of the extent.
+ */
+extern void ffstream_get_extent(const struct _ffstream* stream,
+		DWORD* lba, DWORD* sectors);
+
+/**
+ * \brief Write data at the current position of a stream with a single
+ * multi-block request.
+ * \param stream  Stream descriptor.
+ * \param buff  Data to write. The buffer is written by whole sectors and must
+ * be sized accordingly.
+ * \param len  Number of bytes to write. Only the last write of a stream may
+ * use a length that is not a multiple of the sector size.
+ * \return FR_OK on success, FR_DENIED if the extent is full or a partial
+ * sector was already written, FR_DISK_ERR on media error.
+ */
+extern FRESULT ffstream_write(struct _ffstream* stream, const void* buff, UINT len);
+
+/**
+ * \brief Get the number of bytes that can still be written to a stream.
+ * \param stream  Stream descriptor.
+ * \return Number of free bytes in the extent.
+ */
+extern FSIZE_t ffstream_get_free(const struct _ffstream* stream);
+
+/**
+ * \brief Close a stream: set the file size to the number of bytes written,
+ * release the unused clusters and update the directory entry.
+ * \param stream  Stream descriptor.
+ * \return FR_OK on success, or FatFs error code.
+ */
+extern FRESULT ffstream_close(struct _ffstream* stream);
+
+#endif /* _FFSTREAM_H_ */
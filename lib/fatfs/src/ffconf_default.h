@@ -48,7 +48,8 @@
 
 
 #define	_USE_EXPAND		0
-/* This option switches f_expand function. (0:Disable or 1:Enable) */
+/* This option switches f_expand function. (0:Disable or 1:Enable)
+/  It is required by the streaming API (lib/fatfs/softpack/ffstream.c). */
 
 
 #define _USE_CHMOD		0
@@ -198,6 +199,18 @@
 */
 
 
+#define _USE_DISKCACHE	0
+#define _DISKCACHE_SECTORS	32
+#define _DISKCACHE_READ_AHEAD	8
+/* The option _USE_DISKCACHE switches the write-back sector cache inserted
+/  between FatFs and the disk I/O layer (lib/fatfs/softpack/diskcache.c).
+/  (0:Disable or 1:Enable)
+/  _DISKCACHE_SECTORS defines the number of cached sectors of each physical
+/  drive. _DISKCACHE_READ_AHEAD defines the number of sectors read in advance
+/  when a sequential access is detected. Dirty sectors are written back on
+/  eviction and on CTRL_SYNC. */
+
+
 
 /*---------------------------------------------------------------------------/
 / System Configurations
@@ -260,7 +273,10 @@
 /  The _FS_TIMEOUT defines timeout period in unit of time tick.
 /  The _SYNC_t defines O/S dependent sync object type. e.g. HANDLE, ID, OS_EVENT*,
 /  SemaphoreHandle_t and etc.. A header file for O/S definitions needs to be
-/  included somewhere in the scope of ff.c. */
+/  included somewhere in the scope of ff.c.
+/
+/  With FreeRTOS, lib/fatfs/softpack/ff_freertos.c provides the synchronization
+/  handlers; define _SYNC_t as void* and _FS_TIMEOUT in FreeRTOS ticks. */
 
 
 /*--- End of configuration options ---*/
@@ -0,0 +1,432 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "errno.h"
+#include "mm/cache.h"
+
+#include "gfx.h"
+#include "gfx_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local definitions
+ *------------------------------------------------------------------------------*/
+
+/** Dirty rectangles at least this wide are cleaned as a single region */
+#define CLEAN_FULL_WIDTH_RATIO 2
+
+/*------------------------------------------------------------------------------
+ *         Local variables
+ *------------------------------------------------------------------------------*/
+
+#ifdef CONFIG_HAVE_NEON
+static const struct _gfx_ops* _ops = &gfx_neon_ops;
+#else
+static const struct _gfx_ops* _ops = &gfx_c_ops;
+#endif
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+static inline int32_t _min(int32_t a, int32_t b)
+{
+	return a < b ? a : b;
+}
+
+static inline int32_t _max(int32_t a, int32_t b)
+{
+	return a > b ? a : b;
+}
+
+static inline uint8_t* _address(const struct _gfx_surface* surface,
+		int32_t x, int32_t y)
+{
+	return surface->buffer + y * surface->stride + x * (surface->bpp / 8);
+}
+
+/**
+ * \brief Convert a 0xAARRGGBB color to the surface format
+ */
+static uint32_t _pixel(const struct _gfx_surface* surface, uint32_t color)
+{
+	switch (surface->bpp) {
+	case 16:
+		return ((color >> 8) & 0xf800) | ((color >> 5) & 0x07e0) |
+		       ((color >> 3) & 0x001f);
+	case 24:
+		return color & 0xffffff;
+	default:
+		return color;
+	}
+}
+
+static inline void _put_pixel(uint8_t* dst, uint32_t pixel, uint8_t bpp)
+{
+	switch (bpp) {
+	case 16:
+		*(uint16_t*)dst = pixel;
+		break;
+	case 24:
+		dst[0] = pixel;
+		dst[1] = pixel >> 8;
+		dst[2] = pixel >> 16;
+		break;
+	default:
+		*(uint32_t*)dst = pixel;
+		break;
+	}
+}
+
+/**
+ * \brief Intersect r with clip, return false if the result is empty
+ */
+static bool _intersect(struct _gfx_rect* r, const struct _gfx_rect* clip)
+{
+	int32_t x1 = _min(r->x + r->w, clip->x + clip->w);
+	int32_t y1 = _min(r->y + r->h, clip->y + clip->h);
+
+	r->x = _max(r->x, clip->x);
+	r->y = _max(r->y, clip->y);
+	r->w = x1 - r->x;
+	r->h = y1 - r->y;
+	return r->w > 0 && r->h > 0;
+}
+
+static void _union(struct _gfx_rect* r, const struct _gfx_rect* a,
+		const struct _gfx_rect* b)
+{
+	int32_t x1 = _max(a->x + a->w, b->x + b->w);
+	int32_t y1 = _max(a->y + a->h, b->y + b->h);
+
+	r->x = _min(a->x, b->x);
+	r->y = _min(a->y, b->y);
+	r->w = x1 - r->x;
+	r->h = y1 - r->y;
+}
+
+/**
+ * \brief Check if two rectangles overlap or share an edge
+ */
+static bool _touch(const struct _gfx_rect* a, const struct _gfx_rect* b)
+{
+	return a->x <= b->x + b->w && b->x <= a->x + a->w &&
+	       a->y <= b->y + b->h && b->y <= a->y + a->h;
+}
+
+static inline uint32_t _area(const struct _gfx_rect* r)
+{
+	return (uint32_t)r->w * (uint32_t)r->h;
+}
+
+static void _copy(struct _gfx_surface* dst, int32_t x, int32_t y,
+		const struct _gfx_surface* src, const struct _gfx_rect* rect)
+{
+	uint32_t len = rect->w * (dst->bpp / 8);
+	int32_t i;
+
+	if (src->buffer == dst->buffer && y > rect->y) {
+		/* overlapping areas of the same buffer, copy from the bottom */
+		for (i = rect->h - 1; i >= 0; i--)
+			memmove(_address(dst, x, y + i),
+				_address(src, rect->x, rect->y + i), len);
+	} else {
+		for (i = 0; i < rect->h; i++)
+			memmove(_address(dst, x, y + i),
+				_address(src, rect->x, rect->y + i), len);
+	}
+}
+
+static void _draw_string(struct _gfx_surface* surface, int32_t x, int32_t y,
+		const struct _gfx_font* font, const char* str, uint32_t color,
+		const uint32_t* bgcolor)
+{
+	struct _gfx_rect box = { x, y, 0, 0 };
+	struct _gfx_rect clip = surface->clip;
+	uint32_t pixel = _pixel(surface, color);
+	uint8_t bytes = surface->bpp / 8;
+	bool cols = font->layout == GFX_FONT_COLS_MSB ||
+	            font->layout == GFX_FONT_COLS_LSB;
+	bool msb = font->layout == GFX_FONT_COLS_MSB ||
+	           font->layout == GFX_FONT_ROWS_MSB;
+	uint32_t line = cols ? (font->height + 7) / 8 : (font->width + 7) / 8;
+	uint32_t size = line * (cols ? font->width : font->height);
+	int32_t x0 = x;
+	int32_t i, j, gx, gy;
+
+	for (; *str; str++) {
+		uint8_t c = *str;
+		const uint8_t* glyph;
+		struct _gfx_rect r;
+
+		if (c == '\n') {
+			x = x0;
+			y += font->height + font->spacing;
+			continue;
+		}
+
+		r.x = x;
+		r.y = y;
+		r.w = font->width;
+		r.h = font->height;
+		_union(&box, &box, &r);
+		x += font->width + font->spacing;
+
+		if (c < font->first || c > font->last || !_intersect(&r, &clip))
+			continue;
+
+		if (bgcolor) {
+			for (j = 0; j < r.h; j++)
+				_ops->fill_span(_address(surface, r.x, r.y + j),
+						r.w, _pixel(surface, *bgcolor),
+						surface->bpp);
+		}
+
+		/* glyph coordinates of the visible part */
+		glyph = font->glyphs + (c - font->first) * size;
+		gx = r.x - (x - font->width - font->spacing);
+		gy = r.y - y;
+		for (j = gy; j < gy + r.h; j++) {
+			uint8_t* dst = _address(surface, r.x, r.y + j - gy);
+			for (i = gx; i < gx + r.w; i++, dst += bytes) {
+				uint8_t bits, bit;
+				if (cols) {
+					bits = glyph[i * line + j / 8];
+					bit = j & 7;
+				} else {
+					bits = glyph[j * line + i / 8];
+					bit = i & 7;
+				}
+				if (msb)
+					bit = 7 - bit;
+				if (bits & (1 << bit))
+					_put_pixel(dst, pixel, surface->bpp);
+			}
+		}
+	}
+
+	gfx_mark_dirty(surface, &box);
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+int gfx_surface_init(struct _gfx_surface* surface, void* buffer,
+		uint16_t width, uint16_t height, uint8_t bpp)
+{
+	if (bpp != 16 && bpp != 24 && bpp != 32)
+		return -EINVAL;
+
+	surface->buffer = buffer;
+	surface->width = width;
+	surface->height = height;
+	surface->stride = width * (bpp / 8);
+	surface->bpp = bpp;
+	surface->dirty_count = 0;
+	gfx_set_clip(surface, NULL);
+	return 0;
+}
+
+bool gfx_use_neon(bool enable)
+{
+#ifdef CONFIG_HAVE_NEON
+	_ops = enable ? &gfx_neon_ops : &gfx_c_ops;
+	return enable;
+#else
+	(void)enable;
+	return false;
+#endif
+}
+
+void gfx_set_clip(struct _gfx_surface* surface, const struct _gfx_rect* clip)
+{
+	surface->clip.x = 0;
+	surface->clip.y = 0;
+	surface->clip.w = surface->width;
+	surface->clip.h = surface->height;
+	if (clip && !_intersect(&surface->clip, clip))
+		surface->clip.w = surface->clip.h = 0;
+}
+
+void gfx_mark_dirty(struct _gfx_surface* surface, const struct _gfx_rect* rect)
+{
+	struct _gfx_rect r = *rect;
+	struct _gfx_rect all = { 0, 0, surface->width, surface->height };
+	uint32_t best_cost = UINT32_MAX;
+	uint8_t best = 0;
+	uint8_t i;
+
+	if (!_intersect(&r, &all))
+		return;
+
+	/* absorb the rectangles touching the new one, the union can then touch
+	 * rectangles that were apart so scan again after each merge */
+	for (i = 0; i < surface->dirty_count; ) {
+		if (_touch(&r, &surface->dirty[i])) {
+			_union(&r, &r, &surface->dirty[i]);
+			surface->dirty[i] = surface->dirty[--surface->dirty_count];
+			i = 0;
+		} else {
+			i++;
+		}
+	}
+
+	if (surface->dirty_count < GFX_MAX_DIRTY) {
+		surface->dirty[surface->dirty_count++] = r;
+		return;
+	}
+
+	/* list full, merge with the rectangle adding the least area */
+	for (i = 0; i < surface->dirty_count; i++) {
+		struct _gfx_rect u;
+		uint32_t cost;
+		_union(&u, &r, &surface->dirty[i]);
+		cost = _area(&u) - _area(&surface->dirty[i]);
+		if (cost < best_cost) {
+			best_cost = cost;
+			best = i;
+		}
+	}
+	_union(&r, &r, &surface->dirty[best]);
+	surface->dirty[best] = surface->dirty[--surface->dirty_count];
+	gfx_mark_dirty(surface, &r);
+}
+
+void gfx_clean_dirty(struct _gfx_surface* surface)
+{
+	uint8_t bytes = surface->bpp / 8;
+	uint8_t i;
+	int32_t j;
+
+	for (i = 0; i < surface->dirty_count; i++) {
+		const struct _gfx_rect* r = &surface->dirty[i];
+		if (r->w * CLEAN_FULL_WIDTH_RATIO >= surface->width) {
+			/* wide rectangle, clean the lines in one go */
+			cache_clean_region(_address(surface, 0, r->y),
+					r->h * surface->stride);
+		} else {
+			for (j = 0; j < r->h; j++)
+				cache_clean_region(_address(surface, r->x, r->y + j),
+						r->w * bytes);
+		}
+	}
+	surface->dirty_count = 0;
+}
+
+void gfx_fill_rect(struct _gfx_surface* surface,
+		int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+	struct _gfx_rect r = { x, y, w, h };
+	uint32_t pixel = _pixel(surface, color);
+	int32_t j;
+
+	if (!_intersect(&r, &surface->clip))
+		return;
+
+	for (j = 0; j < r.h; j++)
+		_ops->fill_span(_address(surface, r.x, r.y + j), r.w, pixel,
+				surface->bpp);
+
+	gfx_mark_dirty(surface, &r);
+}
+
+void gfx_blit(struct _gfx_surface* dst, int32_t x, int32_t y,
+		const struct _gfx_surface* src, const struct _gfx_rect* rect)
+{
+	struct _gfx_rect all = { 0, 0, src->width, src->height };
+	struct _gfx_rect s = rect ? *rect : all;
+	struct _gfx_rect d;
+
+	if (dst->bpp != src->bpp)
+		return;
+	if (!_intersect(&s, &all))
+		return;
+
+	/* clip the destination and move the source rectangle along */
+	d.x = x + s.x - (rect ? rect->x : 0);
+	d.y = y + s.y - (rect ? rect->y : 0);
+	d.w = s.w;
+	d.h = s.h;
+	x = d.x;
+	y = d.y;
+	if (!_intersect(&d, &dst->clip))
+		return;
+	s.x += d.x - x;
+	s.y += d.y - y;
+	s.w = d.w;
+	s.h = d.h;
+
+	_copy(dst, d.x, d.y, src, &s);
+	gfx_mark_dirty(dst, &d);
+}
+
+void gfx_blit_alpha(struct _gfx_surface* dst, int32_t x, int32_t y,
+		const uint32_t* image, int32_t w, int32_t h, uint32_t stride)
+{
+	struct _gfx_rect r = { x, y, w, h };
+	int32_t j;
+
+	if (!_intersect(&r, &dst->clip))
+		return;
+
+	image += (r.y - y) * stride + (r.x - x);
+	for (j = 0; j < r.h; j++, image += stride)
+		_ops->blend_span(_address(dst, r.x, r.y + j), image, r.w,
+				dst->bpp);
+
+	gfx_mark_dirty(dst, &r);
+}
+
+void gfx_draw_string(struct _gfx_surface* surface, int32_t x, int32_t y,
+		const struct _gfx_font* font, const char* str, uint32_t color)
+{
+	_draw_string(surface, x, y, font, str, color, NULL);
+}
+
+void gfx_draw_string_with_bgcolor(struct _gfx_surface* surface,
+		int32_t x, int32_t y, const struct _gfx_font* font, const char* str,
+		uint32_t color, uint32_t bgcolor)
+{
+	_draw_string(surface, x, y, font, str, color, &bgcolor);
+}
+
+void gfx_copy_rect(struct _gfx_surface* dst, const struct _gfx_surface* src,
+		const struct _gfx_rect* rect)
+{
+	_copy(dst, rect->x, rect->y, src, rect);
+	gfx_mark_dirty(dst, rect);
+}
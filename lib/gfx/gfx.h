@@ -0,0 +1,232 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * 2D graphics on RGB frame buffers.
+ *
+ * Drawing goes to a surface, a RGB 565 (16 bpp), RGB 888 (24 bpp) or
+ * ARGB 8888 (32 bpp) frame buffer in the LCDC layer formats. Colors are
+ * given as 0xAARRGGBB and converted to the surface format. All operations
+ * are clipped to the surface clip rectangle.
+ *
+ * Each operation records the area it changed in a short list of dirty
+ * rectangles. gfx_clean_dirty() cleans only these areas from the data cache
+ * before the buffer is displayed, and the gfx_display functions use them to
+ * flip double buffered LCDC layers at start of frame.
+ *
+ * Span fills and alpha blending have NEON versions when the library is built
+ * with CONFIG_HAVE_NEON. Both versions give identical output.
+ */
+
+#ifndef _GFX_H
+#define _GFX_H
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ *         Definitions
+ *------------------------------------------------------------------------------*/
+
+/** Dirty rectangles kept per surface, more are merged */
+#define GFX_MAX_DIRTY 8
+
+/** Glyph bitmap layouts */
+enum _gfx_font_layout {
+	GFX_FONT_COLS_MSB,  /**< columns of bytes, top pixel in bit 7 */
+	GFX_FONT_COLS_LSB,  /**< columns of bytes, top pixel in bit 0 */
+	GFX_FONT_ROWS_MSB,  /**< rows of bytes, left pixel in bit 7 */
+	GFX_FONT_ROWS_LSB,  /**< rows of bytes, left pixel in bit 0 */
+};
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+struct _gfx_rect {
+	int32_t x;
+	int32_t y;
+	int32_t w;
+	int32_t h;
+};
+
+struct _gfx_surface {
+	uint8_t* buffer;        /**< frame buffer */
+	uint16_t width;         /**< width in pixels */
+	uint16_t height;        /**< height in pixels */
+	uint32_t stride;        /**< bytes per line */
+	uint8_t bpp;            /**< 16, 24 or 32 */
+	struct _gfx_rect clip;  /**< drawing is limited to this rectangle */
+
+	/* --- following fields are used internally --- */
+	struct _gfx_rect dirty[GFX_MAX_DIRTY];
+	uint8_t dirty_count;
+};
+
+/** Monochrome bitmap font, one glyph per character from first to last */
+struct _gfx_font {
+	uint8_t width;          /**< glyph width in pixels */
+	uint8_t height;         /**< glyph height in pixels */
+	uint8_t spacing;        /**< space between characters and lines */
+	uint8_t first;          /**< first character */
+	uint8_t last;           /**< last character */
+	uint8_t layout;         /**< enum _gfx_font_layout */
+	const uint8_t* glyphs;  /**< glyph bitmaps */
+};
+
+/** Double buffered LCDC layer */
+struct _gfx_display {
+	uint8_t layer;          /**< LCDC layer ID */
+	uint32_t x;             /**< layer position, ignored for the base layer */
+	uint32_t y;
+
+	/* --- following fields are used internally --- */
+	struct _gfx_surface surface[2];
+	uint8_t back;
+};
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Initialize a surface, clip to the whole surface, nothing dirty.
+ * \param surface surface to initialize
+ * \param buffer frame buffer
+ * \param width width in pixels
+ * \param height height in pixels
+ * \param bpp bits per pixel, 16, 24 or 32
+ * \return 0 on success, -EINVAL if the format is not supported
+ */
+extern int gfx_surface_init(struct _gfx_surface* surface, void* buffer,
+		uint16_t width, uint16_t height, uint8_t bpp);
+
+/**
+ * \brief Select NEON or portable C span functions. NEON is used by default
+ * when available.
+ * \param enable true to use NEON
+ * \return true if NEON is in use
+ */
+extern bool gfx_use_neon(bool enable);
+
+/**
+ * \brief Set the clip rectangle, NULL to clip to the whole surface.
+ */
+extern void gfx_set_clip(struct _gfx_surface* surface,
+		const struct _gfx_rect* clip);
+
+/**
+ * \brief Add a rectangle to the dirty list of a surface.
+ */
+extern void gfx_mark_dirty(struct _gfx_surface* surface,
+		const struct _gfx_rect* rect);
+
+/**
+ * \brief Clean the dirty areas from the data cache and empty the dirty list.
+ */
+extern void gfx_clean_dirty(struct _gfx_surface* surface);
+
+extern void gfx_fill_rect(struct _gfx_surface* surface,
+		int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+
+/**
+ * \brief Copy a rectangle of a surface with the same format.
+ * \param dst destination surface
+ * \param x destination X
+ * \param y destination Y
+ * \param src source surface
+ * \param rect source rectangle, NULL for the whole source
+ */
+extern void gfx_blit(struct _gfx_surface* dst, int32_t x, int32_t y,
+		const struct _gfx_surface* src, const struct _gfx_rect* rect);
+
+/**
+ * \brief Blend an ARGB 8888 image with per pixel alpha.
+ * \param dst destination surface
+ * \param x destination X
+ * \param y destination Y
+ * \param image ARGB pixels
+ * \param w image width
+ * \param h image height
+ * \param stride image line length in pixels
+ */
+extern void gfx_blit_alpha(struct _gfx_surface* dst, int32_t x, int32_t y,
+		const uint32_t* image, int32_t w, int32_t h, uint32_t stride);
+
+/**
+ * \brief Draw a string, '\n' starts a new line.
+ * \param surface destination surface
+ * \param x X of the top left corner
+ * \param y Y of the top left corner
+ * \param font font
+ * \param str string
+ * \param color text color
+ */
+extern void gfx_draw_string(struct _gfx_surface* surface, int32_t x, int32_t y,
+		const struct _gfx_font* font, const char* str, uint32_t color);
+
+/**
+ * \brief Draw a string over a filled background, '\n' starts a new line.
+ */
+extern void gfx_draw_string_with_bgcolor(struct _gfx_surface* surface,
+		int32_t x, int32_t y, const struct _gfx_font* font, const char* str,
+		uint32_t color, uint32_t bgcolor);
+
+/**
+ * \brief Set up a double buffered LCDC layer and show the first buffer.
+ * \param display display with layer and position set
+ * \param buf0 first frame buffer
+ * \param buf1 second frame buffer
+ * \param width layer width
+ * \param height layer height
+ * \param bpp bits per pixel, 16, 24 or 32
+ * \return surface to draw the next frame on, NULL on error
+ */
+extern struct _gfx_surface* gfx_display_init(struct _gfx_display* display,
+		void* buf0, void* buf1, uint16_t width, uint16_t height, uint8_t bpp);
+
+/**
+ * \brief Show the frame drawn on the back surface at next start of frame.
+ *
+ * Cleans the dirty areas, queues the buffer on the layer and waits until
+ * the LCDC has loaded it. The areas that changed are then copied to the
+ * previous buffer, which becomes the new back surface.
+ *
+ * \param display display
+ * \return surface to draw the next frame on
+ */
+extern struct _gfx_surface* gfx_display_swap(struct _gfx_display* display);
+
+#endif /* _GFX_H */
@@ -0,0 +1,103 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "display/lcdc.h"
+#include "mm/cache.h"
+
+#include "gfx.h"
+#include "gfx_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+static void _show(struct _gfx_display* display, struct _gfx_surface* surface)
+{
+	if (display->layer == LCDC_BASE)
+		lcdc_show_base(surface->buffer, surface->bpp, false);
+	else
+		lcdc_put_image(display->layer, surface->buffer, surface->bpp,
+				display->x, display->y,
+				surface->width, surface->height);
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+struct _gfx_surface* gfx_display_init(struct _gfx_display* display,
+		void* buf0, void* buf1, uint16_t width, uint16_t height, uint8_t bpp)
+{
+	struct _gfx_surface* front = &display->surface[0];
+
+	if (gfx_surface_init(&display->surface[0], buf0, width, height, bpp) < 0)
+		return NULL;
+	gfx_surface_init(&display->surface[1], buf1, width, height, bpp);
+
+	/* both buffers start with the same content */
+	memcpy(buf1, buf0, height * front->stride);
+	cache_clean_region(buf0, height * front->stride);
+	cache_clean_region(buf1, height * front->stride);
+
+	_show(display, front);
+	display->back = 1;
+	return &display->surface[1];
+}
+
+struct _gfx_surface* gfx_display_swap(struct _gfx_display* display)
+{
+	struct _gfx_surface* back = &display->surface[display->back];
+	struct _gfx_surface* front = &display->surface[display->back ^ 1];
+	struct _gfx_rect dirty[GFX_MAX_DIRTY];
+	uint8_t count = back->dirty_count;
+	uint8_t i;
+
+	memcpy(dirty, back->dirty, count * sizeof(dirty[0]));
+	gfx_clean_dirty(back);
+
+	/* the new buffer is used from next start of frame, the previous one
+	 * is free once the LCDC has loaded the new descriptor */
+	_show(display, back);
+	lcdc_wait_vsync(display->layer);
+
+	/* bring the previous buffer up to date with the changed areas only */
+	front->dirty_count = 0;
+	for (i = 0; i < count; i++)
+		gfx_copy_rect(front, back, &dirty[i]);
+
+	display->back ^= 1;
+	return front;
+}
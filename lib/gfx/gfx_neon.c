@@ -0,0 +1,134 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <arm_neon.h>
+#include <stdint.h>
+
+#include "gfx_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+/* Kernels process 8 or 16 pixels per iteration and leave the tail (and
+ * 16 bpp blending) to the C kernels, results are identical to gfx_c_ops. */
+
+static void _fill_span(uint8_t* dst, uint32_t count, uint32_t pixel,
+		uint8_t bpp)
+{
+	switch (bpp) {
+	case 16:
+	{
+		uint16x8_t v = vdupq_n_u16(pixel);
+		for (; count >= 16; count -= 16, dst += 32) {
+			vst1q_u16((uint16_t*)dst, v);
+			vst1q_u16((uint16_t*)dst + 8, v);
+		}
+		break;
+	}
+	case 24:
+	{
+		uint8x8x3_t v;
+		v.val[0] = vdup_n_u8(pixel);
+		v.val[1] = vdup_n_u8(pixel >> 8);
+		v.val[2] = vdup_n_u8(pixel >> 16);
+		for (; count >= 8; count -= 8, dst += 24)
+			vst3_u8(dst, v);
+		break;
+	}
+	case 32:
+	{
+		uint32x4_t v = vdupq_n_u32(pixel);
+		for (; count >= 8; count -= 8, dst += 32) {
+			vst1q_u32((uint32_t*)dst, v);
+			vst1q_u32((uint32_t*)dst + 4, v);
+		}
+		break;
+	}
+	}
+	gfx_c_ops.fill_span(dst, count, pixel, bpp);
+}
+
+/**
+ * \brief Blend 8 channel values, rounded division by 255
+ */
+static inline uint8x8_t _blend(uint8x8_t s, uint8x8_t d, uint8x8_t a,
+		uint8x8_t ia)
+{
+	uint16x8_t x = vmlal_u8(vmull_u8(s, a), d, ia);
+	x = vaddq_u16(x, vdupq_n_u16(128));
+	return vshrn_n_u16(vsraq_n_u16(x, x, 8), 8);
+}
+
+static void _blend_span(uint8_t* dst, const uint32_t* src, uint32_t count,
+		uint8_t bpp)
+{
+	switch (bpp) {
+	case 24:
+		for (; count >= 8; count -= 8, src += 8, dst += 24) {
+			/* B, G, R, A */
+			uint8x8x4_t s = vld4_u8((const uint8_t*)src);
+			uint8x8x3_t d = vld3_u8(dst);
+			uint8x8_t ia = vmvn_u8(s.val[3]);
+
+			d.val[0] = _blend(s.val[0], d.val[0], s.val[3], ia);
+			d.val[1] = _blend(s.val[1], d.val[1], s.val[3], ia);
+			d.val[2] = _blend(s.val[2], d.val[2], s.val[3], ia);
+			vst3_u8(dst, d);
+		}
+		break;
+	case 32:
+		for (; count >= 8; count -= 8, src += 8, dst += 32) {
+			uint8x8x4_t s = vld4_u8((const uint8_t*)src);
+			uint8x8x4_t d = vld4_u8(dst);
+			uint8x8_t ia = vmvn_u8(s.val[3]);
+
+			d.val[0] = _blend(s.val[0], d.val[0], s.val[3], ia);
+			d.val[1] = _blend(s.val[1], d.val[1], s.val[3], ia);
+			d.val[2] = _blend(s.val[2], d.val[2], s.val[3], ia);
+			d.val[3] = _blend(vdup_n_u8(0xff), d.val[3], s.val[3], ia);
+			vst4_u8(dst, d);
+		}
+		break;
+	}
+	gfx_c_ops.blend_span(dst, src, count, bpp);
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported variables
+ *------------------------------------------------------------------------------*/
+
+const struct _gfx_ops gfx_neon_ops = {
+	.fill_span = _fill_span,
+	.blend_span = _blend_span,
+};
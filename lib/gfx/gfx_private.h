@@ -0,0 +1,72 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef _GFX_PRIVATE_H
+#define _GFX_PRIVATE_H
+
+#include <stdint.h>
+
+#include "gfx.h"
+
+/*------------------------------------------------------------------------------
+ *      Types
+ *------------------------------------------------------------------------------*/
+
+struct _gfx_ops {
+	/** Fill count pixels with a pixel value in the surface format */
+	void (*fill_span)(uint8_t* dst, uint32_t count, uint32_t pixel,
+			uint8_t bpp);
+
+	/** Blend count ARGB 8888 pixels over the destination */
+	void (*blend_span)(uint8_t* dst, const uint32_t* src, uint32_t count,
+			uint8_t bpp);
+};
+
+/*------------------------------------------------------------------------------
+ *      Exported variables
+ *------------------------------------------------------------------------------*/
+
+extern const struct _gfx_ops gfx_c_ops;
+
+#ifdef CONFIG_HAVE_NEON
+extern const struct _gfx_ops gfx_neon_ops;
+#endif
+
+/*------------------------------------------------------------------------------
+ *      Exported functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Copy a rectangle between two surfaces with the same format, without
+ * clipping, and mark it dirty in the destination.
+ */
+extern void gfx_copy_rect(struct _gfx_surface* dst,
+		const struct _gfx_surface* src, const struct _gfx_rect* rect);
+
+#endif /* _GFX_PRIVATE_H */
@@ -0,0 +1,163 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+#include "gfx_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Blend a channel, rounded division by 255
+ */
+static inline uint8_t _blend(uint32_t s, uint32_t d, uint32_t a)
+{
+	uint32_t x = s * a + d * (255 - a) + 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+static void _fill_span(uint8_t* dst, uint32_t count, uint32_t pixel,
+		uint8_t bpp)
+{
+	uint32_t* w;
+	uint32_t w0, w1, w2;
+
+	switch (bpp) {
+	case 16:
+		if (count && ((uint32_t)dst & 2)) {
+			*(uint16_t*)dst = pixel;
+			dst += 2;
+			count--;
+		}
+		w0 = pixel | (pixel << 16);
+		for (w = (uint32_t*)dst; count >= 8; count -= 8, w += 4) {
+			w[0] = w0;
+			w[1] = w0;
+			w[2] = w0;
+			w[3] = w0;
+		}
+		for (; count >= 2; count -= 2)
+			*w++ = w0;
+		if (count)
+			*(uint16_t*)w = pixel;
+		break;
+
+	case 24:
+		/* align on a word, then store 4 pixels as 3 words */
+		for (; count && ((uint32_t)dst & 3); count--, dst += 3) {
+			dst[0] = pixel;
+			dst[1] = pixel >> 8;
+			dst[2] = pixel >> 16;
+		}
+		w0 = (pixel & 0xffffff) | (pixel << 24);
+		w1 = ((pixel >> 8) & 0xffff) | (pixel << 16);
+		w2 = ((pixel >> 16) & 0xff) | (pixel << 8);
+		for (w = (uint32_t*)dst; count >= 4; count -= 4, w += 3) {
+			w[0] = w0;
+			w[1] = w1;
+			w[2] = w2;
+		}
+		for (dst = (uint8_t*)w; count; count--, dst += 3) {
+			dst[0] = pixel;
+			dst[1] = pixel >> 8;
+			dst[2] = pixel >> 16;
+		}
+		break;
+
+	case 32:
+		for (w = (uint32_t*)dst; count >= 4; count -= 4, w += 4) {
+			w[0] = pixel;
+			w[1] = pixel;
+			w[2] = pixel;
+			w[3] = pixel;
+		}
+		for (; count; count--)
+			*w++ = pixel;
+		break;
+	}
+}
+
+static void _blend_span(uint8_t* dst, const uint32_t* src, uint32_t count,
+		uint8_t bpp)
+{
+	uint32_t i, s, a, d, r, g, b;
+
+	for (i = 0; i < count; i++) {
+		s = src[i];
+		a = s >> 24;
+
+		switch (bpp) {
+		case 16:
+			d = *(uint16_t*)dst;
+			if (a) {
+				r = (d >> 11) & 0x1f;
+				g = (d >> 5) & 0x3f;
+				b = d & 0x1f;
+				r = _blend((s >> 16) & 0xff, (r << 3) | (r >> 2), a);
+				g = _blend((s >> 8) & 0xff, (g << 2) | (g >> 4), a);
+				b = _blend(s & 0xff, (b << 3) | (b >> 2), a);
+				*(uint16_t*)dst = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+			}
+			dst += 2;
+			break;
+		case 24:
+			if (a) {
+				dst[0] = _blend(s & 0xff, dst[0], a);
+				dst[1] = _blend((s >> 8) & 0xff, dst[1], a);
+				dst[2] = _blend((s >> 16) & 0xff, dst[2], a);
+			}
+			dst += 3;
+			break;
+		case 32:
+			if (a) {
+				dst[0] = _blend(s & 0xff, dst[0], a);
+				dst[1] = _blend((s >> 8) & 0xff, dst[1], a);
+				dst[2] = _blend((s >> 16) & 0xff, dst[2], a);
+				dst[3] = _blend(0xff, dst[3], a);
+			}
+			dst += 4;
+			break;
+		}
+	}
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported variables
+ *------------------------------------------------------------------------------*/
+
+const struct _gfx_ops gfx_c_ops = {
+	.fill_span = _fill_span,
+	.blend_span = _blend_span,
+};
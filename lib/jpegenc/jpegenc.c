@@ -0,0 +1,557 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "errno.h"
+#include "intmath.h"
+
+#include "jpegenc.h"
+#include "jpegenc_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local definitions
+ *------------------------------------------------------------------------------*/
+
+/* AAN DCT constants, 8 fractional bits */
+#define FIX_0_382683433  98
+#define FIX_0_541196100  139
+#define FIX_0_707106781  181
+#define FIX_1_306562965  334
+
+#define MULTIPLY(v, c) (((int32_t)(v) * (c)) >> 8)
+
+/*------------------------------------------------------------------------------
+ *         Local types
+ *------------------------------------------------------------------------------*/
+
+struct _huffman_table {
+	uint16_t code[256];
+	uint8_t size[256];
+};
+
+struct _bit_writer {
+	uint8_t* buf;
+	uint8_t* end;
+	uint32_t acc;
+	uint32_t count;
+	bool overflow;
+};
+
+/*------------------------------------------------------------------------------
+ *         Local constants
+ *------------------------------------------------------------------------------*/
+
+static const uint8_t _zigzag[64] = {
+	 0,  1,  8, 16,  9,  2,  3, 10,
+	17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34,
+	27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36,
+	29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46,
+	53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+/** T.81 Annex K quantization tables, natural order */
+static const uint8_t _base_qtable[2][64] = {
+	{
+		16,  11,  10,  16,  24,  40,  51,  61,
+		12,  12,  14,  19,  26,  58,  60,  55,
+		14,  13,  16,  24,  40,  57,  69,  56,
+		14,  17,  22,  29,  51,  87,  80,  62,
+		18,  22,  37,  56,  68, 109, 103,  77,
+		24,  35,  55,  64,  81, 104, 113,  92,
+		49,  64,  78,  87, 103, 121, 120, 101,
+		72,  92,  95,  98, 112, 100, 103,  99,
+	},
+	{
+		17,  18,  24,  47,  99,  99,  99,  99,
+		18,  21,  26,  66,  99,  99,  99,  99,
+		24,  26,  56,  99,  99,  99,  99,  99,
+		47,  66,  99,  99,  99,  99,  99,  99,
+		99,  99,  99,  99,  99,  99,  99,  99,
+		99,  99,  99,  99,  99,  99,  99,  99,
+		99,  99,  99,  99,  99,  99,  99,  99,
+		99,  99,  99,  99,  99,  99,  99,  99,
+	},
+};
+
+/** AAN scale factors, 14 fractional bits */
+static const uint16_t _aan_scale[8] = {
+	16384, 22725, 21407, 19266, 16384, 12873, 8867, 4520,
+};
+
+/* T.81 Annex K Huffman tables: code counts per length, then symbols */
+static const uint8_t _dc_lum_bits[16] = {
+	0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const uint8_t _dc_chrom_bits[16] = {
+	0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+};
+
+static const uint8_t _dc_vals[12] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+};
+
+static const uint8_t _ac_lum_bits[16] = {
+	0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d,
+};
+
+static const uint8_t _ac_lum_vals[162] = {
+	0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12,
+	0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+	0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08,
+	0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+	0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16,
+	0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+	0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+	0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+	0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+	0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+	0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+	0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98,
+	0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+	0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6,
+	0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+	0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4,
+	0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+	0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea,
+	0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+	0xf9, 0xfa,
+};
+
+static const uint8_t _ac_chrom_bits[16] = {
+	0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77,
+};
+
+static const uint8_t _ac_chrom_vals[162] = {
+	0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21,
+	0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+	0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91,
+	0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+	0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34,
+	0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+	0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38,
+	0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+	0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+	0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+	0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
+	0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+	0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96,
+	0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+	0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4,
+	0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+	0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2,
+	0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+	0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9,
+	0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+	0xf9, 0xfa,
+};
+
+/*------------------------------------------------------------------------------
+ *         Local variables
+ *------------------------------------------------------------------------------*/
+
+#ifdef CONFIG_HAVE_NEON
+static const struct _jpegenc_ops* _ops = &jpegenc_neon_ops;
+#else
+static const struct _jpegenc_ops* _ops = &jpegenc_c_ops;
+#endif
+
+static struct _huffman_table _dc_huff[2];
+static struct _huffman_table _ac_huff[2];
+static bool _huff_ready;
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+static void _fetch_mcu(const uint8_t* src, uint32_t stride,
+		int16_t blocks[4][64])
+{
+	uint32_t r, c;
+
+	for (r = 0; r < 8; r++, src += stride) {
+		for (c = 0; c < 8; c++) {
+			blocks[0][r * 8 + c] = (int16_t)src[2 * c] - 128;
+			blocks[1][r * 8 + c] = (int16_t)src[16 + 2 * c] - 128;
+			blocks[2][r * 8 + c] = (int16_t)src[4 * c + 1] - 128;
+			blocks[3][r * 8 + c] = (int16_t)src[4 * c + 3] - 128;
+		}
+	}
+}
+
+/**
+ * \brief One-dimensional AAN forward DCT of 8 samples spaced by step
+ */
+static void _fdct_1d(int16_t* d, uint32_t step)
+{
+	int32_t tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+	int32_t tmp10, tmp11, tmp12, tmp13;
+	int32_t z1, z2, z3, z4, z5, z11, z13;
+
+	tmp0 = d[0 * step] + d[7 * step];
+	tmp7 = d[0 * step] - d[7 * step];
+	tmp1 = d[1 * step] + d[6 * step];
+	tmp6 = d[1 * step] - d[6 * step];
+	tmp2 = d[2 * step] + d[5 * step];
+	tmp5 = d[2 * step] - d[5 * step];
+	tmp3 = d[3 * step] + d[4 * step];
+	tmp4 = d[3 * step] - d[4 * step];
+
+	/* even part */
+	tmp10 = tmp0 + tmp3;
+	tmp13 = tmp0 - tmp3;
+	tmp11 = tmp1 + tmp2;
+	tmp12 = tmp1 - tmp2;
+
+	d[0 * step] = tmp10 + tmp11;
+	d[4 * step] = tmp10 - tmp11;
+
+	z1 = MULTIPLY(tmp12 + tmp13, FIX_0_707106781);
+	d[2 * step] = tmp13 + z1;
+	d[6 * step] = tmp13 - z1;
+
+	/* odd part */
+	tmp10 = tmp4 + tmp5;
+	tmp11 = tmp5 + tmp6;
+	tmp12 = tmp6 + tmp7;
+
+	z5 = MULTIPLY(tmp10 - tmp12, FIX_0_382683433);
+	z2 = MULTIPLY(tmp10, FIX_0_541196100) + z5;
+	z4 = MULTIPLY(tmp12, FIX_1_306562965) + z5;
+	z3 = MULTIPLY(tmp11, FIX_0_707106781);
+
+	z11 = tmp7 + z3;
+	z13 = tmp7 - z3;
+
+	d[5 * step] = z13 + z2;
+	d[3 * step] = z13 - z2;
+	d[1 * step] = z11 + z4;
+	d[7 * step] = z11 - z4;
+}
+
+static void _fdct_quant(int16_t* block, const uint16_t* recip)
+{
+	uint32_t i, q;
+
+	for (i = 0; i < 8; i++)
+		_fdct_1d(block + 8 * i, 1);
+	for (i = 0; i < 8; i++)
+		_fdct_1d(block + i, 8);
+
+	for (i = 0; i < 64; i++) {
+		if (block[i] < 0) {
+			q = ((uint32_t)(-block[i]) * recip[i] + 0x8000) >> 16;
+			block[i] = -(int16_t)q;
+		} else {
+			q = ((uint32_t)block[i] * recip[i] + 0x8000) >> 16;
+			block[i] = (int16_t)q;
+		}
+	}
+}
+
+static void _build_huffman(struct _huffman_table* table, const uint8_t* bits,
+		const uint8_t* vals)
+{
+	uint32_t len, i, k = 0;
+	uint16_t code = 0;
+
+	memset(table, 0, sizeof(*table));
+	for (len = 1; len <= 16; len++) {
+		for (i = 0; i < bits[len - 1]; i++, k++) {
+			table->code[vals[k]] = code++;
+			table->size[vals[k]] = len;
+		}
+		code <<= 1;
+	}
+}
+
+static void _put_byte(struct _bit_writer* bw, uint8_t byte)
+{
+	if (bw->buf < bw->end)
+		*bw->buf++ = byte;
+	else
+		bw->overflow = true;
+}
+
+static inline void _put_bits(struct _bit_writer* bw, uint32_t bits,
+		uint32_t size)
+{
+	uint8_t byte;
+
+	bw->acc = (bw->acc << size) | (bits & ((1u << size) - 1));
+	bw->count += size;
+	while (bw->count >= 8) {
+		bw->count -= 8;
+		byte = bw->acc >> bw->count;
+		_put_byte(bw, byte);
+		if (byte == 0xff)
+			_put_byte(bw, 0);
+	}
+}
+
+static void _flush_bits(struct _bit_writer* bw)
+{
+	/* pad with ones up to a byte boundary */
+	if (bw->count)
+		_put_bits(bw, 0x7f, 8 - bw->count);
+}
+
+static void _put_marker(struct _bit_writer* bw, uint8_t marker, uint16_t length)
+{
+	_put_byte(bw, 0xff);
+	_put_byte(bw, marker);
+	if (length) {
+		_put_byte(bw, length >> 8);
+		_put_byte(bw, length & 0xff);
+	}
+}
+
+static void _put_huffman(struct _bit_writer* bw, uint8_t id,
+		const uint8_t* bits, const uint8_t* vals, uint32_t count)
+{
+	uint32_t i;
+
+	_put_byte(bw, id);
+	for (i = 0; i < 16; i++)
+		_put_byte(bw, bits[i]);
+	for (i = 0; i < count; i++)
+		_put_byte(bw, vals[i]);
+}
+
+static void _write_headers(const struct _jpegenc_desc* desc,
+		struct _bit_writer* bw)
+{
+	static const uint8_t jfif[] = {
+		'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0,
+	};
+	uint32_t i, t;
+
+	_put_marker(bw, 0xd8, 0); /* SOI */
+
+	_put_marker(bw, 0xe0, 2 + sizeof(jfif)); /* APP0 */
+	for (i = 0; i < sizeof(jfif); i++)
+		_put_byte(bw, jfif[i]);
+
+	_put_marker(bw, 0xdb, 2 + 2 * 65); /* DQT */
+	for (t = 0; t < 2; t++) {
+		_put_byte(bw, t);
+		for (i = 0; i < 64; i++)
+			_put_byte(bw, desc->qtable[t][i]);
+	}
+
+	_put_marker(bw, 0xc0, 17); /* SOF0 */
+	_put_byte(bw, 8);
+	_put_byte(bw, desc->height >> 8);
+	_put_byte(bw, desc->height & 0xff);
+	_put_byte(bw, desc->width >> 8);
+	_put_byte(bw, desc->width & 0xff);
+	_put_byte(bw, 3);
+	_put_byte(bw, 1);    /* Y: 2x1 sampling, table 0 */
+	_put_byte(bw, 0x21);
+	_put_byte(bw, 0);
+	_put_byte(bw, 2);    /* Cb: 1x1 sampling, table 1 */
+	_put_byte(bw, 0x11);
+	_put_byte(bw, 1);
+	_put_byte(bw, 3);    /* Cr: 1x1 sampling, table 1 */
+	_put_byte(bw, 0x11);
+	_put_byte(bw, 1);
+
+	_put_marker(bw, 0xc4, 2 + 4 * 17 + 2 * 12 + 2 * 162); /* DHT */
+	_put_huffman(bw, 0x00, _dc_lum_bits, _dc_vals, 12);
+	_put_huffman(bw, 0x10, _ac_lum_bits, _ac_lum_vals, 162);
+	_put_huffman(bw, 0x01, _dc_chrom_bits, _dc_vals, 12);
+	_put_huffman(bw, 0x11, _ac_chrom_bits, _ac_chrom_vals, 162);
+
+	_put_marker(bw, 0xda, 12); /* SOS */
+	_put_byte(bw, 3);
+	_put_byte(bw, 1);
+	_put_byte(bw, 0x00);
+	_put_byte(bw, 2);
+	_put_byte(bw, 0x11);
+	_put_byte(bw, 3);
+	_put_byte(bw, 0x11);
+	_put_byte(bw, 0);
+	_put_byte(bw, 63);
+	_put_byte(bw, 0);
+}
+
+/**
+ * \brief Huffman encode a quantized block, natural order
+ */
+static void _encode_block(struct _bit_writer* bw, const int16_t* block,
+		int16_t* last_dc, const struct _huffman_table* dc,
+		const struct _huffman_table* ac)
+{
+	int32_t v, bits;
+	uint32_t k, nbits, run = 0;
+
+	v = block[0] - *last_dc;
+	*last_dc = block[0];
+	bits = v < 0 ? v - 1 : v;
+	nbits = v ? fls(v < 0 ? -v : v) : 0;
+	_put_bits(bw, dc->code[nbits], dc->size[nbits]);
+	if (nbits)
+		_put_bits(bw, bits, nbits);
+
+	for (k = 1; k < 64; k++) {
+		v = block[_zigzag[k]];
+		if (!v) {
+			run++;
+			continue;
+		}
+		while (run > 15) {
+			_put_bits(bw, ac->code[0xf0], ac->size[0xf0]);
+			run -= 16;
+		}
+		bits = v < 0 ? v - 1 : v;
+		nbits = fls(v < 0 ? -v : v);
+		_put_bits(bw, ac->code[(run << 4) | nbits],
+				ac->size[(run << 4) | nbits]);
+		_put_bits(bw, bits, nbits);
+		run = 0;
+	}
+	if (run)
+		_put_bits(bw, ac->code[0x00], ac->size[0x00]);
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported variables
+ *------------------------------------------------------------------------------*/
+
+const struct _jpegenc_ops jpegenc_c_ops = {
+	.fetch_mcu = _fetch_mcu,
+	.fdct_quant = _fdct_quant,
+};
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+int jpegenc_configure(struct _jpegenc_desc* desc)
+{
+	uint32_t t, k, i, q, scale, div;
+
+	if (!desc->width || !desc->height || desc->width > 0xffff ||
+	    desc->height > 0xffff || (desc->width & 15) || (desc->height & 7))
+		return -EINVAL;
+
+	if (!_huff_ready) {
+		_build_huffman(&_dc_huff[0], _dc_lum_bits, _dc_vals);
+		_build_huffman(&_ac_huff[0], _ac_lum_bits, _ac_lum_vals);
+		_build_huffman(&_dc_huff[1], _dc_chrom_bits, _dc_vals);
+		_build_huffman(&_ac_huff[1], _ac_chrom_bits, _ac_chrom_vals);
+		_huff_ready = true;
+	}
+
+	q = desc->quality;
+	if (q < 1)
+		q = 1;
+	if (q > 100)
+		q = 100;
+	scale = q < 50 ? 5000 / q : 200 - 2 * q;
+
+	for (t = 0; t < 2; t++) {
+		for (k = 0; k < 64; k++) {
+			i = _zigzag[k];
+			q = (_base_qtable[t][i] * scale + 50) / 100;
+			if (q < 1)
+				q = 1;
+			if (q > 255)
+				q = 255;
+			desc->qtable[t][k] = q;
+
+			/* fold AAN output scaling (x8 and per-frequency
+			 * factors) into the divisor */
+			div = (_aan_scale[i >> 3] * _aan_scale[i & 7] + 8192) >> 14;
+			div = (q * div + 1024) >> 11;
+			if (div < 2)
+				div = 2;
+			desc->recip[t][i] = (0x10000 + div / 2) / div;
+		}
+	}
+	return 0;
+}
+
+bool jpegenc_use_neon(bool enable)
+{
+#ifdef CONFIG_HAVE_NEON
+	_ops = enable ? &jpegenc_neon_ops : &jpegenc_c_ops;
+	return enable;
+#else
+	(void)enable;
+	return false;
+#endif
+}
+
+int jpegenc_encode(const struct _jpegenc_desc* desc, const uint8_t* src,
+		uint32_t stride, uint8_t* buf, uint32_t size)
+{
+	struct _bit_writer bw = {
+		.buf = buf,
+		.end = buf + size,
+	};
+	int16_t blocks[4][64];
+	int16_t dc[3] = { 0, 0, 0 };
+	uint32_t mx, my, i;
+
+	_write_headers(desc, &bw);
+
+	for (my = 0; my < desc->height / 8; my++) {
+		for (mx = 0; mx < desc->width / 16; mx++) {
+			_ops->fetch_mcu(src + my * 8 * stride + mx * 32, stride,
+					blocks);
+			for (i = 0; i < 4; i++)
+				_ops->fdct_quant(blocks[i],
+						desc->recip[i < 2 ? 0 : 1]);
+			_encode_block(&bw, blocks[0], &dc[0], &_dc_huff[0], &_ac_huff[0]);
+			_encode_block(&bw, blocks[1], &dc[0], &_dc_huff[0], &_ac_huff[0]);
+			_encode_block(&bw, blocks[2], &dc[1], &_dc_huff[1], &_ac_huff[1]);
+			_encode_block(&bw, blocks[3], &dc[2], &_dc_huff[1], &_ac_huff[1]);
+			if (bw.overflow)
+				return -ENOSPC;
+		}
+	}
+
+	_flush_bits(&bw);
+	_put_marker(&bw, 0xd9, 0); /* EOI */
+	if (bw.overflow)
+		return -ENOSPC;
+	return bw.buf - buf;
+}
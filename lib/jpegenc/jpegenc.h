@@ -0,0 +1,100 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Baseline JPEG encoder for packed YUV 4:2:2 (YUYV) frames.
+ *
+ * Frames are encoded as 4:2:2 baseline JPEG with the quantization tables of
+ * ITU-T T.81 Annex K scaled by a quality factor and the Annex K Huffman
+ * tables. The output is a complete JFIF image (SOI to EOI) suitable for
+ * MJPEG streaming.
+ *
+ * The forward DCT is the integer AAN algorithm, with a NEON version when
+ * the library is built with CONFIG_HAVE_NEON. Both versions give identical
+ * output, jpegenc_use_neon(false) selects the portable C code.
+ */
+
+#ifndef _JPEGENC_H
+#define _JPEGENC_H
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+struct _jpegenc_desc {
+	uint32_t width;         /**< frame width, multiple of 16 */
+	uint32_t height;        /**< frame height, multiple of 8 */
+	uint8_t quality;        /**< quality, 1 (lowest) to 100 */
+
+	/* --- following fields are used internally --- */
+	uint8_t qtable[2][64];  /**< quantization tables, zigzag order */
+	uint16_t recip[2][64];  /**< quantization reciprocals with DCT scaling */
+};
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Compute the quantization tables of an encoder.
+ * \param desc encoder with width, height and quality set
+ * \return 0 on success, -EINVAL if the frame size is not supported
+ */
+extern int jpegenc_configure(struct _jpegenc_desc* desc);
+
+/**
+ * \brief Select NEON or portable C kernels. NEON kernels are used by
+ * default when available.
+ * \param enable true to use NEON kernels
+ * \return true if NEON kernels are in use
+ */
+extern bool jpegenc_use_neon(bool enable);
+
+/**
+ * \brief Encode a YUYV frame.
+ * \param desc configured encoder
+ * \param src frame, Y0 U Y1 V byte order
+ * \param stride line stride of the frame, in bytes
+ * \param buf output buffer
+ * \param size size of the output buffer
+ * \return size of the JPEG image, -ENOSPC if the output buffer is too small
+ */
+extern int jpegenc_encode(const struct _jpegenc_desc* desc, const uint8_t* src,
+		uint32_t stride, uint8_t* buf, uint32_t size);
+
+#endif /* _JPEGENC_H */
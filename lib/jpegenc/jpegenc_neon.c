@@ -0,0 +1,198 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <arm_neon.h>
+#include <stdint.h>
+
+#include "jpegenc_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local definitions
+ *------------------------------------------------------------------------------*/
+
+/* Same 8-bit fixed point constants as the C version */
+#define FIX_0_382683433  98
+#define FIX_0_541196100  139
+#define FIX_0_707106781  181
+#define FIX_1_306562965  334
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+/* Kernels give results identical to jpegenc_c_ops. */
+
+static void _fetch_mcu(const uint8_t* src, uint32_t stride,
+		int16_t blocks[4][64])
+{
+	const uint8x8_t bias = vdup_n_u8(128);
+	uint32_t r;
+
+	for (r = 0; r < 8; r++, src += stride) {
+		/* Y even, U, Y odd, V */
+		uint8x8x4_t p = vld4_u8(src);
+		uint8x8x2_t y = vzip_u8(p.val[0], p.val[2]);
+
+		vst1q_s16(&blocks[0][r * 8],
+			vreinterpretq_s16_u16(vsubl_u8(y.val[0], bias)));
+		vst1q_s16(&blocks[1][r * 8],
+			vreinterpretq_s16_u16(vsubl_u8(y.val[1], bias)));
+		vst1q_s16(&blocks[2][r * 8],
+			vreinterpretq_s16_u16(vsubl_u8(p.val[1], bias)));
+		vst1q_s16(&blocks[3][r * 8],
+			vreinterpretq_s16_u16(vsubl_u8(p.val[3], bias)));
+	}
+}
+
+static inline int16x8_t _multiply(int16x8_t v, int16_t c)
+{
+	return vcombine_s16(vshrn_n_s32(vmull_n_s16(vget_low_s16(v), c), 8),
+			vshrn_n_s32(vmull_n_s16(vget_high_s16(v), c), 8));
+}
+
+static inline void _transpose(int16x8_t v[8])
+{
+	int16x8x2_t t01 = vtrnq_s16(v[0], v[1]);
+	int16x8x2_t t23 = vtrnq_s16(v[2], v[3]);
+	int16x8x2_t t45 = vtrnq_s16(v[4], v[5]);
+	int16x8x2_t t67 = vtrnq_s16(v[6], v[7]);
+	int32x4x2_t u0 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[0]),
+			vreinterpretq_s32_s16(t23.val[0]));
+	int32x4x2_t u1 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[1]),
+			vreinterpretq_s32_s16(t23.val[1]));
+	int32x4x2_t u2 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[0]),
+			vreinterpretq_s32_s16(t67.val[0]));
+	int32x4x2_t u3 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[1]),
+			vreinterpretq_s32_s16(t67.val[1]));
+
+	v[0] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u0.val[0]),
+			vget_low_s32(u2.val[0])));
+	v[1] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u1.val[0]),
+			vget_low_s32(u3.val[0])));
+	v[2] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u0.val[1]),
+			vget_low_s32(u2.val[1])));
+	v[3] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(u1.val[1]),
+			vget_low_s32(u3.val[1])));
+	v[4] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u0.val[0]),
+			vget_high_s32(u2.val[0])));
+	v[5] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u1.val[0]),
+			vget_high_s32(u3.val[0])));
+	v[6] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u0.val[1]),
+			vget_high_s32(u2.val[1])));
+	v[7] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(u1.val[1]),
+			vget_high_s32(u3.val[1])));
+}
+
+/**
+ * \brief AAN forward DCT across the 8 vectors, 8 transforms at once
+ */
+static inline void _fdct_pass(int16x8_t v[8])
+{
+	int16x8_t tmp0 = vaddq_s16(v[0], v[7]);
+	int16x8_t tmp7 = vsubq_s16(v[0], v[7]);
+	int16x8_t tmp1 = vaddq_s16(v[1], v[6]);
+	int16x8_t tmp6 = vsubq_s16(v[1], v[6]);
+	int16x8_t tmp2 = vaddq_s16(v[2], v[5]);
+	int16x8_t tmp5 = vsubq_s16(v[2], v[5]);
+	int16x8_t tmp3 = vaddq_s16(v[3], v[4]);
+	int16x8_t tmp4 = vsubq_s16(v[3], v[4]);
+	int16x8_t tmp10, tmp11, tmp12, tmp13;
+	int16x8_t z1, z2, z3, z4, z5, z11, z13;
+
+	/* even part */
+	tmp10 = vaddq_s16(tmp0, tmp3);
+	tmp13 = vsubq_s16(tmp0, tmp3);
+	tmp11 = vaddq_s16(tmp1, tmp2);
+	tmp12 = vsubq_s16(tmp1, tmp2);
+
+	v[0] = vaddq_s16(tmp10, tmp11);
+	v[4] = vsubq_s16(tmp10, tmp11);
+
+	z1 = _multiply(vaddq_s16(tmp12, tmp13), FIX_0_707106781);
+	v[2] = vaddq_s16(tmp13, z1);
+	v[6] = vsubq_s16(tmp13, z1);
+
+	/* odd part */
+	tmp10 = vaddq_s16(tmp4, tmp5);
+	tmp11 = vaddq_s16(tmp5, tmp6);
+	tmp12 = vaddq_s16(tmp6, tmp7);
+
+	z5 = _multiply(vsubq_s16(tmp10, tmp12), FIX_0_382683433);
+	z2 = vaddq_s16(_multiply(tmp10, FIX_0_541196100), z5);
+	z4 = vaddq_s16(_multiply(tmp12, FIX_1_306562965), z5);
+	z3 = _multiply(tmp11, FIX_0_707106781);
+
+	z11 = vaddq_s16(tmp7, z3);
+	z13 = vsubq_s16(tmp7, z3);
+
+	v[5] = vaddq_s16(z13, z2);
+	v[3] = vsubq_s16(z13, z2);
+	v[1] = vaddq_s16(z11, z4);
+	v[7] = vsubq_s16(z11, z4);
+}
+
+static void _fdct_quant(int16_t* block, const uint16_t* recip)
+{
+	const int16x8_t zero = vdupq_n_s16(0);
+	int16x8_t v[8];
+	uint32_t i;
+
+	for (i = 0; i < 8; i++)
+		v[i] = vld1q_s16(block + 8 * i);
+
+	/* rows, then columns, like the C version */
+	_transpose(v);
+	_fdct_pass(v);
+	_transpose(v);
+	_fdct_pass(v);
+
+	for (i = 0; i < 8; i++) {
+		uint16x8_t a = vreinterpretq_u16_s16(vabsq_s16(v[i]));
+		uint16x8_t r = vld1q_u16(recip + 8 * i);
+		int16x8_t q = vreinterpretq_s16_u16(vcombine_u16(
+			vrshrn_n_u32(vmull_u16(vget_low_u16(a), vget_low_u16(r)), 16),
+			vrshrn_n_u32(vmull_u16(vget_high_u16(a), vget_high_u16(r)), 16)));
+
+		vst1q_s16(block + 8 * i,
+			vbslq_s16(vcltq_s16(v[i], zero), vnegq_s16(q), q));
+	}
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported variables
+ *------------------------------------------------------------------------------*/
+
+const struct _jpegenc_ops jpegenc_neon_ops = {
+	.fetch_mcu = _fetch_mcu,
+	.fdct_quant = _fdct_quant,
+};
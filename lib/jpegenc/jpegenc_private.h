@@ -0,0 +1,59 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef _JPEGENC_PRIVATE_H
+#define _JPEGENC_PRIVATE_H
+
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ *      Types
+ *------------------------------------------------------------------------------*/
+
+struct _jpegenc_ops {
+	/** Load a 16x8 MCU of a YUYV frame into level shifted Y0, Y1, Cb
+	 * and Cr blocks */
+	void (*fetch_mcu)(const uint8_t* src, uint32_t stride,
+			int16_t blocks[4][64]);
+
+	/** Forward DCT and quantization of a block, in place, natural order */
+	void (*fdct_quant)(int16_t* block, const uint16_t* recip);
+};
+
+/*------------------------------------------------------------------------------
+ *      Exported variables
+ *------------------------------------------------------------------------------*/
+
+extern const struct _jpegenc_ops jpegenc_c_ops;
+
+#ifdef CONFIG_HAVE_NEON
+extern const struct _jpegenc_ops jpegenc_neon_ops;
+#endif
+
+#endif /* _JPEGENC_PRIVATE_H */
@@ -372,14 +372,36 @@ _SendCmd(sSdCard * pSd, fSdmmcCallback fCallback, void *pCbArg)
 	uint32_t err, drv_is_busy;
 	uint8_t bRc;
 	bool elapsed = false;
+	const bool suspend = fCallback == NULL && pSd->fWait != NULL;
 
 	if (pCmd->bCmd != 55)
 		trace_debug("Cmd%u(%lx)\n\r", pCmd->bCmd, pCmd->dwArg);
-	pCmd->fCallback = fCallback;
-	pCmd->pArg = pCbArg;
+	if (suspend) {
+		/* Discard the completion of a previous command that ended
+		 * before the caller had to wait for it */
+		pSd->fWait(pSd->pWaitArg, 0);
+		pCmd->fCallback = pSd->fWake;
+		pCmd->pArg = pSd->pWaitArg;
+	} else {
+		pCmd->fCallback = fCallback;
+		pCmd->pArg = pCbArg;
+	}
 	bRc = pHal->fCommand(pSd->pDrv, pCmd);
 
-	if (fCallback == NULL) {
+	if (suspend) {
+		/* Suspend the caller until the driver invokes the end-of-command
+		 * callback, with the same 30s backup timeout as when polling */
+		drv_is_busy = 1;
+		err = pHal->fIOCtrl(pDrv, SDMMC_IOCTL_BUSY_CHECK,
+		    (uint32_t)&drv_is_busy);
+		if (err != SDMMC_OK)
+			pCmd->bStatus = (uint8_t)err;
+		else if (drv_is_busy && !pSd->fWait(pSd->pWaitArg, 30000)) {
+			pHal->fIOCtrl(pDrv, SDMMC_IOCTL_CANCEL_CMD, 0);
+			pCmd->bStatus = SDMMC_NO_RESPONSE;
+		}
+		bRc = pCmd->bStatus;
+	} else if (fCallback == NULL) {
 		/* Poll command status.
 		 * The driver is responsible for detecting and reporting
 		 * timeout conditions. Here we only start a backup timer, in
@@ -3334,10 +3356,35 @@ SDD_Initialize(sSdCard * pSd,
 	pSd->pHalf = (sSdHalFunctions *) pHalf;
 	pSd->pExt = NULL;
 	pSd->bSlot = bSlot;
+	pSd->fWait = NULL;
+	pSd->fWake = NULL;
+	pSd->pWaitArg = NULL;
 
 	_SdParamReset(pSd);
 }
 
+/**
+ * Install functions suspending the caller while SD/MMC commands are in
+ * progress, instead of polling the driver. The driver shall complete commands
+ * from its interrupt handler and invoke the end-of-command callback.
+ * \param pSd    Pointer to a SD card driver instance.
+ * \param fWait  Function suspending the caller until fWake is invoked or the
+ *               timeout elapses. NULL to restore polling.
+ * \param fWake  End-of-command callback, resuming the suspended caller.
+ * \param pArg   Argument to fWait and fWake.
+ */
+void
+SD_SetWaitHandler(sSdCard * pSd,
+		  fSdmmcWait fWait, fSdmmcCallback fWake, void *pArg)
+{
+	assert(pSd != NULL);
+	assert(fWait == NULL || fWake != NULL);
+
+	pSd->fWait = fWait;
+	pSd->fWake = fWake;
+	pSd->pWaitArg = pArg;
+}
+
 /**
  * Run the SDcard initialization sequence. This function runs the
  * initialisation procedure and the identification process, then it sets the
@@ -630,6 +630,9 @@
 extern uint8_t SD_Init(sSdCard * pSd);
 void SD_DeInit(sSdCard * pSd);
 
+extern void SD_SetWaitHandler(sSdCard * pSd, fSdmmcWait fWait,
+			      fSdmmcCallback fWake, void *pArg);
+
 extern uint32_t SD_GetField(const uint8_t *reg,
 			    uint16_t reg_len,
 			    uint16_t field_start,
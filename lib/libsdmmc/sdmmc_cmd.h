@@ -61,6 +61,7 @@
  *      Includes
  *----------------------------------------------------------------------------*/
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "chip.h"
 
@@ -329,6 +330,11 @@ or not by mechanical write protect switch */
 /** SD/MMC end-of-command callback function. */
 typedef void (*fSdmmcCallback) (uint32_t status, void *pArg);
 
+/** Function suspending the caller until the end-of-command callback is
+ * invoked, or the timeout (in milliseconds) elapses. Returns true if the
+ * command completed. */
+typedef bool (*fSdmmcWait) (void *pArg, uint32_t timeout);
+
 /**
  * Sdmmc command operation settings union.
  */
@@ -444,6 +450,12 @@ typedef struct _SdCard {
 
 	sSdmmcCommand sdCmd;	/**< Command instance for underlying driver */
 
+	fSdmmcWait fWait;	/**< Optional function suspending the caller
+				 * while a command is in progress */
+	fSdmmcCallback fWake;	/**< End-of-command callback resuming the
+				 * caller suspended by fWait */
+	void *pWaitArg;		/**< Argument to fWait and fWake */
+
 	uint32_t dwTotalSize;	/**< Card total size
                                 (0xffffffff to see number of blocks */
 	uint32_t dwNbBlocks;	/**< Card total number of blocks */
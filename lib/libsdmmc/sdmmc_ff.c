@@ -43,6 +43,9 @@
 #include "libsdmmc.h"
 #include "ffconf.h"
 #include "fatfs/src/diskio.h"
+#if _USE_DISKCACHE
+#include "fatfs/softpack/diskcache.h"
+#endif
 
 #include <string.h>
 #include <stdio.h>
@@ -61,63 +64,18 @@
 extern bool SD_GetInstance(uint8_t index, sSdCard **holder);
 
 /*----------------------------------------------------------------------------
- *        Exported functions
+ *        Local functions
  *----------------------------------------------------------------------------*/
 
 /**
- * \brief Initialize a Drive.
- * \param slot  Physical drive number (0..).
- * \return Drive status flags; STA_NOINIT if the specified drive does not exist.
- */
-DSTATUS disk_initialize(BYTE slot)
-{
-	sSdCard *lib = NULL;
-	uint8_t rc;
-
-	if (!SD_GetInstance(slot, &lib))
-		return STA_NOINIT;
-	assert(lib);
-	rc = SD_GetStatus(lib);
-	if (rc == SDMMC_NOT_SUPPORTED)
-		return STA_NODISK | STA_NOINIT;
-	SD_DeInit(lib);
-	/* FIXME a delay with the bus held off may be required by the device */
-	rc = SD_Init(lib);
-	return rc == SDMMC_OK ? 0 : STA_NOINIT;
-}
-
-/**
- * \brief Get Drive Status.
- * \param slot  Physical drive number (0..).
- * \return Drive status flags; STA_NODISK if there is currently no device in
- * the specified slot.
- */
-DSTATUS disk_status(BYTE slot)
-{
-	sSdCard *lib = NULL;
-	uint8_t rc;
-
-	if (!SD_GetInstance(slot, &lib))
-		return STA_NODISK | STA_NOINIT;
-	assert(lib);
-	rc = SD_GetStatus(lib);
-	if (rc == SDMMC_NOT_SUPPORTED)
-		return STA_NODISK | STA_NOINIT;
-	else if (rc != SDMMC_OK)
-		return STA_NOINIT;
-	/* Well, no restriction on this drive */
-	return 0;
-}
-
-/**
- * \brief Read Sector(s).
+ * \brief Read Sector(s) from the device.
  * \param slot  Physical drive number (0..).
  * \param buff  Data buffer to store read data.
  * \param sector  Sector address in LBA.
  * \param count  Number of sectors to read.
  * \return Result code; RES_OK if successful.
  */
-DRESULT disk_read(BYTE slot, BYTE* buff, DWORD sector, UINT count)
+static DRESULT _sdmmc_disk_read(BYTE slot, BYTE* buff, DWORD sector, UINT count)
 {
 	sSdCard *lib = NULL;
 	DRESULT res;
@@ -157,7 +115,7 @@ DRESULT disk_read(BYTE slot, BYTE* buff, DWORD sector, UINT count)
 
 #if !_FS_READONLY
 /**
- * \brief Write Sector(s).
+ * \brief Write Sector(s) to the device.
  *
  * \param slot  Physical drive number (0..).
  * \param buff  Data to be written.
@@ -171,7 +129,7 @@ DRESULT disk_read(BYTE slot, BYTE* buff, DWORD sector, UINT count)
  * multiple single sector transfers to the media, or the data read/write
  * performance may be drastically decreased.
  */
-DRESULT disk_write(BYTE slot, const BYTE* buff, DWORD sector, UINT count)
+static DRESULT _sdmmc_disk_write(BYTE slot, const BYTE* buff, DWORD sector, UINT count)
 {
 	sSdCard *lib = NULL;
 	DRESULT res;
@@ -208,6 +166,112 @@ DRESULT disk_write(BYTE slot, const BYTE* buff, DWORD sector, UINT count)
 }
 #endif /* _FS_READONLY */
 
+#if _USE_DISKCACHE
+static const struct _diskcache_ops _sdmmc_diskcache_ops = {
+	.read = _sdmmc_disk_read,
+#if !_FS_READONLY
+	.write = _sdmmc_disk_write,
+#endif
+};
+#endif
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Initialize a Drive.
+ * \param slot  Physical drive number (0..).
+ * \return Drive status flags; STA_NOINIT if the specified drive does not exist.
+ */
+DSTATUS disk_initialize(BYTE slot)
+{
+	sSdCard *lib = NULL;
+	uint8_t rc;
+
+	if (!SD_GetInstance(slot, &lib))
+		return STA_NOINIT;
+	assert(lib);
+	rc = SD_GetStatus(lib);
+	if (rc == SDMMC_NOT_SUPPORTED)
+		return STA_NODISK | STA_NOINIT;
+	SD_DeInit(lib);
+	/* FIXME a delay with the bus held off may be required by the device */
+	rc = SD_Init(lib);
+	if (rc != SDMMC_OK)
+		return STA_NOINIT;
+#if _USE_DISKCACHE
+	{
+		DWORD sectors;
+
+		if (disk_ioctl(slot, GET_SECTOR_COUNT, &sectors) != RES_OK)
+			return STA_NOINIT;
+		diskcache_attach(slot, &_sdmmc_diskcache_ops, sectors);
+	}
+#endif
+	return 0;
+}
+
+/**
+ * \brief Get Drive Status.
+ * \param slot  Physical drive number (0..).
+ * \return Drive status flags; STA_NODISK if there is currently no device in
+ * the specified slot.
+ */
+DSTATUS disk_status(BYTE slot)
+{
+	sSdCard *lib = NULL;
+	uint8_t rc;
+
+	if (!SD_GetInstance(slot, &lib))
+		return STA_NODISK | STA_NOINIT;
+	assert(lib);
+	rc = SD_GetStatus(lib);
+	if (rc == SDMMC_NOT_SUPPORTED)
+		return STA_NODISK | STA_NOINIT;
+	else if (rc != SDMMC_OK)
+		return STA_NOINIT;
+	/* Well, no restriction on this drive */
+	return 0;
+}
+
+
+/**
+ * \brief Read Sector(s).
+ * \param slot  Physical drive number (0..).
+ * \param buff  Data buffer to store read data.
+ * \param sector  Sector address in LBA.
+ * \param count  Number of sectors to read.
+ * \return Result code; RES_OK if successful.
+ */
+DRESULT disk_read(BYTE slot, BYTE* buff, DWORD sector, UINT count)
+{
+#if _USE_DISKCACHE
+	return diskcache_read(slot, buff, sector, count);
+#else
+	return _sdmmc_disk_read(slot, buff, sector, count);
+#endif
+}
+
+#if !_FS_READONLY
+/**
+ * \brief Write Sector(s).
+ * \param slot  Physical drive number (0..).
+ * \param buff  Data to be written.
+ * \param sector  Sector address in LBA.
+ * \param count  Number of sectors to write.
+ * \return Result code; RES_OK if successful.
+ */
+DRESULT disk_write(BYTE slot, const BYTE* buff, DWORD sector, UINT count)
+{
+#if _USE_DISKCACHE
+	return diskcache_write(slot, buff, sector, count);
+#else
+	return _sdmmc_disk_write(slot, buff, sector, count);
+#endif
+}
+#endif /* _FS_READONLY */
+
 /**
  * \brief Miscellaneous Functions.
  * \param slot  Physical drive number (0..).
@@ -232,7 +296,11 @@ DRESULT disk_ioctl(BYTE slot, BYTE cmd, void* buff)
 		/* SD/MMC devices do not seem to cache data beyond completion
 		 * of the write commands. Note that if _FS_READONLY is enabled,
 		 * this command is not needed. */
+#if _USE_DISKCACHE
+		res = diskcache_sync(slot);
+#else
 		res = RES_OK;
+#endif
 		break;
 
 	case GET_SECTOR_COUNT:
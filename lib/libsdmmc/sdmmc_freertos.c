@@ -0,0 +1,117 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *        Headers
+ *----------------------------------------------------------------------------*/
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include "libsdmmc/sdmmc_api.h"
+#include "libsdmmc/sdmmc_freertos.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+/*----------------------------------------------------------------------------
+ *        Local definitions
+ *----------------------------------------------------------------------------*/
+
+/** Processor mode of the tasks, see portINITIAL_SPSR in the ports. Interrupt
+ * handlers run in IRQ or Supervisor mode. */
+#define CPSR_MODE_MASK 0x1f
+#define CPSR_MODE_SYS  0x1f
+
+/*----------------------------------------------------------------------------
+ *        Local functions
+ *----------------------------------------------------------------------------*/
+
+static bool _sdmmc_freertos_in_task(void)
+{
+	uint32_t cpsr;
+
+	asm volatile("mrs %0, cpsr" : "=r"(cpsr));
+	return (cpsr & CPSR_MODE_MASK) == CPSR_MODE_SYS;
+}
+
+static bool _sdmmc_freertos_wait(void *arg, uint32_t timeout)
+{
+	SemaphoreHandle_t sem = (SemaphoreHandle_t)arg;
+	TickType_t ticks = timeout ? (timeout + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS : 0;
+
+	return xSemaphoreTake(sem, ticks) == pdTRUE;
+}
+
+static void _sdmmc_freertos_wake(uint32_t status, void *arg)
+{
+	SemaphoreHandle_t sem = (SemaphoreHandle_t)arg;
+	BaseType_t woken = pdFALSE;
+
+	(void)status;
+	/* In polling mode, the command completes in the context of the task
+	 * which waits for it */
+	if (_sdmmc_freertos_in_task()) {
+		xSemaphoreGive(sem);
+	} else {
+		xSemaphoreGiveFromISR(sem, &woken);
+		portYIELD_FROM_ISR(woken);
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *        Exported functions
+ *----------------------------------------------------------------------------*/
+
+bool sdmmc_freertos_init(sSdCard *pSd)
+{
+	SemaphoreHandle_t sem;
+
+	assert(pSd);
+
+	sem = xSemaphoreCreateBinary();
+	if (sem == NULL)
+		return false;
+	SD_SetWaitHandler(pSd, _sdmmc_freertos_wait, _sdmmc_freertos_wake,
+	    (void *)sem);
+	return true;
+}
+
+void sdmmc_freertos_deinit(sSdCard *pSd)
+{
+	SemaphoreHandle_t sem;
+
+	assert(pSd);
+
+	if (pSd->fWait != _sdmmc_freertos_wait)
+		return;
+	sem = (SemaphoreHandle_t)pSd->pWaitArg;
+	SD_SetWaitHandler(pSd, NULL, NULL, NULL);
+	vSemaphoreDelete(sem);
+}
@@ -0,0 +1,69 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * FreeRTOS support for the SD/MMC library: commands suspend the calling task
+ * until the driver signals their completion from its interrupt handler,
+ * instead of busy waiting. The SD/MMC driver should be used in interrupt mode;
+ * in polling mode the completion is signaled from the waiting task itself.
+ */
+
+#ifndef _SDMMC_FREERTOS_H
+#define _SDMMC_FREERTOS_H
+
+/*------------------------------------------------------------------------------
+ *      Includes
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+
+#include "libsdmmc/sdmmc_cmd.h"
+
+/*------------------------------------------------------------------------------
+ *      Functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Make the commands sent to a device suspend the calling task.
+ * \param pSd  Pointer to a SD card driver instance, initialized with
+ * SDD_Initialize().
+ * \return true on success, false if the semaphore could not be allocated.
+ */
+extern bool sdmmc_freertos_init(sSdCard *pSd);
+
+/**
+ * \brief Restore polling for a device and release the semaphore allocated by
+ * sdmmc_freertos_init().
+ * \param pSd  Pointer to a SD card driver instance.
+ */
+extern void sdmmc_freertos_deinit(sSdCard *pSd);
+
+#endif /* _SDMMC_FREERTOS_H */
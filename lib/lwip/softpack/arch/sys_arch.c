@@ -1,7 +1,13 @@
+#include <stdlib.h>
+
 #include "arch/cc.h"
 #include "arch/sys_arch.h"
 #include "timer.h"
 
+#if defined(CONFIG_HAVE_AES) && defined(CONFIG_HAVE_TRNG)
+#include "crypto/drbg.h"
+#endif
+
 
 #if !NO_SYS
 
@@ -561,4 +567,24 @@ unsigned int sys_now(void)
 	return timer_get_tick();
 }
 
-#endif
\ No newline at end of file
+#endif
+
+#if defined(CONFIG_HAVE_AES) && defined(CONFIG_HAVE_TRNG)
+static struct _drbg_desc* _rand_drbg;
+
+void sys_set_rand_drbg(struct _drbg_desc* drbg)
+{
+	_rand_drbg = drbg;
+}
+#endif
+
+unsigned int sys_rand(void)
+{
+#if defined(CONFIG_HAVE_AES) && defined(CONFIG_HAVE_TRNG)
+	uint32_t value;
+
+	if (_rand_drbg && drbg_rand(_rand_drbg, &value) == 0)
+		return value;
+#endif
+	return (unsigned int)rand();
+}
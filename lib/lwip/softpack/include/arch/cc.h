@@ -68,6 +68,11 @@
     #error "This compiler does not support."
 #endif
 
+/* Random numbers for TCP initial sequence numbers, DNS ids and local ports,
+ * taken from the DRBG registered with sys_set_rand_drbg() when available */
+extern unsigned int sys_rand(void);
+#define LWIP_RAND() ((u32_t)sys_rand())
+
 /* No assert */
 #define LWIP_NOASSERT
 
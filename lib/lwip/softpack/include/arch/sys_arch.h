@@ -64,4 +64,16 @@ unsigned int sys_now(void);
 
 #endif
 
+#if defined(CONFIG_HAVE_AES) && defined(CONFIG_HAVE_TRNG)
+struct _drbg_desc;
+
+/**
+ * \brief Use an instantiated DRBG as source for LWIP_RAND(). Until a DRBG is
+ * registered, or when it cannot provide random data, the software generator
+ * rand() is used.
+ * \param drbg DRBG descriptor, or NULL to use the software generator only
+ */
+void sys_set_rand_drbg(struct _drbg_desc* drbg);
+#endif
+
 #endif
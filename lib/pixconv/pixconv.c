@@ -0,0 +1,538 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "compiler.h"
+#include "errno.h"
+
+#include "pixconv.h"
+#include "pixconv_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local definitions
+ *------------------------------------------------------------------------------*/
+
+/** Block size for rotations, keeps source and destination lines in cache */
+#define ROTATE_BLOCK 16
+
+/*------------------------------------------------------------------------------
+ *         Local types
+ *------------------------------------------------------------------------------*/
+
+struct _pixconv_line {
+	uint8_t* y;
+	uint8_t* u;
+	uint8_t* v;
+};
+
+/*------------------------------------------------------------------------------
+ *         Local variables
+ *------------------------------------------------------------------------------*/
+
+#ifdef CONFIG_HAVE_NEON
+static const struct _pixconv_ops* _ops = &pixconv_neon_ops;
+#else
+static const struct _pixconv_ops* _ops = &pixconv_c_ops;
+#endif
+
+/** Source line buffer, also holds the vertically filtered line when scaling */
+ALIGNED(16) static uint8_t _line_in[3 * PIXCONV_MAX_WIDTH];
+
+/** Destination line buffer */
+ALIGNED(16) static uint8_t _line_out[2 * PIXCONV_MAX_WIDTH];
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+static bool _is_yuv(enum _pixconv_format format)
+{
+	return format == PIXCONV_YUYV || format == PIXCONV_YUV422P ||
+	       format == PIXCONV_YUV420P || format == PIXCONV_YUV420SP;
+}
+
+static uint8_t _plane_count(enum _pixconv_format format)
+{
+	switch (format) {
+	case PIXCONV_RGB565:
+	case PIXCONV_RGB888:
+	case PIXCONV_YUYV:
+		return 1;
+	case PIXCONV_YUV420SP:
+		return 2;
+	case PIXCONV_YUV422P:
+	case PIXCONV_YUV420P:
+		return 3;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * \brief Get the size of a plane, in elements, and the element size in bytes
+ */
+static void _plane_geometry(const struct _pixconv_image* image, uint8_t plane,
+		uint32_t* width, uint32_t* height, uint32_t* bpp)
+{
+	*width = image->width;
+	*height = image->height;
+	*bpp = 1;
+
+	switch (image->format) {
+	case PIXCONV_RGB565:
+	case PIXCONV_YUYV:
+		*bpp = 2;
+		break;
+	case PIXCONV_RGB888:
+		*bpp = 3;
+		break;
+	case PIXCONV_YUV422P:
+		if (plane)
+			*width /= 2;
+		break;
+	case PIXCONV_YUV420P:
+		if (plane) {
+			*width /= 2;
+			*height /= 2;
+		}
+		break;
+	case PIXCONV_YUV420SP:
+		if (plane) {
+			*width /= 2;
+			*height /= 2;
+			*bpp = 2;
+		}
+		break;
+	}
+}
+
+static bool _check_image(const struct _pixconv_image* image)
+{
+	uint8_t i, planes = _plane_count(image->format);
+
+	if (!planes || !image->width || !image->height ||
+	    image->width > PIXCONV_MAX_WIDTH)
+		return false;
+	if (_is_yuv(image->format) && (image->width & 1))
+		return false;
+	if ((image->format == PIXCONV_YUV420P ||
+	     image->format == PIXCONV_YUV420SP) && (image->height & 1))
+		return false;
+	for (i = 0; i < planes; i++)
+		if (!image->plane[i])
+			return false;
+	return true;
+}
+
+static inline uint8_t* _row(const struct _pixconv_image* image, uint8_t plane,
+		uint32_t row)
+{
+	return image->plane[plane] + row * image->stride[plane];
+}
+
+/**
+ * \brief Get Y, U and V lines of a YUV image row, unpacked if needed
+ */
+static void _yuv_read(const struct _pixconv_image* image, uint32_t row,
+		struct _pixconv_line* line)
+{
+	uint32_t width = image->width;
+
+	switch (image->format) {
+	case PIXCONV_YUYV:
+		line->y = _line_in;
+		line->u = _line_in + width;
+		line->v = line->u + width / 2;
+		_ops->unpack_yuyv(_row(image, 0, row), line->y, line->u,
+				line->v, width);
+		break;
+	case PIXCONV_YUV422P:
+		line->y = _row(image, 0, row);
+		line->u = _row(image, 1, row);
+		line->v = _row(image, 2, row);
+		break;
+	case PIXCONV_YUV420P:
+		line->y = _row(image, 0, row);
+		line->u = _row(image, 1, row / 2);
+		line->v = _row(image, 2, row / 2);
+		break;
+	case PIXCONV_YUV420SP:
+		line->y = _row(image, 0, row);
+		line->u = _line_in;
+		line->v = _line_in + width / 2;
+		_ops->unpack_uv(_row(image, 1, row / 2), line->u, line->v,
+				width / 2);
+		break;
+	default:
+		line->y = line->u = line->v = NULL;
+		break;
+	}
+}
+
+/**
+ * \brief Get Y, U and V lines to write a YUV image row. Chroma of odd rows
+ * of 4:2:0 images goes to a scratch line.
+ */
+static void _yuv_prepare(const struct _pixconv_image* image, uint32_t row,
+		struct _pixconv_line* line)
+{
+	uint32_t width = image->width;
+
+	line->y = _line_out;
+	line->u = _line_out + width;
+	line->v = line->u + width / 2;
+
+	switch (image->format) {
+	case PIXCONV_YUV422P:
+		line->y = _row(image, 0, row);
+		line->u = _row(image, 1, row);
+		line->v = _row(image, 2, row);
+		break;
+	case PIXCONV_YUV420P:
+		line->y = _row(image, 0, row);
+		if (!(row & 1)) {
+			line->u = _row(image, 1, row / 2);
+			line->v = _row(image, 2, row / 2);
+		}
+		break;
+	case PIXCONV_YUV420SP:
+		line->y = _row(image, 0, row);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * \brief Pack lines filled after _yuv_prepare() into a YUV image row
+ */
+static void _yuv_commit(const struct _pixconv_image* image, uint32_t row,
+		const struct _pixconv_line* line)
+{
+	switch (image->format) {
+	case PIXCONV_YUYV:
+		_ops->pack_yuyv(line->y, line->u, line->v, _row(image, 0, row),
+				image->width);
+		break;
+	case PIXCONV_YUV420SP:
+		if (!(row & 1))
+			_ops->pack_uv(line->u, line->v, _row(image, 1, row / 2),
+					image->width / 2);
+		break;
+	default:
+		break;
+	}
+}
+
+static void _copy_image(const struct _pixconv_image* src,
+		const struct _pixconv_image* dst)
+{
+	uint32_t width, height, bpp, row;
+	uint8_t i;
+
+	for (i = 0; i < _plane_count(src->format); i++) {
+		_plane_geometry(src, i, &width, &height, &bpp);
+		for (row = 0; row < height; row++)
+			memcpy(_row(dst, i, row), _row(src, i, row), width * bpp);
+	}
+}
+
+static void _convert_row(const struct _pixconv_image* src,
+		const struct _pixconv_image* dst, uint32_t row)
+{
+	struct _pixconv_line in, out;
+	uint32_t width = src->width;
+
+	if (!_is_yuv(src->format)) {
+		if (!_is_yuv(dst->format)) {
+			if (src->format == PIXCONV_RGB565)
+				_ops->rgb565_to_rgb888((const uint16_t*)_row(src, 0, row),
+						_row(dst, 0, row), width);
+			else
+				_ops->rgb888_to_rgb565(_row(src, 0, row),
+						(uint16_t*)_row(dst, 0, row), width);
+			return;
+		}
+		_yuv_prepare(dst, row, &out);
+		if (src->format == PIXCONV_RGB565)
+			_ops->rgb565_to_yuv((const uint16_t*)_row(src, 0, row),
+					out.y, out.u, out.v, width);
+		else
+			_ops->rgb888_to_yuv(_row(src, 0, row), out.y, out.u,
+					out.v, width);
+		_yuv_commit(dst, row, &out);
+		return;
+	}
+
+	_yuv_read(src, row, &in);
+	if (dst->format == PIXCONV_RGB565) {
+		_ops->yuv_to_rgb565(in.y, in.u, in.v,
+				(uint16_t*)_row(dst, 0, row), width);
+	} else if (dst->format == PIXCONV_RGB888) {
+		_ops->yuv_to_rgb888(in.y, in.u, in.v, _row(dst, 0, row), width);
+	} else {
+		_yuv_prepare(dst, row, &out);
+		memcpy(out.y, in.y, width);
+		memcpy(out.u, in.u, width / 2);
+		memcpy(out.v, in.v, width / 2);
+		_yuv_commit(dst, row, &out);
+	}
+}
+
+/**
+ * \brief Get the source position of a destination sample, in 1/65536,
+ * sample centers aligned
+ */
+static inline uint32_t _scale_pos(uint32_t i, uint32_t step)
+{
+	int32_t pos = (int32_t)(i * step + step / 2) - 0x8000;
+
+	return pos < 0 ? 0 : (uint32_t)pos;
+}
+
+static void _scale_plane(const uint8_t* src, uint32_t src_stride,
+		uint32_t src_width, uint32_t src_height,
+		uint8_t* dst, uint32_t dst_stride,
+		uint32_t dst_width, uint32_t dst_height, uint32_t bpp)
+{
+	uint32_t xstep = (src_width << 16) / dst_width;
+	uint32_t ystep = (src_height << 16) / dst_height;
+	uint32_t x, y, c, pos, x0, x1, y0, y1, fx;
+	const uint8_t* line = _line_in;
+	uint8_t* d;
+
+	for (y = 0; y < dst_height; y++) {
+		pos = _scale_pos(y, ystep);
+		y0 = pos >> 16;
+		if (y0 > src_height - 1)
+			y0 = src_height - 1;
+		y1 = y0 + 1 < src_height ? y0 + 1 : y0;
+		_ops->blend(src + y0 * src_stride, src + y1 * src_stride,
+				_line_in, src_width * bpp, (pos >> 8) & 0xff);
+
+		d = dst + y * dst_stride;
+		for (x = 0; x < dst_width; x++) {
+			pos = _scale_pos(x, xstep);
+			x0 = pos >> 16;
+			if (x0 > src_width - 1)
+				x0 = src_width - 1;
+			x1 = x0 + 1 < src_width ? x0 + 1 : x0;
+			fx = (pos >> 8) & 0xff;
+			for (c = 0; c < bpp; c++)
+				*d++ = (line[x0 * bpp + c] * (256 - fx) +
+					line[x1 * bpp + c] * fx + 128) >> 8;
+		}
+	}
+}
+
+static inline void _copy_pixel(uint8_t* dst, const uint8_t* src, uint32_t bpp)
+{
+	dst[0] = src[0];
+	if (bpp > 1)
+		dst[1] = src[1];
+	if (bpp > 2)
+		dst[2] = src[2];
+}
+
+static void _rotate_plane(const uint8_t* src, uint32_t src_stride,
+		uint32_t width, uint32_t height,
+		uint8_t* dst, uint32_t dst_stride, uint32_t bpp,
+		enum _pixconv_rotation rotation)
+{
+	uint32_t bx, by, x, y, xe, ye;
+
+	if (rotation == PIXCONV_ROTATE_0 || rotation == PIXCONV_ROTATE_180) {
+		for (y = 0; y < height; y++) {
+			const uint8_t* s = src + y * src_stride;
+			uint8_t* d;
+
+			if (rotation == PIXCONV_ROTATE_0) {
+				memcpy(dst + y * dst_stride, s, width * bpp);
+				continue;
+			}
+			d = dst + (height - 1 - y) * dst_stride + (width - 1) * bpp;
+			for (x = 0; x < width; x++, s += bpp, d -= bpp)
+				_copy_pixel(d, s, bpp);
+		}
+		return;
+	}
+
+	/* 90 and 270 degrees, source (x, y) goes to (height - 1 - y, x) or
+	 * (y, width - 1 - x) */
+	for (by = 0; by < height; by += ROTATE_BLOCK) {
+		ye = by + ROTATE_BLOCK < height ? by + ROTATE_BLOCK : height;
+		for (bx = 0; bx < width; bx += ROTATE_BLOCK) {
+			xe = bx + ROTATE_BLOCK < width ? bx + ROTATE_BLOCK : width;
+			for (y = by; y < ye; y++) {
+				const uint8_t* s = src + y * src_stride + bx * bpp;
+				for (x = bx; x < xe; x++, s += bpp) {
+					if (rotation == PIXCONV_ROTATE_90)
+						_copy_pixel(dst + x * dst_stride +
+							(height - 1 - y) * bpp, s, bpp);
+					else
+						_copy_pixel(dst + (width - 1 - x) * dst_stride +
+							y * bpp, s, bpp);
+				}
+			}
+		}
+	}
+}
+
+static void _rotate_yuyv_180(const struct _pixconv_image* src,
+		const struct _pixconv_image* dst)
+{
+	uint32_t x, y;
+	const uint8_t* s;
+	uint8_t* d;
+
+	for (y = 0; y < src->height; y++) {
+		s = _row(src, 0, y);
+		d = _row(dst, 0, src->height - 1 - y) + 2 * src->width - 4;
+		for (x = 0; x < src->width / 2; x++, s += 4, d -= 4) {
+			d[0] = s[2];
+			d[1] = s[1];
+			d[2] = s[0];
+			d[3] = s[3];
+		}
+	}
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+uint32_t pixconv_image_init(struct _pixconv_image* image,
+		enum _pixconv_format format, uint32_t width, uint32_t height,
+		void* buffer)
+{
+	uint32_t w, h, bpp, size = 0;
+	uint8_t i;
+
+	memset(image, 0, sizeof(*image));
+	image->format = format;
+	image->width = width;
+	image->height = height;
+
+	for (i = 0; i < _plane_count(format); i++) {
+		_plane_geometry(image, i, &w, &h, &bpp);
+		image->plane[i] = (uint8_t*)buffer + size;
+		image->stride[i] = w * bpp;
+		size += w * h * bpp;
+	}
+	return size;
+}
+
+bool pixconv_use_neon(bool enable)
+{
+#ifdef CONFIG_HAVE_NEON
+	_ops = enable ? &pixconv_neon_ops : &pixconv_c_ops;
+	return enable;
+#else
+	(void)enable;
+	return false;
+#endif
+}
+
+int pixconv_convert(const struct _pixconv_image* src,
+		const struct _pixconv_image* dst)
+{
+	uint32_t row;
+
+	if (!_check_image(src) || !_check_image(dst))
+		return -EINVAL;
+	if (src->width != dst->width || src->height != dst->height)
+		return -EINVAL;
+
+	if (src->format == dst->format) {
+		_copy_image(src, dst);
+		return 0;
+	}
+
+	for (row = 0; row < src->height; row++)
+		_convert_row(src, dst, row);
+	return 0;
+}
+
+int pixconv_scale(const struct _pixconv_image* src,
+		const struct _pixconv_image* dst)
+{
+	uint32_t sw, sh, dw, dh, bpp;
+	uint8_t i;
+
+	if (!_check_image(src) || !_check_image(dst) ||
+	    src->format != dst->format)
+		return -EINVAL;
+	if (src->format == PIXCONV_RGB565 || src->format == PIXCONV_YUYV)
+		return -ENOTSUP;
+
+	for (i = 0; i < _plane_count(src->format); i++) {
+		_plane_geometry(src, i, &sw, &sh, &bpp);
+		_plane_geometry(dst, i, &dw, &dh, &bpp);
+		_scale_plane(src->plane[i], src->stride[i], sw, sh,
+				dst->plane[i], dst->stride[i], dw, dh, bpp);
+	}
+	return 0;
+}
+
+int pixconv_rotate(const struct _pixconv_image* src,
+		const struct _pixconv_image* dst, enum _pixconv_rotation rotation)
+{
+	uint32_t width, height, bpp;
+	bool swap = rotation == PIXCONV_ROTATE_90 || rotation == PIXCONV_ROTATE_270;
+	uint8_t i;
+
+	if (!_check_image(src) || !_check_image(dst) ||
+	    src->format != dst->format)
+		return -EINVAL;
+	if (dst->width != (swap ? src->height : src->width) ||
+	    dst->height != (swap ? src->width : src->height))
+		return -EINVAL;
+	if (swap && (src->format == PIXCONV_YUYV ||
+		     src->format == PIXCONV_YUV422P))
+		return -ENOTSUP;
+
+	if (src->format == PIXCONV_YUYV && rotation == PIXCONV_ROTATE_180) {
+		_rotate_yuyv_180(src, dst);
+		return 0;
+	}
+
+	for (i = 0; i < _plane_count(src->format); i++) {
+		_plane_geometry(src, i, &width, &height, &bpp);
+		_rotate_plane(src->plane[i], src->stride[i], width, height,
+				dst->plane[i], dst->stride[i], bpp, rotation);
+	}
+	return 0;
+}
@@ -0,0 +1,159 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Software pixel format conversion, scaling and rotation.
+ *
+ * Images are described by up to three planes with their line stride in
+ * bytes. Supported formats:
+ * - PIXCONV_RGB565: 16-bit packed RGB, one plane
+ * - PIXCONV_RGB888: 24-bit packed, B, G, R byte order (LCDC 24 bpp), one plane
+ * - PIXCONV_YUYV: packed YUV 4:2:2, Y0 U Y1 V byte order, one plane
+ * - PIXCONV_YUV422P: planar YUV 4:2:2, Y, U and V planes
+ * - PIXCONV_YUV420P: planar YUV 4:2:0, Y, U and V planes
+ * - PIXCONV_YUV420SP: semi-planar YUV 4:2:0, Y plane and interleaved UV plane
+ *
+ * YUV is BT.601 limited range. Widths of YUV images must be even, heights
+ * of 4:2:0 images must be even.
+ *
+ * Line kernels use NEON when the library is built with CONFIG_HAVE_NEON,
+ * the portable C kernels give bit-exact results and can be selected with
+ * pixconv_use_neon(false), for example to compare both paths.
+ *
+ * The conversion uses static line buffers of PIXCONV_MAX_WIDTH pixels,
+ * functions of this library are not reentrant.
+ */
+
+#ifndef _PIXCONV_H
+#define _PIXCONV_H
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ *         Definitions
+ *------------------------------------------------------------------------------*/
+
+#ifndef PIXCONV_MAX_WIDTH
+#define PIXCONV_MAX_WIDTH 2592
+#endif
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+enum _pixconv_format {
+	PIXCONV_RGB565 = 0,
+	PIXCONV_RGB888,
+	PIXCONV_YUYV,
+	PIXCONV_YUV422P,
+	PIXCONV_YUV420P,
+	PIXCONV_YUV420SP,
+};
+
+enum _pixconv_rotation {
+	PIXCONV_ROTATE_0 = 0,
+	PIXCONV_ROTATE_90,  /**< clockwise */
+	PIXCONV_ROTATE_180,
+	PIXCONV_ROTATE_270, /**< clockwise */
+};
+
+struct _pixconv_image {
+	enum _pixconv_format format;
+	uint32_t width;
+	uint32_t height;
+	uint8_t* plane[3];   /**< plane start addresses */
+	uint32_t stride[3];  /**< plane line strides, in bytes */
+};
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Fill plane addresses and strides of an image stored contiguously
+ * (planes following each other, no line padding) in a buffer.
+ * \param image image to initialize
+ * \param format pixel format
+ * \param width image width, in pixels
+ * \param height image height, in pixels
+ * \param buffer buffer holding the image
+ * \return size of the image in bytes, 0 if the format is invalid
+ */
+extern uint32_t pixconv_image_init(struct _pixconv_image* image,
+		enum _pixconv_format format, uint32_t width, uint32_t height,
+		void* buffer);
+
+/**
+ * \brief Select NEON or portable C line kernels. NEON kernels are used by
+ * default when available.
+ * \param enable true to use NEON kernels
+ * \return true if NEON kernels are in use
+ */
+extern bool pixconv_use_neon(bool enable);
+
+/**
+ * \brief Convert an image to another pixel format, same size.
+ * \param src source image
+ * \param dst destination image
+ * \return 0 on success, -EINVAL on size or format mismatch
+ */
+extern int pixconv_convert(const struct _pixconv_image* src,
+		const struct _pixconv_image* dst);
+
+/**
+ * \brief Scale an image to the destination size with bilinear filtering.
+ * Source and destination must have the same format, packed YUYV and
+ * RGB565 images are not supported.
+ * \param src source image
+ * \param dst destination image
+ * \return 0 on success, -EINVAL on format mismatch, -ENOTSUP on format
+ */
+extern int pixconv_scale(const struct _pixconv_image* src,
+		const struct _pixconv_image* dst);
+
+/**
+ * \brief Rotate an image. Source and destination must have the same format,
+ * destination width and height are swapped for 90 and 270 degrees. YUYV and
+ * YUV422P images support PIXCONV_ROTATE_180 only.
+ * \param src source image
+ * \param dst destination image, must not overlap the source
+ * \param rotation rotation to apply
+ * \return 0 on success, -EINVAL on size or format mismatch, -ENOTSUP on format
+ */
+extern int pixconv_rotate(const struct _pixconv_image* src,
+		const struct _pixconv_image* dst, enum _pixconv_rotation rotation);
+
+#endif /* _PIXCONV_H */
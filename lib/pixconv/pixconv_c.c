@@ -0,0 +1,256 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+#include "pixconv_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+static inline uint8_t _clamp(int32_t x)
+{
+	return x < 0 ? 0 : (x > 255 ? 255 : x);
+}
+
+/**
+ * \brief Convert a YUV sample to RGB, BT.601 limited range, Q6 coefficients
+ */
+static inline void _yuv_to_rgb(uint8_t y, uint8_t u, uint8_t v,
+		uint8_t* r, uint8_t* g, uint8_t* b)
+{
+	int32_t c = ((int32_t)y - 16) * 74;
+	int32_t d = (int32_t)u - 128;
+	int32_t e = (int32_t)v - 128;
+
+	*r = _clamp((c + 102 * e + 32) >> 6);
+	*g = _clamp((c - 25 * d - 52 * e + 32) >> 6);
+	*b = _clamp((c + 129 * d + 32) >> 6);
+}
+
+static inline uint8_t _rgb_to_y(uint8_t r, uint8_t g, uint8_t b)
+{
+	return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+}
+
+static inline uint8_t _rgb_to_u(uint8_t r, uint8_t g, uint8_t b)
+{
+	return ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+}
+
+static inline uint8_t _rgb_to_v(uint8_t r, uint8_t g, uint8_t b)
+{
+	return ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+static inline uint16_t _pack565(uint8_t r, uint8_t g, uint8_t b)
+{
+	return ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3);
+}
+
+static inline void _unpack565(uint16_t p, uint8_t* r, uint8_t* g, uint8_t* b)
+{
+	uint8_t r5 = p >> 11;
+	uint8_t g6 = (p >> 5) & 0x3f;
+	uint8_t b5 = p & 0x1f;
+
+	*r = (r5 << 3) | (r5 >> 2);
+	*g = (g6 << 2) | (g6 >> 4);
+	*b = (b5 << 3) | (b5 >> 2);
+}
+
+static inline uint8_t _avg(uint8_t a, uint8_t b)
+{
+	return (a + b + 1) >> 1;
+}
+
+static void _unpack_yuyv(const uint8_t* src, uint8_t* y, uint8_t* u,
+		uint8_t* v, uint32_t width)
+{
+	uint32_t i;
+
+	for (i = 0; i < width / 2; i++) {
+		*y++ = *src++;
+		*u++ = *src++;
+		*y++ = *src++;
+		*v++ = *src++;
+	}
+}
+
+static void _pack_yuyv(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+		uint8_t* dst, uint32_t width)
+{
+	uint32_t i;
+
+	for (i = 0; i < width / 2; i++) {
+		*dst++ = *y++;
+		*dst++ = *u++;
+		*dst++ = *y++;
+		*dst++ = *v++;
+	}
+}
+
+static void _unpack_uv(const uint8_t* uv, uint8_t* u, uint8_t* v,
+		uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		*u++ = *uv++;
+		*v++ = *uv++;
+	}
+}
+
+static void _pack_uv(const uint8_t* u, const uint8_t* v, uint8_t* uv,
+		uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		*uv++ = *u++;
+		*uv++ = *v++;
+	}
+}
+
+static void _yuv_to_rgb565(const uint8_t* y, const uint8_t* u,
+		const uint8_t* v, uint16_t* dst, uint32_t width)
+{
+	uint32_t i;
+	uint8_t r, g, b;
+
+	for (i = 0; i < width; i++) {
+		_yuv_to_rgb(y[i], u[i / 2], v[i / 2], &r, &g, &b);
+		dst[i] = _pack565(r, g, b);
+	}
+}
+
+static void _yuv_to_rgb888(const uint8_t* y, const uint8_t* u,
+		const uint8_t* v, uint8_t* dst, uint32_t width)
+{
+	uint32_t i;
+	uint8_t r, g, b;
+
+	for (i = 0; i < width; i++) {
+		_yuv_to_rgb(y[i], u[i / 2], v[i / 2], &r, &g, &b);
+		*dst++ = b;
+		*dst++ = g;
+		*dst++ = r;
+	}
+}
+
+static void _rgb565_to_yuv(const uint16_t* src, uint8_t* y, uint8_t* u,
+		uint8_t* v, uint32_t width)
+{
+	uint32_t i;
+	uint8_t r0, g0, b0, r1, g1, b1, r, g, b;
+
+	for (i = 0; i < width / 2; i++) {
+		_unpack565(*src++, &r0, &g0, &b0);
+		_unpack565(*src++, &r1, &g1, &b1);
+		*y++ = _rgb_to_y(r0, g0, b0);
+		*y++ = _rgb_to_y(r1, g1, b1);
+		r = _avg(r0, r1);
+		g = _avg(g0, g1);
+		b = _avg(b0, b1);
+		*u++ = _rgb_to_u(r, g, b);
+		*v++ = _rgb_to_v(r, g, b);
+	}
+}
+
+static void _rgb888_to_yuv(const uint8_t* src, uint8_t* y, uint8_t* u,
+		uint8_t* v, uint32_t width)
+{
+	uint32_t i;
+	uint8_t r, g, b;
+
+	for (i = 0; i < width / 2; i++) {
+		*y++ = _rgb_to_y(src[2], src[1], src[0]);
+		*y++ = _rgb_to_y(src[5], src[4], src[3]);
+		r = _avg(src[2], src[5]);
+		g = _avg(src[1], src[4]);
+		b = _avg(src[0], src[3]);
+		*u++ = _rgb_to_u(r, g, b);
+		*v++ = _rgb_to_v(r, g, b);
+		src += 6;
+	}
+}
+
+static void _rgb565_to_rgb888(const uint16_t* src, uint8_t* dst,
+		uint32_t width)
+{
+	uint32_t i;
+
+	for (i = 0; i < width; i++) {
+		_unpack565(*src++, &dst[2], &dst[1], &dst[0]);
+		dst += 3;
+	}
+}
+
+static void _rgb888_to_rgb565(const uint8_t* src, uint16_t* dst,
+		uint32_t width)
+{
+	uint32_t i;
+
+	for (i = 0; i < width; i++) {
+		*dst++ = _pack565(src[2], src[1], src[0]);
+		src += 3;
+	}
+}
+
+static void _blend(const uint8_t* a, const uint8_t* b, uint8_t* dst,
+		uint32_t count, uint32_t weight)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		dst[i] = (a[i] * (256 - weight) + b[i] * weight + 128) >> 8;
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported variables
+ *------------------------------------------------------------------------------*/
+
+const struct _pixconv_ops pixconv_c_ops = {
+	.unpack_yuyv = _unpack_yuyv,
+	.pack_yuyv = _pack_yuyv,
+	.unpack_uv = _unpack_uv,
+	.pack_uv = _pack_uv,
+	.yuv_to_rgb565 = _yuv_to_rgb565,
+	.yuv_to_rgb888 = _yuv_to_rgb888,
+	.rgb565_to_yuv = _rgb565_to_yuv,
+	.rgb888_to_yuv = _rgb888_to_yuv,
+	.rgb565_to_rgb888 = _rgb565_to_rgb888,
+	.rgb888_to_rgb565 = _rgb888_to_rgb565,
+	.blend = _blend,
+};
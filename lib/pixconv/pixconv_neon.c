@@ -0,0 +1,322 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <arm_neon.h>
+#include <stdint.h>
+
+#include "pixconv_private.h"
+
+/*------------------------------------------------------------------------------
+ *         Local functions
+ *------------------------------------------------------------------------------*/
+
+/* Kernels process 16 pixels per iteration and leave the tail to the C
+ * kernels, results are identical to pixconv_c_ops. */
+
+static inline uint16x8_t _pack565(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+	uint16x8_t p = vshll_n_u8(r, 8);
+	p = vsriq_n_u16(p, vshll_n_u8(g, 8), 5);
+	return vsriq_n_u16(p, vshll_n_u8(b, 8), 11);
+}
+
+static inline void _unpack565(uint16x8_t p, uint8x8_t* r, uint8x8_t* g,
+		uint8x8_t* b)
+{
+	uint8x8_t t;
+
+	t = vshrn_n_u16(p, 8);
+	*r = vsri_n_u8(t, t, 5);
+	t = vshrn_n_u16(p, 3);
+	*g = vsri_n_u8(t, t, 6);
+	t = vmovn_u16(vshlq_n_u16(p, 3));
+	*b = vsri_n_u8(t, t, 5);
+}
+
+/**
+ * \brief Convert 16 pixels to RGB, chroma samples are shared by pairs
+ */
+static inline void _yuv_to_rgb(const uint8_t* y, const uint8_t* u,
+		const uint8_t* v, uint8x8x2_t* r, uint8x8x2_t* g, uint8x8x2_t* b)
+{
+	uint8x8x2_t yy = vld2_u8(y);
+	int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u))),
+			vdupq_n_s16(128));
+	int16x8_t e = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v))),
+			vdupq_n_s16(128));
+	int16x8_t ruv = vmulq_n_s16(e, 102);
+	int16x8_t guv = vmlaq_n_s16(vmulq_n_s16(d, -25), e, -52);
+	int16x8_t buv = vmulq_n_s16(d, 129);
+	uint8x8_t re, ro, ge, go, be, bo;
+	int16x8_t c;
+
+	c = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yy.val[0])),
+			vdupq_n_s16(16)), 74);
+	re = vqrshrun_n_s16(vaddq_s16(c, ruv), 6);
+	ge = vqrshrun_n_s16(vaddq_s16(c, guv), 6);
+	be = vqrshrun_n_s16(vqaddq_s16(c, buv), 6);
+
+	c = vmulq_n_s16(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yy.val[1])),
+			vdupq_n_s16(16)), 74);
+	ro = vqrshrun_n_s16(vaddq_s16(c, ruv), 6);
+	go = vqrshrun_n_s16(vaddq_s16(c, guv), 6);
+	bo = vqrshrun_n_s16(vqaddq_s16(c, buv), 6);
+
+	*r = vzip_u8(re, ro);
+	*g = vzip_u8(ge, go);
+	*b = vzip_u8(be, bo);
+}
+
+static inline uint8x8_t _rgb_to_y(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+	uint16x8_t t = vmull_u8(r, vdup_n_u8(66));
+	t = vmlal_u8(t, g, vdup_n_u8(129));
+	t = vmlal_u8(t, b, vdup_n_u8(25));
+	return vadd_u8(vrshrn_n_u16(t, 8), vdup_n_u8(16));
+}
+
+/**
+ * \brief Convert 16 pixels to YUV, chroma from the average of pixel pairs
+ */
+static inline void _rgb_to_yuv(uint8x16_t r, uint8x16_t g, uint8x16_t b,
+		uint8_t* y, uint8_t* u, uint8_t* v)
+{
+	uint8x8_t ra, ga, ba;
+	int16x8_t t;
+
+	vst1_u8(y, _rgb_to_y(vget_low_u8(r), vget_low_u8(g), vget_low_u8(b)));
+	vst1_u8(y + 8, _rgb_to_y(vget_high_u8(r), vget_high_u8(g), vget_high_u8(b)));
+
+	ra = vrshrn_n_u16(vpaddlq_u8(r), 1);
+	ga = vrshrn_n_u16(vpaddlq_u8(g), 1);
+	ba = vrshrn_n_u16(vpaddlq_u8(b), 1);
+
+	/* results fit in 16-bit signed, wrap-around of unsigned
+	 * multiply-subtract gives the signed value */
+	t = vreinterpretq_s16_u16(vmlsl_u8(vmlsl_u8(vmull_u8(ba, vdup_n_u8(112)),
+			ra, vdup_n_u8(38)), ga, vdup_n_u8(74)));
+	t = vaddq_s16(vrshrq_n_s16(t, 8), vdupq_n_s16(128));
+	vst1_u8(u, vmovn_u16(vreinterpretq_u16_s16(t)));
+
+	t = vreinterpretq_s16_u16(vmlsl_u8(vmlsl_u8(vmull_u8(ra, vdup_n_u8(112)),
+			ga, vdup_n_u8(94)), ba, vdup_n_u8(18)));
+	t = vaddq_s16(vrshrq_n_s16(t, 8), vdupq_n_s16(128));
+	vst1_u8(v, vmovn_u16(vreinterpretq_u16_s16(t)));
+}
+
+static void _unpack_yuyv(const uint8_t* src, uint8_t* y, uint8_t* u,
+		uint8_t* v, uint32_t width)
+{
+	uint32_t i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		uint8x8x4_t p = vld4_u8(src + 2 * i);
+		uint8x8x2_t yy = { { p.val[0], p.val[2] } };
+		vst2_u8(y + i, yy);
+		vst1_u8(u + i / 2, p.val[1]);
+		vst1_u8(v + i / 2, p.val[3]);
+	}
+	pixconv_c_ops.unpack_yuyv(src + 2 * i, y + i, u + i / 2, v + i / 2,
+			width - i);
+}
+
+static void _pack_yuyv(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+		uint8_t* dst, uint32_t width)
+{
+	uint32_t i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		uint8x8x2_t yy = vld2_u8(y + i);
+		uint8x8x4_t p = { { yy.val[0], vld1_u8(u + i / 2),
+				    yy.val[1], vld1_u8(v + i / 2) } };
+		vst4_u8(dst + 2 * i, p);
+	}
+	pixconv_c_ops.pack_yuyv(y + i, u + i / 2, v + i / 2, dst + 2 * i,
+			width - i);
+}
+
+static void _unpack_uv(const uint8_t* uv, uint8_t* u, uint8_t* v,
+		uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		uint8x16x2_t p = vld2q_u8(uv + 2 * i);
+		vst1q_u8(u + i, p.val[0]);
+		vst1q_u8(v + i, p.val[1]);
+	}
+	pixconv_c_ops.unpack_uv(uv + 2 * i, u + i, v + i, count - i);
+}
+
+static void _pack_uv(const uint8_t* u, const uint8_t* v, uint8_t* uv,
+		uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		uint8x16x2_t p = { { vld1q_u8(u + i), vld1q_u8(v + i) } };
+		vst2q_u8(uv + 2 * i, p);
+	}
+	pixconv_c_ops.pack_uv(u + i, v + i, uv + 2 * i, count - i);
+}
+
+static void _yuv_to_rgb565(const uint8_t* y, const uint8_t* u,
+		const uint8_t* v, uint16_t* dst, uint32_t width)
+{
+	uint32_t i;
+	uint8x8x2_t r, g, b;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		_yuv_to_rgb(y + i, u + i / 2, v + i / 2, &r, &g, &b);
+		vst1q_u16(dst + i, _pack565(r.val[0], g.val[0], b.val[0]));
+		vst1q_u16(dst + i + 8, _pack565(r.val[1], g.val[1], b.val[1]));
+	}
+	pixconv_c_ops.yuv_to_rgb565(y + i, u + i / 2, v + i / 2, dst + i,
+			width - i);
+}
+
+static void _yuv_to_rgb888(const uint8_t* y, const uint8_t* u,
+		const uint8_t* v, uint8_t* dst, uint32_t width)
+{
+	uint32_t i, j;
+	uint8x8x2_t r, g, b;
+	uint8x8x3_t p;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		_yuv_to_rgb(y + i, u + i / 2, v + i / 2, &r, &g, &b);
+		for (j = 0; j < 2; j++) {
+			p.val[0] = b.val[j];
+			p.val[1] = g.val[j];
+			p.val[2] = r.val[j];
+			vst3_u8(dst + 3 * (i + 8 * j), p);
+		}
+	}
+	pixconv_c_ops.yuv_to_rgb888(y + i, u + i / 2, v + i / 2, dst + 3 * i,
+			width - i);
+}
+
+static void _rgb565_to_yuv(const uint16_t* src, uint8_t* y, uint8_t* u,
+		uint8_t* v, uint32_t width)
+{
+	uint32_t i;
+	uint8x8_t r0, g0, b0, r1, g1, b1;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		_unpack565(vld1q_u16(src + i), &r0, &g0, &b0);
+		_unpack565(vld1q_u16(src + i + 8), &r1, &g1, &b1);
+		_rgb_to_yuv(vcombine_u8(r0, r1), vcombine_u8(g0, g1),
+				vcombine_u8(b0, b1), y + i, u + i / 2, v + i / 2);
+	}
+	pixconv_c_ops.rgb565_to_yuv(src + i, y + i, u + i / 2, v + i / 2,
+			width - i);
+}
+
+static void _rgb888_to_yuv(const uint8_t* src, uint8_t* y, uint8_t* u,
+		uint8_t* v, uint32_t width)
+{
+	uint32_t i;
+
+	for (i = 0; i + 16 <= width; i += 16) {
+		uint8x16x3_t p = vld3q_u8(src + 3 * i);
+		_rgb_to_yuv(p.val[2], p.val[1], p.val[0],
+				y + i, u + i / 2, v + i / 2);
+	}
+	pixconv_c_ops.rgb888_to_yuv(src + 3 * i, y + i, u + i / 2, v + i / 2,
+			width - i);
+}
+
+static void _rgb565_to_rgb888(const uint16_t* src, uint8_t* dst,
+		uint32_t width)
+{
+	uint32_t i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		uint8x8x3_t p;
+		_unpack565(vld1q_u16(src + i), &p.val[2], &p.val[1], &p.val[0]);
+		vst3_u8(dst + 3 * i, p);
+	}
+	pixconv_c_ops.rgb565_to_rgb888(src + i, dst + 3 * i, width - i);
+}
+
+static void _rgb888_to_rgb565(const uint8_t* src, uint16_t* dst,
+		uint32_t width)
+{
+	uint32_t i;
+
+	for (i = 0; i + 8 <= width; i += 8) {
+		uint8x8x3_t p = vld3_u8(src + 3 * i);
+		vst1q_u16(dst + i, _pack565(p.val[2], p.val[1], p.val[0]));
+	}
+	pixconv_c_ops.rgb888_to_rgb565(src + 3 * i, dst + i, width - i);
+}
+
+static void _blend(const uint8_t* a, const uint8_t* b, uint8_t* dst,
+		uint32_t count, uint32_t weight)
+{
+	uint32_t i = 0;
+
+	if (weight > 0 && weight < 256) {
+		uint8x8_t wa = vdup_n_u8(256 - weight);
+		uint8x8_t wb = vdup_n_u8(weight);
+
+		for (; i + 16 <= count; i += 16) {
+			uint8x16_t pa = vld1q_u8(a + i);
+			uint8x16_t pb = vld1q_u8(b + i);
+			uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(pa), wa),
+					vget_low_u8(pb), wb);
+			uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(pa), wa),
+					vget_high_u8(pb), wb);
+			vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 8),
+					vrshrn_n_u16(hi, 8)));
+		}
+	}
+	pixconv_c_ops.blend(a + i, b + i, dst + i, count - i, weight);
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported variables
+ *------------------------------------------------------------------------------*/
+
+const struct _pixconv_ops pixconv_neon_ops = {
+	.unpack_yuyv = _unpack_yuyv,
+	.pack_yuyv = _pack_yuyv,
+	.unpack_uv = _unpack_uv,
+	.pack_uv = _pack_uv,
+	.yuv_to_rgb565 = _yuv_to_rgb565,
+	.yuv_to_rgb888 = _yuv_to_rgb888,
+	.rgb565_to_yuv = _rgb565_to_yuv,
+	.rgb888_to_yuv = _rgb888_to_yuv,
+	.rgb565_to_rgb888 = _rgb565_to_rgb888,
+	.rgb888_to_rgb565 = _rgb888_to_rgb565,
+	.blend = _blend,
+};
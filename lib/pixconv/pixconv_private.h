@@ -0,0 +1,100 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef _PIXCONV_PRIVATE_H
+#define _PIXCONV_PRIVATE_H
+
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ *      Types
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Line kernels. Widths are in pixels and even for functions handling
+ * 4:2:2 chroma, chroma lines hold width / 2 samples.
+ */
+struct _pixconv_ops {
+	/** Split a YUYV line into Y, U and V lines */
+	void (*unpack_yuyv)(const uint8_t* src, uint8_t* y, uint8_t* u,
+			uint8_t* v, uint32_t width);
+
+	/** Merge Y, U and V lines into a YUYV line */
+	void (*pack_yuyv)(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+			uint8_t* dst, uint32_t width);
+
+	/** Split an interleaved UV line of count pairs */
+	void (*unpack_uv)(const uint8_t* uv, uint8_t* u, uint8_t* v,
+			uint32_t count);
+
+	/** Interleave count U and V samples */
+	void (*pack_uv)(const uint8_t* u, const uint8_t* v, uint8_t* uv,
+			uint32_t count);
+
+	/** Convert Y, U and V lines to RGB565 */
+	void (*yuv_to_rgb565)(const uint8_t* y, const uint8_t* u,
+			const uint8_t* v, uint16_t* dst, uint32_t width);
+
+	/** Convert Y, U and V lines to RGB888 */
+	void (*yuv_to_rgb888)(const uint8_t* y, const uint8_t* u,
+			const uint8_t* v, uint8_t* dst, uint32_t width);
+
+	/** Convert a RGB565 line to Y, U and V lines */
+	void (*rgb565_to_yuv)(const uint16_t* src, uint8_t* y, uint8_t* u,
+			uint8_t* v, uint32_t width);
+
+	/** Convert a RGB888 line to Y, U and V lines */
+	void (*rgb888_to_yuv)(const uint8_t* src, uint8_t* y, uint8_t* u,
+			uint8_t* v, uint32_t width);
+
+	/** Convert a RGB565 line to RGB888 */
+	void (*rgb565_to_rgb888)(const uint16_t* src, uint8_t* dst,
+			uint32_t width);
+
+	/** Convert a RGB888 line to RGB565 */
+	void (*rgb888_to_rgb565)(const uint8_t* src, uint16_t* dst,
+			uint32_t width);
+
+	/** Blend count bytes of two lines, weight (0-256) applies to b */
+	void (*blend)(const uint8_t* a, const uint8_t* b, uint8_t* dst,
+			uint32_t count, uint32_t weight);
+};
+
+/*------------------------------------------------------------------------------
+ *      Exported variables
+ *------------------------------------------------------------------------------*/
+
+/** Portable C kernels, also used by NEON kernels for line tails */
+extern const struct _pixconv_ops pixconv_c_ops;
+
+#ifdef CONFIG_HAVE_NEON
+extern const struct _pixconv_ops pixconv_neon_ops;
+#endif
+
+#endif /* _PIXCONV_PRIVATE_H */
@@ -682,6 +682,31 @@ typedef PACKED_STRUCT _USBVideoUncompressedFrameDescriptor1 {
 	uint32_t dwFrameInterva[1]; /**< shortest interval, in 100ns ... following are longer */
 } USBVideoUncompressedFrameDescriptor1;
 
+/* USB Video Payload Motion-JPEG, 3.1.1 */
+/**
+ * Motion-JPEG Video Format Descriptor
+ */
+typedef PACKED_STRUCT _USBVideoMjpegFormatDescriptor {
+	uint8_t  bLength; /**< Size of descriptor: 11 bytes */
+	uint8_t  bDescriptorType; /**< CS_INTERFACE descriptor type */
+	uint8_t  bDescriptorSubType; /**< VS_FORMAT_MJPEG descriptor subtype */
+	uint8_t  bFormatIndex; /**< Index of this format descriptor */
+	uint8_t  bNumFrameDescriptors; /**< Number of frame descriptors following */
+	uint8_t  bmFlags; /**< D0: fixed size samples */
+	uint8_t  bDefaultFrameIndex; /**< Optimum Frame Index (used to select resolution) for this stream */
+	uint8_t  bAspectRatioX; /**< The X dimension of the picture aspect ratio */
+	uint8_t  bAspectRatioY; /**< The Y dimension of the picture aspect ratio */
+	uint8_t  bmInterlaceFlags; /**< interlace information */
+	uint8_t  bCopyProtect; /**< Whether duplication of the video stream is restricted */
+} USBVideoMjpegFormatDescriptor;
+
+/* USB Video Payload Motion-JPEG, 3.1.2 */
+/**
+ * Motion-JPEG Video Frame Descriptor
+ * (with 1 interval setting, same layout as the uncompressed one)
+ */
+typedef USBVideoUncompressedFrameDescriptor1 USBVideoMjpegFrameDescriptor1;
+
 /* USB Video, 3.9.2.5, Table 3-17 */
 /**
  * Still Image Frame Descriptor
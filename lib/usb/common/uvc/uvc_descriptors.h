@@ -100,6 +100,25 @@
 #define VIDCAMD_FW_3                 176
 #define VIDCAMD_FH_3                 144
 
+/** Format indexes, the MJPEG format is only in MJPEG configurations */
+#define VIDCAMD_FormatUncompressed      1
+#define VIDCAMD_FormatMjpeg             2
+
+/** Number of MJPEG Frame Types */
+#define VIDCAMD_NumMjpegFrameTypes      3
+
+#define VIDCAMD_MJPEG_FW_1           320
+#define VIDCAMD_MJPEG_FH_1           240
+
+#define VIDCAMD_MJPEG_FW_2           640
+#define VIDCAMD_MJPEG_FH_2           480
+
+#define VIDCAMD_MJPEG_FW_3           1280
+#define VIDCAMD_MJPEG_FH_3           720
+
+/** Compressed frame buffer size budget, 8 bits per pixel */
+#define FRAME_MJPEG_BUFFER_SIZEC(W,H)  ((W)*(H))
+
 /*----------------------------------------------------------------------------
  *         Types
  *----------------------------------------------------------------------------*/
@@ -138,6 +157,26 @@ typedef PACKED_STRUCT _UsbVideoInputHeaderDescriptor1 {
 	uint8_t     bmaControls1;
 } UsbVideoInputHeaderDescriptor1;
 
+/**
+ * Input header descriptor (with 2 formats)
+ */
+typedef PACKED_STRUCT _UsbVideoInputHeaderDescriptor2 {
+	uint8_t     bLength;
+	uint8_t     bDescriptorType;
+	uint8_t     bDescriptorSubType;
+	uint8_t     bNumFormats;
+	uint16_t    wTotalLength;
+	uint8_t     bEndpointAddress;
+	uint8_t     bmInfo;
+	uint8_t     bTerminalLink;
+	uint8_t     bStillCaptureMethod;
+	uint8_t     bTriggerSupport;
+	uint8_t     bTriggerUsage;
+	uint8_t     bControlSize;
+	uint8_t     bmaControls1;
+	uint8_t     bmaControls2;
+} UsbVideoInputHeaderDescriptor2;
+
 /**
  * Class-specific USB VideoControl Interface descriptor list
  */
@@ -161,6 +200,21 @@ typedef PACKED_STRUCT _UsbVideoStreamingInterfaceDescriptor {
 	UsbVideoFormatDescriptor format;
 } UsbVideoStreamingInterfaceDescriptor;
 
+/** USB Video MJPEG Format with 3 frames */
+typedef PACKED_STRUCT _UsbVideoFormatMjpegDescriptor {
+	USBVideoMjpegFormatDescriptor payload;
+	USBVideoMjpegFrameDescriptor1 frame320x240;
+	USBVideoMjpegFrameDescriptor1 frame640x480;
+	USBVideoMjpegFrameDescriptor1 frame1280x720;
+	USBVideoColorMatchingDescriptor colorMjpeg;
+} UsbVideoFormatMjpegDescriptor;
+
+typedef PACKED_STRUCT _UsbVideoStreamingInterfaceDescriptor2 {
+	UsbVideoInputHeaderDescriptor2 inHeader;
+	UsbVideoFormatDescriptor format;
+	UsbVideoFormatMjpegDescriptor mjpeg;
+} UsbVideoStreamingInterfaceDescriptor2;
+
 PACKED_STRUCT UsbVideoCamConfigurationDescriptors {
 	/* Configuration descriptor */
 	USBConfigurationDescriptor configuration;
@@ -180,6 +234,25 @@ PACKED_STRUCT UsbVideoCamConfigurationDescriptors {
 	USBEndpointDescriptor ep11;
 };
 
+PACKED_STRUCT UsbVideoCamMjpegConfigurationDescriptors {
+	/* Configuration descriptor */
+	USBConfigurationDescriptor configuration;
+	/* IAD */
+	USBInterfaceAssociationDescriptor iad;
+	/* VideoControl I/F */
+	USBInterfaceDescriptor interface0;
+	/* VideoControl I/F Descriptors */
+	UsbVideoControlInterfaceDescriptor vcInterface;
+	/* VideoStreaming I/F */
+	USBInterfaceDescriptor interface10;
+	/* VideoStreaming I/F Descriptors, uncompressed and MJPEG formats */
+	UsbVideoStreamingInterfaceDescriptor2 vsInterface;
+	/* VideoStreaming I/F */
+	USBInterfaceDescriptor interface11;
+	/* Endpoint */
+	USBEndpointDescriptor ep11;
+};
+
 
 /**@}*/
 #endif /* _VIDEODESCRIPTORS_H_ */
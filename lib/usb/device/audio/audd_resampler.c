@@ -0,0 +1,549 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *  Fixed-point polyphase fractional resampler for 16-bit PCM streams.
+ */
+
+/** \addtogroup usbd_audio_speakerphone
+ *@{
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "errno.h"
+
+#include "usb/device/audio/audd_resampler.h"
+
+/*------------------------------------------------------------------------------
+ *         Internal Defines
+ *------------------------------------------------------------------------------*/
+
+/** Bits of the position used to select the phase and to interpolate */
+#define PHASE_BITS          6
+#define INTERP_BITS         (16 - PHASE_BITS)
+
+#if (1 << PHASE_BITS) != AUDD_RESAMPLER_PHASES
+#error PHASE_BITS does not match AUDD_RESAMPLER_PHASES
+#endif
+
+/*------------------------------------------------------------------------------
+ *         Internal Variables
+ *------------------------------------------------------------------------------*/
+
+/**
+ * Filter phases, Q15, one more to interpolate the last phase.
+ *
+ * Windowed sinc, cutoff at 0.45 of the sample rate, Blackman-Harris window,
+ * each phase normalized to unity DC gain with the rounding error added to
+ * its largest tap. Phase p, tap k is computed for the distance
+ * t = p / AUDD_RESAMPLER_PHASES + AUDD_RESAMPLER_TAPS / 2 - 1 - k between
+ * the output position and input k.
+ */
+static const int16_t _coefs[AUDD_RESAMPLER_PHASES + 1][AUDD_RESAMPLER_TAPS] = {
+	{ /* phase 0 */
+		     0,      2,     -6,     11,    -13,      0,     50,   -167,
+		   382,   -719,   1178,  -1725,   2297,  -2803,   3152,  29490,
+		  3152,  -2803,   2297,  -1725,   1178,   -719,    382,   -167,
+		    50,      0,    -13,     11,     -6,      2,      0,      0,
+	},
+	{ /* phase 1 */
+		     0,      2,     -6,     10,    -11,     -4,     56,   -175,
+		   391,   -724,   1168,  -1688,   2205,  -2605,   2677,  29481,
+		  3637,  -2998,   2386,  -1760,   1184,   -713,    372,   -158,
+		    44,      4,    -15,     12,     -6,      2,      0,      0,
+	},
+	{ /* phase 2 */
+		     0,      2,     -5,      9,     -9,     -7,     62,   -183,
+		   399,   -726,   1157,  -1647,   2109,  -2407,   2211,  29451,
+		  4130,  -3191,   2471,  -1792,   1189,   -706,    362,   -148,
+		    37,      8,    -17,     13,     -6,      2,      0,      0,
+	},
+	{ /* phase 3 */
+		     0,      2,     -5,      9,     -7,    -11,     68,   -191,
+		   406,   -728,   1144,  -1603,   2011,  -2207,   1756,  29403,
+		  4632,  -3381,   2553,  -1821,   1191,   -697,    350,   -138,
+		    30,     12,    -19,     14,     -7,      2,      0,      0,
+	},
+	{ /* phase 4 */
+		     0,      2,     -5,      8,     -6,    -15,     73,   -198,
+		   412,   -728,   1128,  -1557,   1911,  -2006,   1312,  29338,
+		  5143,  -3568,   2631,  -1847,   1191,   -686,    337,   -128,
+		    23,     16,    -21,     14,     -7,      2,     -1,      0,
+	},
+	{ /* phase 5 */
+		     0,      2,     -4,      7,     -4,    -18,     79,   -204,
+		   417,   -726,   1111,  -1509,   1808,  -1805,    878,  29247,
+		  5660,  -3751,   2704,  -1869,   1189,   -674,    324,   -117,
+		    16,     20,    -23,     15,     -7,      3,     -1,      0,
+	},
+	{ /* phase 6 */
+		     0,      2,     -4,      6,     -2,    -21,     84,   -210,
+		   422,   -724,   1091,  -1458,   1703,  -1604,    456,  29140,
+		  6185,  -3930,   2774,  -1887,   1184,   -660,    310,   -106,
+		     8,     24,    -25,     16,     -8,      3,     -1,      0,
+	},
+	{ /* phase 7 */
+		     0,      2,     -4,      5,      0,    -24,     88,   -216,
+		   425,   -719,   1070,  -1405,   1596,  -1404,     45,  29016,
+		  6717,  -4105,   2839,  -1903,   1176,   -645,    295,    -94,
+		     1,     28,    -27,     17,     -8,      3,     -1,      0,
+	},
+	{ /* phase 8 */
+		     0,      2,     -4,      5,      2,    -27,     93,   -220,
+		   428,   -714,   1046,  -1350,   1488,  -1204,   -354,  28869,
+		  7255,  -4275,   2899,  -1914,   1166,   -628,    279,    -82,
+		    -7,     32,    -29,     18,     -8,      3,     -1,      0,
+	},
+	{ /* phase 9 */
+		     0,      1,     -3,      4,      3,    -30,     97,   -225,
+		   429,   -707,   1021,  -1293,   1378,  -1005,   -740,  28709,
+		  7798,  -4440,   2954,  -1922,   1154,   -610,    262,    -70,
+		   -15,     37,    -31,     18,     -8,      3,     -1,      0,
+	},
+	{ /* phase 10 */
+		     0,      1,     -3,      3,      5,    -33,    101,   -229,
+		   430,   -698,    995,  -1234,   1267,   -808,  -1114,  28524,
+		  8346,  -4599,   3005,  -1926,   1139,   -590,    245,    -57,
+		   -23,     41,    -33,     19,     -8,      3,     -1,      0,
+	},
+	{ /* phase 11 */
+		     0,      1,     -3,      2,      6,    -36,    105,   -232,
+		   430,   -689,    966,  -1173,   1155,   -613,  -1476,  28327,
+		  8899,  -4752,   3050,  -1926,   1122,   -569,    226,    -44,
+		   -31,     45,    -35,     20,     -9,      3,     -1,      0,
+	},
+	{ /* phase 12 */
+		     0,      1,     -2,      2,      8,    -38,    108,   -235,
+		   429,   -678,    936,  -1111,   1043,   -420,  -1824,  28108,
+		  9456,  -4898,   3089,  -1923,   1102,   -547,    207,    -31,
+		   -39,     49,    -37,     20,     -9,      3,     -1,      0,
+	},
+	{ /* phase 13 */
+		     0,      1,     -2,      1,      9,    -41,    111,   -237,
+		   427,   -666,    905,  -1048,    930,   -229,  -2159,  27869,
+		 10016,  -5038,   3123,  -1915,   1080,   -523,    188,    -17,
+		   -47,     54,    -38,     21,     -9,      3,     -1,      0,
+	},
+	{ /* phase 14 */
+		     0,      1,     -2,      0,     11,    -43,    114,   -239,
+		   424,   -653,    872,   -983,    817,    -41,  -2481,  27616,
+		 10578,  -5170,   3151,  -1904,   1055,   -497,    167,     -3,
+		   -55,     58,    -40,     22,     -9,      3,     -1,      0,
+	},
+	{ /* phase 15 */
+		     0,      1,     -2,     -1,     12,    -45,    116,   -240,
+		   421,   -638,    838,   -917,    703,    143,  -2789,  27347,
+		 11143,  -5295,   3173,  -1889,   1028,   -470,    146,     11,
+		   -63,     62,    -42,     22,     -9,      3,     -1,      0,
+	},
+	{ /* phase 16 */
+		     0,      1,     -1,     -1,     13,    -47,    119,   -241,
+		   416,   -623,    803,   -851,    590,    325,  -3084,  27058,
+		 11710,  -5411,   3190,  -1869,    998,   -442,    124,     25,
+		   -72,     66,    -44,     23,     -9,      3,     -1,      0,
+	},
+	{ /* phase 17 */
+		     0,      1,     -1,     -2,     15,    -49,    121,   -241,
+		   411,   -607,    767,   -783,    478,    502,  -3364,  26752,
+		 12277,  -5519,   3200,  -1846,    966,   -413,    102,     40,
+		   -80,     70,    -45,     23,     -9,      3,     -1,      0,
+	},
+	{ /* phase 18 */
+		     0,      1,     -1,     -2,     16,    -51,    122,   -241,
+		   405,   -589,    729,   -715,    366,    676,  -3631,  26433,
+		 12845,  -5619,   3204,  -1818,    931,   -382,     79,     55,
+		   -88,     74,    -47,     24,    -10,      3,     -1,      0,
+	},
+	{ /* phase 19 */
+		     0,      1,     -1,     -3,     17,    -53,    124,   -240,
+		   399,   -571,    691,   -647,    255,    845,  -3884,  26098,
+		 13413,  -5709,   3201,  -1787,    894,   -350,     56,     69,
+		   -96,     78,    -48,     24,    -10,      3,     -1,      0,
+	},
+	{ /* phase 20 */
+		     0,      1,      0,     -4,     18,    -54,    125,   -239,
+		   392,   -552,    652,   -578,    145,   1010,  -4123,  25747,
+		 13979,  -5789,   3192,  -1752,    855,   -317,     32,     84,
+		  -105,     82,    -50,     25,    -10,      3,     -1,      0,
+	},
+	{ /* phase 21 */
+		     0,      0,      0,     -4,     19,    -55,    125,   -237,
+		   384,   -532,    612,   -508,     36,   1170,  -4347,  25378,
+		 14545,  -5860,   3177,  -1712,    814,   -283,      8,     99,
+		  -113,     86,    -51,     25,    -10,      3,     -1,      0,
+	},
+	{ /* phase 22 */
+		     0,      0,      0,     -5,     20,    -56,    126,   -235,
+		   375,   -511,    571,   -439,    -71,   1325,  -4558,  24999,
+		 15108,  -5920,   3155,  -1669,    770,   -248,    -16,    114,
+		  -121,     89,    -53,     25,    -10,      3,      0,      0,
+	},
+	{ /* phase 23 */
+		     0,      0,      0,     -5,     21,    -58,    126,   -233,
+		   366,   -489,    530,   -370,   -177,   1475,  -4754,  24602,
+		 15669,  -5970,   3126,  -1621,    725,   -212,    -41,    129,
+		  -129,     93,    -54,     26,    -10,      3,      0,      0,
+	},
+	{ /* phase 24 */
+		     0,      0,      1,     -6,     22,    -58,    126,   -230,
+		   356,   -467,    488,   -301,   -281,   1620,  -4936,  24190,
+		 16226,  -6008,   3091,  -1570,    677,   -175,    -66,    145,
+		  -136,     96,    -55,     26,    -10,      3,      0,      0,
+	},
+	{ /* phase 25 */
+		     0,      0,      1,     -6,     22,    -59,    126,   -226,
+		   346,   -444,    446,   -232,   -383,   1759,  -5104,  23769,
+		 16779,  -6036,   3049,  -1515,    627,   -137,    -92,    160,
+		  -144,     99,    -56,     26,    -10,      3,      0,      0,
+	},
+	{ /* phase 26 */
+		     0,      0,      1,     -7,     23,    -60,    126,   -222,
+		   335,   -421,    404,   -164,   -482,   1892,  -5258,  23335,
+		 17328,  -6052,   3000,  -1456,    575,    -98,   -118,    174,
+		  -152,    103,    -57,     26,    -10,      3,      0,      0,
+	},
+	{ /* phase 27 */
+		     0,      0,      1,     -7,     24,    -60,    125,   -218,
+		   324,   -397,    361,    -96,   -580,   2020,  -5398,  22886,
+		 17871,  -6056,   2944,  -1393,    522,    -58,   -143,    189,
+		  -159,    105,    -58,     26,     -9,      2,      0,      0,
+	},
+	{ /* phase 28 */
+		     0,      0,      1,     -7,     24,    -61,    124,   -214,
+		   312,   -373,    319,    -29,   -675,   2141,  -5524,  22429,
+		 18409,  -6048,   2881,  -1326,    466,    -18,   -169,    204,
+		  -166,    108,    -59,     26,     -9,      2,      0,      0,
+	},
+	{ /* phase 29 */
+		     0,      0,      1,     -8,     25,    -61,    123,   -209,
+		   299,   -348,    276,     37,   -767,   2256,  -5636,  21959,
+		 18940,  -6028,   2812,  -1256,    409,     23,   -195,    218,
+		  -173,    111,    -59,     26,     -9,      2,      0,      0,
+	},
+	{ /* phase 30 */
+		     0,      0,      2,     -8,     25,    -61,    121,   -204,
+		   287,   -323,    233,    102,   -856,   2365,  -5735,  21480,
+		 19464,  -5995,   2736,  -1183,    350,     64,   -221,    233,
+		  -180,    113,    -60,     26,     -9,      2,      0,      0,
+	},
+	{ /* phase 31 */
+		     0,      0,      2,     -8,     25,    -61,    120,   -198,
+		   274,   -298,    190,    166,   -943,   2468,  -5820,  20988,
+		 19981,  -5950,   2653,  -1106,    290,    106,   -247,    247,
+		  -186,    116,    -60,     26,     -9,      2,      0,      0,
+	},
+	{ /* phase 32 */
+		     0,      0,      2,     -8,     26,    -61,    118,   -192,
+		   260,   -272,    148,    229,  -1026,   2564,  -5891,  20489,
+		 20485,  -5891,   2564,  -1026,    229,    148,   -272,    260,
+		  -192,    118,    -61,     26,     -8,      2,      0,      0,
+	},
+	{ /* phase 33 */
+		     0,      0,      2,     -9,     26,    -60,    116,   -186,
+		   247,   -247,    106,    290,  -1106,   2653,  -5950,  19981,
+		 20988,  -5820,   2468,   -943,    166,    190,   -298,    274,
+		  -198,    120,    -61,     25,     -8,      2,      0,      0,
+	},
+	{ /* phase 34 */
+		     0,      0,      2,     -9,     26,    -60,    113,   -180,
+		   233,   -221,     64,    350,  -1183,   2736,  -5995,  19464,
+		 21480,  -5735,   2365,   -856,    102,    233,   -323,    287,
+		  -204,    121,    -61,     25,     -8,      2,      0,      0,
+	},
+	{ /* phase 35 */
+		     0,      0,      2,     -9,     26,    -59,    111,   -173,
+		   218,   -195,     23,    409,  -1256,   2812,  -6028,  18940,
+		 21959,  -5636,   2256,   -767,     37,    276,   -348,    299,
+		  -209,    123,    -61,     25,     -8,      1,      0,      0,
+	},
+	{ /* phase 36 */
+		     0,      0,      2,     -9,     26,    -59,    108,   -166,
+		   204,   -169,    -18,    466,  -1326,   2881,  -6048,  18409,
+		 22429,  -5524,   2141,   -675,    -29,    319,   -373,    312,
+		  -214,    124,    -61,     24,     -7,      1,      0,      0,
+	},
+	{ /* phase 37 */
+		     0,      0,      2,     -9,     26,    -58,    105,   -159,
+		   189,   -143,    -58,    522,  -1393,   2944,  -6056,  17871,
+		 22886,  -5398,   2020,   -580,    -96,    361,   -397,    324,
+		  -218,    125,    -60,     24,     -7,      1,      0,      0,
+	},
+	{ /* phase 38 */
+		     0,      0,      3,    -10,     26,    -57,    103,   -152,
+		   174,   -118,    -98,    575,  -1456,   3000,  -6052,  17328,
+		 23335,  -5258,   1892,   -482,   -164,    404,   -421,    335,
+		  -222,    126,    -60,     23,     -7,      1,      0,      0,
+	},
+	{ /* phase 39 */
+		     0,      0,      3,    -10,     26,    -56,     99,   -144,
+		   160,    -92,   -137,    627,  -1515,   3049,  -6036,  16779,
+		 23769,  -5104,   1759,   -383,   -232,    446,   -444,    346,
+		  -226,    126,    -59,     22,     -6,      1,      0,      0,
+	},
+	{ /* phase 40 */
+		     0,      0,      3,    -10,     26,    -55,     96,   -136,
+		   145,    -66,   -175,    677,  -1570,   3091,  -6008,  16226,
+		 24190,  -4936,   1620,   -281,   -301,    488,   -467,    356,
+		  -230,    126,    -58,     22,     -6,      1,      0,      0,
+	},
+	{ /* phase 41 */
+		     0,      0,      3,    -10,     26,    -54,     93,   -129,
+		   129,    -41,   -212,    725,  -1621,   3126,  -5970,  15669,
+		 24602,  -4754,   1475,   -177,   -370,    530,   -489,    366,
+		  -233,    126,    -58,     21,     -5,      0,      0,      0,
+	},
+	{ /* phase 42 */
+		     0,      0,      3,    -10,     25,    -53,     89,   -121,
+		   114,    -16,   -248,    770,  -1669,   3155,  -5920,  15108,
+		 24999,  -4558,   1325,    -71,   -439,    571,   -511,    375,
+		  -235,    126,    -56,     20,     -5,      0,      0,      0,
+	},
+	{ /* phase 43 */
+		     0,     -1,      3,    -10,     25,    -51,     86,   -113,
+		    99,      8,   -283,    814,  -1712,   3177,  -5860,  14545,
+		 25378,  -4347,   1170,     36,   -508,    612,   -532,    384,
+		  -237,    125,    -55,     19,     -4,      0,      0,      0,
+	},
+	{ /* phase 44 */
+		     0,     -1,      3,    -10,     25,    -50,     82,   -105,
+		    84,     32,   -317,    855,  -1752,   3192,  -5789,  13979,
+		 25747,  -4123,   1010,    145,   -578,    652,   -552,    392,
+		  -239,    125,    -54,     18,     -4,      0,      1,      0,
+	},
+	{ /* phase 45 */
+		     0,     -1,      3,    -10,     24,    -48,     78,    -96,
+		    69,     56,   -350,    894,  -1787,   3201,  -5709,  13413,
+		 26098,  -3884,    845,    255,   -647,    691,   -571,    399,
+		  -240,    124,    -53,     17,     -3,     -1,      1,      0,
+	},
+	{ /* phase 46 */
+		     0,     -1,      3,    -10,     24,    -47,     74,    -88,
+		    55,     79,   -382,    931,  -1818,   3204,  -5619,  12845,
+		 26433,  -3631,    676,    366,   -715,    729,   -589,    405,
+		  -241,    122,    -51,     16,     -2,     -1,      1,      0,
+	},
+	{ /* phase 47 */
+		     0,     -1,      3,     -9,     23,    -45,     70,    -80,
+		    40,    102,   -413,    966,  -1846,   3200,  -5519,  12277,
+		 26752,  -3364,    502,    478,   -783,    767,   -607,    411,
+		  -241,    121,    -49,     15,     -2,     -1,      1,      0,
+	},
+	{ /* phase 48 */
+		     0,     -1,      3,     -9,     23,    -44,     66,    -72,
+		    25,    124,   -442,    998,  -1869,   3190,  -5411,  11710,
+		 27058,  -3084,    325,    590,   -851,    803,   -623,    416,
+		  -241,    119,    -47,     13,     -1,     -1,      1,      0,
+	},
+	{ /* phase 49 */
+		     0,     -1,      3,     -9,     22,    -42,     62,    -63,
+		    11,    146,   -470,   1028,  -1889,   3173,  -5295,  11143,
+		 27347,  -2789,    143,    703,   -917,    838,   -638,    421,
+		  -240,    116,    -45,     12,     -1,     -2,      1,      0,
+	},
+	{ /* phase 50 */
+		     0,     -1,      3,     -9,     22,    -40,     58,    -55,
+		    -3,    167,   -497,   1055,  -1904,   3151,  -5170,  10578,
+		 27616,  -2481,    -41,    817,   -983,    872,   -653,    424,
+		  -239,    114,    -43,     11,      0,     -2,      1,      0,
+	},
+	{ /* phase 51 */
+		     0,     -1,      3,     -9,     21,    -38,     54,    -47,
+		   -17,    188,   -523,   1080,  -1915,   3123,  -5038,  10016,
+		 27869,  -2159,   -229,    930,  -1048,    905,   -666,    427,
+		  -237,    111,    -41,      9,      1,     -2,      1,      0,
+	},
+	{ /* phase 52 */
+		     0,     -1,      3,     -9,     20,    -37,     49,    -39,
+		   -31,    207,   -547,   1102,  -1923,   3089,  -4898,   9456,
+		 28108,  -1824,   -420,   1043,  -1111,    936,   -678,    429,
+		  -235,    108,    -38,      8,      2,     -2,      1,      0,
+	},
+	{ /* phase 53 */
+		     0,     -1,      3,     -9,     20,    -35,     45,    -31,
+		   -44,    226,   -569,   1122,  -1926,   3050,  -4752,   8899,
+		 28327,  -1476,   -613,   1155,  -1173,    966,   -689,    430,
+		  -232,    105,    -36,      6,      2,     -3,      1,      0,
+	},
+	{ /* phase 54 */
+		     0,     -1,      3,     -8,     19,    -33,     41,    -23,
+		   -57,    245,   -590,   1139,  -1926,   3005,  -4599,   8346,
+		 28524,  -1114,   -808,   1267,  -1234,    995,   -698,    430,
+		  -229,    101,    -33,      5,      3,     -3,      1,      0,
+	},
+	{ /* phase 55 */
+		     0,     -1,      3,     -8,     18,    -31,     37,    -15,
+		   -70,    262,   -610,   1154,  -1922,   2954,  -4440,   7798,
+		 28709,   -740,  -1005,   1378,  -1293,   1021,   -707,    429,
+		  -225,     97,    -30,      3,      4,     -3,      1,      0,
+	},
+	{ /* phase 56 */
+		     0,     -1,      3,     -8,     18,    -29,     32,     -7,
+		   -82,    279,   -628,   1166,  -1914,   2899,  -4275,   7255,
+		 28869,   -354,  -1204,   1488,  -1350,   1046,   -714,    428,
+		  -220,     93,    -27,      2,      5,     -4,      2,      0,
+	},
+	{ /* phase 57 */
+		     0,     -1,      3,     -8,     17,    -27,     28,      1,
+		   -94,    295,   -645,   1176,  -1903,   2839,  -4105,   6717,
+		 29016,     45,  -1404,   1596,  -1405,   1070,   -719,    425,
+		  -216,     88,    -24,      0,      5,     -4,      2,      0,
+	},
+	{ /* phase 58 */
+		     0,     -1,      3,     -8,     16,    -25,     24,      8,
+		  -106,    310,   -660,   1184,  -1887,   2774,  -3930,   6185,
+		 29140,    456,  -1604,   1703,  -1458,   1091,   -724,    422,
+		  -210,     84,    -21,     -2,      6,     -4,      2,      0,
+	},
+	{ /* phase 59 */
+		     0,     -1,      3,     -7,     15,    -23,     20,     16,
+		  -117,    324,   -674,   1189,  -1869,   2704,  -3751,   5660,
+		 29247,    878,  -1805,   1808,  -1509,   1111,   -726,    417,
+		  -204,     79,    -18,     -4,      7,     -4,      2,      0,
+	},
+	{ /* phase 60 */
+		     0,     -1,      2,     -7,     14,    -21,     16,     23,
+		  -128,    337,   -686,   1191,  -1847,   2631,  -3568,   5143,
+		 29338,   1312,  -2006,   1911,  -1557,   1128,   -728,    412,
+		  -198,     73,    -15,     -6,      8,     -5,      2,      0,
+	},
+	{ /* phase 61 */
+		     0,      0,      2,     -7,     14,    -19,     12,     30,
+		  -138,    350,   -697,   1191,  -1821,   2553,  -3381,   4632,
+		 29403,   1756,  -2207,   2011,  -1603,   1144,   -728,    406,
+		  -191,     68,    -11,     -7,      9,     -5,      2,      0,
+	},
+	{ /* phase 62 */
+		     0,      0,      2,     -6,     13,    -17,      8,     37,
+		  -148,    362,   -706,   1189,  -1792,   2471,  -3191,   4130,
+		 29451,   2211,  -2407,   2109,  -1647,   1157,   -726,    399,
+		  -183,     62,     -7,     -9,      9,     -5,      2,      0,
+	},
+	{ /* phase 63 */
+		     0,      0,      2,     -6,     12,    -15,      4,     44,
+		  -158,    372,   -713,   1184,  -1760,   2386,  -2998,   3637,
+		 29481,   2677,  -2605,   2205,  -1688,   1168,   -724,    391,
+		  -175,     56,     -4,    -11,     10,     -6,      2,      0,
+	},
+	{ /* phase 64 */
+		     0,      0,      2,     -6,     11,    -13,      0,     50,
+		  -167,    382,   -719,   1178,  -1725,   2297,  -2803,   3152,
+		 29490,   3152,  -2803,   2297,  -1725,   1178,   -719,    382,
+		  -167,     50,      0,    -13,     11,     -6,      2,      0,
+	},
+};
+
+/*------------------------------------------------------------------------------
+ *         Exported Functions
+ *------------------------------------------------------------------------------*/
+
+int audd_resampler_init(struct _audd_resampler *resampler, uint8_t channels)
+{
+	if (channels == 0 || channels > AUDD_RESAMPLER_MAX_CHANNELS)
+		return -EINVAL;
+
+	resampler->channels = channels;
+	resampler->ratio = 1 << 16;
+	resampler->position = 0;
+	resampler->index = 0;
+	memset(resampler->history, 0, sizeof(resampler->history));
+	return 0;
+}
+
+void audd_resampler_set_ratio(struct _audd_resampler *resampler,
+		uint32_t ratio)
+{
+	resampler->ratio = ratio;
+}
+
+uint32_t audd_resampler_process(struct _audd_resampler *resampler,
+		const int16_t *in, uint32_t in_count,
+		int16_t *out, uint32_t out_count, uint32_t *in_used)
+{
+	int32_t coefs[AUDD_RESAMPLER_TAPS];
+	uint32_t used = 0, produced = 0;
+	uint8_t ch, k;
+
+	while (produced < out_count) {
+		const int16_t *c0, *c1;
+		int32_t frac;
+
+		/* move the input forward to the output position */
+		while (resampler->position >= (1 << 16)) {
+			if (used == in_count)
+				goto done;
+			/* the history is stored twice to be read without wrapping */
+			resampler->index = (resampler->index + 1) % AUDD_RESAMPLER_TAPS;
+			for (ch = 0; ch < resampler->channels; ch++) {
+				resampler->history[ch][resampler->index] = in[ch];
+				resampler->history[ch][resampler->index + AUDD_RESAMPLER_TAPS] = in[ch];
+			}
+			in += resampler->channels;
+			used++;
+			resampler->position -= 1 << 16;
+		}
+
+		/* filter for the position, Q25 */
+		c0 = _coefs[resampler->position >> INTERP_BITS];
+		c1 = _coefs[(resampler->position >> INTERP_BITS) + 1];
+		frac = resampler->position & ((1 << INTERP_BITS) - 1);
+		for (k = 0; k < AUDD_RESAMPLER_TAPS; k++)
+			coefs[k] = (c0[k] << INTERP_BITS) + (c1[k] - c0[k]) * frac;
+
+		for (ch = 0; ch < resampler->channels; ch++) {
+			const int16_t *x = &resampler->history[ch][resampler->index + 1];
+			int64_t acc = 1 << (14 + INTERP_BITS);
+			int32_t y;
+
+			for (k = 0; k < AUDD_RESAMPLER_TAPS; k++)
+				acc += (int64_t)x[k] * coefs[k];
+			y = (int32_t)(acc >> (15 + INTERP_BITS));
+			if (y > INT16_MAX)
+				y = INT16_MAX;
+			else if (y < INT16_MIN)
+				y = INT16_MIN;
+			*out++ = y;
+		}
+
+		produced++;
+		resampler->position += resampler->ratio;
+	}
+
+done:
+	if (in_used)
+		*in_used = used;
+	return produced;
+}
+
+/**@}*/
@@ -0,0 +1,119 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *  Fixed-point polyphase fractional resampler for 16-bit PCM streams.
+ *
+ *  Each output sample is a AUDD_RESAMPLER_TAPS taps windowed sinc
+ *  interpolation of the input, the filter for the fractional position is
+ *  linearly interpolated between AUDD_RESAMPLER_PHASES precomputed phases.
+ *  The ratio can be changed at any time without discontinuity, which makes
+ *  it suited to follow a slowly drifting clock (see audd_sync_get_ratio()).
+ *  The output is delayed by AUDD_RESAMPLER_TAPS / 2 input samples.
+ */
+
+/** \addtogroup usbd_audio_speakerphone
+ *@{
+ */
+
+#ifndef _AUDD_RESAMPLER_H_
+#define _AUDD_RESAMPLER_H_
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ *         Defines
+ *------------------------------------------------------------------------------*/
+
+/** Filter length in input samples */
+#define AUDD_RESAMPLER_TAPS         32
+
+/** Number of precomputed filter phases */
+#define AUDD_RESAMPLER_PHASES       64
+
+/** Maximum number of interleaved channels */
+#define AUDD_RESAMPLER_MAX_CHANNELS 2
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+struct _audd_resampler {
+	uint8_t  channels;       /**< number of interleaved channels */
+	uint32_t ratio;          /**< input samples per output sample, 16.16 */
+
+	/* --- following fields are used internally --- */
+	uint32_t position;       /**< output position after the last input, 16.16 */
+	uint8_t  index;          /**< last input in the history */
+	int16_t  history[AUDD_RESAMPLER_MAX_CHANNELS][2 * AUDD_RESAMPLER_TAPS];
+};
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Initialize a resampler with a ratio of 1.
+ * \param resampler resampler instance
+ * \param channels number of interleaved channels
+ * \return 0 on success, -EINVAL if the number of channels is not supported
+ */
+extern int audd_resampler_init(struct _audd_resampler *resampler,
+		uint8_t channels);
+
+/**
+ * \brief Change the ratio, effective from the next output sample.
+ * \param resampler resampler instance
+ * \param ratio input samples per output sample, 16.16
+ */
+extern void audd_resampler_set_ratio(struct _audd_resampler *resampler,
+		uint32_t ratio);
+
+/**
+ * \brief Resample interleaved samples until the input is used or the output
+ * is full.
+ * \param resampler resampler instance
+ * \param in input samples
+ * \param in_count number of input samples per channel
+ * \param out output samples
+ * \param out_count room in output, samples per channel
+ * \param in_used number of input samples per channel used
+ * \return number of output samples per channel
+ */
+extern uint32_t audd_resampler_process(struct _audd_resampler *resampler,
+		const int16_t *in, uint32_t in_count,
+		int16_t *out, uint32_t out_count, uint32_t *in_used);
+
+/**@}*/
+
+#endif /* _AUDD_RESAMPLER_H_ */
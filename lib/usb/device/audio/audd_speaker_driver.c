@@ -220,4 +220,26 @@ uint8_t audd_speaker_driver_read(void *buffer, uint32_t length,
 			buffer, length, callback, argument);
 }
 
+/**
+ * Send the explicit feedback value of the asynchronous OUT stream.
+ * \param buffer Feedback value, see audd_sync_get_feedback().
+ * \param length Feedback length, 3 bytes at full speed, 4 at high speed.
+ * \param callback Optional callback function to invoke when the transfer
+ *        finishes.
+ * \param argument Optional argument to the callback function.
+ * \return USBD_STATUS_SUCCESS if the transfer is started successfully;
+ *         otherwise an error code.
+ */
+uint8_t audd_speaker_driver_write_feedback(const void *buffer, uint32_t length,
+		usbd_xfer_cb_t callback, void *argument)
+{
+	AUDDSpeakerDriver *p_audd = &audd_speaker_driver;
+	AUDDSpeakerPhone *p_audf  = &p_audd->fun;
+
+	if (p_audf->pSpeaker->bEndpointFeedback == 0)
+		return USBD_STATUS_INVALID_PARAMETER;
+	return usbd_write(p_audf->pSpeaker->bEndpointFeedback,
+			buffer, length, callback, argument);
+}
+
 /**@}*/
@@ -90,6 +90,8 @@ typedef struct _AUDDStream {
 	uint8_t     bEndpointOut;
 	/** Streaming IN  endpoint address */
 	uint8_t     bEndpointIn;
+	/** Explicit feedback IN endpoint number for an asynchronous OUT stream */
+	uint8_t     bEndpointFeedback;
 	/** Number of channels (<=8) */
 	uint8_t     bNumChannels;
 	/** Mute control bits  (8b) */
@@ -0,0 +1,165 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *  Clock drift handling for USB audio OUT streams.
+ */
+
+/** \addtogroup usbd_audio_speakerphone
+ *@{
+ */
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "usb/device/audio/audd_sync.h"
+
+/*------------------------------------------------------------------------------
+ *         Internal Functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * Low pass filter a rate.
+ */
+static uint32_t _filter(uint32_t rate, uint32_t value)
+{
+	return rate + (((int32_t)(value - rate)) >> AUDD_SYNC_FILTER_SHIFT);
+}
+
+/**
+ * Rate correction bringing the buffer level back to the target, positive
+ * when the buffer is too full.
+ */
+static int32_t _level_error(const struct _audd_sync *sync, uint32_t level)
+{
+	int64_t error = (int32_t)(level - sync->target);
+	int32_t max = sync->nominal / AUDD_SYNC_MAX_DEVIATION;
+
+	error = (error * (1 << 16)) >> AUDD_SYNC_LEVEL_SHIFT;
+	if (error > max)
+		error = max;
+	else if (error < -max)
+		error = -max;
+	return (int32_t)error;
+}
+
+static uint32_t _clamp(const struct _audd_sync *sync, uint32_t rate)
+{
+	uint32_t max = sync->nominal / AUDD_SYNC_MAX_DEVIATION;
+
+	if (rate > sync->nominal + max)
+		return sync->nominal + max;
+	if (rate < sync->nominal - max)
+		return sync->nominal - max;
+	return rate;
+}
+
+/*------------------------------------------------------------------------------
+ *         Exported Functions
+ *------------------------------------------------------------------------------*/
+
+void audd_sync_init(struct _audd_sync *sync, uint32_t sample_rate,
+		uint32_t target, uint8_t window_log2)
+{
+	sync->nominal = ((uint64_t)sample_rate << 16) / 1000;
+	sync->target = target;
+	sync->window_log2 = window_log2;
+	sync->in_rate = sync->nominal;
+	sync->out_rate = sync->nominal;
+	sync->consumed = 0;
+	audd_sync_restart(sync);
+}
+
+void audd_sync_restart(struct _audd_sync *sync)
+{
+	sync->frames = 0;
+	sync->received = 0;
+	sync->consumed_start = sync->consumed;
+}
+
+void audd_sync_frame(struct _audd_sync *sync, uint32_t received)
+{
+	uint32_t consumed;
+
+	sync->received += received;
+	if (++sync->frames < (1u << sync->window_log2))
+		return;
+
+	/* the window ends, update the filtered rates */
+	consumed = sync->consumed;
+	sync->in_rate = _filter(sync->in_rate,
+			_clamp(sync, ((uint64_t)sync->received << 16) >> sync->window_log2));
+	sync->out_rate = _filter(sync->out_rate,
+			_clamp(sync, ((uint64_t)(consumed - sync->consumed_start) << 16) >> sync->window_log2));
+
+	sync->frames = 0;
+	sync->received = 0;
+	sync->consumed_start = consumed;
+}
+
+uint32_t audd_sync_get_rate(struct _audd_sync *sync, uint32_t level)
+{
+	return _clamp(sync, sync->out_rate - _level_error(sync, level));
+}
+
+uint32_t audd_sync_get_feedback(struct _audd_sync *sync,
+		uint32_t level, bool high_speed, uint8_t *buffer)
+{
+	uint32_t rate = audd_sync_get_rate(sync, level);
+
+	if (high_speed) {
+		/* 16.16 per microframe */
+		rate >>= 3;
+		buffer[0] = rate;
+		buffer[1] = rate >> 8;
+		buffer[2] = rate >> 16;
+		buffer[3] = rate >> 24;
+		return 4;
+	} else {
+		/* 10.14 per frame */
+		rate >>= 2;
+		buffer[0] = rate;
+		buffer[1] = rate >> 8;
+		buffer[2] = rate >> 16;
+		return 3;
+	}
+}
+
+uint32_t audd_sync_get_ratio(struct _audd_sync *sync, uint32_t level)
+{
+	uint32_t in_rate = sync->in_rate + _level_error(sync, level);
+
+	return ((uint64_t)in_rate << 16) / sync->out_rate;
+}
+
+/**@}*/
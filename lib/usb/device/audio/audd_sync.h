@@ -0,0 +1,159 @@
+/* ----------------------------------------------------------------------------
+ *         SAM Software Package License
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2019, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/** \file
+ *  Clock drift handling for USB audio OUT streams.
+ *
+ *  The rates at which the host sends samples and the audio device (SSC,
+ *  CLASSD...) consumes them are measured over windows of USB frames and low
+ *  pass filtered. Together with the level of the sample buffer they give:
+ *  - the explicit feedback value of an asynchronous OUT endpoint, so that
+ *    the host follows the audio device clock;
+ *  - the ratio for audd_resampler when the audio device clock cannot follow
+ *    the host.
+ *
+ *  All rates are in samples (one per channel) per 1 ms frame, 16.16 fixed
+ *  point.
+ */
+
+/** \addtogroup usbd_audio_speakerphone
+ *@{
+ */
+
+#ifndef _AUDD_SYNC_H_
+#define _AUDD_SYNC_H_
+
+/*------------------------------------------------------------------------------
+ *         Headers
+ *------------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*------------------------------------------------------------------------------
+ *         Defines
+ *------------------------------------------------------------------------------*/
+
+/** Rates are filtered with a weight of 1/2^x per window */
+#define AUDD_SYNC_FILTER_SHIFT      3
+
+/** Buffer level errors are corrected over 2^x frames */
+#define AUDD_SYNC_LEVEL_SHIFT       10
+
+/** Corrected rates stay within nominal +/- nominal/x */
+#define AUDD_SYNC_MAX_DEVIATION     64
+
+/*------------------------------------------------------------------------------
+ *         Types
+ *------------------------------------------------------------------------------*/
+
+struct _audd_sync {
+	uint32_t nominal;        /**< nominal rate */
+	uint32_t target;         /**< buffer level to keep, in samples */
+	uint8_t  window_log2;    /**< measurement window is 2^x frames */
+
+	/* --- following fields are used internally --- */
+	uint32_t frames;         /**< frames in current window */
+	uint32_t received;       /**< samples received in current window */
+	volatile uint32_t consumed; /**< samples consumed, free running */
+	uint32_t consumed_start; /**< consumed at start of window */
+	uint32_t in_rate;        /**< filtered host rate */
+	uint32_t out_rate;       /**< filtered audio device rate */
+};
+
+/*------------------------------------------------------------------------------
+ *         Exported functions
+ *------------------------------------------------------------------------------*/
+
+/**
+ * \brief Initialize the rate estimation, rates start at the nominal value.
+ * \param sync rate estimation instance
+ * \param sample_rate nominal sample rate in Hz
+ * \param target buffer level to keep, in samples
+ * \param window_log2 measurement window, 2^x frames
+ */
+extern void audd_sync_init(struct _audd_sync *sync, uint32_t sample_rate,
+		uint32_t target, uint8_t window_log2);
+
+/**
+ * \brief Restart the measurement, keep the filtered rates. To be called
+ * when the audio device starts consuming samples.
+ */
+extern void audd_sync_restart(struct _audd_sync *sync);
+
+/**
+ * \brief Account for one USB frame while the audio device is running.
+ * \param sync rate estimation instance
+ * \param received samples received in the frame, 0 for a lost packet
+ */
+extern void audd_sync_frame(struct _audd_sync *sync, uint32_t received);
+
+/**
+ * \brief Account for samples sent out by the audio device.
+ */
+static inline void audd_sync_consumed(struct _audd_sync *sync,
+		uint32_t samples)
+{
+	sync->consumed += samples;
+}
+
+/**
+ * \brief Rate to request from the host: audio device rate corrected to bring
+ * the buffer level back to the target.
+ * \param sync rate estimation instance
+ * \param level current buffer level in samples
+ * \return samples per frame, 16.16
+ */
+extern uint32_t audd_sync_get_rate(struct _audd_sync *sync, uint32_t level);
+
+/**
+ * \brief Build the explicit feedback value: 10.14 samples per frame on 3
+ * bytes at full speed, 16.16 samples per microframe on 4 bytes at high
+ * speed.
+ * \param sync rate estimation instance
+ * \param level current buffer level in samples
+ * \param high_speed true if the device is connected at high speed
+ * \param buffer feedback value, 4 bytes
+ * \return feedback value length in bytes
+ */
+extern uint32_t audd_sync_get_feedback(struct _audd_sync *sync,
+		uint32_t level, bool high_speed, uint8_t *buffer);
+
+/**
+ * \brief Input samples per output sample for audd_resampler, host rate over
+ * audio device rate corrected to bring the buffer level back to the target.
+ * \param sync rate estimation instance
+ * \param level current buffer level in samples
+ * \return ratio, 16.16
+ */
+extern uint32_t audd_sync_get_ratio(struct _audd_sync *sync, uint32_t level);
+
+/**@}*/
+
+#endif /* _AUDD_SYNC_H_ */
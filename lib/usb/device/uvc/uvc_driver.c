@@ -131,6 +131,8 @@ void uvc_driver_interface_setting_changed_handler(uint8_t interface,
 		uvc_driver.is_video_on = 1;
 		uvc_driver.frm_count = 0;
 		uvc_driver.frm_offset = 0;
+		uvc_driver.cmp_frm_size = 0;
+		uvc_driver.xfr_frm_size = 0;
 	} else {
 		uvc_driver.is_video_on = 0;
 		uvc_driver.is_frame_xfring = 0;
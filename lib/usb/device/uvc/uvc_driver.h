@@ -57,11 +57,18 @@ struct _uvc_driver {
 	volatile uint8_t is_video_on;
 	volatile uint8_t is_frame_xfring; //=0 default
 	uint32_t frm_format;
+	uint32_t fmt_index;
 	uint32_t frm_count;
 	uint32_t frm_offset;
 	uint32_t stream_frm_index;
 	uint32_t buf_start_addr;
 	uint8_t  multi_buffers;
+	/** Latest compressed frame, set by the application */
+	volatile uint32_t cmp_frm_addr;
+	volatile uint32_t cmp_frm_size;
+	/** Compressed frame being transferred */
+	uint32_t xfr_frm_addr;
+	uint32_t xfr_frm_size;
 	/** Array for storing the current setting of each interface */
 	uint8_t alternate_interfaces[4];
 };
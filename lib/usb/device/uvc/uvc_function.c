@@ -41,6 +41,7 @@
 #include "usb/device/usbd_hal.h"
 #include "usb/device/uvc/uvc_function.h"
 #include "timer.h"
+#include <stdbool.h>
 #include <string.h>
 
 /** Probe & Commit Controls */
@@ -98,10 +99,9 @@ static uint32_t uvc_frame_count = 0;
  * - Mode 1: last packet is <epSize+1> ~ <epSize*2> bytes\n
  * - Mode 2: last packet is <epSize*2+1> ~ <epSize*3> bytes
  */
-static void vidd_update_high_bw_max_packetsize(void)
+static void vidd_update_high_bw_max_packetsize(uint32_t frm_size)
 {
 #if (ISO_HIGH_BW_MODE == 1 || ISO_HIGH_BW_MODE == 2)
-	uint32_t frm_size = frm_width * frm_height * 2 + FRAME_PAYLOAD_HDR_SIZE;
 	uint32_t pkt_size = FRAME_PACKET_SIZE_HS * (ISO_HIGH_BW_MODE + 1);
 	uint32_t nb_last = frm_size % pkt_size;
 
@@ -113,6 +113,7 @@ static void vidd_update_high_bw_max_packetsize(void)
 	}
 	frm_max_pkt_size = pkt_size;
 #else
+	(void)frm_size;
 	frm_max_pkt_size = FRAME_PACKET_SIZE_HS; // EP size
 #endif
 }
@@ -124,30 +125,36 @@ static void vidd_status_stage(void *arg, uint8_t status,
 		uint32_t transferred, uint32_t remaining)
 {
 	USBVideoProbeData *pProbe = (USBVideoProbeData *)control_buffer;
+	bool mjpeg = pProbe->bFormatIndex == VIDCAMD_FormatMjpeg;
 
 	switch (pProbe->bFrameIndex) {
 	case 1:
-		frm_width = VIDCAMD_FW_1;
-		frm_height = VIDCAMD_FH_1;
+		frm_width = mjpeg ? VIDCAMD_MJPEG_FW_1 : VIDCAMD_FW_1;
+		frm_height = mjpeg ? VIDCAMD_MJPEG_FH_1 : VIDCAMD_FH_1;
 		break;
 	case 2:
-		frm_width = VIDCAMD_FW_2;
-		frm_height = VIDCAMD_FH_2;
+		frm_width = mjpeg ? VIDCAMD_MJPEG_FW_2 : VIDCAMD_FW_2;
+		frm_height = mjpeg ? VIDCAMD_MJPEG_FH_2 : VIDCAMD_FH_2;
 		break;
 	case 3:
-		frm_width = VIDCAMD_FW_3;
-		frm_height = VIDCAMD_FH_3;
+		frm_width = mjpeg ? VIDCAMD_MJPEG_FW_3 : VIDCAMD_FW_3;
+		frm_height = mjpeg ? VIDCAMD_MJPEG_FH_3 : VIDCAMD_FH_3;
 		break;
 	}
 
 	memcpy(&vidd_probe_data, &vidd_probe_data_init, sizeof(vidd_probe_data));
-	vidd_update_high_bw_max_packetsize();
+	vidd_update_high_bw_max_packetsize(FRAME_BUFFER_SIZEC(frm_width, frm_height)
+			+ FRAME_PAYLOAD_HDR_SIZE);
 	vidd_probe_data.bFormatIndex = pProbe->bFormatIndex;
 	vidd_probe_data.bFrameIndex = pProbe->bFrameIndex;
 	vidd_probe_data.wCompQuality = 0;
 	vidd_probe_data.wDelay = 0;
-	vidd_probe_data.dwMaxVideoFrameSize = FRAME_BUFFER_SIZEC(frm_width, frm_height);
+	if (mjpeg)
+		vidd_probe_data.dwMaxVideoFrameSize = FRAME_MJPEG_BUFFER_SIZEC(frm_width, frm_height);
+	else
+		vidd_probe_data.dwMaxVideoFrameSize = FRAME_BUFFER_SIZEC(frm_width, frm_height);
 	uvc_driver->frm_format = pProbe->bFrameIndex;
+	uvc_driver->fmt_index = pProbe->bFormatIndex;
 	usbd_write(0, NULL, 0, NULL, NULL);
 }
 
@@ -291,11 +298,35 @@ void uvc_function_payload_sent(void *arg, uint8_t state,
 	uint8_t *uncompressed_stream = (uint8_t*)(uvc_driver->buf_start_addr +
 									frame_buffer_addr * FRAME_BUFFER_SIZEC(frm_width, frm_height));
 	USBVideoPayloadHeader *header = (USBVideoPayloadHeader*)stream_header;
-	uint32_t max_pkt_size = usbd_is_high_speed() ? frm_max_pkt_size : FRAME_PACKET_SIZE_FS;
+	uint32_t max_pkt_size;
 	if (remaining){
 
 		return;
 	}
+	if (uvc_driver->fmt_index == VIDCAMD_FormatMjpeg) {
+		/* Compressed frames change size, latch the latest complete
+		 * one at frame start and send headers only until the
+		 * application provides one */
+		if (uvc_driver->frm_offset == 0) {
+			uvc_driver->xfr_frm_size = uvc_driver->cmp_frm_size;
+			uvc_driver->xfr_frm_addr = uvc_driver->cmp_frm_addr;
+			vidd_update_high_bw_max_packetsize(uvc_driver->xfr_frm_size
+					+ FRAME_PAYLOAD_HDR_SIZE);
+		}
+		frame_size = uvc_driver->xfr_frm_size;
+		uncompressed_stream = (uint8_t*)uvc_driver->xfr_frm_addr;
+		if (frame_size == 0) {
+			header->bHeaderLength = FRAME_PAYLOAD_HDR_SIZE;
+			header->bmHeaderInfo.B = 0;
+			header->bmHeaderInfo.bm.FID = (uvc_driver->frm_count & 1);
+			header->bmHeaderInfo.bm.EOH = 1;
+			usleep(500);
+			usbd_hal_write_with_header(VIDCAMD_IsoInEndpointNum, header,
+				header->bHeaderLength, NULL, 0);
+			return;
+		}
+	}
+	max_pkt_size = usbd_is_high_speed() ? frm_max_pkt_size : FRAME_PACKET_SIZE_FS;
 	dma_transfer_size = frame_size - uvc_driver->frm_offset;
 	header->bHeaderLength = FRAME_PAYLOAD_HDR_SIZE;
 	header->bmHeaderInfo.B = 0;
@@ -344,5 +375,26 @@ void uvc_function_update_frame_idx(uint32_t idx)
 	uvc_driver->stream_frm_index = idx;
 }
 
+uint8_t uvc_function_get_format_index(void)
+{
+	return (uint8_t)uvc_driver->fmt_index;
+}
+
+void uvc_function_update_compressed_frame(const void* buf, uint32_t size)
+{
+	/* an interrupted update reads as "no frame" in the transfer callback */
+	uvc_driver->cmp_frm_size = 0;
+	uvc_driver->cmp_frm_addr = (uint32_t)buf;
+	uvc_driver->cmp_frm_size = size;
+}
+
+const void* uvc_function_get_streaming_frame(void)
+{
+	if (uvc_driver->fmt_index != VIDCAMD_FormatMjpeg ||
+	    uvc_driver->xfr_frm_size == 0)
+		return NULL;
+	return (const void*)uvc_driver->xfr_frm_addr;
+}
+
 /**@}*/
 
@@ -61,6 +61,21 @@ extern void uvc_function_set_cur(const USBGenericRequest *request);
 extern uint8_t uvc_function_is_video_on(void);
 extern uint8_t uvc_function_get_frame_format(void);
 extern void uvc_function_update_frame_idx(uint32_t idx);
+extern uint8_t uvc_function_get_format_index(void);
+
+/**
+ * \brief Publish the latest compressed frame to stream. The buffer must stay
+ * untouched while it is the published or the streaming frame.
+ * \param buf compressed frame, cleaned from the data cache
+ * \param size size of the frame in bytes, 0 to stream payload headers only
+ */
+extern void uvc_function_update_compressed_frame(const void* buf, uint32_t size);
+
+/**
+ * \brief Get the compressed frame being transferred.
+ * \return frame address, NULL if no compressed frame is being transferred
+ */
+extern const void* uvc_function_get_streaming_frame(void);
 extern void uvc_reset_frame_count(void);
 extern uint32_t uvc_get_frame_count(void);
 /**@}*/
@@ -48,6 +48,13 @@
 #define APPLET_CMD_WRITE_BOOTCFG     0x35 /* Write Boot Config */
 #define APPLET_CMD_TAG_BLOCK         0x36 /* Tag / untag block as bad */
 #define APPLET_CMD_ENABLE_BOOT_PART  0x37 /* Enable / disable eMMC boot partition */
+/* Streaming commands are only supported by the serialflash, qspiflash and
+ * internalflash applets, the other applets report buf_count = 0 and reject
+ * them */
+#define APPLET_CMD_WRITE_BUFFER      0x38 /* Start writing a streaming buffer */
+#define APPLET_CMD_BUFFER_STATUS     0x39 /* Get streaming buffer state */
+#define APPLET_CMD_WRITE_COMPRESSED  0x3A /* Write LZ4 compressed pages */
+#define APPLET_CMD_VERIFY            0x3B /* Compute CRC32/SHA-256 of pages */
 
 #define APPLET_SUCCESS               0x00 /* Operation was successful */
 #define APPLET_DEV_UNKNOWN           0x01 /* Device unknown */
@@ -62,6 +69,17 @@
 #define APPLET_PMECC_CONFIG          0x0A /* ECC configure failure */
 #define APPLET_FAIL                  0x0F /* Generic/Unknown failure */
 
+/* Streaming buffer states */
+#define APPLET_BUFFER_FREE           0x00 /* Buffer can be filled by the host */
+#define APPLET_BUFFER_BUSY           0x01 /* Buffer is being written to memory */
+
+/* 'write compressed' flags */
+#define APPLET_WRITE_SKIP_ERASED     (1 << 0) /* Skip all-0xFF pages (erased memory) */
+
+/* 'verify' algorithms */
+#define APPLET_VERIFY_CRC32          0x00
+#define APPLET_VERIFY_SHA256         0x01
+
 /* Communication link identification */
 #define COMM_TYPE_USB                0x00
 #define COMM_TYPE_DBGU               0x01
@@ -108,6 +126,10 @@ union initialize_mailbox
 		uint32_t erase_support;
 		/** NAND header (if applicable) */
 		uint32_t nand_header;
+		/** Number of streaming buffers (0 if not supported), each
+		 *  buffer is buf_size / buf_count bytes long, starting at
+		 *  buf_addr */
+		uint32_t buf_count;
 	} out;
 };
 
@@ -178,6 +200,84 @@ union boot_partition_mailbox {
 	} out;
 };
 
+/**
+ * Mailbox content for the 'write buffer' and 'buffer status' commands.
+ *
+ * Streaming protocol: the host fills a free buffer and sends 'write buffer',
+ * the applet starts writing it to memory and returns while the memory is
+ * busy, so that the host can fill the next buffer meanwhile. When no buffer
+ * is left free, 'write buffer' drives the writes until one is. 'buffer
+ * status' makes progress on the pending writes and returns the state of a
+ * buffer, and the status of its last write once it is free again.
+ *
+ * Only the SPI/QSPI NOR and internal flash applets implement it. The NAND
+ * and SD/MMC drivers have no asynchronous program path, these applets
+ * report buf_count = 0 and the host must use 'write pages' instead.
+ */
+union stream_buffer_mailbox {
+	struct {
+		/** Buffer index */
+		uint32_t index;
+		/** Write offset (in pages), 'write buffer' only */
+		uint32_t offset;
+		/** Write length (in pages), 'write buffer' only */
+		uint32_t length;
+	} in;
+
+	struct {
+		/** Buffer state (APPLET_BUFFER_FREE or APPLET_BUFFER_BUSY) */
+		uint32_t state;
+		/** Status of the last write of the buffer */
+		uint32_t status;
+		/** Pages written by the last write of the buffer */
+		uint32_t pages;
+	} out;
+};
+
+/**
+ * Mailbox content for the 'write compressed' command.
+ *
+ * The host stores a raw LZ4 block (LZ4_compress_default() output, without
+ * frame) at the end of the buffer (buf_addr + buf_size - comp_size). The
+ * applet decompresses it to the start of the buffer and writes the pages with
+ * its 'write pages' command. The decompressed length plus
+ * (comp_size / 256 + 32) bytes must fit in the buffer.
+ */
+union write_compressed_mailbox {
+	struct {
+		/** Write offset (in pages) */
+		uint32_t offset;
+		/** Decompressed length (in pages) */
+		uint32_t length;
+		/** Compressed block size (in bytes) */
+		uint32_t comp_size;
+		/** APPLET_WRITE_* flags */
+		uint32_t flags;
+	} in;
+
+	struct {
+		/** Pages written (erased pages skipped included) */
+		uint32_t pages;
+	} out;
+};
+
+/** Mailbox content for the 'verify' command. */
+union verify_mailbox {
+	struct {
+		/** Verify offset (in pages) */
+		uint32_t offset;
+		/** Verify length (in pages) */
+		uint32_t length;
+		/** APPLET_VERIFY_CRC32 or APPLET_VERIFY_SHA256 */
+		uint32_t algo;
+	} in;
+
+	struct {
+		/** CRC32 in the first word, or SHA-256 digest bytes */
+		uint32_t digest[8];
+	} out;
+};
+
 typedef uint32_t (*applet_command_handler_t)(uint32_t cmd, uint32_t *args);
 
 struct applet_command
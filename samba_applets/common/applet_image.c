@@ -0,0 +1,472 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <string.h>
+
+#include "applet.h"
+#include "applet_image.h"
+#include "trace.h"
+
+/*----------------------------------------------------------------------------
+ *         Local constants
+ *----------------------------------------------------------------------------*/
+
+static const uint32_t crc32_nibble_table[16] = {
+	0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+	0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+	0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+	0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static uint8_t* _buffer;
+static uint32_t _buffer_size;
+static uint32_t _page_size;
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void _sha256_transform(struct applet_sha256* ctx, const uint8_t* data)
+{
+	uint32_t w[64], a, b, c, d, e, f, g, h, t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = (data[4 * i] << 24) | (data[4 * i + 1] << 16) |
+		       (data[4 * i + 2] << 8) | data[4 * i + 3];
+	for (i = 16; i < 64; i++) {
+		uint32_t s0 = ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		uint32_t s1 = ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	a = ctx->state[0];
+	b = ctx->state[1];
+	c = ctx->state[2];
+	d = ctx->state[3];
+	e = ctx->state[4];
+	f = ctx->state[5];
+	g = ctx->state[6];
+	h = ctx->state[7];
+
+	for (i = 0; i < 64; i++) {
+		t1 = h + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25)) +
+		     ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+		t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22)) +
+		     ((a & b) ^ (a & c) ^ (b & c));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	ctx->state[0] += a;
+	ctx->state[1] += b;
+	ctx->state[2] += c;
+	ctx->state[3] += d;
+	ctx->state[4] += e;
+	ctx->state[5] += f;
+	ctx->state[6] += g;
+	ctx->state[7] += h;
+}
+
+static applet_command_handler_t _get_pages_handler(uint32_t cmd)
+{
+	applet_command_handler_t handler = get_applet_command_handler(cmd);
+
+	if (!handler)
+		trace_error("Applet does not support command 0x%02x\r\n", (unsigned)cmd);
+	return handler;
+}
+
+/* Write pages from the start of the applet buffer using the applet's own
+ * 'write pages' command */
+static uint32_t _write_pages(applet_command_handler_t handler, uint32_t offset, uint32_t length)
+{
+	union read_write_erase_pages_mailbox mbx;
+
+	mbx.in.offset = offset;
+	mbx.in.length = length;
+	return handler(APPLET_CMD_WRITE_PAGES, (uint32_t*)&mbx);
+}
+
+static uint32_t _handle_write_compressed(union write_compressed_mailbox* mbx)
+{
+	uint32_t offset = mbx->in.offset;
+	uint32_t length = mbx->in.length;
+	uint32_t comp_size = mbx->in.comp_size;
+	bool skip_erased = (mbx->in.flags & APPLET_WRITE_SKIP_ERASED) != 0;
+	applet_command_handler_t handler;
+	uint32_t i, first, status;
+	int size;
+
+	handler = _get_pages_handler(APPLET_CMD_WRITE_PAGES);
+	if (!handler)
+		return APPLET_FAIL;
+
+	if (_page_size == 0) {
+		trace_error("Page size unknown\r\n");
+		return APPLET_FAIL;
+	}
+
+	/* the compressed block is stored at the end of the buffer and
+	 * decompressed in-place to the start of the buffer, length is checked
+	 * before the multiplication so that it cannot overflow */
+	if (comp_size > _buffer_size ||
+	    length > _buffer_size / _page_size ||
+	    APPLET_LZ4_MARGIN(comp_size) > _buffer_size - length * _page_size) {
+		trace_error("Buffer overflow\r\n");
+		return APPLET_FAIL;
+	}
+
+	size = applet_lz4_decompress(_buffer + _buffer_size - comp_size, comp_size,
+			_buffer, length * _page_size);
+	if (size != length * _page_size) {
+		trace_error("Invalid compressed data\r\n");
+		mbx->out.pages = 0;
+		return APPLET_FAIL;
+	}
+
+	if (!skip_erased) {
+		status = _write_pages(handler, offset, length);
+		mbx->out.pages = status == APPLET_SUCCESS ? length : 0;
+		return status;
+	}
+
+	/* write runs of non-erased pages, the memory is expected to be erased */
+	for (i = 0; i < length; ) {
+		while (i < length && applet_is_erased(_buffer + i * _page_size, _page_size))
+			i++;
+		first = i;
+		while (i < length && !applet_is_erased(_buffer + i * _page_size, _page_size))
+			i++;
+		if (first == i)
+			break;
+
+		/* the 'write pages' command writes from the start of the
+		 * buffer, the pages after the run are not overwritten */
+		if (first)
+			memmove(_buffer, _buffer + first * _page_size, (i - first) * _page_size);
+		status = _write_pages(handler, offset + first, i - first);
+		if (status != APPLET_SUCCESS) {
+			mbx->out.pages = first;
+			return status;
+		}
+	}
+
+	trace_info_wp("Wrote %u bytes at 0x%08x (%u bytes compressed)\r\n",
+			(unsigned)(length * _page_size),
+			(unsigned)(offset * _page_size), (unsigned)comp_size);
+
+	mbx->out.pages = length;
+	return APPLET_SUCCESS;
+}
+
+static uint32_t _handle_verify(union verify_mailbox* mbx)
+{
+	uint32_t offset = mbx->in.offset;
+	uint32_t length = mbx->in.length;
+	uint32_t algo = mbx->in.algo;
+	union read_write_erase_pages_mailbox rd;
+	applet_command_handler_t handler;
+	struct applet_sha256 sha;
+	uint32_t crc = 0, chunk, status;
+
+	handler = _get_pages_handler(APPLET_CMD_READ_PAGES);
+	if (!handler)
+		return APPLET_FAIL;
+
+	if (algo != APPLET_VERIFY_CRC32 && algo != APPLET_VERIFY_SHA256) {
+		trace_error("Unsupported verify algorithm %u\r\n", (unsigned)algo);
+		return APPLET_FAIL;
+	}
+
+	/* pages are read by chunks of at least one page */
+	if (_page_size == 0 || _buffer_size < _page_size) {
+		trace_error("Buffer smaller than a page\r\n");
+		return APPLET_FAIL;
+	}
+
+	applet_sha256_init(&sha);
+	while (length) {
+		chunk = length;
+		if (chunk > _buffer_size / _page_size)
+			chunk = _buffer_size / _page_size;
+
+		rd.in.offset = offset;
+		rd.in.length = chunk;
+		status = handler(APPLET_CMD_READ_PAGES, (uint32_t*)&rd);
+		if (status != APPLET_SUCCESS)
+			return status;
+
+		if (algo == APPLET_VERIFY_CRC32)
+			crc = applet_crc32(crc, _buffer, chunk * _page_size);
+		else
+			applet_sha256_update(&sha, _buffer, chunk * _page_size);
+
+		offset += chunk;
+		length -= chunk;
+	}
+
+	memset(mbx->out.digest, 0, sizeof(mbx->out.digest));
+	if (algo == APPLET_VERIFY_CRC32)
+		mbx->out.digest[0] = crc;
+	else
+		applet_sha256_final(&sha, (uint8_t*)mbx->out.digest);
+
+	trace_info_wp("Verified %u bytes at 0x%08x\r\n",
+			(unsigned)(mbx->in.length * _page_size),
+			(unsigned)(mbx->in.offset * _page_size));
+
+	return APPLET_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ *         Public functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Decompress a raw LZ4 block (no frame header).
+ *
+ * The decompression can be done in-place if the compressed data is stored at
+ * the end of a buffer of at least dst_len + APPLET_LZ4_MARGIN(src_len) bytes
+ * starting at dst.
+ *
+ * \return the decompressed size, or -1 if the block is invalid
+ */
+int applet_lz4_decompress(const uint8_t* src, uint32_t src_len,
+		uint8_t* dst, uint32_t dst_len)
+{
+	const uint8_t* ip = src;
+	const uint8_t* iend = src + src_len;
+	uint8_t* op = dst;
+	uint8_t* oend = dst + dst_len;
+	uint32_t token, len, offset;
+	uint8_t b;
+
+	while (ip < iend) {
+		token = *ip++;
+
+		/* literals */
+		len = token >> 4;
+		if (len == 15) {
+			do {
+				if (ip >= iend)
+					return -1;
+				b = *ip++;
+				len += b;
+			} while (b == 255);
+		}
+		if (len > (uint32_t)(iend - ip) || len > (uint32_t)(oend - op))
+			return -1;
+		memmove(op, ip, len);
+		ip += len;
+		op += len;
+
+		/* the last sequence only has literals */
+		if (ip >= iend)
+			break;
+
+		/* match */
+		if (iend - ip < 2)
+			return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (uint32_t)(op - dst))
+			return -1;
+
+		len = token & 15;
+		if (len == 15) {
+			do {
+				if (ip >= iend)
+					return -1;
+				b = *ip++;
+				len += b;
+			} while (b == 255);
+		}
+		len += 4;
+		if (len > (uint32_t)(oend - op))
+			return -1;
+
+		if (offset >= len) {
+			memcpy(op, op - offset, len);
+			op += len;
+		} else {
+			/* overlapping match, repeats the last 'offset' bytes */
+			const uint8_t* match = op - offset;
+			while (len--)
+				*op++ = *match++;
+		}
+	}
+
+	return op - dst;
+}
+
+bool applet_is_erased(const uint8_t* buf, uint32_t length)
+{
+	const uint32_t* p = (const uint32_t*)buf;
+	uint32_t i;
+
+	/* buffers are page aligned */
+	for (i = 0; i < length / 4; i++)
+		if (p[i] != 0xffffffffu)
+			return false;
+	for (i *= 4; i < length; i++)
+		if (buf[i] != 0xffu)
+			return false;
+	return true;
+}
+
+/**
+ * \brief Update a CRC32 (IEEE 802.3, same as zlib), start with crc = 0
+ */
+uint32_t applet_crc32(uint32_t crc, const uint8_t* buf, uint32_t length)
+{
+	crc = ~crc;
+	while (length--) {
+		crc ^= *buf++;
+		crc = (crc >> 4) ^ crc32_nibble_table[crc & 0xf];
+		crc = (crc >> 4) ^ crc32_nibble_table[crc & 0xf];
+	}
+	return ~crc;
+}
+
+void applet_sha256_init(struct applet_sha256* ctx)
+{
+	ctx->state[0] = 0x6a09e667;
+	ctx->state[1] = 0xbb67ae85;
+	ctx->state[2] = 0x3c6ef372;
+	ctx->state[3] = 0xa54ff53a;
+	ctx->state[4] = 0x510e527f;
+	ctx->state[5] = 0x9b05688c;
+	ctx->state[6] = 0x1f83d9ab;
+	ctx->state[7] = 0x5be0cd19;
+	ctx->length = 0;
+	ctx->count = 0;
+}
+
+void applet_sha256_update(struct applet_sha256* ctx, const uint8_t* buf, uint32_t length)
+{
+	ctx->length += length;
+
+	while (length) {
+		uint32_t n = 64 - ctx->count;
+		if (n > length)
+			n = length;
+
+		if (ctx->count == 0 && n == 64) {
+			_sha256_transform(ctx, buf);
+		} else {
+			memcpy(&ctx->block[ctx->count], buf, n);
+			ctx->count += n;
+			if (ctx->count == 64) {
+				_sha256_transform(ctx, ctx->block);
+				ctx->count = 0;
+			}
+		}
+
+		buf += n;
+		length -= n;
+	}
+}
+
+void applet_sha256_final(struct applet_sha256* ctx, uint8_t* digest)
+{
+	uint64_t bits = ctx->length * 8;
+	int i;
+
+	ctx->block[ctx->count++] = 0x80;
+	if (ctx->count > 56) {
+		memset(&ctx->block[ctx->count], 0, 64 - ctx->count);
+		_sha256_transform(ctx, ctx->block);
+		ctx->count = 0;
+	}
+	memset(&ctx->block[ctx->count], 0, 56 - ctx->count);
+	for (i = 0; i < 8; i++)
+		ctx->block[56 + i] = bits >> (56 - 8 * i);
+	_sha256_transform(ctx, ctx->block);
+
+	for (i = 0; i < 32; i++)
+		digest[i] = ctx->state[i / 4] >> (24 - 8 * (i % 4));
+}
+
+void applet_image_set_info(uint8_t* buffer, uint32_t buffer_size, uint32_t page_size)
+{
+	_buffer = buffer;
+	_buffer_size = buffer_size;
+	_page_size = page_size;
+}
+
+bool applet_is_image_command(uint32_t cmd)
+{
+	return (cmd == APPLET_CMD_WRITE_COMPRESSED ||
+	        cmd == APPLET_CMD_VERIFY);
+}
+
+uint32_t applet_handle_image_command(uint32_t cmd, uint32_t *args)
+{
+	if (!_buffer || !_page_size) {
+		trace_error("Applet buffer not configured\r\n");
+		return APPLET_FAIL;
+	}
+
+	if (cmd == APPLET_CMD_WRITE_COMPRESSED)
+		return _handle_write_compressed((union write_compressed_mailbox*)args);
+	else
+		return _handle_verify((union verify_mailbox*)args);
+}
@@ -0,0 +1,69 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef _APPLET_IMAGE_H_
+#define _APPLET_IMAGE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*----------------------------------------------------------------------------
+ *         Global definitions
+ *----------------------------------------------------------------------------*/
+
+/* LZ4 in-place decompression margin, see applet_lz4_decompress() */
+#define APPLET_LZ4_MARGIN(comp_size) (((comp_size) >> 8) + 32)
+
+struct applet_sha256 {
+	uint32_t state[8];
+	uint64_t length;
+	uint32_t count;
+	uint8_t block[64];
+};
+
+extern int applet_lz4_decompress(const uint8_t* src, uint32_t src_len,
+		uint8_t* dst, uint32_t dst_len);
+
+extern bool applet_is_erased(const uint8_t* buf, uint32_t length);
+
+extern uint32_t applet_crc32(uint32_t crc, const uint8_t* buf, uint32_t length);
+
+extern void applet_sha256_init(struct applet_sha256* ctx);
+
+extern void applet_sha256_update(struct applet_sha256* ctx, const uint8_t* buf, uint32_t length);
+
+extern void applet_sha256_final(struct applet_sha256* ctx, uint8_t* digest);
+
+extern void applet_image_set_info(uint8_t* buffer, uint32_t buffer_size, uint32_t page_size);
+
+extern bool applet_is_image_command(uint32_t cmd);
+
+extern uint32_t applet_handle_image_command(uint32_t cmd, uint32_t *args);
+
+#endif /* _APPLET_IMAGE_H_ */
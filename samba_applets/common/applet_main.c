@@ -30,7 +30,9 @@
 #include <string.h>
 
 #include "applet.h"
+#include "applet_image.h"
 #include "applet_legacy.h"
+#include "applet_stream.h"
 #include "board.h"
 #include "board_console.h"
 #include "board_timer.h"
@@ -232,10 +234,15 @@ void applet_main(void)
 	/* set default status */
 	applet_mailbox.status = APPLET_FAIL;
 
+	/* complete the streaming writes before other memory accesses */
+	if (!applet_is_stream_command(applet_mailbox.command))
+		applet_stream_wait();
+
 	/* look for handler and call it */
 	handler = get_applet_command_handler(applet_mailbox.command);
 	if (handler) {
 		if (applet_mailbox.command == APPLET_CMD_INITIALIZE) {
+			applet_stream_setup(NULL, NULL, 0, 0);
 			applet_mailbox.status = handler(applet_mailbox.command, applet_mailbox.data);
 			applet_initialized = (applet_mailbox.status == APPLET_SUCCESS);
 		} else if (applet_initialized) {
@@ -243,6 +250,31 @@ void applet_main(void)
 		} else {
 			trace_error_wp("Applet not initialized!\r\n");
 		}
+
+		if (applet_mailbox.command == APPLET_CMD_INITIALIZE ||
+		    applet_mailbox.command == APPLET_CMD_READ_INFO) {
+			union initialize_mailbox *mbx =
+				(union initialize_mailbox*)applet_mailbox.data;
+			if (applet_mailbox.status == APPLET_SUCCESS) {
+				mbx->out.buf_count = applet_stream_get_buffer_count();
+				applet_image_set_info((uint8_t*)mbx->out.buf_addr,
+						mbx->out.buf_size, mbx->out.page_size);
+			}
+		}
+	} else if (applet_is_image_command(applet_mailbox.command)) {
+		if (applet_initialized) {
+			applet_mailbox.status = applet_handle_image_command(
+					applet_mailbox.command, applet_mailbox.data);
+		} else {
+			trace_error_wp("Applet not initialized!\r\n");
+		}
+	} else if (applet_is_stream_command(applet_mailbox.command)) {
+		if (applet_initialized) {
+			applet_mailbox.status = applet_handle_stream_command(
+					applet_mailbox.command, applet_mailbox.data);
+		} else {
+			trace_error_wp("Applet not initialized!\r\n");
+		}
 	} else if (applet_is_legacy_command(applet_mailbox.command)) {
 		if (applet_initialized) {
 			applet_mailbox.status = applet_emulate_legacy_command(
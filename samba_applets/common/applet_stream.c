@@ -0,0 +1,292 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+#include <string.h>
+
+#include "applet.h"
+#include "applet_stream.h"
+#include "trace.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define STREAM_BUFFER_FREE    0
+#define STREAM_BUFFER_QUEUED  1
+#define STREAM_BUFFER_BUSY    2
+
+struct _stream_buffer {
+	uint8_t* data;
+	uint32_t state;
+	uint32_t seq;      /* queuing order */
+	uint32_t offset;   /* write offset, in bytes */
+	uint32_t length;   /* write length, in bytes */
+	uint32_t status;   /* status of the last write */
+	uint32_t pages;    /* pages written by the last write */
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static struct {
+	const struct applet_stream_ops* ops;
+	uint32_t count;
+	uint32_t size;
+	uint32_t page_size;
+	uint32_t seq;
+	struct _stream_buffer* current;
+	struct _stream_buffer buffers[APPLET_STREAM_BUFFERS];
+} _stream;
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static struct _stream_buffer* _stream_next_queued(void)
+{
+	struct _stream_buffer* next = NULL;
+	int i;
+
+	for (i = 0; i < _stream.count; i++) {
+		struct _stream_buffer* b = &_stream.buffers[i];
+
+		if (b->state != STREAM_BUFFER_QUEUED)
+			continue;
+		if (!next || (int32_t)(b->seq - next->seq) < 0)
+			next = b;
+	}
+
+	return next;
+}
+
+/* Complete the buffer being written if the memory is ready and start
+ * writing the next queued buffer */
+static void _stream_process(void)
+{
+	struct _stream_buffer* b;
+	int rc;
+
+	while (true) {
+		if (_stream.current) {
+			b = _stream.current;
+			rc = _stream.ops->poll();
+			if (rc > 0)
+				return;
+
+			if (rc < 0) {
+				trace_error("Write error at 0x%08x\r\n", (unsigned)b->offset);
+				b->status = APPLET_WRITE_FAIL;
+				b->pages = 0;
+			} else {
+				trace_info_wp("Wrote %u bytes at 0x%08x\r\n",
+						(unsigned)b->length, (unsigned)b->offset);
+				b->status = APPLET_SUCCESS;
+				b->pages = b->length / _stream.page_size;
+			}
+			b->state = STREAM_BUFFER_FREE;
+			_stream.current = NULL;
+		}
+
+		b = _stream_next_queued();
+		if (!b)
+			return;
+
+		rc = _stream.ops->write(b->offset, b->data, b->length);
+		if (rc < 0) {
+			trace_error("Write error at 0x%08x\r\n", (unsigned)b->offset);
+			b->status = APPLET_WRITE_FAIL;
+			b->pages = 0;
+			b->state = STREAM_BUFFER_FREE;
+			continue;
+		}
+		b->state = STREAM_BUFFER_BUSY;
+		_stream.current = b;
+	}
+}
+
+static bool _stream_has_free_buffer(void)
+{
+	int i;
+
+	for (i = 0; i < _stream.count; i++)
+		if (_stream.buffers[i].state == STREAM_BUFFER_FREE)
+			return true;
+
+	return false;
+}
+
+static uint32_t _stream_write_buffer(union stream_buffer_mailbox* mbx)
+{
+	uint32_t index = mbx->in.index;
+	struct _stream_buffer* b;
+
+	if (index >= _stream.count) {
+		trace_error("Invalid buffer index %u\r\n", (unsigned)index);
+		return APPLET_FAIL;
+	}
+	b = &_stream.buffers[index];
+
+	/* check that requested size does not overflow buffer, before
+	 * converting the page counts to bytes */
+	if (mbx->in.length == 0 ||
+	    mbx->in.length > _stream.size / _stream.page_size) {
+		trace_error("Buffer overflow\r\n");
+		return APPLET_FAIL;
+	}
+	if (mbx->in.offset > UINT32_MAX / _stream.page_size - mbx->in.length) {
+		trace_error("Invalid offset %u\r\n", (unsigned)mbx->in.offset);
+		return APPLET_FAIL;
+	}
+
+	_stream_process();
+	if (b->state != STREAM_BUFFER_FREE) {
+		trace_error("Buffer %u is busy\r\n", (unsigned)index);
+		return APPLET_FAIL;
+	}
+
+	b->offset = mbx->in.offset * _stream.page_size;
+	b->length = mbx->in.length * _stream.page_size;
+	b->seq = _stream.seq++;
+	b->state = STREAM_BUFFER_QUEUED;
+
+	/*
+	 * The applet gets neither interrupts nor CPU time between two
+	 * commands, and the host has nothing to fill until a buffer is free:
+	 * keep polling the memory until then, so that each page is started
+	 * as soon as the previous one is programmed.
+	 */
+	do {
+		_stream_process();
+	} while (!_stream_has_free_buffer());
+
+	mbx->out.state = b->state == STREAM_BUFFER_FREE ?
+		APPLET_BUFFER_FREE : APPLET_BUFFER_BUSY;
+	mbx->out.status = b->status;
+	mbx->out.pages = b->pages;
+
+	return APPLET_SUCCESS;
+}
+
+static uint32_t _stream_buffer_status(union stream_buffer_mailbox* mbx)
+{
+	uint32_t index = mbx->in.index;
+	struct _stream_buffer* b;
+
+	if (index >= _stream.count) {
+		trace_error("Invalid buffer index %u\r\n", (unsigned)index);
+		return APPLET_FAIL;
+	}
+	b = &_stream.buffers[index];
+
+	_stream_process();
+
+	mbx->out.state = b->state == STREAM_BUFFER_FREE ?
+		APPLET_BUFFER_FREE : APPLET_BUFFER_BUSY;
+	mbx->out.status = b->status;
+	mbx->out.pages = b->pages;
+
+	return APPLET_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ *         Public functions
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Split the applet buffer into streaming buffers.
+ * \param ops  asynchronous write operations, NULL to disable streaming
+ * \return the number of streaming buffers
+ */
+uint32_t applet_stream_setup(const struct applet_stream_ops* ops,
+		uint8_t* buffer, uint32_t size, uint32_t page_size)
+{
+	int i;
+
+	applet_stream_wait();
+	memset(&_stream, 0, sizeof(_stream));
+
+	if (!ops || !page_size)
+		return 0;
+
+	/* each buffer must hold at least one page */
+	_stream.size = (size / APPLET_STREAM_BUFFERS) & ~(page_size - 1);
+	if (_stream.size == 0)
+		return 0;
+
+	_stream.ops = ops;
+	_stream.count = APPLET_STREAM_BUFFERS;
+	_stream.page_size = page_size;
+	for (i = 0; i < _stream.count; i++) {
+		_stream.buffers[i].data = buffer + i * _stream.size;
+		_stream.buffers[i].status = APPLET_SUCCESS;
+	}
+
+	return _stream.count;
+}
+
+uint32_t applet_stream_get_buffer_count(void)
+{
+	return _stream.count;
+}
+
+/**
+ * \brief Complete all queued writes, must be called before the memory is
+ * accessed by the other commands.
+ */
+void applet_stream_wait(void)
+{
+	if (!_stream.ops)
+		return;
+
+	do {
+		_stream_process();
+	} while (_stream.current);
+}
+
+bool applet_is_stream_command(uint32_t cmd)
+{
+	return (cmd == APPLET_CMD_WRITE_BUFFER ||
+	        cmd == APPLET_CMD_BUFFER_STATUS);
+}
+
+uint32_t applet_handle_stream_command(uint32_t cmd, uint32_t *args)
+{
+	union stream_buffer_mailbox *mbx = (union stream_buffer_mailbox*)args;
+
+	if (!_stream.count) {
+		trace_error("Streaming buffers not supported\r\n");
+		return APPLET_FAIL;
+	}
+
+	if (cmd == APPLET_CMD_WRITE_BUFFER)
+		return _stream_write_buffer(mbx);
+	else
+		return _stream_buffer_status(mbx);
+}
@@ -0,0 +1,67 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef _APPLET_STREAM_H_
+#define _APPLET_STREAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*----------------------------------------------------------------------------
+ *         Global definitions
+ *----------------------------------------------------------------------------*/
+
+#define APPLET_STREAM_BUFFERS 2
+
+/**
+ * \brief Asynchronous write operations of the applet memory, used to program
+ * a streaming buffer while the host fills the next one.
+ */
+struct applet_stream_ops {
+	/** Start writing 'length' bytes from 'buffer' at 'offset' (in bytes),
+	 *  return 0 on success or a negative error code */
+	int (*write)(uint32_t offset, const uint8_t* buffer, uint32_t length);
+
+	/** Make progress on the write, return 1 while in progress, 0 when
+	 *  completed or a negative error code */
+	int (*poll)(void);
+};
+
+extern uint32_t applet_stream_setup(const struct applet_stream_ops* ops,
+		uint8_t* buffer, uint32_t size, uint32_t page_size);
+
+extern uint32_t applet_stream_get_buffer_count(void);
+
+extern void applet_stream_wait(void);
+
+extern bool applet_is_stream_command(uint32_t cmd);
+
+extern uint32_t applet_handle_stream_command(uint32_t cmd, uint32_t *args);
+
+#endif /* _APPLET_STREAM_H_ */
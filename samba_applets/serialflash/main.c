@@ -37,6 +37,7 @@
 #include <string.h>
 
 #include "applet.h"
+#include "applet_stream.h"
 #include "board.h"
 #include "chip.h"
 #include "gpio/pio.h"
@@ -84,6 +85,21 @@ static uint32_t erase_support;
  *         Local functions
  *----------------------------------------------------------------------------*/
 
+static int stream_write(uint32_t offset, const uint8_t* buf, uint32_t length)
+{
+	return spi_nor_write_async(&flash, offset, buf, length, NULL);
+}
+
+static int stream_poll(void)
+{
+	return spi_nor_poll(&flash);
+}
+
+static const struct applet_stream_ops stream_ops = {
+	.write = stream_write,
+	.poll = stream_poll,
+};
+
 static bool configure_instance_pio(uint32_t instance, uint32_t ioset,
 		uint32_t cs, Spi** addr)
 {
@@ -183,6 +199,9 @@ static uint32_t handle_cmd_initialize(uint32_t cmd, uint32_t *mailbox)
 	trace_warning_wp("Buffer Size: %u bytes\r\n",
 			 (unsigned)buffer_size);
 
+	/* program a half of the buffer while the host fills the other */
+	applet_stream_setup(&stream_ops, buffer, buffer_size, page_size);
+
 	mbx->out.buf_addr = (uint32_t)buffer;
 	mbx->out.buf_size = buffer_size;
 	mbx->out.page_size = page_size;
@@ -0,0 +1,201 @@
+#!/bin/sh
+# ----------------------------------------------------------------------------
+#                  Atmel Microcontroller Software Support
+# ----------------------------------------------------------------------------
+# Copyright (c) 2017, Atmel Corporation
+#
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following condition is met:
+#
+# - Redistributions of source code must retain the above copyright notice,
+# this list of conditions and the disclaimer below.
+#
+# Atmel's name may not be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# DISCLAIMER:  THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+# IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+# DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+# INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+# LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+# NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+# EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+# ----------------------------------------------------------------------------
+
+#
+# This script prints a per-section size report from a GNU ld map file and
+# checks that the hot symbols (interrupt entry, interrupt dispatch, DMA
+# completion handlers, memcpy/memset) do not execute from a slow memory
+# region such as the QSPI memory used for XIP.
+#
+# usage: map_report.sh [-c] [-r region] <map file> <nm output> [symbol...]
+#
+#   -c         exit with an error if a hot symbol is found in the slow region
+#   -r region  name of the slow memory region (default: qspi)
+#   symbol     additional hot symbols to check
+#
+# Functions are moved out of the slow region with the RAMFUNC attribute and
+# data with the FASTDATA attribute (see utils/compiler.h).
+
+check=0
+region=qspi
+while getopts "cr:" opt ; do
+	case $opt in
+	c) check=1 ;;
+	r) region=$OPTARG ;;
+	*) echo "usage: $0 [-c] [-r region] <map> <symbols> [symbol...]" >&2 ; exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -lt 2 ] ; then
+	echo "usage: $0 [-c] [-r region] <map> <symbols> [symbol...]" >&2
+	exit 2
+fi
+
+map=$1
+symbols=$2
+shift 2
+
+hot="irqHandler _default_irq_handler aic_get_current_interrupt_source \
+nvic_get_current_interrupt_source dma_irq_handler callback_call memcpy memset $*"
+
+awk -v check=$check -v slow=$region -v hot="$hot" -v symbols="$symbols" '
+function hex(s,    i, c, v) {
+	sub(/^0x/, "", s)
+	v = 0
+	for (i = 1; i <= length(s); i++) {
+		c = index("0123456789abcdef", tolower(substr(s, i, 1)))
+		if (c == 0)
+			break
+		v = v * 16 + c - 1
+	}
+	return v
+}
+
+function find_region(addr,    i) {
+	for (i = 0; i < nregions; i++)
+		if (addr >= origin[i] && addr < origin[i] + length_[i])
+			return i
+	return -1
+}
+
+function output_section(name, addr, size, load,    r, l) {
+	if (size == 0)
+		return
+	r = find_region(addr)
+	if (r < 0)
+		return
+	# initialized sections copied at startup also use their load region
+	if (load != "") {
+		l = find_region(hex(load))
+		if (l >= 0 && l != r)
+			used[l] += size
+	}
+	sections[nsections] = name
+	section_addr[nsections] = addr
+	section_size[nsections] = size
+	section_region[nsections] = r
+	nsections++
+	used[r] += size
+}
+
+function input_section(name, size) {
+	if (name ~ /^\.ramfunc/)
+		ramfunc += size
+	else if (name ~ /^\.fastdata/)
+		fastdata += size
+}
+
+BEGIN {
+	state = 0
+	nregions = 0
+	nsections = 0
+}
+
+/^Memory Configuration/ { state = 1; next }
+/^Linker script and memory map/ { state = 2; next }
+
+state == 1 && $1 != "Name" && $1 != "*default*" && NF >= 3 && $2 ~ /^0x/ {
+	name[nregions] = $1
+	origin[nregions] = hex($2)
+	length_[nregions] = hex($3)
+	nregions++
+	next
+}
+
+state == 2 {
+	# long section names are followed by a line holding address and size
+	if (pending != "") {
+		if ($1 ~ /^0x/ && NF >= 2) {
+			if (pending_input)
+				input_section(pending, hex($2))
+			else
+				output_section(pending, hex($1), hex($2), $3 == "load" ? $5 : "")
+		}
+		pending = ""
+		next
+	}
+	if ($0 ~ /^\.[^ ]+/) {
+		if (NF == 1) {
+			pending = $1
+			pending_input = 0
+		} else if ($2 ~ /^0x/ && $3 ~ /^0x/) {
+			output_section($1, hex($2), hex($3), $4 == "load" ? $6 : "")
+		}
+		next
+	}
+	if ($0 ~ /^ \.[^ ]+/) {
+		if (NF == 1) {
+			pending = $1
+			pending_input = 1
+		} else if ($2 ~ /^0x/ && $3 ~ /^0x/) {
+			input_section($1, hex($3))
+		}
+		next
+	}
+}
+
+END {
+	printf("%-16s %10s %10s %10s %6s\n", "Region", "Origin", "Size", "Used", "Usage")
+	for (i = 0; i < nregions; i++) {
+		if (used[i] == 0)
+			continue
+		printf("%-16s 0x%08x %10u %10u %5u%%\n", name[i], origin[i],
+		       length_[i], used[i], used[i] * 100 / length_[i])
+	}
+	printf("\n%-24s %-16s %10s %10s\n", "Section", "Region", "Address", "Size")
+	for (i = 0; i < nsections; i++)
+		printf("%-24s %-16s 0x%08x %10u\n", sections[i],
+		       name[section_region[i]], section_addr[i], section_size[i])
+	printf("\nRAMFUNC code: %u bytes, FASTDATA: %u bytes\n", ramfunc, fastdata)
+
+	for (i = 0; i < nregions; i++)
+		if (name[i] == slow)
+			slow_region = i
+	if (slow_region == "" || used[slow_region] == 0)
+		exit 0
+
+	n = split(hot, list, " ")
+	for (i = 1; i <= n; i++)
+		wanted[list[i]] = 1
+	errors = 0
+	while ((getline line < symbols) > 0) {
+		split(line, f, " ")
+		if (!(f[3] in wanted) || f[2] !~ /^[TtWw]$/)
+			continue
+		if (find_region(hex(f[1])) == slow_region) {
+			printf("warning: hot symbol %s executes from %s (0x%s)\n",
+			       f[3], slow, f[1])
+			errors++
+		}
+	}
+	if (errors && check)
+		exit 1
+}
+' "$map"
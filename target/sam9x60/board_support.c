@@ -495,8 +495,17 @@ void board_cfg_ddram(void)
 #ifdef BOARD_DDRAM_TYPE
 	struct _mpddrc_desc desc;
 	ddram_init_descriptor(&desc, BOARD_DDRAM_TYPE);
+#ifdef BOARD_DDRAM_SAVED_CONFIG
+	/* reuse the setup validated on a previous boot; a failed bus test
+	 * leaves the DDRAM unusable, so stop here: the saved setup has been
+	 * invalidated and the next boot configures and tests it again */
+	if (ddram_configure_cached(&desc, BOARD_DDRAM_SAVED_CONFIG,
+				   BOARD_DDR_MEMORY_SIZE) < 0)
+		trace_fatal("DDRAM bus test failed\r\n");
+#else
 	ddram_configure(&desc);
 #endif
+#endif
 #ifdef BOARD_SDRAM_TYPE
 	struct _sdramc_desc desc;
 	sdram_init_descriptor(&desc, BOARD_DDRAM_TYPE);
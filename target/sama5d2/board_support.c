@@ -40,6 +40,7 @@
 #include "string.h"
 #include "board.h"
 #include "board_timer.h"
+#include "boot_profile.h"
 #include "trace.h"
 #include "intmath.h"
 
@@ -185,17 +186,20 @@ void board_cfg_lowlevel(bool clocks, bool ddram, bool mmu)
 
 	/* Configure system timer */
 	board_cfg_timer();
+	boot_profile_mark("timer");
 
 	board_cfg_matrix_default();
 
 	if (ddram) {
 		/* Configure DDRAM */
 		board_cfg_ddram();
+		boot_profile_mark("ddram");
 	}
 
 	if (mmu) {
 		/* Setup MMU */
 		board_cfg_mmu();
+		boot_profile_mark("mmu");
 	}
 }
 
@@ -573,8 +577,17 @@ void board_cfg_ddram(void)
 	board_cfg_matrix_for_ddr();
 	struct _mpddrc_desc desc;
 	ddram_init_descriptor(&desc, BOARD_DDRAM_TYPE);
+#ifdef BOARD_DDRAM_SAVED_CONFIG
+	/* reuse the setup validated on a previous boot; a failed bus test
+	 * leaves the DDRAM unusable, so stop here: the saved setup has been
+	 * invalidated and the next boot configures and tests it again */
+	if (ddram_configure_cached(&desc, BOARD_DDRAM_SAVED_CONFIG,
+				   BOARD_DDR_MEMORY_SIZE) < 0)
+		trace_fatal("DDRAM bus test failed\r\n");
+#else
 	ddram_configure(&desc);
 #endif
+#endif
 }
 
 #ifdef CONFIG_HAVE_NAND_FLASH
@@ -740,6 +753,7 @@ void board_cfg_pmic(void)
 		goto Fail;
 #endif
 	act8945a_initialized = true;
+	boot_profile_mark("pmic");
 	return;
 
 Fail:
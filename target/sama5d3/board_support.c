@@ -476,8 +476,17 @@ void board_cfg_ddram(void)
 	board_cfg_matrix_for_ddr();
 	struct _mpddrc_desc desc;
 	ddram_init_descriptor(&desc, BOARD_DDRAM_TYPE);
+#ifdef BOARD_DDRAM_SAVED_CONFIG
+	/* reuse the setup validated on a previous boot; a failed bus test
+	 * leaves the DDRAM unusable, so stop here: the saved setup has been
+	 * invalidated and the next boot configures and tests it again */
+	if (ddram_configure_cached(&desc, BOARD_DDRAM_SAVED_CONFIG,
+				   BOARD_DDR_MEMORY_SIZE) < 0)
+		trace_fatal("DDRAM bus test failed\r\n");
+#else
 	ddram_configure(&desc);
 #endif
+#endif
 }
 
 void board_cfg_nand_flash(void)
@@ -0,0 +1,121 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/* Host stand-in for the chip header: only the definitions used by the
+ * modules under test. The internal flash, the SHA, the ISC, the LCDC, the
+ * PDMIC and the MCAN registers are provided by the test. */
+
+#ifndef _CHIP_H_
+#define _CHIP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "compiler.h"
+#include "component/component_eefc.h"
+#ifdef CONFIG_HAVE_XDMAC
+#include "component/component_xdmac.h"
+#endif
+#ifdef CONFIG_HAVE_SHA
+#include "component/component_sha.h"
+#endif
+#ifdef CONFIG_HAVE_I2C_BUS
+#include "component/component_twi.h"
+#endif
+#ifdef CONFIG_HAVE_SPI_BUS
+#include "component/component_spi.h"
+#endif
+#ifdef CONFIG_HAVE_ISC
+#include "component/component_isc.h"
+#endif
+#ifdef CONFIG_HAVE_LCDC
+#include "component/component_lcdc.h"
+#endif
+#ifdef CONFIG_HAVE_PDMIC
+#include "component/component_pdmic.h"
+#endif
+#ifdef CONFIG_HAVE_MCAN
+#include "component/component_matrix.h"
+#include "component/component_mcan.h"
+#include "component/component_pmc.h"
+#endif
+
+#define L1_CACHE_BYTES 32
+
+typedef struct _tc Tc;
+
+#define ID_EFC 6
+
+extern uint8_t test_iflash[];
+#define IFLASH_ADDR ((uintptr_t)test_iflash)
+
+#ifdef CONFIG_HAVE_SHA
+#define ID_SHA 12
+extern Sha test_sha;
+#define SHA (&test_sha)
+#endif
+
+#ifdef CONFIG_HAVE_ISC
+#define ID_ISC 46
+extern Isc test_isc;
+#define ISC (&test_isc)
+#endif
+
+#ifdef CONFIG_HAVE_LCDC
+#define ID_LCDC 45
+extern Lcdc test_lcdc;
+#define LCDC (&test_lcdc)
+#endif
+
+#ifdef CONFIG_HAVE_PDMIC
+#define ID_PDMIC 48
+extern Pdmic test_pdmic;
+#define PDMIC (&test_pdmic)
+extern uint32_t get_pdmic_id_from_addr(const Pdmic* addr);
+/* generated clock source, from the SAMA5D2 PMC */
+#define PMC_PCR_GCKCSS_PLLA_CLK (0x2u << 8)
+#endif
+
+#ifdef CONFIG_HAVE_MCAN
+#define ID_MCAN0_INT0 35
+#define ID_MCAN0_INT1 36
+#define ID_MCAN1_INT0 37
+#define ID_MCAN1_INT1 38
+#define ID_PERIPH_COUNT 64
+#define CAN_IFACE_COUNT 2
+#define PMC_PCK_CAN 5
+extern Matrix test_matrix;
+#define MATRIX (&test_matrix)
+extern Mcan test_mcan[CAN_IFACE_COUNT];
+#define MCAN0 (&test_mcan[0])
+#define MCAN1 (&test_mcan[1])
+extern uint32_t get_mcan_id_from_addr(const Mcan* addr, uint8_t int_idx);
+#endif
+
+#endif /* _CHIP_H_ */
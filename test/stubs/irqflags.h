@@ -0,0 +1,75 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/* Host stand-in for the interrupt mask: the mask state is a variable
+ * provided by the test. With TEST_IRQ_THREADS, interrupts are host threads
+ * and the test provides the functions, masking is then a lock shared with
+ * these threads. */
+
+#ifndef IRQFLAGS_H_
+#define IRQFLAGS_H_
+
+#include <stdint.h>
+
+#ifdef TEST_IRQ_THREADS
+
+extern uint32_t arch_irq_save(void);
+
+extern void arch_irq_restore(uint32_t flags);
+
+#else /* !TEST_IRQ_THREADS */
+
+extern uint32_t test_irq_disabled;
+
+static inline void arch_irq_enable(void)
+{
+	test_irq_disabled = 0;
+}
+
+static inline void arch_irq_disable(void)
+{
+	test_irq_disabled = 1;
+}
+
+static inline uint32_t arch_irq_save(void)
+{
+	uint32_t flags = test_irq_disabled;
+
+	test_irq_disabled = 1;
+	return flags;
+}
+
+static inline void arch_irq_restore(uint32_t flags)
+{
+	test_irq_disabled = flags;
+}
+
+#endif /* !TEST_IRQ_THREADS */
+
+#endif /* IRQFLAGS_H_ */
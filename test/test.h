@@ -0,0 +1,78 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Minimal helpers shared by the host unit tests: a failed check prints its
+ * location and exits with a non-zero status.
+ */
+
+#ifndef _TEST_H_
+#define _TEST_H_
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*----------------------------------------------------------------------------
+ *         Definitions
+ *----------------------------------------------------------------------------*/
+
+#define TEST_ASSERT(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", \
+			       __FILE__, __LINE__, #cond); \
+			exit(1); \
+		} \
+	} while (0)
+
+#define TEST_ASSERT_EQUAL(expected, actual) \
+	do { \
+		long long _e = (long long)(expected); \
+		long long _a = (long long)(actual); \
+		if (_e != _a) { \
+			printf("%s:%d: %s is %lld, expected %lld\n", \
+			       __FILE__, __LINE__, #actual, _a, _e); \
+			exit(1); \
+		} \
+	} while (0)
+
+#define TEST_RUN(fn) \
+	do { \
+		fn(); \
+		printf("  %s\n", #fn); \
+	} while (0)
+
+#endif /* _TEST_H_ */
@@ -0,0 +1,346 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the streaming write commands of the SAM-BA applets. The
+ * tests play the host side of the protocol through the mailbox of the 'write
+ * buffer' and 'buffer status' commands. The memory is simulated: a write
+ * started by the applet programs one page per poll, and the data of a page
+ * is only read from the applet buffer when the page is programmed, so that a
+ * buffer reused too early shows up in the memory content.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "applet.h"
+#include "applet_stream.h"
+#include "test.h"
+#include "trace.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define PAGE_SIZE 256
+#define BUFFER_SIZE (2 * 16 * PAGE_SIZE + 100)
+#define BUFFER_PAGES 16
+#define MEM_PAGES 1024
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+static uint8_t _buffer[BUFFER_SIZE];
+
+/* simulated memory */
+static uint8_t _mem[MEM_PAGES * PAGE_SIZE];
+static const uint8_t* _src;
+static uint32_t _offset;
+static uint32_t _remaining;
+static uint32_t _writes;
+static uint32_t _polls;
+static int _write_error;
+static int _poll_error;
+static uint32_t _errors;
+
+/*----------------------------------------------------------------------------
+ *         Simulated memory
+ *----------------------------------------------------------------------------*/
+
+static int _sim_write(uint32_t offset, const uint8_t* buffer, uint32_t length)
+{
+	if (_remaining)
+		_errors++;
+	if (offset % PAGE_SIZE || length % PAGE_SIZE) {
+		_errors++;
+		return -1;
+	}
+	_writes++;
+	if (offset >= sizeof(_mem) || length > sizeof(_mem) - offset)
+		return -1;
+	if (_write_error)
+		return _write_error;
+
+	_src = buffer;
+	_offset = offset;
+	_remaining = length;
+	return 0;
+}
+
+static int _sim_poll(void)
+{
+	if (!_remaining)
+		return 0;
+
+	_polls++;
+	if (_poll_error) {
+		_remaining = 0;
+		return _poll_error;
+	}
+
+	/* one page per poll, read from the buffer now */
+	memcpy(&_mem[_offset], _src, PAGE_SIZE);
+	_src += PAGE_SIZE;
+	_offset += PAGE_SIZE;
+	_remaining -= PAGE_SIZE;
+	return _remaining ? 1 : 0;
+}
+
+static const struct applet_stream_ops _ops = {
+	.write = _sim_write,
+	.poll = _sim_poll,
+};
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static void _setup(void)
+{
+	memset(_mem, 0xff, sizeof(_mem));
+	_remaining = 0;
+	_writes = 0;
+	_polls = 0;
+	_write_error = 0;
+	_poll_error = 0;
+	_errors = 0;
+	TEST_ASSERT_EQUAL(APPLET_STREAM_BUFFERS,
+			  applet_stream_setup(&_ops, _buffer, sizeof(_buffer), PAGE_SIZE));
+}
+
+static uint32_t _write_buffer(uint32_t index, uint32_t offset, uint32_t length,
+			      union stream_buffer_mailbox* mbx)
+{
+	mbx->in.index = index;
+	mbx->in.offset = offset;
+	mbx->in.length = length;
+	return applet_handle_stream_command(APPLET_CMD_WRITE_BUFFER, (uint32_t*)mbx);
+}
+
+static uint32_t _buffer_status(uint32_t index, union stream_buffer_mailbox* mbx)
+{
+	mbx->in.index = index;
+	return applet_handle_stream_command(APPLET_CMD_BUFFER_STATUS, (uint32_t*)mbx);
+}
+
+static uint8_t* _host_buffer(uint32_t index)
+{
+	return &_buffer[index * BUFFER_PAGES * PAGE_SIZE];
+}
+
+static void _host_fill(uint32_t index, uint32_t page, uint32_t pages)
+{
+	uint8_t* data = _host_buffer(index);
+	uint32_t i;
+
+	for (i = 0; i < pages * PAGE_SIZE; i++)
+		data[i] = (page * PAGE_SIZE + i) * 31 + 7;
+}
+
+static bool _mem_check(uint32_t page, uint32_t pages)
+{
+	uint32_t i;
+
+	for (i = 0; i < pages * PAGE_SIZE; i++)
+		if (_mem[page * PAGE_SIZE + i] != (uint8_t)((page * PAGE_SIZE + i) * 31 + 7))
+			return false;
+	return true;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_setup(void)
+{
+	/* whole pages per buffer */
+	TEST_ASSERT_EQUAL(0, applet_stream_setup(NULL, _buffer, sizeof(_buffer), PAGE_SIZE));
+	TEST_ASSERT_EQUAL(0, applet_stream_get_buffer_count());
+	TEST_ASSERT_EQUAL(0, applet_stream_setup(&_ops, _buffer, PAGE_SIZE, PAGE_SIZE));
+	TEST_ASSERT(applet_is_stream_command(APPLET_CMD_WRITE_BUFFER));
+	TEST_ASSERT(applet_is_stream_command(APPLET_CMD_BUFFER_STATUS));
+	TEST_ASSERT(!applet_is_stream_command(APPLET_CMD_WRITE_PAGES));
+
+	/* rejected when streaming is not set up */
+	{
+		union stream_buffer_mailbox mbx;
+
+		TEST_ASSERT_EQUAL(APPLET_FAIL, _write_buffer(0, 0, 1, &mbx));
+	}
+
+	_setup();
+	TEST_ASSERT_EQUAL(APPLET_STREAM_BUFFERS, applet_stream_get_buffer_count());
+}
+
+static void test_double_buffering(void)
+{
+	union stream_buffer_mailbox mbx;
+
+	_setup();
+
+	/* the first buffer is written while the host fills the second one */
+	_host_fill(0, 4, BUFFER_PAGES);
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS, _write_buffer(0, 4, BUFFER_PAGES, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_BUFFER_BUSY, mbx.out.state);
+	TEST_ASSERT_EQUAL(1, _writes);
+	TEST_ASSERT(_remaining > 0);
+
+	/* no buffer left for the host: the first one is completed */
+	_host_fill(1, 4 + BUFFER_PAGES, 8);
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS, _write_buffer(1, 4 + BUFFER_PAGES, 8, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_BUFFER_BUSY, mbx.out.state);
+	TEST_ASSERT_EQUAL(2, _writes);
+	TEST_ASSERT(_mem_check(4, BUFFER_PAGES));
+
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS, _buffer_status(0, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_BUFFER_FREE, mbx.out.state);
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS, mbx.out.status);
+	TEST_ASSERT_EQUAL(BUFFER_PAGES, mbx.out.pages);
+
+	/* a busy buffer is not written again */
+	TEST_ASSERT_EQUAL(APPLET_FAIL, _write_buffer(1, 0, 1, &mbx));
+
+	/* 'buffer status' makes progress, one page per command here */
+	do {
+		TEST_ASSERT_EQUAL(APPLET_SUCCESS, _buffer_status(1, &mbx));
+	} while (mbx.out.state == APPLET_BUFFER_BUSY);
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS, mbx.out.status);
+	TEST_ASSERT_EQUAL(8, mbx.out.pages);
+	TEST_ASSERT(_mem_check(4 + BUFFER_PAGES, 8));
+	TEST_ASSERT_EQUAL(0xff, _mem[4 * PAGE_SIZE - 1]);
+	TEST_ASSERT_EQUAL(0xff, _mem[(4 + BUFFER_PAGES + 8) * PAGE_SIZE]);
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_stream(void)
+{
+	union stream_buffer_mailbox mbx;
+	uint32_t page, index = 0;
+
+	_setup();
+
+	/* the host refills a buffer as soon as 'write buffer' returns */
+	for (page = 0; page < MEM_PAGES; page += BUFFER_PAGES) {
+		_host_fill(index, page, BUFFER_PAGES);
+		TEST_ASSERT_EQUAL(APPLET_SUCCESS, _write_buffer(index, page, BUFFER_PAGES, &mbx));
+		index = (index + 1) % APPLET_STREAM_BUFFERS;
+		TEST_ASSERT_EQUAL(APPLET_SUCCESS, _buffer_status(index, &mbx));
+		TEST_ASSERT_EQUAL(APPLET_BUFFER_FREE, mbx.out.state);
+		TEST_ASSERT_EQUAL(APPLET_SUCCESS, mbx.out.status);
+	}
+
+	/* the other commands wait for the end of the writes */
+	applet_stream_wait();
+	TEST_ASSERT_EQUAL(0, _remaining);
+	TEST_ASSERT_EQUAL(MEM_PAGES / BUFFER_PAGES, _writes);
+	TEST_ASSERT_EQUAL(MEM_PAGES, _polls);
+	TEST_ASSERT(_mem_check(0, MEM_PAGES));
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_invalid_requests(void)
+{
+	union stream_buffer_mailbox mbx;
+
+	_setup();
+
+	TEST_ASSERT_EQUAL(APPLET_FAIL, _write_buffer(APPLET_STREAM_BUFFERS, 0, 1, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_FAIL, _buffer_status(APPLET_STREAM_BUFFERS, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_FAIL, _write_buffer(0, 0, 0, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_FAIL, _write_buffer(0, 0, BUFFER_PAGES + 1, &mbx));
+
+	/* page counts that wrap around once converted to bytes */
+	TEST_ASSERT_EQUAL(APPLET_FAIL, _write_buffer(0, 0, UINT32_MAX / PAGE_SIZE + 2, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_FAIL, _write_buffer(0, UINT32_MAX / PAGE_SIZE, 1, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_FAIL, _write_buffer(0, UINT32_MAX / PAGE_SIZE + 1, 1, &mbx));
+	TEST_ASSERT_EQUAL(0, _writes);
+
+	/* the last page of the address space, beyond the memory */
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS,
+			  _write_buffer(0, UINT32_MAX / PAGE_SIZE - 1, 1, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_WRITE_FAIL, mbx.out.status);
+	TEST_ASSERT_EQUAL(1, _writes);
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_write_errors(void)
+{
+	union stream_buffer_mailbox mbx;
+
+	_setup();
+
+	/* a write that cannot start frees its buffer */
+	_write_error = -1;
+	_host_fill(0, 0, 1);
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS, _write_buffer(0, 0, 1, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_BUFFER_FREE, mbx.out.state);
+	TEST_ASSERT_EQUAL(APPLET_WRITE_FAIL, mbx.out.status);
+	TEST_ASSERT_EQUAL(0, mbx.out.pages);
+
+	/* a write failing later reports no page written */
+	_write_error = 0;
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS, _write_buffer(0, 0, 4, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_BUFFER_BUSY, mbx.out.state);
+	_poll_error = -1;
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS, _buffer_status(0, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_BUFFER_FREE, mbx.out.state);
+	TEST_ASSERT_EQUAL(APPLET_WRITE_FAIL, mbx.out.status);
+	TEST_ASSERT_EQUAL(0, mbx.out.pages);
+
+	/* and does not stop the next one */
+	_poll_error = 0;
+	_host_fill(1, 8, 2);
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS, _write_buffer(1, 8, 2, &mbx));
+	applet_stream_wait();
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS, _buffer_status(1, &mbx));
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS, mbx.out.status);
+	TEST_ASSERT_EQUAL(2, mbx.out.pages);
+	TEST_ASSERT(_mem_check(8, 2));
+}
+
+int main(void)
+{
+	TEST_RUN(test_setup);
+	TEST_RUN(test_double_buffering);
+	TEST_RUN(test_stream);
+	TEST_RUN(test_invalid_requests);
+	TEST_RUN(test_write_errors);
+	return 0;
+}
@@ -0,0 +1,491 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the AT24 EEPROM driver against a simulated AT24C256 on the
+ * I2C bus. A page write starts the internal write cycle on STOP. During the
+ * write cycle the EEPROM does not acknowledge its address, like the real
+ * device. Each bus transfer advances a simulated microsecond clock by its
+ * duration at 400kHz, and the timer mocks read that clock.
+ *
+ * The tests check the ACK polling of the end of the write cycles, the page
+ * split of writes, the write cycle timeout, the asynchronous writes driven by
+ * at24_poll(), and the write-back page cache: repeated updates of a page are
+ * merged into one page write, and reads and writes stay coherent with it.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "callback.h"
+#include "chip.h"
+#include "errno.h"
+#include "intmath.h"
+#include "test.h"
+#include "timer.h"
+#include "trace.h"
+
+#include "nvm/i2c/at24.h"
+#include "peripherals/bus.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define EEPROM_ADDR 0x50
+#define EEPROM_SIZE 32768
+#define PAGE_SIZE 64
+
+/* write cycle of the simulated EEPROM, and the driver timeout */
+#define WRITE_CYCLE 4000
+#define WRITE_TIMEOUT 20000
+
+/* one byte on the bus at 400kHz, with its acknowledge */
+#define BYTE_TIME 23
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+/* simulated clock, in microseconds */
+static uint64_t _now;
+
+/* EEPROM model */
+static uint8_t _mem[EEPROM_SIZE];
+static uint64_t _busy_until;
+/* the write cycles never end */
+static bool _stuck;
+static uint32_t _page_writes;
+static uint32_t _bytes_written;
+static uint32_t _nacks;
+static uint32_t _errors;
+static bool _in_transaction;
+
+/* completion callback */
+static uint32_t _cb_count;
+static int _cb_rc;
+
+static struct _at24 _at24;
+
+/*----------------------------------------------------------------------------
+ *         Simulated EEPROM
+ *----------------------------------------------------------------------------*/
+
+static void _sim_reset(void)
+{
+	memset(_mem, 0xff, sizeof(_mem));
+	_now = 1000000;
+	_busy_until = 0;
+	_stuck = false;
+	_page_writes = 0;
+	_bytes_written = 0;
+	_nacks = 0;
+	_errors = 0;
+	_in_transaction = false;
+	_cb_count = 0;
+	_cb_rc = 1;
+}
+
+static bool _sim_busy(void)
+{
+	return _now < _busy_until;
+}
+
+/* bytes after the memory address wrap around in the page */
+static void _sim_write(uint32_t addr, const uint8_t* data, uint32_t len)
+{
+	uint32_t page = addr & ~(PAGE_SIZE - 1);
+	uint32_t i;
+
+	if (len > PAGE_SIZE || (addr & (PAGE_SIZE - 1)) + len > PAGE_SIZE)
+		_errors++;
+	for (i = 0; i < len; i++)
+		_mem[page + ((addr + i) & (PAGE_SIZE - 1))] = data[i];
+
+	_page_writes++;
+	_bytes_written += len;
+	_busy_until = _stuck ? UINT64_MAX : _now + WRITE_CYCLE;
+}
+
+/*----------------------------------------------------------------------------
+ *         Mocks
+ *----------------------------------------------------------------------------*/
+
+int bus_start_transaction(uint8_t bus_id)
+{
+	TEST_ASSERT(!_in_transaction);
+	_in_transaction = true;
+	return 0;
+}
+
+int bus_stop_transaction(uint8_t bus_id)
+{
+	TEST_ASSERT(_in_transaction);
+	_in_transaction = false;
+	return 0;
+}
+
+int bus_transfer(uint8_t bus_id, uint16_t remote, struct _buffer* buf, uint16_t buffers, struct _callback* cb)
+{
+	uint32_t addr, i;
+
+	TEST_ASSERT(_in_transaction);
+	TEST_ASSERT_EQUAL(EEPROM_ADDR, remote);
+	TEST_ASSERT(buf[0].attr & BUS_I2C_BUF_ATTR_START);
+	TEST_ASSERT(buf[0].attr & BUS_BUF_ATTR_TX);
+	TEST_ASSERT(buf[buffers - 1].attr & BUS_I2C_BUF_ATTR_STOP);
+
+	/* device address */
+	_now += BYTE_TIME;
+	if (_sim_busy()) {
+		_nacks++;
+		return -ECONNABORTED;
+	}
+
+	for (i = 0; i < buffers; i++)
+		_now += buf[i].size * BYTE_TIME;
+
+	/* the first byte of the memory address alone: no side effect */
+	if (buffers == 1) {
+		TEST_ASSERT_EQUAL(1, buf[0].size);
+		return 0;
+	}
+
+	TEST_ASSERT_EQUAL(2, buf[0].size);
+	addr = ((buf[0].data[0] << 8) | buf[0].data[1]) & (EEPROM_SIZE - 1);
+
+	if (buf[1].attr & BUS_BUF_ATTR_RX) {
+		/* sequential read, wrapping at the end of the memory */
+		for (i = 0; i < buf[1].size; i++)
+			buf[1].data[i] = _mem[(addr + i) & (EEPROM_SIZE - 1)];
+	} else {
+		_sim_write(addr, buf[1].data, buf[1].size);
+	}
+	return 0;
+}
+
+uint64_t timer_get_interval(uint64_t start, uint64_t end)
+{
+	return end - start;
+}
+
+uint64_t timer_get_tick(void)
+{
+	return _now / 1000;
+}
+
+void usleep(uint32_t count)
+{
+	_now += count;
+}
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static int _done(void* arg, void* arg2)
+{
+	_cb_count++;
+	_cb_rc = (int)(intptr_t)arg2;
+	return 0;
+}
+
+static void _configure(void)
+{
+	struct _at24_config cfg = {
+		.bus = 0,
+		.addr = EEPROM_ADDR,
+		.model = AT24C256,
+	};
+
+	_sim_reset();
+	memset(&_at24, 0xa5, sizeof(_at24));
+	TEST_ASSERT_EQUAL(0, at24_configure(&_at24, &cfg));
+}
+
+/* poll every 500us until the completion callback */
+static void _poll_until_done(void)
+{
+	uint32_t polls = 0;
+
+	while (!_cb_count) {
+		TEST_ASSERT(polls < 100000);
+		at24_poll(&_at24);
+		_now += 500;
+		polls++;
+	}
+}
+
+static void _fill(uint8_t* buf, uint32_t len, uint8_t seed)
+{
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = seed + i * 13;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_configure(void)
+{
+	struct _at24_config cfg = {
+		.addr = EEPROM_ADDR + 1,
+		.model = AT24C1024,
+	};
+
+	/* A0 is the block select bit of the 128KB devices */
+	memset(&_at24, 0, sizeof(_at24));
+	TEST_ASSERT_EQUAL(-ENODEV, at24_configure(&_at24, &cfg));
+	cfg.addr = EEPROM_ADDR + 2;
+	TEST_ASSERT_EQUAL(0, at24_configure(&_at24, &cfg));
+	cfg.model = 0xff;
+	TEST_ASSERT_EQUAL(-ENOTSUP, at24_configure(&_at24, &cfg));
+}
+
+static void test_ack_polling(void)
+{
+	uint8_t data[PAGE_SIZE], check[PAGE_SIZE];
+	uint64_t start;
+
+	_configure();
+	_fill(data, sizeof(data), 1);
+
+	/* done at the end of the write cycle, not after a fixed delay */
+	start = _now;
+	TEST_ASSERT_EQUAL(0, at24_write(&_at24, 0x1000, data, sizeof(data)));
+	TEST_ASSERT_EQUAL(1, _page_writes);
+	TEST_ASSERT(_nacks > 0);
+	TEST_ASSERT(_now - start >= WRITE_CYCLE);
+	TEST_ASSERT(_now - start <= WRITE_CYCLE + (PAGE_SIZE + 8) * BYTE_TIME);
+
+	TEST_ASSERT_EQUAL(0, at24_read(&_at24, 0x1000, check, sizeof(check)));
+	TEST_ASSERT(!memcmp(data, check, sizeof(data)));
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_write_pages(void)
+{
+	static uint8_t data[200], check[200];
+	uint64_t start;
+
+	_configure();
+	_fill(data, sizeof(data), 3);
+
+	/* 16 + 64 + 64 + 56 bytes, one write cycle each */
+	start = _now;
+	TEST_ASSERT_EQUAL(0, at24_write(&_at24, 0x30, data, sizeof(data)));
+	TEST_ASSERT_EQUAL(4, _page_writes);
+	TEST_ASSERT(_now - start <= 4 * (WRITE_CYCLE + 8 * BYTE_TIME) +
+		    sizeof(data) * BYTE_TIME);
+
+	TEST_ASSERT_EQUAL(0, at24_read(&_at24, 0x30, check, sizeof(check)));
+	TEST_ASSERT(!memcmp(data, check, sizeof(data)));
+	TEST_ASSERT_EQUAL(0xff, _mem[0x2f]);
+	TEST_ASSERT_EQUAL(0xff, _mem[0x30 + sizeof(data)]);
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_write_timeout(void)
+{
+	uint8_t data[8] = { 0 };
+	uint64_t start;
+
+	_configure();
+
+	_stuck = true;
+	start = _now;
+	TEST_ASSERT_EQUAL(-ETIMEDOUT, at24_write(&_at24, 0, data, sizeof(data)));
+	TEST_ASSERT(_now - start >= WRITE_TIMEOUT);
+	TEST_ASSERT(_now - start <= WRITE_TIMEOUT + 2000);
+	TEST_ASSERT_EQUAL(1, _page_writes);
+
+	/* the next page write is not acknowledged */
+	TEST_ASSERT_EQUAL(-ECONNABORTED, at24_write(&_at24, 8, data, sizeof(data)));
+	TEST_ASSERT_EQUAL(1, _page_writes);
+}
+
+static void test_async_write(void)
+{
+	static uint8_t data[300], check[300];
+	struct _callback cb;
+	uint64_t start;
+
+	_configure();
+	_fill(data, sizeof(data), 5);
+	callback_set(&cb, _done, NULL);
+
+	start = _now;
+	TEST_ASSERT_EQUAL(0, at24_write_async(&_at24, 0x20, data, sizeof(data), &cb));
+	TEST_ASSERT_EQUAL(1, _page_writes);
+	TEST_ASSERT_EQUAL(-EBUSY, at24_write_async(&_at24, 0, data, 1, &cb));
+	TEST_ASSERT_EQUAL(-EBUSY, at24_read(&_at24, 0x20, check, 1));
+	TEST_ASSERT_EQUAL(-EBUSY, at24_write(&_at24, 0x20, data, 1));
+
+	/* 32 + 4 * 64 + 12 bytes, the next page sent at the first poll
+	 * after each write cycle */
+	_poll_until_done();
+	TEST_ASSERT_EQUAL(1, _cb_count);
+	TEST_ASSERT_EQUAL(0, _cb_rc);
+	TEST_ASSERT_EQUAL(6, _page_writes);
+	TEST_ASSERT(_now - start <= 6 * (WRITE_CYCLE + 500 + 8 * BYTE_TIME) +
+		    sizeof(data) * BYTE_TIME);
+	TEST_ASSERT_EQUAL(0, at24_poll(&_at24));
+
+	TEST_ASSERT_EQUAL(0, at24_read(&_at24, 0x20, check, sizeof(check)));
+	TEST_ASSERT(!memcmp(data, check, sizeof(data)));
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_async_timeout(void)
+{
+	uint8_t data[8] = { 0 };
+	struct _callback cb;
+	uint64_t start;
+
+	_configure();
+	callback_set(&cb, _done, NULL);
+
+	start = _now;
+	_stuck = true;
+	TEST_ASSERT_EQUAL(0, at24_write_async(&_at24, 0, data, sizeof(data), &cb));
+	_poll_until_done();
+	TEST_ASSERT_EQUAL(-ETIMEDOUT, _cb_rc);
+	TEST_ASSERT(_now - start >= WRITE_TIMEOUT);
+	TEST_ASSERT(_now - start <= WRITE_TIMEOUT + 2000);
+	TEST_ASSERT_EQUAL(0, at24_poll(&_at24));
+}
+
+static void test_cache_coalescing(void)
+{
+	static uint8_t lines[2 * PAGE_SIZE];
+	uint32_t i, counter, check;
+
+	_configure();
+	TEST_ASSERT_EQUAL(0, at24_set_cache(&_at24, lines, sizeof(lines)));
+
+	/* a counter updated a hundred times: a single page write on flush */
+	for (i = 0; i < 100; i++) {
+		counter = i;
+		TEST_ASSERT_EQUAL(0, at24_write_cached(&_at24, 0x104, (uint8_t*)&counter, sizeof(counter)));
+		TEST_ASSERT_EQUAL(0, at24_read(&_at24, 0x104, (uint8_t*)&check, sizeof(check)));
+		TEST_ASSERT_EQUAL(i, check);
+	}
+	TEST_ASSERT_EQUAL(0, _page_writes);
+	TEST_ASSERT_EQUAL(0xff, _mem[0x104]);
+
+	TEST_ASSERT_EQUAL(0, at24_flush(&_at24));
+	TEST_ASSERT_EQUAL(1, _page_writes);
+	TEST_ASSERT_EQUAL(sizeof(counter), _bytes_written);
+	memcpy(&check, &_mem[0x104], sizeof(check));
+	TEST_ASSERT_EQUAL(99, check);
+
+	/* clean pages are not written again */
+	TEST_ASSERT_EQUAL(0, at24_flush(&_at24));
+	TEST_ASSERT_EQUAL(1, _page_writes);
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_cache_eviction(void)
+{
+	static uint8_t lines[2 * PAGE_SIZE];
+	uint8_t a = 0x11, b = 0x22, c = 0x33;
+
+	_configure();
+	TEST_ASSERT_EQUAL(0, at24_set_cache(&_at24, lines, sizeof(lines)));
+
+	/* the least recently used page is written back for a third one */
+	TEST_ASSERT_EQUAL(0, at24_write_cached(&_at24, 0x000, &a, 1));
+	TEST_ASSERT_EQUAL(0, at24_write_cached(&_at24, 0x040, &b, 1));
+	TEST_ASSERT_EQUAL(0, at24_write_cached(&_at24, 0x001, &a, 1));
+	TEST_ASSERT_EQUAL(0, _page_writes);
+	TEST_ASSERT_EQUAL(0, at24_write_cached(&_at24, 0x080, &c, 1));
+	TEST_ASSERT_EQUAL(1, _page_writes);
+	TEST_ASSERT_EQUAL(b, _mem[0x040]);
+	TEST_ASSERT_EQUAL(0xff, _mem[0x000]);
+
+	/* the merged dirty range of a page is written at once */
+	TEST_ASSERT_EQUAL(0, at24_flush(&_at24));
+	TEST_ASSERT_EQUAL(3, _page_writes);
+	TEST_ASSERT_EQUAL(a, _mem[0x000]);
+	TEST_ASSERT_EQUAL(a, _mem[0x001]);
+	TEST_ASSERT_EQUAL(c, _mem[0x080]);
+	TEST_ASSERT_EQUAL(4, _bytes_written);
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_cache_coherency(void)
+{
+	static uint8_t lines[2 * PAGE_SIZE];
+	uint8_t data[PAGE_SIZE], check[PAGE_SIZE];
+	uint8_t v = 0x5a;
+
+	_configure();
+	_fill(data, sizeof(data), 7);
+	TEST_ASSERT_EQUAL(0, at24_set_cache(&_at24, lines, sizeof(lines)));
+
+	/* a direct write over a dirty cached page wins over its old data */
+	TEST_ASSERT_EQUAL(0, at24_write_cached(&_at24, 0x210, &v, 1));
+	TEST_ASSERT_EQUAL(0, at24_write(&_at24, 0x200, data, sizeof(data)));
+	TEST_ASSERT_EQUAL(0, at24_flush(&_at24));
+	TEST_ASSERT_EQUAL(0, at24_read(&_at24, 0x200, check, sizeof(check)));
+	TEST_ASSERT(!memcmp(data, check, sizeof(data)));
+	TEST_ASSERT(!memcmp(data, &_mem[0x200], sizeof(data)));
+
+	/* a full page is cached without reading it first */
+	TEST_ASSERT_EQUAL(0, at24_write_cached(&_at24, 0x400, data, sizeof(data)));
+	TEST_ASSERT_EQUAL(0, at24_set_cache(&_at24, NULL, 0));
+	TEST_ASSERT(!memcmp(data, &_mem[0x400], sizeof(data)));
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+int main(void)
+{
+	TEST_RUN(test_configure);
+	TEST_RUN(test_ack_polling);
+	TEST_RUN(test_write_pages);
+	TEST_RUN(test_write_timeout);
+	TEST_RUN(test_async_write);
+	TEST_RUN(test_async_timeout);
+	TEST_RUN(test_cache_coalescing);
+	TEST_RUN(test_cache_eviction);
+	TEST_RUN(test_cache_coherency);
+	return 0;
+}
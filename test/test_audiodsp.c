@@ -0,0 +1,685 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the audio processing pipeline. The output of
+ * audiodsp_process() must match, byte for byte, a reference model that runs
+ * the pipeline one frame at a time: format conversions, channel map, gain
+ * ramps, biquads and mixed sources. Pipelines are run in chunks of various
+ * sizes so that the states cross block and call boundaries.
+ *
+ * When the host compiler provides arm_neon.h, the NEON kernels are built
+ * too and must give the same bytes as the C kernels.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "callback.h"
+#include "errno.h"
+#include "test.h"
+
+#include "audiodsp.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define FRAMES 500
+
+/* largest frame: 8 channels of 32 bits */
+#define MAX_FRAME_SIZE (4 * AUDIODSP_MAX_CHANNELS)
+
+enum _ref_stage_type {
+	REF_GAIN,
+	REF_BIQUAD,
+	REF_MIX,
+};
+
+struct _ref_stage {
+	uint8_t type;
+	uint8_t mask;
+	int32_t gain[AUDIODSP_MAX_CHANNELS];
+	int32_t target[AUDIODSP_MAX_CHANNELS];
+	int32_t step[AUDIODSP_MAX_CHANNELS];
+	uint32_t remaining[AUDIODSP_MAX_CHANNELS];
+	struct _audiodsp_biquad k;
+	int32_t x1[AUDIODSP_MAX_CHANNELS];
+	int32_t x2[AUDIODSP_MAX_CHANNELS];
+	int32_t y1[AUDIODSP_MAX_CHANNELS];
+	int32_t y2[AUDIODSP_MAX_CHANNELS];
+};
+
+struct _ref_source {
+	const uint8_t* data;
+	uint8_t format;
+	uint8_t channels;
+	int32_t gain;
+	uint32_t frames;
+	uint32_t pos;
+};
+
+/** Reference model of a pipeline */
+struct _ref {
+	uint8_t in_format;
+	uint8_t in_channels;
+	uint8_t out_format;
+	uint8_t out_channels;
+	uint32_t ramp;
+	uint8_t map[AUDIODSP_MAX_CHANNELS];
+	struct _ref_stage stages[AUDIODSP_MAX_STAGES];
+	int stage_count;
+	struct _ref_source sources[AUDIODSP_MAX_SOURCES];
+	int source_count;
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static struct _audiodsp _dsp;
+static struct _ref _ref;
+
+static uint8_t _in[FRAMES * MAX_FRAME_SIZE];
+static uint8_t _out[FRAMES * MAX_FRAME_SIZE];
+static uint8_t _expected[FRAMES * MAX_FRAME_SIZE];
+
+static uint32_t _rand_state;
+
+/* sources played by the mix stages, and their completion order */
+static int16_t _beep[150];
+static int32_t _chime[2 * 70];
+static struct _audiodsp_source _beep_source = {
+	.format = AUDIODSP_S16,
+	.channels = 1,
+	.gain = AUDIODSP_GAIN(0.25),
+};
+static struct _audiodsp_source _chime_source = {
+	.format = AUDIODSP_S32,
+	.channels = 2,
+	.gain = AUDIODSP_GAIN(0.5),
+};
+static struct _audiodsp_source* _done[AUDIODSP_MAX_SOURCES];
+static int _done_count;
+
+/** Bass boost: 150 Hz low shelf, Q 0.707, +9 dB at 48 kHz */
+static const struct _audiodsp_biquad _bass_boost = {
+	.b0 = 270395259,
+	.b1 = -531061877,
+	.b2 = 260838517,
+	.a1 = -531117331,
+	.a2 = 262742867,
+};
+
+/** 2 kHz Butterworth low-pass at 48 kHz */
+static const struct _audiodsp_biquad _lowpass = {
+	.b0 = 3951672,
+	.b1 = 7903344,
+	.b2 = 3951672,
+	.a1 = -446098617,
+	.a2 = 193469849,
+};
+
+/* chunk sizes of the audiodsp_process() calls, around the block size */
+static const uint32_t _chunks[] = { 37, 64, 1, 128, 65, 63, 142 };
+
+/*----------------------------------------------------------------------------
+ *         Reference model
+ *----------------------------------------------------------------------------*/
+
+static int32_t _sat32(int64_t x)
+{
+	if (x > INT32_MAX)
+		return INT32_MAX;
+	if (x < INT32_MIN)
+		return INT32_MIN;
+	return x;
+}
+
+/* Q31 product rounded to nearest */
+static int32_t _qmul(int32_t a, int32_t b)
+{
+	return _sat32(((int64_t)a * b + (1LL << 30)) >> 31);
+}
+
+/* sample to Q31, full scale of each format is 1.0 */
+static int32_t _ref_load(const uint8_t* buf, uint8_t format, uint8_t channels,
+		uint32_t frame, uint8_t channel)
+{
+	uint32_t i = frame * channels + channel;
+	const uint8_t* p;
+
+	switch (format) {
+	case AUDIODSP_S16:
+		return (int32_t)((const int16_t*)buf)[i] * 65536;
+	case AUDIODSP_S24:
+		return ((const int32_t*)buf)[i] * 256;
+	case AUDIODSP_S24_PACKED:
+		p = buf + 3 * i;
+		return (int32_t)(((uint32_t)p[2] << 24) | (p[1] << 16) | (p[0] << 8));
+	default:
+		return ((const int32_t*)buf)[i];
+	}
+}
+
+/* Q31 to sample, rounded to nearest and saturated */
+static void _ref_store(uint8_t* buf, uint8_t format, uint8_t channels,
+		uint32_t frame, uint8_t channel, int32_t x)
+{
+	uint32_t i = frame * channels + channel;
+	int64_t y;
+
+	switch (format) {
+	case AUDIODSP_S16:
+		y = ((int64_t)x + 32768) / 65536 - (((int64_t)x + 32768) % 65536 < 0);
+		((int16_t*)buf)[i] = y > INT16_MAX ? INT16_MAX : y;
+		break;
+	case AUDIODSP_S24:
+	case AUDIODSP_S24_PACKED:
+		y = ((int64_t)x + 128) / 256 - (((int64_t)x + 128) % 256 < 0);
+		if (y > 0x7fffff)
+			y = 0x7fffff;
+		if (format == AUDIODSP_S24) {
+			((int32_t*)buf)[i] = y;
+		} else {
+			buf[3 * i] = y & 0xff;
+			buf[3 * i + 1] = (y >> 8) & 0xff;
+			buf[3 * i + 2] = (y >> 16) & 0xff;
+		}
+		break;
+	default:
+		((int32_t*)buf)[i] = x;
+		break;
+	}
+}
+
+static int32_t _ref_gain(struct _ref_stage* s, uint8_t c, int32_t x)
+{
+	if (s->remaining[c]) {
+		x = _qmul(x, s->gain[c]);
+		s->gain[c] += s->step[c];
+		if (--s->remaining[c] == 0)
+			s->gain[c] = s->target[c];
+		return x;
+	}
+	/* unity gain leaves samples untouched */
+	return s->gain[c] == AUDIODSP_GAIN_UNITY ? x : _qmul(x, s->gain[c]);
+}
+
+static int32_t _ref_biquad(struct _ref_stage* s, uint8_t c, int32_t x)
+{
+	const struct _audiodsp_biquad* k = &s->k;
+	int64_t acc = (int64_t)k->b0 * x + (int64_t)k->b1 * s->x1[c]
+	            + (int64_t)k->b2 * s->x2[c] - (int64_t)k->a1 * s->y1[c]
+	            - (int64_t)k->a2 * s->y2[c];
+	int32_t y = _sat32((acc + (1 << (AUDIODSP_BIQUAD_SHIFT - 1)))
+	                   >> AUDIODSP_BIQUAD_SHIFT);
+
+	s->x2[c] = s->x1[c];
+	s->x1[c] = x;
+	s->y2[c] = s->y1[c];
+	s->y1[c] = y;
+	return y;
+}
+
+static void _ref_mix(struct _ref* ref, int32_t* x)
+{
+	int i;
+	uint8_t c;
+
+	for (i = 0; i < ref->source_count; i++) {
+		struct _ref_source* src = &ref->sources[i];
+
+		if (src->pos >= src->frames)
+			continue;
+		for (c = 0; c < ref->out_channels; c++) {
+			int32_t v = _ref_load(src->data, src->format,
+					src->channels, src->pos,
+					c % src->channels);
+			x[c] = _sat32((int64_t)x[c] + _qmul(v, src->gain));
+		}
+		src->pos++;
+	}
+}
+
+static void _ref_process(struct _ref* ref, const uint8_t* in, uint8_t* out,
+		uint32_t frames)
+{
+	int32_t x[AUDIODSP_MAX_CHANNELS];
+	uint32_t f;
+	uint8_t c;
+	int s;
+
+	for (f = 0; f < frames; f++) {
+		for (c = 0; c < ref->out_channels; c++)
+			x[c] = ref->map[c] == AUDIODSP_MAP_NONE ? 0 :
+			       _ref_load(in, ref->in_format, ref->in_channels,
+					 f, ref->map[c]);
+
+		for (s = 0; s < ref->stage_count; s++) {
+			struct _ref_stage* stage = &ref->stages[s];
+
+			if (stage->type == REF_MIX) {
+				_ref_mix(ref, x);
+				continue;
+			}
+			for (c = 0; c < ref->out_channels; c++) {
+				if (!(stage->mask & (1 << c)))
+					continue;
+				if (stage->type == REF_GAIN)
+					x[c] = _ref_gain(stage, c, x[c]);
+				else
+					x[c] = _ref_biquad(stage, c, x[c]);
+			}
+		}
+
+		for (c = 0; c < ref->out_channels; c++)
+			_ref_store(out, ref->out_format, ref->out_channels, f,
+				   c, x[c]);
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *         Pipeline and model setup
+ *----------------------------------------------------------------------------*/
+
+static uint32_t _rand(void)
+{
+	_rand_state = _rand_state * 1103515245 + 12345;
+	return _rand_state >> 1;
+}
+
+/* random samples, one in eight at full scale */
+static int32_t _rand_q31(void)
+{
+	uint32_t r = _rand();
+
+	switch (r & 7) {
+	case 0:
+		return (r & 8) ? INT32_MAX : INT32_MIN;
+	default:
+		return (int32_t)(_rand() << 1) ^ (int32_t)r;
+	}
+}
+
+static void _fill(uint8_t* buf, uint8_t format, uint8_t channels,
+		uint32_t frames)
+{
+	uint32_t i, count = frames * channels;
+
+	for (i = 0; i < count; i++) {
+		int32_t x = _rand_q31();
+
+		switch (format) {
+		case AUDIODSP_S16:
+			((int16_t*)buf)[i] = x >> 16;
+			break;
+		case AUDIODSP_S24:
+			((int32_t*)buf)[i] = x >> 8;
+			break;
+		case AUDIODSP_S24_PACKED:
+			buf[3 * i] = x >> 8;
+			buf[3 * i + 1] = x >> 16;
+			buf[3 * i + 2] = x >> 24;
+			break;
+		default:
+			((int32_t*)buf)[i] = x;
+			break;
+		}
+	}
+}
+
+static void _setup(uint8_t in_format, uint8_t in_channels,
+		uint8_t out_format, uint8_t out_channels, uint32_t ramp)
+{
+	uint8_t c;
+
+	memset(&_dsp, 0, sizeof(_dsp));
+	_dsp.in_format = in_format;
+	_dsp.in_channels = in_channels;
+	_dsp.out_format = out_format;
+	_dsp.out_channels = out_channels;
+	_dsp.ramp = ramp;
+	TEST_ASSERT_EQUAL(0, audiodsp_init(&_dsp));
+
+	memset(&_ref, 0, sizeof(_ref));
+	_ref.in_format = in_format;
+	_ref.in_channels = in_channels;
+	_ref.out_format = out_format;
+	_ref.out_channels = out_channels;
+	_ref.ramp = ramp;
+	for (c = 0; c < AUDIODSP_MAX_CHANNELS; c++)
+		_ref.map[c] = c % in_channels;
+
+	_done_count = 0;
+	_rand_state = 1;
+}
+
+static void _set_map(const uint8_t* map)
+{
+	TEST_ASSERT_EQUAL(0, audiodsp_set_map(&_dsp, map));
+	memcpy(_ref.map, map, _ref.out_channels);
+}
+
+static int _add_gain(uint8_t mask)
+{
+	struct _ref_stage* s = &_ref.stages[_ref.stage_count];
+	int index = audiodsp_add_gain(&_dsp, mask);
+	uint8_t c;
+
+	TEST_ASSERT_EQUAL(_ref.stage_count, index);
+	memset(s, 0, sizeof(*s));
+	s->type = REF_GAIN;
+	s->mask = mask;
+	for (c = 0; c < AUDIODSP_MAX_CHANNELS; c++)
+		s->gain[c] = s->target[c] = AUDIODSP_GAIN_UNITY;
+	_ref.stage_count++;
+	return index;
+}
+
+/* the ramp reaches the target after ramp frames, in equal steps rounded
+ * toward zero */
+static void _set_gain(int stage, uint8_t mask, int32_t gain)
+{
+	struct _ref_stage* s = &_ref.stages[stage];
+	uint8_t c;
+
+	TEST_ASSERT_EQUAL(0, audiodsp_set_gain(&_dsp, stage, mask, gain));
+	for (c = 0; c < AUDIODSP_MAX_CHANNELS; c++) {
+		if (!(mask & (1 << c)))
+			continue;
+		s->target[c] = gain;
+		s->step[c] = _ref.ramp ?
+			((int64_t)gain - s->gain[c]) / (int64_t)_ref.ramp : 0;
+		if (s->step[c]) {
+			s->remaining[c] = _ref.ramp;
+		} else {
+			s->remaining[c] = 0;
+			s->gain[c] = gain;
+		}
+	}
+}
+
+static void _add_biquad(uint8_t mask, const struct _audiodsp_biquad* k)
+{
+	struct _ref_stage* s = &_ref.stages[_ref.stage_count];
+
+	TEST_ASSERT_EQUAL(_ref.stage_count, audiodsp_add_biquad(&_dsp, mask, k));
+	memset(s, 0, sizeof(*s));
+	s->type = REF_BIQUAD;
+	s->mask = mask;
+	s->k = *k;
+	_ref.stage_count++;
+}
+
+static void _add_mix(void)
+{
+	TEST_ASSERT_EQUAL(_ref.stage_count, audiodsp_add_mix(&_dsp));
+	_ref.stages[_ref.stage_count++].type = REF_MIX;
+}
+
+static int _source_done(void* arg, void* source)
+{
+	TEST_ASSERT(_done_count < AUDIODSP_MAX_SOURCES);
+	_done[_done_count++] = source;
+	return 0;
+}
+
+static void _play(struct _audiodsp_source* source, const void* data,
+		uint32_t frames)
+{
+	struct _ref_source* src = &_ref.sources[_ref.source_count++];
+	struct _callback cb;
+
+	callback_set(&cb, _source_done, NULL);
+	TEST_ASSERT_EQUAL(0, audiodsp_play(&_dsp, source, data, frames, &cb));
+	src->data = data;
+	src->format = source->format;
+	src->channels = source->channels;
+	src->gain = source->gain;
+	src->frames = frames;
+	src->pos = 0;
+}
+
+/* run the pipeline in chunks and the model at once, compare the bytes */
+static void _run_and_compare(uint32_t frames)
+{
+	uint32_t in_size = audiodsp_frame_size(_dsp.in_format, _dsp.in_channels);
+	uint32_t out_size = audiodsp_frame_size(_dsp.out_format,
+			_dsp.out_channels);
+	uint32_t done = 0, i = 0;
+
+	memset(_out, 0, sizeof(_out));
+	memset(_expected, 0, sizeof(_expected));
+
+	while (done < frames) {
+		uint32_t n = _chunks[i++ % ARRAY_SIZE(_chunks)];
+
+		if (n > frames - done)
+			n = frames - done;
+		TEST_ASSERT_EQUAL(0, audiodsp_process(&_dsp, _in + done * in_size,
+				_out + done * out_size, n));
+		done += n;
+	}
+	_ref_process(&_ref, _in, _expected, frames);
+
+	for (i = 0; i < frames * out_size; i++) {
+		if (_out[i] != _expected[i]) {
+			printf("frame %u, byte %u: 0x%02x, expected 0x%02x\n",
+			       i / out_size, i % out_size, _out[i], _expected[i]);
+			TEST_ASSERT(false);
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+/* the model itself, on values worked out by hand */
+static void test_reference(void)
+{
+	static const int16_t s16[] = { 0x1234, -1, INT16_MAX, INT16_MIN };
+	static const uint8_t s24p[] = { 0x56, 0x34, 0x12, 0xff, 0xff, 0xff };
+	uint8_t buf[12];
+
+	TEST_ASSERT_EQUAL(0x12340000, _ref_load((const uint8_t*)s16,
+			AUDIODSP_S16, 1, 0, 0));
+	TEST_ASSERT_EQUAL(-65536, _ref_load((const uint8_t*)s16,
+			AUDIODSP_S16, 2, 0, 1));
+	TEST_ASSERT_EQUAL(INT32_MIN, _ref_load((const uint8_t*)s16,
+			AUDIODSP_S16, 2, 1, 1));
+	TEST_ASSERT_EQUAL(0x12345600, _ref_load(s24p, AUDIODSP_S24_PACKED,
+			1, 0, 0));
+	TEST_ASSERT_EQUAL(-256, _ref_load(s24p, AUDIODSP_S24_PACKED, 1, 1, 0));
+
+	/* halves round up, the positive full scale saturates */
+	_ref_store(buf, AUDIODSP_S16, 1, 0, 0, 0x8000);
+	TEST_ASSERT_EQUAL(1, ((int16_t*)buf)[0]);
+	_ref_store(buf, AUDIODSP_S16, 1, 0, 0, 0x7fff);
+	TEST_ASSERT_EQUAL(0, ((int16_t*)buf)[0]);
+	_ref_store(buf, AUDIODSP_S16, 1, 0, 0, -0x8001);
+	TEST_ASSERT_EQUAL(-1, ((int16_t*)buf)[0]);
+	_ref_store(buf, AUDIODSP_S16, 1, 0, 0, INT32_MAX);
+	TEST_ASSERT_EQUAL(INT16_MAX, ((int16_t*)buf)[0]);
+	_ref_store(buf, AUDIODSP_S24, 1, 0, 0, INT32_MIN);
+	TEST_ASSERT_EQUAL(-0x800000, ((int32_t*)buf)[0]);
+	_ref_store(buf, AUDIODSP_S24_PACKED, 2, 0, 1, 0x12345680);
+	TEST_ASSERT_EQUAL(0x57, buf[3]);
+	TEST_ASSERT_EQUAL(0x34, buf[4]);
+	TEST_ASSERT_EQUAL(0x12, buf[5]);
+
+	TEST_ASSERT_EQUAL(0x20000000, _qmul(0x40000000, 0x40000000));
+	TEST_ASSERT_EQUAL(INT32_MAX, _qmul(INT32_MIN, INT32_MIN));
+	TEST_ASSERT_EQUAL(-1, _qmul(-3, 0x40000000));
+}
+
+/* format conversions and channel duplication, without and with a gain */
+static void test_formats(void)
+{
+	static const uint8_t channels[][2] = { { 1, 2 }, { 2, 2 }, { 3, 1 } };
+	uint8_t in_format, out_format;
+	uint32_t i;
+
+	for (in_format = AUDIODSP_S16; in_format <= AUDIODSP_S32; in_format++) {
+		for (out_format = AUDIODSP_S16; out_format <= AUDIODSP_S32;
+		     out_format++) {
+			for (i = 0; i < ARRAY_SIZE(channels); i++) {
+				_setup(in_format, channels[i][0], out_format,
+				       channels[i][1], 0);
+				_fill(_in, in_format, channels[i][0], FRAMES);
+				_run_and_compare(FRAMES);
+
+				_setup(in_format, channels[i][0], out_format,
+				       channels[i][1], 0);
+				_set_gain(_add_gain(0xff), 0xff,
+					  AUDIODSP_GAIN(0.7));
+				_run_and_compare(FRAMES);
+			}
+		}
+	}
+}
+
+/* a full pipeline: map with silence, ramped gains changed between calls,
+ * biquads, two sources ending in the middle of blocks */
+static void test_pipeline(void)
+{
+	static const uint8_t map[] = { 1, 0, AUDIODSP_MAP_NONE, 0 };
+	int volume, balance;
+	uint32_t i;
+
+	_setup(AUDIODSP_S16, 2, AUDIODSP_S24_PACKED, 4, 100);
+	_set_map(map);
+	volume = _add_gain(0x0f);
+	_add_biquad(0x09, &_bass_boost);
+	_add_biquad(0x02, &_lowpass);
+	_add_mix();
+	balance = _add_gain(0x03);
+
+	_fill(_in, AUDIODSP_S16, 2, FRAMES);
+	_fill((uint8_t*)_beep, AUDIODSP_S16, 1, ARRAY_SIZE(_beep));
+	_fill((uint8_t*)_chime, AUDIODSP_S32, 2, ARRAY_SIZE(_chime) / 2);
+	_play(&_beep_source, _beep, ARRAY_SIZE(_beep));
+	_play(&_chime_source, _chime, ARRAY_SIZE(_chime) / 2);
+	_set_gain(volume, 0x0f, AUDIODSP_GAIN(0.5));
+	_set_gain(balance, 0x01, AUDIODSP_GAIN(0.8));
+
+	_run_and_compare(FRAMES);
+	TEST_ASSERT_EQUAL(2, _done_count);
+	TEST_ASSERT(_done[0] == &_chime_source);
+	TEST_ASSERT(_done[1] == &_beep_source);
+
+	/* ramps restarted in the middle of a ramp, the filter states go on */
+	_set_gain(volume, 0x05, AUDIODSP_GAIN(0.1));
+	_set_gain(balance, 0x03, AUDIODSP_GAIN_UNITY);
+	_run_and_compare(50);
+	_set_gain(volume, 0x0f, AUDIODSP_GAIN_UNITY);
+	for (i = 0; i < 3; i++) {
+		_fill(_in, AUDIODSP_S16, 2, FRAMES);
+		_run_and_compare(FRAMES);
+	}
+}
+
+/* in place processing, allowed unless output frames are larger */
+static void test_in_place(void)
+{
+	static uint8_t buf[FRAMES * MAX_FRAME_SIZE];
+
+	/* same frame size */
+	_setup(AUDIODSP_S32, 2, AUDIODSP_S32, 2, 0);
+	_set_gain(_add_gain(0x03), 0x03, AUDIODSP_GAIN(0.3));
+	_fill(_in, AUDIODSP_S32, 2, FRAMES);
+	memcpy(buf, _in, sizeof(buf));
+	TEST_ASSERT_EQUAL(0, audiodsp_process(&_dsp, buf, buf, FRAMES));
+	_ref_process(&_ref, _in, _expected, FRAMES);
+	TEST_ASSERT(memcmp(buf, _expected, FRAMES * 8) == 0);
+
+	/* smaller output frames */
+	_setup(AUDIODSP_S32, 2, AUDIODSP_S16, 2, 0);
+	_fill(_in, AUDIODSP_S32, 2, FRAMES);
+	memcpy(buf, _in, sizeof(buf));
+	TEST_ASSERT_EQUAL(0, audiodsp_process(&_dsp, buf, buf, FRAMES));
+	_ref_process(&_ref, _in, _expected, FRAMES);
+	TEST_ASSERT(memcmp(buf, _expected, FRAMES * 4) == 0);
+
+	/* larger output frames are refused for overlapping buffers, the
+	 * buffer is left untouched */
+	_setup(AUDIODSP_S16, 2, AUDIODSP_S32, 2, 0);
+	_fill(_in, AUDIODSP_S16, 2, FRAMES);
+	memcpy(buf, _in, sizeof(buf));
+	TEST_ASSERT_EQUAL(-EINVAL, audiodsp_process(&_dsp, buf, buf, FRAMES));
+	TEST_ASSERT_EQUAL(-EINVAL, audiodsp_process(&_dsp, buf + 4 * FRAMES,
+			buf, FRAMES));
+	TEST_ASSERT_EQUAL(-EINVAL, audiodsp_process(&_dsp, buf,
+			buf + 2 * FRAMES, FRAMES));
+	TEST_ASSERT(memcmp(buf, _in, sizeof(buf)) == 0);
+
+	/* adjacent buffers do not overlap */
+	TEST_ASSERT_EQUAL(0, audiodsp_process(&_dsp, buf, buf + 4 * 64, 64));
+	_ref_process(&_ref, _in, _expected, 64);
+	TEST_ASSERT(memcmp(buf + 4 * 64, _expected, 64 * 8) == 0);
+}
+
+#ifdef CONFIG_HAVE_NEON
+/* NEON kernels give the bytes of the C kernels */
+static void test_neon(void)
+{
+	static uint8_t neon_out[FRAMES * MAX_FRAME_SIZE];
+
+	TEST_ASSERT(audiodsp_use_neon(true));
+	test_pipeline();
+	memcpy(neon_out, _out, sizeof(neon_out));
+
+	TEST_ASSERT(!audiodsp_use_neon(false));
+	test_pipeline();
+	TEST_ASSERT(memcmp(neon_out, _out, sizeof(neon_out)) == 0);
+
+	audiodsp_use_neon(true);
+}
+#endif
+
+int main(void)
+{
+	TEST_RUN(test_reference);
+	TEST_RUN(test_formats);
+	TEST_RUN(test_pipeline);
+	TEST_RUN(test_in_place);
+#ifdef CONFIG_HAVE_NEON
+	TEST_RUN(test_neon);
+#endif
+	return 0;
+}
@@ -0,0 +1,694 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the voice capture path. The voice chain runs on synthetic
+ * tones: DC removal, the high-pass filter of the pdmic example and the
+ * decimation filters are checked against their expected frequency
+ * responses, the AGC against its gain limit and target level. Output
+ * counts and samples must not depend on how the input is split in blocks.
+ *
+ * The PDMIC capture ring runs on a simulated DMA channel that fills one
+ * period per poll: periods must come back in order, back to back, and the
+ * voice chain fed from the period callback must give the same samples as a
+ * single run on the whole capture.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "callback.h"
+#include "chip.h"
+#include "errno.h"
+#include "intmath.h"
+#include "test.h"
+#include "trace.h"
+
+#include "audio/pdmic.h"
+#include "audiodsp.h"
+#include "dma/dma.h"
+#include "dma/xdmac.h"
+#include "mm/cache.h"
+#include "peripherals/pmc.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define SAMPLE_RATE 48000
+
+/* one second of input */
+#define SAMPLES SAMPLE_RATE
+
+/* input samples skipped before measuring, the filters settle */
+#define SETTLE (SAMPLE_RATE / 10)
+
+#define AMPLITUDE 8000.0
+
+/* capture ring of the pdmic example: 4 periods of 10 ms */
+#define RING_PERIODS 4
+#define RING_PERIOD_SAMPLES (SAMPLE_RATE / 100)
+
+/* SAMA5D2 clocks: PLLA and the PDMIC peripheral clock */
+#define PLLA_CLOCK 498000000
+#define PERIPHERAL_CLOCK 83000000
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+Pdmic test_pdmic;
+
+static int16_t _in[SAMPLES];
+static int16_t _out[SAMPLES];
+static int16_t _expected[SAMPLES];
+
+/** 100 Hz Butterworth high-pass at 48 kHz, as in the pdmic example */
+static const struct _audiodsp_biquad _highpass = {
+	.b0 = 265961911,
+	.b1 = -531923821,
+	.b2 = 265961911,
+	.a1 = -531901035,
+	.a2 = 263511152,
+};
+
+static const uint32_t _chunks[] = { 37, 64, 1, 128, 65, 63, 142, 480 };
+
+/* simulated clocks */
+static uint32_t _gck_div;
+
+/* simulated DMA channel */
+static struct _dma_channel _dma_channel;
+static struct _callback _dma_callback;
+static struct _dma_cfg _dma_cfg;
+static struct _dma_transfer_cfg _dma_list[PDMIC_RING_MAX_PERIODS];
+static uint8_t _dma_count;
+static uint8_t _dma_block;
+static bool _dma_running;
+static uint32_t _dma_it;
+
+/* microphone samples written by the simulated DMA */
+static uint32_t _mic_pos;
+
+/* period callback */
+static struct _audiodsp_voice _voice;
+static const uint8_t* _last_block;
+static uint32_t _blocks;
+static uint32_t _voice_count;
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static double _det3(const double m[3][3])
+{
+	return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+	     - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+	     + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+/**
+ * Amplitude of a sine of a known frequency, in cycles per sample, fitted in
+ * the least squares sense with any phase and offset. The offset is returned
+ * in dc when not NULL.
+ */
+static double _amplitude(const int16_t* buf, uint32_t count, double freq,
+		double* dc)
+{
+	double m[3][3] = { { 0 } }, v[3] = { 0 }, p[3], det;
+	uint32_t i, j, k;
+
+	for (i = 0; i < count; i++) {
+		double b[3] = { sin(2 * M_PI * freq * i),
+				cos(2 * M_PI * freq * i), 1 };
+
+		for (j = 0; j < 3; j++) {
+			for (k = 0; k < 3; k++)
+				m[j][k] += b[j] * b[k];
+			v[j] += b[j] * buf[i];
+		}
+	}
+
+	/* Cramer's rule */
+	det = _det3(m);
+	for (j = 0; j < 3; j++) {
+		double mj[3][3];
+
+		memcpy(mj, m, sizeof(mj));
+		for (k = 0; k < 3; k++)
+			mj[k][j] = v[k];
+		p[j] = _det3(mj) / det;
+	}
+
+	if (dc)
+		*dc = p[2];
+	return sqrt(p[0] * p[0] + p[1] * p[1]);
+}
+
+static void _tone(int16_t* buf, uint32_t count, double freq, double amplitude,
+		double offset)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		buf[i] = (int16_t)lrint(offset + amplitude *
+				sin(2 * M_PI * freq * i / SAMPLE_RATE));
+}
+
+/* microphone signal: two tones and an offset, as a PDM microphone gives */
+static int16_t _mic(uint32_t i)
+{
+	return (int16_t)lrint(-300 + 4000 * sin(2 * M_PI * 440.0 * i / SAMPLE_RATE)
+				   + 500 * sin(2 * M_PI * 60.0 * i / SAMPLE_RATE));
+}
+
+static void _voice_setup(uint8_t decimation, uint8_t dc_shift,
+		const struct _audiodsp_biquad* highpass, int16_t agc_target,
+		uint8_t agc_max_gain_db)
+{
+	memset(&_voice, 0, sizeof(_voice));
+	_voice.rate = SAMPLE_RATE;
+	_voice.decimation = decimation;
+	_voice.dc_shift = dc_shift;
+	_voice.highpass = highpass;
+	_voice.agc_target = agc_target;
+	_voice.agc_max_gain_db = agc_max_gain_db;
+	TEST_ASSERT_EQUAL(0, audiodsp_voice_init(&_voice));
+}
+
+/* gain in dB of a tone through the chain, aliases are measured at their
+ * output frequency */
+static double _response_db(double freq)
+{
+	uint32_t out_rate = SAMPLE_RATE / _voice.decimation;
+	uint32_t skip = SETTLE / _voice.decimation;
+	uint32_t count;
+	double out_freq;
+
+	TEST_ASSERT_EQUAL(0, audiodsp_voice_init(&_voice));
+	_tone(_in, SAMPLES, freq, AMPLITUDE, 0);
+	count = audiodsp_voice_process(&_voice, _in, SAMPLES, _out);
+	TEST_ASSERT_EQUAL(SAMPLES / _voice.decimation, count);
+
+	out_freq = fmod(freq, out_rate);
+	if (out_freq > out_rate / 2)
+		out_freq = out_rate - out_freq;
+	return 20 * log10(_amplitude(_out + skip, count - skip,
+				out_freq / out_rate, NULL) / AMPLITUDE);
+}
+
+/* level of a tone at the AGC output once the gain has settled */
+static double _agc_level(double amplitude)
+{
+	_voice_setup(1, 0, NULL, 8192, 30);
+	_tone(_in, SAMPLES, 1000, amplitude, 0);
+	audiodsp_voice_process(&_voice, _in, SAMPLES, _out);
+	return _amplitude(_out + SAMPLES / 2, SAMPLES / 2, 1000.0 / SAMPLE_RATE,
+			NULL);
+}
+
+/* voice chain of the pdmic example */
+static void _voice_example(void)
+{
+	_voice_setup(3, 10, &_highpass, 8192, 30);
+}
+
+static int _period_callback(void* arg, void* arg2)
+{
+	struct _buffer* block = (struct _buffer*)arg2;
+
+	TEST_ASSERT(arg == &_voice);
+	TEST_ASSERT_EQUAL(PDMIC_BUF_ATTR_READ, block->attr);
+	TEST_ASSERT_EQUAL(RING_PERIOD_SAMPLES * sizeof(int16_t), block->size);
+	_last_block = block->data;
+	_blocks++;
+	_voice_count += audiodsp_voice_process(&_voice,
+			(const int16_t*)block->data, RING_PERIOD_SAMPLES,
+			_out + _voice_count);
+	return 0;
+}
+
+static void _pdmic_setup(struct _pdmic_desc* desc)
+{
+	memset(desc, 0, sizeof(*desc));
+	desc->addr = PDMIC;
+	desc->sample_rate = SAMPLE_RATE;
+	desc->channels = 1;
+	desc->dsp_size = PDMIC_CONVERTED_DATA_SIZE_16;
+	desc->dsp_osr = PDMIC_OVER_SAMPLING_RATIO_64;
+	desc->dsp_hpfbyp = PDMIC_DSP_HIGH_PASS_FILTER_ON;
+	desc->dsp_sinbyp = PDMIC_DSP_SINCC_PASS_FILTER_ON;
+	desc->dsp_dgain = 1;
+	TEST_ASSERT_EQUAL(0, pdmic_init(desc));
+}
+
+/*----------------------------------------------------------------------------
+ *         Simulated DMA, mutex, cache and clocks
+ *----------------------------------------------------------------------------*/
+
+uint32_t get_pdmic_id_from_addr(const Pdmic* addr)
+{
+	TEST_ASSERT(addr == PDMIC);
+	return ID_PDMIC;
+}
+
+struct _dma_channel* dma_allocate_channel(uint8_t src, uint8_t dest)
+{
+	TEST_ASSERT_EQUAL(ID_PDMIC, src);
+	TEST_ASSERT_EQUAL(DMA_PERIPH_MEMORY, dest);
+	return &_dma_channel;
+}
+
+int dma_set_callback(struct _dma_channel* channel, struct _callback* callback)
+{
+	callback_copy(&_dma_callback, callback);
+	return 0;
+}
+
+int dma_configure_transfer(struct _dma_channel* channel,
+			   struct _dma_cfg* cfg_dma,
+			   struct _dma_transfer_cfg* list,
+			   uint8_t list_size)
+{
+	uint8_t i;
+
+	TEST_ASSERT(channel == &_dma_channel);
+	TEST_ASSERT(!_dma_running);
+	TEST_ASSERT(list_size >= 1 && list_size <= ARRAY_SIZE(_dma_list));
+	for (i = 0; i < list_size; i++) {
+		TEST_ASSERT(list[i].saddr == (void*)&PDMIC->PDMIC_CDR);
+		_dma_list[i] = list[i];
+	}
+	_dma_cfg = *cfg_dma;
+	_dma_count = list_size;
+	_dma_block = 0;
+	return 0;
+}
+
+int dma_start_transfer(struct _dma_channel* channel)
+{
+	_dma_running = true;
+	return 0;
+}
+
+int dma_stop_transfer(struct _dma_channel* channel)
+{
+	_dma_running = false;
+	return 0;
+}
+
+int dma_reset_channel(struct _dma_channel* channel)
+{
+	_dma_it = 0;
+	return 0;
+}
+
+void xdmac_enable_channel_it(Xdmac* xdmac, uint8_t channel, uint32_t int_mask)
+{
+	_dma_it |= int_mask;
+}
+
+/* the channel fills the next block of the list with microphone samples,
+ * then calls the callback as from the end of block interrupt */
+static void _dma_run_block(void)
+{
+	struct _dma_transfer_cfg* cfg = &_dma_list[_dma_block];
+	int16_t* data = (int16_t*)cfg->daddr;
+	uint32_t i;
+
+	TEST_ASSERT(_dma_running);
+	for (i = 0; i < cfg->len; i++)
+		data[i] = _mic(_mic_pos++);
+	if (_dma_cfg.loop)
+		_dma_block = (_dma_block + 1) % _dma_count;
+	else
+		_dma_running = ++_dma_block < _dma_count;
+	if (_dma_it & XDMAC_CIE_BIE || !_dma_running)
+		callback_call(&_dma_callback, NULL);
+}
+
+bool mutex_try_lock(mutex_t* mutex)
+{
+	if (*mutex)
+		return false;
+	*mutex = 1;
+	return true;
+}
+
+void mutex_lock(mutex_t* mutex)
+{
+	TEST_ASSERT(mutex_try_lock(mutex));
+}
+
+void mutex_unlock(mutex_t* mutex)
+{
+	*mutex = 0;
+}
+
+bool mutex_is_locked(const mutex_t* mutex)
+{
+	return *mutex != 0;
+}
+
+void cache_invalidate_region(void* start, uint32_t length)
+{
+}
+
+uint32_t pmc_get_plla_clock(void)
+{
+	return PLLA_CLOCK;
+}
+
+uint32_t pmc_get_peripheral_clock(uint32_t id)
+{
+	TEST_ASSERT_EQUAL(ID_PDMIC, id);
+	return PERIPHERAL_CLOCK;
+}
+
+void pmc_configure_peripheral(uint32_t id, const struct _pmc_periph_cfg* cfg,
+		bool enable)
+{
+	TEST_ASSERT_EQUAL(ID_PDMIC, id);
+	TEST_ASSERT_EQUAL(PMC_PCR_GCKCSS_PLLA_CLK, cfg->gck.css);
+	_gck_div = cfg->gck.div;
+}
+
+uint32_t pmc_get_gck_clock(uint32_t id)
+{
+	return _gck_div ? PLLA_CLOCK / _gck_div : 0;
+}
+
+void pmc_enable_peripheral(uint32_t id)
+{
+}
+
+void pmc_disable_peripheral(uint32_t id)
+{
+}
+
+void pmc_enable_gck(uint32_t id)
+{
+}
+
+void pmc_disable_gck(uint32_t id)
+{
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_init(void)
+{
+	struct _audiodsp_voice voice;
+
+	memset(&voice, 0, sizeof(voice));
+	voice.rate = SAMPLE_RATE;
+	voice.decimation = 1;
+	TEST_ASSERT_EQUAL(0, audiodsp_voice_init(&voice));
+	TEST_ASSERT(voice.fir == NULL);
+
+	voice.decimation = 0;
+	TEST_ASSERT_EQUAL(-EINVAL, audiodsp_voice_init(&voice));
+	voice.decimation = AUDIODSP_VOICE_MAX_DECIMATION + 1;
+	TEST_ASSERT_EQUAL(-EINVAL, audiodsp_voice_init(&voice));
+	voice.decimation = AUDIODSP_VOICE_MAX_DECIMATION;
+	TEST_ASSERT_EQUAL(0, audiodsp_voice_init(&voice));
+	TEST_ASSERT(voice.fir != NULL);
+
+	voice.dc_shift = 31;
+	TEST_ASSERT_EQUAL(-EINVAL, audiodsp_voice_init(&voice));
+	voice.dc_shift = 10;
+	voice.agc_target = -1;
+	TEST_ASSERT_EQUAL(-EINVAL, audiodsp_voice_init(&voice));
+	voice.agc_target = 8192;
+	voice.agc_max_gain_db = AUDIODSP_VOICE_MAX_AGC_GAIN_DB + 1;
+	TEST_ASSERT_EQUAL(-EINVAL, audiodsp_voice_init(&voice));
+	voice.agc_max_gain_db = AUDIODSP_VOICE_MAX_AGC_GAIN_DB;
+	TEST_ASSERT_EQUAL(0, audiodsp_voice_init(&voice));
+	voice.rate = 0;
+	TEST_ASSERT_EQUAL(-EINVAL, audiodsp_voice_init(&voice));
+}
+
+/* the DC blocker removes the offset and leaves the voice band alone */
+static void test_dc_removal(void)
+{
+	double amplitude, dc;
+
+	_voice_setup(1, 10, NULL, 0, 0);
+	_tone(_in, SAMPLES, 1000, AMPLITUDE, 4000);
+	TEST_ASSERT_EQUAL(SAMPLES,
+			audiodsp_voice_process(&_voice, _in, SAMPLES, _out));
+	amplitude = _amplitude(_out + SAMPLES / 2, SAMPLES / 2,
+			1000.0 / SAMPLE_RATE, &dc);
+	printf("    offset %.2f, 1000 Hz %+.3f dB\n", dc,
+	       20 * log10(amplitude / AMPLITUDE));
+	TEST_ASSERT(fabs(dc) < 1);
+	TEST_ASSERT(fabs(20 * log10(amplitude / AMPLITUDE)) < 0.02);
+}
+
+/* second order Butterworth high-pass at 100 Hz */
+static void test_highpass(void)
+{
+	static const double freqs[] = { 25, 50, 100, 200, 400, 1000, 4000, 12000 };
+	uint32_t i;
+
+	_voice_setup(1, 0, &_highpass, 0, 0);
+	for (i = 0; i < ARRAY_SIZE(freqs); i++) {
+		double r4 = pow(freqs[i] / 100, 4);
+		double expected = 10 * log10(r4 / (1 + r4));
+		double gain = _response_db(freqs[i]);
+
+		printf("    %5.0f Hz: %+7.2f dB, expected %+7.2f dB\n",
+		       freqs[i], gain, expected);
+		TEST_ASSERT(fabs(gain - expected) < 0.1);
+	}
+}
+
+/* flat passband up to half the output Nyquist frequency, 4 kHz at 16 kHz,
+ * the cut-off at 0.9 times the output Nyquist frequency and no alias folded
+ * onto the passband */
+static void test_decimation(void)
+{
+	static const double pass[] = { 0.05, 0.2, 0.35, 0.5 };
+	uint8_t decimation;
+	uint32_t i;
+
+	for (decimation = 2; decimation <= AUDIODSP_VOICE_MAX_DECIMATION;
+	     decimation++) {
+		double nyquist = SAMPLE_RATE / decimation / 2.0;
+		double ripple = 0, alias = -200, cutoff;
+
+		_voice_setup(decimation, 0, NULL, 0, 0);
+		for (i = 0; i < ARRAY_SIZE(pass); i++)
+			ripple = fmax(ripple, fabs(_response_db(pass[i] * nyquist)));
+
+		cutoff = _response_db(0.9 * nyquist);
+
+		/* tones folded onto the passband */
+		for (i = 0; i < ARRAY_SIZE(pass); i++)
+			alias = fmax(alias, _response_db((2 - pass[i]) * nyquist));
+
+		printf("    decimation by %u: ripple %.3f dB, cut-off %.2f dB, "
+		       "alias %.1f dB\n", decimation, ripple, cutoff, alias);
+		TEST_ASSERT(ripple < 0.05);
+		TEST_ASSERT(fabs(cutoff + 6.02) < 0.1);
+		TEST_ASSERT(alias < -70);
+	}
+}
+
+/* the gain stops at agc_max_gain_db for quiet input and brings louder input
+ * to agc_target, a loud onset is brought down within a few AGC steps */
+static void test_agc(void)
+{
+	uint32_t peak = 0;
+	double quiet, loud;
+	uint32_t i;
+
+	quiet = _agc_level(100);
+	loud = _agc_level(2000);
+	printf("    100 -> %.0f, 2000 -> %.0f\n", quiet, loud);
+	TEST_ASSERT(fabs(quiet / (100 * pow(10, 30 / 20.0)) - 1) < 0.01);
+	TEST_ASSERT(fabs(loud / 8192 - 1) < 0.02);
+
+	/* quiet then loud, the gain is at its maximum before the onset */
+	_voice_setup(1, 0, NULL, 8192, 30);
+	_tone(_in, SAMPLES, 1000, 200, 0);
+	_tone(_in + SAMPLES / 2, SAMPLES / 2, 1000, 16000, 0);
+	audiodsp_voice_process(&_voice, _in, SAMPLES, _out);
+	for (i = SAMPLES / 2 + 2 * 32; i < SAMPLES; i++)
+		peak = max_u32(peak, abs_u32(_out[i]));
+	printf("    onset: peak %u two AGC steps after\n", (unsigned)peak);
+	TEST_ASSERT(peak <= 8192 * 1.02);
+}
+
+/* output counts and samples do not depend on the block sizes */
+static void test_blocks(void)
+{
+	uint32_t in_pos = 0, out_pos = 0, i = 0;
+
+	_voice_example();
+	_mic_pos = 0;
+	for (i = 0; i < SAMPLES; i++)
+		_in[i] = _mic(i);
+	TEST_ASSERT_EQUAL(SAMPLES / 3,
+			audiodsp_voice_process(&_voice, _in, SAMPLES, _expected));
+
+	TEST_ASSERT_EQUAL(0, audiodsp_voice_init(&_voice));
+	for (i = 0; in_pos < SAMPLES; i++) {
+		uint32_t n = min_u32(_chunks[i % ARRAY_SIZE(_chunks)],
+				SAMPLES - in_pos);
+		uint32_t count;
+
+		/* in place */
+		memcpy(_out + in_pos, _in + in_pos, n * sizeof(_in[0]));
+		count = audiodsp_voice_process(&_voice, _out + in_pos, n,
+				_out + in_pos);
+		TEST_ASSERT_EQUAL((in_pos + n) / 3 - in_pos / 3, count);
+		memmove(_out + out_pos, _out + in_pos, count * sizeof(_out[0]));
+		in_pos += n;
+		out_pos += count;
+	}
+	TEST_ASSERT_EQUAL(SAMPLES / 3, out_pos);
+	TEST_ASSERT(memcmp(_expected, _out, out_pos * sizeof(_out[0])) == 0);
+}
+
+/* the generated clock is the divider of PLLA giving the closest PDM clock */
+static void test_clock(void)
+{
+	struct _pdmic_desc desc;
+	uint32_t mr, selck, f_pdm;
+
+	_pdmic_setup(&desc);
+	mr = test_pdmic.PDMIC_MR;
+	TEST_ASSERT_EQUAL(PDMIC_MR_CLKS_GCLK, mr & PDMIC_MR_CLKS_GCLK);
+	selck = PLLA_CLOCK / _gck_div;
+	f_pdm = selck / (2 * (((mr & PDMIC_MR_PRESCAL_Msk) >>
+			PDMIC_MR_PRESCAL_Pos) + 1));
+	printf("    GCLK PLLA/%u, PDM clock %u Hz\n", (unsigned)_gck_div,
+	       (unsigned)f_pdm);
+	TEST_ASSERT(3 * selck <= PERIPHERAL_CLOCK);
+	TEST_ASSERT(abs((int)f_pdm - SAMPLE_RATE * 64) < SAMPLE_RATE * 64 / 1000);
+}
+
+/* periods come back in order and back to back, the voice chain fed from
+ * the period callback sees the whole capture */
+static void test_ring(void)
+{
+	static int16_t ring[RING_PERIODS * RING_PERIOD_SAMPLES];
+	struct _pdmic_desc desc;
+	struct _callback cb;
+	struct _buffer buf = {
+		.data = (uint8_t*)ring,
+		.size = sizeof(ring),
+		.attr = PDMIC_BUF_ATTR_READ,
+	};
+	uint32_t i, periods = SAMPLES / RING_PERIOD_SAMPLES;
+
+	_pdmic_setup(&desc);
+	callback_set(&cb, _period_callback, &_voice);
+
+	TEST_ASSERT_EQUAL(-EINVAL, pdmic_ring_start(&desc, &buf, 1, &cb));
+	TEST_ASSERT_EQUAL(-EINVAL, pdmic_ring_start(&desc, &buf,
+			PDMIC_RING_MAX_PERIODS + 1, &cb));
+	buf.size -= 2;
+	TEST_ASSERT_EQUAL(-EINVAL, pdmic_ring_start(&desc, &buf,
+			RING_PERIODS, &cb));
+	buf.size += 2;
+
+	_voice_example();
+	_mic_pos = 0;
+	_blocks = 0;
+	_voice_count = 0;
+	TEST_ASSERT_EQUAL(0, pdmic_ring_start(&desc, &buf, RING_PERIODS, &cb));
+	TEST_ASSERT_EQUAL(-EBUSY, pdmic_ring_start(&desc, &buf,
+			RING_PERIODS, &cb));
+	TEST_ASSERT(test_pdmic.PDMIC_CR & PDMIC_CR_ENPDM);
+	TEST_ASSERT(_dma_cfg.loop);
+	TEST_ASSERT_EQUAL(DMA_DATA_WIDTH_HALF_WORD, _dma_cfg.data_width);
+	TEST_ASSERT_EQUAL(RING_PERIODS, _dma_count);
+	for (i = 0; i < RING_PERIODS; i++) {
+		TEST_ASSERT(_dma_list[i].daddr == &ring[i * RING_PERIOD_SAMPLES]);
+		TEST_ASSERT_EQUAL(RING_PERIOD_SAMPLES, _dma_list[i].len);
+	}
+
+	for (i = 0; i < periods; i++) {
+		_dma_run_block();
+		TEST_ASSERT_EQUAL(i + 1, _blocks);
+		TEST_ASSERT(_last_block == (uint8_t*)&ring[(i % RING_PERIODS) *
+				RING_PERIOD_SAMPLES]);
+		TEST_ASSERT(!pdmic_rx_transfer_is_done(&desc));
+	}
+
+	pdmic_ring_stop(&desc);
+	TEST_ASSERT(!_dma_running);
+	TEST_ASSERT(!(test_pdmic.PDMIC_CR & PDMIC_CR_ENPDM));
+	TEST_ASSERT(pdmic_rx_transfer_is_done(&desc));
+
+	/* a block completing while stopping is dropped */
+	callback_call(&_dma_callback, NULL);
+	TEST_ASSERT_EQUAL(periods, _blocks);
+
+	/* same samples as one run on the whole capture */
+	for (i = 0; i < SAMPLES; i++)
+		_in[i] = _mic(i);
+	TEST_ASSERT_EQUAL(0, audiodsp_voice_init(&_voice));
+	TEST_ASSERT_EQUAL(SAMPLES / 3,
+			audiodsp_voice_process(&_voice, _in, SAMPLES, _expected));
+	TEST_ASSERT_EQUAL(SAMPLES / 3, _voice_count);
+	TEST_ASSERT(memcmp(_expected, _out, _voice_count * sizeof(_out[0])) == 0);
+
+	/* the ring can be started again */
+	TEST_ASSERT_EQUAL(0, pdmic_ring_start(&desc, &buf, RING_PERIODS, &cb));
+	pdmic_ring_stop(&desc);
+}
+
+int main(void)
+{
+	TEST_RUN(test_init);
+	TEST_RUN(test_dc_removal);
+	TEST_RUN(test_highpass);
+	TEST_RUN(test_decimation);
+	TEST_RUN(test_agc);
+	TEST_RUN(test_blocks);
+	TEST_RUN(test_clock);
+	TEST_RUN(test_ring);
+	return 0;
+}
@@ -0,0 +1,574 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests and benchmark of the FatFs sector cache. The physical drives
+ * are RAM disks with a latency model: each device request costs a fixed
+ * command time plus a transfer time per sector. The disk I/O layer follows
+ * sdmmc_ff.c: drives are attached to the cache in disk_initialize() and
+ * disk_read(), disk_write() and CTRL_SYNC go through it, or directly to the
+ * RAM disk when the cache is disabled for the comparison runs.
+ *
+ * The benchmark formats a volume, writes a tree of small files, then mounts
+ * it again and opens and reads every file, as done when loading
+ * configuration and asset files at boot. The device requests and the
+ * modelled time are printed with and without the cache.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+#include "ff.h"
+#include "diskio.h"
+#include "fatfs/softpack/diskcache.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define SECTOR_SIZE 512
+
+#define DRIVE0_SECTORS 8192
+#define DRIVE1_SECTORS 1024
+
+/* latency model, close to an SD card in high speed mode */
+#define CMD_US 200
+#define SECTOR_US 20
+
+#define BENCH_DIRS 8
+#define BENCH_FILES 32
+
+/*----------------------------------------------------------------------------
+ *         Local types
+ *----------------------------------------------------------------------------*/
+
+struct _ram_stats {
+	uint32_t reads;
+	uint32_t read_sectors;
+	uint32_t writes;
+	uint32_t write_sectors;
+	uint64_t time_us;
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static uint8_t _drive0[DRIVE0_SECTORS][SECTOR_SIZE];
+static uint8_t _drive1[DRIVE1_SECTORS][SECTOR_SIZE];
+
+static uint8_t (*const _drives[])[SECTOR_SIZE] = { _drive0, _drive1 };
+static const DWORD _drive_sectors[] = { DRIVE0_SECTORS, DRIVE1_SECTORS };
+
+static struct _ram_stats _ram_stats;
+
+static bool _use_cache;
+
+static FATFS _fs;
+
+static uint8_t _buf[32 * SECTOR_SIZE];
+
+/*----------------------------------------------------------------------------
+ *         RAM disks
+ *----------------------------------------------------------------------------*/
+
+static DRESULT _ram_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
+{
+	TEST_ASSERT(pdrv < 2);
+	TEST_ASSERT(count > 0 && sector + count <= _drive_sectors[pdrv]);
+	memcpy(buff, _drives[pdrv][sector], count * SECTOR_SIZE);
+	_ram_stats.reads++;
+	_ram_stats.read_sectors += count;
+	_ram_stats.time_us += CMD_US + count * SECTOR_US;
+	return RES_OK;
+}
+
+static DRESULT _ram_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
+{
+	TEST_ASSERT(pdrv < 2);
+	TEST_ASSERT(count > 0 && sector + count <= _drive_sectors[pdrv]);
+	memcpy(_drives[pdrv][sector], buff, count * SECTOR_SIZE);
+	_ram_stats.writes++;
+	_ram_stats.write_sectors += count;
+	_ram_stats.time_us += CMD_US + count * SECTOR_US;
+	return RES_OK;
+}
+
+static const struct _diskcache_ops _ram_ops = {
+	.read = _ram_read,
+	.write = _ram_write,
+};
+
+/*----------------------------------------------------------------------------
+ *         Disk I/O layer
+ *----------------------------------------------------------------------------*/
+
+DSTATUS disk_initialize(BYTE pdrv)
+{
+	if (pdrv >= 2)
+		return STA_NOINIT;
+	if (_use_cache)
+		diskcache_attach(pdrv, &_ram_ops, _drive_sectors[pdrv]);
+	return 0;
+}
+
+DSTATUS disk_status(BYTE pdrv)
+{
+	return pdrv < 2 ? 0 : STA_NOINIT;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
+{
+	if (_use_cache)
+		return diskcache_read(pdrv, buff, sector, count);
+	return _ram_read(pdrv, buff, sector, count);
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
+{
+	if (_use_cache)
+		return diskcache_write(pdrv, buff, sector, count);
+	return _ram_write(pdrv, buff, sector, count);
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff)
+{
+	switch (cmd) {
+	case CTRL_SYNC:
+		return _use_cache ? diskcache_sync(pdrv) : RES_OK;
+	case GET_SECTOR_COUNT:
+		*(DWORD*)buff = _drive_sectors[pdrv];
+		return RES_OK;
+	case GET_SECTOR_SIZE:
+		*(WORD*)buff = SECTOR_SIZE;
+		return RES_OK;
+	case GET_BLOCK_SIZE:
+		*(DWORD*)buff = 1;
+		return RES_OK;
+	default:
+		return RES_PARERR;
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *         Helpers
+ *----------------------------------------------------------------------------*/
+
+static void _fill_drives(void)
+{
+	DWORD s;
+	int i;
+
+	for (s = 0; s < DRIVE0_SECTORS; s++)
+		for (i = 0; i < SECTOR_SIZE; i++)
+			_drive0[s][i] = (uint8_t)(s * 7 + i);
+	for (s = 0; s < DRIVE1_SECTORS; s++)
+		for (i = 0; i < SECTOR_SIZE; i++)
+			_drive1[s][i] = (uint8_t)(s * 13 + i + 1);
+}
+
+static void _setup(void)
+{
+	_fill_drives();
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_init());
+	diskcache_attach(0, &_ram_ops, DRIVE0_SECTORS);
+	diskcache_reset_stats(0);
+	memset(&_ram_stats, 0, sizeof(_ram_stats));
+}
+
+static void _read1(BYTE pdrv, DWORD sector)
+{
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_read(pdrv, _buf, sector, 1));
+	TEST_ASSERT(memcmp(_buf, _drives[pdrv][sector], SECTOR_SIZE) == 0);
+}
+
+static void _write1(BYTE pdrv, DWORD sector, uint8_t value)
+{
+	memset(_buf, value, SECTOR_SIZE);
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_write(pdrv, _buf, sector, 1));
+}
+
+static bool _sector_is(BYTE pdrv, DWORD sector, uint8_t value)
+{
+	int i;
+
+	for (i = 0; i < SECTOR_SIZE; i++)
+		if (_drives[pdrv][sector][i] != value)
+			return false;
+	return true;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+/* the drives cannot be used before the cache is initialized */
+static void test_uninitialized(void)
+{
+	_fill_drives();
+	diskcache_attach(0, &_ram_ops, DRIVE0_SECTORS);
+	TEST_ASSERT_EQUAL(RES_NOTRDY, diskcache_read(0, _buf, 0, 1));
+	TEST_ASSERT_EQUAL(RES_NOTRDY, diskcache_sync(0));
+	TEST_ASSERT_EQUAL(0, _ram_stats.reads);
+}
+
+static void test_hit_miss(void)
+{
+	struct _diskcache_stats stats;
+
+	_setup();
+	_read1(0, 10);
+	_read1(0, 10);
+	diskcache_get_stats(0, &stats);
+	TEST_ASSERT_EQUAL(1, stats.hits);
+	TEST_ASSERT_EQUAL(1, stats.misses);
+	TEST_ASSERT_EQUAL(1, stats.dev_reads);
+	TEST_ASSERT_EQUAL(1, _ram_stats.reads);
+}
+
+/* the second of two sequential reads fetches the following sectors in
+ * the same device request */
+static void test_read_ahead(void)
+{
+	struct _diskcache_stats stats;
+	DWORD s;
+
+	_setup();
+	_read1(0, 100);
+	_read1(0, 101);
+	diskcache_get_stats(0, &stats);
+	TEST_ASSERT_EQUAL(2, stats.dev_reads);
+	TEST_ASSERT_EQUAL(1 + _DISKCACHE_READ_AHEAD, stats.dev_read_sectors);
+	TEST_ASSERT_EQUAL(_DISKCACHE_READ_AHEAD - 1, stats.read_ahead);
+
+	for (s = 102; s < 101 + _DISKCACHE_READ_AHEAD; s++)
+		_read1(0, s);
+	diskcache_get_stats(0, &stats);
+	TEST_ASSERT_EQUAL(2, stats.dev_reads);
+	TEST_ASSERT_EQUAL(_DISKCACHE_READ_AHEAD - 1, stats.hits);
+
+	/* no read-ahead on the last sectors of the drive */
+	_read1(0, DRIVE0_SECTORS - 3);
+	_read1(0, DRIVE0_SECTORS - 2);
+	TEST_ASSERT_EQUAL(1 + _DISKCACHE_READ_AHEAD + 3, _ram_stats.read_sectors);
+}
+
+/* written sectors stay in the cache until the sync, which writes the
+ * contiguous ones in a single request */
+static void test_write_back(void)
+{
+	struct _diskcache_stats stats;
+	DWORD s;
+
+	_setup();
+	for (s = 200; s < 204; s++)
+		_write1(0, s, 0xa5);
+	TEST_ASSERT_EQUAL(0, _ram_stats.writes);
+	TEST_ASSERT(!_sector_is(0, 200, 0xa5));
+
+	/* cached data is returned before the sync */
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_read(0, _buf, 202, 1));
+	TEST_ASSERT_EQUAL(0xa5, _buf[0]);
+	TEST_ASSERT_EQUAL(0, _ram_stats.reads);
+
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_sync(0));
+	diskcache_get_stats(0, &stats);
+	TEST_ASSERT_EQUAL(1, stats.dev_writes);
+	TEST_ASSERT_EQUAL(4, stats.dev_write_sectors);
+	for (s = 200; s < 204; s++)
+		TEST_ASSERT(_sector_is(0, s, 0xa5));
+
+	/* nothing left to write */
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_sync(0));
+	TEST_ASSERT_EQUAL(1, _ram_stats.writes);
+}
+
+/* a dirty sector is written back when it is evicted */
+static void test_evict_dirty(void)
+{
+	int i;
+
+	_setup();
+	_write1(0, 300, 0x3c);
+	for (i = 0; i < _DISKCACHE_SECTORS; i++)
+		_read1(0, 1000 + 2 * i);
+	TEST_ASSERT_EQUAL(1, _ram_stats.writes);
+	TEST_ASSERT(_sector_is(0, 300, 0x3c));
+}
+
+/* pinned sectors survive a scan larger than the cache */
+static void test_pinned(void)
+{
+	/* non sequential order, no read-ahead */
+	static const DWORD pinned[] = { 2001, 2003, 2000, 2002 };
+	struct _diskcache_stats stats;
+	int i;
+
+	_setup();
+	diskcache_pin(0, 2000, 4);
+	for (i = 0; i < 4; i++)
+		_read1(0, pinned[i]);
+	for (i = 0; i < 2 * _DISKCACHE_SECTORS; i++)
+		_read1(0, 3000 + 2 * i);
+
+	diskcache_reset_stats(0);
+	for (i = 0; i < 4; i++)
+		_read1(0, 2000 + i);
+	diskcache_get_stats(0, &stats);
+	TEST_ASSERT_EQUAL(4, stats.hits);
+	TEST_ASSERT_EQUAL(0, stats.dev_reads);
+
+	/* unpinned sectors are evicted again */
+	diskcache_pin(0, 0, 0);
+	for (i = 0; i < 2 * _DISKCACHE_SECTORS; i++)
+		_read1(0, 3001 + 2 * i);
+	diskcache_reset_stats(0);
+	_read1(0, 2000);
+	diskcache_get_stats(0, &stats);
+	TEST_ASSERT_EQUAL(1, stats.misses);
+}
+
+/* large transfers go to the device, after writing back the cached data
+ * they cover */
+static void test_bypass(void)
+{
+	struct _diskcache_stats stats;
+
+	_setup();
+	_write1(0, 410, 0x5a);
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_read(0, _buf, 400, 32));
+	diskcache_get_stats(0, &stats);
+	TEST_ASSERT_EQUAL(1, stats.dev_writes);
+	TEST_ASSERT_EQUAL(1, stats.dev_reads);
+	TEST_ASSERT_EQUAL(32, stats.dev_read_sectors);
+	TEST_ASSERT_EQUAL(0x5a, _buf[10 * SECTOR_SIZE]);
+
+	/* a large write supersedes the cached sectors */
+	_write1(0, 520, 0x11);
+	memset(_buf, 0x22, sizeof(_buf));
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_write(0, _buf, 500, 32));
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_sync(0));
+	TEST_ASSERT(_sector_is(0, 520, 0x22));
+	TEST_ASSERT_EQUAL(2, _ram_stats.writes);
+}
+
+/* detaching a drive drops its sectors without writing them */
+static void test_detach(void)
+{
+	_setup();
+	_write1(0, 600, 0x77);
+	diskcache_detach(0);
+	TEST_ASSERT_EQUAL(0, _ram_stats.writes);
+	TEST_ASSERT(!_sector_is(0, 600, 0x77));
+	TEST_ASSERT_EQUAL(RES_NOTRDY, diskcache_read(0, _buf, 600, 1));
+	TEST_ASSERT_EQUAL(RES_NOTRDY, diskcache_write(0, _buf, 600, 1));
+	TEST_ASSERT_EQUAL(RES_NOTRDY, diskcache_sync(0));
+}
+
+/* the cache is shared by the drives, entries are told apart by drive */
+static void test_drives(void)
+{
+	struct _diskcache_stats stats;
+
+	_setup();
+	diskcache_attach(1, &_ram_ops, DRIVE1_SECTORS);
+	diskcache_reset_stats(1);
+	_read1(0, 7);
+	_read1(1, 7);
+	_read1(0, 7);
+	_read1(1, 7);
+	diskcache_get_stats(1, &stats);
+	TEST_ASSERT_EQUAL(1, stats.hits);
+	TEST_ASSERT_EQUAL(1, stats.misses);
+
+	_write1(1, 20, 0x99);
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_sync(0));
+	TEST_ASSERT(!_sector_is(1, 20, 0x99));
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_sync(1));
+	TEST_ASSERT(_sector_is(1, 20, 0x99));
+	diskcache_detach(1);
+}
+
+static void test_invalid(void)
+{
+	_setup();
+	TEST_ASSERT_EQUAL(RES_PARERR, diskcache_read(0, _buf, DRIVE0_SECTORS, 1));
+	TEST_ASSERT_EQUAL(RES_PARERR, diskcache_read(0, _buf, DRIVE0_SECTORS - 1, 2));
+	TEST_ASSERT_EQUAL(RES_PARERR, diskcache_write(0, _buf, DRIVE0_SECTORS, 1));
+	TEST_ASSERT_EQUAL(RES_NOTRDY, diskcache_read(1, _buf, 0, 1));
+	TEST_ASSERT_EQUAL(RES_NOTRDY, diskcache_read(_VOLUMES, _buf, 0, 1));
+	TEST_ASSERT_EQUAL(0, _ram_stats.reads);
+}
+
+/*----------------------------------------------------------------------------
+ *         Benchmark
+ *----------------------------------------------------------------------------*/
+
+static uint32_t _file_size(int dir, int file)
+{
+	return 64 + ((dir * BENCH_FILES + file) * 97) % 1500;
+}
+
+static uint8_t _file_byte(int dir, int file, uint32_t offset)
+{
+	return (uint8_t)(dir * 31 + file * 7 + offset);
+}
+
+static void _create_tree(void)
+{
+	FIL fil;
+	char path[32];
+	uint32_t size, i;
+	UINT bw;
+	int d, f;
+
+	TEST_ASSERT_EQUAL(FR_OK, f_mount(&_fs, "0:", 1));
+	for (d = 0; d < BENCH_DIRS; d++) {
+		snprintf(path, sizeof(path), "0:/dir%d", d);
+		TEST_ASSERT_EQUAL(FR_OK, f_mkdir(path));
+		for (f = 0; f < BENCH_FILES; f++) {
+			snprintf(path, sizeof(path), "0:/dir%d/asset_%02d.cfg", d, f);
+			TEST_ASSERT_EQUAL(FR_OK, f_open(&fil, path, FA_WRITE | FA_CREATE_NEW));
+			size = _file_size(d, f);
+			for (i = 0; i < size; i++)
+				_buf[i] = _file_byte(d, f, i);
+			TEST_ASSERT_EQUAL(FR_OK, f_write(&fil, _buf, size, &bw));
+			TEST_ASSERT_EQUAL(size, bw);
+			TEST_ASSERT_EQUAL(FR_OK, f_close(&fil));
+		}
+	}
+	TEST_ASSERT_EQUAL(FR_OK, f_mount(NULL, "0:", 0));
+}
+
+/* mount the volume, list every directory and read every file */
+static void _load_tree(void)
+{
+	FILINFO info;
+	FIL fil;
+	DIR dir;
+	char path[32];
+	uint32_t size, i;
+	UINT br;
+	int d, f, files;
+
+	TEST_ASSERT_EQUAL(FR_OK, f_mount(&_fs, "0:", 1));
+	if (_use_cache)
+		diskcache_pin_fat(&_fs);
+	for (d = 0; d < BENCH_DIRS; d++) {
+		snprintf(path, sizeof(path), "0:/dir%d", d);
+		TEST_ASSERT_EQUAL(FR_OK, f_opendir(&dir, path));
+		files = 0;
+		while (f_readdir(&dir, &info) == FR_OK && info.fname[0])
+			files++;
+		TEST_ASSERT_EQUAL(BENCH_FILES, files);
+		TEST_ASSERT_EQUAL(FR_OK, f_closedir(&dir));
+
+		for (f = 0; f < BENCH_FILES; f++) {
+			snprintf(path, sizeof(path), "0:/dir%d/asset_%02d.cfg", d, f);
+			TEST_ASSERT_EQUAL(FR_OK, f_open(&fil, path, FA_READ));
+			size = _file_size(d, f);
+			TEST_ASSERT_EQUAL(size, f_size(&fil));
+			TEST_ASSERT_EQUAL(FR_OK, f_read(&fil, _buf, sizeof(_buf), &br));
+			TEST_ASSERT_EQUAL(size, br);
+			for (i = 0; i < size; i++)
+				TEST_ASSERT_EQUAL(_file_byte(d, f, i), _buf[i]);
+			TEST_ASSERT_EQUAL(FR_OK, f_close(&fil));
+		}
+	}
+	TEST_ASSERT_EQUAL(FR_OK, f_mount(NULL, "0:", 0));
+}
+
+static struct _ram_stats _bench_load(bool use_cache)
+{
+	_use_cache = use_cache;
+	memset(&_ram_stats, 0, sizeof(_ram_stats));
+	_load_tree();
+	return _ram_stats;
+}
+
+static void test_benchmark(void)
+{
+	struct _ram_stats raw, cached;
+
+	/* format and populate through the cache, then check the result
+	 * without it */
+	diskcache_detach(0);
+	_use_cache = true;
+	TEST_ASSERT_EQUAL(FR_OK, f_mount(&_fs, "0:", 0));
+	TEST_ASSERT_EQUAL(FR_OK, f_mkfs("0:", 1, 0));
+	TEST_ASSERT_EQUAL(FR_OK, f_mount(NULL, "0:", 0));
+	_create_tree();
+	diskcache_detach(0);
+
+	raw = _bench_load(false);
+	cached = _bench_load(true);
+
+	printf("    %d files, no cache: %u requests, %u sectors, %u ms\n",
+	       BENCH_DIRS * BENCH_FILES, raw.reads, raw.read_sectors,
+	       (unsigned)(raw.time_us / 1000));
+	printf("    %d files, cache:    %u requests, %u sectors, %u ms\n",
+	       BENCH_DIRS * BENCH_FILES, cached.reads, cached.read_sectors,
+	       (unsigned)(cached.time_us / 1000));
+
+	TEST_ASSERT_EQUAL(0, raw.writes);
+	TEST_ASSERT_EQUAL(0, cached.writes);
+	TEST_ASSERT(cached.reads * 2 < raw.reads);
+	TEST_ASSERT(cached.time_us * 2 < raw.time_us);
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	TEST_RUN(test_uninitialized);
+	TEST_RUN(test_hit_miss);
+	TEST_RUN(test_read_ahead);
+	TEST_RUN(test_write_back);
+	TEST_RUN(test_evict_dirty);
+	TEST_RUN(test_pinned);
+	TEST_RUN(test_bypass);
+	TEST_RUN(test_detach);
+	TEST_RUN(test_drives);
+	TEST_RUN(test_invalid);
+	TEST_RUN(test_benchmark);
+
+	return 0;
+}
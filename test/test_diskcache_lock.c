@@ -0,0 +1,412 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the FatFs sector cache locking, with _FS_REENTRANT. The
+ * sync objects are pthread mutexes which count the requests that had to
+ * wait. The RAM disk requests of the tests meet at a rendezvous, so that
+ * they only complete when the expected requests run at the same time: two
+ * drives shall be accessed in parallel, while a second request to a busy
+ * drive shall wait for its lock.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "test.h"
+
+#include "ff.h"
+#include "diskio.h"
+#include "fatfs/softpack/diskcache.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define SECTOR_SIZE 512
+
+#define DRIVE_SECTORS 1024
+
+/* rendezvous timeout */
+#define WAIT_MS 2000
+
+#define LOOPS 200
+
+/*----------------------------------------------------------------------------
+ *         Local types
+ *----------------------------------------------------------------------------*/
+
+struct _sync_obj {
+	pthread_mutex_t mutex;
+	BYTE vol;
+	uint32_t waits;
+};
+
+struct _task {
+	pthread_t thread;
+	BYTE pdrv;
+	DWORD first;
+	bool write;
+	bool ok;
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static uint8_t _drives[_VOLUMES][DRIVE_SECTORS][SECTOR_SIZE];
+
+static struct _sync_obj _sync_objs[_VOLUMES];
+static int _sync_count;
+
+static pthread_mutex_t _state_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _state_cond = PTHREAD_COND_INITIALIZER;
+
+/* device requests in progress, per drive and in total */
+static int _in_flight[_VOLUMES];
+static int _in_flight_total;
+static int _max_in_flight[_VOLUMES];
+static int _max_in_flight_total;
+
+/* number of requests that shall be in progress, or waiting for a lock,
+ * before the first device request of a test completes */
+static int _rendezvous_in_flight;
+static int _rendezvous_waits;
+static bool _rendezvous_done;
+static bool _rendezvous_timeout;
+
+/*----------------------------------------------------------------------------
+ *         Sync objects
+ *----------------------------------------------------------------------------*/
+
+int ff_cre_syncobj(BYTE vol, _SYNC_t* sobj)
+{
+	struct _sync_obj* obj;
+
+	if (_sync_count >= _VOLUMES)
+		return 0;
+	obj = &_sync_objs[_sync_count++];
+	pthread_mutex_init(&obj->mutex, NULL);
+	obj->vol = vol;
+	obj->waits = 0;
+	*sobj = obj;
+	return 1;
+}
+
+int ff_del_syncobj(_SYNC_t sobj)
+{
+	struct _sync_obj* obj = sobj;
+
+	pthread_mutex_destroy(&obj->mutex);
+	return 1;
+}
+
+int ff_req_grant(_SYNC_t sobj)
+{
+	struct _sync_obj* obj = sobj;
+
+	if (pthread_mutex_trylock(&obj->mutex) != 0) {
+		pthread_mutex_lock(&_state_mutex);
+		obj->waits++;
+		pthread_cond_broadcast(&_state_cond);
+		pthread_mutex_unlock(&_state_mutex);
+		pthread_mutex_lock(&obj->mutex);
+	}
+	return 1;
+}
+
+void ff_rel_grant(_SYNC_t sobj)
+{
+	struct _sync_obj* obj = sobj;
+
+	pthread_mutex_unlock(&obj->mutex);
+}
+
+static uint32_t _total_waits(void)
+{
+	uint32_t waits = 0;
+	int i;
+
+	for (i = 0; i < _sync_count; i++)
+		waits += _sync_objs[i].waits;
+	return waits;
+}
+
+/*----------------------------------------------------------------------------
+ *         RAM disks
+ *----------------------------------------------------------------------------*/
+
+static bool _rendezvous_reached(void)
+{
+	return _in_flight_total >= _rendezvous_in_flight &&
+	       _total_waits() >= (uint32_t)_rendezvous_waits;
+}
+
+static void _request_begin(BYTE pdrv)
+{
+	struct timespec deadline;
+
+	pthread_mutex_lock(&_state_mutex);
+	_in_flight[pdrv]++;
+	_in_flight_total++;
+	if (_in_flight[pdrv] > _max_in_flight[pdrv])
+		_max_in_flight[pdrv] = _in_flight[pdrv];
+	if (_in_flight_total > _max_in_flight_total)
+		_max_in_flight_total = _in_flight_total;
+	pthread_cond_broadcast(&_state_cond);
+
+	/* hold the first requests until the rendezvous is reached */
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += WAIT_MS / 1000;
+	while (!_rendezvous_done && !_rendezvous_reached()) {
+		if (pthread_cond_timedwait(&_state_cond, &_state_mutex,
+					   &deadline) != 0) {
+			_rendezvous_timeout = true;
+			break;
+		}
+	}
+	_rendezvous_done = true;
+	pthread_cond_broadcast(&_state_cond);
+	pthread_mutex_unlock(&_state_mutex);
+}
+
+static void _request_end(BYTE pdrv)
+{
+	pthread_mutex_lock(&_state_mutex);
+	_in_flight[pdrv]--;
+	_in_flight_total--;
+	pthread_mutex_unlock(&_state_mutex);
+}
+
+static DRESULT _ram_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
+{
+	TEST_ASSERT(pdrv < _VOLUMES);
+	TEST_ASSERT(count > 0 && sector + count <= DRIVE_SECTORS);
+	_request_begin(pdrv);
+	memcpy(buff, _drives[pdrv][sector], count * SECTOR_SIZE);
+	_request_end(pdrv);
+	return RES_OK;
+}
+
+static DRESULT _ram_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
+{
+	TEST_ASSERT(pdrv < _VOLUMES);
+	TEST_ASSERT(count > 0 && sector + count <= DRIVE_SECTORS);
+	_request_begin(pdrv);
+	memcpy(_drives[pdrv][sector], buff, count * SECTOR_SIZE);
+	_request_end(pdrv);
+	return RES_OK;
+}
+
+static const struct _diskcache_ops _ram_ops = {
+	.read = _ram_read,
+	.write = _ram_write,
+};
+
+/*----------------------------------------------------------------------------
+ *         Helpers
+ *----------------------------------------------------------------------------*/
+
+static uint8_t _sector_byte(BYTE pdrv, DWORD sector, int i)
+{
+	return (uint8_t)(pdrv * 101 + sector * 7 + i);
+}
+
+static void _setup(int in_flight, int waits)
+{
+	BYTE pdrv;
+	DWORD s;
+	int i;
+
+	for (pdrv = 0; pdrv < _VOLUMES; pdrv++) {
+		for (s = 0; s < DRIVE_SECTORS; s++)
+			for (i = 0; i < SECTOR_SIZE; i++)
+				_drives[pdrv][s][i] = _sector_byte(pdrv, s, i);
+		diskcache_attach(pdrv, &_ram_ops, DRIVE_SECTORS);
+		_max_in_flight[pdrv] = 0;
+	}
+	for (i = 0; i < _sync_count; i++)
+		_sync_objs[i].waits = 0;
+	_max_in_flight_total = 0;
+	_rendezvous_in_flight = in_flight;
+	_rendezvous_waits = waits;
+	_rendezvous_done = false;
+	_rendezvous_timeout = false;
+}
+
+/* Read or write LOOPS runs of sectors of a drive, checking the data read.
+ * The ranges of the tasks do not overlap. */
+static void* _task_run(void* arg)
+{
+	struct _task* task = arg;
+	uint8_t buf[4 * SECTOR_SIZE];
+	DWORD sector;
+	int loop, i;
+
+	task->ok = true;
+	for (loop = 0; loop < LOOPS; loop++) {
+		sector = task->first + (loop * 4) % 256;
+		if (task->write) {
+			memset(buf, (uint8_t)loop, sizeof(buf));
+			if (diskcache_write(task->pdrv, buf, sector, 4) != RES_OK)
+				task->ok = false;
+			continue;
+		}
+		if (diskcache_read(task->pdrv, buf, sector, 4) != RES_OK) {
+			task->ok = false;
+			continue;
+		}
+		for (i = 0; i < (int)sizeof(buf); i++)
+			if (buf[i] != _sector_byte(task->pdrv, sector + i / SECTOR_SIZE,
+						   i % SECTOR_SIZE))
+				task->ok = false;
+	}
+	if (task->write && diskcache_sync(task->pdrv) != RES_OK)
+		task->ok = false;
+	return NULL;
+}
+
+static void _run_tasks(struct _task* tasks, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		TEST_ASSERT_EQUAL(0, pthread_create(&tasks[i].thread, NULL,
+						    _task_run, &tasks[i]));
+	for (i = 0; i < count; i++) {
+		pthread_join(tasks[i].thread, NULL);
+		TEST_ASSERT(tasks[i].ok);
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+/* the sync objects are created once, by diskcache_init(), one per drive */
+static void test_init(void)
+{
+	uint8_t buf[SECTOR_SIZE];
+	int i;
+
+	TEST_ASSERT_EQUAL(RES_NOTRDY, diskcache_read(0, buf, 0, 1));
+	TEST_ASSERT_EQUAL(0, _sync_count);
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_init());
+	TEST_ASSERT_EQUAL(_VOLUMES, _sync_count);
+	for (i = 0; i < _VOLUMES; i++)
+		TEST_ASSERT_EQUAL(i, _sync_objs[i].vol);
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_init());
+	TEST_ASSERT_EQUAL(_VOLUMES, _sync_count);
+}
+
+/* device requests to two drives run at the same time */
+static void test_parallel_drives(void)
+{
+	struct _task tasks[2] = {
+		{ .pdrv = 0, .first = 0 },
+		{ .pdrv = 1, .first = 0 },
+	};
+
+	_setup(2, 0);
+	_run_tasks(tasks, 2);
+	TEST_ASSERT(!_rendezvous_timeout);
+	TEST_ASSERT_EQUAL(2, _max_in_flight_total);
+	TEST_ASSERT_EQUAL(1, _max_in_flight[0]);
+	TEST_ASSERT_EQUAL(1, _max_in_flight[1]);
+	TEST_ASSERT_EQUAL(0, _total_waits());
+}
+
+/* a request to a drive waits while another task accesses it */
+static void test_same_drive(void)
+{
+	struct _task tasks[2] = {
+		{ .pdrv = 0, .first = 0 },
+		{ .pdrv = 0, .first = 512 },
+	};
+
+	_setup(1, 1);
+	_run_tasks(tasks, 2);
+	TEST_ASSERT(!_rendezvous_timeout);
+	TEST_ASSERT_EQUAL(1, _max_in_flight[0]);
+	TEST_ASSERT(_sync_objs[0].waits > 0);
+	TEST_ASSERT_EQUAL(0, _sync_objs[1].waits);
+}
+
+/* concurrent writers to the same drive and to another drive keep their
+ * data */
+static void test_writers(void)
+{
+	struct _task tasks[3] = {
+		{ .pdrv = 0, .first = 0, .write = true },
+		{ .pdrv = 0, .first = 512, .write = true },
+		{ .pdrv = 1, .first = 0, .write = true },
+	};
+	DWORD s;
+	int t, i, last;
+
+	_setup(0, 0);
+	_run_tasks(tasks, 3);
+	TEST_ASSERT_EQUAL(1, _max_in_flight[0]);
+	TEST_ASSERT_EQUAL(1, _max_in_flight[1]);
+
+	/* each run of 4 sectors holds the number of the last loop writing it */
+	for (t = 0; t < 3; t++) {
+		for (s = 0; s < 256; s++) {
+			last = LOOPS - 1;
+			while ((last * 4) % 256 != (int)(s & ~3u))
+				last--;
+			for (i = 0; i < SECTOR_SIZE; i++)
+				TEST_ASSERT_EQUAL((uint8_t)last,
+				    _drives[tasks[t].pdrv][tasks[t].first + s][i]);
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	TEST_RUN(test_init);
+	TEST_RUN(test_parallel_drives);
+	TEST_RUN(test_same_drive);
+	TEST_RUN(test_writers);
+	return 0;
+}
@@ -0,0 +1,505 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the CTR_DRBG (AES-256, no derivation function) against
+ * known-answer vectors. The AES peripheral is replaced by a software AES-256
+ * ECB encryption checked against the FIPS-197 vector, and the TRNG entropy
+ * pool by a deterministic byte source whose fill level and health state are
+ * set by each test.
+ *
+ * The expected outputs follow the CAVP CTR_DRBG procedure: instantiate,
+ * optional reseed, one generate call whose output is discarded, and a
+ * second generate call whose 512-bit output is checked.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "errno.h"
+#include "test.h"
+#include "trace.h"
+
+#include "crypto/aesd.h"
+#include "crypto/drbg.h"
+#include "crypto/trngd.h"
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+static uint8_t _sbox[256];
+
+/* simulated entropy pool */
+static uint8_t _pool[DRBG_SEED_SIZE];
+static uint32_t _pool_available;
+static bool _pool_healthy;
+static uint32_t _pool_reads;
+
+/* number of AES transfers */
+static uint32_t _aes_transfers;
+
+static struct _aesd_desc _aesd;
+static struct _drbg_desc _drbg = { .aes = &_aesd };
+
+/*----------------------------------------------------------------------------
+ *         Software AES-256 (encryption only)
+ *----------------------------------------------------------------------------*/
+
+static uint8_t _xtime(uint8_t x)
+{
+	return (x << 1) ^ ((x & 0x80) ? 0x1b : 0);
+}
+
+static uint8_t _gmul(uint8_t a, uint8_t b)
+{
+	uint8_t p = 0;
+
+	while (b) {
+		if (b & 1)
+			p ^= a;
+		a = _xtime(a);
+		b >>= 1;
+	}
+	return p;
+}
+
+static void _aes_init_sbox(void)
+{
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		uint8_t inv = 0, s;
+
+		/* multiplicative inverse in GF(2^8), 0 maps to 0 */
+		for (j = 1; j < 256 && i; j++) {
+			if (_gmul(i, j) == 1) {
+				inv = j;
+				break;
+			}
+		}
+		/* affine transformation */
+		s = inv;
+		for (j = 1; j < 5; j++)
+			s ^= (uint8_t)((inv << j) | (inv >> (8 - j)));
+		_sbox[i] = s ^ 0x63;
+	}
+}
+
+static void _aes256_expand_key(const uint8_t* key, uint8_t* rk)
+{
+	uint8_t rcon = 1;
+	int i, j;
+
+	memcpy(rk, key, 32);
+	for (i = 8; i < 60; i++) {
+		uint8_t t[4];
+
+		memcpy(t, &rk[(i - 1) * 4], 4);
+		if ((i % 8) == 0) {
+			uint8_t u = t[0];
+
+			t[0] = _sbox[t[1]] ^ rcon;
+			t[1] = _sbox[t[2]];
+			t[2] = _sbox[t[3]];
+			t[3] = _sbox[u];
+			rcon = _xtime(rcon);
+		} else if ((i % 8) == 4) {
+			for (j = 0; j < 4; j++)
+				t[j] = _sbox[t[j]];
+		}
+		for (j = 0; j < 4; j++)
+			rk[i * 4 + j] = rk[(i - 8) * 4 + j] ^ t[j];
+	}
+}
+
+static void _aes256_encrypt_block(const uint8_t* rk, const uint8_t* in,
+				  uint8_t* out)
+{
+	uint8_t s[16], t[16];
+	int round, i, c;
+
+	for (i = 0; i < 16; i++)
+		s[i] = in[i] ^ rk[i];
+
+	for (round = 1; round <= 14; round++) {
+		/* SubBytes and ShiftRows */
+		for (c = 0; c < 4; c++)
+			for (i = 0; i < 4; i++)
+				t[c * 4 + i] = _sbox[s[((c + i) % 4) * 4 + i]];
+		/* MixColumns, except in the last round */
+		if (round < 14) {
+			for (c = 0; c < 4; c++) {
+				uint8_t* col = &t[c * 4];
+				uint8_t a0 = col[0], a1 = col[1];
+				uint8_t a2 = col[2], a3 = col[3];
+
+				col[0] = _xtime(a0) ^ _xtime(a1) ^ a1 ^ a2 ^ a3;
+				col[1] = a0 ^ _xtime(a1) ^ _xtime(a2) ^ a2 ^ a3;
+				col[2] = a0 ^ a1 ^ _xtime(a2) ^ _xtime(a3) ^ a3;
+				col[3] = _xtime(a0) ^ a0 ^ a1 ^ a2 ^ _xtime(a3);
+			}
+		}
+		for (i = 0; i < 16; i++)
+			s[i] = t[i] ^ rk[round * 16 + i];
+	}
+	memcpy(out, s, 16);
+}
+
+/*----------------------------------------------------------------------------
+ *         Simulated drivers
+ *----------------------------------------------------------------------------*/
+
+uint32_t aesd_transfer(struct _aesd_desc* desc, struct _buffer* buffer_in,
+		       struct _buffer* buffer_out, struct _buffer* buffer_aad,
+		       struct _callback* callback)
+{
+	uint8_t rk[240];
+	uint32_t i;
+
+	TEST_ASSERT(desc->cfg.encrypt);
+	TEST_ASSERT_EQUAL(AESD_MODE_ECB, desc->cfg.mode);
+	TEST_ASSERT_EQUAL(AESD_AES256, desc->cfg.key_size);
+	TEST_ASSERT_EQUAL(buffer_in->size, buffer_out->size);
+	TEST_ASSERT((buffer_in->size % AES_BLOCK_SIZE) == 0);
+
+	_aes256_expand_key((const uint8_t*)desc->cfg.key, rk);
+	for (i = 0; i < buffer_in->size; i += AES_BLOCK_SIZE)
+		_aes256_encrypt_block(rk, &buffer_in->data[i],
+				      &buffer_out->data[i]);
+	_aes_transfers++;
+
+	return AESD_SUCCESS;
+}
+
+void aesd_wait_transfer(struct _aesd_desc* desc)
+{
+}
+
+bool trngd_is_healthy(void)
+{
+	return _pool_healthy;
+}
+
+uint32_t trngd_get_available(void)
+{
+	return _pool_available;
+}
+
+int trngd_read(uint8_t* data, uint32_t len)
+{
+	if (!_pool_healthy)
+		return -EIO;
+	if (len > _pool_available)
+		len = _pool_available;
+	memcpy(data, _pool, len);
+	_pool_available -= len;
+	_pool_reads++;
+	return len;
+}
+
+bool mutex_try_lock(mutex_t* mutex)
+{
+	if (*mutex)
+		return false;
+	*mutex = 1;
+	return true;
+}
+
+void mutex_lock(mutex_t* mutex)
+{
+	TEST_ASSERT(mutex_try_lock(mutex));
+}
+
+void mutex_unlock(mutex_t* mutex)
+{
+	*mutex = 0;
+}
+
+/*----------------------------------------------------------------------------
+ *         Helpers
+ *----------------------------------------------------------------------------*/
+
+static void _hex(const char* hex, uint8_t* out)
+{
+	while (hex[0] && hex[1]) {
+		unsigned int byte;
+
+		TEST_ASSERT(sscanf(hex, "%2x", &byte) == 1);
+		*out++ = byte;
+		hex += 2;
+	}
+}
+
+static void _fill(uint8_t* data, uint32_t len, uint8_t first)
+{
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+		data[i] = first + i;
+}
+
+static void _check_bytes(const uint8_t* data, const char* expected_hex)
+{
+	uint8_t expected[64];
+	uint32_t len = strlen(expected_hex) / 2;
+
+	TEST_ASSERT(len <= sizeof(expected));
+	_hex(expected_hex, expected);
+	TEST_ASSERT(memcmp(data, expected, len) == 0);
+}
+
+static void _pool_set(uint8_t first, uint32_t available)
+{
+	_fill(_pool, sizeof(_pool), first);
+	_pool_available = available;
+	_pool_healthy = true;
+	_pool_reads = 0;
+}
+
+static void _instantiate(const uint8_t* pers, uint32_t pers_len)
+{
+	uint8_t entropy[DRBG_SEED_SIZE];
+	struct _buffer buf = {
+		.data = (uint8_t*)pers,
+		.size = pers_len,
+	};
+
+	_fill(entropy, sizeof(entropy), 0x00);
+	TEST_ASSERT_EQUAL(0, drbg_instantiate(&_drbg, entropy,
+					      pers ? &buf : NULL));
+}
+
+static void _generate(uint8_t* data, uint32_t len, const uint8_t* add,
+		      uint32_t add_len)
+{
+	struct _buffer out = {
+		.data = data,
+		.size = len,
+	};
+	struct _buffer buf = {
+		.data = (uint8_t*)add,
+		.size = add_len,
+	};
+
+	TEST_ASSERT_EQUAL(0, drbg_generate(&_drbg, &out, add ? &buf : NULL));
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+/* FIPS-197 appendix C.3 */
+static void test_aes_model(void)
+{
+	uint8_t key[32], in[16], out[16], rk[240];
+
+	_fill(key, sizeof(key), 0x00);
+	_hex("00112233445566778899aabbccddeeff", in);
+	_aes256_expand_key(key, rk);
+	_aes256_encrypt_block(rk, in, out);
+	_check_bytes(out, "8ea2b7ca516745bfeafc49904b496089");
+}
+
+static void test_kat_no_input(void)
+{
+	uint8_t out[64];
+
+	_instantiate(NULL, 0);
+	_generate(out, sizeof(out), NULL, 0);
+	_generate(out, sizeof(out), NULL, 0);
+	_check_bytes(out,
+		"04562ad35e8ecafaafda16981cdaa147606beea62801342af13c8b5535f72f94"
+		"95b74317c762f0adab7abe710797612176b61b0e208398113cf9c170157bc75f");
+}
+
+static void test_kat_inputs(void)
+{
+	uint8_t pers[32], entropy[DRBG_SEED_SIZE], add1[16], add2[16];
+	uint8_t out[64];
+	struct _buffer add = {
+		.data = add1,
+		.size = sizeof(add1),
+	};
+
+	_fill(pers, sizeof(pers), 0x40);
+	_fill(entropy, sizeof(entropy), 0x80);
+	_fill(add1, sizeof(add1), 0x60);
+	_fill(add2, sizeof(add2), 0xa0);
+
+	_instantiate(pers, sizeof(pers));
+	TEST_ASSERT_EQUAL(0, drbg_reseed(&_drbg, entropy, &add));
+	_generate(out, sizeof(out), add1, sizeof(add1));
+	_generate(out, sizeof(out), add2, sizeof(add2));
+	_check_bytes(out,
+		"4c2c538d406fe548681ab2b458edad435d3f2bc694d36ab998edd608927c5e2f"
+		"021229ebf778e6165b1506e6dda5ae1e629046473590d5d6c7a222b46a95975c");
+}
+
+/* requests longer than the transfer buffer are split in several AES
+ * transfers without breaking the counter sequence */
+static void test_long_request(void)
+{
+	static uint8_t out[600];
+	uint32_t transfers;
+
+	_instantiate(NULL, 0);
+	transfers = _aes_transfers;
+	_generate(out, sizeof(out), NULL, 0);
+	/* three output chunks plus the final update */
+	TEST_ASSERT_EQUAL(4, _aes_transfers - transfers);
+	_check_bytes(&out[0], "061550234d158c5ec95595fe04ef7a25");
+	_check_bytes(&out[256], "b8355a67565d3bdcb0973aa5f4c5971b");
+	_check_bytes(&out[584], "d56b3b72b8db114934e5699f5bae6af3");
+}
+
+/* drbg_rand() returns the generated stream four bytes at a time and
+ * refills its buffer with a new generate request */
+static void test_rand(void)
+{
+	uint32_t value;
+	int i;
+
+	_instantiate(NULL, 0);
+	TEST_ASSERT_EQUAL(0, drbg_rand(&_drbg, &value));
+	TEST_ASSERT_EQUAL(0x23501506, value);
+	TEST_ASSERT_EQUAL(0, drbg_rand(&_drbg, &value));
+	TEST_ASSERT_EQUAL(0x5e8c154d, value);
+	for (i = 2; i < 64; i++)
+		TEST_ASSERT_EQUAL(0, drbg_rand(&_drbg, &value));
+	TEST_ASSERT_EQUAL(0x64cc795d, value);
+	TEST_ASSERT_EQUAL(0, drbg_rand(&_drbg, &value));
+	TEST_ASSERT_EQUAL(0x40037ec1, value);
+}
+
+/* errors are reported separately from the value, which is left untouched */
+static void test_rand_errors(void)
+{
+	uint32_t value = 0xdeadbeef;
+
+	drbg_uninstantiate(&_drbg);
+	TEST_ASSERT_EQUAL(-EINVAL, drbg_rand(&_drbg, &value));
+	TEST_ASSERT_EQUAL(0xdeadbeef, value);
+
+	_instantiate(NULL, 0);
+	_drbg.mutex = 1;
+	TEST_ASSERT_EQUAL(-EBUSY, drbg_rand(&_drbg, &value));
+	TEST_ASSERT_EQUAL(0xdeadbeef, value);
+	_drbg.mutex = 0;
+
+	TEST_ASSERT_EQUAL(0, drbg_rand(&_drbg, &value));
+	TEST_ASSERT_EQUAL(0x23501506, value);
+}
+
+/* seeds read from the entropy pool, and the automatic reseed after
+ * DRBG_RESEED_INTERVAL generate requests */
+static void test_entropy_pool(void)
+{
+	uint8_t out[16];
+	int i;
+
+	drbg_uninstantiate(&_drbg);
+	_pool_set(0x00, DRBG_SEED_SIZE - 1);
+	TEST_ASSERT_EQUAL(-EAGAIN, drbg_instantiate(&_drbg, NULL, NULL));
+	_pool_healthy = false;
+	TEST_ASSERT_EQUAL(-EIO, drbg_instantiate(&_drbg, NULL, NULL));
+
+	_pool_set(0x00, DRBG_SEED_SIZE);
+	TEST_ASSERT_EQUAL(0, drbg_instantiate(&_drbg, NULL, NULL));
+	TEST_ASSERT_EQUAL(1, _pool_reads);
+	TEST_ASSERT_EQUAL(0, _pool_available);
+
+	for (i = 0; i < DRBG_RESEED_INTERVAL; i++)
+		_generate(out, sizeof(out), NULL, 0);
+	TEST_ASSERT_EQUAL(1, _pool_reads);
+
+	/* reseed required, but the pool is empty */
+	TEST_ASSERT_EQUAL(-EAGAIN, drbg_generate(&_drbg,
+		&(struct _buffer){ .data = out, .size = sizeof(out) }, NULL));
+
+	_pool_set(0x80, DRBG_SEED_SIZE);
+	_generate(out, sizeof(out), NULL, 0);
+	TEST_ASSERT_EQUAL(1, _pool_reads);
+	_check_bytes(out, "b0d976718453c7be7df1c8d007851160");
+}
+
+static void test_invalid(void)
+{
+	uint8_t data[DRBG_SEED_SIZE + 1];
+	struct _buffer big = {
+		.data = data,
+		.size = sizeof(data),
+	};
+	struct _buffer out = {
+		.data = data,
+		.size = 16,
+	};
+
+	_fill(data, sizeof(data), 0);
+	_instantiate(NULL, 0);
+	TEST_ASSERT_EQUAL(-EINVAL, drbg_reseed(&_drbg, data, &big));
+	TEST_ASSERT_EQUAL(-EINVAL, drbg_generate(&_drbg, &out, &big));
+	out.size = DRBG_MAX_REQUEST_SIZE + 1;
+	TEST_ASSERT_EQUAL(-EINVAL, drbg_generate(&_drbg, &out, NULL));
+
+	drbg_uninstantiate(&_drbg);
+	out.size = 16;
+	TEST_ASSERT_EQUAL(-EINVAL, drbg_generate(&_drbg, &out, NULL));
+	TEST_ASSERT_EQUAL(-EINVAL, drbg_reseed(&_drbg, data, NULL));
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	_aes_init_sbox();
+
+	TEST_RUN(test_aes_model);
+	TEST_RUN(test_kat_no_input);
+	TEST_RUN(test_kat_inputs);
+	TEST_RUN(test_long_request);
+	TEST_RUN(test_rand);
+	TEST_RUN(test_rand_errors);
+	TEST_RUN(test_entropy_pool);
+	TEST_RUN(test_invalid);
+
+	return 0;
+}
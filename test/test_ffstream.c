@@ -0,0 +1,484 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the FatFs contiguous streams on a RAM disk. The disk I/O
+ * layer goes through the sector cache, as in sdmmc_ff.c, and the RAM disk
+ * counts the device requests and models their duration with a command
+ * time plus a time per sector.
+ *
+ * After each stream is closed, the volume is mounted again and checked.
+ * The file size and content must match what was written. The FAT chain
+ * must be one contiguous run with no clusters left beyond the data. The
+ * free cluster count must match the clusters actually used. Closing is
+ * also compared with an abandoned stream. The throughput case writes the
+ * same file with f_write() and with a stream and prints both results.
+ *
+ * The FatFs version in the tree can only format FAT volumes, so the exFAT
+ * contiguous flag is not covered here.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+
+#include "ff.h"
+#include "diskio.h"
+#include "fatfs/softpack/diskcache.h"
+#include "fatfs/softpack/ffstream.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define SECTOR_SIZE 512
+#define DISK_SECTORS (64 * 1024)
+
+/* latency model, close to an SD card in high speed mode */
+#define CMD_US 200
+#define SECTOR_US 20
+
+/* chunk sizes of the throughput test */
+#define FWRITE_CHUNK 4096
+#define STREAM_CHUNK (128 * 1024)
+#define BENCH_SIZE (8 * 1024 * 1024)
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static uint8_t _disk[DISK_SECTORS][SECTOR_SIZE];
+
+static struct {
+	uint32_t writes;
+	uint32_t write_sectors;
+	uint64_t time_us;
+} _disk_stats;
+
+static FATFS _fs;
+static FIL _fil;
+
+static uint8_t _buf[STREAM_CHUNK];
+
+/*----------------------------------------------------------------------------
+ *         RAM disk and disk I/O layer
+ *----------------------------------------------------------------------------*/
+
+static DRESULT _ram_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
+{
+	TEST_ASSERT(count > 0 && sector + count <= DISK_SECTORS);
+	memcpy(buff, _disk[sector], count * SECTOR_SIZE);
+	_disk_stats.time_us += CMD_US + count * SECTOR_US;
+	return RES_OK;
+}
+
+static DRESULT _ram_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
+{
+	TEST_ASSERT(count > 0 && sector + count <= DISK_SECTORS);
+	memcpy(_disk[sector], buff, count * SECTOR_SIZE);
+	_disk_stats.writes++;
+	_disk_stats.write_sectors += count;
+	_disk_stats.time_us += CMD_US + count * SECTOR_US;
+	return RES_OK;
+}
+
+static const struct _diskcache_ops _ram_ops = {
+	.read = _ram_read,
+	.write = _ram_write,
+};
+
+DSTATUS disk_initialize(BYTE pdrv)
+{
+	if (pdrv != 0)
+		return STA_NOINIT;
+	diskcache_attach(pdrv, &_ram_ops, DISK_SECTORS);
+	return 0;
+}
+
+DSTATUS disk_status(BYTE pdrv)
+{
+	return pdrv == 0 ? 0 : STA_NOINIT;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
+{
+	return diskcache_read(pdrv, buff, sector, count);
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
+{
+	return diskcache_write(pdrv, buff, sector, count);
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff)
+{
+	switch (cmd) {
+	case CTRL_SYNC:
+		return diskcache_sync(pdrv);
+	case GET_SECTOR_COUNT:
+		*(DWORD*)buff = DISK_SECTORS;
+		return RES_OK;
+	case GET_SECTOR_SIZE:
+		*(WORD*)buff = SECTOR_SIZE;
+		return RES_OK;
+	case GET_BLOCK_SIZE:
+		*(DWORD*)buff = 1;
+		return RES_OK;
+	default:
+		return RES_PARERR;
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *         Helpers
+ *----------------------------------------------------------------------------*/
+
+static uint8_t _data_byte(uint32_t offset)
+{
+	return (uint8_t)(offset * 7 + (offset >> 9));
+}
+
+static void _fill(uint8_t* data, uint32_t offset, uint32_t len)
+{
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+		data[i] = _data_byte(offset + i);
+}
+
+static void _mount(void)
+{
+	memset(&_fs, 0, sizeof(_fs));
+	TEST_ASSERT_EQUAL(FR_OK, f_mount(&_fs, "0:", 1));
+}
+
+static void _unmount(void)
+{
+	TEST_ASSERT_EQUAL(FR_OK, f_mount(NULL, "0:", 0));
+}
+
+static void _format(void)
+{
+	memset(_disk, 0, sizeof(_disk));
+	TEST_ASSERT_EQUAL(RES_OK, diskcache_init());
+	TEST_ASSERT_EQUAL(FR_OK, f_mount(&_fs, "0:", 0));
+	/* 2 KB clusters, for a FAT16 volume */
+	TEST_ASSERT_EQUAL(FR_OK, f_mkfs("0:", 1, 2048));
+	_unmount();
+	_mount();
+	TEST_ASSERT_EQUAL(FS_FAT16, _fs.fs_type);
+}
+
+/* FAT16 entry, read from the media */
+static DWORD _fat_entry(DWORD clst)
+{
+	DWORD offset = clst * 2;
+	const uint8_t* sector = _disk[_fs.fatbase + offset / SECTOR_SIZE];
+
+	return sector[offset % SECTOR_SIZE] |
+	       (sector[offset % SECTOR_SIZE + 1] << 8);
+}
+
+/* number of free clusters, counted again after a mount */
+static DWORD _count_free(void)
+{
+	FATFS* fs;
+	DWORD nclst;
+
+	_unmount();
+	_mount();
+	TEST_ASSERT_EQUAL(FR_OK, f_getfree("0:", &nclst, &fs));
+	return nclst;
+}
+
+/* check a closed file: size, content, contiguous FAT chain; returns the
+ * cluster following the chain */
+static DWORD _check_file(const char* path, uint32_t size)
+{
+	DWORD csz = _fs.csize * SECTOR_SIZE;
+	DWORD clusters = (size + csz - 1) / csz;
+	DWORD clst, i;
+	uint32_t offset;
+	UINT br;
+
+	TEST_ASSERT_EQUAL(FR_OK, f_open(&_fil, path, FA_READ));
+	TEST_ASSERT_EQUAL(size, f_size(&_fil));
+
+	clst = _fil.obj.sclust;
+	for (i = 0; i + 1 < clusters; i++)
+		TEST_ASSERT_EQUAL(clst + i + 1, _fat_entry(clst + i));
+	TEST_ASSERT(_fat_entry(clst + clusters - 1) >= 0xfff8);
+
+	for (offset = 0; offset < size; offset += br) {
+		uint32_t j;
+
+		TEST_ASSERT_EQUAL(FR_OK, f_read(&_fil, _buf, sizeof(_buf), &br));
+		TEST_ASSERT(br > 0);
+		for (j = 0; j < br; j++)
+			TEST_ASSERT_EQUAL(_data_byte(offset + j), _buf[j]);
+	}
+	TEST_ASSERT_EQUAL(size, offset);
+	TEST_ASSERT_EQUAL(FR_OK, f_close(&_fil));
+
+	return clst + clusters;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+/* the extent covers the preallocated clusters, which are accounted as
+ * used without a new scan of the FAT */
+static void test_extent(void)
+{
+	struct _ffstream stream;
+	DWORD lba, sectors, free_before;
+	FATFS* fs;
+	DWORD nclst;
+
+	_format();
+	free_before = _count_free();
+
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_create(&stream, &_fil, "0:/rec.bin", 1000000));
+	ffstream_get_extent(&stream, &lba, &sectors);
+	TEST_ASSERT_EQUAL(_fs.database + _fs.csize * (_fil.obj.sclust - 2), lba);
+	TEST_ASSERT_EQUAL((1000000 + SECTOR_SIZE - 1) / SECTOR_SIZE, sectors);
+	TEST_ASSERT_EQUAL((FSIZE_t)sectors * SECTOR_SIZE, ffstream_get_free(&stream));
+
+	TEST_ASSERT_EQUAL(FR_OK, f_getfree("0:", &nclst, &fs));
+	TEST_ASSERT_EQUAL(free_before - (1000000 + _fs.csize * SECTOR_SIZE - 1) /
+			  (_fs.csize * SECTOR_SIZE), nclst);
+
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_close(&stream));
+	TEST_ASSERT_EQUAL(free_before, _count_free());
+}
+
+/* whole-sector writes followed by a partial one, the file is shrunk to the
+ * data length on close */
+static void test_write_close(void)
+{
+	const uint32_t size = 700 * 1024 + 100;
+	struct _ffstream stream;
+	DWORD free_before, csz;
+	uint32_t offset, len;
+
+	_format();
+	free_before = _count_free();
+	csz = _fs.csize * SECTOR_SIZE;
+
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_create(&stream, &_fil, "0:/rec.bin", 2 * 1024 * 1024));
+	for (offset = 0; offset < size; offset += len) {
+		len = size - offset;
+		if (len > 64 * 1024)
+			len = 64 * 1024;
+		_fill(_buf, offset, len);
+		TEST_ASSERT_EQUAL(FR_OK, ffstream_write(&stream, _buf, len));
+	}
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_close(&stream));
+
+	TEST_ASSERT_EQUAL(free_before - (size + csz - 1) / csz, _count_free());
+	/* the unused clusters of the preallocated block were released */
+	TEST_ASSERT_EQUAL(0, _fat_entry(_check_file("0:/rec.bin", size)));
+
+	/* the stream data does not stay in the cache */
+	TEST_ASSERT_EQUAL(FR_OK, diskcache_sync(0));
+}
+
+static void test_denied(void)
+{
+	struct _ffstream stream;
+
+	_format();
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_create(&stream, &_fil, "0:/rec.bin", 4096));
+
+	/* larger than the extent */
+	TEST_ASSERT_EQUAL(FR_DENIED, ffstream_write(&stream, _buf, 4097));
+
+	/* a partial sector terminates the stream */
+	_fill(_buf, 0, 1000);
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_write(&stream, _buf, 1000));
+	TEST_ASSERT_EQUAL(0, ffstream_get_free(&stream));
+	TEST_ASSERT_EQUAL(FR_DENIED, ffstream_write(&stream, _buf, SECTOR_SIZE));
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_close(&stream));
+
+	TEST_ASSERT_EQUAL(FR_INVALID_OBJECT, ffstream_write(&stream, _buf, SECTOR_SIZE));
+	TEST_ASSERT_EQUAL(FR_INVALID_OBJECT, ffstream_close(&stream));
+
+	_unmount();
+	_mount();
+	_check_file("0:/rec.bin", 1000);
+}
+
+/* no contiguous block large enough on a fragmented volume */
+static void test_fragmented(void)
+{
+	struct _ffstream stream;
+	char path[16];
+	DWORD csz, free_clst;
+	UINT bw;
+	int i, files;
+
+	_format();
+	csz = _fs.csize * SECTOR_SIZE;
+	free_clst = _count_free();
+
+	/* fill the volume with one-cluster files and delete every other one */
+	memset(_buf, 0, csz);
+	TEST_ASSERT_EQUAL(FR_OK, f_mkdir("0:/d"));
+	for (files = 0; ; files++) {
+		snprintf(path, sizeof(path), "0:/d/%d", files);
+		TEST_ASSERT_EQUAL(FR_OK, f_open(&_fil, path, FA_WRITE | FA_CREATE_NEW));
+		TEST_ASSERT_EQUAL(FR_OK, f_write(&_fil, _buf, csz, &bw));
+		TEST_ASSERT_EQUAL(FR_OK, f_close(&_fil));
+		if (bw < csz)
+			break;
+	}
+	TEST_ASSERT(files > free_clst / 2);
+	for (i = 0; i < files; i += 2) {
+		snprintf(path, sizeof(path), "0:/d/%d", i);
+		TEST_ASSERT_EQUAL(FR_OK, f_unlink(path));
+	}
+	free_clst = _count_free();
+	TEST_ASSERT(free_clst * csz > 8 * csz);
+
+	TEST_ASSERT_EQUAL(FR_DENIED, ffstream_create(&stream, &_fil, "0:/rec.bin", 8 * csz));
+	TEST_ASSERT(stream.fp == NULL);
+	TEST_ASSERT_EQUAL(free_clst, _count_free());
+
+	/* a single cluster still fits */
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_create(&stream, &_fil, "0:/rec.bin", csz));
+	_fill(_buf, 0, csz);
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_write(&stream, _buf, csz));
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_close(&stream));
+	TEST_ASSERT_EQUAL(free_clst - 1, _count_free());
+	_check_file("0:/rec.bin", csz);
+}
+
+/* a stream that is never closed keeps its whole preallocated block: no
+ * cluster is lost or shared after a remount */
+static void test_abandoned(void)
+{
+	struct _ffstream stream;
+	DWORD free_before, csz;
+
+	_format();
+	free_before = _count_free();
+	csz = _fs.csize * SECTOR_SIZE;
+
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_create(&stream, &_fil, "0:/rec.bin", 64 * csz));
+	_fill(_buf, 0, 4 * csz);
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_write(&stream, _buf, 4 * csz));
+
+	/* power loss: the cache content is lost */
+	diskcache_detach(0);
+	_mount();
+	TEST_ASSERT_EQUAL(free_before - 64, _count_free());
+	TEST_ASSERT_EQUAL(FR_OK, f_open(&_fil, "0:/rec.bin", FA_READ));
+	TEST_ASSERT_EQUAL(64 * csz, f_size(&_fil));
+	TEST_ASSERT_EQUAL(FR_OK, f_close(&_fil));
+}
+
+static uint64_t _bench_fwrite(void)
+{
+	uint32_t offset;
+	UINT bw;
+
+	_format();
+	memset(&_disk_stats, 0, sizeof(_disk_stats));
+	TEST_ASSERT_EQUAL(FR_OK, f_open(&_fil, "0:/fw.bin", FA_WRITE | FA_CREATE_NEW));
+	for (offset = 0; offset < BENCH_SIZE; offset += FWRITE_CHUNK) {
+		_fill(_buf, offset, FWRITE_CHUNK);
+		TEST_ASSERT_EQUAL(FR_OK, f_write(&_fil, _buf, FWRITE_CHUNK, &bw));
+		TEST_ASSERT_EQUAL(FWRITE_CHUNK, bw);
+	}
+	TEST_ASSERT_EQUAL(FR_OK, f_close(&_fil));
+
+	printf("    f_write:  %u requests, %u ms\n", _disk_stats.writes,
+	       (unsigned)(_disk_stats.time_us / 1000));
+	_check_file("0:/fw.bin", BENCH_SIZE);
+	return _disk_stats.time_us;
+}
+
+static uint64_t _bench_stream(void)
+{
+	struct _ffstream stream;
+	uint32_t offset;
+
+	_format();
+	memset(&_disk_stats, 0, sizeof(_disk_stats));
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_create(&stream, &_fil, "0:/st.bin", BENCH_SIZE));
+	for (offset = 0; offset < BENCH_SIZE; offset += STREAM_CHUNK) {
+		_fill(_buf, offset, STREAM_CHUNK);
+		TEST_ASSERT_EQUAL(FR_OK, ffstream_write(&stream, _buf, STREAM_CHUNK));
+	}
+	TEST_ASSERT_EQUAL(FR_OK, ffstream_close(&stream));
+
+	printf("    ffstream: %u requests, %u ms\n", _disk_stats.writes,
+	       (unsigned)(_disk_stats.time_us / 1000));
+	_check_file("0:/st.bin", BENCH_SIZE);
+	return _disk_stats.time_us;
+}
+
+static void test_throughput(void)
+{
+	uint64_t fwrite_us, stream_us;
+
+	fwrite_us = _bench_fwrite();
+	stream_us = _bench_stream();
+	printf("    %u MB: f_write %u KB/s, ffstream %u KB/s\n",
+	       BENCH_SIZE / (1024 * 1024),
+	       (unsigned)(BENCH_SIZE * 1000ull / fwrite_us),
+	       (unsigned)(BENCH_SIZE * 1000ull / stream_us));
+	TEST_ASSERT(stream_us < fwrite_us);
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	TEST_RUN(test_extent);
+	TEST_RUN(test_write_close);
+	TEST_RUN(test_denied);
+	TEST_RUN(test_fragmented);
+	TEST_RUN(test_abandoned);
+	TEST_RUN(test_throughput);
+
+	return 0;
+}
@@ -0,0 +1,425 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the internal flash driver against a simulated EEFC: CPU
+ * writes to the flash go to the page latch, commands apply it to the flash
+ * cells with the same bit semantics as the hardware (programming can only
+ * clear bits, EWP and EPA erase first).
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "callback.h"
+#include "chip.h"
+#include "errno.h"
+#include "irq/irq.h"
+#include "mm/cache.h"
+#include "nvm/flash/eefc.h"
+#include "nvm/flash/flashd.h"
+#include "test.h"
+#include "trace.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define FLASH_SIZE      (128 * 1024)
+#define PAGE_SIZE       512
+#define ERASE_SIZE      (16 * PAGE_SIZE)
+#define SMALL_SECTORS   (16 * 1024)
+#define LOCK_REGIONS    16
+#define GPNVM_BITS      9
+
+#define CMD_COUNT       0x20
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+/* flash as seen by the CPU, writes go to the page latch */
+ALIGNED(32) uint8_t test_iflash[FLASH_SIZE];
+
+/* flash cells */
+static uint8_t _cells[FLASH_SIZE];
+
+/* expected flash content */
+static uint8_t _expected[FLASH_SIZE];
+
+static uint8_t _data[FLASH_SIZE];
+
+static Eefc _eefc;
+static struct _flash _flash;
+
+static uint32_t _commands[CMD_COUNT];
+static uint32_t _results[8 + LOCK_REGIONS];
+static uint32_t _result_index;
+static int _pending_cmd = -1;
+static uint32_t _pending_arg;
+
+static irq_handler_t _irq_handler;
+static void* _irq_arg;
+
+/*----------------------------------------------------------------------------
+ *         Simulated EEFC
+ *----------------------------------------------------------------------------*/
+
+static void _eefc_execute(uint32_t cmd, uint32_t arg)
+{
+	uint32_t addr = arg * PAGE_SIZE;
+	uint32_t i, pages, first;
+
+	TEST_ASSERT(cmd < CMD_COUNT);
+	_commands[cmd]++;
+
+	switch (cmd) {
+	case EEFC_FCR_FCMD_GETD:
+		_result_index = 0;
+		break;
+	case EEFC_FCR_FCMD_WP:
+		TEST_ASSERT(addr < FLASH_SIZE);
+		for (i = 0; i < PAGE_SIZE; i++)
+			_cells[addr + i] &= test_iflash[addr + i];
+		break;
+	case EEFC_FCR_FCMD_EWP:
+		TEST_ASSERT(addr < SMALL_SECTORS);
+		memcpy(&_cells[addr], &test_iflash[addr], PAGE_SIZE);
+		break;
+	case EEFC_FCR_FCMD_EPA:
+		pages = 4 << (arg & 3);
+		first = arg & ~3u;
+		TEST_ASSERT(first % pages == 0);
+		TEST_ASSERT((first + pages) * PAGE_SIZE <= FLASH_SIZE);
+		memset(&_cells[first * PAGE_SIZE], 0xff, pages * PAGE_SIZE);
+		break;
+	case EEFC_FCR_FCMD_EA:
+		memset(_cells, 0xff, FLASH_SIZE);
+		break;
+	default:
+		TEST_ASSERT(false);
+	}
+
+	/* the latch is only written for the programmed page, reads return the
+	 * flash cells again */
+	if (cmd == EEFC_FCR_FCMD_WP || cmd == EEFC_FCR_FCMD_EWP)
+		TEST_ASSERT(memcmp(test_iflash, _cells, addr) == 0 &&
+		            memcmp(&test_iflash[addr + PAGE_SIZE],
+		                   &_cells[addr + PAGE_SIZE],
+		                   FLASH_SIZE - addr - PAGE_SIZE) == 0);
+	memcpy(test_iflash, _cells, FLASH_SIZE);
+}
+
+void eefc_enable_frdy_it(Eefc* eefc)
+{
+	eefc->EEFC_FMR |= EEFC_FMR_FRDY;
+}
+
+void eefc_disable_frdy_it(Eefc* eefc)
+{
+	eefc->EEFC_FMR &= ~EEFC_FMR_FRDY;
+}
+
+int eefc_perform_command(Eefc* eefc, uint32_t command, uint32_t arg)
+{
+	_eefc_execute(command, arg);
+	return 0;
+}
+
+/* the command completes on the next status read, FRDY is reported once it
+ * is done */
+void eefc_start_command(Eefc* eefc, uint32_t command, uint32_t arg)
+{
+	TEST_ASSERT(_pending_cmd < 0);
+	_pending_cmd = command;
+	_pending_arg = arg;
+}
+
+uint32_t eefc_get_status(Eefc* eefc)
+{
+	if (_pending_cmd >= 0) {
+		_eefc_execute(_pending_cmd, _pending_arg);
+		_pending_cmd = -1;
+		return 0;
+	}
+	return EEFC_FSR_FRDY;
+}
+
+int eefc_check_status(uint32_t status)
+{
+	return (status & (EEFC_FSR_FLOCKE | EEFC_FSR_FCMDE | EEFC_FSR_FLERR)) ? -EIO : 0;
+}
+
+uint32_t eefc_get_result(Eefc* eefc)
+{
+	TEST_ASSERT(_result_index < ARRAY_SIZE(_results));
+	return _results[_result_index++];
+}
+
+int eefc_read_unique_id(Eefc* eefc, uint8_t* uid)
+{
+	memset(uid, 0, 16);
+	return 0;
+}
+
+void irq_add_handler(uint32_t source, irq_handler_t handler, void* user_arg)
+{
+	_irq_handler = handler;
+	_irq_arg = user_arg;
+}
+
+void irq_remove_handler(uint32_t source, irq_handler_t handler)
+{
+	_irq_handler = NULL;
+}
+
+void irq_enable(uint32_t source)
+{
+}
+
+void irq_disable(uint32_t source)
+{
+}
+
+void cache_invalidate_region(void* start, uint32_t length)
+{
+}
+
+void cache_clean_region(const void* start, uint32_t length)
+{
+}
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static void _reset(void)
+{
+	uint32_t i, seed = 7;
+
+	memset(_cells, 0xff, FLASH_SIZE);
+	memset(test_iflash, 0xff, FLASH_SIZE);
+	memset(_expected, 0xff, FLASH_SIZE);
+	for (i = 0; i < FLASH_SIZE; i++) {
+		seed = seed * 1103515245 + 12345;
+		_data[i] = seed >> 16;
+	}
+
+	_results[0] = 0;
+	_results[1] = FLASH_SIZE;
+	_results[2] = PAGE_SIZE;
+	_results[3] = 1;
+	_results[4] = FLASH_SIZE;
+	_results[5] = LOCK_REGIONS;
+	for (i = 0; i < LOCK_REGIONS; i++)
+		_results[6 + i] = FLASH_SIZE / LOCK_REGIONS;
+	_results[6 + LOCK_REGIONS] = GPNVM_BITS;
+
+	TEST_ASSERT_EQUAL(0, flashd_initialize(&_flash, &_eefc));
+	TEST_ASSERT_EQUAL(ERASE_SIZE, _flash.erase_size);
+	memset(_commands, 0, sizeof(_commands));
+}
+
+static void _write(uint32_t addr, const uint8_t* data, uint32_t length)
+{
+	TEST_ASSERT_EQUAL(0, flashd_write(&_flash, addr, data, length));
+	memcpy(&_expected[addr], data, length);
+}
+
+static void _check(void)
+{
+	TEST_ASSERT(memcmp(_cells, _expected, FLASH_SIZE) == 0);
+}
+
+static int _async_done(void* arg, void* arg2)
+{
+	*(int*)arg = (int)(intptr_t)arg2 + 1;
+	return 0;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_write_erased(void)
+{
+	_reset();
+	_write(100, _data, 20000);
+	_check();
+	TEST_ASSERT_EQUAL((20100 + PAGE_SIZE - 1) / PAGE_SIZE, _commands[EEFC_FCR_FCMD_WP]);
+	TEST_ASSERT_EQUAL(0, _commands[EEFC_FCR_FCMD_EPA]);
+}
+
+static void test_rewrite_small_sectors(void)
+{
+	_reset();
+	_write(0, _data, SMALL_SECTORS);
+	memset(_commands, 0, sizeof(_commands));
+
+	/* pages already programmed are erased by EWP */
+	_write(1000, &_data[5000], 3000);
+	_check();
+	TEST_ASSERT(_commands[EEFC_FCR_FCMD_EWP] > 0);
+}
+
+static void test_rewrite_erase_block(void)
+{
+	uint32_t addr = 2 * ERASE_SIZE + SMALL_SECTORS;
+
+	_reset();
+	_write(addr, _data, 2 * ERASE_SIZE);
+	memset(_commands, 0, sizeof(_commands));
+
+	/* a rewritten erase block is erased with a single EPA */
+	_write(addr, &_data[77], ERASE_SIZE);
+	_check();
+	TEST_ASSERT_EQUAL(1, _commands[EEFC_FCR_FCMD_EPA]);
+	TEST_ASSERT_EQUAL(ERASE_SIZE / PAGE_SIZE, _commands[EEFC_FCR_FCMD_WP]);
+}
+
+static void test_buffered(void)
+{
+	uint8_t rd[4096];
+	uint32_t base = 40000, i, n;
+
+	_reset();
+	for (i = 0; i < sizeof(rd); i += n) {
+		n = i + 100 > sizeof(rd) ? sizeof(rd) - i : 100;
+		TEST_ASSERT_EQUAL(0, flashd_write_buffered(&_flash, base + i, &_data[i], n));
+		memcpy(&_expected[base + i], &_data[i], n);
+	}
+
+	/* reads include the page still in the buffer */
+	TEST_ASSERT_EQUAL(0, flashd_read(&_flash, base, rd, sizeof(rd)));
+	TEST_ASSERT(memcmp(rd, _data, sizeof(rd)) == 0);
+
+	TEST_ASSERT_EQUAL(0, flashd_flush(&_flash));
+	_check();
+
+	/* each page programmed once */
+	TEST_ASSERT_EQUAL((base + sizeof(rd) - 1) / PAGE_SIZE - base / PAGE_SIZE + 1,
+			_commands[EEFC_FCR_FCMD_WP]);
+}
+
+static void test_stale_buffered_page(void)
+{
+	uint32_t block = SMALL_SECTORS + 2 * ERASE_SIZE;
+
+	_reset();
+	_write(block, _data, ERASE_SIZE);
+
+	/* leave the first page of the block in the buffer */
+	TEST_ASSERT_EQUAL(0, flashd_write_buffered(&_flash, block, &_data[9000], 100));
+	memcpy(&_expected[block], &_data[9000], 100);
+
+	/* rewrite the whole block, starting in the previous one: the buffered
+	 * page must not be programmed before the block is erased and written
+	 * again */
+	memset(_commands, 0, sizeof(_commands));
+	_write(block - PAGE_SIZE, &_data[20000], ERASE_SIZE + PAGE_SIZE);
+	_check();
+	TEST_ASSERT_EQUAL(1, _commands[EEFC_FCR_FCMD_EPA]);
+	TEST_ASSERT_EQUAL(ERASE_SIZE / PAGE_SIZE + 1, _commands[EEFC_FCR_FCMD_WP]);
+}
+
+static void test_stale_buffered_page_partial(void)
+{
+	uint32_t addr = SMALL_SECTORS + 3 * ERASE_SIZE;
+
+	_reset();
+
+	/* the buffered page is only partly rewritten: it is programmed first
+	 * and the new data merged with the flash content */
+	TEST_ASSERT_EQUAL(0, flashd_write_buffered(&_flash, addr + 300, _data, 100));
+	memcpy(&_expected[addr + 300], _data, 100);
+	_write(addr - PAGE_SIZE, &_data[1000], PAGE_SIZE + 200);
+	_check();
+}
+
+static void test_async(void)
+{
+	uint32_t addr = 3 * SMALL_SECTORS;
+	int done = 0, rc, polls = 0;
+	struct _callback cb;
+
+	_reset();
+	callback_set(&cb, _async_done, &done);
+
+	/* polled */
+	TEST_ASSERT_EQUAL(0, flashd_write_async(&_flash, addr, &_data[3], ERASE_SIZE + 300, &cb));
+	memcpy(&_expected[addr], &_data[3], ERASE_SIZE + 300);
+	while ((rc = flashd_poll(&_flash)) == 1)
+		polls++;
+	TEST_ASSERT_EQUAL(0, rc);
+	TEST_ASSERT_EQUAL(1, done);
+	TEST_ASSERT(polls > 0);
+	_check();
+
+	/* interrupt driven, a write is rejected while busy */
+	done = 0;
+	flashd_set_irq_mode(&_flash, true);
+	TEST_ASSERT(_irq_handler != NULL);
+	TEST_ASSERT_EQUAL(0, flashd_write_async(&_flash, addr + ERASE_SIZE + 300,
+			&_data[9], 5000, &cb));
+	memcpy(&_expected[addr + ERASE_SIZE + 300], &_data[9], 5000);
+	TEST_ASSERT_EQUAL(-EBUSY, flashd_write(&_flash, 0, _data, 4));
+	while (_flash.async.busy) {
+		TEST_ASSERT(_eefc.EEFC_FMR & EEFC_FMR_FRDY);
+		_irq_handler(ID_EFC, _irq_arg);
+	}
+	TEST_ASSERT_EQUAL(0, flashd_poll(&_flash));
+	TEST_ASSERT_EQUAL(1, done);
+	_check();
+	flashd_set_irq_mode(&_flash, false);
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	TEST_RUN(test_write_erased);
+	TEST_RUN(test_rewrite_small_sectors);
+	TEST_RUN(test_rewrite_erase_block);
+	TEST_RUN(test_buffered);
+	TEST_RUN(test_stale_buffered_page);
+	TEST_RUN(test_stale_buffered_page_partial);
+	TEST_RUN(test_async);
+	return 0;
+}
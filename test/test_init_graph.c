@@ -0,0 +1,284 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the initialization graph scheduler: dependency order,
+ * interleaving of asynchronous steps, failure propagation, timeouts and
+ * invalid graphs. Time only moves when a step is polled.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "errno.h"
+#include "init_graph.h"
+#include "test.h"
+#include "timer.h"
+#include "trace.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define MAX_EVENTS 64
+
+/* simulated step: completes or fails after a number of polls */
+struct _sim_step {
+	char id;
+	int polls;      /* polls before completion, 0 for a synchronous step */
+	int result;     /* final status */
+	int count;
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+static uint64_t _tick;
+
+/* start ('A') and completion ('a') events, in order */
+static char _events[MAX_EVENTS];
+static int _event_count;
+
+/*----------------------------------------------------------------------------
+ *         Timer
+ *----------------------------------------------------------------------------*/
+
+uint64_t timer_get_tick(void)
+{
+	return _tick;
+}
+
+uint64_t timer_get_interval(uint64_t start, uint64_t end)
+{
+	return end - start;
+}
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static void _event(char e)
+{
+	TEST_ASSERT(_event_count < MAX_EVENTS - 1);
+	_events[_event_count++] = e;
+	_events[_event_count] = 0;
+}
+
+static int _sim_poll(void* arg)
+{
+	struct _sim_step* s = (struct _sim_step*)arg;
+
+	_tick++;
+	if (++s->count < s->polls)
+		return 1;
+	_event(s->id - 'A' + 'a');
+	return s->result;
+}
+
+static int _sim_start(void* arg)
+{
+	struct _sim_step* s = (struct _sim_step*)arg;
+
+	_event(s->id);
+	s->count = 0;
+	if (s->polls)
+		return 1;
+	_event(s->id - 'A' + 'a');
+	return s->result;
+}
+
+static void _reset(void)
+{
+	_tick = 0;
+	_event_count = 0;
+	_events[0] = 0;
+}
+
+static int _index(char e)
+{
+	const char* p = strchr(_events, e);
+
+	TEST_ASSERT(p != NULL);
+	return p - _events;
+}
+
+#define STEP(s, d) { \
+	.name = #s, \
+	.start = _sim_start, \
+	.poll = (s).polls ? _sim_poll : NULL, \
+	.arg = &(s), \
+	.deps = (d), \
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_order(void)
+{
+	struct _sim_step a = { 'A', 0, 0 }, b = { 'B', 3, 0 };
+	struct _sim_step c = { 'C', 0, 0 }, d = { 'D', 2, 0 };
+	struct _sim_step e = { 'E', 0, 0 };
+	struct _init_step steps[] = {
+		STEP(d, INIT_STEP_DEP(1) | INIT_STEP_DEP(2)),
+		STEP(b, INIT_STEP_DEP(3)),
+		STEP(c, INIT_STEP_DEP(3)),
+		STEP(a, 0),
+		STEP(e, 0),
+	};
+	int i;
+
+	_reset();
+	TEST_ASSERT_EQUAL(0, init_graph_run(steps, ARRAY_SIZE(steps)));
+	for (i = 0; i < ARRAY_SIZE(steps); i++) {
+		TEST_ASSERT_EQUAL(INIT_STEP_DONE, steps[i].state);
+		TEST_ASSERT_EQUAL(0, steps[i].status);
+	}
+
+	/* dependencies complete before a step starts */
+	TEST_ASSERT(_index('a') < _index('B'));
+	TEST_ASSERT(_index('a') < _index('C'));
+	TEST_ASSERT(_index('b') < _index('D'));
+	TEST_ASSERT(_index('c') < _index('D'));
+
+	/* the asynchronous step is started before the synchronous one and
+	 * runs while it executes */
+	TEST_ASSERT(_index('B') < _index('C'));
+	TEST_ASSERT(_index('c') < _index('b'));
+
+	/* D waited for B's three polls */
+	TEST_ASSERT(steps[0].start_tick >= 3);
+	TEST_ASSERT_EQUAL(steps[0].start_tick + 2, steps[0].end_tick);
+}
+
+static void test_failure(void)
+{
+	struct _sim_step a = { 'A', 2, -EIO }, b = { 'B', 0, 0 };
+	struct _sim_step c = { 'C', 0, 0 }, d = { 'D', 0, -ENODEV };
+	struct _init_step steps[] = {
+		STEP(a, 0),
+		STEP(b, INIT_STEP_DEP(0)),
+		STEP(c, INIT_STEP_DEP(1)),
+		STEP(d, 0),
+	};
+
+	_reset();
+
+	/* first failure in table order, dependents cancelled transitively,
+	 * independent steps still run */
+	TEST_ASSERT_EQUAL(-EIO, init_graph_run(steps, ARRAY_SIZE(steps)));
+	TEST_ASSERT_EQUAL(INIT_STEP_FAILED, steps[0].state);
+	TEST_ASSERT_EQUAL(-ECANCELED, steps[1].status);
+	TEST_ASSERT_EQUAL(-ECANCELED, steps[2].status);
+	TEST_ASSERT_EQUAL(INIT_STEP_FAILED, steps[3].state);
+	TEST_ASSERT_EQUAL(-ENODEV, steps[3].status);
+	TEST_ASSERT(strchr(_events, 'B') == NULL);
+	TEST_ASSERT(strchr(_events, 'C') == NULL);
+	TEST_ASSERT(strchr(_events, 'D') != NULL);
+}
+
+static void test_timeout(void)
+{
+	struct _sim_step a = { 'A', 1000, 0 }, b = { 'B', 0, 0 };
+	struct _init_step steps[] = {
+		STEP(a, 0),
+		STEP(b, INIT_STEP_DEP(0)),
+	};
+
+	steps[0].timeout = 10;
+
+	_reset();
+	TEST_ASSERT_EQUAL(-ETIMEDOUT, init_graph_run(steps, ARRAY_SIZE(steps)));
+	TEST_ASSERT_EQUAL(10, a.count);
+	TEST_ASSERT_EQUAL(-ECANCELED, steps[1].status);
+}
+
+static void test_sync_step_in_progress(void)
+{
+	struct _sim_step a = { 'A', 0, 1 };
+	struct _init_step steps[] = {
+		STEP(a, 0),
+	};
+
+	/* a step without poll method cannot stay in progress */
+	_reset();
+	TEST_ASSERT_EQUAL(-EINVAL, init_graph_run(steps, ARRAY_SIZE(steps)));
+}
+
+static void test_invalid(void)
+{
+	struct _sim_step a = { 'A', 0, 0 }, b = { 'B', 0, 0 }, c = { 'C', 0, 0 };
+	struct _init_step self[] = {
+		STEP(a, INIT_STEP_DEP(0)),
+	};
+	struct _init_step unknown[] = {
+		STEP(a, INIT_STEP_DEP(1)),
+	};
+	struct _init_step cycle[] = {
+		STEP(a, 0),
+		STEP(b, INIT_STEP_DEP(2)),
+		STEP(c, INIT_STEP_DEP(1)),
+	};
+
+	_reset();
+	TEST_ASSERT_EQUAL(-EINVAL, init_graph_run(self, ARRAY_SIZE(self)));
+	TEST_ASSERT_EQUAL(-EINVAL, init_graph_run(unknown, ARRAY_SIZE(unknown)));
+	TEST_ASSERT_EQUAL(-EINVAL, init_graph_run(self, INIT_GRAPH_MAX_STEPS + 1));
+	TEST_ASSERT_EQUAL(0, _event_count);
+
+	/* steps of a cycle fail, the others run */
+	TEST_ASSERT_EQUAL(-EINVAL, init_graph_run(cycle, ARRAY_SIZE(cycle)));
+	TEST_ASSERT_EQUAL(INIT_STEP_DONE, cycle[0].state);
+	TEST_ASSERT_EQUAL(-EINVAL, cycle[1].status);
+	TEST_ASSERT_EQUAL(-EINVAL, cycle[2].status);
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	TEST_RUN(test_order);
+	TEST_RUN(test_failure);
+	TEST_RUN(test_timeout);
+	TEST_RUN(test_sync_step_in_progress);
+	TEST_RUN(test_invalid);
+	return 0;
+}
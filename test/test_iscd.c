@@ -0,0 +1,580 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the ISC 3A (AWB/AE) engine. The ISC registers are plain
+ * memory, the histogram DMA is a copy completed on the next poll and the
+ * sensor exposure is a model applied two frames after it is written. Each
+ * frame, the histogram of the channel selected by ISC_HIS_CFG is computed
+ * from a scene: per channel levels scaled by the sensor exposure and gain,
+ * spread around their mean and clipped to the last bin.
+ *
+ * The tests check the gains and exposure reached and the number of frames
+ * to converge, and report the CPU time of the histogram updates.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "callback.h"
+#include "chip.h"
+#include "test.h"
+#include "trace.h"
+
+#include "dma/dma.h"
+#include "irq/irq.h"
+#include "mm/cache.h"
+#include "video/image_sensor_inf.h"
+#include "video/isc.h"
+#include "video/iscd.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define TEST_BUS 1
+
+/* pixels of each channel histogram */
+#define SCENE_PIXELS 16384
+
+/* exposure of the scene levels, in lines */
+#define SCENE_EXPOSURE 100
+
+/* frames before a written exposure is seen in the histograms */
+#define SENSOR_LATENCY 2
+
+#define MAX_FRAMES 200
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+Isc test_isc;
+
+CACHE_ALIGNED static uint32_t _histo_buf[HIST_ENTRIES];
+
+/* ISC interrupt handler */
+static irq_handler_t _isc_handler;
+static void* _isc_handler_arg;
+
+/* simulated DMA channel */
+static struct _dma_channel* const _dma_channel = (struct _dma_channel*)&_dma_channel;
+static struct _callback _dma_callback;
+static struct _dma_transfer_cfg _dma_transfer;
+static bool _dma_pending;
+
+/* scene levels at SCENE_EXPOSURE and unit gain, in bins */
+static uint32_t _scene[BAYER_COUNT];
+
+/* sensor model, values written and values seen by the histograms */
+static const struct sensor_exposure _exposure = {
+	.gain_unit = 16,
+	.exposure_min = 1,
+	.exposure_max = 980,
+	.gain_min = 16,
+	.gain_max = 248,
+};
+static struct sensor_profile _sensor = {
+	.name = "SIM",
+	.exposure = &_exposure,
+};
+static struct sensor_profile _sensor_no_ae = {
+	.name = "SIM-AWB",
+};
+static uint32_t _sensor_exposure[SENSOR_LATENCY + 1];
+static uint16_t _sensor_gain[SENSOR_LATENCY + 1];
+static uint32_t _sensor_writes;
+static bool _sensor_manual;
+
+/* 3A statistics reported by the callback */
+static struct _iscd_3a_stats _stats;
+static uint32_t _callbacks;
+
+/* CPU time of the histogram updates */
+static uint64_t _update_ns;
+static uint32_t _update_count;
+
+/*----------------------------------------------------------------------------
+ *         Simulated ISC interrupt, DMA and cache
+ *----------------------------------------------------------------------------*/
+
+static void _isc_set(volatile const uint32_t* reg, uint32_t value)
+{
+	*(volatile uint32_t*)reg = value;
+}
+
+void irq_add_handler(uint32_t source, irq_handler_t handler, void* user_arg)
+{
+	TEST_ASSERT_EQUAL(ID_ISC, source);
+	_isc_handler = handler;
+	_isc_handler_arg = user_arg;
+}
+
+void irq_enable(uint32_t source)
+{
+}
+
+void irq_disable(uint32_t source)
+{
+}
+
+struct _dma_channel* dma_allocate_channel(uint8_t src, uint8_t dest)
+{
+	return _dma_channel;
+}
+
+int dma_set_callback(struct _dma_channel* channel, struct _callback* callback)
+{
+	callback_copy(&_dma_callback, callback);
+	return 0;
+}
+
+int dma_configure_transfer(struct _dma_channel* channel,
+			   struct _dma_cfg* cfg_dma,
+			   struct _dma_transfer_cfg* list,
+			   uint8_t list_size)
+{
+	TEST_ASSERT(channel == _dma_channel);
+	TEST_ASSERT(!_dma_pending);
+	TEST_ASSERT_EQUAL(1, list_size);
+	TEST_ASSERT(list[0].saddr == (void*)&ISC->ISC_HIS_ENTRY[0]);
+	TEST_ASSERT_EQUAL(HIST_ENTRIES, list[0].len);
+	_dma_transfer = list[0];
+	return 0;
+}
+
+int dma_start_transfer(struct _dma_channel* channel)
+{
+	_dma_pending = true;
+	return 0;
+}
+
+int dma_reset_channel(struct _dma_channel* channel)
+{
+	return 0;
+}
+
+/* transfers complete on the next poll, the callback then runs as from the
+ * DMA interrupt */
+static void _dma_poll(void)
+{
+	if (!_dma_pending)
+		return;
+	memcpy(_dma_transfer.daddr, _dma_transfer.saddr,
+	       _dma_transfer.len * sizeof(uint32_t));
+	_dma_pending = false;
+	callback_call(&_dma_callback, NULL);
+}
+
+void cache_invalidate_region(void* start, uint32_t length)
+{
+}
+
+void cache_clean_region(const void* start, uint32_t length)
+{
+}
+
+/*----------------------------------------------------------------------------
+ *         Sensor model
+ *----------------------------------------------------------------------------*/
+
+uint32_t sensor_set_manual_exposure(uint8_t twi_bus, struct sensor_profile* sensor)
+{
+	TEST_ASSERT_EQUAL(TEST_BUS, twi_bus);
+	TEST_ASSERT(sensor == &_sensor);
+	_sensor_manual = true;
+	return SENSOR_OK;
+}
+
+uint32_t sensor_get_exposure(uint8_t twi_bus, struct sensor_profile* sensor,
+			     uint32_t* exposure, uint16_t* gain)
+{
+	TEST_ASSERT_EQUAL(TEST_BUS, twi_bus);
+	TEST_ASSERT(sensor == &_sensor);
+	*exposure = _sensor_exposure[0];
+	*gain = _sensor_gain[0];
+	return SENSOR_OK;
+}
+
+uint32_t sensor_set_exposure(uint8_t twi_bus, struct sensor_profile* sensor,
+			     uint32_t exposure, uint16_t gain)
+{
+	TEST_ASSERT_EQUAL(TEST_BUS, twi_bus);
+	TEST_ASSERT(sensor == &_sensor);
+	TEST_ASSERT(_sensor_manual);
+	TEST_ASSERT(exposure >= _exposure.exposure_min &&
+		    exposure <= _exposure.exposure_max);
+	TEST_ASSERT(gain >= _exposure.gain_min && gain <= _exposure.gain_max);
+	_sensor_exposure[0] = exposure;
+	_sensor_gain[0] = gain;
+	_sensor_writes++;
+	return SENSOR_OK;
+}
+
+/* the exposure written is seen SENSOR_LATENCY frames later */
+static void _sensor_frame(void)
+{
+	int i;
+
+	for (i = SENSOR_LATENCY; i > 0; i--) {
+		_sensor_exposure[i] = _sensor_exposure[i - 1];
+		_sensor_gain[i] = _sensor_gain[i - 1];
+	}
+}
+
+static void _sensor_reset(uint32_t exposure, uint16_t gain)
+{
+	int i;
+
+	for (i = 0; i <= SENSOR_LATENCY; i++) {
+		_sensor_exposure[i] = exposure;
+		_sensor_gain[i] = gain;
+	}
+	_sensor_writes = 0;
+	_sensor_manual = false;
+}
+
+/*----------------------------------------------------------------------------
+ *         Scene and frames
+ *----------------------------------------------------------------------------*/
+
+static void _set_scene(uint32_t gr, uint32_t r, uint32_t gb, uint32_t b)
+{
+	_scene[HISTOGRAM_GR] = gr;
+	_scene[HISTOGRAM_R] = r;
+	_scene[HISTOGRAM_GB] = gb;
+	_scene[HISTOGRAM_B] = b;
+}
+
+/* level of a channel with the exposure seen by this frame, in 1/256 bin */
+static uint32_t _level(uint8_t channel)
+{
+	uint64_t level = (uint64_t)_scene[channel] << 8;
+
+	level = level * _sensor_exposure[SENSOR_LATENCY] * _sensor_gain[SENSOR_LATENCY];
+	return (uint32_t)(level / (SCENE_EXPOSURE * _exposure.gain_unit));
+}
+
+/* pixels spread evenly over [level/2, 3*level/2], clipped to the last bin */
+static void _fill_histogram(uint8_t channel)
+{
+	uint32_t level = _level(channel);
+	uint32_t i, bin;
+
+	for (i = 0; i < HIST_ENTRIES; i++)
+		_isc_set(&ISC->ISC_HIS_ENTRY[i], 0);
+	for (i = 0; i < SCENE_PIXELS; i++) {
+		bin = (level / 2 + (uint64_t)level * i / SCENE_PIXELS) >> 8;
+		if (bin > HIST_ENTRIES - 1)
+			bin = HIST_ENTRIES - 1;
+		_isc_set(&ISC->ISC_HIS_ENTRY[bin], ISC->ISC_HIS_ENTRY[bin] + 1);
+	}
+}
+
+static uint64_t _now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* one frame: histogram request, HISDONE interrupt, DMA read, update */
+static void _frame(void)
+{
+	uint64_t start;
+
+	_sensor_frame();
+
+	iscd_3a_process(_histo_buf);
+	TEST_ASSERT_EQUAL(ISC_CTRLEN_HISREQ, ISC->ISC_CTRLEN);
+	TEST_ASSERT(ISC->ISC_HIS_CFG & ISC_HIS_CFG_RAR);
+
+	_fill_histogram(ISC->ISC_HIS_CFG & ISC_HIS_CFG_MODE_Msk);
+	_isc_set(&ISC->ISC_INTSR, ISC_INTSR_HISDONE);
+	_isc_handler(ID_ISC, _isc_handler_arg);
+	_isc_set(&ISC->ISC_INTSR, 0);
+
+	iscd_3a_process(_histo_buf);
+	TEST_ASSERT(_dma_pending);
+	_dma_poll();
+
+	start = _now_ns();
+	iscd_3a_process(_histo_buf);
+	_update_ns += _now_ns() - start;
+	_update_count++;
+}
+
+static void _callback(const struct _iscd_3a_stats* stats)
+{
+	_stats = *stats;
+	_callbacks++;
+}
+
+static uint16_t _wb_gain(uint8_t channel)
+{
+	switch (channel) {
+	case HISTOGRAM_R:
+		return (ISC->ISC_WB_G_RGR & ISC_WB_G_RGR_RGAIN_Msk) >> ISC_WB_G_RGR_RGAIN_Pos;
+	case HISTOGRAM_GR:
+		return (ISC->ISC_WB_G_RGR & ISC_WB_G_RGR_GRGAIN_Msk) >> ISC_WB_G_RGR_GRGAIN_Pos;
+	case HISTOGRAM_B:
+		return (ISC->ISC_WB_G_BGB & ISC_WB_G_BGB_BGAIN_Msk) >> ISC_WB_G_BGB_BGAIN_Pos;
+	default:
+		return (ISC->ISC_WB_G_BGB & ISC_WB_G_BGB_GBGAIN_Msk) >> ISC_WB_G_BGB_GBGAIN_Pos;
+	}
+}
+
+/* gain expected for a channel, from the scene levels (0:4:9) */
+static uint32_t _expected_gain(uint8_t channel)
+{
+	return ((_scene[HISTOGRAM_GR] + _scene[HISTOGRAM_GB]) << 8) / _scene[channel];
+}
+
+static bool _near(uint32_t value, uint32_t expected, uint32_t percent)
+{
+	uint32_t diff = value > expected ? value - expected : expected - value;
+
+	return diff * 100 <= expected * percent;
+}
+
+/* Start the pipe with a RAW Bayer input and the histogram enabled */
+static void _start(struct sensor_profile* sensor, uint32_t exposure, uint16_t gain)
+{
+	static struct _color_correct cc;
+	static struct _iscd_desc desc;
+
+	memset(&test_isc, 0, sizeof(test_isc));
+	memset(&_stats, 0, sizeof(_stats));
+	_callbacks = 0;
+	_sensor_reset(exposure, gain);
+
+	memset(&desc, 0, sizeof(desc));
+	desc.cfg.input_format = RAW_BAYER;
+	desc.cfg.input_bits = BIT_8;
+	desc.cfg.layout = ISCD_LAYOUT_PACKED16;
+	desc.cfg.multi_bufs = 1;
+	desc.pipe.bayer_pattern = ISCD_BGBG;
+	desc.pipe.histo_enable = true;
+	desc.pipe.histo_buf = _histo_buf;
+	desc.pipe.cbc.contrast = 1.0;
+	desc.pipe.color_correction = &cc;
+	desc.pipe.rlp_mode = ISCD_RLP_MODE_RGB565;
+
+	iscd_3a_configure(NULL, TEST_BUS, sensor, _callback);
+	TEST_ASSERT_EQUAL(ISCD_OK, iscd_pipe_start(&desc));
+	TEST_ASSERT(_isc_handler != NULL);
+	TEST_ASSERT_EQUAL(ISCD_WB_GAIN_ONE, _wb_gain(HISTOGRAM_R));
+}
+
+/* Run frames until AWB and, if enabled, AE have converged and stay so for
+ * a full channel cycle. Return the number of frames. */
+static uint32_t _converge(void)
+{
+	uint32_t frames, stable = 0;
+
+	for (frames = 1; frames <= MAX_FRAMES; frames++) {
+		_frame();
+		if (_stats.awb_converged &&
+		    (!_stats.ae_enabled || _stats.ae_converged))
+			stable++;
+		else
+			stable = 0;
+		if (stable == BAYER_COUNT)
+			return frames;
+	}
+	TEST_ASSERT(false);
+	return 0;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+/* gray world gains on a sensor without exposure control */
+static void test_awb(void)
+{
+	uint32_t frames;
+	uint8_t c;
+
+	_set_scene(80, 40, 80, 64);
+	_start(&_sensor_no_ae, SCENE_EXPOSURE, 16);
+	TEST_ASSERT(!_stats.ae_enabled);
+
+	/* no update before the four channels are gathered */
+	for (c = 0; c < BAYER_COUNT - 1; c++)
+		_frame();
+	TEST_ASSERT_EQUAL(0, _callbacks);
+
+	frames = _converge();
+	printf("    AWB converged in %u frames\n", frames + BAYER_COUNT - 1);
+	TEST_ASSERT(frames <= 40);
+	TEST_ASSERT(_near(_wb_gain(HISTOGRAM_R), _expected_gain(HISTOGRAM_R), 2));
+	TEST_ASSERT(_near(_wb_gain(HISTOGRAM_B), _expected_gain(HISTOGRAM_B), 2));
+	TEST_ASSERT_EQUAL(ISCD_WB_GAIN_ONE, _wb_gain(HISTOGRAM_GR));
+	TEST_ASSERT_EQUAL(ISCD_WB_GAIN_ONE, _wb_gain(HISTOGRAM_GB));
+	TEST_ASSERT_EQUAL(_stats.wb_gain[HISTOGRAM_R], _wb_gain(HISTOGRAM_R));
+	TEST_ASSERT_EQUAL(0, _sensor_writes);
+
+	/* one statistics report per histogram once all channels are known */
+	TEST_ASSERT_EQUAL(_stats.updates - (BAYER_COUNT - 1), _callbacks);
+}
+
+/* gains are limited by the tuning */
+static void test_awb_clamp(void)
+{
+	uint32_t i;
+
+	_set_scene(200, 10, 200, 300);
+	_start(&_sensor_no_ae, SCENE_EXPOSURE, 16);
+	_converge();
+
+	/* the last steps of the damped gain, then no overshoot */
+	for (i = 0; i < 64; i++)
+		_frame();
+	TEST_ASSERT_EQUAL(8 * ISCD_WB_GAIN_ONE - 1, _wb_gain(HISTOGRAM_R));
+	TEST_ASSERT(_near(_wb_gain(HISTOGRAM_B), _expected_gain(HISTOGRAM_B), 2));
+}
+
+/* a dark scene: the exposure is raised to the target at unit gain */
+static void test_ae_dark(void)
+{
+	uint32_t frames, g;
+
+	_set_scene(20, 10, 20, 15);
+	_start(&_sensor, SCENE_EXPOSURE, 16);
+	TEST_ASSERT(_sensor_manual);
+
+	frames = _converge();
+	printf("    AE x6.4 converged in %u frames, %u sensor writes\n",
+	       frames, _sensor_writes);
+	TEST_ASSERT(_stats.ae_enabled);
+	TEST_ASSERT(frames <= 60);
+	TEST_ASSERT_EQUAL(16, _sensor_gain[0]);
+	g = (_stats.mean[HISTOGRAM_GR] + _stats.mean[HISTOGRAM_GB]) / 2;
+	TEST_ASSERT(_near(g, (HIST_ENTRIES / 4) << 8, 13));
+	TEST_ASSERT(_near(_wb_gain(HISTOGRAM_R), _expected_gain(HISTOGRAM_R), 2));
+}
+
+/* a very dark scene: exposure at its maximum, then the gain is raised */
+static void test_ae_gain(void)
+{
+	uint32_t frames;
+
+	_set_scene(2, 2, 2, 2);
+	_start(&_sensor, SCENE_EXPOSURE, 16);
+	frames = _converge();
+	printf("    AE x64 converged in %u frames, %u sensor writes\n",
+	       frames, _sensor_writes);
+	TEST_ASSERT(frames <= 80);
+	TEST_ASSERT_EQUAL(_exposure.exposure_max, _sensor_exposure[0]);
+	TEST_ASSERT(_sensor_gain[0] > _exposure.gain_unit);
+	TEST_ASSERT_EQUAL(_sensor_exposure[0], _stats.exposure);
+	TEST_ASSERT_EQUAL(_sensor_gain[0], _stats.gain);
+}
+
+/* a clipped scene: the exposure is lowered */
+static void test_ae_bright(void)
+{
+	uint32_t frames;
+
+	_set_scene(600, 500, 600, 550);
+	_start(&_sensor, SCENE_EXPOSURE, 64);
+	frames = _converge();
+	printf("    AE clipped converged in %u frames, %u sensor writes\n",
+	       frames, _sensor_writes);
+	TEST_ASSERT(frames <= 80);
+	TEST_ASSERT_EQUAL(16, _sensor_gain[0]);
+	TEST_ASSERT(_sensor_exposure[0] < SCENE_EXPOSURE / 2);
+}
+
+/* a lighting change after convergence is followed */
+static void test_lighting_step(void)
+{
+	uint32_t frames, writes;
+
+	_set_scene(40, 20, 40, 30);
+	_start(&_sensor, SCENE_EXPOSURE, 16);
+	_converge();
+
+	/* nothing is written while converged */
+	writes = _sensor_writes;
+	for (frames = 0; frames < 16; frames++)
+		_frame();
+	TEST_ASSERT_EQUAL(writes, _sensor_writes);
+
+	/* twice the light, with a blue cast */
+	_set_scene(80, 40, 80, 120);
+	frames = _converge();
+	printf("    step converged in %u frames\n", frames);
+	TEST_ASSERT(frames <= 60);
+	TEST_ASSERT(_near(_wb_gain(HISTOGRAM_B), _expected_gain(HISTOGRAM_B), 2));
+}
+
+/* CPU time of the update that runs once a histogram has been read */
+static void test_cost(void)
+{
+	uint32_t i;
+
+	_set_scene(40, 20, 40, 30);
+	_start(&_sensor, SCENE_EXPOSURE, 16);
+	_update_ns = 0;
+	_update_count = 0;
+	for (i = 0; i < 1000; i++)
+		_frame();
+	printf("    %u ns per histogram update (host)\n",
+	       (unsigned)(_update_ns / _update_count));
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	TEST_RUN(test_awb);
+	TEST_RUN(test_awb_clamp);
+	TEST_RUN(test_ae_dark);
+	TEST_RUN(test_ae_gain);
+	TEST_RUN(test_ae_bright);
+	TEST_RUN(test_lighting_step);
+	TEST_RUN(test_cost);
+	return 0;
+}
@@ -0,0 +1,623 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the baseline JPEG encoder. Encoded frames are decoded by a
+ * straightforward reference decoder (canonical Huffman tables, floating
+ * point inverse DCT) which also checks the stream syntax: marker segments,
+ * byte stuffing, MCU count and EOI. The decoded frame must be close to the
+ * source, by PSNR per quality level, and flat frames must decode exactly.
+ * A golden CRC of the stream of a fixed test pattern catches unintended
+ * changes of the output.
+ *
+ * When the host compiler targets NEON, the NEON kernels are built too and
+ * must give the same stream as the C kernels. Encoding time of a VGA frame
+ * is reported.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "compiler.h"
+#include "errno.h"
+#include "test.h"
+
+#include "jpegenc.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+/* test frame, with padded lines */
+#define WIDTH 96
+#define HEIGHT 48
+#define STRIDE (2 * WIDTH + 24)
+
+#define BENCH_WIDTH 640
+#define BENCH_HEIGHT 480
+
+#define MAX_JPEG (2 * BENCH_WIDTH * BENCH_HEIGHT)
+
+/* CRC-32 of the stream of the test pattern at quality 75 */
+#define GOLDEN_CRC 0x11f8d104u
+
+/*----------------------------------------------------------------------------
+ *         Local types
+ *----------------------------------------------------------------------------*/
+
+/* decoding table of a canonical Huffman code */
+struct _huff_dec {
+	int32_t maxcode[18];
+	int32_t valptr[17];
+	int32_t mincode[17];
+	uint8_t vals[256];
+	bool defined;
+};
+
+struct _decoder {
+	const uint8_t* p;
+	const uint8_t* end;
+	uint32_t acc;
+	uint32_t count;
+	bool marker;          /* a marker was met in the entropy data */
+	uint8_t qtable[4][64];  /* zigzag order */
+	struct _huff_dec dc[2];
+	struct _huff_dec ac[2];
+	uint32_t width;
+	uint32_t height;
+	uint8_t comp_q[3];
+	uint8_t comp_dc[3];
+	uint8_t comp_ac[3];
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static const uint8_t _zigzag[64] = {
+	 0,  1,  8, 16,  9,  2,  3, 10,
+	17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34,
+	27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36,
+	29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46,
+	53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+static uint8_t _frame[HEIGHT * STRIDE];
+static uint8_t _decoded[HEIGHT * 2 * WIDTH];
+static uint8_t _jpeg[MAX_JPEG];
+static uint8_t _jpeg2[MAX_JPEG];
+
+static uint8_t _bench_frame[2 * BENCH_WIDTH * BENCH_HEIGHT];
+
+/*----------------------------------------------------------------------------
+ *         Reference decoder
+ *----------------------------------------------------------------------------*/
+
+static uint32_t _u16(const uint8_t* p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static void _build_dec(struct _huff_dec* h, const uint8_t* bits,
+		       const uint8_t* vals)
+{
+	int32_t code = 0, k = 0, len, count = 0;
+
+	for (len = 0; len < 16; len++)
+		count += bits[len];
+	TEST_ASSERT(count <= 256);
+	memcpy(h->vals, vals, count);
+
+	for (len = 1; len <= 16; len++) {
+		h->valptr[len] = k;
+		h->mincode[len] = code;
+		code += bits[len - 1];
+		k += bits[len - 1];
+		h->maxcode[len] = bits[len - 1] ? code - 1 : -1;
+		code <<= 1;
+	}
+	h->maxcode[17] = 0x7fffffff;
+	h->defined = true;
+}
+
+static uint32_t _get_bit(struct _decoder* d)
+{
+	uint8_t byte;
+
+	if (!d->count) {
+		TEST_ASSERT(d->p < d->end);
+		byte = *d->p++;
+		if (byte == 0xff) {
+			/* stuffed zero, any other marker ends the scan */
+			TEST_ASSERT(d->p < d->end);
+			if (*d->p == 0x00)
+				d->p++;
+			else
+				d->marker = true;
+		}
+		TEST_ASSERT(!d->marker);
+		d->acc = byte;
+		d->count = 8;
+	}
+	d->count--;
+	return (d->acc >> d->count) & 1;
+}
+
+static uint32_t _get_bits(struct _decoder* d, uint32_t n)
+{
+	uint32_t v = 0;
+
+	while (n--)
+		v = (v << 1) | _get_bit(d);
+	return v;
+}
+
+static uint8_t _decode_huff(struct _decoder* d, const struct _huff_dec* h)
+{
+	int32_t code = _get_bit(d);
+	int32_t len = 1;
+
+	TEST_ASSERT(h->defined);
+	while (code > h->maxcode[len]) {
+		code = (code << 1) | _get_bit(d);
+		len++;
+		TEST_ASSERT(len <= 16);
+	}
+	return h->vals[h->valptr[len] + code - h->mincode[len]];
+}
+
+static int32_t _extend(uint32_t v, uint32_t n)
+{
+	return v < (1u << (n - 1)) ? (int32_t)v - (1 << n) + 1 : (int32_t)v;
+}
+
+/* Decode and dequantize one block, then inverse DCT to 8x8 samples */
+static void _decode_block(struct _decoder* d, uint8_t comp, int32_t* dc,
+			  uint8_t out[64])
+{
+	double coef[64], sum, cu, cv;
+	uint32_t k, s, r, x, y, u, v;
+	const uint8_t* q = d->qtable[d->comp_q[comp]];
+	uint8_t rs;
+
+	memset(coef, 0, sizeof(coef));
+	s = _decode_huff(d, &d->dc[d->comp_dc[comp]]);
+	TEST_ASSERT(s <= 11);
+	if (s)
+		*dc += _extend(_get_bits(d, s), s);
+	coef[0] = *dc * q[0];
+
+	for (k = 1; k < 64; k++) {
+		rs = _decode_huff(d, &d->ac[d->comp_ac[comp]]);
+		r = rs >> 4;
+		s = rs & 15;
+		if (!s) {
+			if (r == 15) {
+				k += 15;
+				continue;
+			}
+			TEST_ASSERT_EQUAL(0, r);
+			break;
+		}
+		k += r;
+		TEST_ASSERT(k < 64);
+		coef[_zigzag[k]] = _extend(_get_bits(d, s), s) * q[k];
+	}
+
+	for (y = 0; y < 8; y++) {
+		for (x = 0; x < 8; x++) {
+			sum = 0;
+			for (v = 0; v < 8; v++) {
+				cv = v ? 1.0 : M_SQRT1_2;
+				for (u = 0; u < 8; u++) {
+					cu = u ? 1.0 : M_SQRT1_2;
+					sum += cu * cv * coef[v * 8 + u] *
+					       cos((2 * x + 1) * u * M_PI / 16) *
+					       cos((2 * y + 1) * v * M_PI / 16);
+				}
+			}
+			sum = sum / 4 + 128.5;
+			out[y * 8 + x] = sum < 0 ? 0 : (sum > 255 ? 255 : (uint8_t)sum);
+		}
+	}
+}
+
+/* Decode a 4:2:2 JFIF stream into a YUYV frame, return the stream length
+ * consumed up to EOI */
+static uint32_t _decode(const uint8_t* jpeg, uint32_t size, uint8_t* frame,
+			uint32_t stride)
+{
+	struct _decoder d;
+	const uint8_t* p = jpeg;
+	const uint8_t* seg;
+	uint8_t blocks[4][64];
+	int32_t dc[3] = { 0, 0, 0 };
+	uint32_t len, i, n, count, mx, my, r, c;
+	uint8_t marker, id;
+	bool sof = false;
+
+	memset(&d, 0, sizeof(d));
+	TEST_ASSERT(size >= 4);
+	TEST_ASSERT(p[0] == 0xff && p[1] == 0xd8);
+	p += 2;
+
+	for (;;) {
+		TEST_ASSERT(p + 4 <= jpeg + size);
+		TEST_ASSERT_EQUAL(0xff, p[0]);
+		marker = p[1];
+		len = _u16(p + 2);
+		seg = p + 4;
+		p += 2 + len;
+		TEST_ASSERT(p <= jpeg + size);
+
+		if (marker == 0xe0) {
+			TEST_ASSERT(memcmp(seg, "JFIF", 5) == 0);
+		} else if (marker == 0xdb) {
+			for (i = 0; i < len - 2; i += 65) {
+				TEST_ASSERT(seg[i] < 4);  /* 8-bit tables */
+				memcpy(d.qtable[seg[i]], &seg[i + 1], 64);
+			}
+			TEST_ASSERT_EQUAL(len - 2, i);
+		} else if (marker == 0xc0) {
+			TEST_ASSERT_EQUAL(17, len);
+			TEST_ASSERT_EQUAL(8, seg[0]);
+			d.height = _u16(seg + 1);
+			d.width = _u16(seg + 3);
+			TEST_ASSERT_EQUAL(3, seg[5]);
+			TEST_ASSERT(seg[6] == 1 && seg[7] == 0x21);
+			TEST_ASSERT(seg[9] == 2 && seg[10] == 0x11);
+			TEST_ASSERT(seg[12] == 3 && seg[13] == 0x11);
+			for (i = 0; i < 3; i++)
+				d.comp_q[i] = seg[8 + 3 * i];
+			sof = true;
+		} else if (marker == 0xc4) {
+			for (i = 0; i < len - 2; i += 17 + count) {
+				id = seg[i];
+				TEST_ASSERT((id & 0x0f) < 2 && (id >> 4) < 2);
+				for (n = 0, count = 0; n < 16; n++)
+					count += seg[i + 1 + n];
+				_build_dec(id >> 4 ? &d.ac[id & 1] : &d.dc[id & 1],
+					   &seg[i + 1], &seg[i + 17]);
+			}
+			TEST_ASSERT_EQUAL(len - 2, i);
+		} else if (marker == 0xda) {
+			TEST_ASSERT(sof);
+			TEST_ASSERT_EQUAL(12, len);
+			TEST_ASSERT_EQUAL(3, seg[0]);
+			for (i = 0; i < 3; i++) {
+				TEST_ASSERT_EQUAL(i + 1, seg[1 + 2 * i]);
+				d.comp_dc[i] = seg[2 + 2 * i] >> 4;
+				d.comp_ac[i] = seg[2 + 2 * i] & 15;
+			}
+			TEST_ASSERT(seg[7] == 0 && seg[8] == 63 && seg[9] == 0);
+			break;
+		} else {
+			TEST_ASSERT(false);
+		}
+	}
+
+	d.p = p;
+	d.end = jpeg + size;
+	for (my = 0; my < d.height / 8; my++) {
+		for (mx = 0; mx < d.width / 16; mx++) {
+			_decode_block(&d, 0, &dc[0], blocks[0]);
+			_decode_block(&d, 0, &dc[0], blocks[1]);
+			_decode_block(&d, 1, &dc[1], blocks[2]);
+			_decode_block(&d, 2, &dc[2], blocks[3]);
+			for (r = 0; r < 8; r++) {
+				uint8_t* dst = frame + (my * 8 + r) * stride + mx * 32;
+				for (c = 0; c < 8; c++) {
+					dst[2 * c] = blocks[0][r * 8 + c];
+					dst[16 + 2 * c] = blocks[1][r * 8 + c];
+					dst[4 * c + 1] = blocks[2][r * 8 + c];
+					dst[4 * c + 3] = blocks[3][r * 8 + c];
+				}
+			}
+		}
+	}
+
+	/* padding bits are ones, then EOI */
+	while (d.count) {
+		TEST_ASSERT_EQUAL(1, _get_bit(&d));
+	}
+	TEST_ASSERT(d.p + 2 <= d.end);
+	TEST_ASSERT(d.p[0] == 0xff && d.p[1] == 0xd9);
+	return d.p + 2 - jpeg;
+}
+
+/*----------------------------------------------------------------------------
+ *         Helpers
+ *----------------------------------------------------------------------------*/
+
+/* smooth gradients, a disc with sharp edges and a fine checker pattern */
+static void _pattern(uint8_t* frame, uint32_t width, uint32_t height,
+		     uint32_t stride)
+{
+	uint32_t x, y;
+	int32_t dx, dy;
+	uint8_t* p;
+
+	for (y = 0; y < height; y++) {
+		p = frame + y * stride;
+		for (x = 0; x < width; x++) {
+			dx = (int32_t)x - (int32_t)width / 3;
+			dy = (int32_t)y - (int32_t)height / 2;
+			if (dx * dx + dy * dy < (int32_t)(height * height / 9))
+				p[2 * x] = 220;
+			else if (x > 3 * width / 4)
+				p[2 * x] = ((x ^ y) & 2) ? 200 : 40;
+			else
+				p[2 * x] = 16 + (200 * x) / width;
+			if (x & 1)
+				p[2 * x + 1] = 128 + (100 * (int32_t)y) / (int32_t)height - 50;
+			else
+				p[2 * x + 1] = 80 + (96 * x) / width;
+		}
+	}
+}
+
+/* PSNR of the luma or chroma samples of two YUYV frames */
+static double _psnr(const uint8_t* a, uint32_t a_stride, const uint8_t* b,
+		    uint32_t b_stride, uint32_t width, uint32_t height,
+		    bool chroma)
+{
+	double mse = 0, diff;
+	uint32_t x, y;
+
+	for (y = 0; y < height; y++)
+		for (x = chroma ? 1 : 0; x < 2 * width; x += 2) {
+			diff = (double)a[y * a_stride + x] - b[y * b_stride + x];
+			mse += diff * diff;
+		}
+	mse /= width * height;
+	return mse > 0 ? 10 * log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+static uint32_t _crc32(const uint8_t* data, uint32_t size)
+{
+	uint32_t crc = 0xffffffff;
+	uint32_t i, b;
+
+	for (i = 0; i < size; i++) {
+		crc ^= data[i];
+		for (b = 0; b < 8; b++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+	return ~crc;
+}
+
+static uint64_t _now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+/* the decoded frame stays close to the source, the stream grows with the
+ * quality. Above 90 the high frequency divisors are held at their minimum
+ * of 2, which bounds the luma error on sharp edges. */
+static void test_quality(void)
+{
+	static const struct {
+		uint8_t quality;
+		double luma;
+		double chroma;
+	} levels[] = {
+		{ 25, 26.5, 42.0 },
+		{ 50, 29.0, 45.0 },
+		{ 75, 33.0, 45.0 },
+		{ 90, 40.0, 45.0 },
+		{ 100, 40.0, 45.0 },
+	};
+	struct _jpegenc_desc desc = { .width = WIDTH, .height = HEIGHT };
+	double luma, chroma;
+	uint32_t i;
+	int size, last = 0;
+
+	_pattern(_frame, WIDTH, HEIGHT, STRIDE);
+	for (i = 0; i < ARRAY_SIZE(levels); i++) {
+		desc.quality = levels[i].quality;
+		TEST_ASSERT_EQUAL(0, jpegenc_configure(&desc));
+		size = jpegenc_encode(&desc, _frame, STRIDE, _jpeg, sizeof(_jpeg));
+		TEST_ASSERT(size > 0);
+		TEST_ASSERT_EQUAL(size, _decode(_jpeg, size, _decoded, 2 * WIDTH));
+		luma = _psnr(_frame, STRIDE, _decoded, 2 * WIDTH, WIDTH, HEIGHT, false);
+		chroma = _psnr(_frame, STRIDE, _decoded, 2 * WIDTH, WIDTH, HEIGHT, true);
+		printf("    quality %3u: %5d bytes, PSNR Y %.1f dB, C %.1f dB\n",
+		       levels[i].quality, size, luma, chroma);
+		TEST_ASSERT(luma >= levels[i].luma);
+		TEST_ASSERT(chroma >= levels[i].chroma);
+		TEST_ASSERT(size > last);
+		last = size;
+	}
+}
+
+/* flat frames have DC coefficients only and decode exactly */
+static void test_flat(void)
+{
+	static const uint8_t levels[] = { 0, 16, 128, 235, 255 };
+	struct _jpegenc_desc desc = { .width = WIDTH, .height = HEIGHT, .quality = 75 };
+	uint32_t i, j;
+	int size;
+
+	TEST_ASSERT_EQUAL(0, jpegenc_configure(&desc));
+	for (i = 0; i < ARRAY_SIZE(levels); i++) {
+		memset(_frame, levels[i], sizeof(_frame));
+		size = jpegenc_encode(&desc, _frame, STRIDE, _jpeg, sizeof(_jpeg));
+		TEST_ASSERT(size > 0);
+		TEST_ASSERT_EQUAL(size, _decode(_jpeg, size, _decoded, 2 * WIDTH));
+		for (j = 0; j < sizeof(_decoded); j++)
+			TEST_ASSERT(abs(_decoded[j] - levels[i]) <= 1);
+	}
+}
+
+/* the stream of the test pattern does not change unnoticed */
+static void test_golden(void)
+{
+	struct _jpegenc_desc desc = { .width = WIDTH, .height = HEIGHT, .quality = 75 };
+	uint32_t crc;
+	int size;
+
+	_pattern(_frame, WIDTH, HEIGHT, STRIDE);
+	TEST_ASSERT_EQUAL(0, jpegenc_configure(&desc));
+	size = jpegenc_encode(&desc, _frame, STRIDE, _jpeg, sizeof(_jpeg));
+	TEST_ASSERT(size > 0);
+	crc = _crc32(_jpeg, size);
+	printf("    %d bytes, CRC 0x%08x\n", size, crc);
+	TEST_ASSERT_EQUAL(GOLDEN_CRC, crc);
+}
+
+/* full output buffers and unsupported sizes are reported */
+static void test_errors(void)
+{
+	struct _jpegenc_desc desc = { .width = WIDTH, .height = HEIGHT, .quality = 75 };
+	int size, i;
+
+	_pattern(_frame, WIDTH, HEIGHT, STRIDE);
+	TEST_ASSERT_EQUAL(0, jpegenc_configure(&desc));
+	size = jpegenc_encode(&desc, _frame, STRIDE, _jpeg, sizeof(_jpeg));
+	TEST_ASSERT(size > 0);
+
+	/* every size short of the image fails, without writing past it */
+	for (i = 0; i < size; i += 37) {
+		memset(_jpeg2, 0xa5, sizeof(_jpeg2));
+		TEST_ASSERT_EQUAL(-ENOSPC, jpegenc_encode(&desc, _frame, STRIDE,
+							  _jpeg2, i));
+		TEST_ASSERT_EQUAL(0xa5, _jpeg2[i]);
+	}
+	TEST_ASSERT_EQUAL(-ENOSPC, jpegenc_encode(&desc, _frame, STRIDE,
+						  _jpeg2, size - 1));
+	TEST_ASSERT_EQUAL(size, jpegenc_encode(&desc, _frame, STRIDE, _jpeg2, size));
+	TEST_ASSERT(memcmp(_jpeg, _jpeg2, size) == 0);
+
+	desc.width = WIDTH + 8;
+	TEST_ASSERT_EQUAL(-EINVAL, jpegenc_configure(&desc));
+	desc.width = WIDTH;
+	desc.height = HEIGHT + 4;
+	TEST_ASSERT_EQUAL(-EINVAL, jpegenc_configure(&desc));
+	desc.height = 0;
+	TEST_ASSERT_EQUAL(-EINVAL, jpegenc_configure(&desc));
+}
+
+#ifdef CONFIG_HAVE_NEON
+/* NEON kernels give the stream of the C kernels */
+static void test_neon(void)
+{
+	struct _jpegenc_desc desc = { .width = WIDTH, .height = HEIGHT };
+	uint32_t i, q;
+	int size_c, size_n;
+
+	for (q = 5; q <= 100; q += 5) {
+		desc.quality = q;
+		TEST_ASSERT_EQUAL(0, jpegenc_configure(&desc));
+		for (i = 0; i < 3; i++) {
+			if (i == 0)
+				_pattern(_frame, WIDTH, HEIGHT, STRIDE);
+			else
+				memset(_frame, i == 1 ? 0 : 255, sizeof(_frame));
+			jpegenc_use_neon(false);
+			size_c = jpegenc_encode(&desc, _frame, STRIDE, _jpeg, sizeof(_jpeg));
+			jpegenc_use_neon(true);
+			size_n = jpegenc_encode(&desc, _frame, STRIDE, _jpeg2, sizeof(_jpeg2));
+			TEST_ASSERT(size_c > 0);
+			TEST_ASSERT_EQUAL(size_c, size_n);
+			TEST_ASSERT(memcmp(_jpeg, _jpeg2, size_c) == 0);
+		}
+	}
+}
+#endif
+
+/* CPU time per VGA frame on the host */
+static void test_benchmark(void)
+{
+	struct _jpegenc_desc desc = {
+		.width = BENCH_WIDTH,
+		.height = BENCH_HEIGHT,
+		.quality = 75,
+	};
+	uint64_t start, ns[2];
+	int size = 0, k, i;
+
+	_pattern(_bench_frame, BENCH_WIDTH, BENCH_HEIGHT, 2 * BENCH_WIDTH);
+	TEST_ASSERT_EQUAL(0, jpegenc_configure(&desc));
+	for (k = 0; k < 2; k++) {
+		if (k && !jpegenc_use_neon(true))
+			break;
+		if (!k)
+			jpegenc_use_neon(false);
+		start = _now_ns();
+		for (i = 0; i < 10; i++)
+			size = jpegenc_encode(&desc, _bench_frame, 2 * BENCH_WIDTH,
+					      _jpeg, sizeof(_jpeg));
+		ns[k] = (_now_ns() - start) / 10;
+		TEST_ASSERT(size > 0);
+	}
+	if (k == 2)
+		printf("    VGA q75: %d bytes, C %u us, NEON %u us\n", size,
+		       (unsigned)(ns[0] / 1000), (unsigned)(ns[1] / 1000));
+	else
+		printf("    VGA q75: %d bytes, C %u us\n", size,
+		       (unsigned)(ns[0] / 1000));
+	jpegenc_use_neon(true);
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	TEST_RUN(test_quality);
+	TEST_RUN(test_flat);
+	TEST_RUN(test_golden);
+	TEST_RUN(test_errors);
+#ifdef CONFIG_HAVE_NEON
+	TEST_RUN(test_neon);
+#endif
+	TEST_RUN(test_benchmark);
+	return 0;
+}
@@ -0,0 +1,524 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the LCDC frame queue and of lcdc_wait_vsync. The LCDC
+ * registers are plain memory and the base layer DMA channel is a model that
+ * applies the register writes and loads a descriptor at each start of frame.
+ * Frames start at a fixed period of the simulated millisecond timer, the
+ * timeouts of the driver are polled on that timer.
+ *
+ * The tests check the frames shown and released, in order, and that the
+ * waits end with -ETIMEDOUT when the display stalls.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "callback.h"
+#include "chip.h"
+#include "errno.h"
+#include "test.h"
+#include "timer.h"
+#include "trace.h"
+
+#include "display/lcdc.h"
+#include "irq/irq.h"
+#include "mm/cache.h"
+#include "peripherals/pmc.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define WIDTH 8
+#define HEIGHT 4
+
+/* ticks (ms) between two starts of frame, at 60 Hz and on a slow display */
+#define FRAME_MS 16
+#define SLOW_FRAME_MS 80
+
+/* the driver gives up waiting for a descriptor load after 100 ms */
+#define VSYNC_TIMEOUT 100
+
+#define FRAME_COUNT 6
+#define LOG_SIZE 32
+
+/** LCDC DMA descriptor, same layout as the driver one */
+struct _sim_desc {
+	uint32_t addr;
+	uint32_t ctrl;
+	uint32_t next;
+	uint32_t for_alignment_only;
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+Lcdc test_lcdc;
+
+/* frame buffers, the LCDC DMA takes 32-bit addresses */
+static uint8_t _frames[FRAME_COUNT][WIDTH * HEIGHT * 3];
+
+/* LCDC interrupt handler */
+static irq_handler_t _lcdc_handler;
+static void* _lcdc_handler_arg;
+static bool _lcdc_irq_enabled;
+
+/* base layer DMA channel model */
+static uint32_t _base_imr;
+static uint32_t _base_desc;
+static bool _stalled;
+
+static uint64_t _tick;
+static uint32_t _frame_ms;
+
+/* frame buffer loaded at each start of frame */
+static uint32_t _shown[LOG_SIZE];
+static int _shown_count;
+
+/* frame buffers given back by the driver */
+static void* _released[LOG_SIZE];
+static int _released_count;
+
+/*----------------------------------------------------------------------------
+ *         Base layer DMA channel model
+ *----------------------------------------------------------------------------*/
+
+static void _lcdc_set(volatile const uint32_t* reg, uint32_t value)
+{
+	*(volatile uint32_t*)reg = value;
+}
+
+static struct _sim_desc* _desc(uint32_t addr)
+{
+	return (struct _sim_desc*)(uintptr_t)addr;
+}
+
+/* apply the register writes done since the last call */
+static void _lcdc_sync(void)
+{
+	uint32_t chsr = LCDC->LCDC_BASECHSR;
+
+	/* writes are seen in the order of the driver: disable, then enable */
+	if (LCDC->LCDC_BASECHDR & LCDC_BASECHDR_CHDIS)
+		chsr &= ~(LCDC_BASECHSR_CHSR | LCDC_BASECHSR_A2QSR);
+	if (LCDC->LCDC_BASECHER & LCDC_BASECHER_CHEN) {
+		chsr |= LCDC_BASECHSR_CHSR;
+		_base_desc = LCDC->LCDC_BASENEXT;
+	}
+	if (LCDC->LCDC_BASECHER & LCDC_BASECHER_A2QEN)
+		chsr |= LCDC_BASECHSR_A2QSR;
+	LCDC->LCDC_BASECHER = 0;
+	LCDC->LCDC_BASECHDR = 0;
+	_lcdc_set(&LCDC->LCDC_BASECHSR, chsr);
+
+	_base_imr &= ~LCDC->LCDC_BASEIDR;
+	_base_imr |= LCDC->LCDC_BASEIER;
+	LCDC->LCDC_BASEIDR = 0;
+	LCDC->LCDC_BASEIER = 0;
+}
+
+/* start of frame: load a descriptor, from the head register when one is
+ * added to the queue, raise its flags and the interrupt */
+static void _lcdc_frame(void)
+{
+	uint32_t chsr, isr = 0;
+	struct _sim_desc* desc;
+
+	_lcdc_sync();
+	chsr = LCDC->LCDC_BASECHSR;
+	if (!(chsr & LCDC_BASECHSR_CHSR))
+		return;
+
+	if (chsr & LCDC_BASECHSR_A2QSR) {
+		_base_desc = LCDC->LCDC_BASEHEAD;
+		_lcdc_set(&LCDC->LCDC_BASECHSR, chsr & ~LCDC_BASECHSR_A2QSR);
+		if (_desc(_base_desc)->ctrl & LCDC_BASECTRL_ADDIEN)
+			isr |= LCDC_BASEISR_ADD;
+	} else {
+		_base_desc = _desc(_base_desc)->next;
+	}
+	desc = _desc(_base_desc);
+	TEST_ASSERT(desc->ctrl & LCDC_BASECTRL_DFETCH);
+	if (desc->ctrl & LCDC_BASECTRL_DSCRIEN)
+		isr |= LCDC_BASEISR_DSCR;
+	LCDC->LCDC_BASEADDR = desc->addr;
+	_lcdc_set(&LCDC->LCDC_BASEISR, isr);
+
+	TEST_ASSERT(_shown_count < LOG_SIZE);
+	_shown[_shown_count++] = desc->addr;
+
+	if ((isr & _base_imr) && _lcdc_irq_enabled &&
+	    (LCDC->LCDC_LCDIER & LCDC_LCDIER_BASEIE))
+		_lcdc_handler(ID_LCDC, _lcdc_handler_arg);
+}
+
+static int _release(void* arg, void* buffer)
+{
+	TEST_ASSERT(_released_count < LOG_SIZE);
+	_released[_released_count++] = buffer;
+	return 0;
+}
+
+/* run the display for some frames */
+static void _run_frames(int count)
+{
+	int i;
+
+	for (i = 0; i < count * _frame_ms; i++)
+		timer_get_tick();
+}
+
+/*----------------------------------------------------------------------------
+ *         Mocks
+ *----------------------------------------------------------------------------*/
+
+uint64_t timer_get_tick(void)
+{
+	/* reads of the status register clear it, the driver reads it between
+	 * two ticks */
+	_lcdc_set(&LCDC->LCDC_BASEISR, 0);
+
+	_tick++;
+	_lcdc_sync();
+	if (!_stalled && (_tick % _frame_ms) == 0)
+		_lcdc_frame();
+	return _tick;
+}
+
+uint64_t timer_get_interval(uint64_t start, uint64_t end)
+{
+	return end - start;
+}
+
+void timer_start_timeout(struct _timeout* timeout, uint64_t count)
+{
+	timeout->start = timer_get_tick();
+	timeout->count = count;
+}
+
+void timer_reset_timeout(struct _timeout* timeout)
+{
+	timeout->start = timer_get_tick();
+}
+
+uint8_t timer_timeout_reached(struct _timeout* timeout)
+{
+	return timer_get_interval(timeout->start, timer_get_tick()) >= timeout->count;
+}
+
+void irq_add_handler(uint32_t source, irq_handler_t handler, void* user_arg)
+{
+	TEST_ASSERT_EQUAL(ID_LCDC, source);
+	_lcdc_handler = handler;
+	_lcdc_handler_arg = user_arg;
+}
+
+void irq_enable(uint32_t source)
+{
+	_lcdc_irq_enabled = true;
+}
+
+void irq_disable(uint32_t source)
+{
+	_lcdc_irq_enabled = false;
+}
+
+void cache_clean_region(const void* start, uint32_t length)
+{
+}
+
+/* the LCDC clocks and power run once the peripheral clock is enabled */
+void pmc_configure_peripheral(uint32_t id, const struct _pmc_periph_cfg* cfg,
+			      bool enable)
+{
+	TEST_ASSERT_EQUAL(ID_LCDC, id);
+	_lcdc_set(&LCDC->LCDC_LCDSR, LCDC_LCDSR_CLKSTS | LCDC_LCDSR_LCDSTS |
+		  LCDC_LCDSR_DISPSTS);
+}
+
+void pmc_disable_peripheral(uint32_t id)
+{
+	_lcdc_set(&LCDC->LCDC_LCDSR, 0);
+}
+
+bool pmc_has_system_clock(enum _pmc_system_clock clock)
+{
+	return true;
+}
+
+void pmc_enable_system_clock(enum _pmc_system_clock clock)
+{
+}
+
+void pmc_disable_system_clock(enum _pmc_system_clock clock)
+{
+}
+
+uint32_t pmc_get_master_clock(void)
+{
+	return 166000000;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void _setup(void)
+{
+	static const struct _lcdc_desc desc = {
+		.width = WIDTH,
+		.height = HEIGHT,
+		.framerate = 60,
+	};
+
+	memset(&test_lcdc, 0, sizeof(test_lcdc));
+	_base_imr = 0;
+	_base_desc = 0;
+	_stalled = false;
+	_frame_ms = FRAME_MS;
+	_shown_count = 0;
+	_released_count = 0;
+	_lcdc_irq_enabled = false;
+
+	lcdc_configure(&desc);
+}
+
+/* show a buffer on the base layer and wait for it, the channel is enabled
+ * before the next start of frame */
+static void _show_base(void* buffer)
+{
+	lcdc_show_base(buffer, 24, false);
+	_lcdc_sync();
+	TEST_ASSERT_EQUAL(0, lcdc_wait_vsync(LCDC_BASE));
+	TEST_ASSERT_EQUAL((uint32_t)buffer, LCDC->LCDC_BASEADDR);
+	_shown_count = 0;
+}
+
+/* the channel sees an added descriptor before the next start of frame */
+static int _queue_frame(void* buffer)
+{
+	int err = lcdc_queue_frame(LCDC_BASE, buffer);
+
+	_lcdc_sync();
+	return err;
+}
+
+static void _start_queue(void)
+{
+	struct _callback release;
+
+	callback_set(&release, _release, NULL);
+	TEST_ASSERT_EQUAL(0, lcdc_queue_start(LCDC_BASE, &release));
+}
+
+/* a buffer is on screen once lcdc_wait_vsync returns, which takes at most
+ * one frame */
+static void test_wait_vsync(void)
+{
+	uint64_t start;
+
+	_setup();
+	TEST_ASSERT_EQUAL(-EINVAL, lcdc_wait_vsync(LCDC_BASE));
+
+	_show_base(_frames[0]);
+
+	start = _tick;
+	TEST_ASSERT_EQUAL(0, lcdc_wait_vsync(LCDC_BASE));
+	TEST_ASSERT(_tick - start <= FRAME_MS + 1);
+	TEST_ASSERT_EQUAL(1, _shown_count);
+	TEST_ASSERT_EQUAL((uint32_t)_frames[0], _shown[0]);
+
+	/* a new buffer goes through the head of the DMA queue */
+	lcdc_show_base(_frames[1], 24, false);
+	TEST_ASSERT_EQUAL(0, lcdc_wait_vsync(LCDC_BASE));
+	TEST_ASSERT_EQUAL((uint32_t)_frames[1], LCDC->LCDC_BASEADDR);
+}
+
+static void test_wait_vsync_timeout(void)
+{
+	uint64_t start;
+
+	_setup();
+	_show_base(_frames[0]);
+
+	_stalled = true;
+	start = _tick;
+	TEST_ASSERT_EQUAL(-ETIMEDOUT, lcdc_wait_vsync(LCDC_BASE));
+	TEST_ASSERT(_tick - start >= VSYNC_TIMEOUT);
+	TEST_ASSERT(_tick - start <= VSYNC_TIMEOUT + 2);
+	TEST_ASSERT_EQUAL(0, _shown_count);
+}
+
+/* each queued frame is shown once, in order, and the previous one is
+ * released when it is on screen */
+static void test_queue_order(void)
+{
+	int i;
+
+	_setup();
+	TEST_ASSERT_EQUAL(-EINVAL, lcdc_queue_start(LCDC_BASE, NULL));
+	TEST_ASSERT_EQUAL(-EINVAL, _queue_frame(_frames[1]));
+	TEST_ASSERT_EQUAL(-ENODEV, lcdc_queue_start(LCDC_CONTROLLER, NULL));
+
+	_show_base(_frames[0]);
+	_start_queue();
+
+	for (i = 1; i < LCDC_FRAME_QUEUE_SIZE; i++)
+		TEST_ASSERT_EQUAL(0, _queue_frame(_frames[i]));
+	TEST_ASSERT_EQUAL(-EBUSY, _queue_frame(_frames[i]));
+	TEST_ASSERT_EQUAL(0, _released_count);
+
+	TEST_ASSERT_EQUAL(0, lcdc_wait_vsync(LCDC_BASE));
+	TEST_ASSERT_EQUAL(LCDC_FRAME_QUEUE_SIZE - 1, _shown_count);
+	TEST_ASSERT_EQUAL(LCDC_FRAME_QUEUE_SIZE - 1, _released_count);
+	for (i = 0; i < LCDC_FRAME_QUEUE_SIZE - 1; i++) {
+		TEST_ASSERT_EQUAL((uint32_t)_frames[i + 1], _shown[i]);
+		TEST_ASSERT(_released[i] == _frames[i]);
+	}
+
+	/* the last frame stays on screen and owned by the LCDC */
+	_run_frames(3);
+	TEST_ASSERT_EQUAL(LCDC_FRAME_QUEUE_SIZE - 1, _released_count);
+	TEST_ASSERT_EQUAL((uint32_t)_frames[LCDC_FRAME_QUEUE_SIZE - 1],
+			  LCDC->LCDC_BASEADDR);
+
+	/* released buffers are queued again, the slots wrap around */
+	for (i = 0; i < FRAME_COUNT; i++) {
+		void* buffer = _released[i];
+
+		TEST_ASSERT_EQUAL(0, _queue_frame(buffer));
+		_run_frames(1);
+		TEST_ASSERT_EQUAL(LCDC_FRAME_QUEUE_SIZE + i, _released_count);
+		TEST_ASSERT_EQUAL((uint32_t)buffer, LCDC->LCDC_BASEADDR);
+	}
+}
+
+/* stopping the queue waits for the frame queued on the DMA and releases the
+ * waiting ones without showing them */
+static void test_queue_stop(void)
+{
+	_setup();
+	_show_base(_frames[0]);
+	_start_queue();
+
+	TEST_ASSERT_EQUAL(0, _queue_frame(_frames[1]));
+	TEST_ASSERT_EQUAL(0, _queue_frame(_frames[2]));
+	TEST_ASSERT_EQUAL(0, lcdc_queue_stop(LCDC_BASE));
+
+	TEST_ASSERT_EQUAL(1, _shown_count);
+	TEST_ASSERT_EQUAL((uint32_t)_frames[1], _shown[0]);
+	TEST_ASSERT_EQUAL(2, _released_count);
+	TEST_ASSERT(_released[0] == _frames[2]);
+	TEST_ASSERT(_released[1] == _frames[0]);
+
+	TEST_ASSERT_EQUAL(-EINVAL, _queue_frame(_frames[3]));
+	TEST_ASSERT_EQUAL(0, lcdc_queue_stop(LCDC_BASE));
+
+	/* the layer keeps the last frame and can start a new queue */
+	_run_frames(2);
+	TEST_ASSERT_EQUAL((uint32_t)_frames[1], LCDC->LCDC_BASEADDR);
+	_start_queue();
+	TEST_ASSERT_EQUAL(0, _queue_frame(_frames[3]));
+	TEST_ASSERT_EQUAL(0, lcdc_wait_vsync(LCDC_BASE));
+	TEST_ASSERT_EQUAL((uint32_t)_frames[3], LCDC->LCDC_BASEADDR);
+	TEST_ASSERT(_released[2] == _frames[1]);
+}
+
+/* with a stalled display, the waits give up and the LCDC keeps the frames
+ * it may still read */
+static void test_queue_stall(void)
+{
+	uint64_t start;
+
+	_setup();
+	_show_base(_frames[0]);
+	_start_queue();
+
+	_stalled = true;
+	TEST_ASSERT_EQUAL(0, _queue_frame(_frames[1]));
+	TEST_ASSERT_EQUAL(0, _queue_frame(_frames[2]));
+
+	start = _tick;
+	TEST_ASSERT_EQUAL(-ETIMEDOUT, lcdc_wait_vsync(LCDC_BASE));
+	TEST_ASSERT(_tick - start >= VSYNC_TIMEOUT);
+
+	start = _tick;
+	TEST_ASSERT_EQUAL(-ETIMEDOUT, lcdc_queue_stop(LCDC_BASE));
+	TEST_ASSERT(_tick - start >= VSYNC_TIMEOUT);
+
+	/* only the waiting frame is released */
+	TEST_ASSERT_EQUAL(1, _released_count);
+	TEST_ASSERT(_released[0] == _frames[2]);
+	TEST_ASSERT_EQUAL(0, _shown_count);
+}
+
+/* a slow display still shows a long queue: each frame gets its own
+ * timeout */
+static void test_queue_slow_display(void)
+{
+	int i;
+
+	_setup();
+	_show_base(_frames[0]);
+	_start_queue();
+
+	for (i = 1; i < LCDC_FRAME_QUEUE_SIZE; i++)
+		TEST_ASSERT_EQUAL(0, _queue_frame(_frames[i]));
+
+	/* two frames take more than the timeout */
+	_frame_ms = SLOW_FRAME_MS;
+	TEST_ASSERT(2 * SLOW_FRAME_MS > VSYNC_TIMEOUT);
+	TEST_ASSERT_EQUAL(0, lcdc_wait_vsync(LCDC_BASE));
+	TEST_ASSERT_EQUAL(LCDC_FRAME_QUEUE_SIZE - 1, _shown_count);
+	TEST_ASSERT_EQUAL(LCDC_FRAME_QUEUE_SIZE - 1, _released_count);
+}
+
+int main(void)
+{
+	TEST_RUN(test_wait_vsync);
+	TEST_RUN(test_wait_vsync_timeout);
+	TEST_RUN(test_queue_order);
+	TEST_RUN(test_queue_stop);
+	TEST_RUN(test_queue_stall);
+	TEST_RUN(test_queue_slow_display);
+	return 0;
+}
@@ -0,0 +1,374 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the SAM-BA applet image helpers: LZ4 block decompression
+ * (round trip through a reference compressor, in-place layout, malformed
+ * blocks), CRC32/SHA-256 digests and the 'write compressed' and 'verify'
+ * command parameter checks.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "applet.h"
+#include "applet_image.h"
+#include "test.h"
+#include "trace.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define PAGE_SIZE   512
+#define BUFFER_SIZE (64 * 1024)
+#define DATA_SIZE   (32 * 1024)
+
+/* LZ4 block format limits */
+#define LZ4_MIN_MATCH     4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MF_LIMIT      12
+#define LZ4_HASH_LOG      12
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+static uint8_t _buffer[BUFFER_SIZE];
+static uint8_t _data[DATA_SIZE];
+static uint8_t _comp[DATA_SIZE + DATA_SIZE / 255 + 16];
+
+/* pages written by the fake 'write pages' command */
+static uint32_t _written_calls;
+static uint32_t _written_offset;
+static uint32_t _written_length;
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static uint32_t _write_pages(uint32_t cmd, uint32_t* args)
+{
+	union read_write_erase_pages_mailbox* mbx =
+		(union read_write_erase_pages_mailbox*)args;
+
+	_written_calls++;
+	_written_offset = mbx->in.offset;
+	_written_length = mbx->in.length;
+	mbx->out.pages = mbx->in.length;
+	return APPLET_SUCCESS;
+}
+
+/* pages read from _data by the fake 'read pages' command */
+static uint32_t _read_pages(uint32_t cmd, uint32_t* args)
+{
+	union read_write_erase_pages_mailbox* mbx =
+		(union read_write_erase_pages_mailbox*)args;
+
+	memcpy(_buffer, _data + mbx->in.offset * PAGE_SIZE,
+	       mbx->in.length * PAGE_SIZE);
+	mbx->out.pages = mbx->in.length;
+	return APPLET_SUCCESS;
+}
+
+applet_command_handler_t get_applet_command_handler(uint8_t cmd)
+{
+	if (cmd == APPLET_CMD_WRITE_PAGES)
+		return _write_pages;
+	if (cmd == APPLET_CMD_READ_PAGES)
+		return _read_pages;
+	return NULL;
+}
+
+static uint8_t* _lz4_length(uint8_t* op, uint32_t len)
+{
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+static uint8_t* _lz4_sequence(uint8_t* op, const uint8_t* lit, uint32_t lit_len,
+		uint32_t offset, uint32_t match_len)
+{
+	uint8_t* token = op++;
+
+	*token = (lit_len < 15 ? lit_len : 15) << 4;
+	if (lit_len >= 15)
+		op = _lz4_length(op, lit_len - 15);
+	memcpy(op, lit, lit_len);
+	op += lit_len;
+
+	if (match_len) {
+		match_len -= LZ4_MIN_MATCH;
+		*token |= match_len < 15 ? match_len : 15;
+		*op++ = offset;
+		*op++ = offset >> 8;
+		if (match_len >= 15)
+			op = _lz4_length(op, match_len - 15);
+	}
+	return op;
+}
+
+/* Greedy reference LZ4 block compressor, same format as
+ * LZ4_compress_default() */
+static uint32_t _lz4_compress(const uint8_t* src, uint32_t len, uint8_t* dst)
+{
+	static int32_t table[1 << LZ4_HASH_LOG];
+	uint32_t ip = 0, anchor = 0;
+	uint8_t* op = dst;
+
+	memset(table, 0xff, sizeof(table));
+	while (len >= LZ4_MF_LIMIT && ip < len - LZ4_MF_LIMIT) {
+		uint32_t seq, hash, match_len;
+		int32_t ref;
+
+		memcpy(&seq, src + ip, 4);
+		hash = (seq * 2654435761u) >> (32 - LZ4_HASH_LOG);
+		ref = table[hash];
+		table[hash] = ip;
+
+		if (ref < 0 || ip - ref > 0xffff || memcmp(src + ref, src + ip, 4)) {
+			ip++;
+			continue;
+		}
+
+		match_len = LZ4_MIN_MATCH;
+		while (ip + match_len < len - LZ4_LAST_LITERALS &&
+		       src[ref + match_len] == src[ip + match_len])
+			match_len++;
+
+		op = _lz4_sequence(op, src + anchor, ip - anchor, ip - ref, match_len);
+		ip += match_len;
+		anchor = ip;
+	}
+	op = _lz4_sequence(op, src + anchor, len - anchor, 0, 0);
+
+	return op - dst;
+}
+
+/* Decompress in-place the way the applet does: compressed block at the end
+ * of a buffer of the minimum documented size */
+static void _check_round_trip(const uint8_t* data, uint32_t len)
+{
+	uint32_t comp_len = _lz4_compress(data, len, _comp);
+	uint32_t size = len + APPLET_LZ4_MARGIN(comp_len);
+	uint8_t* src;
+
+	TEST_ASSERT(size <= BUFFER_SIZE);
+	memset(_buffer, 0xa5, BUFFER_SIZE);
+	src = _buffer + size - comp_len;
+	memcpy(src, _comp, comp_len);
+
+	TEST_ASSERT_EQUAL(len, applet_lz4_decompress(src, comp_len, _buffer, len));
+	TEST_ASSERT(memcmp(_buffer, data, len) == 0);
+}
+
+static void _fill_pattern(uint8_t* data, uint32_t len)
+{
+	static const char text[] = "The quick brown fox jumps over the lazy dog. ";
+	uint32_t i, seed = 1;
+
+	for (i = 0; i < len; i++) {
+		seed = seed * 1103515245 + 12345;
+		/* text with some noise, mostly short and long matches */
+		data[i] = (seed >> 24) < 8 ? (seed >> 16) : text[i % (sizeof(text) - 1)];
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_lz4_round_trip(void)
+{
+	uint32_t i, seed = 42;
+
+	/* overlapping matches with offset 1 */
+	memset(_data, 0, DATA_SIZE);
+	_check_round_trip(_data, DATA_SIZE);
+
+	/* incompressible, literals only with long length extensions */
+	for (i = 0; i < DATA_SIZE; i++) {
+		seed = seed * 1103515245 + 12345;
+		_data[i] = seed >> 16;
+	}
+	_check_round_trip(_data, DATA_SIZE);
+
+	_fill_pattern(_data, DATA_SIZE);
+	_check_round_trip(_data, DATA_SIZE);
+
+	/* blocks too short to hold a match */
+	for (i = 0; i <= LZ4_MF_LIMIT + 1; i++)
+		_check_round_trip(_data, i);
+}
+
+static void test_lz4_invalid(void)
+{
+	/* 4 literals then a match of offset 5, before the start */
+	static const uint8_t bad_offset[] = { 0x40, 'a', 'b', 'c', 'd', 5, 0 };
+	/* 4 literals then a match of offset 0 */
+	static const uint8_t zero_offset[] = { 0x40, 'a', 'b', 'c', 'd', 0, 0 };
+	/* 15 + more literals, length extension missing */
+	static const uint8_t truncated_len[] = { 0xf0 };
+	/* 8 literals announced, 3 present */
+	static const uint8_t truncated_lit[] = { 0x80, 'a', 'b', 'c' };
+	uint32_t comp_len;
+
+	TEST_ASSERT(applet_lz4_decompress(bad_offset, sizeof(bad_offset), _buffer, 64) < 0);
+	TEST_ASSERT(applet_lz4_decompress(zero_offset, sizeof(zero_offset), _buffer, 64) < 0);
+	TEST_ASSERT(applet_lz4_decompress(truncated_len, sizeof(truncated_len), _buffer, 64) < 0);
+	TEST_ASSERT(applet_lz4_decompress(truncated_lit, sizeof(truncated_lit), _buffer, 64) < 0);
+
+	/* valid block, output buffer one byte short */
+	_fill_pattern(_data, 4096);
+	comp_len = _lz4_compress(_data, 4096, _comp);
+	TEST_ASSERT(applet_lz4_decompress(_comp, comp_len, _buffer, 4095) < 0);
+}
+
+static void test_digests(void)
+{
+	static const uint8_t sha_abc[32] = {
+		0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+		0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+		0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+		0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+	};
+	struct applet_sha256 sha;
+	uint8_t digest[32];
+
+	TEST_ASSERT_EQUAL(0xcbf43926, applet_crc32(0, (const uint8_t*)"123456789", 9));
+	/* CRC can be computed in several parts */
+	TEST_ASSERT_EQUAL(0xcbf43926, applet_crc32(applet_crc32(0,
+			(const uint8_t*)"1234", 4), (const uint8_t*)"56789", 5));
+
+	applet_sha256_init(&sha);
+	applet_sha256_update(&sha, (const uint8_t*)"a", 1);
+	applet_sha256_update(&sha, (const uint8_t*)"bc", 2);
+	applet_sha256_final(&sha, digest);
+	TEST_ASSERT(memcmp(digest, sha_abc, sizeof(digest)) == 0);
+}
+
+static void test_write_compressed(void)
+{
+	union write_compressed_mailbox mbx;
+	uint32_t comp_len, pages = 8;
+
+	applet_image_set_info(_buffer, BUFFER_SIZE, PAGE_SIZE);
+
+	_fill_pattern(_data, pages * PAGE_SIZE);
+	comp_len = _lz4_compress(_data, pages * PAGE_SIZE, _comp);
+	memcpy(_buffer + BUFFER_SIZE - comp_len, _comp, comp_len);
+
+	_written_calls = 0;
+	memset(&mbx, 0, sizeof(mbx));
+	mbx.in.offset = 3;
+	mbx.in.length = pages;
+	mbx.in.comp_size = comp_len;
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS,
+		applet_handle_image_command(APPLET_CMD_WRITE_COMPRESSED, (uint32_t*)&mbx));
+	TEST_ASSERT_EQUAL(1, _written_calls);
+	TEST_ASSERT_EQUAL(3, _written_offset);
+	TEST_ASSERT_EQUAL(pages, _written_length);
+	TEST_ASSERT_EQUAL(pages, mbx.out.pages);
+	TEST_ASSERT(memcmp(_buffer, _data, pages * PAGE_SIZE) == 0);
+
+	/* length * page_size wraps to a small value in 32 bits */
+	_written_calls = 0;
+	mbx.in.offset = 0;
+	mbx.in.length = 0x80000001;
+	mbx.in.comp_size = 16;
+	TEST_ASSERT_EQUAL(APPLET_FAIL,
+		applet_handle_image_command(APPLET_CMD_WRITE_COMPRESSED, (uint32_t*)&mbx));
+	TEST_ASSERT_EQUAL(0, _written_calls);
+
+	/* decompressed data and margin do not fit */
+	mbx.in.length = BUFFER_SIZE / PAGE_SIZE;
+	TEST_ASSERT_EQUAL(APPLET_FAIL,
+		applet_handle_image_command(APPLET_CMD_WRITE_COMPRESSED, (uint32_t*)&mbx));
+	TEST_ASSERT_EQUAL(0, _written_calls);
+
+	/* applet without page size */
+	applet_image_set_info(_buffer, BUFFER_SIZE, 0);
+	mbx.in.length = 1;
+	TEST_ASSERT_EQUAL(APPLET_FAIL,
+		applet_handle_image_command(APPLET_CMD_WRITE_COMPRESSED, (uint32_t*)&mbx));
+	TEST_ASSERT_EQUAL(0, _written_calls);
+}
+
+static void test_verify(void)
+{
+	union verify_mailbox mbx;
+	uint32_t pages = 40;
+
+	/* reads are split in buffer sized chunks */
+	applet_image_set_info(_buffer, 16 * PAGE_SIZE, PAGE_SIZE);
+	_fill_pattern(_data, DATA_SIZE);
+
+	memset(&mbx, 0, sizeof(mbx));
+	mbx.in.offset = 2;
+	mbx.in.length = pages;
+	mbx.in.algo = APPLET_VERIFY_CRC32;
+	TEST_ASSERT_EQUAL(APPLET_SUCCESS,
+		applet_handle_image_command(APPLET_CMD_VERIFY, (uint32_t*)&mbx));
+	TEST_ASSERT_EQUAL(applet_crc32(0, _data + 2 * PAGE_SIZE, pages * PAGE_SIZE),
+			mbx.out.digest[0]);
+
+	/* no page size, or buffer smaller than a page */
+	applet_image_set_info(_buffer, 16 * PAGE_SIZE, 0);
+	mbx.in.length = pages;
+	TEST_ASSERT_EQUAL(APPLET_FAIL,
+		applet_handle_image_command(APPLET_CMD_VERIFY, (uint32_t*)&mbx));
+	applet_image_set_info(_buffer, PAGE_SIZE - 1, PAGE_SIZE);
+	TEST_ASSERT_EQUAL(APPLET_FAIL,
+		applet_handle_image_command(APPLET_CMD_VERIFY, (uint32_t*)&mbx));
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	TEST_RUN(test_lz4_round_trip);
+	TEST_RUN(test_lz4_invalid);
+	TEST_RUN(test_digests);
+	TEST_RUN(test_write_compressed);
+	TEST_RUN(test_verify);
+	return 0;
+}
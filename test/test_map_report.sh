@@ -0,0 +1,193 @@
+#!/bin/sh
+# ----------------------------------------------------------------------------
+#                  Atmel Microcontroller Software Support
+# ----------------------------------------------------------------------------
+# Copyright (c) 2017, Atmel Corporation
+#
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following condition is met:
+#
+# - Redistributions of source code must retain the above copyright notice,
+# this list of conditions and the disclaimer below.
+#
+# Atmel's name may not be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# DISCLAIMER:  THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+# IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+# DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+# INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+# OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+# LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+# NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+# EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+# ----------------------------------------------------------------------------
+
+#
+# Host test of scripts/map_report.sh, run on the map file and symbol list of
+# a made-up QSPI XIP build and of a made-up SRAM build.
+#
+# usage: test_map_report.sh [path to map_report.sh]
+#
+
+report=${1:-$(dirname "$0")/../scripts/map_report.sh}
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+failures=0
+
+# begin <test>
+begin() {
+	t=$1
+	echo "  $t"
+}
+
+fail() {
+	echo "$1: check failed: $2"
+	failures=$((failures + 1))
+}
+
+# expect <test> <file> <extended regex>
+expect() {
+	grep -Eq "$3" "$2" || fail "$1" "no line matching '$3'"
+}
+
+# expect_not <test> <file> <extended regex>
+expect_not() {
+	! grep -Eq "$3" "$2" || fail "$1" "unexpected line matching '$3'"
+}
+
+# expect_status <test> <expected> <actual>
+expect_status() {
+	[ "$2" = "$3" ] || fail "$1" "exit status $3, expected $2"
+}
+
+# QSPI build: code in QSPI, .relocate in SRAM loaded from QSPI, irqHandler
+# moved to SRAM, callback_call and memcpy left in QSPI. Long section names
+# are wrapped by ld onto two lines.
+cat > "$tmp/qspi.map" <<'MAP'
+Archive member included to satisfy reference by file (symbol)
+
+Memory Configuration
+
+Name             Origin             Length             Attributes
+sram             0x00200000         0x00020000         xrw
+qspi             0xd0000000         0x01000000         xr
+*default*        0x00000000         0xffffffff
+
+Linker script and memory map
+
+                0x00200000                _sram = ORIGIN (sram)
+
+.vectors        0xd0000000       0x40
+ *(.vectors)
+ .vectors       0xd0000000       0x40 build/cstartup.o
+
+.text           0xd0000040     0x1000
+ *(.text*)
+ .text          0xd0000040      0x100 build/main.o
+                0xd0000040                main
+ .text.callback_call
+                0xd0000140       0x20 build/callback.o
+                0xd0000140                callback_call
+
+.relocate       0x00200000      0x100 load address 0xd0001040
+ *(.ramfunc*)
+ .ramfunc       0x00200000       0x40 build/irq.o
+                0x00200000                irqHandler
+ .ramfunc.aic_get_current_interrupt_source
+                0x00200040       0x30 build/aic5.o
+ *(.fastdata*)
+ .fastdata      0x00200070       0x10 build/xdmac.o
+
+.bss_with_a_very_long_name
+                0x00200100      0x200
+
+.empty          0x00200300        0x0
+MAP
+
+cat > "$tmp/qspi.sym" <<'SYM'
+00200000 T irqHandler
+00200040 t aic_get_current_interrupt_source
+d0000040 T main
+d0000140 T callback_call
+d0000500 W memcpy
+d0000600 D memset
+SYM
+
+# SRAM build: everything in SRAM, the hot symbols are not checked
+cat > "$tmp/sram.map" <<'MAP'
+Memory Configuration
+
+Name             Origin             Length             Attributes
+sram             0x00200000         0x00020000         xrw
+qspi             0xd0000000         0x01000000         xr
+*default*        0x00000000         0xffffffff
+
+Linker script and memory map
+
+.text           0x00200000      0x800
+ .text          0x00200000      0x800 build/main.o
+MAP
+
+cat > "$tmp/sram.sym" <<'SYM'
+00200000 T main
+00200400 T memcpy
+SYM
+
+begin regions
+sh "$report" "$tmp/qspi.map" "$tmp/qspi.sym" > "$tmp/out" 2>&1
+expect_status $t 0 $?
+# sram: .relocate 0x100 + .bss 0x200, qspi: .vectors 0x40 + .text 0x1000 +
+# .relocate load image 0x100
+expect $t "$tmp/out" "^sram +0x00200000 +131072 +768 +0%$"
+expect $t "$tmp/out" "^qspi +0xd0000000 +16777216 +4416 +0%$"
+expect_not $t "$tmp/out" "^\*default\*"
+
+begin sections
+expect $t "$tmp/out" "^\.vectors +qspi +0xd0000000 +64$"
+expect $t "$tmp/out" "^\.text +qspi +0xd0000040 +4096$"
+expect $t "$tmp/out" "^\.relocate +sram +0x00200000 +256$"
+expect $t "$tmp/out" "^\.bss_with_a_very_long_name +sram +0x00200100 +512$"
+expect_not $t "$tmp/out" "^\.empty"
+expect_not $t "$tmp/out" "^\.text\.callback_call"
+
+begin attributes
+expect $t "$tmp/out" "^RAMFUNC code: 112 bytes, FASTDATA: 16 bytes$"
+
+begin hot_symbols
+expect $t "$tmp/out" "hot symbol callback_call executes from qspi \(0xd0000140\)"
+expect $t "$tmp/out" "hot symbol memcpy executes from qspi \(0xd0000500\)"
+expect_not $t "$tmp/out" "hot symbol (irqHandler|aic_get_current|main|memset)"
+
+begin extra_symbols
+sh "$report" "$tmp/qspi.map" "$tmp/qspi.sym" main > "$tmp/out" 2>&1
+expect $t "$tmp/out" "hot symbol main executes from qspi"
+
+begin check
+sh "$report" -c "$tmp/qspi.map" "$tmp/qspi.sym" > "$tmp/out" 2>&1
+expect_status $t 1 $?
+
+begin other_region
+sh "$report" -c -r sram "$tmp/qspi.map" "$tmp/qspi.sym" > "$tmp/out" 2>&1
+expect_status $t 1 $?
+expect $t "$tmp/out" "hot symbol irqHandler executes from sram"
+expect_not $t "$tmp/out" "hot symbol callback_call"
+
+begin unused_region
+sh "$report" -c "$tmp/sram.map" "$tmp/sram.sym" > "$tmp/out" 2>&1
+expect_status $t 0 $?
+expect $t "$tmp/out" "^sram +0x00200000 +131072 +2048 +1%$"
+expect_not $t "$tmp/out" "^qspi"
+expect_not $t "$tmp/out" "hot symbol"
+
+begin usage
+sh "$report" "$tmp/qspi.map" > "$tmp/out" 2>&1
+expect_status $t 2 $?
+sh "$report" -x "$tmp/qspi.map" "$tmp/qspi.sym" > "$tmp/out" 2>&1
+expect_status $t 2 $?
+
+[ $failures -eq 0 ]
@@ -0,0 +1,892 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the MCAN driver against a simulated controller. The MCAN
+ * registers are plain memory. The controller model finds the Message RAM
+ * only through the start addresses, element counts and element sizes the
+ * driver programmed from configure_ram(), as the hardware does. It receives
+ * frames through the acceptance filters into the Rx FIFO 0, and sends the
+ * Tx Buffers requested through TXBAR.
+ *
+ * The tests check the Message RAM layout, the Rx FIFO ring (views, batch
+ * acknowledge, overflow and watermark), the Tx queue refill from the
+ * transmission complete interrupt, and a dedicated Tx Buffer sent while the
+ * Tx queue runs: its interrupt enable bit must survive the completions of
+ * the queue.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "callback.h"
+#include "chip.h"
+#include "errno.h"
+#include "io.h"
+#include "test.h"
+#include "trace.h"
+
+#include "can/can-bus.h"
+#include "can/mcand.h"
+#include "irq/irq.h"
+#include "peripherals/pmc.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+/* MCAN clock, and bit rates giving a prescaler of 4 with the driver quanta */
+#define MCAN_CLOCK 80000000
+#define BITRATE 500000
+#define BITRATE_FD 1000000
+
+/* Message RAM of the driver */
+#define STD_FILTERS 8
+#define EXT_FILTERS 8
+#define RX_FIFO0_SIZE 12
+#define RX_BUFFERS 4
+#define TX_BUFFERS 4
+#define TX_FIFO_SIZE 4
+#define ELEM_WORDS (2 + 64 / 4)
+
+#define LOG_SIZE 64
+
+/* no pending acknowledge in RXF0A */
+#define NO_ACK 0xFFFFFFFF
+
+/** frame sent on the bus */
+struct _sim_sent {
+	uint32_t buf;
+	uint32_t id;
+	uint8_t len;
+	uint8_t data0;
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+uint32_t test_irq_disabled;
+
+Mcan test_mcan[CAN_IFACE_COUNT];
+Matrix test_matrix;
+
+static irq_handler_t _mcan_handler;
+static void* _mcan_handler_arg;
+static bool _mcan_irq_enabled;
+
+/* interrupt flags not yet seen by the driver */
+static uint32_t _ir;
+
+/* Rx FIFO 0 model */
+static uint32_t _rx_get;
+static uint32_t _rx_put;
+static uint32_t _rx_fill;
+static uint32_t _rx_lost;
+static uint16_t _timestamp;
+
+/* Tx Buffers model: requests in order of TXBAR writes */
+static uint32_t _tx_order[LOG_SIZE];
+static uint32_t _tx_order_count;
+static uint32_t _tx_put;
+static uint32_t _tx_get;
+static uint32_t _tx_free;
+
+static struct _sim_sent _sent[LOG_SIZE];
+static uint32_t _sent_count;
+
+/* callbacks */
+static uint32_t _rx_fill_seen[LOG_SIZE];
+static uint32_t _rx_cb_count;
+static uint32_t _tx_cb_count;
+static uint32_t _tx_cb_frames;
+static uint32_t _buf_cb_count;
+
+/*----------------------------------------------------------------------------
+ *         Simulated MCAN
+ *----------------------------------------------------------------------------*/
+
+static void _reg_set(volatile const uint32_t* reg, uint32_t value)
+{
+	*(volatile uint32_t*)reg = value;
+}
+
+/* Message RAM address of a start address register field */
+static uint32_t* _ram(uint32_t reg, uint32_t mask)
+{
+	return (uint32_t*)(uintptr_t)((test_matrix.CCFG_CAN0 & 0xFFFF0000) |
+				       (reg & mask));
+}
+
+/* words of an element, from a data field size code of RXESC/TXESC */
+static uint32_t _elem_words(uint32_t code)
+{
+	static const uint8_t sizes[] = { 8, 12, 16, 20, 24, 32, 48, 64 };
+
+	return 2 + sizes[code] / 4;
+}
+
+static uint8_t _dlc_length(uint32_t dlc)
+{
+	static const uint8_t lengths[] = {
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64
+	};
+
+	return lengths[dlc];
+}
+
+static uint32_t _rx_size(void)
+{
+	return (MCAN0->MCAN_RXF0C & MCAN_RXF0C_F0S_Msk) >> MCAN_RXF0C_F0S_Pos;
+}
+
+static uint32_t _tx_buffers(void)
+{
+	return (MCAN0->MCAN_TXBC & MCAN_TXBC_NDTB_Msk) >> MCAN_TXBC_NDTB_Pos;
+}
+
+static uint32_t _tx_fifo_size(void)
+{
+	return (MCAN0->MCAN_TXBC & MCAN_TXBC_TFQS_Msk) >> MCAN_TXBC_TFQS_Pos;
+}
+
+static void _sim_status(void)
+{
+	uint32_t rxf0s = (_rx_fill << MCAN_RXF0S_F0FL_Pos) |
+		(_rx_get << MCAN_RXF0S_F0GI_Pos) | (_rx_put << MCAN_RXF0S_F0PI_Pos);
+	uint32_t txfqs = (_tx_free << MCAN_TXFQS_TFFL_Pos) |
+		(_tx_get << MCAN_TXFQS_TFGI_Pos) | (_tx_put << MCAN_TXFQS_TFQPI_Pos);
+
+	if (_rx_fill == _rx_size())
+		rxf0s |= MCAN_RXF0S_F0F;
+	if (_rx_lost)
+		rxf0s |= MCAN_RXF0S_RF0L;
+	if (_tx_free == 0)
+		txfqs |= MCAN_TXFQS_TFQF;
+	_reg_set(&MCAN0->MCAN_RXF0S, rxf0s);
+	_reg_set(&MCAN0->MCAN_TXFQS, txfqs);
+}
+
+static void _sim_reset(void)
+{
+	memset(test_mcan, 0, sizeof(test_mcan));
+	memset(&test_matrix, 0, sizeof(test_matrix));
+	MCAN0->MCAN_RXF0A = NO_ACK;
+	_ir = 0;
+	_rx_get = _rx_put = _rx_fill = _rx_lost = 0;
+	_timestamp = 0;
+	_tx_order_count = 0;
+	_sent_count = 0;
+}
+
+/* the driver is configured: the Tx FIFO follows the dedicated Tx Buffers */
+static void _sim_start(void)
+{
+	_tx_put = _tx_get = _tx_buffers();
+	_tx_free = _tx_fifo_size();
+	_sim_status();
+}
+
+/* apply the acknowledge and transmission request writes of the driver */
+static void _sim_sync(void)
+{
+	uint32_t request = MCAN0->MCAN_TXBAR;
+	uint32_t fifo_start = _tx_buffers();
+	uint32_t fifo_end = fifo_start + _tx_fifo_size();
+	uint32_t i;
+
+	if (MCAN0->MCAN_RXF0A != NO_ACK) {
+		uint32_t index = MCAN0->MCAN_RXF0A & MCAN_RXF0A_F0AI_Msk;
+		uint32_t count = (index + _rx_size() - _rx_get) % _rx_size() + 1;
+
+		TEST_ASSERT(count <= _rx_fill);
+		_rx_fill -= count;
+		_rx_get = (index + 1) % _rx_size();
+		MCAN0->MCAN_RXF0A = NO_ACK;
+	}
+
+	if (request) {
+		/* Tx FIFO buffers are requested from the put index */
+		while (_tx_free && (request & (1u << _tx_put))) {
+			request &= ~(1u << _tx_put);
+			_tx_order[_tx_order_count++] = _tx_put;
+			if (++_tx_put >= fifo_end)
+				_tx_put = fifo_start;
+			_tx_free--;
+		}
+		for (i = 0; i < fifo_start; i++) {
+			if (request & (1u << i)) {
+				request &= ~(1u << i);
+				_tx_order[_tx_order_count++] = i;
+			}
+		}
+		TEST_ASSERT_EQUAL(0, request);
+		TEST_ASSERT(_tx_order_count <= LOG_SIZE);
+		_reg_set(&MCAN0->MCAN_TXBRP, MCAN0->MCAN_TXBRP | MCAN0->MCAN_TXBAR);
+		_reg_set(&MCAN0->MCAN_TXBTO, MCAN0->MCAN_TXBTO & ~MCAN0->MCAN_TXBAR);
+		MCAN0->MCAN_TXBAR = 0;
+	}
+	_sim_status();
+}
+
+/* run the interrupt handler while enabled flags are pending */
+static void _sim_irq(void)
+{
+	_sim_sync();
+	while (_mcan_irq_enabled && !test_irq_disabled &&
+	       (MCAN0->MCAN_ILE & MCAN_ILE_EINT0) &&
+	       (_ir & MCAN0->MCAN_IE)) {
+		/* the handler sees all the flags, it clears them */
+		MCAN0->MCAN_IR = _ir;
+		_ir = 0;
+		_mcan_handler(ID_MCAN0_INT0, _mcan_handler_arg);
+		_sim_sync();
+	}
+}
+
+static bool _std_match(uint32_t id)
+{
+	const uint32_t* filter = _ram(MCAN0->MCAN_SIDFC, MCAN_SIDFC_FLSSA_Msk);
+	uint32_t count = (MCAN0->MCAN_SIDFC & MCAN_SIDFC_LSS_Msk) >> MCAN_SIDFC_LSS_Pos;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		uint32_t s0 = filter[i];
+		uint32_t id1 = (s0 & MCAN_RAM_S0_SFID1_Msk) >> MCAN_RAM_S0_SFID1_Pos;
+		uint32_t id2 = (s0 & MCAN_RAM_S0_SFID2_Msk) >> MCAN_RAM_S0_SFID2_Pos;
+
+		/* classic filters storing into the Rx FIFO 0 only */
+		if ((s0 & MCAN_RAM_S0_SFEC_Msk) == MCAN_RAM_S0_SFEC_FIFO0 &&
+		    (s0 & MCAN_RAM_S0_SFT_Msk) == MCAN_RAM_S0_SFT_CLASSIC &&
+		    (id & id2) == (id1 & id2))
+			return true;
+	}
+	return false;
+}
+
+static bool _ext_match(uint32_t id)
+{
+	const uint32_t* filter = _ram(MCAN0->MCAN_XIDFC, MCAN_XIDFC_FLESA_Msk);
+	uint32_t count = (MCAN0->MCAN_XIDFC & MCAN_XIDFC_LSE_Msk) >> MCAN_XIDFC_LSE_Pos;
+	uint32_t i;
+
+	id &= MCAN0->MCAN_XIDAM;
+	for (i = 0; i < count; i++) {
+		uint32_t f0 = filter[2 * i];
+		uint32_t f1 = filter[2 * i + 1];
+		uint32_t id1 = (f0 & MCAN_RAM_F0_EFID1_Msk) >> MCAN_RAM_F0_EFID1_Pos;
+		uint32_t id2 = (f1 & MCAN_RAM_F1_EFID2_Msk) >> MCAN_RAM_F1_EFID2_Pos;
+
+		if ((f0 & MCAN_RAM_F0_EFEC_Msk) == MCAN_RAM_F0_EFEC_FIFO0 &&
+		    (f1 & MCAN_RAM_F1_EFT_Msk) == MCAN_RAM_F1_EFT_CLASSIC &&
+		    (id & id2) == (id1 & id2))
+			return true;
+	}
+	return false;
+}
+
+/* a frame is received from the bus, non-matching frames are rejected */
+static void _sim_receive(uint32_t id, bool extended, uint8_t len, uint8_t data0)
+{
+	uint32_t words = _elem_words((MCAN0->MCAN_RXESC & MCAN_RXESC_F0DS_Msk) >>
+				     MCAN_RXESC_F0DS_Pos);
+	uint32_t* elem;
+	uint32_t wm = (MCAN0->MCAN_RXF0C & MCAN_RXF0C_F0WM_Msk) >> MCAN_RXF0C_F0WM_Pos;
+	enum mcan_dlc dlc;
+
+	_timestamp += 100;
+	if (!(extended ? _ext_match(id) : _std_match(id)))
+		return;
+
+	/* blocking mode: the new frame is lost */
+	if (_rx_fill == _rx_size()) {
+		_rx_lost = 1;
+		_ir |= MCAN_IR_RF0L;
+		_sim_irq();
+		return;
+	}
+
+	TEST_ASSERT(mcan_get_length_code(len, &dlc));
+	elem = _ram(MCAN0->MCAN_RXF0C, MCAN_RXF0C_F0SA_Msk) + _rx_put * words;
+	elem[0] = extended ? MCAN_RAM_R0_XTD | MCAN_RAM_R0_XTDID(id) :
+		MCAN_RAM_R0_STDID(id);
+	elem[1] = MCAN_RAM_R1_DLC((uint32_t)dlc) | ((uint32_t)_timestamp << MCAN_RAM_R1_RXTS_Pos);
+	memset(&elem[2], 0, (words - 2) * 4);
+	*(uint8_t*)&elem[2] = data0;
+
+	_rx_put = (_rx_put + 1) % _rx_size();
+	_rx_fill++;
+	_ir |= MCAN_IR_RF0N;
+	if (wm && _rx_fill == wm)
+		_ir |= MCAN_IR_RF0W;
+	if (_rx_fill == _rx_size())
+		_ir |= MCAN_IR_RF0F;
+	_sim_irq();
+}
+
+/* send the oldest requested Tx Buffers, one interrupt per frame */
+static void _sim_transmit(uint32_t count)
+{
+	uint32_t words = _elem_words((MCAN0->MCAN_TXESC & MCAN_TXESC_TBDS_Msk) >>
+				     MCAN_TXESC_TBDS_Pos);
+
+	_sim_sync();
+	while (count-- && _tx_order_count) {
+		uint32_t buf = _tx_order[0];
+		const uint32_t* elem = _ram(MCAN0->MCAN_TXBC, MCAN_TXBC_TBSA_Msk) +
+			buf * words;
+		struct _sim_sent* sent = &_sent[_sent_count++];
+
+		TEST_ASSERT(_sent_count <= LOG_SIZE);
+		memmove(_tx_order, _tx_order + 1,
+			--_tx_order_count * sizeof(_tx_order[0]));
+
+		sent->buf = buf;
+		if (elem[0] & MCAN_RAM_T0_XTD)
+			sent->id = (elem[0] & MCAN_RAM_T0_XTDID_Msk) >> MCAN_RAM_T0_XTDID_Pos;
+		else
+			sent->id = (elem[0] & MCAN_RAM_T0_STDID_Msk) >> MCAN_RAM_T0_STDID_Pos;
+		sent->len = _dlc_length((elem[1] & MCAN_RAM_T1_DLC_Msk) >> MCAN_RAM_T1_DLC_Pos);
+		sent->data0 = *(const uint8_t*)&elem[2];
+
+		if (buf >= _tx_buffers()) {
+			TEST_ASSERT_EQUAL(_tx_get, buf);
+			if (++_tx_get >= _tx_buffers() + _tx_fifo_size())
+				_tx_get = _tx_buffers();
+			_tx_free++;
+		}
+		_reg_set(&MCAN0->MCAN_TXBRP, MCAN0->MCAN_TXBRP & ~(1u << buf));
+		_reg_set(&MCAN0->MCAN_TXBTO, MCAN0->MCAN_TXBTO | (1u << buf));
+		if (MCAN0->MCAN_TXBTIE & (1u << buf))
+			_ir |= MCAN_IR_TC;
+		_sim_irq();
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *         Mocks
+ *----------------------------------------------------------------------------*/
+
+uint32_t get_mcan_id_from_addr(const Mcan* addr, uint8_t int_idx)
+{
+	TEST_ASSERT(addr == MCAN0);
+	return int_idx ? ID_MCAN0_INT1 : ID_MCAN0_INT0;
+}
+
+void irq_add_handler(uint32_t source, irq_handler_t handler, void* user_arg)
+{
+	TEST_ASSERT(source == ID_MCAN0_INT0 || source == ID_MCAN0_INT1);
+	_mcan_handler = handler;
+	_mcan_handler_arg = user_arg;
+}
+
+void irq_enable(uint32_t source)
+{
+	_mcan_irq_enabled = true;
+}
+
+void pmc_enable_upll_clock(void)
+{
+}
+
+void pmc_configure_pck(uint32_t index, uint32_t clock_source, uint32_t prescaler)
+{
+	TEST_ASSERT_EQUAL(PMC_PCK_CAN, index);
+}
+
+void pmc_enable_pck(uint32_t index)
+{
+	TEST_ASSERT_EQUAL(PMC_PCK_CAN, index);
+}
+
+void pmc_configure_peripheral(uint32_t id, const struct _pmc_periph_cfg* cfg,
+			      bool enable)
+{
+	TEST_ASSERT_EQUAL(ID_MCAN0_INT0, id);
+}
+
+uint32_t pmc_get_peripheral_clock(uint32_t id)
+{
+	return MCAN_CLOCK;
+}
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static int _rx_cb(void* arg, void* arg2)
+{
+	TEST_ASSERT(_rx_cb_count < LOG_SIZE);
+	_rx_fill_seen[_rx_cb_count++] = (uint32_t)(uintptr_t)arg2;
+	return 0;
+}
+
+static int _tx_cb(void* arg, void* arg2)
+{
+	_tx_cb_count++;
+	_tx_cb_frames += (uint32_t)(uintptr_t)arg2;
+	return 0;
+}
+
+static int _buf_cb(void* arg, void* arg2)
+{
+	_buf_cb_count++;
+	return 0;
+}
+
+static struct _mcan_desc* _setup(void)
+{
+	struct _mcan_desc* desc = mcand_get_desc(MCAN0);
+
+	_sim_reset();
+	/* the rings and the queue are not active after a reset of the board */
+	memset(desc->rx_ring, 0, sizeof(desc->rx_ring));
+	memset(&desc->tx_queue, 0, sizeof(desc->tx_queue));
+	desc->addr = MCAN0;
+	desc->freq = BITRATE;
+	desc->freq_fd = BITRATE_FD;
+	desc->identifier = 0x123;
+	TEST_ASSERT_EQUAL(0, mcand_configure(desc));
+	_sim_start();
+
+	_rx_cb_count = 0;
+	_tx_cb_count = 0;
+	_tx_cb_frames = 0;
+	_buf_cb_count = 0;
+	test_irq_disabled = 0;
+	return desc;
+}
+
+static void _push(struct _mcan_desc* desc, uint32_t id, uint8_t data0, int expected)
+{
+	uint8_t data[8] = { data0 };
+	struct _mcan_frame frame = {
+		.id = id,
+		.len = sizeof(data),
+		.data = data,
+	};
+
+	TEST_ASSERT_EQUAL(expected, mcand_tx_queue_push(desc, &frame));
+	_sim_sync();
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_layout(void)
+{
+	struct _mcan_desc* desc = _setup();
+	struct mcan_set* set = &desc->set;
+	uint32_t* ram0 = set->ram_filt_std;
+	uint32_t* ram1 = set->ram_fifo_rx0;
+
+	/* both Message RAMs are reached with the same MSB */
+	TEST_ASSERT(test_matrix.CCFG_CAN0 != 0);
+	TEST_ASSERT_EQUAL(test_matrix.CCFG_CAN0, (uintptr_t)ram0 & 0xFFFF0000);
+	TEST_ASSERT_EQUAL(test_matrix.CCFG_CAN0, (uintptr_t)ram1 & 0xFFFF0000);
+	TEST_ASSERT_EQUAL(0, (uintptr_t)ram0 >> 32);
+
+	/* the controller sees the regions computed by configure_ram */
+	TEST_ASSERT(_ram(MCAN0->MCAN_SIDFC, MCAN_SIDFC_FLSSA_Msk) == set->ram_filt_std);
+	TEST_ASSERT(_ram(MCAN0->MCAN_XIDFC, MCAN_XIDFC_FLESA_Msk) == set->ram_filt_ext);
+	TEST_ASSERT(_ram(MCAN0->MCAN_RXF0C, MCAN_RXF0C_F0SA_Msk) == set->ram_fifo_rx0);
+	TEST_ASSERT(_ram(MCAN0->MCAN_RXBC, MCAN_RXBC_RBSA_Msk) == set->ram_array_rx);
+	TEST_ASSERT(_ram(MCAN0->MCAN_TXBC, MCAN_TXBC_TBSA_Msk) == set->ram_array_tx);
+	TEST_ASSERT_EQUAL(STD_FILTERS,
+		(MCAN0->MCAN_SIDFC & MCAN_SIDFC_LSS_Msk) >> MCAN_SIDFC_LSS_Pos);
+	TEST_ASSERT_EQUAL(EXT_FILTERS,
+		(MCAN0->MCAN_XIDFC & MCAN_XIDFC_LSE_Msk) >> MCAN_XIDFC_LSE_Pos);
+	TEST_ASSERT_EQUAL(RX_FIFO0_SIZE, _rx_size());
+	TEST_ASSERT_EQUAL(TX_BUFFERS, _tx_buffers());
+	TEST_ASSERT_EQUAL(TX_FIFO_SIZE, _tx_fifo_size());
+
+	/* 64-byte data fields everywhere */
+	TEST_ASSERT_EQUAL(ELEM_WORDS, _elem_words((MCAN0->MCAN_RXESC &
+		MCAN_RXESC_F0DS_Msk) >> MCAN_RXESC_F0DS_Pos));
+	TEST_ASSERT_EQUAL(ELEM_WORDS, _elem_words((MCAN0->MCAN_RXESC &
+		MCAN_RXESC_RBDS_Msk) >> MCAN_RXESC_RBDS_Pos));
+	TEST_ASSERT_EQUAL(ELEM_WORDS, _elem_words((MCAN0->MCAN_TXESC &
+		MCAN_TXESC_TBDS_Msk) >> MCAN_TXESC_TBDS_Pos));
+
+	/* the regions follow each other without overlap: filters, Tx Buffers
+	 * and Tx FIFO in the first RAM, Rx FIFO 0 and Rx Buffers in the second */
+	TEST_ASSERT(set->ram_filt_ext == ram0 + STD_FILTERS);
+	TEST_ASSERT(set->ram_array_tx == set->ram_filt_ext + 2 * EXT_FILTERS);
+	TEST_ASSERT(set->ram_array_rx == ram1 + RX_FIFO0_SIZE * ELEM_WORDS);
+	TEST_ASSERT(ram1 >= set->ram_array_tx +
+		    (TX_BUFFERS + TX_FIFO_SIZE) * ELEM_WORDS ||
+		    ram1 + (RX_FIFO0_SIZE + RX_BUFFERS) * ELEM_WORDS <= ram0);
+}
+
+static void test_rx_ring(void)
+{
+	struct _mcan_desc* desc = _setup();
+	struct _mcan_frame frames[RX_FIFO0_SIZE];
+	struct _mcan_rx_stats stats;
+	struct _callback cb;
+	uint32_t i, count;
+
+	TEST_ASSERT_EQUAL(0, mcand_rx_ring_filter(desc, MCAN_RAM_RX_FIFO0,
+						  0x100, 0x700, false));
+	TEST_ASSERT_EQUAL(0, mcand_rx_ring_filter(desc, MCAN_RAM_RX_FIFO0,
+						  0x1234500, 0x1FFFFF00, true));
+	callback_set(&cb, _rx_cb, NULL);
+	TEST_ASSERT_EQUAL(0, mcand_rx_ring_start(desc, MCAN_RAM_RX_FIFO0, 0, &cb));
+
+	/* rejected by the filters */
+	_sim_receive(0x200, false, 8, 0);
+	_sim_receive(0x1234600, true, 8, 0);
+	TEST_ASSERT_EQUAL(0, _rx_fill);
+	TEST_ASSERT_EQUAL(0, _rx_cb_count);
+
+	_sim_receive(0x101, false, 8, 1);
+	_sim_receive(0x12345AB, true, 4, 2);
+	_sim_receive(0x1FF, false, 0, 3);
+	TEST_ASSERT_EQUAL(3, _rx_cb_count);
+	TEST_ASSERT_EQUAL(1, _rx_fill_seen[0]);
+	TEST_ASSERT_EQUAL(3, _rx_fill_seen[2]);
+
+	/* views on the Message RAM, without acknowledge */
+	TEST_ASSERT_EQUAL(3, mcand_rx_ring_peek(desc, MCAN_RAM_RX_FIFO0,
+						frames, RX_FIFO0_SIZE));
+	TEST_ASSERT_EQUAL(0x101, frames[0].id);
+	TEST_ASSERT_EQUAL(0, frames[0].flags);
+	TEST_ASSERT_EQUAL(8, frames[0].len);
+	TEST_ASSERT_EQUAL(1, frames[0].data[0]);
+	TEST_ASSERT_EQUAL(0x12345AB, frames[1].id);
+	TEST_ASSERT_EQUAL(MCAN_FRAME_EXTENDED, frames[1].flags);
+	TEST_ASSERT_EQUAL(4, frames[1].len);
+	TEST_ASSERT_EQUAL(2, frames[1].data[0]);
+	TEST_ASSERT_EQUAL(0, frames[2].len);
+	TEST_ASSERT(frames[1].timestamp > frames[0].timestamp);
+	TEST_ASSERT(frames[1].data >= (uint8_t*)desc->set.ram_fifo_rx0 &&
+		    frames[1].data < (uint8_t*)desc->set.ram_array_rx);
+	TEST_ASSERT_EQUAL(3, _rx_fill);
+
+	/* a batch of two is released with one acknowledge */
+	mcand_rx_ring_release(desc, MCAN_RAM_RX_FIFO0, 2);
+	_sim_sync();
+	TEST_ASSERT_EQUAL(1, _rx_fill);
+	TEST_ASSERT_EQUAL(1, mcand_rx_ring_peek(desc, MCAN_RAM_RX_FIFO0,
+						frames, RX_FIFO0_SIZE));
+	TEST_ASSERT_EQUAL(3, frames[0].data[0]);
+	mcand_rx_ring_release(desc, MCAN_RAM_RX_FIFO0, 1);
+	_sim_sync();
+
+	/* the FIFO wraps around, the frames keep their order */
+	for (i = 0; i < 2 * RX_FIFO0_SIZE; i++) {
+		_sim_receive(0x100 + (i & 0xFF), false, 8, (uint8_t)(10 + i));
+		if (i % 3 == 2) {
+			count = mcand_rx_ring_peek(desc, MCAN_RAM_RX_FIFO0,
+						   frames, RX_FIFO0_SIZE);
+			TEST_ASSERT_EQUAL(3, count);
+			TEST_ASSERT_EQUAL(10 + i - 2, frames[0].data[0]);
+			TEST_ASSERT_EQUAL(10 + i, frames[2].data[0]);
+			mcand_rx_ring_release(desc, MCAN_RAM_RX_FIFO0, count);
+			_sim_sync();
+		}
+	}
+	TEST_ASSERT_EQUAL(0, _rx_fill);
+
+	mcand_rx_ring_get_stats(desc, MCAN_RAM_RX_FIFO0, &stats);
+	TEST_ASSERT_EQUAL(3 + 2 * RX_FIFO0_SIZE, stats.frames);
+	TEST_ASSERT_EQUAL(0, stats.lost);
+	TEST_ASSERT_EQUAL(0, stats.full);
+	TEST_ASSERT_EQUAL(3, stats.max_fill);
+	mcand_rx_ring_stop(desc, MCAN_RAM_RX_FIFO0);
+}
+
+static void test_rx_overflow(void)
+{
+	struct _mcan_desc* desc = _setup();
+	struct _mcan_frame frames[RX_FIFO0_SIZE];
+	struct _mcan_rx_stats stats;
+	uint32_t i;
+
+	TEST_ASSERT_EQUAL(0, mcand_rx_ring_filter(desc, MCAN_RAM_RX_FIFO0,
+						  0, 0, false));
+	TEST_ASSERT_EQUAL(0, mcand_rx_ring_start(desc, MCAN_RAM_RX_FIFO0, 0, NULL));
+
+	for (i = 0; i < RX_FIFO0_SIZE + 2; i++)
+		_sim_receive(i, false, 8, (uint8_t)i);
+	TEST_ASSERT_EQUAL(RX_FIFO0_SIZE, _rx_fill);
+
+	mcand_rx_ring_get_stats(desc, MCAN_RAM_RX_FIFO0, &stats);
+	TEST_ASSERT_EQUAL(0, stats.frames);
+	TEST_ASSERT_EQUAL(1, stats.full);
+	TEST_ASSERT_EQUAL(2, stats.lost);
+	TEST_ASSERT_EQUAL(RX_FIFO0_SIZE, stats.max_fill);
+
+	/* the oldest frames are kept */
+	TEST_ASSERT_EQUAL(RX_FIFO0_SIZE, mcand_rx_ring_peek(desc,
+			MCAN_RAM_RX_FIFO0, frames, RX_FIFO0_SIZE));
+	TEST_ASSERT_EQUAL(0, frames[0].data[0]);
+	TEST_ASSERT_EQUAL(RX_FIFO0_SIZE - 1, frames[RX_FIFO0_SIZE - 1].data[0]);
+
+	/* releasing more than the fill level releases everything */
+	mcand_rx_ring_release(desc, MCAN_RAM_RX_FIFO0, 100);
+	_sim_sync();
+	TEST_ASSERT_EQUAL(0, _rx_fill);
+	mcand_rx_ring_get_stats(desc, MCAN_RAM_RX_FIFO0, &stats);
+	TEST_ASSERT_EQUAL(RX_FIFO0_SIZE, stats.frames);
+	mcand_rx_ring_stop(desc, MCAN_RAM_RX_FIFO0);
+}
+
+static void test_rx_watermark(void)
+{
+	struct _mcan_desc* desc = _setup();
+	struct _callback cb;
+	uint32_t i;
+
+	TEST_ASSERT_EQUAL(0, mcand_rx_ring_filter(desc, MCAN_RAM_RX_FIFO0,
+						  0, 0, false));
+	callback_set(&cb, _rx_cb, NULL);
+	TEST_ASSERT_EQUAL(-EINVAL, mcand_rx_ring_start(desc, MCAN_RAM_RX_FIFO0,
+						       RX_FIFO0_SIZE, &cb));
+	TEST_ASSERT_EQUAL(0, mcand_rx_ring_start(desc, MCAN_RAM_RX_FIFO0, 4, &cb));
+	TEST_ASSERT_EQUAL(-EBUSY, mcand_rx_ring_start(desc, MCAN_RAM_RX_FIFO0, 4, &cb));
+
+	/* one callback per watermark */
+	for (i = 0; i < 3; i++)
+		_sim_receive(0x10, false, 8, 0);
+	TEST_ASSERT_EQUAL(0, _rx_cb_count);
+	_sim_receive(0x10, false, 8, 0);
+	TEST_ASSERT_EQUAL(1, _rx_cb_count);
+	TEST_ASSERT_EQUAL(4, _rx_fill_seen[0]);
+
+	mcand_rx_ring_release(desc, MCAN_RAM_RX_FIFO0, 4);
+	_sim_sync();
+	for (i = 0; i < 4; i++)
+		_sim_receive(0x10, false, 8, 0);
+	TEST_ASSERT_EQUAL(2, _rx_cb_count);
+
+	/* stopped: the frames stay in the FIFO, no callback */
+	mcand_rx_ring_stop(desc, MCAN_RAM_RX_FIFO0);
+	for (i = 0; i < 4; i++)
+		_sim_receive(0x10, false, 8, 0);
+	TEST_ASSERT_EQUAL(2, _rx_cb_count);
+	TEST_ASSERT_EQUAL(8, _rx_fill);
+}
+
+static void test_tx_queue(void)
+{
+	struct _mcan_desc* desc = _setup();
+	struct _mcan_tx_element elements[9];
+	struct _callback cb;
+	uint32_t i;
+
+	callback_set(&cb, _tx_cb, NULL);
+	TEST_ASSERT_EQUAL(-EINVAL, mcand_tx_queue_start(desc, elements, 1, &cb));
+	TEST_ASSERT_EQUAL(0, mcand_tx_queue_start(desc, elements,
+						  ARRAY_SIZE(elements), &cb));
+
+	/* 4 frames in the Tx FIFO, 8 in the queue, then full */
+	for (i = 0; i < TX_FIFO_SIZE + ARRAY_SIZE(elements) - 1; i++)
+		_push(desc, 0x300 + i, (uint8_t)i, 0);
+	_push(desc, 0x3FF, 0xFF, -ENOSPC);
+	TEST_ASSERT_EQUAL(TX_FIFO_SIZE, _tx_order_count);
+	TEST_ASSERT_EQUAL(0, _tx_free);
+
+	/* each completion refills the Tx FIFO from the queue */
+	_sim_transmit(1);
+	TEST_ASSERT_EQUAL(1, _tx_cb_count);
+	TEST_ASSERT_EQUAL(1, _tx_cb_frames);
+	TEST_ASSERT_EQUAL(TX_FIFO_SIZE, _tx_order_count);
+	_push(desc, 0x300 + 12, 12, 0);
+	_push(desc, 0x3FF, 0xFF, -ENOSPC);
+
+	_sim_transmit(LOG_SIZE);
+	TEST_ASSERT_EQUAL(13, _sent_count);
+	TEST_ASSERT_EQUAL(13, _tx_cb_frames);
+	TEST_ASSERT_EQUAL(TX_FIFO_SIZE, _tx_free);
+	TEST_ASSERT_EQUAL(0, MCAN0->MCAN_TXBTIE);
+	for (i = 0; i < _sent_count; i++) {
+		TEST_ASSERT_EQUAL(0x300 + i, _sent[i].id);
+		TEST_ASSERT_EQUAL(8, _sent[i].len);
+		TEST_ASSERT_EQUAL(i, _sent[i].data0);
+		TEST_ASSERT_EQUAL(TX_BUFFERS + i % TX_FIFO_SIZE, _sent[i].buf);
+	}
+
+	/* the FIFO is given back to mcand_transfer after a stop */
+	_push(desc, 0x400, 0, 0);
+	_push(desc, 0x401, 1, 0);
+	mcand_tx_queue_stop(desc);
+	TEST_ASSERT_EQUAL(-EINVAL, mcand_tx_queue_push(desc, &(struct _mcan_frame){ .len = 0 }));
+	_sim_transmit(LOG_SIZE);
+	TEST_ASSERT_EQUAL(15, _sent_count);
+	TEST_ASSERT_EQUAL(15, _tx_cb_frames);
+}
+
+static void test_tx_queue_batch(void)
+{
+	struct _mcan_desc* desc = _setup();
+	struct _mcan_tx_element elements[8];
+	struct _callback cb;
+	uint32_t i;
+
+	callback_set(&cb, _tx_cb, NULL);
+	TEST_ASSERT_EQUAL(0, mcand_tx_queue_start(desc, elements,
+						  ARRAY_SIZE(elements), &cb));
+	_push(desc, 0x700, 0, 0);
+	_push(desc, 0x701, 1, 0);
+	_sim_transmit(2);
+	TEST_ASSERT_EQUAL(TX_BUFFERS + 2, _tx_put);
+
+	for (i = 2; i < 9; i++)
+		_push(desc, 0x700 + i, (uint8_t)i, 0);
+
+	/* three completions seen by one interrupt: the refill of three frames
+	 * wraps around the end of the Tx FIFO */
+	test_irq_disabled = 1;
+	_sim_transmit(3);
+	TEST_ASSERT_EQUAL(2, _tx_cb_count);
+	test_irq_disabled = 0;
+	_sim_irq();
+	TEST_ASSERT_EQUAL(3, _tx_cb_count);
+	TEST_ASSERT_EQUAL(5, _tx_cb_frames);
+	TEST_ASSERT_EQUAL(0, _tx_free);
+
+	_sim_transmit(LOG_SIZE);
+	TEST_ASSERT_EQUAL(9, _sent_count);
+	for (i = 0; i < _sent_count; i++) {
+		TEST_ASSERT_EQUAL(0x700 + i, _sent[i].id);
+		TEST_ASSERT_EQUAL(i, _sent[i].data0);
+	}
+	mcand_tx_queue_stop(desc);
+}
+
+static void test_tx_buffer_with_queue(void)
+{
+	struct _mcan_desc* desc = _setup();
+	struct _mcan_tx_element elements[8];
+	uint8_t data[8] = { 0xAB };
+	struct _buffer buf = {
+		.data = data,
+		.size = sizeof(data),
+		.attr = CAND_BUF_ATTR_TX,
+	};
+	struct _callback cb, buf_cb;
+	uint32_t i, dedicated;
+
+	callback_set(&cb, _tx_cb, NULL);
+	callback_set(&buf_cb, _buf_cb, NULL);
+	TEST_ASSERT_EQUAL(0, mcand_tx_queue_start(desc, elements,
+						  ARRAY_SIZE(elements), &cb));
+	for (i = 0; i < 6; i++)
+		_push(desc, 0x500 + i, (uint8_t)i, 0);
+
+	/* a dedicated Tx Buffer requested behind the queued frames */
+	TEST_ASSERT_EQUAL(0, mcand_transfer(desc, &buf, &buf_cb));
+	_sim_sync();
+	TEST_ASSERT_EQUAL(0, test_irq_disabled);
+	dedicated = _tx_order[_tx_order_count - 1];
+	TEST_ASSERT(dedicated < TX_BUFFERS);
+
+	/* the completions and refills of the queue leave its interrupt enable
+	 * bit set */
+	for (i = 0; _tx_order[0] != dedicated; i++) {
+		_sim_transmit(1);
+		TEST_ASSERT(MCAN0->MCAN_TXBTIE & (1u << dedicated));
+	}
+	TEST_ASSERT_EQUAL(TX_FIFO_SIZE, i);
+	TEST_ASSERT_EQUAL(TX_FIFO_SIZE, _tx_cb_frames);
+	TEST_ASSERT_EQUAL(0, _buf_cb_count);
+
+	_sim_transmit(1);
+	TEST_ASSERT_EQUAL(1, _buf_cb_count);
+	TEST_ASSERT(buf.attr & CAND_BUF_ATTR_TRANSFER_DONE);
+	TEST_ASSERT_EQUAL(0x123, _sent[TX_FIFO_SIZE].id);
+	TEST_ASSERT_EQUAL(0xAB, _sent[TX_FIFO_SIZE].data0);
+	TEST_ASSERT_EQUAL(0, MCAN0->MCAN_TXBTIE & (1u << dedicated));
+
+	_sim_transmit(LOG_SIZE);
+	TEST_ASSERT_EQUAL(7, _sent_count);
+	TEST_ASSERT_EQUAL(0x505, _sent[6].id);
+	TEST_ASSERT_EQUAL(6, _tx_cb_frames);
+	TEST_ASSERT_EQUAL(1, _buf_cb_count);
+	TEST_ASSERT_EQUAL(0, MCAN0->MCAN_TXBTIE);
+	mcand_tx_queue_stop(desc);
+}
+
+static void test_irq_state(void)
+{
+	struct _mcan_desc* desc = _setup();
+	struct _mcan_tx_element elements[4];
+	uint8_t data[8] = { 0 };
+	struct _buffer buf = {
+		.data = data,
+		.size = sizeof(data),
+		.attr = CAND_BUF_ATTR_TX,
+	};
+
+	TEST_ASSERT_EQUAL(0, mcand_tx_queue_start(desc, elements,
+						  ARRAY_SIZE(elements), NULL));
+
+	/* called with interrupts masked, they stay masked */
+	test_irq_disabled = 1;
+	_push(desc, 0x600, 0, 0);
+	TEST_ASSERT_EQUAL(1, test_irq_disabled);
+	TEST_ASSERT_EQUAL(0, mcand_transfer(desc, &buf, NULL));
+	TEST_ASSERT_EQUAL(1, test_irq_disabled);
+	mcand_tx_queue_stop(desc);
+	TEST_ASSERT_EQUAL(1, test_irq_disabled);
+
+	/* the completions are seen once the interrupts are unmasked */
+	_sim_transmit(2);
+	TEST_ASSERT_EQUAL(2, _sent_count);
+	TEST_ASSERT(MCAN0->MCAN_TXBTIE != 0);
+	test_irq_disabled = 0;
+	_sim_irq();
+	TEST_ASSERT_EQUAL(0, MCAN0->MCAN_TXBTIE);
+	TEST_ASSERT(buf.attr & CAND_BUF_ATTR_TRANSFER_DONE);
+}
+
+int main(void)
+{
+	TEST_RUN(test_layout);
+	TEST_RUN(test_rx_ring);
+	TEST_RUN(test_rx_overflow);
+	TEST_RUN(test_rx_watermark);
+	TEST_RUN(test_tx_queue);
+	TEST_RUN(test_tx_queue_batch);
+	TEST_RUN(test_tx_buffer_with_queue);
+	TEST_RUN(test_irq_state);
+	return 0;
+}
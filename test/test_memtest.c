@@ -0,0 +1,416 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the external RAM test engine: pattern generation, error
+ * reporting, bus tests and complete runs with and without DMA. The DMA
+ * channel is simulated, a transfer completes on its first poll, and can
+ * inject a stuck data bit or an address alias in the tested area.
+ *
+ * The engine handles addresses as 32-bit integers, so the test is linked
+ * as a non position independent executable to keep its buffers in the low
+ * 4GB of the address space.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "chip.h"
+#include "errno.h"
+#include "test.h"
+
+#include "dma/dma.h"
+#include "extram/memtest.h"
+#include "mm/cache.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+/* not a multiple of the block size, to test a partial last block */
+#define AREA_WORDS (10 * 1024 + 8)
+#define STAGE_WORDS 512
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static uint32_t _area[AREA_WORDS] ALIGNED(L1_CACHE_BYTES);
+static uint32_t _stage[STAGE_WORDS] ALIGNED(L1_CACHE_BYTES);
+
+static const enum _memtest_pattern _all_patterns[] = {
+	MEMTEST_WALKING_ONES,
+	MEMTEST_WALKING_ZEROS,
+	MEMTEST_CHECKERBOARD,
+	MEMTEST_ADDRESS,
+	MEMTEST_INV_ADDRESS,
+	MEMTEST_RANDOM,
+};
+
+/* simulated DMA channel */
+static struct _dma_channel _channel;
+static bool _channel_allocated;
+static bool _channel_available;
+static bool _dma_pending;
+static struct _dma_transfer_cfg _dma_xfer;
+static int _dma_transfers;
+
+/* fault injection in the tested area */
+static int _stuck_word = -1;
+static uint32_t _stuck_bits;
+static uint32_t _alias_words;
+
+/*----------------------------------------------------------------------------
+ *         Cache
+ *----------------------------------------------------------------------------*/
+
+void cache_invalidate_region(void* start, uint32_t length)
+{
+}
+
+void cache_clean_region(const void* start, uint32_t length)
+{
+}
+
+/*----------------------------------------------------------------------------
+ *         DMA
+ *----------------------------------------------------------------------------*/
+
+void dma_poll(void)
+{
+}
+
+struct _dma_channel* dma_allocate_channel(uint8_t src, uint8_t dest)
+{
+	TEST_ASSERT_EQUAL(DMA_PERIPH_MEMORY, src);
+	TEST_ASSERT_EQUAL(DMA_PERIPH_MEMORY, dest);
+	if (!_channel_available || _channel_allocated)
+		return NULL;
+	_channel_allocated = true;
+	return &_channel;
+}
+
+int dma_free_channel(struct _dma_channel* channel)
+{
+	TEST_ASSERT(channel == &_channel && _channel_allocated);
+	TEST_ASSERT(!_dma_pending);
+	_channel_allocated = false;
+	return 0;
+}
+
+int dma_configure_transfer(struct _dma_channel* channel,
+			   struct _dma_cfg* cfg_dma,
+			   struct _dma_transfer_cfg* list,
+			   uint8_t list_size)
+{
+	TEST_ASSERT(channel == &_channel && _channel_allocated);
+	/* the engine must wait for a transfer before starting the next one */
+	TEST_ASSERT(!_dma_pending);
+	TEST_ASSERT_EQUAL(DMA_DATA_WIDTH_WORD, cfg_dma->data_width);
+	TEST_ASSERT(cfg_dma->incr_saddr && cfg_dma->incr_daddr);
+	TEST_ASSERT_EQUAL(1, list_size);
+	_dma_xfer = list[0];
+	return 0;
+}
+
+int dma_start_transfer(struct _dma_channel* channel)
+{
+	TEST_ASSERT(!_dma_pending);
+	_dma_pending = true;
+	_dma_transfers++;
+	return 0;
+}
+
+bool dma_is_transfer_done(struct _dma_channel* channel)
+{
+	const uint32_t* src = (const uint32_t*)_dma_xfer.saddr;
+	uint32_t* dst = (uint32_t*)_dma_xfer.daddr;
+	uint32_t i;
+
+	if (!_dma_pending)
+		return true;
+
+	TEST_ASSERT(dst >= _area && dst + _dma_xfer.len <= _area + AREA_WORDS);
+	for (i = 0; i < _dma_xfer.len; i++) {
+		uint32_t word = dst + i - _area;
+
+		_area[word] = src[i];
+		/* a shorted address line also writes the aliased word */
+		if (_alias_words && word >= _alias_words)
+			_area[word - _alias_words] = src[i];
+		if ((int)word == _stuck_word)
+			_area[word] |= _stuck_bits;
+	}
+	_dma_pending = false;
+	return true;
+}
+
+int dma_reset_channel(struct _dma_channel* channel)
+{
+	return 0;
+}
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static void _reset(void)
+{
+	memset(_area, 0, sizeof(_area));
+	_channel_allocated = false;
+	_channel_available = true;
+	_dma_pending = false;
+	_dma_transfers = 0;
+	_stuck_word = -1;
+	_stuck_bits = 0;
+	_alias_words = 0;
+}
+
+static void _init_cfg(struct _memtest_cfg* cfg, bool use_dma)
+{
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->addr = (uint32_t)_area;
+	cfg->size = sizeof(_area);
+	cfg->patterns = _all_patterns;
+	cfg->pattern_count = ARRAY_SIZE(_all_patterns);
+	cfg->seed = 0x12345678;
+	cfg->stage = _stage;
+	cfg->stage_size = sizeof(_stage);
+	cfg->use_dma = use_dma;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_pattern_words(void)
+{
+	TEST_ASSERT_EQUAL(0x00000002, memtest_pattern_word(MEMTEST_WALKING_ONES, 0, 33));
+	TEST_ASSERT_EQUAL(0x7fffffff, memtest_pattern_word(MEMTEST_WALKING_ZEROS, 0, 31));
+	TEST_ASSERT_EQUAL(0x55555555, memtest_pattern_word(MEMTEST_CHECKERBOARD, 0, 4));
+	TEST_ASSERT_EQUAL(0xaaaaaaaa, memtest_pattern_word(MEMTEST_CHECKERBOARD, 0, 5));
+	TEST_ASSERT_EQUAL(1234, memtest_pattern_word(MEMTEST_ADDRESS, 0, 1234));
+	TEST_ASSERT_EQUAL(~1234u, memtest_pattern_word(MEMTEST_INV_ADDRESS, 0, 1234));
+
+	/* the random pattern depends on the seed and differs between words */
+	TEST_ASSERT(memtest_pattern_word(MEMTEST_RANDOM, 1, 10) !=
+		    memtest_pattern_word(MEMTEST_RANDOM, 2, 10));
+	TEST_ASSERT(memtest_pattern_word(MEMTEST_RANDOM, 1, 10) !=
+		    memtest_pattern_word(MEMTEST_RANDOM, 1, 11));
+}
+
+static void test_fill_check(void)
+{
+	uint32_t buf[200];
+	uint32_t i;
+	int p;
+
+	/* memtest_fill must match the word by word definition at any offset,
+	 * and across the block size used by memtest_check */
+	for (p = 0; p < MEMTEST_PATTERN_COUNT; p++) {
+		memtest_fill(p, 7, buf, 1001, ARRAY_SIZE(buf));
+		for (i = 0; i < ARRAY_SIZE(buf); i++)
+			TEST_ASSERT_EQUAL(memtest_pattern_word(p, 7, 1001 + i), buf[i]);
+		TEST_ASSERT_EQUAL(0, memtest_check(p, 7, buf, 1001,
+					ARRAY_SIZE(buf), NULL));
+		/* a wrong offset is detected */
+		TEST_ASSERT(memtest_check(p, 7, buf, 1000,
+					ARRAY_SIZE(buf), NULL) > 0);
+	}
+}
+
+static void test_check_errors(void)
+{
+	struct _memtest_result result;
+	uint32_t buf[200];
+	uint32_t expected;
+
+	memset(&result, 0, sizeof(result));
+	memtest_fill(MEMTEST_RANDOM, 3, buf, 0, ARRAY_SIZE(buf));
+	expected = buf[70];
+	buf[70] ^= 0x100;
+	buf[150] = ~buf[150];
+
+	TEST_ASSERT_EQUAL(2, memtest_check(MEMTEST_RANDOM, 3, buf, 0,
+				ARRAY_SIZE(buf), &result));
+	TEST_ASSERT_EQUAL(2, result.errors);
+	TEST_ASSERT_EQUAL((uint32_t)&buf[70], result.first_addr);
+	TEST_ASSERT_EQUAL(expected, result.expected);
+	TEST_ASSERT_EQUAL(expected ^ 0x100, result.actual);
+
+	/* errors accumulate, the first error is kept */
+	TEST_ASSERT_EQUAL(2, memtest_check(MEMTEST_RANDOM, 3, buf, 0,
+				ARRAY_SIZE(buf), &result));
+	TEST_ASSERT_EQUAL(4, result.errors);
+	TEST_ASSERT_EQUAL((uint32_t)&buf[70], result.first_addr);
+}
+
+static void test_bus(void)
+{
+	_reset();
+	TEST_ASSERT_EQUAL(0, memtest_data_bus((uint32_t)_area));
+	TEST_ASSERT_EQUAL(0, memtest_address_bus((uint32_t)_area, 8192 * 4));
+}
+
+static void test_run_cpu(void)
+{
+	struct _memtest_cfg cfg;
+	struct _memtest_result result;
+	uint32_t i;
+
+	_reset();
+	_init_cfg(&cfg, false);
+	TEST_ASSERT_EQUAL(0, memtest_run(&cfg, &result));
+	TEST_ASSERT_EQUAL(0, result.errors);
+	TEST_ASSERT_EQUAL(0, _dma_transfers);
+
+	/* the area holds the last pattern */
+	for (i = 0; i < AREA_WORDS; i++)
+		TEST_ASSERT_EQUAL(memtest_pattern_word(MEMTEST_RANDOM,
+					cfg.seed, i), _area[i]);
+}
+
+static void test_run_dma(void)
+{
+	struct _memtest_cfg cfg;
+	struct _memtest_result result;
+	uint32_t blocks, i;
+
+	_reset();
+	_init_cfg(&cfg, true);
+	TEST_ASSERT_EQUAL(0, memtest_run(&cfg, &result));
+	TEST_ASSERT_EQUAL(0, result.errors);
+	TEST_ASSERT(!_channel_allocated);
+
+	/* each pattern is written once, in blocks of half the staging area */
+	blocks = (AREA_WORDS + STAGE_WORDS / 2 - 1) / (STAGE_WORDS / 2);
+	TEST_ASSERT_EQUAL(blocks * ARRAY_SIZE(_all_patterns), _dma_transfers);
+	for (i = 0; i < AREA_WORDS; i++)
+		TEST_ASSERT_EQUAL(memtest_pattern_word(MEMTEST_RANDOM,
+					cfg.seed, i), _area[i]);
+}
+
+static void test_stuck_bit(void)
+{
+	struct _memtest_cfg cfg;
+	struct _memtest_result result;
+
+	_reset();
+	_init_cfg(&cfg, true);
+	_stuck_word = 1000;
+	_stuck_bits = 0x00010000;
+	TEST_ASSERT_EQUAL(-EIO, memtest_run(&cfg, &result));
+	TEST_ASSERT(result.errors > 0);
+	TEST_ASSERT_EQUAL((uint32_t)&_area[1000], result.first_addr);
+	TEST_ASSERT_EQUAL(_stuck_bits, result.actual & ~result.expected);
+	TEST_ASSERT(!_channel_allocated);
+}
+
+static void test_address_alias(void)
+{
+	static const enum _memtest_pattern patterns[] = { MEMTEST_ADDRESS };
+	struct _memtest_cfg cfg;
+	struct _memtest_result result;
+
+	/* the upper half of the area overwrites the lower half: only found
+	 * because a pattern is checked once the whole area is written */
+	_reset();
+	_init_cfg(&cfg, true);
+	cfg.patterns = patterns;
+	cfg.pattern_count = ARRAY_SIZE(patterns);
+	_alias_words = 4096;
+	TEST_ASSERT_EQUAL(-EIO, memtest_run(&cfg, &result));
+	TEST_ASSERT_EQUAL((uint32_t)&_area[0], result.first_addr);
+	TEST_ASSERT_EQUAL(0, result.expected);
+	TEST_ASSERT_EQUAL(4096, result.actual);
+}
+
+static void test_invalid(void)
+{
+	static const enum _memtest_pattern bad[] = { MEMTEST_PATTERN_COUNT };
+	struct _memtest_cfg cfg;
+	struct _memtest_result result;
+
+	_reset();
+
+	_init_cfg(&cfg, false);
+	cfg.pattern_count = 0;
+	TEST_ASSERT_EQUAL(-EINVAL, memtest_run(&cfg, &result));
+
+	_init_cfg(&cfg, false);
+	cfg.size = 6;
+	TEST_ASSERT_EQUAL(-EINVAL, memtest_run(&cfg, &result));
+
+	_init_cfg(&cfg, false);
+	cfg.patterns = bad;
+	cfg.pattern_count = ARRAY_SIZE(bad);
+	TEST_ASSERT_EQUAL(-EINVAL, memtest_run(&cfg, &result));
+
+	/* staging area too small for two cache lines, or not aligned */
+	_init_cfg(&cfg, true);
+	cfg.stage_size = L1_CACHE_BYTES;
+	TEST_ASSERT_EQUAL(-EINVAL, memtest_run(&cfg, &result));
+
+	_init_cfg(&cfg, true);
+	cfg.stage = _stage + 1;
+	TEST_ASSERT_EQUAL(-EINVAL, memtest_run(&cfg, &result));
+
+	_init_cfg(&cfg, true);
+	_channel_available = false;
+	TEST_ASSERT_EQUAL(-EBUSY, memtest_run(&cfg, &result));
+	TEST_ASSERT_EQUAL(0, _dma_transfers);
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	/* addresses are truncated to 32 bits by the engine */
+	TEST_ASSERT((uintptr_t)_area == (uint32_t)(uintptr_t)_area);
+
+	TEST_RUN(test_pattern_words);
+	TEST_RUN(test_fill_check);
+	TEST_RUN(test_check_errors);
+	TEST_RUN(test_bus);
+	TEST_RUN(test_run_cpu);
+	TEST_RUN(test_run_dma);
+	TEST_RUN(test_stuck_bit);
+	TEST_RUN(test_address_alias);
+	TEST_RUN(test_invalid);
+	return 0;
+}
@@ -0,0 +1,666 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the pixel conversion library. Conversions between all the
+ * formats are checked pixel by pixel against a reference model of BT.601
+ * limited range, itself checked against the floating point definition.
+ * Scaling and rotations are checked against their geometric properties,
+ * and line padding of the destinations must be left untouched.
+ *
+ * When the host compiler provides arm_neon.h, the NEON kernels are built
+ * too and each kernel must give the same bytes as the C kernel, for all the
+ * line lengths around the 16 pixel blocks. The CPU time of a few VGA
+ * operations is reported for the kernels built.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "compiler.h"
+#include "errno.h"
+#include "test.h"
+
+#include "pixconv.h"
+#include "pixconv_private.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+/* test image, with padded lines */
+#define WIDTH 38
+#define HEIGHT 10
+#define PAD 5
+
+#define GUARD 0xa5
+
+#define BENCH_WIDTH 640
+#define BENCH_HEIGHT 480
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static const enum _pixconv_format _formats[] = {
+	PIXCONV_RGB565,
+	PIXCONV_RGB888,
+	PIXCONV_YUYV,
+	PIXCONV_YUV422P,
+	PIXCONV_YUV420P,
+	PIXCONV_YUV420SP,
+};
+
+static uint8_t _src_buf[3 * (WIDTH + PAD) * (WIDTH + PAD)];
+static uint8_t _dst_buf[3 * (WIDTH + PAD) * (WIDTH + PAD)];
+static uint8_t _tmp_buf[3 * (WIDTH + PAD) * (WIDTH + PAD)];
+
+static uint8_t _bench_src[3 * BENCH_WIDTH * BENCH_HEIGHT];
+static uint8_t _bench_dst[3 * BENCH_WIDTH * BENCH_HEIGHT];
+
+static uint32_t _seed = 1;
+
+/*----------------------------------------------------------------------------
+ *         Reference model
+ *----------------------------------------------------------------------------*/
+
+static uint8_t _rand8(void)
+{
+	_seed = _seed * 1103515245 + 12345;
+	return _seed >> 16;
+}
+
+static void _fill_random(uint8_t* buf, uint32_t size)
+{
+	uint32_t i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = _rand8();
+}
+
+static uint8_t _clamp(int32_t x)
+{
+	return x < 0 ? 0 : (x > 255 ? 255 : x);
+}
+
+/* BT.601 limited range, Q6 coefficients */
+static void _ref_yuv_to_rgb(uint8_t y, uint8_t u, uint8_t v,
+			    uint8_t* r, uint8_t* g, uint8_t* b)
+{
+	int32_t c = ((int32_t)y - 16) * 74;
+	int32_t d = (int32_t)u - 128;
+	int32_t e = (int32_t)v - 128;
+
+	*r = _clamp((c + 102 * e + 32) >> 6);
+	*g = _clamp((c - 25 * d - 52 * e + 32) >> 6);
+	*b = _clamp((c + 129 * d + 32) >> 6);
+}
+
+/* BT.601 limited range, Q8 coefficients */
+static void _ref_rgb_to_yuv(uint8_t r, uint8_t g, uint8_t b,
+			    uint8_t* y, uint8_t* u, uint8_t* v)
+{
+	*y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+	*u = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+	*v = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+static uint16_t _ref_pack565(uint8_t r, uint8_t g, uint8_t b)
+{
+	return ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3);
+}
+
+/* bit replication of the 5 and 6 bit components */
+static void _ref_unpack565(uint16_t p, uint8_t* r, uint8_t* g, uint8_t* b)
+{
+	*r = ((p >> 11) << 3) | (p >> 13);
+	*g = (((p >> 5) & 0x3f) << 2) | ((p >> 9) & 0x3);
+	*b = ((p & 0x1f) << 3) | ((p >> 2) & 0x7);
+}
+
+static bool _is_yuv(enum _pixconv_format format)
+{
+	return format != PIXCONV_RGB565 && format != PIXCONV_RGB888;
+}
+
+static bool _is_420(enum _pixconv_format format)
+{
+	return format == PIXCONV_YUV420P || format == PIXCONV_YUV420SP;
+}
+
+/* Describe an image in a buffer, with pad bytes after each line */
+static void _image(struct _pixconv_image* image, enum _pixconv_format format,
+		   uint32_t width, uint32_t height, uint8_t* buffer)
+{
+	uint32_t cw = width / 2, ch = _is_420(format) ? height / 2 : height;
+
+	memset(image, 0, sizeof(*image));
+	image->format = format;
+	image->width = width;
+	image->height = height;
+	switch (format) {
+	case PIXCONV_RGB565:
+	case PIXCONV_YUYV:
+		image->stride[0] = 2 * width + PAD;
+		break;
+	case PIXCONV_RGB888:
+		image->stride[0] = 3 * width + PAD;
+		break;
+	case PIXCONV_YUV420SP:
+		image->stride[0] = width + PAD;
+		image->stride[1] = 2 * cw + PAD;
+		break;
+	default:
+		image->stride[0] = width + PAD;
+		image->stride[1] = cw + PAD;
+		image->stride[2] = cw + PAD;
+		break;
+	}
+	image->plane[0] = buffer;
+	image->plane[1] = image->plane[0] + height * image->stride[0];
+	if (image->stride[1])
+		image->plane[2] = image->plane[1] + ch * image->stride[1];
+}
+
+static uint8_t* _pixel(const struct _pixconv_image* image, uint8_t plane,
+		       uint32_t x, uint32_t row)
+{
+	return image->plane[plane] + row * image->stride[plane] + x;
+}
+
+static void _get_yuv(const struct _pixconv_image* image, uint32_t x,
+		     uint32_t row, uint8_t* y, uint8_t* u, uint8_t* v)
+{
+	const uint8_t* p;
+
+	switch (image->format) {
+	case PIXCONV_YUYV:
+		p = _pixel(image, 0, 4 * (x / 2), row);
+		*y = p[2 * (x & 1)];
+		*u = p[1];
+		*v = p[3];
+		break;
+	case PIXCONV_YUV422P:
+		*y = *_pixel(image, 0, x, row);
+		*u = *_pixel(image, 1, x / 2, row);
+		*v = *_pixel(image, 2, x / 2, row);
+		break;
+	case PIXCONV_YUV420P:
+		*y = *_pixel(image, 0, x, row);
+		*u = *_pixel(image, 1, x / 2, row / 2);
+		*v = *_pixel(image, 2, x / 2, row / 2);
+		break;
+	case PIXCONV_YUV420SP:
+		*y = *_pixel(image, 0, x, row);
+		p = _pixel(image, 1, 2 * (x / 2), row / 2);
+		*u = p[0];
+		*v = p[1];
+		break;
+	default:
+		TEST_ASSERT(false);
+	}
+}
+
+static void _get_rgb(const struct _pixconv_image* image, uint32_t x,
+		     uint32_t row, uint8_t* r, uint8_t* g, uint8_t* b)
+{
+	const uint8_t* p;
+
+	if (image->format == PIXCONV_RGB565) {
+		p = _pixel(image, 0, 2 * x, row);
+		_ref_unpack565(p[0] | (p[1] << 8), r, g, b);
+	} else {
+		p = _pixel(image, 0, 3 * x, row);
+		*b = p[0];
+		*g = p[1];
+		*r = p[2];
+	}
+}
+
+/* Check that the pad bytes of every line still hold the guard */
+static void _check_pad(const struct _pixconv_image* image)
+{
+	uint32_t row, i, used, height;
+	uint8_t plane;
+
+	for (plane = 0; plane < 3 && image->stride[plane]; plane++) {
+		used = image->stride[plane] - PAD;
+		height = plane && _is_420(image->format) ? image->height / 2
+							 : image->height;
+		for (row = 0; row < height; row++)
+			for (i = used; i < image->stride[plane]; i++)
+				TEST_ASSERT_EQUAL(GUARD, *_pixel(image, plane, i, row));
+	}
+}
+
+/* Expected destination pixel of a conversion, as YUV or RGB */
+static void _check_pixel(const struct _pixconv_image* src,
+			 const struct _pixconv_image* dst,
+			 uint32_t x, uint32_t row)
+{
+	/* destination chroma of 4:2:0 images comes from even rows */
+	uint32_t crow = _is_420(dst->format) ? row & ~1u : row;
+	uint8_t r, g, b, y, u, v, r1, g1, b1, ey, eu, ev;
+
+	if (!_is_yuv(src->format) && !_is_yuv(dst->format)) {
+		_get_rgb(src, x, row, &r, &g, &b);
+		if (dst->format == PIXCONV_RGB565)
+			_ref_unpack565(_ref_pack565(r, g, b), &r, &g, &b);
+		_get_rgb(dst, x, row, &r1, &g1, &b1);
+		TEST_ASSERT(r == r1 && g == g1 && b == b1);
+	} else if (!_is_yuv(dst->format)) {
+		_get_yuv(src, x, row, &y, &u, &v);
+		_ref_yuv_to_rgb(y, u, v, &r, &g, &b);
+		if (dst->format == PIXCONV_RGB565)
+			_ref_unpack565(_ref_pack565(r, g, b), &r, &g, &b);
+		_get_rgb(dst, x, row, &r1, &g1, &b1);
+		TEST_ASSERT(r == r1 && g == g1 && b == b1);
+	} else if (_is_yuv(src->format)) {
+		_get_yuv(src, x, row, &ey, &u, &v);
+		_get_yuv(src, x, crow, &y, &eu, &ev);
+		_get_yuv(dst, x, row, &y, &u, &v);
+		TEST_ASSERT(y == ey && u == eu && v == ev);
+	} else {
+		/* chroma of the average of the pixel pair */
+		_get_rgb(src, x, row, &r, &g, &b);
+		_ref_rgb_to_yuv(r, g, b, &ey, &u, &v);
+		_get_rgb(src, x & ~1u, crow, &r, &g, &b);
+		_get_rgb(src, x | 1u, crow, &r1, &g1, &b1);
+		_ref_rgb_to_yuv((r + r1 + 1) >> 1, (g + g1 + 1) >> 1,
+				(b + b1 + 1) >> 1, &y, &eu, &ev);
+		_get_yuv(dst, x, row, &y, &u, &v);
+		TEST_ASSERT(y == ey && u == eu && v == ev);
+	}
+}
+
+static uint64_t _now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+/* the integer model stays within rounding of the BT.601 definition */
+static void test_reference(void)
+{
+	uint32_t y, u, v, r, g, b;
+	uint8_t r8, g8, b8, y8, u8, v8;
+	double fr, fg, fb;
+
+	for (y = 16; y <= 235; y += 3)
+		for (u = 16; u <= 240; u += 7)
+			for (v = 16; v <= 240; v += 5) {
+				_ref_yuv_to_rgb(y, u, v, &r8, &g8, &b8);
+				fr = 1.164 * (y - 16.0) + 1.596 * (v - 128.0);
+				fg = 1.164 * (y - 16.0) - 0.392 * (u - 128.0) -
+				     0.813 * (v - 128.0);
+				fb = 1.164 * (y - 16.0) + 2.017 * (u - 128.0);
+				TEST_ASSERT(abs(r8 - _clamp(fr + 0.5)) <= 3);
+				TEST_ASSERT(abs(g8 - _clamp(fg + 0.5)) <= 3);
+				TEST_ASSERT(abs(b8 - _clamp(fb + 0.5)) <= 3);
+			}
+
+	for (r = 0; r < 256; r += 5)
+		for (g = 0; g < 256; g += 3)
+			for (b = 0; b < 256; b += 7) {
+				_ref_rgb_to_yuv(r, g, b, &y8, &u8, &v8);
+				fr = 16 + 0.257 * r + 0.504 * g + 0.098 * b;
+				fg = 128 - 0.148 * r - 0.291 * g + 0.439 * b;
+				fb = 128 + 0.439 * r - 0.368 * g - 0.071 * b;
+				TEST_ASSERT(abs(y8 - (int)(fr + 0.5)) <= 1);
+				TEST_ASSERT(abs(u8 - (int)(fg + 0.5)) <= 1);
+				TEST_ASSERT(abs(v8 - (int)(fb + 0.5)) <= 1);
+			}
+}
+
+/* every format pair, pixel by pixel */
+static void test_convert(void)
+{
+	struct _pixconv_image src, dst;
+	uint32_t i, j, x, row;
+
+	for (i = 0; i < ARRAY_SIZE(_formats); i++) {
+		for (j = 0; j < ARRAY_SIZE(_formats); j++) {
+			_fill_random(_src_buf, sizeof(_src_buf));
+			memset(_dst_buf, GUARD, sizeof(_dst_buf));
+			_image(&src, _formats[i], WIDTH, HEIGHT, _src_buf);
+			_image(&dst, _formats[j], WIDTH, HEIGHT, _dst_buf);
+			TEST_ASSERT_EQUAL(0, pixconv_convert(&src, &dst));
+			for (row = 0; row < HEIGHT; row++)
+				for (x = 0; x < WIDTH; x++)
+					_check_pixel(&src, &dst, x, row);
+			_check_pad(&dst);
+		}
+	}
+}
+
+/* same size scaling is a copy, a flat image stays flat, a ramp stays
+ * monotonic */
+static void test_scale(void)
+{
+	static const enum _pixconv_format formats[] = {
+		PIXCONV_RGB888, PIXCONV_YUV422P, PIXCONV_YUV420P, PIXCONV_YUV420SP,
+	};
+	struct _pixconv_image src, dst;
+	uint32_t i, x, row, plane;
+
+	for (i = 0; i < ARRAY_SIZE(formats); i++) {
+		_fill_random(_src_buf, sizeof(_src_buf));
+		memset(_dst_buf, GUARD, sizeof(_dst_buf));
+		_image(&src, formats[i], WIDTH, HEIGHT, _src_buf);
+		_image(&dst, formats[i], WIDTH, HEIGHT, _dst_buf);
+		TEST_ASSERT_EQUAL(0, pixconv_scale(&src, &dst));
+		for (plane = 0; plane < 3 && src.stride[plane]; plane++)
+			for (row = 0; row < (plane && _is_420(formats[i]) ? HEIGHT / 2 : HEIGHT); row++)
+				TEST_ASSERT(memcmp(_pixel(&src, plane, 0, row),
+						   _pixel(&dst, plane, 0, row),
+						   src.stride[plane] - PAD) == 0);
+		_check_pad(&dst);
+	}
+
+	/* flat RGB888, down and up */
+	memset(_src_buf, 0x40, sizeof(_src_buf));
+	_image(&src, PIXCONV_RGB888, WIDTH, HEIGHT, _src_buf);
+	memset(_dst_buf, GUARD, sizeof(_dst_buf));
+	_image(&dst, PIXCONV_RGB888, 13, 7, _dst_buf);
+	TEST_ASSERT_EQUAL(0, pixconv_scale(&src, &dst));
+	for (row = 0; row < 7; row++)
+		for (x = 0; x < 3 * 13; x++)
+			TEST_ASSERT_EQUAL(0x40, *_pixel(&dst, 0, x, row));
+	_check_pad(&dst);
+
+	/* horizontal ramp of the Y plane, upscaled */
+	_image(&src, PIXCONV_YUV420P, WIDTH, HEIGHT, _src_buf);
+	for (row = 0; row < HEIGHT; row++)
+		for (x = 0; x < WIDTH; x++)
+			*_pixel(&src, 0, x, row) = 6 * x;
+	memset(_dst_buf, GUARD, sizeof(_dst_buf));
+	_image(&dst, PIXCONV_YUV420P, WIDTH + 2, HEIGHT + 4, _dst_buf);
+	TEST_ASSERT_EQUAL(0, pixconv_scale(&src, &dst));
+	for (row = 0; row < HEIGHT + 4; row++) {
+		TEST_ASSERT_EQUAL(0, *_pixel(&dst, 0, 0, row));
+		TEST_ASSERT_EQUAL(6 * (WIDTH - 1), *_pixel(&dst, 0, WIDTH + 1, row));
+		for (x = 1; x < WIDTH + 2; x++)
+			TEST_ASSERT(*_pixel(&dst, 0, x, row) >= *_pixel(&dst, 0, x - 1, row));
+	}
+	_check_pad(&dst);
+
+	/* packed formats with chroma or bit fields are not scaled */
+	_image(&src, PIXCONV_RGB565, WIDTH, HEIGHT, _src_buf);
+	_image(&dst, PIXCONV_RGB565, WIDTH, HEIGHT, _dst_buf);
+	TEST_ASSERT_EQUAL(-ENOTSUP, pixconv_scale(&src, &dst));
+	_image(&src, PIXCONV_YUYV, WIDTH, HEIGHT, _src_buf);
+	_image(&dst, PIXCONV_YUYV, WIDTH, HEIGHT, _dst_buf);
+	TEST_ASSERT_EQUAL(-ENOTSUP, pixconv_scale(&src, &dst));
+	_image(&dst, PIXCONV_YUV422P, WIDTH, HEIGHT, _dst_buf);
+	TEST_ASSERT_EQUAL(-EINVAL, pixconv_scale(&src, &dst));
+}
+
+/* pixel mapping of the rotations, and rotations adding up to a turn */
+static void test_rotate(void)
+{
+	static const enum _pixconv_format formats[] = {
+		PIXCONV_RGB565, PIXCONV_RGB888, PIXCONV_YUV420P, PIXCONV_YUV420SP,
+	};
+	struct _pixconv_image src, dst, tmp;
+	uint32_t i, x, row, plane, rows, bytes;
+	uint8_t r, g, b, r1, g1, b1, y, u, v, y1, u1, v1;
+
+	for (i = 0; i < ARRAY_SIZE(formats); i++) {
+		_fill_random(_src_buf, sizeof(_src_buf));
+		memset(_dst_buf, GUARD, sizeof(_dst_buf));
+		memset(_tmp_buf, GUARD, sizeof(_tmp_buf));
+		_image(&src, formats[i], WIDTH, HEIGHT, _src_buf);
+		_image(&dst, formats[i], HEIGHT, WIDTH, _dst_buf);
+		_image(&tmp, formats[i], WIDTH, HEIGHT, _tmp_buf);
+
+		/* source (x, row) goes to (HEIGHT - 1 - row, x) */
+		TEST_ASSERT_EQUAL(0, pixconv_rotate(&src, &dst, PIXCONV_ROTATE_90));
+		for (row = 0; row < HEIGHT; row++)
+			for (x = 0; x < WIDTH; x++) {
+				if (_is_yuv(formats[i])) {
+					_get_yuv(&src, x, row, &y, &u, &v);
+					_get_yuv(&dst, HEIGHT - 1 - row, x, &y1, &u1, &v1);
+					TEST_ASSERT(y == y1 && u == u1 && v == v1);
+				} else {
+					_get_rgb(&src, x, row, &r, &g, &b);
+					_get_rgb(&dst, HEIGHT - 1 - row, x, &r1, &g1, &b1);
+					TEST_ASSERT(r == r1 && g == g1 && b == b1);
+				}
+			}
+		_check_pad(&dst);
+
+		/* 90 then 270 is the source */
+		TEST_ASSERT_EQUAL(0, pixconv_rotate(&dst, &tmp, PIXCONV_ROTATE_270));
+		_check_pad(&tmp);
+		for (plane = 0; plane < 3 && src.stride[plane]; plane++) {
+			rows = plane && _is_420(formats[i]) ? HEIGHT / 2 : HEIGHT;
+			bytes = src.stride[plane] - PAD;
+			for (row = 0; row < rows; row++)
+				TEST_ASSERT(memcmp(_pixel(&src, plane, 0, row),
+						   _pixel(&tmp, plane, 0, row), bytes) == 0);
+		}
+
+		/* 180 twice is the source */
+		_image(&dst, formats[i], WIDTH, HEIGHT, _dst_buf);
+		memset(_tmp_buf, GUARD, sizeof(_tmp_buf));
+		TEST_ASSERT_EQUAL(0, pixconv_rotate(&src, &dst, PIXCONV_ROTATE_180));
+		TEST_ASSERT_EQUAL(0, pixconv_rotate(&dst, &tmp, PIXCONV_ROTATE_180));
+		for (plane = 0; plane < 3 && src.stride[plane]; plane++) {
+			rows = plane && _is_420(formats[i]) ? HEIGHT / 2 : HEIGHT;
+			bytes = src.stride[plane] - PAD;
+			for (row = 0; row < rows; row++)
+				TEST_ASSERT(memcmp(_pixel(&src, plane, 0, row),
+						   _pixel(&tmp, plane, 0, row), bytes) == 0);
+		}
+	}
+
+	/* YUYV 180 keeps the chroma of each pair */
+	_fill_random(_src_buf, sizeof(_src_buf));
+	_image(&src, PIXCONV_YUYV, WIDTH, HEIGHT, _src_buf);
+	_image(&dst, PIXCONV_YUYV, WIDTH, HEIGHT, _dst_buf);
+	TEST_ASSERT_EQUAL(0, pixconv_rotate(&src, &dst, PIXCONV_ROTATE_180));
+	for (row = 0; row < HEIGHT; row++)
+		for (x = 0; x < WIDTH; x++) {
+			_get_yuv(&src, x, row, &y, &u, &v);
+			_get_yuv(&dst, WIDTH - 1 - x, HEIGHT - 1 - row, &y1, &u1, &v1);
+			TEST_ASSERT(y == y1 && u == u1 && v == v1);
+		}
+
+	/* 4:2:2 chroma can not be rotated by a quarter turn */
+	_image(&dst, PIXCONV_YUYV, HEIGHT, WIDTH, _dst_buf);
+	TEST_ASSERT_EQUAL(-ENOTSUP, pixconv_rotate(&src, &dst, PIXCONV_ROTATE_90));
+	_image(&dst, PIXCONV_YUYV, WIDTH, HEIGHT, _dst_buf);
+	TEST_ASSERT_EQUAL(-EINVAL, pixconv_rotate(&src, &dst, PIXCONV_ROTATE_90));
+}
+
+static void test_invalid(void)
+{
+	struct _pixconv_image src, dst;
+
+	_image(&src, PIXCONV_YUYV, WIDTH - 1, HEIGHT, _src_buf);
+	_image(&dst, PIXCONV_RGB888, WIDTH - 1, HEIGHT, _dst_buf);
+	TEST_ASSERT_EQUAL(-EINVAL, pixconv_convert(&src, &dst));
+
+	_image(&src, PIXCONV_RGB888, WIDTH, HEIGHT - 1, _src_buf);
+	_image(&dst, PIXCONV_YUV420SP, WIDTH, HEIGHT - 1, _dst_buf);
+	TEST_ASSERT_EQUAL(-EINVAL, pixconv_convert(&src, &dst));
+
+	_image(&src, PIXCONV_RGB888, WIDTH, HEIGHT, _src_buf);
+	_image(&dst, PIXCONV_RGB565, WIDTH, HEIGHT - 2, _dst_buf);
+	TEST_ASSERT_EQUAL(-EINVAL, pixconv_convert(&src, &dst));
+
+	_image(&dst, PIXCONV_RGB565, WIDTH, HEIGHT, _dst_buf);
+	dst.plane[0] = NULL;
+	TEST_ASSERT_EQUAL(-EINVAL, pixconv_convert(&src, &dst));
+
+	_image(&dst, PIXCONV_RGB565, PIXCONV_MAX_WIDTH + 2, 1, _dst_buf);
+	_image(&src, PIXCONV_RGB888, PIXCONV_MAX_WIDTH + 2, 1, _src_buf);
+	TEST_ASSERT_EQUAL(-EINVAL, pixconv_convert(&src, &dst));
+
+	TEST_ASSERT_EQUAL(0, pixconv_image_init(&dst, (enum _pixconv_format)42,
+						WIDTH, HEIGHT, _dst_buf));
+	TEST_ASSERT_EQUAL(WIDTH * HEIGHT * 3 / 2,
+			  pixconv_image_init(&dst, PIXCONV_YUV420SP, WIDTH, HEIGHT, _dst_buf));
+}
+
+#ifdef CONFIG_HAVE_NEON
+/* NEON kernels give the bytes of the C kernels, for blocks and tails */
+static void test_neon(void)
+{
+	static uint8_t in[4][3 * 64 + 16], out_c[3][3 * 64 + 16], out_n[3][3 * 64 + 16];
+	const struct _pixconv_ops* c = &pixconv_c_ops;
+	const struct _pixconv_ops* n = &pixconv_neon_ops;
+	uint32_t w, i, weight;
+
+#define RUN(call_c, call_n) do { \
+		memset(out_c, GUARD, sizeof(out_c)); \
+		memset(out_n, GUARD, sizeof(out_n)); \
+		call_c; \
+		call_n; \
+		TEST_ASSERT(memcmp(out_c, out_n, sizeof(out_c)) == 0); \
+	} while (0)
+
+	for (i = 0; i < 64; i++) {
+		for (w = 0; w <= 64; w += 2) {
+			/* random lines, then saturated ones */
+			if (i < 62)
+				_fill_random(&in[0][0], sizeof(in));
+			else
+				memset(in, i == 62 ? 0 : 255, sizeof(in));
+			weight = _rand8() + 1;
+
+			RUN(c->unpack_yuyv(in[0], out_c[0], out_c[1], out_c[2], w),
+			    n->unpack_yuyv(in[0], out_n[0], out_n[1], out_n[2], w));
+			RUN(c->pack_yuyv(in[0], in[1], in[2], out_c[0], w),
+			    n->pack_yuyv(in[0], in[1], in[2], out_n[0], w));
+			RUN(c->unpack_uv(in[0], out_c[0], out_c[1], w),
+			    n->unpack_uv(in[0], out_n[0], out_n[1], w));
+			RUN(c->pack_uv(in[0], in[1], out_c[0], w),
+			    n->pack_uv(in[0], in[1], out_n[0], w));
+			RUN(c->yuv_to_rgb565(in[0], in[1], in[2], (uint16_t*)out_c[0], w),
+			    n->yuv_to_rgb565(in[0], in[1], in[2], (uint16_t*)out_n[0], w));
+			RUN(c->yuv_to_rgb888(in[0], in[1], in[2], out_c[0], w),
+			    n->yuv_to_rgb888(in[0], in[1], in[2], out_n[0], w));
+			RUN(c->rgb565_to_yuv((uint16_t*)in[0], out_c[0], out_c[1], out_c[2], w),
+			    n->rgb565_to_yuv((uint16_t*)in[0], out_n[0], out_n[1], out_n[2], w));
+			RUN(c->rgb888_to_yuv(in[0], out_c[0], out_c[1], out_c[2], w),
+			    n->rgb888_to_yuv(in[0], out_n[0], out_n[1], out_n[2], w));
+			RUN(c->rgb565_to_rgb888((uint16_t*)in[0], out_c[0], w),
+			    n->rgb565_to_rgb888((uint16_t*)in[0], out_n[0], w));
+			RUN(c->rgb888_to_rgb565(in[0], (uint16_t*)out_c[0], w),
+			    n->rgb888_to_rgb565(in[0], (uint16_t*)out_n[0], w));
+			RUN(c->blend(in[0], in[1], out_c[0], 3 * w + 1, weight),
+			    n->blend(in[0], in[1], out_n[0], 3 * w + 1, weight));
+		}
+	}
+#undef RUN
+}
+#endif
+
+static void _bench(const char* name, enum _pixconv_format sfmt,
+		   enum _pixconv_format dfmt, uint32_t dw, uint32_t dh,
+		   int op)
+{
+	struct _pixconv_image src, dst;
+	uint64_t start, ns[2];
+	int k, i;
+
+	pixconv_image_init(&src, sfmt, BENCH_WIDTH, BENCH_HEIGHT, _bench_src);
+	pixconv_image_init(&dst, dfmt, dw, dh, _bench_dst);
+	for (k = 0; k < 2; k++) {
+		if (k && !pixconv_use_neon(true))
+			break;
+		if (!k)
+			pixconv_use_neon(false);
+		start = _now_ns();
+		for (i = 0; i < 10; i++) {
+			if (op == 0)
+				TEST_ASSERT_EQUAL(0, pixconv_convert(&src, &dst));
+			else if (op == 1)
+				TEST_ASSERT_EQUAL(0, pixconv_scale(&src, &dst));
+			else
+				TEST_ASSERT_EQUAL(0, pixconv_rotate(&src, &dst, PIXCONV_ROTATE_90));
+		}
+		ns[k] = (_now_ns() - start) / 10;
+	}
+	if (k == 2)
+		printf("    %-26s C %6u us, NEON %6u us\n", name,
+		       (unsigned)(ns[0] / 1000), (unsigned)(ns[1] / 1000));
+	else
+		printf("    %-26s C %6u us\n", name, (unsigned)(ns[0] / 1000));
+}
+
+/* CPU time per VGA frame on the host */
+static void test_benchmark(void)
+{
+	_fill_random(_bench_src, sizeof(_bench_src));
+	_bench("YUYV to RGB565", PIXCONV_YUYV, PIXCONV_RGB565,
+	       BENCH_WIDTH, BENCH_HEIGHT, 0);
+	_bench("RGB888 to YUV420SP", PIXCONV_RGB888, PIXCONV_YUV420SP,
+	       BENCH_WIDTH, BENCH_HEIGHT, 0);
+	_bench("YUV420SP scale to QVGA", PIXCONV_YUV420SP, PIXCONV_YUV420SP,
+	       BENCH_WIDTH / 2, BENCH_HEIGHT / 2, 1);
+	_bench("YUV420P rotate 90", PIXCONV_YUV420P, PIXCONV_YUV420P,
+	       BENCH_HEIGHT, BENCH_WIDTH, 2);
+	pixconv_use_neon(true);
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	TEST_RUN(test_reference);
+	TEST_RUN(test_convert);
+	TEST_RUN(test_scale);
+	TEST_RUN(test_rotate);
+	TEST_RUN(test_invalid);
+#ifdef CONFIG_HAVE_NEON
+	TEST_RUN(test_neon);
+#endif
+	TEST_RUN(test_benchmark);
+	return 0;
+}
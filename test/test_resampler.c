@@ -0,0 +1,536 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the USB audio clock drift handling. The resampler output of
+ * sine inputs is fitted to a sine at the expected frequency and the residue
+ * gives the THD+N, for ratios close to one and for 44.1 to 48 kHz. The rate
+ * estimation is checked in closed loop against a host and a DAC running on
+ * clocks a few hundred ppm apart: with a host following the explicit
+ * feedback, and with a host ignoring it and the resampler absorbing the
+ * drift. The buffer level must stay close to its target and the audio
+ * through the drifting loop must stay clean.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compiler.h"
+#include "errno.h"
+#include "intmath.h"
+#include "test.h"
+
+#include "usb/device/audio/audd_resampler.h"
+#include "usb/device/audio/audd_sync.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define SAMPLE_RATE 48000
+#define FRAME_SAMPLES (SAMPLE_RATE / 1000)
+
+/* output samples skipped before measuring, the filter fills up */
+#define SETTLE AUDD_RESAMPLER_TAPS
+
+#define TONE_SAMPLES 8192
+#define AMPLITUDE 16000.0
+
+/* buffer level target and window of the rate estimation, as in the
+ * usb_audio_speaker example */
+#define SYNC_TARGET (3 * FRAME_SAMPLES)
+#define SYNC_WINDOW_LOG2 5
+
+/* simulated time of the clock drift tests */
+#define DRIFT_FRAMES 120000
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static int16_t _in[2 * TONE_SAMPLES];
+static int16_t _out[2 * TONE_SAMPLES * 2];
+
+/* phase of each measured sample, in cycles */
+static double _phase[2 * TONE_SAMPLES * 2];
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static void _sine(int16_t* buf, uint8_t channels, uint8_t channel,
+		uint32_t count, double freq, double rate)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		buf[i * channels + channel] =
+			(int16_t)lrint(AMPLITUDE * sin(2 * M_PI * freq * i / rate));
+}
+
+static double _det3(const double m[3][3])
+{
+	return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+	     - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+	     + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+/**
+ * THD+N in dB of count samples: the samples are fitted in the least squares
+ * sense to a sine of known phases, in cycles, with any amplitude, phase
+ * offset and DC offset. The residue is the distortion and noise.
+ */
+static double _thd_n_phase(const int16_t* buf, uint8_t channels,
+		uint32_t count, const double* phase)
+{
+	double m[3][3] = { { 0 } }, v[3] = { 0 }, p[3], det;
+	double signal = 0, residue = 0;
+	uint32_t i, j, k;
+
+	/* normal equations for the basis sin, cos and 1 */
+	for (i = 0; i < count; i++) {
+		double b[3] = { sin(2 * M_PI * phase[i]),
+				cos(2 * M_PI * phase[i]), 1 };
+
+		for (j = 0; j < 3; j++) {
+			for (k = 0; k < 3; k++)
+				m[j][k] += b[j] * b[k];
+			v[j] += b[j] * buf[i * channels];
+		}
+	}
+
+	/* Cramer's rule */
+	det = _det3(m);
+	for (j = 0; j < 3; j++) {
+		double mj[3][3];
+
+		memcpy(mj, m, sizeof(mj));
+		for (k = 0; k < 3; k++)
+			mj[k][j] = v[k];
+		p[j] = _det3(mj) / det;
+	}
+
+	for (i = 0; i < count; i++) {
+		double fit = p[0] * sin(2 * M_PI * phase[i])
+		           + p[1] * cos(2 * M_PI * phase[i]);
+		double e = buf[i * channels] - p[2] - fit;
+
+		signal += fit * fit;
+		residue += e * e;
+	}
+	return 10 * log10(signal / residue);
+}
+
+/* THD+N in dB of a sine of a known frequency, in cycles per sample */
+static double _thd_n(const int16_t* buf, uint8_t channels, uint32_t count,
+		double freq)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		_phase[i] = freq * i;
+	return _thd_n_phase(buf, channels, count, _phase);
+}
+
+/* amplitude of the fitted sine, relative to AMPLITUDE, in dB */
+static double _gain_db(const int16_t* buf, uint32_t count)
+{
+	double power = 0;
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+		power += (double)buf[i] * buf[i];
+	return 10 * log10(power / count / (AMPLITUDE * AMPLITUDE / 2));
+}
+
+/* resample a mono tone, return the number of output samples */
+static uint32_t _resample_tone(double freq, uint32_t ratio)
+{
+	struct _audd_resampler resampler;
+	uint32_t used, produced;
+
+	TEST_ASSERT_EQUAL(0, audd_resampler_init(&resampler, 1));
+	audd_resampler_set_ratio(&resampler, ratio);
+	_sine(_in, 1, 0, TONE_SAMPLES, freq, SAMPLE_RATE);
+	produced = audd_resampler_process(&resampler, _in, TONE_SAMPLES,
+			_out, ARRAY_SIZE(_out), &used);
+	TEST_ASSERT_EQUAL(TONE_SAMPLES, used);
+	return produced;
+}
+
+/* samples per 1 ms frame of a clock, from a 16.16 rate */
+static uint32_t _clock_frame(uint32_t* acc, uint32_t rate)
+{
+	uint32_t n;
+
+	*acc += rate;
+	n = *acc >> 16;
+	*acc &= 0xffff;
+	return n;
+}
+
+static uint32_t _rate(double ppm)
+{
+	return (uint32_t)lrint(FRAME_SAMPLES * 65536.0 * (1 + ppm * 1e-6));
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_init(void)
+{
+	struct _audd_resampler resampler;
+
+	TEST_ASSERT_EQUAL(-EINVAL, audd_resampler_init(&resampler, 0));
+	TEST_ASSERT_EQUAL(-EINVAL, audd_resampler_init(&resampler,
+			AUDD_RESAMPLER_MAX_CHANNELS + 1));
+	TEST_ASSERT_EQUAL(0, audd_resampler_init(&resampler, 2));
+	TEST_ASSERT_EQUAL(1 << 16, resampler.ratio);
+}
+
+/* unity DC gain at all fractional positions */
+static void test_dc(void)
+{
+	static const uint32_t ratios[] = { 0x10000, 0x10041, 0xffbf, 0xeb33 };
+	struct _audd_resampler resampler;
+	uint32_t i, r, used, produced;
+
+	for (i = 0; i < 1024; i++)
+		_in[i] = -12345;
+
+	for (r = 0; r < ARRAY_SIZE(ratios); r++) {
+		TEST_ASSERT_EQUAL(0, audd_resampler_init(&resampler, 1));
+		audd_resampler_set_ratio(&resampler, ratios[r]);
+		produced = audd_resampler_process(&resampler, _in, 1024, _out,
+				ARRAY_SIZE(_out), &used);
+		TEST_ASSERT(produced > 900);
+		for (i = SETTLE; i < produced; i++)
+			TEST_ASSERT(abs(_out[i] + 12345) <= 1);
+	}
+}
+
+/* tones through the resampler, the output frequency follows the ratio */
+static void test_thd(void)
+{
+	static const struct {
+		double freq;
+		uint32_t ratio;
+		double min_thd_n;
+	} cases[] = {
+		{ 1000, 0x10000, 90 },
+		{ 1000, 0x10000 + 66, 82 },   /* +1000 ppm */
+		{ 1000, 0x10000 - 66, 82 },   /* -1000 ppm */
+		{ 1000, (44100ULL << 16) / 48000, 82 },
+		{ 10000, 0x10000 + 13, 80 },  /* +200 ppm */
+		{ 18000, 0x10000 - 13, 78 },
+	};
+	uint32_t i;
+
+	for (i = 0; i < ARRAY_SIZE(cases); i++) {
+		uint32_t produced = _resample_tone(cases[i].freq, cases[i].ratio);
+		double freq = cases[i].freq * cases[i].ratio / 65536.0 / SAMPLE_RATE;
+		double thd_n = _thd_n(_out + SETTLE, 1, produced - SETTLE, freq);
+
+		printf("    %5.0f Hz, ratio 0x%05x: THD+N %.1f dB\n",
+		       cases[i].freq, cases[i].ratio, thd_n);
+		TEST_ASSERT(thd_n >= cases[i].min_thd_n);
+	}
+}
+
+/* flat pass band up to 18 kHz, -3 dB at most at 20 kHz, the 32 taps give a
+ * transition band reaching the Nyquist frequency */
+static void test_response(void)
+{
+	static const struct {
+		double freq;
+		double min_db;
+		double max_db;
+	} cases[] = {
+		{ 100, -0.05, 0.05 },
+		{ 1000, -0.05, 0.05 },
+		{ 10000, -0.05, 0.05 },
+		{ 18000, -0.2, 0.1 },
+		{ 20000, -3, 0.1 },
+		{ 23500, -200, -15 },
+	};
+	uint32_t i, produced;
+	double gain;
+
+	for (i = 0; i < ARRAY_SIZE(cases); i++) {
+		produced = _resample_tone(cases[i].freq, 0x10000 + 66);
+		gain = _gain_db(_out + SETTLE, produced - SETTLE);
+		printf("    %5.0f Hz: %+.2f dB\n", cases[i].freq, gain);
+		TEST_ASSERT(gain >= cases[i].min_db && gain <= cases[i].max_db);
+	}
+}
+
+/* the output does not depend on how the input and output are split, and
+ * channels are independent */
+static void test_split(void)
+{
+	static int16_t ref[2 * 2000];
+	struct _audd_resampler resampler;
+	uint32_t used, produced, in_pos = 0, out_pos = 0, i = 0;
+
+	memset(_in, 0, sizeof(_in));
+	_sine(_in, 2, 0, 2000, 440, SAMPLE_RATE);
+	audd_resampler_init(&resampler, 2);
+	audd_resampler_set_ratio(&resampler, 0x10000 + 100);
+	produced = audd_resampler_process(&resampler, _in, 2000, ref, 1900, &used);
+	TEST_ASSERT_EQUAL(1900, produced);
+	TEST_ASSERT(used < 2000);
+
+	audd_resampler_init(&resampler, 2);
+	audd_resampler_set_ratio(&resampler, 0x10000 + 100);
+	while (out_pos < 1900) {
+		uint32_t in_count = 1 + (i * 7) % 61;
+		uint32_t out_count = 1 + (i * 13) % 53;
+
+		if (in_count > 2000 - in_pos)
+			in_count = 2000 - in_pos;
+		if (out_count > 1900 - out_pos)
+			out_count = 1900 - out_pos;
+		produced = audd_resampler_process(&resampler, &_in[2 * in_pos],
+				in_count, &_out[2 * out_pos], out_count, &used);
+		TEST_ASSERT(produced <= out_count);
+		TEST_ASSERT(used <= in_count);
+		TEST_ASSERT(produced == out_count || used == in_count);
+		in_pos += used;
+		out_pos += produced;
+		i++;
+	}
+	TEST_ASSERT(memcmp(ref, _out, sizeof(ref[0]) * 2 * 1900) == 0);
+
+	/* the right channel is silent */
+	for (i = 0; i < 1900; i++)
+		TEST_ASSERT_EQUAL(0, _out[2 * i + 1]);
+}
+
+/* ratio changes on every 1 ms frame do not add distortion */
+static void test_ratio_changes(void)
+{
+	struct _audd_resampler resampler;
+	uint32_t used, produced, in_pos = 0, out_pos = 0, i = 0;
+	double thd_n, freq = 1000.0 / SAMPLE_RATE;
+
+	_sine(_in, 1, 0, TONE_SAMPLES, 1000, SAMPLE_RATE);
+	audd_resampler_init(&resampler, 1);
+
+	/* the ratio wanders by +/- 2 ppm around 1 + 100 ppm */
+	while (in_pos < TONE_SAMPLES && out_pos + FRAME_SAMPLES <= TONE_SAMPLES) {
+		audd_resampler_set_ratio(&resampler, 0x10000 + 6 + (i & 1));
+		produced = audd_resampler_process(&resampler, &_in[in_pos],
+				TONE_SAMPLES - in_pos, &_out[out_pos],
+				FRAME_SAMPLES, &used);
+		in_pos += used;
+		out_pos += produced;
+		i++;
+	}
+	thd_n = _thd_n(_out + SETTLE, 1, out_pos - SETTLE,
+			freq * (0x10000 + 6.5) / 0x10000);
+	printf("    1000 Hz, ratio changes: THD+N %.1f dB\n", thd_n);
+	TEST_ASSERT(thd_n >= 80);
+}
+
+/* rates and feedback formats at nominal rate */
+static void test_sync_nominal(void)
+{
+	struct _audd_sync sync;
+	uint8_t fb[4];
+
+	audd_sync_init(&sync, SAMPLE_RATE, SYNC_TARGET, SYNC_WINDOW_LOG2);
+	TEST_ASSERT_EQUAL(48 << 16, sync.nominal);
+	TEST_ASSERT_EQUAL(48 << 16, audd_sync_get_rate(&sync, SYNC_TARGET));
+	TEST_ASSERT_EQUAL(1 << 16, audd_sync_get_ratio(&sync, SYNC_TARGET));
+
+	/* 10.14 per frame at full speed */
+	TEST_ASSERT_EQUAL(3, audd_sync_get_feedback(&sync, SYNC_TARGET, false, fb));
+	TEST_ASSERT_EQUAL(0x00, fb[0]);
+	TEST_ASSERT_EQUAL(0x00, fb[1]);
+	TEST_ASSERT_EQUAL(0x0c, fb[2]);
+
+	/* 16.16 per microframe at high speed */
+	TEST_ASSERT_EQUAL(4, audd_sync_get_feedback(&sync, SYNC_TARGET, true, fb));
+	TEST_ASSERT_EQUAL(0x00, fb[0]);
+	TEST_ASSERT_EQUAL(0x00, fb[1]);
+	TEST_ASSERT_EQUAL(0x06, fb[2]);
+	TEST_ASSERT_EQUAL(0x00, fb[3]);
+
+	/* a full buffer asks for less, within the maximum deviation */
+	TEST_ASSERT(audd_sync_get_rate(&sync, SYNC_TARGET + 10) < (48 << 16));
+	TEST_ASSERT(audd_sync_get_rate(&sync, SYNC_TARGET - 10) > (48 << 16));
+	TEST_ASSERT_EQUAL((48 << 16) - (48 << 16) / AUDD_SYNC_MAX_DEVIATION,
+			  audd_sync_get_rate(&sync, 100000));
+}
+
+/* the host follows the 10.14 full speed feedback, read every window, the
+ * DAC is slow by 300 ppm. The level correction makes the feedback dither
+ * around the DAC rate, its mean must match the DAC rate. */
+static void test_sync_feedback(void)
+{
+	struct _audd_sync sync;
+	uint32_t host_acc = 0, dac_acc = 0, host_rate = _rate(0);
+	uint32_t dac_rate = _rate(-300);
+	int32_t level = SYNC_TARGET, min = level, max = level;
+	uint64_t rate_sum = 0;
+	uint32_t frame;
+	double mean;
+	uint8_t fb[4];
+
+	audd_sync_init(&sync, SAMPLE_RATE, SYNC_TARGET, SYNC_WINDOW_LOG2);
+
+	for (frame = 0; frame < DRIFT_FRAMES; frame++) {
+		uint32_t received = _clock_frame(&host_acc, host_rate);
+		uint32_t consumed = _clock_frame(&dac_acc, dac_rate);
+
+		level += received;
+		audd_sync_frame(&sync, received);
+		level -= consumed;
+		audd_sync_consumed(&sync, consumed);
+		TEST_ASSERT(level > 0);
+
+		if ((frame & ((1 << SYNC_WINDOW_LOG2) - 1)) == 0) {
+			audd_sync_get_feedback(&sync, level, false, fb);
+			host_rate = ((fb[2] << 16) | (fb[1] << 8) | fb[0]) << 2;
+		}
+		if (frame >= DRIFT_FRAMES / 2) {
+			rate_sum += host_rate;
+			if (level < min)
+				min = level;
+			if (level > max)
+				max = level;
+		}
+	}
+
+	mean = (double)rate_sum / (DRIFT_FRAMES / 2);
+	printf("    feedback: level %d..%d, rate %+.1f ppm\n", min, max,
+	       (mean / _rate(0) - 1) * 1e6);
+	TEST_ASSERT(min >= SYNC_TARGET - FRAME_SAMPLES);
+	TEST_ASSERT(max <= SYNC_TARGET + FRAME_SAMPLES);
+	TEST_ASSERT(fabs(mean / dac_rate - 1) < 5e-6);
+}
+
+/* the host ignores the feedback and is fast by 200 ppm, the resampler
+ * absorbs the drift and the tone through the loop stays clean. The ratio
+ * follows the level and dithers by tens of ppm: the output is compared to
+ * the tone at the input positions the ratios lead to. */
+static void test_sync_resample(void)
+{
+	static int16_t played[TONE_SAMPLES];
+	static int16_t fifo[4096];
+	struct _audd_resampler resampler;
+	struct _audd_sync sync;
+	uint32_t host_acc = 0, host_rate = _rate(200);
+	uint32_t head = 0, level = SYNC_TARGET, min = level, max = level, i;
+	uint32_t tone_pos = 0, played_count = 0, frame, ratio = 0;
+	double thd_n, position = 0;
+
+	audd_sync_init(&sync, SAMPLE_RATE, SYNC_TARGET, SYNC_WINDOW_LOG2);
+	audd_resampler_init(&resampler, 1);
+	memset(fifo, 0, sizeof(fifo));
+
+	for (frame = 0; frame < DRIFT_FRAMES; frame++) {
+		uint32_t received = _clock_frame(&host_acc, host_rate);
+		uint32_t produced = 0;
+
+		/* the host sends a 1 kHz tone at its own rate */
+		for (i = 0; i < received; i++, tone_pos++)
+			fifo[(head + level + i) % ARRAY_SIZE(fifo)] = (int16_t)
+				lrint(AMPLITUDE * sin(2 * M_PI * 1000.0 *
+						      tone_pos / SAMPLE_RATE));
+		level += received;
+		audd_sync_frame(&sync, received);
+
+		/* the DAC plays FRAME_SAMPLES per frame at the nominal rate */
+		ratio = audd_sync_get_ratio(&sync, level);
+		audd_resampler_set_ratio(&resampler, ratio);
+		while (produced < FRAME_SAMPLES) {
+			int16_t out[FRAME_SAMPLES];
+			uint32_t used, n, count;
+
+			count = min_u32(level, ARRAY_SIZE(fifo) - head);
+			TEST_ASSERT(count > 0);
+			n = audd_resampler_process(&resampler, &fifo[head],
+					count, out, FRAME_SAMPLES - produced,
+					&used);
+			head = (head + used) % ARRAY_SIZE(fifo);
+			level -= used;
+			if (frame >= DRIFT_FRAMES - TONE_SAMPLES / FRAME_SAMPLES) {
+				for (i = 0; i < n && played_count < ARRAY_SIZE(played);
+				     i++, played_count++) {
+					played[played_count] = out[i];
+					_phase[played_count] = position * 1000.0 / SAMPLE_RATE;
+					position += ratio / 65536.0;
+				}
+			}
+			produced += n;
+		}
+		audd_sync_consumed(&sync, FRAME_SAMPLES);
+
+		if (frame >= DRIFT_FRAMES / 2) {
+			if (level < min)
+				min = level;
+			if (level > max)
+				max = level;
+		}
+	}
+
+	thd_n = _thd_n_phase(played, 1, played_count, _phase);
+	printf("    resampling: level %u..%u, ratio %+.1f ppm, THD+N %.1f dB\n",
+	       min, max, (ratio / 65536.0 - 1) * 1e6, thd_n);
+	TEST_ASSERT(min >= SYNC_TARGET - FRAME_SAMPLES);
+	TEST_ASSERT(max <= SYNC_TARGET + FRAME_SAMPLES);
+	TEST_ASSERT(fabs(ratio / 65536.0 - 1 - 200e-6) < 40e-6);
+	TEST_ASSERT(thd_n >= 80);
+}
+
+int main(void)
+{
+	TEST_RUN(test_init);
+	TEST_RUN(test_dc);
+	TEST_RUN(test_thd);
+	TEST_RUN(test_response);
+	TEST_RUN(test_split);
+	TEST_RUN(test_ratio_changes);
+	TEST_RUN(test_sync_nominal);
+	TEST_RUN(test_sync_feedback);
+	TEST_RUN(test_sync_resample);
+	return 0;
+}
@@ -0,0 +1,467 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the image sensor register loader. The TWI bus is replaced
+ * by a model of the sensor register file which records the register writes
+ * and the delays, in order. Every register table of every sensor profile is
+ * loaded, and the recorded stream shall match the table. The bus transfers
+ * are checked on the way: START/STOP framing, batch and burst limits, and
+ * auto-increment bursts only for the sensors that support them.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "compiler.h"
+#include "errno.h"
+#include "test.h"
+
+#include "peripherals/bus.h"
+#include "timer.h"
+#include "trace.h"
+#include "video/image_sensor_inf.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define TEST_BUS 1
+
+/* limits of image_sensor_inf.c */
+#define BATCH_SIZE 16
+#define BURST_SIZE 32
+
+#define MAX_EVENTS 8192
+
+/*----------------------------------------------------------------------------
+ *         Local types
+ *----------------------------------------------------------------------------*/
+
+/** Register write, or delay, seen by the sensor */
+struct _event {
+	bool delay;
+	uint16_t reg;
+	uint8_t data[2];
+	uint32_t ms;
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+static const struct sensor_profile* const _profiles[] = {
+	&mt9v022_profile,
+	&ov2640_profile,
+	&ov2643_profile,
+	&ov5640_profile,
+	&ov7670_profile,
+	&ov7740_profile,
+	&ov9740_profile,
+};
+
+/* sensor model */
+static const struct sensor_profile* _sensor;
+static uint8_t _regs[65536][2];
+
+static struct _event _events[MAX_EVENTS];
+static int _event_count;
+
+/* bus state */
+static bool _in_transaction;
+static bool _transfer_pending;
+static bool _last_batch_partial;
+static uint32_t _transfers;
+static uint32_t _writes;
+static int _fail_transfer;
+
+/*----------------------------------------------------------------------------
+ *         Sensor bus model
+ *----------------------------------------------------------------------------*/
+
+static void _sizes(const struct sensor_profile* sensor, uint8_t* addr_size,
+		   uint8_t* data_size)
+{
+	*addr_size = sensor->twi_inf_mode == SENSOR_TWI_REG_2BYTE_DATA_BYTE ? 2 : 1;
+	*data_size = sensor->twi_inf_mode == SENSOR_TWI_REG_BYTE_DATA_2BYTE ? 2 : 1;
+}
+
+static uint16_t _buf_reg(const struct _buffer* buf, uint8_t addr_size)
+{
+	return addr_size == 2 ? (buf->data[0] << 8) | buf->data[1] : buf->data[0];
+}
+
+static void _add_event(const struct _event* event)
+{
+	TEST_ASSERT(_event_count < MAX_EVENTS);
+	_events[_event_count++] = *event;
+}
+
+static int _read(struct _buffer* buf, uint16_t buffers, uint8_t addr_size,
+		 uint8_t data_size)
+{
+	uint16_t reg;
+
+	TEST_ASSERT_EQUAL(2, buffers);
+	TEST_ASSERT_EQUAL(BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_TX | BUS_I2C_BUF_ATTR_STOP,
+			  buf[0].attr);
+	TEST_ASSERT_EQUAL(addr_size, buf[0].size);
+	TEST_ASSERT_EQUAL(BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_RX | BUS_I2C_BUF_ATTR_STOP,
+			  buf[1].attr);
+	TEST_ASSERT_EQUAL(data_size, buf[1].size);
+
+	reg = _buf_reg(&buf[0], addr_size);
+	memcpy(buf[1].data, _regs[reg], data_size);
+
+	/* reads are not part of a register list, the next write starts one */
+	_last_batch_partial = false;
+	return 0;
+}
+
+static int _write(struct _buffer* buf, uint16_t buffers, uint8_t addr_size,
+		  uint8_t data_size)
+{
+	const bool auto_inc = (_sensor->twi_flags & SENSOR_TWI_AUTO_INC) != 0;
+	struct _event event = { .delay = false };
+	uint16_t i, reg = 0, prev_reg = 0;
+	uint32_t j, prev_size = 0;
+
+	/* a batch is only cut short by a delay or by the end of the table */
+	TEST_ASSERT(!_last_batch_partial);
+	TEST_ASSERT(buffers % 2 == 0);
+	TEST_ASSERT(buffers > 0 && buffers <= 2 * BATCH_SIZE);
+
+	for (i = 0; i < buffers; i += 2) {
+		TEST_ASSERT_EQUAL(BUS_I2C_BUF_ATTR_START | BUS_BUF_ATTR_TX, buf[i].attr);
+		TEST_ASSERT_EQUAL(addr_size, buf[i].size);
+		TEST_ASSERT_EQUAL(BUS_BUF_ATTR_TX | BUS_I2C_BUF_ATTR_STOP, buf[i + 1].attr);
+		TEST_ASSERT(buf[i + 1].size > 0 && buf[i + 1].size % data_size == 0);
+		TEST_ASSERT(buf[i + 1].size <= (auto_inc ? BURST_SIZE : data_size));
+
+		reg = _buf_reg(&buf[i], addr_size);
+
+		/* writes to consecutive registers are merged when possible */
+		if (auto_inc && i > 0)
+			TEST_ASSERT(reg != (uint16_t)(prev_reg + prev_size / data_size) ||
+				    prev_size + data_size > BURST_SIZE);
+		prev_reg = reg;
+		prev_size = buf[i + 1].size;
+
+		for (j = 0; j < buf[i + 1].size; j += data_size) {
+			event.reg = reg + j / data_size;
+			memcpy(event.data, &buf[i + 1].data[j], data_size);
+			memcpy(_regs[event.reg], event.data, data_size);
+			_add_event(&event);
+		}
+		_writes++;
+	}
+	_last_batch_partial = buffers < 2 * BATCH_SIZE;
+	return 0;
+}
+
+int bus_start_transaction(uint8_t bus_id)
+{
+	TEST_ASSERT_EQUAL(TEST_BUS, bus_id);
+	TEST_ASSERT(!_in_transaction);
+	_in_transaction = true;
+	return 0;
+}
+
+int bus_stop_transaction(uint8_t bus_id)
+{
+	TEST_ASSERT_EQUAL(TEST_BUS, bus_id);
+	TEST_ASSERT(_in_transaction);
+	TEST_ASSERT(!_transfer_pending);
+	_in_transaction = false;
+	return 0;
+}
+
+int bus_transfer(uint8_t bus_id, uint16_t remote, struct _buffer* buf,
+		 uint16_t buffers, struct _callback* cb)
+{
+	uint8_t addr_size, data_size;
+
+	TEST_ASSERT_EQUAL(TEST_BUS, bus_id);
+	TEST_ASSERT(_in_transaction);
+	TEST_ASSERT(!_transfer_pending);
+	TEST_ASSERT(cb == NULL);
+
+	if (remote != _sensor->addr)
+		return -ENODEV;
+	if (_fail_transfer && --_fail_transfer == 0)
+		return -EIO;
+
+	_sizes(_sensor, &addr_size, &data_size);
+	if (buf[buffers - 1].attr & BUS_BUF_ATTR_RX)
+		return _read(buf, buffers, addr_size, data_size);
+
+	_transfers++;
+	_transfer_pending = true;
+	return _write(buf, buffers, addr_size, data_size);
+}
+
+int bus_wait_transfer(uint8_t bus_id)
+{
+	TEST_ASSERT_EQUAL(TEST_BUS, bus_id);
+	_transfer_pending = false;
+	return 0;
+}
+
+void msleep(uint32_t count)
+{
+	struct _event event = { .delay = true, .ms = count };
+
+	TEST_ASSERT(!_in_transaction);
+	_last_batch_partial = false;
+	_add_event(&event);
+}
+
+/*----------------------------------------------------------------------------
+ *         Helpers
+ *----------------------------------------------------------------------------*/
+
+static void _reset(const struct sensor_profile* sensor)
+{
+	_sensor = sensor;
+	memset(_regs, 0, sizeof(_regs));
+	_event_count = 0;
+	_transfers = 0;
+	_writes = 0;
+	_fail_transfer = 0;
+	_last_batch_partial = false;
+}
+
+static void _set_pid(const struct sensor_profile* sensor)
+{
+	_regs[sensor->pid_high_reg][0] = (uint8_t)sensor->pid_high;
+	_regs[sensor->pid_low_reg][0] = (uint8_t)sensor->pid_low;
+}
+
+/* Check the recorded stream against a register table, return the number
+ * of entries of the table */
+static int _check_stream(const struct sensor_profile* sensor,
+			 const struct sensor_reg* table)
+{
+	uint8_t addr_size, data_size;
+	int n;
+
+	_sizes(sensor, &addr_size, &data_size);
+	for (n = 0; !(table[n].reg == SENSOR_REG_TERM &&
+		      table[n].val == SENSOR_VAL_TERM); n++) {
+		TEST_ASSERT(n < _event_count);
+		if (table[n].reg == SENSOR_REG_DELAY) {
+			TEST_ASSERT(_events[n].delay);
+			TEST_ASSERT_EQUAL(table[n].val, _events[n].ms);
+			continue;
+		}
+		TEST_ASSERT(!_events[n].delay);
+		TEST_ASSERT_EQUAL(table[n].reg, _events[n].reg);
+		TEST_ASSERT(memcmp(&table[n].val, _events[n].data, data_size) == 0);
+	}
+	TEST_ASSERT_EQUAL(n, _event_count);
+	TEST_ASSERT(!_in_transaction);
+	return n;
+}
+
+/* Copy of a profile with a single output, so that each table is selected by
+ * sensor_setup() even when another output has the same resolution and
+ * format */
+static void _single_output(struct sensor_profile* copy,
+			   const struct sensor_profile* sensor,
+			   const struct sensor_output* output)
+{
+	*copy = *sensor;
+	memset(copy->output_conf, 0, sizeof(copy->output_conf));
+	copy->output_conf[0] = output;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+/* every table is written as listed, with fewer bus transfers */
+static void test_tables(void)
+{
+	struct sensor_profile copy;
+	const struct sensor_output* output;
+	uint32_t tables, entries, transfers;
+	int p, i;
+
+	for (p = 0; p < (int)ARRAY_SIZE(_profiles); p++) {
+		tables = entries = transfers = 0;
+		for (i = 0; i < SENSOR_SUPPORTED_OUTPUTS; i++) {
+			output = _profiles[p]->output_conf[i];
+			if (!output || !output->supported)
+				continue;
+			_single_output(&copy, _profiles[p], output);
+			_reset(&copy);
+			TEST_ASSERT_EQUAL(SENSOR_OK, sensor_setup(TEST_BUS, &copy,
+				output->output_resolution, output->output_format));
+			entries += _check_stream(&copy, output->output_setting);
+			transfers += _transfers;
+			tables++;
+		}
+		TEST_ASSERT(tables > 0);
+		TEST_ASSERT(transfers < entries);
+		printf("    %-8s %u tables, %4u entries, %3u transfers\n",
+		       _profiles[p]->name, tables, entries, transfers);
+	}
+}
+
+/* the manual exposure tables, and exposure settings written with one burst
+ * on sensors with auto-increment */
+static void test_exposure(void)
+{
+	struct sensor_profile* sensor;
+	uint32_t exposure;
+	uint16_t gain;
+	int p;
+
+	for (p = 0; p < (int)ARRAY_SIZE(_profiles); p++) {
+		sensor = (struct sensor_profile*)_profiles[p];
+		_reset(sensor);
+		if (!sensor->exposure) {
+			TEST_ASSERT_EQUAL(SENSOR_NOT_SUPPORTED,
+					  sensor_set_manual_exposure(TEST_BUS, sensor));
+			continue;
+		}
+		TEST_ASSERT_EQUAL(SENSOR_OK, sensor_set_manual_exposure(TEST_BUS, sensor));
+		_check_stream(sensor, sensor->exposure->manual);
+
+		_reset(sensor);
+		TEST_ASSERT_EQUAL(SENSOR_OK, sensor_set_exposure(TEST_BUS, sensor,
+			sensor->exposure->exposure_min + 100,
+			sensor->exposure->gain_min + 3));
+		if (sensor->twi_flags & SENSOR_TWI_AUTO_INC)
+			TEST_ASSERT(_transfers == 1);
+		TEST_ASSERT_EQUAL(SENSOR_OK, sensor_get_exposure(TEST_BUS, sensor,
+								 &exposure, &gain));
+		TEST_ASSERT_EQUAL(sensor->exposure->exposure_min + 100, exposure);
+		TEST_ASSERT_EQUAL(sensor->exposure->gain_min + 3, gain);
+
+		/* out of range values are clamped */
+		TEST_ASSERT_EQUAL(SENSOR_OK, sensor_set_exposure(TEST_BUS, sensor,
+								 0xffffffff, 0));
+		TEST_ASSERT_EQUAL(SENSOR_OK, sensor_get_exposure(TEST_BUS, sensor,
+								 &exposure, &gain));
+		TEST_ASSERT_EQUAL(sensor->exposure->exposure_max, exposure);
+		TEST_ASSERT_EQUAL(sensor->exposure->gain_min, gain);
+	}
+}
+
+/* registers are read back after a setup, a changed one is reported */
+static void test_verify(void)
+{
+	struct sensor_profile* sensor = (struct sensor_profile*)&ov2640_profile;
+	const struct sensor_output* output = sensor->output_conf[0];
+	const struct sensor_reg* last = output->output_setting;
+
+	_reset(sensor);
+	TEST_ASSERT_EQUAL(SENSOR_OK, sensor_setup(TEST_BUS, sensor,
+		output->output_resolution, output->output_format));
+	TEST_ASSERT_EQUAL(SENSOR_OK, sensor_verify(TEST_BUS, sensor,
+		output->output_resolution, output->output_format));
+
+	/* the last entry is checked */
+	while (!(last[1].reg == SENSOR_REG_TERM && last[1].val == SENSOR_VAL_TERM))
+		last++;
+	_regs[last->reg][0] ^= 0x01;
+	TEST_ASSERT_EQUAL(SENSOR_VERIFY_ERROR, sensor_verify(TEST_BUS, sensor,
+		output->output_resolution, output->output_format));
+	TEST_ASSERT(!_in_transaction);
+}
+
+/* a bus error aborts the table and releases the bus */
+static void test_bus_error(void)
+{
+	struct sensor_profile* sensor = (struct sensor_profile*)&ov5640_profile;
+	const struct sensor_output* output = sensor->output_conf[0];
+
+	_reset(sensor);
+	_fail_transfer = 2;
+	TEST_ASSERT_EQUAL(SENSOR_TWI_ERROR, sensor_setup(TEST_BUS, sensor,
+		output->output_resolution, output->output_format));
+	TEST_ASSERT_EQUAL(1, _transfers);
+	TEST_ASSERT(!_in_transaction);
+}
+
+/* outputs that the sensor does not provide are rejected */
+static void test_unsupported(void)
+{
+	struct sensor_profile* sensor = (struct sensor_profile*)&ov2640_profile;
+	uint32_t width, height;
+	uint8_t bits;
+
+	_reset(sensor);
+	TEST_ASSERT_EQUAL(SENSOR_RESOLUTION_NOT_SUPPORTED,
+			  sensor_setup(TEST_BUS, sensor, UVGA, YUV_422));
+	TEST_ASSERT_EQUAL(SENSOR_RESOLUTION_NOT_SUPPORTED,
+			  sensor_get_output(sensor, UVGA, YUV_422, &bits, &width, &height));
+	TEST_ASSERT_EQUAL(SENSOR_OK,
+			  sensor_get_output(sensor, VGA, YUV_422, &bits, &width, &height));
+	TEST_ASSERT_EQUAL(640, width);
+	TEST_ASSERT_EQUAL(480, height);
+	TEST_ASSERT_EQUAL(0, _event_count);
+}
+
+/* the sensor answering with its product ID is detected */
+static void test_detect(void)
+{
+	_reset(&ov7740_profile);
+	_set_pid(&ov7740_profile);
+	TEST_ASSERT(sensor_detect(TEST_BUS, true, 0) == &ov7740_profile);
+	TEST_ASSERT(sensor_detect(TEST_BUS, false, SENSOR_OMNIVISION_7740) == &ov7740_profile);
+	TEST_ASSERT(sensor_detect(TEST_BUS, false, SENSOR_OMNIVISION_2640) == NULL);
+	TEST_ASSERT(!_in_transaction);
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	TEST_RUN(test_tables);
+	TEST_RUN(test_exposure);
+	TEST_RUN(test_verify);
+	TEST_RUN(test_bus_error);
+	TEST_RUN(test_unsupported);
+	TEST_RUN(test_detect);
+	return 0;
+}
@@ -0,0 +1,714 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the SHA driver hash contexts against NIST and RFC vectors.
+ * The SHA peripheral is simulated by a software SHA-1/SHA-224/SHA-256
+ * backend: blocks are hashed as they are written to the input registers,
+ * the output registers return the intermediate hash value and IR0 loads a
+ * user initial hash value. The DMA channel feeds the simulated peripheral
+ * and calls its completion callback from dma_poll().
+ *
+ * The test is built twice: with CONFIG_HAVE_SHA_HMAC, where contexts are
+ * time-sliced by saving and restoring their intermediate hash values, and
+ * without, where a started context keeps the peripheral until its digest
+ * is read.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "callback.h"
+#include "chip.h"
+#include "errno.h"
+#include "test.h"
+#include "trace.h"
+
+#include "crypto/sha.h"
+#include "crypto/shad.h"
+#include "dma/dma.h"
+#include "peripherals/pmc.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define MILLION 1000000
+
+/* simulated SHA peripheral */
+struct _sim_sha {
+	uint32_t mode;
+	bool first;           /* next block starts a message */
+	bool ir0;             /* next input write loads the initial hash */
+	uint32_t user[8];     /* user initial hash value */
+	uint32_t state[8];
+	uint8_t block[64];
+	uint32_t fill;
+	uint32_t blocks;      /* hashed blocks */
+	uint32_t uihv_loads;  /* intermediate hash values restored */
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+uint32_t test_irq_disabled;
+
+Sha test_sha;
+
+static struct _sim_sha _sha;
+
+/* simulated DMA channel */
+static struct _dma_channel _dma_channel;
+static struct _callback _dma_callback;
+static struct _dma_transfer_cfg _dma_list[2];
+static uint8_t _dma_count;
+static bool _dma_pending;
+
+static ALIGNED(L1_CACHE_BYTES) uint8_t _million_a[MILLION];
+
+static const uint32_t _sha1_iv[5] = {
+	0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+};
+
+static const uint32_t _sha224_iv[8] = {
+	0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939,
+	0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4,
+};
+
+static const uint32_t _sha256_iv[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+static const uint32_t _sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+	0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+	0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+	0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+	0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/*----------------------------------------------------------------------------
+ *         Software backend
+ *----------------------------------------------------------------------------*/
+
+static uint32_t _rol(uint32_t x, int n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+static uint32_t _ror(uint32_t x, int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+static uint32_t _load_be32(const uint8_t* p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+	       ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void _sha1_compress(uint32_t* h, const uint8_t* block)
+{
+	uint32_t w[80], a, b, c, d, e, f, k, t;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = _load_be32(&block[4 * i]);
+	for (; i < 80; i++)
+		w[i] = _rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+	a = h[0]; b = h[1]; c = h[2]; d = h[3]; e = h[4];
+	for (i = 0; i < 80; i++) {
+		if (i < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5a827999;
+		} else if (i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		} else if (i < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8f1bbcdc;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+		t = _rol(a, 5) + f + e + k + w[i];
+		e = d; d = c; c = _rol(b, 30); b = a; a = t;
+	}
+	h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+}
+
+static void _sha256_compress(uint32_t* h, const uint8_t* block)
+{
+	uint32_t w[64], s[8], t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = _load_be32(&block[4 * i]);
+	for (; i < 64; i++)
+		w[i] = w[i - 16] + w[i - 7] +
+		       (_ror(w[i - 15], 7) ^ _ror(w[i - 15], 18) ^ (w[i - 15] >> 3)) +
+		       (_ror(w[i - 2], 17) ^ _ror(w[i - 2], 19) ^ (w[i - 2] >> 10));
+
+	memcpy(s, h, sizeof(s));
+	for (i = 0; i < 64; i++) {
+		t1 = s[7] + (_ror(s[4], 6) ^ _ror(s[4], 11) ^ _ror(s[4], 25)) +
+		     ((s[4] & s[5]) ^ (~s[4] & s[6])) + _sha256_k[i] + w[i];
+		t2 = (_ror(s[0], 2) ^ _ror(s[0], 13) ^ _ror(s[0], 22)) +
+		     ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+		memmove(&s[1], &s[0], 7 * sizeof(s[0]));
+		s[4] += t1;
+		s[0] = t1 + t2;
+	}
+	for (i = 0; i < 8; i++)
+		h[i] += s[i];
+}
+
+static void _sim_sha_block(void)
+{
+	uint32_t algo = _sha.mode & SHA_MR_ALGO_Msk;
+
+	if (_sha.first) {
+		if (_sha.mode & SHA_MR_UIHV)
+			memcpy(_sha.state, _sha.user, sizeof(_sha.state));
+		else if (algo == SHA_MR_ALGO_SHA1)
+			memcpy(_sha.state, _sha1_iv, sizeof(_sha1_iv));
+		else if (algo == SHA_MR_ALGO_SHA224)
+			memcpy(_sha.state, _sha224_iv, sizeof(_sha224_iv));
+		else
+			memcpy(_sha.state, _sha256_iv, sizeof(_sha256_iv));
+		_sha.first = false;
+	}
+
+	if (algo == SHA_MR_ALGO_SHA1)
+		_sha1_compress(_sha.state, _sha.block);
+	else
+		_sha256_compress(_sha.state, _sha.block);
+	_sha.blocks++;
+}
+
+static void _sim_sha_write(const uint8_t* data, uint32_t len)
+{
+	uint32_t i, count;
+
+	if (_sha.ir0) {
+		/* initial hash value, in the output register byte order */
+		TEST_ASSERT(_sha.mode & SHA_MR_UIHV);
+		for (i = 0; i < len / 4; i++)
+			_sha.user[i] = _load_be32(&data[4 * i]);
+		_sha.ir0 = false;
+		_sha.uihv_loads++;
+		return;
+	}
+
+	while (len) {
+		count = len < sizeof(_sha.block) - _sha.fill ?
+			len : sizeof(_sha.block) - _sha.fill;
+		memcpy(&_sha.block[_sha.fill], data, count);
+		_sha.fill += count;
+		data += count;
+		len -= count;
+		if (_sha.fill == sizeof(_sha.block)) {
+			_sim_sha_block();
+			_sha.fill = 0;
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *         Simulated SHA peripheral
+ *----------------------------------------------------------------------------*/
+
+void sha_start(void)
+{
+}
+
+void sha_soft_reset(void)
+{
+	memset(&_sha, 0, offsetof(struct _sim_sha, blocks));
+}
+
+void sha_first_block(void)
+{
+	_sha.first = true;
+	_sha.fill = 0;
+}
+
+void sha_configure(uint32_t mode)
+{
+	uint32_t algo = mode & SHA_MR_ALGO_Msk;
+
+	TEST_ASSERT(algo == SHA_MR_ALGO_SHA1 || algo == SHA_MR_ALGO_SHA224 ||
+		    algo == SHA_MR_ALGO_SHA256);
+	_sha.mode = mode;
+}
+
+void sha_enable_it(uint32_t sources)
+{
+}
+
+void sha_disable_it(uint32_t sources)
+{
+}
+
+uint32_t sha_get_status(void)
+{
+	return SHA_ISR_DATRDY;
+}
+
+void sha_set_input(const uint8_t* data, int len)
+{
+	_sim_sha_write(data, len);
+}
+
+void sha_get_output(uint8_t* data, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		data[i] = _sha.state[i / 4] >> (24 - 8 * (i % 4));
+}
+
+void sha_enable_hmac(void)
+{
+	/* the hardware HMAC mode is not simulated */
+	TEST_ASSERT(false);
+}
+
+void sha_set_ir0(uint8_t ir)
+{
+	_sha.ir0 = ir;
+}
+
+void sha_set_ir1(uint8_t ir)
+{
+	TEST_ASSERT(false);
+}
+
+void sha_set_start_algo(uint8_t ir)
+{
+}
+
+void sha_set_msr(uint32_t size)
+{
+	/* automatic padding is not simulated */
+	TEST_ASSERT_EQUAL(0, size);
+}
+
+void sha_set_bcr(uint32_t len)
+{
+	TEST_ASSERT_EQUAL(0, len);
+}
+
+/*----------------------------------------------------------------------------
+ *         Simulated DMA, mutex, cache and clocks
+ *----------------------------------------------------------------------------*/
+
+struct _dma_channel* dma_allocate_channel(uint8_t src, uint8_t dest)
+{
+	TEST_ASSERT_EQUAL(DMA_PERIPH_MEMORY, src);
+	TEST_ASSERT_EQUAL(ID_SHA, dest);
+	return &_dma_channel;
+}
+
+int dma_set_callback(struct _dma_channel* channel, struct _callback* callback)
+{
+	callback_copy(&_dma_callback, callback);
+	return 0;
+}
+
+int dma_configure_transfer(struct _dma_channel* channel,
+			   struct _dma_cfg* cfg_dma,
+			   struct _dma_transfer_cfg* list,
+			   uint8_t list_size)
+{
+	uint8_t i;
+
+	TEST_ASSERT(channel == &_dma_channel);
+	TEST_ASSERT(!_dma_pending);
+	TEST_ASSERT(list_size >= 1 && list_size <= ARRAY_SIZE(_dma_list));
+	for (i = 0; i < list_size; i++) {
+		TEST_ASSERT(list[i].daddr == (void*)&SHA->SHA_IDATAR[0]);
+		TEST_ASSERT_EQUAL(0, (uintptr_t)list[i].saddr & 3);
+		_dma_list[i] = list[i];
+	}
+	_dma_count = list_size;
+	return 0;
+}
+
+int dma_start_transfer(struct _dma_channel* channel)
+{
+	_dma_pending = true;
+	return 0;
+}
+
+int dma_reset_channel(struct _dma_channel* channel)
+{
+	return 0;
+}
+
+/* transfers complete on the next poll, the callback then runs as from the
+ * DMA interrupt */
+void dma_poll(void)
+{
+	uint8_t i;
+
+	if (!_dma_pending)
+		return;
+	for (i = 0; i < _dma_count; i++)
+		_sim_sha_write(_dma_list[i].saddr, 4 * _dma_list[i].len);
+	_dma_pending = false;
+	callback_call(&_dma_callback, NULL);
+}
+
+bool mutex_try_lock(mutex_t* mutex)
+{
+	if (*mutex)
+		return false;
+	*mutex = 1;
+	return true;
+}
+
+void mutex_lock(mutex_t* mutex)
+{
+	TEST_ASSERT(mutex_try_lock(mutex));
+}
+
+void mutex_unlock(mutex_t* mutex)
+{
+	*mutex = 0;
+}
+
+bool mutex_is_locked(const mutex_t* mutex)
+{
+	return *mutex != 0;
+}
+
+void cache_clean_region(const void* start, uint32_t length)
+{
+}
+
+void pmc_configure_peripheral(uint32_t id, const struct _pmc_periph_cfg* cfg,
+			      bool enable)
+{
+}
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static void _hex(const char* hex, uint8_t* out)
+{
+	while (hex[0] && hex[1]) {
+		unsigned int byte;
+
+		TEST_ASSERT(sscanf(hex, "%2x", &byte) == 1);
+		*out++ = byte;
+		hex += 2;
+	}
+}
+
+static void _init_desc(struct _shad_desc* desc, enum _shad_transfer_mode mode)
+{
+	memset(desc, 0, sizeof(*desc));
+	desc->cfg.transfer_mode = mode;
+	desc->cfg.algo = ALGO_SHA_256;
+	shad_init(desc);
+	memset(&_sha, 0, sizeof(_sha));
+}
+
+static void _update(struct _shad_desc* desc, struct _shad_ctx* ctx,
+		const void* data, uint32_t size)
+{
+	struct _buffer buf = {
+		.data = (uint8_t*)data,
+		.size = size,
+	};
+
+	TEST_ASSERT_EQUAL(0, shad_ctx_update(desc, ctx, &buf, NULL));
+	shad_ctx_wait_completion(desc, ctx);
+}
+
+static void _check_digest(struct _shad_desc* desc, struct _shad_ctx* ctx,
+		const char* expected_hex)
+{
+	uint8_t digest[32], expected[32];
+	struct _buffer buf = {
+		.data = digest,
+		.size = shad_get_digest_size(ctx->algo),
+	};
+
+	_hex(expected_hex, expected);
+	TEST_ASSERT_EQUAL(0, shad_ctx_finish(desc, ctx, &buf, NULL));
+	shad_ctx_wait_completion(desc, ctx);
+	TEST_ASSERT(!memcmp(expected, digest, buf.size));
+}
+
+static void _hash_vectors(enum _shad_transfer_mode mode)
+{
+	static const char msg448[] =
+		"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+	static ALIGNED(4) uint8_t data[sizeof(msg448)];
+	static ALIGNED(4) uint8_t abc[4] = "abc";
+	struct _shad_desc desc;
+	struct _shad_ctx ctx;
+	uint32_t offset, len;
+
+	_init_desc(&desc, mode);
+	memcpy(data, msg448, sizeof(msg448));
+
+	TEST_ASSERT_EQUAL(0, shad_ctx_init(&ctx, ALGO_SHA_1));
+	_update(&desc, &ctx, abc, 3);
+	_check_digest(&desc, &ctx, "a9993e364706816aba3e25717850c26c9cd0d89d");
+
+	TEST_ASSERT_EQUAL(0, shad_ctx_init(&ctx, ALGO_SHA_224));
+	_update(&desc, &ctx, abc, 3);
+	_check_digest(&desc, &ctx, "23097d223405d8228642a477bda255b32aadbce4"
+			"bda0b3f7e36c9da7");
+
+	TEST_ASSERT_EQUAL(0, shad_ctx_init(&ctx, ALGO_SHA_256));
+	_update(&desc, &ctx, abc, 3);
+	_check_digest(&desc, &ctx, "ba7816bf8f01cfea414140de5dae2223b00361a3"
+			"96177a9cb410ff61f20015ad");
+
+	/* the context is reusable once its digest is read */
+	_update(&desc, &ctx, data, strlen(msg448));
+	_check_digest(&desc, &ctx, "248d6a61d20638b8e5c026930c3e6039a33ce459"
+			"64ff2167f6ecedd419db06c1");
+
+	/* empty message */
+	_check_digest(&desc, &ctx, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4"
+			"649b934ca495991b7852b855");
+
+	/* long message in updates of varying sizes (multiples of 4 bytes
+	 * except the last one, as required for DMA) */
+	for (offset = 0, len = 4; offset < MILLION; offset += len, len += 60)
+		_update(&desc, &ctx, &_million_a[offset],
+			len < MILLION - offset ? len : MILLION - offset);
+	_check_digest(&desc, &ctx, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48"
+			"a497200e046d39ccc7112cd0");
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_hash_polling(void)
+{
+	_hash_vectors(SHAD_TRANS_POLLING);
+}
+
+static void test_hash_dma(void)
+{
+	_hash_vectors(SHAD_TRANS_DMA);
+}
+
+static void test_concurrent(void)
+{
+	static ALIGNED(4) uint8_t abc[4] = "abc";
+	struct _shad_desc desc;
+	struct _shad_ctx a, b;
+	struct _buffer big = {
+		.data = _million_a,
+		.size = MILLION,
+	};
+	struct _buffer small = {
+		.data = abc,
+		.size = 3,
+	};
+
+	_init_desc(&desc, SHAD_TRANS_DMA);
+	TEST_ASSERT_EQUAL(0, shad_ctx_init(&a, ALGO_SHA_256));
+	TEST_ASSERT_EQUAL(0, shad_ctx_init(&b, ALGO_SHA_1));
+
+	/* a long update is sliced; a second stream submitted meanwhile */
+	TEST_ASSERT_EQUAL(0, shad_ctx_update(&desc, &a, &big, NULL));
+	TEST_ASSERT(shad_ctx_is_busy(&a));
+	TEST_ASSERT_EQUAL(-EBUSY, shad_ctx_update(&desc, &a, &small, NULL));
+	TEST_ASSERT_EQUAL(0, shad_ctx_update(&desc, &b, &small, NULL));
+#ifdef CONFIG_HAVE_SHA_HMAC
+	/* round-robin: the short stream completes long before the long one,
+	 * whose hash value is restored after each slice of the other one */
+	shad_ctx_wait_completion(&desc, &b);
+	TEST_ASSERT(shad_ctx_is_busy(&a));
+	_check_digest(&desc, &b, "a9993e364706816aba3e25717850c26c9cd0d89d");
+	TEST_ASSERT(shad_ctx_is_busy(&a));
+	TEST_ASSERT(_sha.uihv_loads > 0);
+	shad_ctx_wait_completion(&desc, &a);
+	_check_digest(&desc, &a, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48"
+			"a497200e046d39ccc7112cd0");
+#else
+	/* the started stream keeps the peripheral until its digest is read */
+	shad_ctx_wait_completion(&desc, &a);
+	TEST_ASSERT(shad_ctx_is_busy(&b));
+	TEST_ASSERT_EQUAL(-ENOTSUP, shad_start(&desc));
+	_check_digest(&desc, &a, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48"
+			"a497200e046d39ccc7112cd0");
+	shad_ctx_wait_completion(&desc, &b);
+	_check_digest(&desc, &b, "a9993e364706816aba3e25717850c26c9cd0d89d");
+	TEST_ASSERT_EQUAL(0, _sha.uihv_loads);
+#endif
+}
+
+#ifdef CONFIG_HAVE_SHA_HMAC
+
+static void _check_hmac(struct _shad_desc* desc, enum _shad_algo algo,
+		const uint8_t* key, uint32_t key_size, const char* msg,
+		const char* expected_hex)
+{
+	static ALIGNED(4) uint8_t key_buf[256];
+	static ALIGNED(4) uint8_t msg_buf[256];
+	struct _shad_ctx ctx;
+	struct _buffer buf = {
+		.data = key_buf,
+		.size = key_size,
+	};
+	uint32_t blocks;
+
+	memcpy(key_buf, key, key_size);
+	strcpy((char*)msg_buf, msg);
+	TEST_ASSERT_EQUAL(0, shad_ctx_hmac_init(desc, &ctx, algo, &buf));
+
+	/* the key pads are hashed once: a second message only hashes its own
+	 * blocks and the outer block */
+	_update(desc, &ctx, msg_buf, strlen(msg));
+	_check_digest(desc, &ctx, expected_hex);
+	blocks = _sha.blocks;
+	_update(desc, &ctx, msg_buf, strlen(msg));
+	_check_digest(desc, &ctx, expected_hex);
+	TEST_ASSERT_EQUAL(2, _sha.blocks - blocks);
+}
+
+static void test_hmac(void)
+{
+	uint8_t key[131];
+	struct _shad_desc desc;
+
+	_init_desc(&desc, SHAD_TRANS_POLLING);
+
+	/* RFC 2202 test case 1, RFC 4231 test cases 1, 2 and 6 */
+	memset(key, 0x0b, 20);
+	_check_hmac(&desc, ALGO_SHA_1, key, 20, "Hi There",
+		    "b617318655057264e28bc0b6fb378c8ef146be00");
+	_check_hmac(&desc, ALGO_SHA_256, key, 20, "Hi There",
+		    "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c"
+		    "2e32cff7");
+	_check_hmac(&desc, ALGO_SHA_256, (const uint8_t*)"Jefe", 4,
+		    "what do ya want for nothing?",
+		    "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b9"
+		    "64ec3843");
+	memset(key, 0xaa, sizeof(key));
+	_check_hmac(&desc, ALGO_SHA_256, key, sizeof(key),
+		    "Test Using Larger Than Block-Size Key - Hash Key First",
+		    "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f"
+		    "0ee37f54");
+}
+
+#else
+
+static void test_hmac(void)
+{
+	static uint8_t key[] = "Jefe";
+	static uint8_t msg[] = "what do ya want for nothing?";
+	uint8_t digest[32], expected[32];
+	struct _shad_desc desc;
+	struct _shad_ctx ctx;
+	struct _buffer buf_key = {
+		.data = key,
+		.size = 4,
+	};
+	struct _buffer buf_msg = {
+		.data = msg,
+		.size = sizeof(msg) - 1,
+	};
+	struct _buffer buf_digest = {
+		.data = digest,
+		.size = sizeof(digest),
+	};
+
+	_init_desc(&desc, SHAD_TRANS_POLLING);
+	_hex("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+	     expected);
+
+	/* HMAC contexts need user initial hash values */
+	TEST_ASSERT_EQUAL(-ENOTSUP, shad_ctx_hmac_init(&desc, &ctx,
+				ALGO_SHA_256, &buf_key));
+
+	/* the one-shot HMAC cannot run while a started context holds the
+	 * peripheral */
+	TEST_ASSERT_EQUAL(0, shad_ctx_init(&ctx, ALGO_SHA_256));
+	_update(&desc, &ctx, _million_a, 200);
+	TEST_ASSERT_EQUAL(-ENOTSUP, shad_hmac_set_key(&desc, &buf_key));
+	TEST_ASSERT_EQUAL(-ENOTSUP, shad_compute_hmac(&desc, &buf_msg,
+				&buf_digest, NULL));
+
+	/* and runs once its digest is read */
+	_check_digest(&desc, &ctx, "c2a908d98f5df987ade41b5fce213067efbcc21e"
+			"f2240212a41e54b5e7c28ae5");
+	TEST_ASSERT_EQUAL(0, shad_hmac_set_key(&desc, &buf_key));
+	TEST_ASSERT_EQUAL(0, shad_compute_hmac(&desc, &buf_msg, &buf_digest,
+				NULL));
+	TEST_ASSERT(!memcmp(expected, digest, sizeof(digest)));
+}
+
+#endif
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	memset(_million_a, 'a', sizeof(_million_a));
+
+	TEST_RUN(test_hash_polling);
+	TEST_RUN(test_hash_dma);
+	TEST_RUN(test_concurrent);
+	TEST_RUN(test_hmac);
+	return 0;
+}
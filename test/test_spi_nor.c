@@ -0,0 +1,806 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the SPI NOR driver against a behavioral model of a SPI NOR
+ * flash. The model decodes the commands the driver sends on the SPI bus:
+ * Read ID, SFDP, Status Register, Write Enable, (Fast) Read, Page Program,
+ * block and chip erases, Program/Erase Suspend and Resume, and the read of
+ * the register selecting the sector map. Programs and erases keep the
+ * memory busy for their typical time, on a simulated microsecond clock that
+ * the timer mocks advance.
+ *
+ * The model flags the protocol errors a real device would not forgive:
+ * accessing the array while busy, programming or erasing without Write
+ * Enable, misaligned erases, reading the block being erased during a
+ * suspend, and suspending again before the resume interval.
+ *
+ * The tests check the parameters probed from SFDP, the polling of page
+ * programs, the erase commands selected for a range with a uniform map and
+ * with the regions of a Sector Map Parameter Table, the asynchronous write
+ * and erase driven by spi_nor_poll(), the reads suspending an erase, and the
+ * timeouts. The delays never go through usleep(), which masks the interrupts.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "callback.h"
+#include "chip.h"
+#include "errno.h"
+#include "intmath.h"
+#include "test.h"
+#include "timer.h"
+#include "trace.h"
+
+#include "nvm/spi-nor/spi-nor.h"
+#include "peripherals/bus.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define NOR_SIZE (4 * 1024 * 1024)
+#define NOR_PAGE_SIZE 256
+
+/* typical times, as described in the SFDP tables of the model */
+#define PP_TIME 704
+#define ERASE_4K_TIME 48000
+#define ERASE_32K_TIME 128000
+#define ERASE_64K_TIME 256000
+#define ERASE_CHIP_TIME 12000000
+#define SUSPEND_LATENCY 20
+#define RESUME_INTERVAL 128
+
+#define LOG_SIZE 64
+
+/* configuration register read by the sector map detection command */
+#define INST_READ_ANY_REG 0x65
+#define CONFIG_REG_ADDR 0x800004
+#define CONFIG_REG_MAP (0x1 << 2)
+
+/** program or erase command executed by the model */
+struct _sim_op {
+	uint8_t inst;
+	uint32_t addr;
+	uint32_t len;
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t trace_level = TRACE_LEVEL_SILENT;
+
+/* simulated clock, in microseconds */
+static uint64_t _now;
+
+/* SPI NOR model */
+static const uint8_t _id[] = { 0xab, 0x40, 0x16 };
+static uint8_t _array[NOR_SIZE];
+static uint8_t _sfdp[256];
+static uint8_t _config_reg;
+static bool _wel;
+/* the programs and erases never complete */
+static bool _stuck;
+static uint64_t _busy_until;
+
+/* program or erase in progress, possibly suspended */
+static uint32_t _op_addr;
+static uint32_t _op_len;
+static bool _suspended;
+static uint64_t _remaining;
+static uint64_t _resumed_at;
+
+static struct _sim_op _ops[LOG_SIZE];
+static uint32_t _ops_count;
+static uint32_t _sr_reads;
+static uint32_t _suspends;
+static uint32_t _resumes;
+static uint32_t _errors;
+
+/* completion callback */
+static uint32_t _cb_count;
+static int _cb_rc;
+
+static struct spi_flash _flash;
+
+/*----------------------------------------------------------------------------
+ *         Simulated SPI NOR flash
+ *----------------------------------------------------------------------------*/
+
+static void _sfdp_dword(uint32_t offset, uint32_t value)
+{
+	_sfdp[offset + 0] = value >> 0;
+	_sfdp[offset + 1] = value >> 8;
+	_sfdp[offset + 2] = value >> 16;
+	_sfdp[offset + 3] = value >> 24;
+}
+
+/*
+ * JESD216B header and Basic Flash Parameter Table of a 4MiB flash with 4KB,
+ * 32KB and 64KB erases, and program/erase suspend.
+ */
+static void _sim_sfdp_init(void)
+{
+	memset(_sfdp, 0xff, sizeof(_sfdp));
+
+	/* SFDP header: signature, v1.6, one parameter header */
+	_sfdp_dword(0x00, 0x50444653);
+	_sfdp_dword(0x04, 0xff000106);
+
+	/* BFPT header: v1.6, 16 DWORDs at 0x30 */
+	_sfdp_dword(0x08, 0x10010600);
+	_sfdp_dword(0x0c, 0xff000030);
+
+	/* DWORD1: 1-1-1 reads only */
+	_sfdp_dword(0x30, 0x00000000);
+	/* DWORD2: density, in bits minus one */
+	_sfdp_dword(0x34, NOR_SIZE * 8 - 1);
+	_sfdp_dword(0x38, 0);
+	_sfdp_dword(0x3c, 0);
+	_sfdp_dword(0x40, 0);
+	_sfdp_dword(0x44, 0);
+	_sfdp_dword(0x48, 0);
+	/* DWORD8/9: 4KB 0x20, 32KB 0x52, 64KB 0xd8 */
+	_sfdp_dword(0x4c, 0x520f200c);
+	_sfdp_dword(0x50, 0x0000d810);
+	/* DWORD10: erase times 3 * 16ms, 8 * 16ms, 2 * 128ms */
+	_sfdp_dword(0x54, (0x22 << 4) | (0x27 << 11) | (0x41 << 18));
+	/* DWORD11: 256B pages, program 11 * 64us, chip erase 3 * 4s */
+	_sfdp_dword(0x58, (8 << 4) | (10 << 8) | (1 << 13) | (2 << 24) | (2 << 29));
+	/* DWORD12: suspend latency 20 * 1us, resume interval 2 * 64us */
+	_sfdp_dword(0x5c, (19 << 24) | (1 << 29) | (1 << 20));
+	/* DWORD13: suspend 0x75, resume 0x7a */
+	_sfdp_dword(0x60, 0x757a757a);
+	_sfdp_dword(0x64, 0);
+	_sfdp_dword(0x68, 0);
+	_sfdp_dword(0x6c, 0);
+}
+
+/*
+ * Sector Map Parameter Table selected by bit 2 of the configuration
+ * register. Map 0: 4KB erases in the bottom 64KB, 64KB erases in the
+ * middle, 4KB and 32KB erases in the top 64KB. Map 1: 64KB erases only.
+ */
+static void _sim_sfdp_add_smpt(void)
+{
+	/* one more parameter header: SMPT v1.0, 8 DWORDs at 0x80 */
+	_sfdp[0x06] = 1;
+	_sfdp_dword(0x10, 0x08010081);
+	_sfdp_dword(0x14, 0xff000080);
+
+	/* detection: Read Any Register, 3 address bytes, 8 wait states */
+	_sfdp_dword(0x80, (CONFIG_REG_MAP << 24) | (1 << 22) | (8 << 16) |
+		    (INST_READ_ANY_REG << 8));
+	_sfdp_dword(0x84, CONFIG_REG_ADDR);
+
+	/* map 0: three regions */
+	_sfdp_dword(0x88, (2 << 16) | (0 << 8) | (1 << 1));
+	_sfdp_dword(0x8c, ((0x10000 / 256 - 1) << 8) | 0x1);
+	_sfdp_dword(0x90, (((NOR_SIZE - 0x20000) / 256 - 1) << 8) | 0x4);
+	_sfdp_dword(0x94, ((0x10000 / 256 - 1) << 8) | 0x3);
+
+	/* map 1: one region, last descriptor */
+	_sfdp_dword(0x98, (0 << 16) | (1 << 8) | (1 << 1) | (1 << 0));
+	_sfdp_dword(0x9c, ((NOR_SIZE / 256 - 1) << 8) | 0x4);
+}
+
+static void _sim_reset(void)
+{
+	memset(_array, 0xff, sizeof(_array));
+	_sim_sfdp_init();
+	_config_reg = 0;
+	_wel = false;
+	_stuck = false;
+	_busy_until = 0;
+	_op_addr = 0;
+	_op_len = 0;
+	_suspended = false;
+	_remaining = 0;
+	_resumed_at = 0;
+	_ops_count = 0;
+	_sr_reads = 0;
+	_suspends = 0;
+	_resumes = 0;
+	_errors = 0;
+	_cb_count = 0;
+	_cb_rc = 1;
+}
+
+static bool _sim_busy(void)
+{
+	return _now < _busy_until;
+}
+
+static void _sim_start(uint8_t inst, uint32_t addr, uint32_t len, uint32_t time)
+{
+	if (!_wel)
+		_errors++;
+	_wel = false;
+
+	if (_ops_count < LOG_SIZE) {
+		_ops[_ops_count].inst = inst;
+		_ops[_ops_count].addr = addr;
+		_ops[_ops_count].len = len;
+	}
+	_ops_count++;
+
+	_op_addr = addr;
+	_op_len = len;
+	_busy_until = _stuck ? UINT64_MAX : _now + time;
+}
+
+static void _sim_erase(uint8_t inst, uint32_t addr, uint32_t len, uint32_t time)
+{
+	if (addr & (len - 1))
+		_errors++;
+	addr &= ~(len - 1);
+	if (_wel)
+		memset(&_array[addr], 0xff, len);
+	_sim_start(inst, addr, len, time);
+}
+
+static void _sim_program(uint32_t addr, const uint8_t* data, uint32_t len)
+{
+	uint32_t page = addr & ~(NOR_PAGE_SIZE - 1);
+	uint32_t i;
+
+	if (len > NOR_PAGE_SIZE)
+		_errors++;
+	if (_wel) {
+		/* programming only clears bits, and wraps in the page */
+		for (i = 0; i < len; i++)
+			_array[page + ((addr + i) & (NOR_PAGE_SIZE - 1))] &= data[i];
+	}
+	_sim_start(SFLASH_INST_PAGE_PROGRAM, addr, len, PP_TIME);
+}
+
+static void _sim_read(uint32_t addr, uint8_t* data, uint32_t len)
+{
+	/* the array is readable during a suspend, except the busy block */
+	if (_suspended && addr < _op_addr + _op_len && _op_addr < addr + len)
+		_errors++;
+	if (addr + len > NOR_SIZE)
+		_errors++;
+	else
+		memcpy(data, &_array[addr], len);
+}
+
+static void _sim_command(const uint8_t* hdr, uint32_t hdr_len, struct _buffer* data)
+{
+	uint8_t inst = hdr[0];
+	uint32_t addr = 0, addr_len = 0, dummy = 0;
+	uint8_t* buf = data ? data->data : NULL;
+	uint32_t len = data ? data->size : 0;
+
+	switch (inst) {
+	case SFLASH_INST_READ:
+	case SFLASH_INST_PAGE_PROGRAM:
+	case SFLASH_INST_ERASE_4K:
+	case SFLASH_INST_ERASE_32K:
+	case SFLASH_INST_ERASE_64K:
+		addr_len = 3;
+		break;
+	case SFLASH_INST_FAST_READ:
+	case SFLASH_INST_READ_SFDP:
+	case INST_READ_ANY_REG:
+		addr_len = 3;
+		dummy = 1;
+		break;
+	default:
+		break;
+	}
+	if (hdr_len != 1 + addr_len + dummy) {
+		_errors++;
+		return;
+	}
+	if (addr_len)
+		addr = (hdr[1] << 16) | (hdr[2] << 8) | hdr[3];
+
+	/* only the status and the suspend are accepted while busy */
+	if (_sim_busy() && inst != SFLASH_INST_READ_SR &&
+	    inst != SFLASH_INST_SUSPEND) {
+		_errors++;
+		return;
+	}
+
+	/* nothing but reads and the resume during a suspend */
+	if (_suspended && inst != SFLASH_INST_READ_SR &&
+	    inst != SFLASH_INST_READ && inst != SFLASH_INST_FAST_READ &&
+	    inst != SFLASH_INST_RESUME) {
+		_errors++;
+		return;
+	}
+
+	switch (inst) {
+	case SFLASH_INST_RESET_ENABLE:
+	case SFLASH_INST_RESET:
+		_wel = false;
+		break;
+	case SFLASH_INST_READ_ID:
+		memset(buf, 0, len);
+		memcpy(buf, _id, min_u32(len, sizeof(_id)));
+		break;
+	case SFLASH_INST_READ_SFDP:
+		memset(buf, 0xff, len);
+		if (addr < sizeof(_sfdp))
+			memcpy(buf, &_sfdp[addr], min_u32(len, sizeof(_sfdp) - addr));
+		break;
+	case INST_READ_ANY_REG:
+		if (addr != CONFIG_REG_ADDR)
+			_errors++;
+		memset(buf, _config_reg, len);
+		break;
+	case SFLASH_INST_READ_SR:
+		/* WIP, and the Write Enable Latch in bit 1 */
+		_sr_reads++;
+		memset(buf, (_sim_busy() ? SR_WIP : 0) | (_wel ? 0x02 : 0), len);
+		break;
+	case SFLASH_INST_WRITE_ENABLE:
+		_wel = true;
+		break;
+	case SFLASH_INST_WRITE_DISABLE:
+		_wel = false;
+		break;
+	case SFLASH_INST_READ:
+	case SFLASH_INST_FAST_READ:
+		_sim_read(addr, buf, len);
+		break;
+	case SFLASH_INST_PAGE_PROGRAM:
+		_sim_program(addr, buf, len);
+		break;
+	case SFLASH_INST_ERASE_4K:
+		_sim_erase(inst, addr, 4096, ERASE_4K_TIME);
+		break;
+	case SFLASH_INST_ERASE_32K:
+		_sim_erase(inst, addr, 32768, ERASE_32K_TIME);
+		break;
+	case SFLASH_INST_ERASE_64K:
+		_sim_erase(inst, addr, 65536, ERASE_64K_TIME);
+		break;
+	case SFLASH_INST_ERASE_CHIP:
+		_sim_erase(inst, 0, NOR_SIZE, ERASE_CHIP_TIME);
+		break;
+	case SFLASH_INST_SUSPEND:
+		/* ignored when the operation already completed */
+		if (!_sim_busy() || _suspended)
+			break;
+		if (_now < _resumed_at + RESUME_INTERVAL)
+			_errors++;
+		_suspends++;
+		_suspended = true;
+		_remaining = _busy_until - _now;
+		_busy_until = _now + SUSPEND_LATENCY;
+		break;
+	case SFLASH_INST_RESUME:
+		if (!_suspended) {
+			_errors++;
+			break;
+		}
+		_resumes++;
+		_suspended = false;
+		_resumed_at = _now;
+		_busy_until = _now + _remaining;
+		break;
+	default:
+		_errors++;
+		break;
+	}
+}
+
+/*----------------------------------------------------------------------------
+ *         Mocks
+ *----------------------------------------------------------------------------*/
+
+int bus_configure_slave(uint8_t bus_id, const struct _bus_dev_cfg* cfg)
+{
+	return 0;
+}
+
+int bus_start_transaction(uint8_t bus_id)
+{
+	return 0;
+}
+
+int bus_stop_transaction(uint8_t bus_id)
+{
+	return 0;
+}
+
+int bus_transfer(uint8_t bus_id, uint16_t remote, struct _buffer* buf, uint16_t buffers, struct _callback* cb)
+{
+	TEST_ASSERT(buf[0].attr & BUS_BUF_ATTR_TX);
+	TEST_ASSERT(buffers == 1 || buffers == 2);
+	TEST_ASSERT(buf[buffers - 1].attr & BUS_SPI_BUF_ATTR_RELEASE_CS);
+
+	_sim_command(buf[0].data, buf[0].size, buffers > 1 ? &buf[1] : NULL);
+	return 0;
+}
+
+int bus_wait_transfer(uint8_t bus_id)
+{
+	return 0;
+}
+
+void timer_start_timeout(struct _timeout* timeout, uint64_t count)
+{
+	timeout->start = timer_get_tick();
+	timeout->count = count;
+}
+
+uint8_t timer_timeout_reached(struct _timeout* timeout)
+{
+	return timer_get_interval(timeout->start, timer_get_tick()) >= timeout->count;
+}
+
+uint64_t timer_get_interval(uint64_t start, uint64_t end)
+{
+	return end - start;
+}
+
+uint64_t timer_get_tick(void)
+{
+	return _now / 1000;
+}
+
+void msleep(uint32_t count)
+{
+	_now += count * 1000ull;
+}
+
+void timer_delay_us(uint32_t count)
+{
+	_now += count;
+}
+
+void usleep(uint32_t count)
+{
+	/* masks then unmasks the interrupts, whatever their previous state */
+	TEST_ASSERT(0);
+}
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static int _done(void* arg, void* arg2)
+{
+	_cb_count++;
+	_cb_rc = (int)(intptr_t)arg2;
+	return 0;
+}
+
+/* probe the model as set up after _sim_reset() */
+static void _probe(void)
+{
+	struct spi_flash_cfg cfg = {
+		.type = SPI_FLASH_TYPE_SPI,
+		.baudrate = 50000000,
+		.mode = SPI_FLASH_MODE0,
+	};
+
+	_now = 1000000;
+	TEST_ASSERT_EQUAL(0, spi_nor_configure(&_flash, &cfg));
+	TEST_ASSERT_EQUAL(0, _errors);
+	_ops_count = 0;
+	_sr_reads = 0;
+}
+
+static void _configure(void)
+{
+	_sim_reset();
+	_probe();
+}
+
+/* poll every 100us until the completion callback */
+static uint32_t _poll_until_done(void)
+{
+	uint32_t polls = 0;
+
+	while (!_cb_count) {
+		TEST_ASSERT(polls < 1000000);
+		spi_nor_poll(&_flash);
+		_now += 100;
+		polls++;
+	}
+	return polls;
+}
+
+static void _fill(uint8_t* buf, uint32_t len, uint8_t seed)
+{
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = seed + i * 7;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_probe(void)
+{
+	const struct spi_flash_erase_map *map = &_flash.erase_map;
+
+	_configure();
+
+	TEST_ASSERT_EQUAL(NOR_SIZE, _flash.size);
+	TEST_ASSERT_EQUAL(NOR_PAGE_SIZE, _flash.page_size);
+	TEST_ASSERT_EQUAL(3, _flash.addr_len);
+	TEST_ASSERT_EQUAL(PP_TIME, _flash.page_program_time);
+	TEST_ASSERT_EQUAL(ERASE_4K_TIME, map->commands[0].typ_time);
+	TEST_ASSERT_EQUAL(ERASE_32K_TIME, map->commands[1].typ_time);
+	TEST_ASSERT_EQUAL(ERASE_64K_TIME, map->commands[2].typ_time);
+	TEST_ASSERT_EQUAL(ERASE_CHIP_TIME, map->chip.typ_time);
+	TEST_ASSERT(_flash.flags & SFLASH_FLG_HAS_SUSPEND);
+	TEST_ASSERT_EQUAL(SUSPEND_LATENCY, _flash.suspend_latency);
+	TEST_ASSERT_EQUAL(RESUME_INTERVAL, _flash.resume_interval);
+}
+
+static void test_page_program_polling(void)
+{
+	uint8_t data[NOR_PAGE_SIZE], check[NOR_PAGE_SIZE];
+	uint64_t start;
+
+	_configure();
+	_fill(data, sizeof(data), 1);
+
+	start = _now;
+	TEST_ASSERT_EQUAL(0, spi_nor_write(&_flash, 0x1000, data, sizeof(data)));
+	TEST_ASSERT_EQUAL(1, _ops_count);
+
+	/* done within a quarter of the typical time, with a few polls */
+	TEST_ASSERT(_now - start >= PP_TIME);
+	TEST_ASSERT(_now - start <= PP_TIME + PP_TIME / 4);
+	TEST_ASSERT(_sr_reads <= 6);
+
+	TEST_ASSERT_EQUAL(0, spi_nor_read(&_flash, 0x1000, check, sizeof(check)));
+	TEST_ASSERT(!memcmp(data, check, sizeof(data)));
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_write_pages(void)
+{
+	static uint8_t data[1000], check[1000];
+
+	_configure();
+	_fill(data, sizeof(data), 3);
+
+	/* split on the page boundaries */
+	TEST_ASSERT_EQUAL(0, spi_nor_write(&_flash, 0x20080, data, sizeof(data)));
+	TEST_ASSERT_EQUAL(5, _ops_count);
+	TEST_ASSERT_EQUAL(0x20080, _ops[0].addr);
+	TEST_ASSERT_EQUAL(128, _ops[0].len);
+	TEST_ASSERT_EQUAL(0x20100, _ops[1].addr);
+	TEST_ASSERT_EQUAL(256, _ops[1].len);
+	TEST_ASSERT_EQUAL(0x20400, _ops[4].addr);
+	TEST_ASSERT_EQUAL(104, _ops[4].len);
+
+	TEST_ASSERT_EQUAL(0, spi_nor_read(&_flash, 0x20080, check, sizeof(check)));
+	TEST_ASSERT(!memcmp(data, check, sizeof(data)));
+	TEST_ASSERT_EQUAL(0xff, _array[0x2007f]);
+	TEST_ASSERT_EQUAL(0xff, _array[0x20080 + sizeof(data)]);
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_erase_plan(void)
+{
+	uint32_t i;
+
+	_configure();
+
+	/* 4KB up to a 32KB boundary, then 32KB, then 64KB */
+	memset(&_array[0x1000], 0, 0x2f000);
+	TEST_ASSERT_EQUAL(0, spi_nor_erase(&_flash, 0x1000, 0x2f000));
+	TEST_ASSERT_EQUAL(10, _ops_count);
+	for (i = 0; i < 7; i++) {
+		TEST_ASSERT_EQUAL(SFLASH_INST_ERASE_4K, _ops[i].inst);
+		TEST_ASSERT_EQUAL(0x1000 * (i + 1), _ops[i].addr);
+	}
+	TEST_ASSERT_EQUAL(SFLASH_INST_ERASE_32K, _ops[7].inst);
+	TEST_ASSERT_EQUAL(0x8000, _ops[7].addr);
+	TEST_ASSERT_EQUAL(SFLASH_INST_ERASE_64K, _ops[8].inst);
+	TEST_ASSERT_EQUAL(0x10000, _ops[8].addr);
+	TEST_ASSERT_EQUAL(SFLASH_INST_ERASE_64K, _ops[9].inst);
+	TEST_ASSERT_EQUAL(0x20000, _ops[9].addr);
+	for (i = 0x1000; i < 0x30000; i++)
+		TEST_ASSERT_EQUAL(0xff, _array[i]);
+
+	/* the chip erase is faster than 64 64KB erases */
+	_ops_count = 0;
+	TEST_ASSERT_EQUAL(0, spi_nor_erase(&_flash, 0, NOR_SIZE));
+	TEST_ASSERT_EQUAL(1, _ops_count);
+	TEST_ASSERT_EQUAL(SFLASH_INST_ERASE_CHIP, _ops[0].inst);
+
+	/* not on an erase block boundary */
+	TEST_ASSERT_EQUAL(-EINVAL, spi_nor_erase(&_flash, 0x100, 0x1000));
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_sector_map(void)
+{
+	uint32_t i;
+
+	_sim_reset();
+	_sim_sfdp_add_smpt();
+	_probe();
+	TEST_ASSERT_EQUAL(3, _flash.erase_map.num_regions);
+
+	/* 4KB erases only in the bottom region, then 64KB erases */
+	TEST_ASSERT_EQUAL(0, spi_nor_erase(&_flash, 0x8000, 0x28000));
+	TEST_ASSERT_EQUAL(10, _ops_count);
+	for (i = 0; i < 8; i++) {
+		TEST_ASSERT_EQUAL(SFLASH_INST_ERASE_4K, _ops[i].inst);
+		TEST_ASSERT_EQUAL(0x8000 + 0x1000 * i, _ops[i].addr);
+	}
+	TEST_ASSERT_EQUAL(SFLASH_INST_ERASE_64K, _ops[8].inst);
+	TEST_ASSERT_EQUAL(0x10000, _ops[8].addr);
+	TEST_ASSERT_EQUAL(SFLASH_INST_ERASE_64K, _ops[9].inst);
+	TEST_ASSERT_EQUAL(0x20000, _ops[9].addr);
+
+	/* 32KB erases in the top region */
+	_ops_count = 0;
+	TEST_ASSERT_EQUAL(0, spi_nor_erase(&_flash, NOR_SIZE - 0x10000, 0x10000));
+	TEST_ASSERT_EQUAL(2, _ops_count);
+	TEST_ASSERT_EQUAL(SFLASH_INST_ERASE_32K, _ops[0].inst);
+	TEST_ASSERT_EQUAL(SFLASH_INST_ERASE_32K, _ops[1].inst);
+	TEST_ASSERT_EQUAL(NOR_SIZE - 0x8000, _ops[1].addr);
+
+	/* no 4KB erase in the middle region */
+	TEST_ASSERT_EQUAL(-EINVAL, spi_nor_erase(&_flash, 0x11000, 0x1000));
+	TEST_ASSERT_EQUAL(0, _errors);
+
+	/* the other configuration has a single region */
+	_sim_reset();
+	_sim_sfdp_add_smpt();
+	_config_reg = CONFIG_REG_MAP;
+	_probe();
+	TEST_ASSERT_EQUAL(1, _flash.erase_map.num_regions);
+	TEST_ASSERT_EQUAL(0x4, _flash.erase_map.uniform_region.cmd_mask);
+	TEST_ASSERT_EQUAL(-EINVAL, spi_nor_erase(&_flash, 0x8000, 0x1000));
+	TEST_ASSERT_EQUAL(0, spi_nor_erase(&_flash, 0, 0x10000));
+	TEST_ASSERT_EQUAL(1, _ops_count);
+	TEST_ASSERT_EQUAL(SFLASH_INST_ERASE_64K, _ops[0].inst);
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_async_write(void)
+{
+	static uint8_t data[600], check[600];
+	struct _callback cb;
+	uint32_t polls;
+
+	_configure();
+	_fill(data, sizeof(data), 5);
+	callback_set(&cb, _done, NULL);
+
+	TEST_ASSERT_EQUAL(0, spi_nor_write_async(&_flash, 0x10080, data, sizeof(data), &cb));
+	TEST_ASSERT_EQUAL(-EBUSY, spi_nor_write_async(&_flash, 0x20000, data, sizeof(data), &cb));
+	TEST_ASSERT_EQUAL(-EBUSY, spi_nor_erase(&_flash, 0x20000, 0x1000));
+	polls = _poll_until_done();
+
+	/* one page programmed after another, then the callback */
+	TEST_ASSERT_EQUAL(1, _cb_count);
+	TEST_ASSERT_EQUAL(0, _cb_rc);
+	TEST_ASSERT_EQUAL(3, _ops_count);
+	TEST_ASSERT(polls <= 3 * (PP_TIME / 100 + 2));
+	TEST_ASSERT_EQUAL(0, spi_nor_poll(&_flash));
+
+	TEST_ASSERT_EQUAL(0, spi_nor_read(&_flash, 0x10080, check, sizeof(check)));
+	TEST_ASSERT(!memcmp(data, check, sizeof(data)));
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_read_suspends_erase(void)
+{
+	uint8_t data[16], check[16];
+	struct _callback cb;
+	uint64_t start;
+
+	_configure();
+	_fill(data, sizeof(data), 9);
+	TEST_ASSERT_EQUAL(0, spi_nor_write(&_flash, 0x100, data, sizeof(data)));
+	memset(&_array[0x40000], 0, 0x10000);
+	callback_set(&cb, _done, NULL);
+
+	start = _now;
+	TEST_ASSERT_EQUAL(0, spi_nor_erase_async(&_flash, 0x40000, 0x10000, &cb));
+	_now += 10000;
+	TEST_ASSERT_EQUAL(1, spi_nor_poll(&_flash));
+
+	/* reads elsewhere suspend the erase, twice in a row */
+	TEST_ASSERT_EQUAL(0, spi_nor_read(&_flash, 0x100, check, sizeof(check)));
+	TEST_ASSERT(!memcmp(data, check, sizeof(data)));
+	TEST_ASSERT_EQUAL(0, spi_nor_read(&_flash, 0x100, check, sizeof(check)));
+	TEST_ASSERT_EQUAL(2, _suspends);
+	TEST_ASSERT_EQUAL(2, _resumes);
+	TEST_ASSERT_EQUAL(0, _cb_count);
+
+	/* a read of the block being erased waits for the end of the erase */
+	TEST_ASSERT_EQUAL(0, spi_nor_read(&_flash, 0x48000, check, sizeof(check)));
+	TEST_ASSERT_EQUAL(2, _suspends);
+	TEST_ASSERT(_now - start >= ERASE_64K_TIME);
+	TEST_ASSERT_EQUAL(0xff, check[0]);
+
+	TEST_ASSERT_EQUAL(0, spi_nor_poll(&_flash));
+	TEST_ASSERT_EQUAL(1, _cb_count);
+	TEST_ASSERT_EQUAL(0, _cb_rc);
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+static void test_timeout(void)
+{
+	uint8_t data[16];
+	struct _callback cb;
+	uint64_t start;
+
+	_configure();
+	_fill(data, sizeof(data), 11);
+	callback_set(&cb, _done, NULL);
+
+	/* ten times the typical time plus 100ms, within the 1ms tick */
+	_stuck = true;
+	start = _now;
+	TEST_ASSERT_EQUAL(-ETIMEDOUT, spi_nor_write(&_flash, 0, data, sizeof(data)));
+	TEST_ASSERT(_now - start >= (PP_TIME / 100 + 99) * 1000);
+	TEST_ASSERT(_now - start <= (PP_TIME / 100 + 102) * 1000);
+
+	/* the same through spi_nor_poll() */
+	_busy_until = 0;
+	start = _now;
+	TEST_ASSERT_EQUAL(0, spi_nor_erase_async(&_flash, 0x1000, 0x1000, &cb));
+	_poll_until_done();
+	TEST_ASSERT_EQUAL(1, _cb_count);
+	TEST_ASSERT_EQUAL(-ETIMEDOUT, _cb_rc);
+	TEST_ASSERT(_now - start >= (ERASE_4K_TIME / 100 + 99) * 1000);
+	TEST_ASSERT(_now - start <= (ERASE_4K_TIME / 100 + 102) * 1000);
+	TEST_ASSERT_EQUAL(0, _errors);
+}
+
+int main(void)
+{
+	TEST_RUN(test_probe);
+	TEST_RUN(test_page_program_polling);
+	TEST_RUN(test_write_pages);
+	TEST_RUN(test_erase_plan);
+	TEST_RUN(test_sector_map);
+	TEST_RUN(test_async_write);
+	TEST_RUN(test_read_suspends_erase);
+	TEST_RUN(test_timeout);
+	return 0;
+}
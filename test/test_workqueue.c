@@ -0,0 +1,357 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host tests of the deferred work queues: priority and FIFO order, posting
+ * an already queued work, posting from a running work, statistics and the
+ * idle path of the main loop. Time only moves when a test advances it.
+ *
+ * Work items stay registered for the statistics once initialized, so the
+ * simulated works are static.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "callback.h"
+#include "errno.h"
+#include "test.h"
+#include "timer.h"
+#include "workqueue.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define MAX_EVENTS 32
+
+/* simulated work: records its run, optionally takes time or posts work */
+struct _sim_work {
+	struct _work work;
+	char id;
+	uint32_t duration;     /* ticks spent in the callback */
+	struct _work* post;    /* work posted from the callback */
+	int reposts;           /* number of times the work posts itself again */
+	void* arg;             /* argument of the last run */
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+uint32_t test_irq_disabled;
+
+static uint64_t _tick;
+
+static char _events[MAX_EVENTS];
+static int _event_count;
+
+/* idle path */
+static jmp_buf _idle_exit;
+static int _idle_calls;
+static struct _sim_work* _idle_post;
+
+/*----------------------------------------------------------------------------
+ *         Timer and CPU
+ *----------------------------------------------------------------------------*/
+
+uint64_t timer_get_tick(void)
+{
+	return _tick;
+}
+
+uint64_t timer_get_interval(uint64_t start, uint64_t end)
+{
+	return end - start;
+}
+
+void cpu_idle(void)
+{
+	TEST_ASSERT(test_irq_disabled);
+	_idle_calls++;
+	longjmp(_idle_exit, 1);
+}
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static void _event(char e)
+{
+	TEST_ASSERT(_event_count < MAX_EVENTS - 1);
+	_events[_event_count++] = e;
+	_events[_event_count] = 0;
+}
+
+static int _sim_run(void* arg, void* arg2)
+{
+	struct _sim_work* s = (struct _sim_work*)arg;
+
+	/* work runs with interrupts enabled */
+	TEST_ASSERT(!test_irq_disabled);
+	_event(s->id);
+	s->arg = arg2;
+	_tick += s->duration;
+	if (s->post)
+		defer(s->post, NULL);
+	if (s->reposts > 0) {
+		s->reposts--;
+		TEST_ASSERT_EQUAL(0, defer(&s->work, arg2));
+	}
+	return 0;
+}
+
+static void _sim_init(struct _sim_work* s, char id, enum _work_prio prio)
+{
+	struct _callback cb;
+
+	/* the work stays registered: only clear the simulation state */
+	s->id = id;
+	s->duration = 0;
+	s->post = NULL;
+	s->reposts = 0;
+	s->arg = NULL;
+	callback_set(&cb, _sim_run, s);
+	work_init(&s->work, "sim", prio, &cb);
+}
+
+static void _reset(void)
+{
+	/* every test leaves the queues empty */
+	TEST_ASSERT(!workqueue_run_one());
+	TEST_ASSERT(!test_irq_disabled);
+	_event_count = 0;
+	_events[0] = 0;
+	_idle_calls = 0;
+	_idle_post = NULL;
+}
+
+static int _idle_hook(void* arg, void* arg2)
+{
+	TEST_ASSERT(test_irq_disabled);
+	_idle_calls++;
+
+	/* an interrupt posts a work while the CPU waits, the second wait
+	 * ends the test */
+	_tick += 5;
+	if (_idle_post) {
+		defer(&_idle_post->work, NULL);
+		_idle_post = NULL;
+		return 0;
+	}
+	longjmp(_idle_exit, 1);
+	return 0;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_order(void)
+{
+	static struct _sim_work low, normal1, normal2, high;
+
+	_reset();
+	_sim_init(&low, 'L', WORK_PRIO_LOW);
+	_sim_init(&normal1, 'N', WORK_PRIO_NORMAL);
+	_sim_init(&normal2, 'M', WORK_PRIO_NORMAL);
+	_sim_init(&high, 'H', WORK_PRIO_HIGH);
+
+	TEST_ASSERT_EQUAL(0, defer(&low.work, NULL));
+	TEST_ASSERT_EQUAL(0, defer(&normal1.work, NULL));
+	TEST_ASSERT_EQUAL(0, defer(&normal2.work, NULL));
+	TEST_ASSERT_EQUAL(0, defer(&high.work, NULL));
+	TEST_ASSERT(!test_irq_disabled);
+
+	/* highest priority first, posting order inside a queue */
+	TEST_ASSERT(workqueue_run_one());
+	TEST_ASSERT(!strcmp("H", _events));
+	workqueue_run_pending();
+	TEST_ASSERT(!strcmp("HNML", _events));
+	TEST_ASSERT(!workqueue_run_one());
+}
+
+static void test_defer_queued(void)
+{
+	static struct _sim_work w;
+	int a, b;
+
+	_reset();
+	_sim_init(&w, 'A', WORK_PRIO_NORMAL);
+
+	TEST_ASSERT(!work_is_queued(&w.work));
+	TEST_ASSERT_EQUAL(0, defer(&w.work, &a));
+	TEST_ASSERT(work_is_queued(&w.work));
+
+	/* runs once, with the argument of the first post */
+	TEST_ASSERT_EQUAL(-EBUSY, defer(&w.work, &b));
+	workqueue_run_pending();
+	TEST_ASSERT(!strcmp("A", _events));
+	TEST_ASSERT(w.arg == &a);
+	TEST_ASSERT(!work_is_queued(&w.work));
+	TEST_ASSERT_EQUAL(1, w.work.runs);
+}
+
+static void test_post_from_work(void)
+{
+	static struct _sim_work low, high, self;
+
+	_reset();
+	_sim_init(&low, 'L', WORK_PRIO_LOW);
+	_sim_init(&high, 'H', WORK_PRIO_HIGH);
+	_sim_init(&self, 'S', WORK_PRIO_NORMAL);
+
+	/* a work can post itself again as soon as it starts */
+	self.reposts = 2;
+	TEST_ASSERT_EQUAL(0, defer(&self.work, NULL));
+	workqueue_run_pending();
+	TEST_ASSERT(!strcmp("SSS", _events));
+
+	/* a work posted by a lower priority work runs next */
+	_event_count = 0;
+	low.post = &high.work;
+	TEST_ASSERT_EQUAL(0, defer(&low.work, NULL));
+	TEST_ASSERT_EQUAL(0, defer(&self.work, NULL));
+	TEST_ASSERT(workqueue_run_one());
+	TEST_ASSERT(workqueue_run_one());
+	TEST_ASSERT(!strcmp("SL", _events));
+	TEST_ASSERT(work_is_queued(&high.work));
+	workqueue_run_pending();
+	TEST_ASSERT(!strcmp("SLH", _events));
+}
+
+static void test_statistics(void)
+{
+	static struct _sim_work w;
+
+	_reset();
+	_sim_init(&w, 'A', WORK_PRIO_NORMAL);
+
+	w.duration = 10;
+	defer(&w.work, NULL);
+	_tick += 3;
+	workqueue_run_pending();
+
+	w.duration = 4;
+	defer(&w.work, NULL);
+	_tick += 7;
+	workqueue_run_pending();
+
+	TEST_ASSERT_EQUAL(2, w.work.runs);
+	TEST_ASSERT_EQUAL(14, w.work.total_time);
+	TEST_ASSERT_EQUAL(10, w.work.max_time);
+	TEST_ASSERT_EQUAL(7, w.work.max_latency);
+
+	/* initializing again resets the statistics */
+	_sim_init(&w, 'A', WORK_PRIO_NORMAL);
+	TEST_ASSERT_EQUAL(0, w.work.runs);
+}
+
+static void test_invalid_prio(void)
+{
+	static struct _sim_work low, w;
+
+	_reset();
+	_sim_init(&w, 'W', WORK_PRIO_COUNT);
+	_sim_init(&low, 'L', WORK_PRIO_LOW);
+	TEST_ASSERT_EQUAL(WORK_PRIO_LOW, w.work.prio);
+
+	TEST_ASSERT_EQUAL(0, defer(&w.work, NULL));
+	TEST_ASSERT_EQUAL(0, defer(&low.work, NULL));
+	workqueue_run_pending();
+	TEST_ASSERT(!strcmp("WL", _events));
+}
+
+static void test_idle_hook(void)
+{
+	struct _callback cb;
+	static struct _sim_work w;
+	uint64_t idle_start = workqueue_get_idle_time();
+
+	_reset();
+	_sim_init(&w, 'A', WORK_PRIO_NORMAL);
+	_idle_post = &w;
+	callback_set(&cb, _idle_hook, NULL);
+	workqueue_set_idle_hook(&cb);
+
+	/* the first idle call posts a work, which runs before the second */
+	if (!setjmp(_idle_exit))
+		workqueue_run();
+	test_irq_disabled = 0;
+
+	TEST_ASSERT_EQUAL(2, _idle_calls);
+	TEST_ASSERT(!strcmp("A", _events));
+	TEST_ASSERT_EQUAL(1, w.work.runs);
+	/* only the completed idle call is accounted */
+	TEST_ASSERT_EQUAL(5, workqueue_get_idle_time() - idle_start);
+
+	workqueue_set_idle_hook(NULL);
+}
+
+static void test_default_idle(void)
+{
+	static struct _sim_work w;
+
+	_reset();
+	_sim_init(&w, 'A', WORK_PRIO_HIGH);
+	workqueue_set_idle_hook(NULL);
+
+	/* queued work runs first, then the CPU waits */
+	defer(&w.work, NULL);
+	if (!setjmp(_idle_exit))
+		workqueue_run();
+	test_irq_disabled = 0;
+
+	TEST_ASSERT(!strcmp("A", _events));
+	TEST_ASSERT_EQUAL(1, _idle_calls);
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	TEST_RUN(test_order);
+	TEST_RUN(test_defer_queued);
+	TEST_RUN(test_post_from_work);
+	TEST_RUN(test_statistics);
+	TEST_RUN(test_invalid_prio);
+	TEST_RUN(test_idle_hook);
+	TEST_RUN(test_default_idle);
+	return 0;
+}
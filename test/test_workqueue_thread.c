@@ -0,0 +1,268 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Host test of the deferred work queues posted from interrupts. Two host
+ * threads play two interrupt sources, each posting its own work at a fixed
+ * interval, while the main thread runs the main loop. Masking interrupts
+ * takes a lock shared with these threads, and cpu_idle() waits until one of
+ * them has posted. The post-to-run latency is measured on the host clock
+ * and printed.
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "callback.h"
+#include "errno.h"
+#include "irqflags.h"
+#include "test.h"
+#include "timer.h"
+#include "workqueue.h"
+
+/*----------------------------------------------------------------------------
+ *         Local definitions
+ *----------------------------------------------------------------------------*/
+
+#define POSTERS 2
+#define POSTS 500
+
+/* interval between two posts of a source, in microseconds */
+#define POST_INTERVAL 100
+
+/* one post of an interrupt source */
+struct _post {
+	uint64_t tick;         /* time of the post */
+	uint64_t latency;      /* time from post to run */
+	bool busy;             /* the work was still queued */
+	int runs;
+};
+
+/* interrupt source and the work it posts */
+struct _poster {
+	pthread_t thread;
+	struct _work work;
+	struct _post posts[POSTS];
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+/* interrupt mask */
+static pthread_mutex_t _irq_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _irq_cond = PTHREAD_COND_INITIALIZER;
+static __thread bool _irq_masked;
+
+static struct _poster _posters[POSTERS];
+static int _posters_done;
+
+static jmp_buf _idle_exit;
+static int _idle_calls;
+
+/*----------------------------------------------------------------------------
+ *         Interrupt mask, timer and CPU
+ *----------------------------------------------------------------------------*/
+
+uint32_t arch_irq_save(void)
+{
+	if (_irq_masked)
+		return 1;
+	pthread_mutex_lock(&_irq_lock);
+	_irq_masked = true;
+	return 0;
+}
+
+void arch_irq_restore(uint32_t flags)
+{
+	if (flags)
+		return;
+	_irq_masked = false;
+	pthread_mutex_unlock(&_irq_lock);
+}
+
+uint64_t timer_get_tick(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint64_t timer_get_interval(uint64_t start, uint64_t end)
+{
+	return end - start;
+}
+
+void cpu_idle(void)
+{
+	int i;
+
+	/* the main loop only waits with interrupts masked and nothing queued */
+	TEST_ASSERT(_irq_masked);
+	for (i = 0; i < POSTERS; i++)
+		TEST_ASSERT(!work_is_queued(&_posters[i].work));
+
+	_idle_calls++;
+	if (_posters_done == POSTERS)
+		longjmp(_idle_exit, 1);
+
+	/* wait for interrupt, the lock is released meanwhile */
+	pthread_cond_wait(&_irq_cond, &_irq_lock);
+}
+
+/*----------------------------------------------------------------------------
+ *         Local functions
+ *----------------------------------------------------------------------------*/
+
+static int _work_run(void* arg, void* arg2)
+{
+	struct _post* post = (struct _post*)arg2;
+
+	/* work runs with interrupts enabled */
+	TEST_ASSERT(!_irq_masked);
+	post->latency = timer_get_interval(post->tick, timer_get_tick());
+	post->runs++;
+	return 0;
+}
+
+static void* _poster_thread(void* arg)
+{
+	struct _poster* poster = (struct _poster*)arg;
+	const struct timespec interval = { 0, POST_INTERVAL * 1000 };
+	uint32_t flags;
+	int i;
+
+	for (i = 0; i < POSTS; i++) {
+		struct _post* post = &poster->posts[i];
+
+		nanosleep(&interval, NULL);
+
+		/* interrupt handler */
+		flags = arch_irq_save();
+		post->tick = timer_get_tick();
+		post->busy = defer(&poster->work, post) == -EBUSY;
+		pthread_cond_signal(&_irq_cond);
+		arch_irq_restore(flags);
+	}
+
+	flags = arch_irq_save();
+	_posters_done++;
+	pthread_cond_signal(&_irq_cond);
+	arch_irq_restore(flags);
+	return NULL;
+}
+
+static int _compare(const void* a, const void* b)
+{
+	uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*----------------------------------------------------------------------------
+ *         Tests
+ *----------------------------------------------------------------------------*/
+
+static void test_interrupt_posts(void)
+{
+	static const enum _work_prio prio[POSTERS] = {
+		WORK_PRIO_HIGH, WORK_PRIO_LOW,
+	};
+	static uint64_t latencies[POSTERS * POSTS];
+	struct _callback cb;
+	int count = 0, i, j;
+
+	callback_set(&cb, _work_run, NULL);
+	for (i = 0; i < POSTERS; i++)
+		work_init(&_posters[i].work, "irq", prio[i], &cb);
+	workqueue_set_idle_hook(NULL);
+
+	for (i = 0; i < POSTERS; i++)
+		TEST_ASSERT_EQUAL(0, pthread_create(&_posters[i].thread, NULL,
+				_poster_thread, &_posters[i]));
+
+	/* main loop, until the sources are done and the queues are empty */
+	if (!setjmp(_idle_exit))
+		workqueue_run();
+	arch_irq_restore(0);
+
+	for (i = 0; i < POSTERS; i++)
+		pthread_join(_posters[i].thread, NULL);
+
+	/* every post but those finding the work still queued runs once */
+	for (i = 0; i < POSTERS; i++) {
+		struct _poster* poster = &_posters[i];
+		uint64_t max = 0;
+		int runs = 0;
+
+		for (j = 0; j < POSTS; j++) {
+			struct _post* post = &poster->posts[j];
+
+			TEST_ASSERT_EQUAL(post->busy ? 0 : 1, post->runs);
+			if (post->busy)
+				continue;
+			runs++;
+			latencies[count++] = post->latency;
+			if (post->latency > max)
+				max = post->latency;
+		}
+		TEST_ASSERT_EQUAL(runs, poster->work.runs);
+		/* the work measures from inside defer() to the callback */
+		TEST_ASSERT(poster->work.max_latency <= max);
+	}
+	TEST_ASSERT(_idle_calls > 0);
+
+	qsort(latencies, count, sizeof(latencies[0]), _compare);
+	printf("    %d posts, latency (us): median %u, 99%% %u, max %u\n",
+	       count, (unsigned)latencies[count / 2],
+	       (unsigned)latencies[count * 99 / 100],
+	       (unsigned)latencies[count - 1]);
+}
+
+/*----------------------------------------------------------------------------
+ *         Main
+ *----------------------------------------------------------------------------*/
+
+int main(void)
+{
+	TEST_RUN(test_interrupt_posts);
+	return 0;
+}
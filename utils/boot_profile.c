@@ -0,0 +1,89 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdio.h>
+
+#include "boot_profile.h"
+#include "timer.h"
+
+/*----------------------------------------------------------------------------
+ *         Local types
+ *----------------------------------------------------------------------------*/
+
+struct _boot_marker {
+	const char* name;
+	uint64_t tick;
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static struct _boot_marker _markers[BOOT_PROFILE_MAX_MARKERS];
+
+static uint32_t _marker_count;
+
+static uint32_t _markers_dropped;
+
+/*----------------------------------------------------------------------------
+ *         Public methods
+ *----------------------------------------------------------------------------*/
+
+void boot_profile_mark(const char* name)
+{
+	if (_marker_count >= BOOT_PROFILE_MAX_MARKERS) {
+		_markers_dropped++;
+		return;
+	}
+
+	_markers[_marker_count].name = name;
+	_markers[_marker_count].tick = timer_get_tick();
+	_marker_count++;
+}
+
+void boot_profile_dump(void)
+{
+	uint64_t prev = 0;
+	int i;
+
+	printf("\r\n   Time(ms)  Phase(ms)  Phase\r\n");
+	for (i = 0; i < _marker_count; i++) {
+		printf("  %9u  %9u  %s\r\n",
+		       (unsigned)_markers[i].tick,
+		       (unsigned)timer_get_interval(prev, _markers[i].tick),
+		       _markers[i].name);
+		prev = _markers[i].tick;
+	}
+	if (_markers_dropped)
+		printf("  (%u markers dropped)\r\n", (unsigned)_markers_dropped);
+}
@@ -0,0 +1,77 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef _BOOT_PROFILE_H
+#define _BOOT_PROFILE_H
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+/*----------------------------------------------------------------------------
+ *         Public definitions
+ *----------------------------------------------------------------------------*/
+
+/** Maximum number of phase markers recorded */
+#define BOOT_PROFILE_MAX_MARKERS 32
+
+/*----------------------------------------------------------------------------
+ *         Public methods
+ *----------------------------------------------------------------------------*/
+
+#ifdef CONFIG_BOOT_PROFILE
+
+/**
+ * \brief Record the end of a boot phase
+ *
+ * The marker is timestamped with timer_get_tick(), it must not be called
+ * before the system timer is configured. Markers past
+ * BOOT_PROFILE_MAX_MARKERS are dropped.
+ *
+ * \param name   Name of the phase, must be a static string
+ */
+extern void boot_profile_mark(const char* name);
+
+/**
+ * \brief Print the recorded markers as a table, with the time spent in each
+ * phase
+ */
+extern void boot_profile_dump(void);
+
+#else /* !CONFIG_BOOT_PROFILE */
+
+static inline void boot_profile_mark(const char* name) {}
+
+static inline void boot_profile_dump(void) {}
+
+#endif /* !CONFIG_BOOT_PROFILE */
+
+#endif /* _BOOT_PROFILE_H */
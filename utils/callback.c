@@ -34,6 +34,7 @@
 #include <stdlib.h>
 
 #include "callback.h"
+#include "compiler.h"
 #include "errno.h"
 
 /*----------------------------------------------------------------------------
@@ -74,6 +75,7 @@ void callback_copy(struct _callback* cb, struct _callback* orig)
 	}
 }
 
+RAMFUNC
 int callback_call(struct _callback* cb, void* arg2)
 {
 	if (cb && cb->method)
@@ -105,6 +105,16 @@
 		(((uint64_t)BIG_ENDIAN_TO_HOST((uint32_t)((x) & 0xffffffff)) << 32) | \
 		(((uint64_t)BIG_ENDIAN_TO_HOST((uint32_t)((x) >> 32)))))
 
+/* Hot code and data placed in internal SRAM by the linker scripts and copied
+ * there by the startup code, for programs running from QSPI (XIP) or DDR */
+#if defined(__ICCARM__)
+	#define RAMFUNC __ramfunc
+	#define FASTDATA
+#elif defined(__GNUC__)
+	#define RAMFUNC SECTION(".ramfunc") __attribute__((__noinline__))
+	#define FASTDATA SECTION(".fastdata")
+#endif
+
 #ifdef CONFIG_RAMCODE
 	#define RAMCODE SECTION(".ramcode_section")
 	#define RAMDATA SECTION(".ramdata_section")
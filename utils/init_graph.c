@@ -0,0 +1,186 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "boot_profile.h"
+#include "errno.h"
+#include "init_graph.h"
+#include "timer.h"
+#include "trace.h"
+
+/*----------------------------------------------------------------------------
+ *         Local methods
+ *----------------------------------------------------------------------------*/
+
+static void _init_step_end(struct _init_step* step, int status)
+{
+	step->end_tick = timer_get_tick();
+	step->status = status;
+	if (status < 0) {
+		step->state = INIT_STEP_FAILED;
+		trace_error("init: step '%s' failed (%d)\r\n", step->name, status);
+	} else {
+		step->state = INIT_STEP_DONE;
+		boot_profile_mark(step->name);
+	}
+}
+
+static void _init_step_update(struct _init_step* step, int rc)
+{
+	if (rc <= 0)
+		_init_step_end(step, rc);
+	else if (!step->poll)
+		_init_step_end(step, -EINVAL);
+	else
+		step->state = INIT_STEP_RUNNING;
+}
+
+static void _init_step_poll(struct _init_step* step)
+{
+	int rc = step->poll(step->arg);
+
+	if (rc > 0 && step->timeout &&
+	    timer_get_interval(step->start_tick, timer_get_tick()) >= step->timeout)
+		rc = -ETIMEDOUT;
+
+	_init_step_update(step, rc);
+}
+
+static void _init_step_start(struct _init_step* step)
+{
+	step->start_tick = timer_get_tick();
+	_init_step_update(step, step->start(step->arg));
+}
+
+/*----------------------------------------------------------------------------
+ *         Public methods
+ *----------------------------------------------------------------------------*/
+
+int init_graph_run(struct _init_step* steps, uint32_t count)
+{
+	uint32_t valid = count >= 32 ? 0xffffffff : INIT_STEP_DEP(count) - 1;
+	uint32_t done, failed, pending;
+	bool progress, async;
+	int i, rc = 0;
+
+	if (count > INIT_GRAPH_MAX_STEPS)
+		return -EINVAL;
+
+	for (i = 0; i < count; i++) {
+		if ((steps[i].deps & ~valid) || (steps[i].deps & INIT_STEP_DEP(i)))
+			return -EINVAL;
+		steps[i].state = INIT_STEP_PENDING;
+		steps[i].status = 0;
+		steps[i].start_tick = 0;
+		steps[i].end_tick = 0;
+	}
+
+	do {
+		progress = false;
+
+		/* make progress on the steps already started */
+		for (i = 0; i < count; i++) {
+			if (steps[i].state == INIT_STEP_RUNNING) {
+				_init_step_poll(&steps[i]);
+				progress = true;
+			}
+		}
+
+		done = failed = pending = 0;
+		for (i = 0; i < count; i++) {
+			if (steps[i].state == INIT_STEP_DONE)
+				done |= INIT_STEP_DEP(i);
+			else if (steps[i].state == INIT_STEP_FAILED)
+				failed |= INIT_STEP_DEP(i);
+			else if (steps[i].state == INIT_STEP_PENDING)
+				pending |= INIT_STEP_DEP(i);
+		}
+
+		/* cancel the steps depending on failed ones */
+		for (i = 0; i < count; i++) {
+			if ((pending & INIT_STEP_DEP(i)) && (steps[i].deps & failed)) {
+				steps[i].state = INIT_STEP_FAILED;
+				steps[i].status = -ECANCELED;
+				pending &= ~INIT_STEP_DEP(i);
+				progress = true;
+			}
+		}
+
+		/* start ready steps, asynchronous ones first so that they
+		 * progress while synchronous ones run */
+		for (async = true; ; async = false) {
+			for (i = 0; i < count; i++) {
+				if (!(pending & INIT_STEP_DEP(i)))
+					continue;
+				if ((steps[i].deps & done) != steps[i].deps)
+					continue;
+				if ((steps[i].poll != NULL) != async)
+					continue;
+				_init_step_start(&steps[i]);
+				pending &= ~INIT_STEP_DEP(i);
+				progress = true;
+			}
+			if (!async)
+				break;
+		}
+	} while (progress);
+
+	for (i = 0; i < count; i++) {
+		if (steps[i].state == INIT_STEP_PENDING) {
+			/* dependency cycle */
+			steps[i].state = INIT_STEP_FAILED;
+			steps[i].status = -EINVAL;
+		}
+		if (rc == 0 && steps[i].status < 0 &&
+		    steps[i].status != -ECANCELED)
+			rc = steps[i].status;
+	}
+
+	return rc;
+}
+
+void init_graph_dump(const struct _init_step* steps, uint32_t count)
+{
+	int i;
+
+	printf("\r\n   Start(ms)  Time(ms)  Status  Step\r\n");
+	for (i = 0; i < count; i++) {
+		printf("  %10u  %8u  %6d  %s\r\n",
+		       (unsigned)steps[i].start_tick,
+		       (unsigned)timer_get_interval(steps[i].start_tick,
+		                                    steps[i].end_tick),
+		       steps[i].status, steps[i].name);
+	}
+}
@@ -0,0 +1,130 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Initialization graph: runs initialization steps in dependency order,
+ * interleaving the steps that wait for hardware (PHY auto-negotiation, card
+ * identification, sensor power-up...) instead of running them one after the
+ * other.
+ *
+ * A step is started once all the steps it depends on are complete. Its start
+ * method either completes the step or starts it and returns 1, the poll
+ * method is then called until the step completes. Steps failing or timing
+ * out cancel the steps depending on them, independent steps still run.
+ */
+
+#ifndef _INIT_GRAPH_H
+#define _INIT_GRAPH_H
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdint.h>
+
+/*----------------------------------------------------------------------------
+ *         Public definitions
+ *----------------------------------------------------------------------------*/
+
+/** Maximum number of steps in a graph (size of the dependency mask) */
+#define INIT_GRAPH_MAX_STEPS 32
+
+/** Dependency on the step at index \a i of the step table */
+#define INIT_STEP_DEP(i) (1u << (i))
+
+enum _init_step_state {
+	INIT_STEP_PENDING = 0,
+	INIT_STEP_RUNNING,
+	INIT_STEP_DONE,
+	INIT_STEP_FAILED,
+};
+
+/*----------------------------------------------------------------------------
+ *         Public types
+ *----------------------------------------------------------------------------*/
+
+struct _init_step {
+	/** Name of the step, reported in the timing table */
+	const char* name;
+
+	/** Start the step: return 0 when complete, 1 when in progress or a
+	 *  negative error code */
+	int (*start)(void* arg);
+
+	/** Make progress on a step in progress, same return values as start.
+	 *  NULL if start always completes the step */
+	int (*poll)(void* arg);
+
+	/** Argument given to start and poll */
+	void* arg;
+
+	/** Steps to complete first (INIT_STEP_DEP() mask) */
+	uint32_t deps;
+
+	/** Timeout in ms for a step in progress, 0 for none */
+	uint32_t timeout;
+
+	/* runtime state, do not initialize */
+	enum _init_step_state state;
+	int status;
+	uint64_t start_tick;
+	uint64_t end_tick;
+};
+
+/*----------------------------------------------------------------------------
+ *         Public methods
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Run initialization steps until all are complete or failed
+ *
+ * In each pass, the steps in progress are polled, then the steps whose
+ * dependencies are complete are started, the ones with a poll method first
+ * so that they progress while the synchronous ones run.
+ *
+ * \param steps  Table of steps
+ * \param count  Number of steps (at most INIT_GRAPH_MAX_STEPS)
+ * \return 0 if all steps completed, the error code of the first failed step
+ * in the table, or -EINVAL if the dependencies are invalid or cyclic
+ * \note A step that times out is not polled anymore: its start method must
+ * be able to restart it from any state if it is run again.
+ */
+extern int init_graph_run(struct _init_step* steps, uint32_t count);
+
+/**
+ * \brief Print the start time, duration and status of each step
+ *
+ * \param steps  Table of steps, after init_graph_run()
+ * \param count  Number of steps
+ */
+extern void init_graph_dump(const struct _init_step* steps, uint32_t count);
+
+#endif /* _INIT_GRAPH_H */
@@ -184,3 +184,13 @@ void usleep(uint32_t count)
 	/* Re-enable interrupts */
 	arch_irq_enable();
 }
+
+void timer_delay_us(uint32_t count)
+{
+	uint64_t deadline;
+
+	deadline = _timer_get_tick();
+	deadline += ROUND_INT_DIV((_timer.channel_freq / 1000) * (uint64_t)count, 1000);
+
+	while ((int64_t)(_timer_get_tick() - deadline) < 0);
+}
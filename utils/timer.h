@@ -127,4 +127,13 @@ extern void msleep(uint32_t count);
  */
 extern void usleep(uint32_t count);
 
+/**
+ *  \brief Wait for at least count microseconds
+ *
+ * Unlike usleep(), the interrupt state is left untouched: this is safe to
+ * call from code that runs with interrupts masked as well as from code that
+ * must not lose them. Interrupt handlers may lengthen the wait.
+ */
+extern void timer_delay_us(uint32_t count);
+
 #endif /* TIMER_H_ */
@@ -0,0 +1,250 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cpuidle.h"
+#include "errno.h"
+#include "irqflags.h"
+#include "timer.h"
+#include "workqueue.h"
+
+/*----------------------------------------------------------------------------
+ *         Local types
+ *----------------------------------------------------------------------------*/
+
+struct _work_queue {
+	struct _work* head;
+	struct _work* tail;
+};
+
+/*----------------------------------------------------------------------------
+ *         Local variables
+ *----------------------------------------------------------------------------*/
+
+static struct _work_queue _queues[WORK_PRIO_COUNT];
+
+/** Registered work items, for the statistics */
+static struct _work* _registered;
+
+static struct _callback _idle_hook;
+
+static uint64_t _idle_time;
+
+/*----------------------------------------------------------------------------
+ *         Local methods
+ *----------------------------------------------------------------------------*/
+
+static bool _queues_empty(void)
+{
+	int prio;
+
+	for (prio = 0; prio < WORK_PRIO_COUNT; prio++)
+		if (_queues[prio].head)
+			return false;
+	return true;
+}
+
+static struct _work* _dequeue(void)
+{
+	struct _work* work;
+	int prio;
+
+	for (prio = 0; prio < WORK_PRIO_COUNT; prio++) {
+		struct _work_queue* queue = &_queues[prio];
+
+		work = queue->head;
+		if (work) {
+			queue->head = work->next;
+			if (!queue->head)
+				queue->tail = NULL;
+			work->next = NULL;
+			return work;
+		}
+	}
+
+	return NULL;
+}
+
+static void _idle(void)
+{
+	uint64_t start = timer_get_tick();
+	uint32_t flags = arch_irq_save();
+
+	/* checked with interrupts disabled so that a work posted from an
+	 * interrupt cannot be missed before waiting */
+	if (!_queues_empty()) {
+		arch_irq_restore(flags);
+		return;
+	}
+
+	if (_idle_hook.method)
+		callback_call(&_idle_hook, NULL);
+	else
+		cpu_idle();
+
+	arch_irq_restore(flags);
+	_idle_time += timer_get_interval(start, timer_get_tick());
+}
+
+/*----------------------------------------------------------------------------
+ *         Public methods
+ *----------------------------------------------------------------------------*/
+
+void work_init(struct _work* work, const char* name,
+		enum _work_prio prio, struct _callback* callback)
+{
+	struct _work* item;
+
+	work->name = name;
+	callback_copy(&work->callback, callback);
+	work->prio = prio < WORK_PRIO_COUNT ? prio : WORK_PRIO_LOW;
+	work->next = NULL;
+	work->queued = false;
+	work->arg = NULL;
+	work->post_tick = 0;
+	work->runs = 0;
+	work->total_time = 0;
+	work->max_time = 0;
+	work->max_latency = 0;
+
+	for (item = _registered; item; item = item->registered)
+		if (item == work)
+			return;
+	work->registered = _registered;
+	_registered = work;
+}
+
+int defer(struct _work* work, void* arg)
+{
+	struct _work_queue* queue = &_queues[work->prio];
+	uint64_t tick = timer_get_tick();
+	uint32_t flags = arch_irq_save();
+
+	if (work->queued) {
+		arch_irq_restore(flags);
+		return -EBUSY;
+	}
+
+	work->queued = true;
+	work->arg = arg;
+	work->post_tick = tick;
+	work->next = NULL;
+	if (queue->tail)
+		queue->tail->next = work;
+	else
+		queue->head = work;
+	queue->tail = work;
+
+	arch_irq_restore(flags);
+	return 0;
+}
+
+bool work_is_queued(const struct _work* work)
+{
+	return work->queued;
+}
+
+bool workqueue_run_one(void)
+{
+	struct _work* work;
+	uint64_t post_tick = 0, start, end;
+	uint32_t flags, elapsed, latency;
+	void* arg = NULL;
+
+	flags = arch_irq_save();
+	work = _dequeue();
+	if (work) {
+		/* the work can be posted again as soon as it starts */
+		arg = work->arg;
+		post_tick = work->post_tick;
+		work->queued = false;
+	}
+	arch_irq_restore(flags);
+
+	if (!work)
+		return false;
+
+	start = timer_get_tick();
+	latency = timer_get_interval(post_tick, start);
+	callback_call(&work->callback, arg);
+	end = timer_get_tick();
+
+	elapsed = timer_get_interval(start, end);
+	work->runs++;
+	work->total_time += elapsed;
+	if (elapsed > work->max_time)
+		work->max_time = elapsed;
+	if (latency > work->max_latency)
+		work->max_latency = latency;
+
+	return true;
+}
+
+void workqueue_run_pending(void)
+{
+	while (workqueue_run_one());
+}
+
+void workqueue_set_idle_hook(struct _callback* callback)
+{
+	callback_copy(&_idle_hook, callback);
+}
+
+void workqueue_run(void)
+{
+	while (1) {
+		workqueue_run_pending();
+		_idle();
+	}
+}
+
+uint64_t workqueue_get_idle_time(void)
+{
+	return _idle_time;
+}
+
+void workqueue_dump(void)
+{
+	const struct _work* work;
+
+	printf("\r\n  Prio      Runs   Total   Max  Latency  Work\r\n");
+	for (work = _registered; work; work = work->registered) {
+		printf("  %4d  %8u  %6u  %4u  %7u  %s\r\n",
+		       work->prio, (unsigned)work->runs,
+		       (unsigned)work->total_time, (unsigned)work->max_time,
+		       (unsigned)work->max_latency, work->name);
+	}
+	printf("  Idle: %u\r\n", (unsigned)_idle_time);
+}
@@ -0,0 +1,180 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2017, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ * \file
+ *
+ * Deferred work queues: a run-to-completion cooperative scheduler for
+ * applications without an RTOS.
+ *
+ * Interrupt handlers and driver callbacks post work items with defer() and
+ * return, the work itself then runs from the main loop, highest priority
+ * queue first. A work item is queued at most once: posting it again before
+ * it runs has no effect. When all queues are empty the idle hook is called,
+ * by default the CPU waits for the next interrupt (cpu_idle).
+ *
+ * Usage:
+ * \code
+ * static struct _work rx_work;
+ *
+ * static int _on_rx_done(void* arg, void* arg2)
+ * {
+ *         defer(&rx_work, arg2);
+ *         return 0;
+ * }
+ *
+ * work_init(&rx_work, "rx", WORK_PRIO_HIGH, &rx_process_callback);
+ * ...
+ * workqueue_run();
+ * \endcode
+ */
+
+#ifndef _WORKQUEUE_H
+#define _WORKQUEUE_H
+
+/*----------------------------------------------------------------------------
+ *         Headers
+ *----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "callback.h"
+
+/*----------------------------------------------------------------------------
+ *         Public definitions
+ *----------------------------------------------------------------------------*/
+
+enum _work_prio {
+	WORK_PRIO_HIGH = 0,
+	WORK_PRIO_NORMAL,
+	WORK_PRIO_LOW,
+	WORK_PRIO_COUNT,
+};
+
+/*----------------------------------------------------------------------------
+ *         Public types
+ *----------------------------------------------------------------------------*/
+
+struct _work {
+	/** Name of the work, reported in the statistics table */
+	const char* name;
+
+	/** Method called when the work runs, with the argument given to
+	 *  defer() as second argument */
+	struct _callback callback;
+
+	/** Queue the work is posted to */
+	enum _work_prio prio;
+
+	/* Private: queue management */
+	struct _work* next;
+	struct _work* registered;
+	volatile bool queued;
+	void* arg;
+	uint64_t post_tick;
+
+	/* Statistics, in timer ticks */
+	uint32_t runs;
+	uint64_t total_time;
+	uint32_t max_time;
+	uint32_t max_latency;
+};
+
+/*----------------------------------------------------------------------------
+ *         Public methods
+ *----------------------------------------------------------------------------*/
+
+/**
+ * \brief Initialize a work item and register it for the statistics.
+ *
+ * \param work     Work item
+ * \param name     Name of the work
+ * \param prio     Queue the work is posted to
+ * \param callback Method to call when the work runs
+ */
+extern void work_init(struct _work* work, const char* name,
+		enum _work_prio prio, struct _callback* callback);
+
+/**
+ * \brief Post a work item. Can be called from interrupt context.
+ *
+ * \param work Work item
+ * \param arg  Second argument given to the work callback
+ * \return 0 on success, -EBUSY if the work is already queued (the work will
+ * run once, with the argument of the first post)
+ */
+extern int defer(struct _work* work, void* arg);
+
+/**
+ * \brief Check whether a work item is queued.
+ */
+extern bool work_is_queued(const struct _work* work);
+
+/**
+ * \brief Run the highest priority queued work item, if any.
+ *
+ * \return true if a work item was run
+ */
+extern bool workqueue_run_one(void);
+
+/**
+ * \brief Run queued work items until all queues are empty.
+ */
+extern void workqueue_run_pending(void);
+
+/**
+ * \brief Set the method called when all queues are empty.
+ *
+ * The method is called with interrupts disabled and must return with
+ * interrupts disabled; it can wait for an interrupt since a pending
+ * interrupt still wakes up the CPU. Use NULL to restore the default,
+ * cpu_idle().
+ *
+ * \param callback Idle method
+ */
+extern void workqueue_set_idle_hook(struct _callback* callback);
+
+/**
+ * \brief Scheduler main loop: run the work items and call the idle hook when
+ * there is nothing left to do. Never returns.
+ */
+extern void workqueue_run(void);
+
+/**
+ * \brief Time spent in the idle hook since the start, in timer ticks.
+ */
+extern uint64_t workqueue_get_idle_time(void);
+
+/**
+ * \brief Print the statistics of the registered work items.
+ */
+extern void workqueue_dump(void);
+
+#endif /* _WORKQUEUE_H */